@@ -0,0 +1,111 @@
+﻿#include "Benchmark.h"
+#include "TestScene.h"
+#include "Graphics/Animation.h"
+#include "Core/JobSystem.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+    constexpr uint32 JointCount = 80;
+
+    /**
+     * @brief Two seconds of motion on every joint, translation on a few
+     */
+    void MakeClip(std::mt19937& Random, KAnimationClip& OutClip)
+    {
+        std::uniform_real_distribution<float> Unit(-1.0f, 1.0f);
+        FRawAnimationClip Raw;
+        Raw.FrameCount = 61;
+        Raw.JointCount = JointCount;
+        Raw.Frames.resize(size_t(Raw.FrameCount) * JointCount);
+        for (uint32 Joint = 0; Joint < JointCount; ++Joint)
+        {
+            const float Axis[3] = { Unit(Random), Unit(Random), Unit(Random) };
+            const float Speed = 3.0f + Unit(Random);
+            for (uint32 Frame = 0; Frame < Raw.FrameCount; ++Frame)
+            {
+                const float Time = static_cast<float>(Frame) / Raw.SampleRate;
+                FJointTransform& Transform = Raw.Frames[size_t(Frame) * JointCount + Joint];
+                TestScene::MakeQuaternion(Axis, std::sin(Speed * Time), Transform.Rotation);
+                Transform.Translation[1] = Joint % 8 == 0 ? 0.1f + 0.02f * std::sin(Time) : 0.1f;
+            }
+        }
+        OutClip.Compress(Raw);
+    }
+}
+
+/**
+ * @brief Animation evaluation per character: sample two clips, blend, build model matrices and palettes
+ */
+int main(int ArgCount, char** Args)
+{
+    const bool bQuick = KBenchmark::IsQuick(ArgCount, Args);
+    const uint32 CharacterCount = bQuick ? 64 : 1000;
+    const uint32 Repeats = bQuick ? 1 : 10;
+
+    std::mt19937 Random(20);
+    KSkeleton Skeleton;
+    TestScene::MakeSkeleton(JointCount, Random, Skeleton);
+    KAnimationClip Walk, Wave;
+    MakeClip(Random, Walk);
+    MakeClip(Random, Wave);
+    std::printf("Animation: %u characters, %u joints, %zu bytes per clip (%u animated tracks)\n",
+                CharacterCount, JointCount, Walk.GetCompressedSize(), Walk.GetAnimatedTrackCount());
+
+    std::vector<FAnimationLayer> Layers(CharacterCount * 2);
+    std::vector<FAnimationInstance> Instances(CharacterCount);
+    std::vector<FSkinMatrix> Palettes(size_t(CharacterCount) * JointCount);
+    for (uint32 i = 0; i < CharacterCount; ++i)
+    {
+        Layers[i * 2] = { &Walk, 0.013f * i, 0.7f, true };
+        Layers[i * 2 + 1] = { &Wave, 0.029f * i, 0.3f, true };
+        Instances[i].Skeleton = &Skeleton;
+        Instances[i].Layers = &Layers[i * 2];
+        Instances[i].LayerCount = 2;
+        Instances[i].Palette = &Palettes[size_t(i) * JointCount];
+    }
+
+    // Single-clip stages on their own
+    KAnimationPose Pose;
+    const uint64 SampleTime = KBenchmark::Measure(Repeats, [&]()
+    {
+        for (uint32 i = 0; i < CharacterCount; ++i)
+        {
+            Walk.Sample(Layers[i * 2].Time, true, Pose);
+        }
+    });
+    KBenchmark::Report("Sample", SampleTime, CharacterCount, "character");
+
+    std::vector<float> ModelMatrices(JointCount * 16);
+    const uint64 MatrixTime = KBenchmark::Measure(Repeats, [&]()
+    {
+        for (uint32 i = 0; i < CharacterCount; ++i)
+        {
+            Animation::ComputeModelMatrices(Skeleton, Pose, ModelMatrices.data());
+            Animation::ComputeSkinningPalette(Skeleton, ModelMatrices.data(), &Palettes[size_t(i) * JointCount]);
+        }
+    });
+    KBenchmark::Report("Model matrices + palette", MatrixTime, CharacterCount, "character");
+
+    KAnimationEvaluator Evaluator;
+    const uint64 SerialTime = KBenchmark::Measure(Repeats, [&]()
+    {
+        Evaluator.Evaluate(Instances.data(), CharacterCount);
+    });
+    KBenchmark::Report("Evaluate, 2 layers (calling thread)", SerialTime, CharacterCount, "character");
+    KBenchmark::ReportRate("  throughput", SerialTime, CharacterCount * 1.0e-3, "characters/ms");
+
+    KJobSystem JobSystem;
+    JobSystem.Initialize();
+    const uint64 ParallelTime = KBenchmark::Measure(Repeats, [&]()
+    {
+        Evaluator.Evaluate(Instances.data(), CharacterCount, &JobSystem);
+    });
+    JobSystem.Shutdown();
+    KBenchmark::Report("Evaluate, 2 layers (job system)", ParallelTime, CharacterCount, "character");
+    KBenchmark::ReportRate("  throughput", ParallelTime, CharacterCount * 1.0e-3, "characters/ms");
+    return 0;
+}
@@ -0,0 +1,84 @@
+﻿#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include "Utils/Types.h"
+
+/**
+ * @brief Helpers shared by the headless benchmarks
+ *
+ * Every benchmark is a standalone executable printing one line per case.
+ * "--quick" shrinks the workload so CTest can run it as a smoke test.
+ */
+namespace KBenchmark
+{
+    inline uint64 Now()
+    {
+        return static_cast<uint64>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    inline bool IsQuick(int ArgCount, char** Args)
+    {
+        for (int i = 1; i < ArgCount; ++i)
+        {
+            if (std::strcmp(Args[i], "--quick") == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Best wall time of Repeats runs of Function, in nanoseconds
+     */
+    template<typename TFunction>
+    uint64 Measure(uint32 Repeats, TFunction&& Function)
+    {
+        uint64 Best = ~uint64(0);
+        for (uint32 i = 0; i < Repeats; ++i)
+        {
+            const uint64 Start = Now();
+            Function();
+            const uint64 Elapsed = Now() - Start;
+            Best = Elapsed < Best ? Elapsed : Best;
+        }
+        return Best;
+    }
+
+    /**
+     * @brief Print a case as total milliseconds and nanoseconds per item
+     */
+    inline void Report(const char* Name, uint64 Nanoseconds, uint64 ItemCount, const char* ItemName)
+    {
+        const double PerItem = ItemCount > 0 ? static_cast<double>(Nanoseconds) / static_cast<double>(ItemCount) : 0.0;
+        std::printf("%-40s %10.3f ms  %10.2f ns/%s  (%llu)\n", Name, static_cast<double>(Nanoseconds) * 1.0e-6,
+                    PerItem, ItemName, static_cast<unsigned long long>(ItemCount));
+    }
+
+    /**
+     * @brief Print a case as a throughput (items per millisecond or megabytes per second)
+     */
+    inline void ReportRate(const char* Name, uint64 Nanoseconds, double Amount, const char* RateName)
+    {
+        const double Seconds = static_cast<double>(Nanoseconds) * 1.0e-9;
+        std::printf("%-40s %10.3f ms  %10.2f %s\n", Name, Seconds * 1.0e3, Seconds > 0.0 ? Amount / Seconds : 0.0, RateName);
+    }
+
+    /**
+     * @brief Keep a value alive so the optimizer cannot drop the work producing it
+     */
+    template<typename T>
+    inline void DoNotOptimize(const T& Value)
+    {
+#if defined(_MSC_VER)
+        static const void* volatile Sink = nullptr;
+        Sink = &Value;
+#else
+        asm volatile("" : : "r"(&Value) : "memory");
+#endif
+    }
+}
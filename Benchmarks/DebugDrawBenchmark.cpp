@@ -0,0 +1,76 @@
+﻿#include "Benchmark.h"
+#include "TestScene.h"
+#include "Graphics/DebugDraw.h"
+
+#include <vector>
+
+/**
+ * @brief Debug draw batching: primitives added, copied into one stream per mode and retired each frame
+ */
+int main(int ArgCount, char** Args)
+{
+    const bool bQuick = KBenchmark::IsQuick(ArgCount, Args);
+    const uint32 BoxCount = bQuick ? 2000 : 100000;
+    const uint32 FrameCount = bQuick ? 2 : 20;
+
+    std::mt19937 Random(19);
+    std::vector<FBoundingBox> Boxes(BoxCount);
+    std::vector<FBoundingSphere> Spheres(BoxCount / 10);
+    for (FBoundingBox& Box : Boxes)
+    {
+        Box = TestScene::RandomBox(Random, 500.0f, 0.5f, 5.0f);
+    }
+    for (FBoundingSphere& Sphere : Spheres)
+    {
+        const FBoundingBox Box = TestScene::RandomBox(Random, 500.0f, 0.5f, 5.0f);
+        std::copy(Box.Center, Box.Center + 3, Sphere.Center);
+        Sphere.Radius = Box.Extents[0];
+    }
+    const float Eye[3] = { 0.0f, 10.0f, -50.0f };
+    const float At[3] = { 0.0f, 0.0f, 0.0f };
+    const FFrustum Frustum = TestScene::MakeFrustum(Eye, At);
+
+    KDebugDraw DebugDraw;
+    std::vector<FCompactVertex> Upload;
+    uint64 LineCount = 0;
+
+    // One frame: culling boxes depth tested, bounding spheres and frusta as overlay, a few timed markers
+    auto RunFrame = [&]()
+    {
+        for (const FBoundingBox& Box : Boxes)
+        {
+            DebugDraw.AddBox(Box, KDebugDraw::MakeColor(0, 255, 0));
+        }
+        for (const FBoundingSphere& Sphere : Spheres)
+        {
+            DebugDraw.AddSphere(Sphere, KDebugDraw::MakeColor(255, 255, 0), 12, 0.0f, EDebugDrawMode::Overlay);
+        }
+        for (uint32 i = 0; i < 16; ++i)
+        {
+            DebugDraw.AddFrustum(Frustum, KDebugDraw::MakeColor(255, 0, 255), 0.0f, EDebugDrawMode::Overlay);
+            DebugDraw.AddLine(Eye, At, KDebugDraw::MakeColor(255, 0, 0), 0.5f);
+        }
+
+        LineCount = DebugDraw.GetStats().FrameLineCount + DebugDraw.GetStats().TimedLineCount;
+        for (uint32 Mode = 0; Mode < DebugDrawModeCount; ++Mode)
+        {
+            const EDebugDrawMode DrawMode = static_cast<EDebugDrawMode>(Mode);
+            Upload.resize(DebugDraw.GetVertexCount(DrawMode));
+            DebugDraw.CopyVertices(DrawMode, Upload.data());
+            KBenchmark::DoNotOptimize(Upload.data());
+        }
+        DebugDraw.EndFrame();
+        DebugDraw.Tick(1.0f / 60.0f);
+    };
+
+    const uint64 ColdStart = KBenchmark::Now();
+    RunFrame();
+    const uint64 ColdTime = KBenchmark::Now() - ColdStart;
+
+    const uint64 WarmTime = KBenchmark::Measure(FrameCount, RunFrame);
+    std::printf("Debug draw: %u boxes, %zu spheres, %llu lines per frame\n", BoxCount, Spheres.size(),
+                static_cast<unsigned long long>(LineCount));
+    KBenchmark::Report("First frame (streams growing)", ColdTime, LineCount, "line");
+    KBenchmark::Report("Steady frame", WarmTime, LineCount, "line");
+    return 0;
+}
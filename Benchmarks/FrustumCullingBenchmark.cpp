@@ -0,0 +1,55 @@
+﻿#include "Benchmark.h"
+#include "TestScene.h"
+#include "Graphics/FrustumCuller.h"
+
+#include <vector>
+
+/**
+ * @brief SIMD batch frustum culling against a scalar per-box loop
+ */
+int main(int ArgCount, char** Args)
+{
+    const bool bQuick = KBenchmark::IsQuick(ArgCount, Args);
+    const uint32 BoxCount = bQuick ? 10000 : 1000000;
+    const uint32 Repeats = bQuick ? 1 : 10;
+
+    std::mt19937 Random(8);
+    KFrustumCuller Culler;
+    Culler.Reserve(BoxCount);
+    std::vector<FBoundingBox> Boxes;
+    Boxes.reserve(BoxCount);
+    for (uint32 i = 0; i < BoxCount; ++i)
+    {
+        Boxes.push_back(TestScene::RandomBox(Random, 2000.0f, 0.5f, 5.0f));
+        Culler.Add(Boxes.back());
+    }
+
+    const float Eye[3] = { 0.0f, 10.0f, -1500.0f };
+    const float At[3] = { 0.0f, 0.0f, 0.0f };
+    const FFrustum Frustum = TestScene::MakeFrustum(Eye, At, 1.0f, 16.0f / 9.0f, 0.1f, 3000.0f);
+
+    std::printf("Frustum culling: %u boxes, SIMD width %u\n", BoxCount, KFrustumCuller::GetSimdWidth());
+
+    std::vector<uint32> Visible;
+    const uint64 SimdTime = KBenchmark::Measure(Repeats, [&]() { Culler.Cull(Frustum, Visible); });
+    KBenchmark::Report("KFrustumCuller::Cull", SimdTime, BoxCount, "object");
+
+    std::vector<uint32> ScalarVisible;
+    ScalarVisible.reserve(BoxCount);
+    const uint64 ScalarTime = KBenchmark::Measure(Repeats, [&]()
+    {
+        ScalarVisible.clear();
+        for (uint32 i = 0; i < BoxCount; ++i)
+        {
+            if (Bounds::Intersects(Frustum, Boxes[i]))
+            {
+                ScalarVisible.push_back(i);
+            }
+        }
+    });
+    KBenchmark::Report("Scalar Bounds::Intersects loop", ScalarTime, BoxCount, "object");
+
+    std::printf("  visible: %zu (scalar %zu), speedup %.2fx\n", Visible.size(), ScalarVisible.size(),
+                SimdTime > 0 ? static_cast<double>(ScalarTime) / static_cast<double>(SimdTime) : 0.0);
+    return 0;
+}
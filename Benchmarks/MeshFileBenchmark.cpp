@@ -0,0 +1,95 @@
+﻿#include "Benchmark.h"
+#include "TestMesh.h"
+#include "Graphics/MeshFile.h"
+#include "Graphics/MeshImporter.h"
+#include "Graphics/ProceduralGeometry.h"
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief Loading many small meshes: mapped mesh files against OBJ text
+ */
+int main(int ArgCount, char** Args)
+{
+    const bool bQuick = KBenchmark::IsQuick(ArgCount, Args);
+    const uint32 MeshCount = bQuick ? 200 : 10000;
+    const uint32 Repeats = bQuick ? 1 : 3;
+
+    std::vector<FStandardVertex> Vertices;
+    std::vector<uint32> Indices;
+    ProceduralGeometry::Generate(FProceduralMeshDesc::Sphere(32, 16), Vertices, Indices);
+
+    FMeshBuildData Build;
+    if (!MeshFile::Build(Vertices.data(), static_cast<uint32>(Vertices.size()), Indices.data(),
+                         static_cast<uint32>(Indices.size()), EVertexLayout::Quantized, true, Build))
+    {
+        std::printf("Mesh build failed\n");
+        return 1;
+    }
+    std::string Obj;
+    TestMesh::AppendObj(Vertices, Indices, Obj);
+
+    const std::string Directory = TestMesh::MakeTempDirectory("KojeomMeshFileBenchmark");
+    std::vector<std::string> MeshPaths(MeshCount);
+    std::vector<std::string> ObjPaths(MeshCount);
+    for (uint32 i = 0; i < MeshCount; ++i)
+    {
+        MeshPaths[i] = Directory + "/Mesh" + std::to_string(i) + ".kmesh";
+        ObjPaths[i] = Directory + "/Mesh" + std::to_string(i) + ".obj";
+        if (!MeshFile::WriteFile(Build.Data, MeshPaths[i]) || !TestMesh::WriteTextFile(ObjPaths[i], Obj))
+        {
+            std::printf("Writing %s failed\n", Directory.c_str());
+            TestMesh::RemoveDirectory(Directory);
+            return 1;
+        }
+    }
+    std::printf("Mesh load: %u meshes, %u vertices each; %zu bytes mapped vs %zu bytes of OBJ\n",
+                MeshCount, static_cast<uint32>(Vertices.size()),
+                static_cast<size_t>(std::filesystem::file_size(MeshPaths[0])), Obj.size());
+
+    // Mapped files: open, validate and touch the bytes an upload reads
+    uint32 Failed = 0;
+    const uint64 MappedTime = KBenchmark::Measure(Repeats, [&]()
+    {
+        for (const std::string& Path : MeshPaths)
+        {
+            KMeshFile File;
+            if (!File.Open(Path))
+            {
+                ++Failed;
+                continue;
+            }
+            const FMeshData& Data = File.GetData();
+            const size_t StreamSize = size_t(Data.VertexCount) * VertexFormat::GetStreamStride(Data.Layout, 0);
+            uint32 Sum = 0;
+            for (size_t Offset = 0; Offset < StreamSize; Offset += 64)
+            {
+                Sum += static_cast<const uint8*>(Data.Streams[0])[Offset];
+            }
+            KBenchmark::DoNotOptimize(Sum);
+        }
+    });
+    KBenchmark::Report("Mapped mesh files", MappedTime, MeshCount, "mesh");
+
+    FMeshImportSettings Settings;
+    FImportedMesh Imported;
+    const uint64 TextTime = KBenchmark::Measure(Repeats, [&]()
+    {
+        for (const std::string& Path : ObjPaths)
+        {
+            Failed += MeshImporter::ImportObj(Path, Imported, Settings) ? 0 : 1;
+            KBenchmark::DoNotOptimize(Imported.Vertices.data());
+        }
+    });
+    KBenchmark::Report("OBJ import", TextTime, MeshCount, "mesh");
+    std::printf("  mapped files load %.1fx faster\n", static_cast<double>(TextTime) / static_cast<double>(MappedTime));
+
+    TestMesh::RemoveDirectory(Directory);
+    if (Failed > 0)
+    {
+        std::printf("%u loads failed\n", Failed);
+        return 1;
+    }
+    return 0;
+}
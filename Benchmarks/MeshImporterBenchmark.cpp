@@ -0,0 +1,65 @@
+﻿#include "Benchmark.h"
+#include "TestMesh.h"
+#include "Graphics/MeshImporter.h"
+#include "Graphics/ProceduralGeometry.h"
+#include "Core/JobSystem.h"
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief OBJ import throughput on a large grid, serial and on the job system
+ */
+int main(int ArgCount, char** Args)
+{
+    const bool bQuick = KBenchmark::IsQuick(ArgCount, Args);
+    const uint32 Cells = bQuick ? 64 : 768;
+    const uint32 Repeats = bQuick ? 1 : 3;
+
+    std::vector<FStandardVertex> Vertices;
+    std::vector<uint32> Indices;
+    ProceduralGeometry::Generate(FProceduralMeshDesc::Plane(Cells, Cells), Vertices, Indices);
+    std::string Obj;
+    TestMesh::AppendObj(Vertices, Indices, Obj);
+
+    const std::string Directory = TestMesh::MakeTempDirectory("KojeomMeshImporterBenchmark");
+    const std::string Path = Directory + "/Grid.obj";
+    if (!TestMesh::WriteTextFile(Path, Obj))
+    {
+        std::printf("Writing %s failed\n", Path.c_str());
+        TestMesh::RemoveDirectory(Directory);
+        return 1;
+    }
+    const double Megabytes = static_cast<double>(Obj.size()) / (1024.0 * 1024.0);
+    std::printf("OBJ import: %.1f MB, %zu vertices, %zu triangles\n", Megabytes, Vertices.size(), Indices.size() / 3);
+    Obj.clear();
+    Obj.shrink_to_fit();
+
+    FImportedMesh Mesh;
+    FMeshImportSettings Settings;
+    bool bImported = true;
+    const uint64 SerialTime = KBenchmark::Measure(Repeats, [&]()
+    {
+        bImported &= MeshImporter::ImportObj(Path, Mesh, Settings);
+    });
+    KBenchmark::ReportRate("ImportObj (calling thread)", SerialTime, Megabytes, "MB/s");
+
+    KJobSystem JobSystem;
+    JobSystem.Initialize();
+    FMeshImportStats Stats;
+    const uint64 ParallelTime = KBenchmark::Measure(Repeats, [&]()
+    {
+        bImported &= MeshImporter::ImportObj(Path, Mesh, Settings, &JobSystem, &Stats);
+    });
+    KBenchmark::ReportRate("ImportObj (job system)", ParallelTime, Megabytes, "MB/s");
+    JobSystem.Shutdown();
+    std::printf("  %u chunks, %u corners -> %zu vertices\n", Stats.ChunkCount, Stats.SourceVertexCount, Mesh.Vertices.size());
+
+    TestMesh::RemoveDirectory(Directory);
+    if (!bImported)
+    {
+        std::printf("Import failed: %s\n", Stats.Error.c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,73 @@
+﻿#include "Benchmark.h"
+#include "Graphics/MeshOptimizer.h"
+#include "Graphics/ProceduralGeometry.h"
+
+#include <random>
+#include <vector>
+
+/**
+ * @brief Mesh optimization passes on a shuffled grid
+ */
+int main(int ArgCount, char** Args)
+{
+    const bool bQuick = KBenchmark::IsQuick(ArgCount, Args);
+    const uint32 Cells = bQuick ? 64 : 512;
+    const uint32 Repeats = bQuick ? 1 : 3;
+
+    std::vector<FStandardVertex> SourceVertices;
+    std::vector<uint32> SourceIndices;
+    ProceduralGeometry::Generate(FProceduralMeshDesc::Plane(Cells, Cells), SourceVertices, SourceIndices);
+
+    // Scramble triangle order, as exporters without cache optimization tend to
+    std::mt19937 Random(4);
+    const size_t TriangleCount = SourceIndices.size() / 3;
+    for (size_t i = TriangleCount - 1; i > 0; --i)
+    {
+        const size_t j = Random() % (i + 1);
+        for (int Corner = 0; Corner < 3; ++Corner)
+        {
+            std::swap(SourceIndices[i * 3 + Corner], SourceIndices[j * 3 + Corner]);
+        }
+    }
+
+    const uint32 VertexCount = static_cast<uint32>(SourceVertices.size());
+    const uint32 IndexCount = static_cast<uint32>(SourceIndices.size());
+    std::printf("Mesh optimizer: %zu triangles, %u vertices\n", TriangleCount, VertexCount);
+
+    std::vector<uint32> Indices(IndexCount);
+    const uint64 CacheTime = KBenchmark::Measure(Repeats, [&]()
+    {
+        MeshOptimizer::OptimizeVertexCache(Indices.data(), SourceIndices.data(), IndexCount, VertexCount);
+    });
+    KBenchmark::Report("OptimizeVertexCache", CacheTime, TriangleCount, "triangle");
+
+    std::vector<uint32> OverdrawIndices(IndexCount);
+    const uint64 OverdrawTime = KBenchmark::Measure(Repeats, [&]()
+    {
+        MeshOptimizer::OptimizeOverdraw(OverdrawIndices.data(), Indices.data(), IndexCount,
+                                        SourceVertices[0].Position, VertexCount, sizeof(FStandardVertex));
+    });
+    KBenchmark::Report("OptimizeOverdraw", OverdrawTime, TriangleCount, "triangle");
+
+    std::vector<FStandardVertex> Vertices;
+    std::vector<uint32> FetchIndices;
+    const uint64 FetchTime = KBenchmark::Measure(Repeats, [&]()
+    {
+        Vertices = SourceVertices;
+        FetchIndices = OverdrawIndices;
+        MeshOptimizer::OptimizeVertexFetch(Vertices.data(), VertexCount, sizeof(FStandardVertex),
+                                           FetchIndices.data(), IndexCount);
+    });
+    KBenchmark::Report("OptimizeVertexFetch (with copies)", FetchTime, TriangleCount, "triangle");
+
+    const uint64 AnalyzeTime = KBenchmark::Measure(Repeats, [&]()
+    {
+        KBenchmark::DoNotOptimize(MeshOptimizer::AnalyzeVertexCache(FetchIndices.data(), IndexCount, VertexCount));
+    });
+    KBenchmark::Report("AnalyzeVertexCache", AnalyzeTime, TriangleCount, "triangle");
+
+    const FVertexCacheStats Before = MeshOptimizer::AnalyzeVertexCache(SourceIndices.data(), IndexCount, VertexCount);
+    const FVertexCacheStats After = MeshOptimizer::AnalyzeVertexCache(FetchIndices.data(), IndexCount, VertexCount);
+    std::printf("  ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", Before.ACMR, After.ACMR, Before.ATVR, After.ATVR);
+    return 0;
+}
@@ -0,0 +1,68 @@
+﻿#include "Benchmark.h"
+#include "Graphics/MeshSimplifier.h"
+#include "Graphics/ProceduralGeometry.h"
+#include "Core/JobSystem.h"
+
+#include <vector>
+
+/**
+ * @brief Quadric simplification and LOD chain generation on a dense sphere
+ */
+int main(int ArgCount, char** Args)
+{
+    const bool bQuick = KBenchmark::IsQuick(ArgCount, Args);
+    const uint32 Slices = bQuick ? 128 : 1024;
+    const uint32 Repeats = bQuick ? 1 : 2;
+
+    std::vector<FStandardVertex> Vertices;
+    std::vector<uint32> Indices;
+    ProceduralGeometry::Generate(FProceduralMeshDesc::Sphere(Slices, Slices / 2), Vertices, Indices);
+    const uint32 VertexCount = static_cast<uint32>(Vertices.size());
+    const uint32 IndexCount = static_cast<uint32>(Indices.size());
+    const size_t TriangleCount = IndexCount / 3;
+    std::printf("Mesh simplifier: %zu triangles, %u vertices\n", TriangleCount, VertexCount);
+
+    std::vector<uint32> Simplified(IndexCount);
+    for (const uint32 Divisor : { 2u, 8u, 64u })
+    {
+        uint32 Count = 0;
+        float Error = 0.0f;
+        const uint64 Time = KBenchmark::Measure(Repeats, [&]()
+        {
+            Count = MeshSimplifier::Simplify(Simplified.data(), Indices.data(), IndexCount, Vertices[0].Position,
+                                             VertexCount, sizeof(FStandardVertex), IndexCount / Divisor / 3 * 3,
+                                             0.0f, false, &Error);
+        });
+        char Name[64];
+        std::snprintf(Name, sizeof(Name), "Simplify to 1/%u", Divisor);
+        KBenchmark::Report(Name, Time, TriangleCount, "source triangle");
+        std::printf("  %u triangles, error %.5f\n", Count / 3, Error);
+    }
+
+    FMeshLODSettings Settings;
+    Settings.bOptimizeVertexCache = false;
+    std::vector<uint32> LODIndices;
+    std::vector<FMeshLOD> LODs;
+    const uint64 SerialTime = KBenchmark::Measure(Repeats, [&]()
+    {
+        MeshSimplifier::GenerateLODs(Indices.data(), IndexCount, Vertices[0].Position, VertexCount,
+                                     sizeof(FStandardVertex), Settings, LODIndices, LODs);
+    });
+    KBenchmark::Report("GenerateLODs (calling thread)", SerialTime, TriangleCount, "source triangle");
+
+    KJobSystem JobSystem;
+    JobSystem.Initialize();
+    const uint64 ParallelTime = KBenchmark::Measure(Repeats, [&]()
+    {
+        MeshSimplifier::GenerateLODs(Indices.data(), IndexCount, Vertices[0].Position, VertexCount,
+                                     sizeof(FStandardVertex), Settings, LODIndices, LODs, &JobSystem);
+    });
+    KBenchmark::Report("GenerateLODs (job system)", ParallelTime, TriangleCount, "source triangle");
+    JobSystem.Shutdown();
+
+    for (const FMeshLOD& LOD : LODs)
+    {
+        std::printf("  LOD: %u triangles, error %.5f, screen size %g\n", LOD.IndexCount / 3, LOD.Error, LOD.ScreenSize);
+    }
+    return 0;
+}
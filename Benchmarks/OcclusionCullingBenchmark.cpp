@@ -0,0 +1,129 @@
+﻿#include "Benchmark.h"
+#include "TestScene.h"
+#include "Graphics/OcclusionCuller.h"
+#include "Graphics/FrustumCuller.h"
+#include "Core/JobSystem.h"
+
+#include <algorithm>
+#include <vector>
+
+/**
+ * @brief City scene: frustum culling, occluder rasterization and occlusion tests per view
+ */
+int main(int ArgCount, char** Args)
+{
+    const bool bQuick = KBenchmark::IsQuick(ArgCount, Args);
+    const uint32 BlockCount = bQuick ? 10 : 40;
+    const uint32 ObjectCount = bQuick ? 10000 : 1000000;
+    const uint32 ViewCount = bQuick ? 4 : 16;
+
+    std::mt19937 Random(25);
+    std::vector<FBoundingBox> Buildings;
+    TestScene::MakeCity(Random, BlockCount, Buildings);
+
+    // One cube scaled onto each building
+    const FOccluderMesh Cube = TestScene::MakeUnitCube();
+    std::vector<float> WorldMatrices(16 * Buildings.size());
+    for (size_t Building = 0; Building < Buildings.size(); ++Building)
+    {
+        TestScene::MakeBoxMatrix(Buildings[Building], &WorldMatrices[16 * Building]);
+    }
+
+    // Small objects on the ground: street furniture, vehicles, props in the courtyards
+    const float CityExtent = 80.0f * BlockCount;
+    std::uniform_real_distribution<float> Position(0.0f, CityExtent);
+    std::uniform_real_distribution<float> Size(0.5f, 2.5f);
+    KFrustumCuller Boxes;
+    Boxes.Reserve(ObjectCount);
+    for (uint32 i = 0; i < ObjectCount; ++i)
+    {
+        const float Extent = Size(Random);
+        FBoundingBox Box;
+        Box.Center[0] = Position(Random);
+        Box.Center[1] = Extent;
+        Box.Center[2] = Position(Random);
+        Box.Extents[0] = Box.Extents[1] = Box.Extents[2] = Extent;
+        Boxes.Add(Box);
+    }
+
+    KJobSystem JobSystem;
+    JobSystem.Initialize();
+    KOcclusionCuller Culler(FOcclusionCullerSettings{});
+    std::printf("Occlusion culling: %u objects, %zu building occluders, %ux%u depth buffer, %u threads\n",
+                ObjectCount, Buildings.size(), Culler.GetWidth(), Culler.GetHeight(), JobSystem.GetThreadCount());
+
+    uint64 FrustumTime = 0;
+    uint64 SetupTime = 0;
+    uint64 SerialRasterizeTime = 0;
+    uint64 RasterizeTime = 0;
+    uint64 TestTime = 0;
+    uint64 InFrustum = 0;
+    uint64 Occluded = 0;
+    uint64 TriangleCount = 0;
+    uint64 OccluderCount = 0;
+    std::vector<uint32> Indices;
+    for (uint32 View = 0; View < ViewCount; ++View)
+    {
+        // Street-level cameras down the streets, and a quarter of them above the roofs
+        const bool bElevated = View % 4 == 3;
+        const float Street = 70.0f + 80.0f * static_cast<float>((View * 5) % BlockCount);
+        const float Along = 10.0f + 0.8f * CityExtent * static_cast<float>(View) / ViewCount;
+        const float Turn = View % 3 == 0 ? 30.0f : (View % 3 == 1 ? -20.0f : 5.0f);
+        float Eye[3] = { Street, bElevated ? 60.0f : 1.8f, Along };
+        float At[3] = { Street + Turn, bElevated ? 20.0f : 1.8f, Along + 100.0f };
+        if (View % 2 == 1)
+        {
+            std::swap(Eye[0], Eye[2]);
+            std::swap(At[0], At[2]);
+        }
+        float ViewProjection[16];
+        TestScene::MakeViewProjection(Eye, At, 1.0f, 2.0f, 0.5f, 3000.0f, ViewProjection);
+        FFrustum Frustum;
+        Bounds::ExtractFrustumPlanes(ViewProjection, Frustum);
+
+        uint64 Start = KBenchmark::Now();
+        Boxes.Cull(Frustum, Indices);
+        FrustumTime += KBenchmark::Now() - Start;
+        const size_t FrustumVisible = Indices.size();
+
+        // Serial first, for the threading speedup; the job system's frame is the one tested
+        for (uint32 Pass = 0; Pass < 2; ++Pass)
+        {
+            Start = KBenchmark::Now();
+            Culler.BeginFrame(ViewProjection);
+            for (size_t Building = 0; Building < Buildings.size(); ++Building)
+            {
+                Culler.AddOccluder(Cube, &WorldMatrices[16 * Building]);
+            }
+            SetupTime += Pass == 1 ? KBenchmark::Now() - Start : 0;
+
+            Start = KBenchmark::Now();
+            Culler.Rasterize(Pass == 1 ? &JobSystem : nullptr);
+            (Pass == 1 ? RasterizeTime : SerialRasterizeTime) += KBenchmark::Now() - Start;
+        }
+
+        Start = KBenchmark::Now();
+        Culler.Cull(Boxes, Indices, &JobSystem);
+        TestTime += KBenchmark::Now() - Start;
+
+        InFrustum += FrustumVisible;
+        Occluded += FrustumVisible - Indices.size();
+        TriangleCount += Culler.GetStats().TriangleCount;
+        OccluderCount += Culler.GetStats().OccluderCount;
+    }
+
+    KBenchmark::Report("Frustum cull (per view)", FrustumTime / ViewCount, ObjectCount, "object");
+    KBenchmark::Report("Add occluders (per view)", SetupTime / ViewCount, Buildings.size(), "occluder");
+    KBenchmark::Report("Rasterize, serial (per view)", SerialRasterizeTime / ViewCount, TriangleCount / ViewCount, "triangle");
+    KBenchmark::Report("Rasterize, job system (per view)", RasterizeTime / ViewCount, TriangleCount / ViewCount, "triangle");
+    KBenchmark::Report("Occlusion test (per view)", TestTime / ViewCount, InFrustum / ViewCount, "box");
+    std::printf("  %llu occluders in view, %llu in frustum, %.1f%% of them occluded\n",
+                static_cast<unsigned long long>(OccluderCount / ViewCount),
+                static_cast<unsigned long long>(InFrustum / ViewCount),
+                InFrustum > 0 ? 100.0 * static_cast<double>(Occluded) / static_cast<double>(InFrustum) : 0.0);
+    std::printf("  occlusion stage %.3f ms per view\n",
+                static_cast<double>(SetupTime + RasterizeTime + TestTime) * 1.0e-6 / ViewCount);
+
+    JobSystem.Shutdown();
+    return 0;
+}
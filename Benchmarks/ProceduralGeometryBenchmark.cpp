@@ -0,0 +1,142 @@
+﻿#include "Benchmark.h"
+#include "Graphics/ProceduralGeometry.h"
+#include "Core/JobSystem.h"
+
+#include <cmath>
+#include <vector>
+
+namespace
+{
+    /**
+     * @brief The sphere loop KMesh::CreateSphere used: trig per vertex, push_back without reserve
+     */
+    void GenerateReferenceSphere(uint32 Slices, uint32 Stacks, std::vector<FStandardVertex>& OutVertices,
+                                 std::vector<uint32>& OutIndices)
+    {
+        const float Pi = 3.14159265f;
+        OutVertices.clear();
+        OutIndices.clear();
+        for (uint32 i = 0; i <= Stacks; ++i)
+        {
+            const float StackAngle = Pi * i / Stacks - Pi / 2.0f;
+            const float XY = cosf(StackAngle);
+            const float Z = sinf(StackAngle);
+            for (uint32 j = 0; j <= Slices; ++j)
+            {
+                const float SectorAngle = 2 * Pi * j / Slices;
+                FStandardVertex Vertex;
+                Vertex.Position[0] = XY * cosf(SectorAngle);
+                Vertex.Position[1] = Z;
+                Vertex.Position[2] = XY * sinf(SectorAngle);
+                for (int Axis = 0; Axis < 3; ++Axis)
+                {
+                    Vertex.Normal[Axis] = Vertex.Position[Axis];
+                    Vertex.Color[Axis] = (Vertex.Position[Axis] + 1.0f) * 0.5f;
+                }
+                Vertex.Color[3] = 1.0f;
+                Vertex.TexCoord[0] = static_cast<float>(j) / Slices;
+                Vertex.TexCoord[1] = static_cast<float>(i) / Stacks;
+                OutVertices.push_back(Vertex);
+            }
+        }
+        for (uint32 i = 0; i < Stacks; ++i)
+        {
+            uint32 K1 = i * (Slices + 1);
+            uint32 K2 = K1 + Slices + 1;
+            for (uint32 j = 0; j < Slices; ++j, ++K1, ++K2)
+            {
+                if (i != 0)
+                {
+                    OutIndices.push_back(K1);
+                    OutIndices.push_back(K2);
+                    OutIndices.push_back(K1 + 1);
+                }
+                if (i != Stacks - 1)
+                {
+                    OutIndices.push_back(K1 + 1);
+                    OutIndices.push_back(K2);
+                    OutIndices.push_back(K2 + 1);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Procedural shape generation per vertex, small and large, serial and on the job system
+ */
+int main(int ArgCount, char** Args)
+{
+    const bool bQuick = KBenchmark::IsQuick(ArgCount, Args);
+    const uint32 Scale = bQuick ? 1 : 8;
+    const uint32 Repeats = bQuick ? 1 : 5;
+
+    KJobSystem JobSystem;
+    JobSystem.Initialize();
+
+    std::vector<float> Heights((256 * Scale + 1) * (256 * Scale + 1));
+    for (size_t i = 0; i < Heights.size(); ++i)
+    {
+        Heights[i] = static_cast<float>(i % 97) * 0.01f;
+    }
+
+    const struct
+    {
+        const char* Name;
+        FProceduralMeshDesc Desc;
+    } Shapes[] = {
+        { "Sphere 32x16", FProceduralMeshDesc::Sphere(32, 16) },
+        { "Sphere (large)", FProceduralMeshDesc::Sphere(128 * Scale, 64 * Scale) },
+        { "Torus (large)", FProceduralMeshDesc::Torus(128 * Scale, 64 * Scale) },
+        { "Cylinder (large)", FProceduralMeshDesc::Cylinder(128 * Scale, 64 * Scale) },
+        { "Capsule (large)", FProceduralMeshDesc::Capsule(128 * Scale, 32 * Scale) },
+        { "Plane (large)", FProceduralMeshDesc::Plane(256 * Scale, 256 * Scale) },
+        { "Heightfield (large)", FProceduralMeshDesc::Heightfield(Heights.data(), 256 * Scale, 256 * Scale) },
+    };
+
+    std::vector<FStandardVertex> Vertices;
+    std::vector<uint32> Indices;
+    for (const auto& Shape : Shapes)
+    {
+        uint32 VertexCount = 0;
+        uint32 IndexCount = 0;
+        ProceduralGeometry::GetCounts(Shape.Desc, VertexCount, IndexCount);
+        Vertices.resize(VertexCount);
+        Indices.resize(IndexCount);
+
+        const uint64 SerialTime = KBenchmark::Measure(Repeats, [&]()
+        {
+            ProceduralGeometry::Generate(Shape.Desc, Vertices.data(), Indices.data());
+        });
+        KBenchmark::Report(Shape.Name, SerialTime, VertexCount, "vertex");
+
+        const uint64 ParallelTime = KBenchmark::Measure(Repeats, [&]()
+        {
+            ProceduralGeometry::Generate(Shape.Desc, Vertices.data(), Indices.data(), &JobSystem);
+        });
+        KBenchmark::Report("  on the job system", ParallelTime, VertexCount, "vertex");
+    }
+    JobSystem.Shutdown();
+
+    // Baseline: the per-vertex trig loop the module replaced, into fresh vectors as before
+    const uint32 Slices = 128 * Scale;
+    const uint32 Stacks = 64 * Scale;
+    const uint64 ReferenceTime = KBenchmark::Measure(Repeats, [&]()
+    {
+        std::vector<FStandardVertex> ReferenceVertices;
+        std::vector<uint32> ReferenceIndices;
+        GenerateReferenceSphere(Slices, Stacks, ReferenceVertices, ReferenceIndices);
+        KBenchmark::DoNotOptimize(ReferenceVertices.data());
+    });
+    KBenchmark::Report("Sphere (large), per-vertex trig", ReferenceTime, (Slices + 1) * (Stacks + 1), "vertex");
+
+    const uint64 FreshTime = KBenchmark::Measure(Repeats, [&]()
+    {
+        std::vector<FStandardVertex> FreshVertices;
+        std::vector<uint32> FreshIndices;
+        ProceduralGeometry::Generate(FProceduralMeshDesc::Sphere(Slices, Stacks), FreshVertices, FreshIndices);
+        KBenchmark::DoNotOptimize(FreshVertices.data());
+    });
+    KBenchmark::Report("Sphere (large), into fresh vectors", FreshTime, (Slices + 1) * (Stacks + 1), "vertex");
+    return 0;
+}
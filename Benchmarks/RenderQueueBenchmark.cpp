@@ -0,0 +1,74 @@
+﻿#include "Benchmark.h"
+#include "Graphics/RenderQueue.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+/**
+ * @brief Draw key radix sort against std::sort
+ */
+int main(int ArgCount, char** Args)
+{
+    const bool bQuick = KBenchmark::IsQuick(ArgCount, Args);
+    const uint32 Repeats = bQuick ? 1 : 5;
+    const uint32 Counts[] = { 1000, 10000, 100000, 1000000 };
+
+    std::mt19937 Random(1);
+    for (uint32 Count : Counts)
+    {
+        if (bQuick && Count > 10000)
+        {
+            break;
+        }
+
+        std::vector<uint64> Keys(Count);
+        for (uint64& Key : Keys)
+        {
+            Key = DrawKey::Make(static_cast<ERenderPass>(Random() % 3), Random() % 64, Random() % 512,
+                                DrawKey::MakeMeshId(Random() % 2048, Random() % 4), Random());
+        }
+
+        KRenderQueue Queue;
+        Queue.Reserve(Count);
+        const uint64 RadixTime = KBenchmark::Measure(Repeats, [&]()
+        {
+            Queue.Reset();
+            for (uint32 i = 0; i < Count; ++i)
+            {
+                Queue.Push(Keys[i], i);
+            }
+            Queue.Sort();
+        });
+
+        std::vector<FRenderQueueItem> Items(Count);
+        const uint64 StdTime = KBenchmark::Measure(Repeats, [&]()
+        {
+            for (uint32 i = 0; i < Count; ++i)
+            {
+                Items[i] = { Keys[i], i };
+            }
+            std::sort(Items.begin(), Items.end(),
+                      [](const FRenderQueueItem& A, const FRenderQueueItem& B) { return A.Key < B.Key; });
+        });
+
+        size_t BatchCount = 0;
+        const uint64 BatchTime = KBenchmark::Measure(Repeats, [&]()
+        {
+            BatchCount = 0;
+            for (size_t First = 0; First < Queue.GetCount(); First = Queue.FindBatchEnd(First))
+            {
+                ++BatchCount;
+            }
+        });
+
+        char Name[64];
+        std::snprintf(Name, sizeof(Name), "Radix sort %u", Count);
+        KBenchmark::Report(Name, RadixTime, Count, "key");
+        std::snprintf(Name, sizeof(Name), "std::sort %u", Count);
+        KBenchmark::Report(Name, StdTime, Count, "key");
+        std::snprintf(Name, sizeof(Name), "Batch scan %u (%zu batches)", Count, BatchCount);
+        KBenchmark::Report(Name, BatchTime, Count, "key");
+    }
+    return 0;
+}
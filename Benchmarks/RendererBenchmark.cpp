@@ -0,0 +1,123 @@
+﻿#include "Benchmark.h"
+#include "Graphics/Renderer.h"
+#include "RHI/NullRHI.h"
+
+#include <random>
+#include <vector>
+
+/**
+ * @brief Headless throughput of a whole KRenderer frame
+ *
+ * The renderer runs on the null device: BeginFrame, one RenderMesh call per
+ * object and EndFrame, immediate and with deferred (sorted, instanced)
+ * submission. Covers culling, LOD selection, constant ring uploads, instance
+ * buffer maps and state caching that DrawStreamBenchmark leaves out.
+ */
+
+namespace
+{
+    struct FObject
+    {
+        std::shared_ptr<KMesh> Mesh;
+        XMMATRIX WorldMatrix;
+    };
+}
+
+int main(int ArgCount, char** Args)
+{
+    const bool bQuick = KBenchmark::IsQuick(ArgCount, Args);
+    const uint32 ObjectCount = bQuick ? 2000 : 50000;
+    const uint32 FrameCount = bQuick ? 2 : 10;
+    const uint32 Repeats = bQuick ? 1 : 3;
+
+    // Renderer resources are released before the device
+    KNullRHIDevice Device;
+    bool bMatches = true;
+    {
+        KRenderer Renderer;
+        if (FAILED(Renderer.Initialize(&Device, 1280, 720)))
+        {
+            std::printf("Renderer initialization on the null device failed\n");
+            return 1;
+        }
+
+        FMeshLODSettings LODSettings;
+        const std::shared_ptr<KMesh> Meshes[] = {
+            Renderer.CreateCubeMesh(),
+            Renderer.CreateCubeMesh(EVertexLayout::Compact),
+            Renderer.CreateSphereMesh(32, 32, EVertexLayout::Standard, &LODSettings),
+            Renderer.CreateProceduralMesh(FProceduralMeshDesc::Torus(48, 24, 1.0f, 0.3f), EVertexLayout::Quantized),
+        };
+        const uint32 MeshCount = static_cast<uint32>(sizeof(Meshes) / sizeof(Meshes[0]));
+        for (const std::shared_ptr<KMesh>& Mesh : Meshes)
+        {
+            if (!Mesh)
+            {
+                std::printf("Mesh creation on the null device failed\n");
+                return 1;
+            }
+        }
+
+        // Objects spread in front of the camera; a fraction falls outside the frustum
+        std::mt19937 Random(42);
+        std::uniform_real_distribution<float> Lateral(-120.0f, 120.0f);
+        std::uniform_real_distribution<float> Depth(5.0f, 400.0f);
+        std::vector<FObject> Objects(ObjectCount);
+        for (FObject& Object : Objects)
+        {
+            Object.Mesh = Meshes[Random() % MeshCount];
+            Object.WorldMatrix = XMMatrixTranslation(Lateral(Random), Lateral(Random) * 0.5f, Depth(Random));
+        }
+
+        KCamera Camera;
+        Camera.SetPerspective(XM_PIDIV4, 1280.0f / 720.0f, 0.1f, 1000.0f);
+        Camera.SetPosition(0.0f, 0.0f, 0.0f);
+
+        std::printf("Renderer benchmark: %u objects, %u meshes, %u frames\n", ObjectCount, MeshCount, FrameCount);
+
+        KNullCommandContext& Context = Device.GetNullContext();
+        auto RunFrames = [&]()
+        {
+            for (uint32 Frame = 0; Frame < FrameCount; ++Frame)
+            {
+                Context.Reset();
+                Renderer.BeginFrame(&Camera);
+                for (const FObject& Object : Objects)
+                {
+                    Renderer.RenderMesh(Object.Mesh, Object.WorldMatrix);
+                }
+                Renderer.EndFrame();
+            }
+        };
+
+        const uint64 DrawCount = static_cast<uint64>(ObjectCount) * FrameCount;
+        for (bool bDeferred : { false, true })
+        {
+            Renderer.SetDeferredSubmission(bDeferred);
+            const uint64 Time = KBenchmark::Measure(Repeats, RunFrames);
+            KBenchmark::Report(bDeferred ? "Frame, deferred submission" : "Frame, immediate submission", Time, DrawCount,
+                               "object");
+
+            const FCullingStats& Culling = Renderer.GetCullingStats();
+            const FRenderStateStats& States = Renderer.GetStateStats();
+            const uint64 Visible = Culling.Tested - Culling.Culled;
+            std::printf("  visible: %llu of %llu, draws: %llu, commands: %llu, state calls issued: %llu (skipped %llu)\n",
+                        static_cast<unsigned long long>(Visible), static_cast<unsigned long long>(Culling.Tested),
+                        static_cast<unsigned long long>(Context.GetDrawCallCount()),
+                        static_cast<unsigned long long>(Context.GetTotalCommandCount()),
+                        static_cast<unsigned long long>(States.CallsIssued),
+                        static_cast<unsigned long long>(States.CallsSkipped));
+
+            // The last frame reached the null context (deferred frames merge visible objects into fewer draws)
+            bMatches = bMatches && Visible > 0 && Context.GetDrawCallCount() > 0 &&
+                       Context.GetDrawCallCount() <= Visible;
+        }
+
+        Renderer.Cleanup();
+    }
+
+    const bool bNoLeaks = Device.GetLiveResourceCount() == 0;
+    std::printf("  live resources after cleanup: %llu (%s)\n",
+                static_cast<unsigned long long>(Device.GetLiveResourceCount()), bNoLeaks ? "ok" : "LEAK");
+    return bMatches && bNoLeaks ? 0 : 1;
+}
@@ -0,0 +1,149 @@
+﻿#include "Benchmark.h"
+#include "TestScene.h"
+#include "Graphics/SceneBVH.h"
+#include "Core/JobSystem.h"
+
+#include <cmath>
+#include <vector>
+
+/**
+ * @brief Scene BVH over a large dynamic scene: build, per-frame refit of moving objects, and queries
+ */
+int main(int ArgCount, char** Args)
+{
+    const bool bQuick = KBenchmark::IsQuick(ArgCount, Args);
+    const uint32 ObjectCount = bQuick ? 10000 : 1000000;
+    const uint32 FrameCount = bQuick ? 2 : 20;
+    const uint32 RayCount = bQuick ? 1000 : 100000;
+    const uint32 Repeats = bQuick ? 1 : 5;
+    const float WorldExtent = bQuick ? 200.0f : 2000.0f;
+
+    KJobSystem JobSystem;
+    JobSystem.Initialize();
+
+    std::mt19937 Random(23);
+    std::vector<FBoundingBox> Boxes;
+    Boxes.reserve(ObjectCount);
+    for (uint32 i = 0; i < ObjectCount; ++i)
+    {
+        Boxes.push_back(TestScene::RandomBox(Random, WorldExtent, 0.5f, 5.0f));
+    }
+
+    std::printf("Scene BVH: %u objects\n", ObjectCount);
+
+    KSceneBVH BVH;
+    std::vector<uint32> Ids(ObjectCount);
+    const uint64 BuildTime = KBenchmark::Measure(Repeats, [&]()
+    {
+        BVH.Clear();
+        for (uint32 i = 0; i < ObjectCount; ++i)
+        {
+            Ids[i] = BVH.Insert(Boxes[i], i);
+        }
+        BVH.Rebuild(&JobSystem);
+    });
+    KBenchmark::Report("Insert + build", BuildTime, ObjectCount, "object");
+
+    // A tenth of the scene moves a small step every frame; only Update is timed
+    std::uniform_real_distribution<float> Step(-0.5f, 0.5f);
+    const uint32 MovedCount = ObjectCount / 10;
+    const uint32 BuildCount = BVH.GetStats().RebuildCount;
+    uint64 RefitTime = 0;
+    for (uint32 Frame = 0; Frame < FrameCount; ++Frame)
+    {
+        for (uint32 i = 0; i < MovedCount; ++i)
+        {
+            const uint32 Object = (Frame * MovedCount + i * 7) % ObjectCount;
+            for (uint32 Axis = 0; Axis < 3; ++Axis)
+            {
+                Boxes[Object].Center[Axis] += Step(Random);
+            }
+            BVH.Move(Ids[Object], Boxes[Object]);
+        }
+
+        const uint64 Start = KBenchmark::Now();
+        BVH.Update(&JobSystem);
+        RefitTime += KBenchmark::Now() - Start;
+    }
+    KBenchmark::Report("Update, 10% moved (per frame)", RefitTime / FrameCount, MovedCount, "moved");
+
+    const FSceneBVHStats Stats = BVH.GetStats();
+    std::printf("  %u leaves, depth %u, cost %.1f (%.2fx build), %u rebuilds over %u frames\n", Stats.LeafCount,
+                Stats.Depth, Stats.Cost, Stats.BuildCost > 0.0f ? Stats.Cost / Stats.BuildCost : 0.0f,
+                Stats.RebuildCount - BuildCount, FrameCount);
+
+    // Cameras at the edge of the world looking across it
+    std::vector<FFrustum> Frustums;
+    for (uint32 View = 0; View < 8; ++View)
+    {
+        const float Angle = 0.785f * static_cast<float>(View);
+        const float Eye[3] = { 0.75f * WorldExtent * std::sin(Angle), 10.0f, -0.75f * WorldExtent * std::cos(Angle) };
+        const float At[3] = { 0.0f, 0.0f, 0.0f };
+        Frustums.push_back(TestScene::MakeFrustum(Eye, At, 1.0f, 16.0f / 9.0f, 0.1f, 0.5f * WorldExtent));
+    }
+
+    std::vector<uint32> Visible;
+    size_t VisibleSum = 0;
+    const uint64 FrustumTime = KBenchmark::Measure(Repeats, [&]()
+    {
+        VisibleSum = 0;
+        for (const FFrustum& Frustum : Frustums)
+        {
+            Visible.clear();
+            VisibleSum += BVH.QueryFrustum(Frustum, Visible);
+        }
+    });
+    KBenchmark::Report("Frustum query (per view)", FrustumTime / Frustums.size(), VisibleSum / Frustums.size(), "visible");
+
+    std::vector<FSpatialNeighbor> Neighbors;
+    std::uniform_real_distribution<float> Position(-WorldExtent, WorldExtent);
+    std::vector<float> Points(3 * 1000);
+    for (float& Coordinate : Points)
+    {
+        Coordinate = Position(Random);
+    }
+    const uint64 NearestTime = KBenchmark::Measure(Repeats, [&]()
+    {
+        for (uint32 Query = 0; Query < 1000; ++Query)
+        {
+            Neighbors.clear();
+            BVH.QueryNearest(&Points[3 * Query], 8, 3.402823466e+38f, Neighbors);
+        }
+        KBenchmark::DoNotOptimize(Neighbors);
+    });
+    KBenchmark::Report("Nearest 8", NearestTime, 1000, "query");
+
+    // Rays from around the world's center in random directions, as for picking and line of sight
+    std::uniform_real_distribution<float> Unit(-1.0f, 1.0f);
+    std::vector<FSceneRay> Rays(RayCount);
+    for (FSceneRay& Ray : Rays)
+    {
+        for (uint32 Axis = 0; Axis < 3; ++Axis)
+        {
+            Ray.Origin[Axis] = 0.1f * Position(Random);
+            Ray.Direction[Axis] = Unit(Random);
+        }
+    }
+    std::vector<FSceneRayHit> Hits(RayCount);
+    const uint64 SerialRayTime = KBenchmark::Measure(Repeats, [&]()
+    {
+        BVH.RaycastBatch(Rays.data(), RayCount, Hits.data());
+    });
+    KBenchmark::Report("Raycast batch", SerialRayTime, RayCount, "ray");
+
+    const uint64 ParallelRayTime = KBenchmark::Measure(Repeats, [&]()
+    {
+        BVH.RaycastBatch(Rays.data(), RayCount, Hits.data(), &JobSystem);
+    });
+    KBenchmark::Report("Raycast batch, job system", ParallelRayTime, RayCount, "ray");
+
+    uint32 HitCount = 0;
+    for (const FSceneRayHit& Hit : Hits)
+    {
+        HitCount += Hit.UserData != FSceneRayHit::NoHit ? 1 : 0;
+    }
+    std::printf("  %.1f%% of rays hit\n", 100.0 * HitCount / RayCount);
+
+    JobSystem.Shutdown();
+    return 0;
+}
@@ -0,0 +1,200 @@
+﻿#include "Benchmark.h"
+#include "TestScene.h"
+#include "Graphics/SceneBVH.h"
+#include "Graphics/LooseOctree.h"
+#include "Graphics/SpatialHashGrid.h"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+namespace
+{
+    /**
+     * @brief Open world: objects spread over a square of terrain, a few meters to tens of meters high
+     */
+    FBoundingBox RandomWorldBox(std::mt19937& Random, float WorldExtent)
+    {
+        std::uniform_real_distribution<float> Position(-WorldExtent, WorldExtent);
+        std::uniform_real_distribution<float> Height(0.0f, 40.0f);
+        std::uniform_real_distribution<float> Size(0.5f, 4.0f);
+
+        FBoundingBox Box;
+        Box.Center[0] = Position(Random);
+        Box.Center[1] = Height(Random);
+        Box.Center[2] = Position(Random);
+        for (int Axis = 0; Axis < 3; ++Axis)
+        {
+            Box.Extents[Axis] = Size(Random);
+        }
+        return Box;
+    }
+
+    /**
+     * @brief Time inserts, per-frame moves of a tenth of the objects and each query kind on one index
+     */
+    void Run(const char* IndexName, ISpatialIndex& Index, const std::vector<FBoundingBox>& InitialBoxes,
+             float WorldExtent, uint32 FrameCount, uint32 Repeats)
+    {
+        const uint32 ObjectCount = static_cast<uint32>(InitialBoxes.size());
+        std::vector<FBoundingBox> Boxes = InitialBoxes;
+        std::vector<uint32> Ids(ObjectCount);
+        char Name[64];
+
+        const uint64 InsertStart = KBenchmark::Now();
+        for (uint32 i = 0; i < ObjectCount; ++i)
+        {
+            Ids[i] = Index.Insert(Boxes[i], i);
+        }
+        Index.Update(nullptr);
+        std::snprintf(Name, sizeof(Name), "%s insert", IndexName);
+        KBenchmark::Report(Name, KBenchmark::Now() - InsertStart, ObjectCount, "object");
+
+        // Vehicles and characters: a tenth of the scene moves up to a meter per frame
+        std::mt19937 Random(24);
+        std::uniform_real_distribution<float> Step(-1.0f, 1.0f);
+        const uint32 MovedCount = ObjectCount / 10;
+        const uint64 MoveStart = KBenchmark::Now();
+        for (uint32 Frame = 0; Frame < FrameCount; ++Frame)
+        {
+            for (uint32 i = 0; i < MovedCount; ++i)
+            {
+                const uint32 Object = (Frame * MovedCount + i * 7) % ObjectCount;
+                Boxes[Object].Center[0] += Step(Random);
+                Boxes[Object].Center[2] += Step(Random);
+                Index.Move(Ids[Object], Boxes[Object]);
+            }
+            Index.Update(nullptr);
+        }
+        std::snprintf(Name, sizeof(Name), "%s move + update (per frame)", IndexName);
+        KBenchmark::Report(Name, (KBenchmark::Now() - MoveStart) / FrameCount, MovedCount, "moved");
+
+        // Ground-level cameras seeing a few hundred meters, wherever the player is
+        std::uniform_real_distribution<float> Position(-WorldExtent, WorldExtent);
+        std::vector<FFrustum> Frustums;
+        std::vector<FBoundingSphere> Spheres;
+        std::vector<FBoundingBox> Regions;
+        for (uint32 Query = 0; Query < 16; ++Query)
+        {
+            const float Eye[3] = { Position(Random), 2.0f, Position(Random) };
+            const float At[3] = { Eye[0] + Step(Random), 2.0f, Eye[2] + Step(Random) };
+            Frustums.push_back(TestScene::MakeFrustum(Eye, At, 1.0f, 16.0f / 9.0f, 0.1f, 500.0f));
+
+            FBoundingSphere Sphere;
+            Sphere.Center[0] = Eye[0];
+            Sphere.Center[1] = 0.0f;
+            Sphere.Center[2] = Eye[2];
+            Sphere.Radius = 50.0f;
+            Spheres.push_back(Sphere);
+
+            FBoundingBox Region;
+            Region.Center[0] = Eye[0];
+            Region.Center[1] = 20.0f;
+            Region.Center[2] = Eye[2];
+            Region.Extents[0] = Region.Extents[1] = Region.Extents[2] = 50.0f;
+            Regions.push_back(Region);
+        }
+
+        std::vector<uint32> Found;
+        size_t FoundSum = 0;
+        const uint64 FrustumTime = KBenchmark::Measure(Repeats, [&]()
+        {
+            FoundSum = 0;
+            for (const FFrustum& Frustum : Frustums)
+            {
+                Found.clear();
+                FoundSum += Index.QueryFrustum(Frustum, Found);
+            }
+        });
+        std::snprintf(Name, sizeof(Name), "%s frustum (per view)", IndexName);
+        KBenchmark::Report(Name, FrustumTime / Frustums.size(), FoundSum / Frustums.size(), "visible");
+
+        const uint64 SphereTime = KBenchmark::Measure(Repeats, [&]()
+        {
+            FoundSum = 0;
+            for (const FBoundingSphere& Sphere : Spheres)
+            {
+                Found.clear();
+                FoundSum += Index.QuerySphere(Sphere, Found);
+            }
+        });
+        std::snprintf(Name, sizeof(Name), "%s sphere r50 (per query)", IndexName);
+        KBenchmark::Report(Name, SphereTime / Spheres.size(), FoundSum / Spheres.size(), "found");
+
+        const uint64 BoxTime = KBenchmark::Measure(Repeats, [&]()
+        {
+            FoundSum = 0;
+            for (const FBoundingBox& Region : Regions)
+            {
+                Found.clear();
+                FoundSum += Index.QueryBox(Region, Found);
+            }
+        });
+        std::snprintf(Name, sizeof(Name), "%s box 100m (per query)", IndexName);
+        KBenchmark::Report(Name, BoxTime / Regions.size(), FoundSum / Regions.size(), "found");
+
+        std::vector<FSpatialNeighbor> Neighbors;
+        const uint64 NearestTime = KBenchmark::Measure(Repeats, [&]()
+        {
+            for (const FBoundingSphere& Sphere : Spheres)
+            {
+                Neighbors.clear();
+                Index.QueryNearest(Sphere.Center, 8, 200.0f, Neighbors);
+            }
+            KBenchmark::DoNotOptimize(Neighbors);
+        });
+        std::snprintf(Name, sizeof(Name), "%s nearest 8 (per query)", IndexName);
+        KBenchmark::Report(Name, NearestTime / Spheres.size(), Spheres.size(), "query");
+    }
+}
+
+/**
+ * @brief Loose octree and spatial hash grid over sparse open worlds of 100k to 10M objects, with the scene BVH for reference
+ */
+int main(int ArgCount, char** Args)
+{
+    const bool bQuick = KBenchmark::IsQuick(ArgCount, Args);
+    const std::vector<uint32> ObjectCounts = bQuick ? std::vector<uint32>{ 10000 } :
+                                                      std::vector<uint32>{ 100000, 1000000, 10000000 };
+    const uint32 FrameCount = bQuick ? 2 : 10;
+    const uint32 Repeats = bQuick ? 1 : 5;
+
+    for (const uint32 ObjectCount : ObjectCounts)
+    {
+        // Constant density of one object per 64 square meters
+        const float WorldExtent = 4.0f * std::sqrt(static_cast<float>(ObjectCount));
+        std::mt19937 Random(ObjectCount);
+        std::vector<FBoundingBox> Boxes;
+        Boxes.reserve(ObjectCount);
+        for (uint32 i = 0; i < ObjectCount; ++i)
+        {
+            Boxes.push_back(RandomWorldBox(Random, WorldExtent));
+        }
+
+        std::printf("Spatial indexes: %u objects over %.0f m x %.0f m\n", ObjectCount, 2.0f * WorldExtent, 2.0f * WorldExtent);
+
+        // Leaf cells of about 64 m
+        FLooseOctreeSettings OctreeSettings;
+        OctreeSettings.HalfSize = WorldExtent + 64.0f;
+        OctreeSettings.MaxDepth = static_cast<uint32>(std::ceil(std::log2(OctreeSettings.HalfSize / 32.0f)));
+        {
+            KLooseOctree Octree(OctreeSettings);
+            Run("Octree", Octree, Boxes, WorldExtent, FrameCount, Repeats);
+            std::printf("  %u nodes, depth %u\n", Octree.GetNodeCount(), OctreeSettings.MaxDepth);
+        }
+
+        FSpatialHashGridSettings GridSettings;
+        GridSettings.CellSize = 32.0f;
+        {
+            KSpatialHashGrid Grid(GridSettings);
+            Run("Grid", Grid, Boxes, WorldExtent, FrameCount, Repeats);
+            std::printf("  %u cells of %.0f m\n", Grid.GetCellCount(), GridSettings.CellSize);
+        }
+
+        {
+            KSceneBVH BVH;
+            Run("BVH", BVH, Boxes, WorldExtent, FrameCount, Repeats);
+        }
+    }
+    return 0;
+}
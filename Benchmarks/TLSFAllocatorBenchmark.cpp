@@ -0,0 +1,72 @@
+﻿#include "Benchmark.h"
+#include "Graphics/TLSFAllocator.h"
+
+#include <random>
+#include <vector>
+
+/**
+ * @brief Allocation churn and defragmentation of the TLSF suballocator
+ */
+int main(int ArgCount, char** Args)
+{
+    const bool bQuick = KBenchmark::IsQuick(ArgCount, Args);
+    const uint32 OperationCount = bQuick ? 100000 : 10000000;
+    const uint32 Repeats = bQuick ? 1 : 3;
+
+    // Mesh-sized requests in vertices: mostly small, some large
+    std::mt19937 Random(14);
+    std::vector<uint32> Sizes(OperationCount);
+    std::vector<uint32> Choices(OperationCount);
+    for (uint32 i = 0; i < OperationCount; ++i)
+    {
+        Sizes[i] = Random() % 8 == 0 ? 1 + Random() % 65536 : 1 + Random() % 4096;
+        Choices[i] = Random();
+    }
+
+    KTLSFAllocator Allocator;
+    std::vector<uint32> Live;
+    uint32 Failed = 0;
+    const uint64 ChurnTime = KBenchmark::Measure(Repeats, [&]()
+    {
+        Allocator.Initialize(64u << 20);
+        Live.clear();
+        Failed = 0;
+        for (uint32 i = 0; i < OperationCount; ++i)
+        {
+            // Keep roughly 10k live ranges
+            if (Live.size() < 10000 || Choices[i] % 2 == 0)
+            {
+                const uint32 Handle = Allocator.Allocate(Sizes[i]);
+                if (Handle != KTLSFAllocator::InvalidHandle)
+                {
+                    Live.push_back(Handle);
+                }
+                else
+                {
+                    ++Failed;
+                }
+            }
+            else
+            {
+                const size_t Index = Choices[i] % Live.size();
+                Allocator.Free(Live[Index]);
+                Live[Index] = Live.back();
+                Live.pop_back();
+            }
+        }
+    });
+    KBenchmark::Report("Allocate/Free churn", ChurnTime, OperationCount, "op");
+    std::printf("  live %u, used %.1f%%, free blocks %u, fragmentation %.3f, failed %u\n",
+                Allocator.GetAllocationCount(),
+                100.0 * Allocator.GetUsedSize() / Allocator.GetCapacity(),
+                Allocator.GetFreeBlockCount(), Allocator.GetFragmentation(), Failed);
+
+    std::vector<KTLSFAllocator::FRelocation> Relocations;
+    const uint64 DefragmentTime = KBenchmark::Measure(1, [&]()
+    {
+        Allocator.Defragment(Relocations);
+    });
+    KBenchmark::Report("Defragment", DefragmentTime, Allocator.GetAllocationCount(), "allocation");
+    std::printf("  %zu relocations, fragmentation %.3f\n", Relocations.size(), Allocator.GetFragmentation());
+    return 0;
+}
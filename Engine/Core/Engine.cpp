@@ -1,5 +1,7 @@
 ﻿#include "Engine.h"
 
+#include <timeapi.h>
+
 // Global instance definition
 KEngine* KEngine::Instance = nullptr;
 
@@ -14,6 +16,8 @@ KEngine::KEngine()
     , WindowHeight(EngineConstants::DEFAULT_WINDOW_HEIGHT)
     , bIsRunning(false)
     , bIsInitialized(false)
+    , bVSync(true)
+    , bTimerResolutionRaised(false)
     , DeltaTime(0.0f)
     , TotalTime(0.0f)
     , FrameCount(0)
@@ -23,10 +27,6 @@ KEngine::KEngine()
     // Set global instance
     Instance = this;
 
-    // Initialize high-performance timer
-    QueryPerformanceFrequency(&Frequency);
-    QueryPerformanceCounter(&LastTime);
-
     LOG_INFO("Engine constructor called");
 }
 
@@ -54,6 +54,14 @@ HRESULT KEngine::Initialize(HINSTANCE InInstanceHandle, const std::wstring& InWi
         return hr;
     }
 
+    // 1 ms scheduler granularity so the frame pacer's sleeps stay short
+    bTimerResolutionRaised = timeBeginPeriod(1) == TIMERR_NOERROR;
+
+    // Start worker threads (used e.g. by KRenderer::SetParallelRecording)
+    JobSystem = std::make_unique<KJobSystem>();
+    JobSystem->Initialize();
+    LOG_INFO("Job system started, workers: " + std::to_string(JobSystem->GetWorkerCount()));
+
     // Initialize graphics system
     hr = InitializeGraphics();
     if (FAILED(hr))
@@ -88,22 +96,46 @@ int32 KEngine::Run()
     LOG_INFO("Engine main loop starting");
     bIsRunning = true;
 
+    // Initialization time does not count as the first frame
+    FramePacer.Reset();
+    KProfiler::SetThreadName("Main");
+
     // Main game loop
     while (bIsRunning)
     {
+        KE_PROFILE_SCOPE("Frame");
+
         // Process window messages
-        ProcessMessages();
+        {
+            KE_PROFILE_SCOPE("ProcessMessages");
+            ProcessMessages();
+        }
 
         if (bIsRunning)
         {
             // Update timer
-            UpdateTimer();
+            {
+                KE_PROFILE_SCOPE("WaitForNextFrame");
+                UpdateTimer();
+            }
+
+            // Expire timed debug primitives before this frame adds new ones
+            if (Renderer)
+            {
+                Renderer->GetDebugDraw().Tick(DeltaTime);
+            }
 
             // Update game logic
-            Update(DeltaTime);
+            {
+                KE_PROFILE_SCOPE("Update");
+                Update(DeltaTime);
+            }
 
             // Render
-            Render();
+            {
+                KE_PROFILE_SCOPE("Render");
+                Render();
+            }
 
             // Calculate frame statistics
             CalculateFrameStats();
@@ -132,6 +164,12 @@ void KEngine::Shutdown()
         Camera.reset();
     }
 
+    if (JobSystem)
+    {
+        JobSystem->Shutdown();
+        JobSystem.reset();
+    }
+
     if (GraphicsDevice)
     {
         GraphicsDevice->Cleanup();
@@ -150,6 +188,12 @@ void KEngine::Shutdown()
         UnregisterClass(L"KojeomEngineWindow", InstanceHandle);
     }
 
+    if (bTimerResolutionRaised)
+    {
+        timeEndPeriod(1);
+        bTimerResolutionRaised = false;
+    }
+
     bIsInitialized = false;
     LOG_INFO("Engine shutdown completed");
 }
@@ -180,7 +224,28 @@ void KEngine::Render()
     // Override in derived classes to implement actual rendering
 
     // End frame
-    Renderer->EndFrame(true); // Use V-Sync
+    Renderer->EndFrame(bVSync);
+}
+
+void KEngine::ToggleProfilerCapture(const std::string& TracePath)
+{
+    if (!KProfiler::IsEnabled())
+    {
+        KProfiler::Clear();
+        KProfiler::SetEnabled(true);
+        LOG_INFO("Profiler capture started");
+        return;
+    }
+
+    KProfiler::SetEnabled(false);
+    if (KProfiler::WriteChromeTrace(TracePath))
+    {
+        LOG_INFO("Profiler capture saved: " + TracePath);
+    }
+    else
+    {
+        LOG_ERROR("Failed to write profiler capture: " + TracePath);
+    }
 }
 
 void KEngine::OnResize(UINT32 NewWidth, UINT32 NewHeight)
@@ -306,26 +371,16 @@ void KEngine::ProcessMessages()
 
 void KEngine::UpdateTimer()
 {
-    LARGE_INTEGER currentTime;
-    QueryPerformanceCounter(&currentTime);
-
-    // Calculate delta time (in seconds)
-    DeltaTime = static_cast<float>(currentTime.QuadPart - LastTime.QuadPart) / 
-                  static_cast<float>(Frequency.QuadPart);
-
-    // Limit delta time (maximum 1/30 second)
-    if (DeltaTime > 1.0f / 30.0f)
-    {
-        DeltaTime = 1.0f / 30.0f;
-    }
-
-    LastTime = currentTime;
+    // Wait out the frame rate limit, then take the frame time.
+    // Game logic gets the smoothed delta so single-frame spikes do not jitter it.
+    FramePacer.WaitForNextFrame();
+    DeltaTime = FramePacer.GetSmoothedDeltaTime();
 }
 
 void KEngine::CalculateFrameStats()
 {
     FrameCount++;
-    FrameTime += DeltaTime;
+    FrameTime += FramePacer.GetDeltaTime();
 
     // Calculate FPS every second
     if (FrameTime >= 1.0f)
@@ -349,19 +404,41 @@ LRESULT CALLBACK WindowProc(HWND WindowHandle, UINT Message, WPARAM WParam, LPAR
     switch (Message)
     {
     case WM_SIZE:
-        if (engine && WParam != SIZE_MINIMIZED)
+        if (engine && WParam == SIZE_MINIMIZED)
+        {
+            engine->FramePacer.SetBackground(true);
+        }
+        else if (engine)
         {
+            // Restoring from minimized ends the background throttle
+            if (WParam == SIZE_RESTORED || WParam == SIZE_MAXIMIZED)
+            {
+                engine->FramePacer.SetBackground(false);
+            }
+
             UINT width = LOWORD(LParam);
             UINT height = HIWORD(LParam);
             engine->OnResize(width, height);
         }
         break;
 
+    case WM_ACTIVATEAPP:
+        // Throttle while another application has focus
+        if (engine)
+        {
+            engine->FramePacer.SetBackground(WParam == FALSE);
+        }
+        break;
+
     case WM_KEYDOWN:
         if (WParam == VK_ESCAPE)
         {
             PostQuitMessage(0);
         }
+        else if (WParam == VK_F11 && engine && !(LParam & (1 << 30))) // Ignore key repeat
+        {
+            engine->ToggleProfilerCapture();
+        }
         break;
 
     case WM_DESTROY:
@@ -9,6 +9,9 @@
 #include "../Graphics/GraphicsDevice.h"
 #include "../Graphics/Camera.h"
 #include "../Graphics/Renderer.h"
+#include "JobSystem.h"
+#include "FramePacer.h"
+#include "Profiler.h"
 
 /**
  * @brief Main engine class
@@ -68,10 +71,30 @@ public:
      */
     void OnResize(UINT32 NewWidth, UINT32 NewHeight);
 
+    /**
+     * @brief Limit the main loop frame rate
+     * @param InTargetFPS Frames per second, 0 for unlimited
+     */
+    void SetFrameRateLimit(float InTargetFPS) { FramePacer.SetTargetFPS(InTargetFPS); }
+
+    /**
+     * @brief Present with V-Sync (the default) or immediately
+     */
+    void SetVSync(bool bInVSync) { bVSync = bInVSync; }
+    bool IsVSync() const { return bVSync; }
+
+    /**
+     * @brief Start a CPU profiler capture, or stop the running one and save it (F11)
+     * @param TracePath Chrome trace file written when the capture stops
+     */
+    void ToggleProfilerCapture(const std::string& TracePath = "KojeomEngine_Trace.json");
+
     // Accessors
     KGraphicsDevice* GetGraphicsDevice() const { return GraphicsDevice.get(); }
     KCamera* GetCamera() const { return Camera.get(); }
     KRenderer* GetRenderer() const { return Renderer.get(); }
+    KJobSystem* GetJobSystem() const { return JobSystem.get(); }
+    KFramePacer& GetFramePacer() { return FramePacer; }
     HWND GetWindowHandle() const { return WindowHandle; }
     
     UINT32 GetWindowWidth() const { return WindowWidth; }
@@ -183,14 +206,16 @@ private:
     std::unique_ptr<KGraphicsDevice> GraphicsDevice;
     std::unique_ptr<KCamera> Camera;
     std::unique_ptr<KRenderer> Renderer;
+    std::unique_ptr<KJobSystem> JobSystem;
 
     // Engine state
     bool bIsRunning;
     bool bIsInitialized;
 
     // Timing
-    LARGE_INTEGER Frequency;
-    LARGE_INTEGER LastTime;
+    KFramePacer FramePacer;
+    bool bVSync;
+    bool bTimerResolutionRaised;
     float DeltaTime;
     float TotalTime;
 
@@ -0,0 +1,146 @@
+﻿#include "FramePacer.h"
+
+#include <chrono>
+#include <thread>
+
+// KSystemFrameClock class implementation
+
+uint64 KSystemFrameClock::Now()
+{
+    return static_cast<uint64>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void KSystemFrameClock::SleepUntil(uint64 Deadline, uint64 SpinThreshold)
+{
+    uint64 Current = Now();
+    if (Current + SpinThreshold < Deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(Deadline - SpinThreshold - Current));
+        Current = Now();
+    }
+
+    // Spin out the remainder, which OS sleeps cannot hit precisely
+    while (Current < Deadline)
+    {
+        std::this_thread::yield();
+        Current = Now();
+    }
+}
+
+// KFramePacer class implementation
+
+KFramePacer::KFramePacer(IFrameClock* InClock)
+    : Clock(InClock ? InClock : &SystemClock)
+{
+}
+
+void KFramePacer::SetSettings(const FFramePacerSettings& InSettings)
+{
+    Settings = InSettings;
+
+    // Averages over a different window start over
+    SampleCount = 0;
+    SampleCursor = 0;
+    SampleSum = 0.0f;
+}
+
+void KFramePacer::Reset()
+{
+    bStarted = false;
+    DeltaTime = 0.0f;
+    SmoothedDeltaTime = 0.0f;
+    WaitTime = 0.0f;
+    SampleCount = 0;
+    SampleCursor = 0;
+    SampleSum = 0.0f;
+}
+
+uint64 KFramePacer::GetFramePeriod() const
+{
+    float FPS = Settings.TargetFPS;
+    if (bBackground && Settings.BackgroundFPS > 0.0f && (FPS <= 0.0f || Settings.BackgroundFPS < FPS))
+    {
+        FPS = Settings.BackgroundFPS;
+    }
+    return FPS > 0.0f ? static_cast<uint64>(1.0e9 / FPS) : 0;
+}
+
+void KFramePacer::WaitForNextFrame()
+{
+    if (!bStarted)
+    {
+        LastFrameStart = Clock->Now();
+        NextDeadline = LastFrameStart;
+        bStarted = true;
+    }
+
+    const uint64 Period = GetFramePeriod();
+    const uint64 WaitStart = Clock->Now();
+
+    if (Period > 0)
+    {
+        NextDeadline += Period;
+
+        // A slightly late frame is caught up by the next one; more than a
+        // period behind (or a shortened period) restarts the schedule from now
+        if (NextDeadline + Period < WaitStart)
+        {
+            NextDeadline = WaitStart;
+        }
+        else if (NextDeadline > WaitStart + Period)
+        {
+            NextDeadline = WaitStart + Period;
+        }
+
+        WaitUntil(NextDeadline);
+    }
+
+    const uint64 FrameStart = Clock->Now();
+    if (Period == 0)
+    {
+        NextDeadline = FrameStart;
+    }
+
+    WaitTime = static_cast<float>(FrameStart - WaitStart) * 1.0e-9f;
+
+    DeltaTime = static_cast<float>(FrameStart - LastFrameStart) * 1.0e-9f;
+    if (DeltaTime > Settings.MaxDeltaTime)
+    {
+        DeltaTime = Settings.MaxDeltaTime;
+    }
+    LastFrameStart = FrameStart;
+
+    AddSmoothingSample(DeltaTime);
+    ++FrameCount;
+}
+
+void KFramePacer::WaitUntil(uint64 Deadline)
+{
+    const uint64 SpinThreshold = static_cast<uint64>(Settings.SpinThresholdMs * 1.0e6f);
+    if (Clock->Now() < Deadline)
+    {
+        Clock->SleepUntil(Deadline, SpinThreshold);
+    }
+}
+
+void KFramePacer::AddSmoothingSample(float Sample)
+{
+    uint32 Window = Settings.SmoothingFrames;
+    Window = Window < 1 ? 1 : (Window > MaxSmoothingFrames ? MaxSmoothingFrames : Window);
+
+    if (SampleCount == Window)
+    {
+        SampleSum -= Samples[SampleCursor];
+    }
+    else
+    {
+        ++SampleCount;
+    }
+
+    Samples[SampleCursor] = Sample;
+    SampleSum += Sample;
+    SampleCursor = (SampleCursor + 1) % Window;
+
+    SmoothedDeltaTime = SampleSum / static_cast<float>(SampleCount);
+}
@@ -0,0 +1,129 @@
+﻿#pragma once
+
+#include "../Utils/Types.h"
+
+/**
+ * @brief Time source used by KFramePacer
+ *
+ * Times are in nanoseconds from an arbitrary origin. Replace with a fake
+ * clock to test pacing deterministically.
+ */
+class IFrameClock
+{
+public:
+    virtual ~IFrameClock() = default;
+
+    virtual uint64 Now() = 0;
+
+    /**
+     * @brief Block the calling thread until Now() reaches Deadline
+     * @param Deadline Wake-up time
+     * @param SpinThreshold Length of the final stretch that should be spun
+     *        instead of slept (for clocks backed by coarse OS sleeps)
+     */
+    virtual void SleepUntil(uint64 Deadline, uint64 SpinThreshold) = 0;
+};
+
+/**
+ * @brief Steady clock of the standard library
+ *
+ * Sleeps until shortly before the deadline and yields for the rest.
+ */
+class KSystemFrameClock : public IFrameClock
+{
+public:
+    uint64 Now() override;
+    void SleepUntil(uint64 Deadline, uint64 SpinThreshold) override;
+};
+
+/**
+ * @brief Frame pacing settings
+ */
+struct FFramePacerSettings
+{
+    float TargetFPS = 0.0f;             // Frame rate limit, 0 for unlimited
+    float BackgroundFPS = 10.0f;        // Limit while in background (0 disables the throttle)
+    float SpinThresholdMs = 2.0f;       // The last part of each wait is spun instead of slept
+    float MaxDeltaTime = 0.25f;         // Longer frames (breakpoints, window drags) are clamped
+    uint32 SmoothingFrames = 8;         // Frames averaged by GetSmoothedDeltaTime (1 disables)
+};
+
+/**
+ * @brief Frame-rate limiter and frame timer
+ *
+ * WaitForNextFrame sleeps until shortly before the frame's deadline and spins
+ * for the rest, which keeps sub-millisecond accuracy despite coarse OS sleeps.
+ * Deadlines advance by a fixed period so small wake-up errors do not
+ * accumulate; after a long frame the schedule restarts from the current time.
+ * Platform independent.
+ */
+class KFramePacer
+{
+public:
+    static constexpr uint32 MaxSmoothingFrames = 32;
+
+    /**
+     * @param InClock Time source, nullptr for the system clock (not owned)
+     */
+    explicit KFramePacer(IFrameClock* InClock = nullptr);
+
+    // Prevent copying
+    KFramePacer(const KFramePacer&) = delete;
+    KFramePacer& operator=(const KFramePacer&) = delete;
+
+    void SetSettings(const FFramePacerSettings& InSettings);
+    const FFramePacerSettings& GetSettings() const { return Settings; }
+
+    void SetTargetFPS(float InTargetFPS) { Settings.TargetFPS = InTargetFPS; }
+
+    /**
+     * @brief Switch to the background limit (unfocused or minimized window)
+     */
+    void SetBackground(bool bInBackground) { bBackground = bInBackground; }
+    bool IsBackground() const { return bBackground; }
+
+    /**
+     * @brief Restart timing from now (the next frame has no delta)
+     */
+    void Reset();
+
+    /**
+     * @brief Wait for the current frame period to end and start the next frame
+     */
+    void WaitForNextFrame();
+
+    // Timing of the frame that just started
+    float GetDeltaTime() const { return DeltaTime; }
+    float GetSmoothedDeltaTime() const { return SmoothedDeltaTime; }
+    float GetWaitTime() const { return WaitTime; }
+    uint64 GetFrameCount() const { return FrameCount; }
+
+    /**
+     * @brief Active frame period in nanoseconds, 0 when unlimited
+     */
+    uint64 GetFramePeriod() const;
+
+private:
+    void WaitUntil(uint64 Deadline);
+    void AddSmoothingSample(float Sample);
+
+private:
+    KSystemFrameClock SystemClock;
+    IFrameClock* Clock = nullptr;
+    FFramePacerSettings Settings;
+    bool bBackground = false;
+
+    uint64 LastFrameStart = 0;
+    uint64 NextDeadline = 0;
+    bool bStarted = false;
+
+    float DeltaTime = 0.0f;
+    float SmoothedDeltaTime = 0.0f;
+    float WaitTime = 0.0f;
+    uint64 FrameCount = 0;
+
+    float Samples[MaxSmoothingFrames] = {};
+    uint32 SampleCount = 0;
+    uint32 SampleCursor = 0;
+    float SampleSum = 0.0f;
+};
@@ -0,0 +1,125 @@
+﻿#include "JobSystem.h"
+#include "Profiler.h"
+
+KJobSystem::~KJobSystem()
+{
+    Shutdown();
+}
+
+void KJobSystem::Initialize(uint32 WorkerCount)
+{
+    Shutdown();
+
+    if (WorkerCount == 0)
+    {
+        const uint32 HardwareThreads = std::thread::hardware_concurrency();
+        WorkerCount = HardwareThreads > 1 ? HardwareThreads - 1 : 0;
+    }
+
+    // Generation survives a previous Initialize; new workers must not take the last batch for a new one
+    uint64 StartGeneration = 0;
+    {
+        std::lock_guard<std::mutex> Lock(Mutex);
+        bStopping = false;
+        StartGeneration = Generation;
+    }
+
+    Workers.reserve(WorkerCount);
+    for (uint32 i = 0; i < WorkerCount; ++i)
+    {
+        Workers.emplace_back(&KJobSystem::WorkerLoop, this, i + 1, StartGeneration);
+    }
+}
+
+void KJobSystem::Shutdown()
+{
+    {
+        std::lock_guard<std::mutex> Lock(Mutex);
+        bStopping = true;
+    }
+    WorkCondition.notify_all();
+
+    for (std::thread& Worker : Workers)
+    {
+        Worker.join();
+    }
+    Workers.clear();
+}
+
+void KJobSystem::ParallelFor(uint32 Count, const FTaskFunction& Task)
+{
+    if (Count == 0)
+    {
+        return;
+    }
+
+    // Not worth waking anyone up
+    if (Workers.empty() || Count == 1)
+    {
+        for (uint32 i = 0; i < Count; ++i)
+        {
+            Task(i, 0);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> Lock(Mutex);
+        CurrentTask = &Task;
+        TaskCount = Count;
+        NextIndex.store(0, std::memory_order_relaxed);
+        BusyWorkers = static_cast<uint32>(Workers.size());
+        ++Generation;
+    }
+    WorkCondition.notify_all();
+
+    RunTasks(0);
+
+    // Every worker checks in once per generation, so none can miss the next one
+    std::unique_lock<std::mutex> Lock(Mutex);
+    DoneCondition.wait(Lock, [this]() { return BusyWorkers == 0; });
+    CurrentTask = nullptr;
+}
+
+void KJobSystem::WorkerLoop(uint32 WorkerIndex, uint64 SeenGeneration)
+{
+    KProfiler::SetThreadName(("Worker " + std::to_string(WorkerIndex)).c_str());
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> Lock(Mutex);
+            WorkCondition.wait(Lock, [this, SeenGeneration]() { return bStopping || Generation != SeenGeneration; });
+            if (bStopping)
+            {
+                return;
+            }
+            SeenGeneration = Generation;
+        }
+
+        RunTasks(WorkerIndex);
+
+        bool bLastWorker = false;
+        {
+            std::lock_guard<std::mutex> Lock(Mutex);
+            bLastWorker = --BusyWorkers == 0;
+        }
+        if (bLastWorker)
+        {
+            DoneCondition.notify_one();
+        }
+    }
+}
+
+void KJobSystem::RunTasks(uint32 WorkerIndex)
+{
+    while (true)
+    {
+        const uint32 Index = NextIndex.fetch_add(1, std::memory_order_relaxed);
+        if (Index >= TaskCount)
+        {
+            return;
+        }
+        (*CurrentTask)(Index, WorkerIndex);
+    }
+}
@@ -0,0 +1,78 @@
+﻿#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../Utils/Types.h"
+
+/**
+ * @brief Fixed pool of worker threads for data-parallel work
+ *
+ * ParallelFor hands out indices to the workers and the calling thread and
+ * returns once every index has run. Meant to be driven from one thread
+ * (the main thread); nested or concurrent ParallelFor calls are not supported.
+ * Platform independent: only uses the standard library.
+ */
+class KJobSystem
+{
+public:
+    /**
+     * @brief Task callback
+     * @param Index Task index in [0, Count)
+     * @param WorkerIndex 0 for the calling thread, 1..GetWorkerCount() for workers
+     */
+    using FTaskFunction = std::function<void(uint32 Index, uint32 WorkerIndex)>;
+
+    KJobSystem() = default;
+    ~KJobSystem();
+
+    // Prevent copying
+    KJobSystem(const KJobSystem&) = delete;
+    KJobSystem& operator=(const KJobSystem&) = delete;
+
+    /**
+     * @brief Start the worker threads
+     * @param WorkerCount Number of workers, 0 for one per hardware thread minus the caller
+     */
+    void Initialize(uint32 WorkerCount = 0);
+
+    /**
+     * @brief Stop and join the worker threads
+     */
+    void Shutdown();
+
+    /**
+     * @brief Run Task for every index in [0, Count) and wait for completion
+     */
+    void ParallelFor(uint32 Count, const FTaskFunction& Task);
+
+    uint32 GetWorkerCount() const { return static_cast<uint32>(Workers.size()); }
+
+    /**
+     * @brief Number of threads that execute tasks (workers plus the caller)
+     */
+    uint32 GetThreadCount() const { return GetWorkerCount() + 1; }
+
+private:
+    void WorkerLoop(uint32 WorkerIndex, uint64 SeenGeneration);
+    void RunTasks(uint32 WorkerIndex);
+
+private:
+    std::vector<std::thread> Workers;
+
+    std::mutex Mutex;
+    std::condition_variable WorkCondition;
+    std::condition_variable DoneCondition;
+
+    // Current ParallelFor (guarded by Mutex, except NextIndex)
+    const FTaskFunction* CurrentTask = nullptr;
+    uint32 TaskCount = 0;
+    std::atomic<uint32> NextIndex{ 0 };
+    uint32 BusyWorkers = 0;
+    uint64 Generation = 0;
+    bool bStopping = false;
+};
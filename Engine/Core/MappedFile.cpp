@@ -0,0 +1,171 @@
+﻿#include "MappedFile.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+KMappedFile::KMappedFile(KMappedFile&& Other) noexcept
+{
+    *this = std::move(Other);
+}
+
+KMappedFile& KMappedFile::operator=(KMappedFile&& Other) noexcept
+{
+    if (this != &Other)
+    {
+        Close();
+
+        Data = Other.Data;
+        Size = Other.Size;
+        Other.Data = nullptr;
+        Other.Size = 0;
+#ifdef _WIN32
+        FileHandle = Other.FileHandle;
+        MappingHandle = Other.MappingHandle;
+        Other.FileHandle = nullptr;
+        Other.MappingHandle = nullptr;
+#endif
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+
+bool KMappedFile::Open(const std::string& Path)
+{
+    Close();
+
+    const int WideLength = MultiByteToWideChar(CP_UTF8, 0, Path.c_str(), -1, nullptr, 0);
+    if (WideLength <= 0)
+    {
+        return false;
+    }
+    std::wstring WidePath(static_cast<size_t>(WideLength), L'\0');
+    MultiByteToWideChar(CP_UTF8, 0, Path.c_str(), -1, &WidePath[0], WideLength);
+
+    HANDLE File = CreateFileW(WidePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (File == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER FileSize = {};
+    if (!GetFileSizeEx(File, &FileSize) || FileSize.QuadPart <= 0)
+    {
+        CloseHandle(File);
+        return false;
+    }
+
+    HANDLE Mapping = CreateFileMappingW(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!Mapping)
+    {
+        CloseHandle(File);
+        return false;
+    }
+
+    void* View = MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!View)
+    {
+        CloseHandle(Mapping);
+        CloseHandle(File);
+        return false;
+    }
+
+    FileHandle = File;
+    MappingHandle = Mapping;
+    Data = static_cast<const uint8*>(View);
+    Size = static_cast<size_t>(FileSize.QuadPart);
+    return true;
+}
+
+void KMappedFile::Close()
+{
+    if (Data)
+    {
+        UnmapViewOfFile(Data);
+    }
+    if (MappingHandle)
+    {
+        CloseHandle(MappingHandle);
+    }
+    if (FileHandle)
+    {
+        CloseHandle(FileHandle);
+    }
+
+    Data = nullptr;
+    Size = 0;
+    FileHandle = nullptr;
+    MappingHandle = nullptr;
+}
+
+void KMappedFile::Prefetch() const
+{
+    if (Data)
+    {
+        WIN32_MEMORY_RANGE_ENTRY Range = { const_cast<uint8*>(Data), Size };
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &Range, 0);
+    }
+}
+
+#else
+
+bool KMappedFile::Open(const std::string& Path)
+{
+    Close();
+
+    const int File = open(Path.c_str(), O_RDONLY);
+    if (File < 0)
+    {
+        return false;
+    }
+
+    struct stat FileStat;
+    if (fstat(File, &FileStat) != 0 || FileStat.st_size <= 0)
+    {
+        close(File);
+        return false;
+    }
+
+    // The mapping keeps its own reference to the file
+    void* View = mmap(nullptr, static_cast<size_t>(FileStat.st_size), PROT_READ, MAP_PRIVATE, File, 0);
+    close(File);
+    if (View == MAP_FAILED)
+    {
+        return false;
+    }
+
+    Data = static_cast<const uint8*>(View);
+    Size = static_cast<size_t>(FileStat.st_size);
+    return true;
+}
+
+void KMappedFile::Close()
+{
+    if (Data)
+    {
+        munmap(const_cast<uint8*>(Data), Size);
+    }
+
+    Data = nullptr;
+    Size = 0;
+}
+
+void KMappedFile::Prefetch() const
+{
+    if (Data)
+    {
+        madvise(const_cast<uint8*>(Data), Size, MADV_WILLNEED);
+    }
+}
+
+#endif
@@ -0,0 +1,58 @@
+﻿#pragma once
+
+#include <string>
+#include <utility>
+
+#include "../Utils/Types.h"
+
+/**
+ * @brief Read-only memory-mapped file
+ *
+ * Maps a whole file with MapViewOfFile (Windows) or mmap (POSIX); the bytes
+ * stay valid until Close or destruction. Pages are loaded by the OS on first
+ * touch, so opening is cheap regardless of the file size.
+ * Platform independent interface; paths are UTF-8.
+ */
+class KMappedFile
+{
+public:
+    KMappedFile() = default;
+    ~KMappedFile() { Close(); }
+
+    // Prevent copying, allow moving
+    KMappedFile(const KMappedFile&) = delete;
+    KMappedFile& operator=(const KMappedFile&) = delete;
+    KMappedFile(KMappedFile&& Other) noexcept;
+    KMappedFile& operator=(KMappedFile&& Other) noexcept;
+
+    /**
+     * @brief Map a file for reading (closes any file mapped before)
+     * @param Path UTF-8 file path
+     * @return true on success; empty files fail
+     */
+    bool Open(const std::string& Path);
+
+    /**
+     * @brief Unmap the file
+     */
+    void Close();
+
+    /**
+     * @brief Hint that the whole file is about to be read sequentially
+     */
+    void Prefetch() const;
+
+    // Accessors
+    const uint8* GetData() const { return Data; }
+    size_t GetSize() const { return Size; }
+    bool IsOpen() const { return Data != nullptr; }
+
+private:
+    const uint8* Data = nullptr;
+    size_t Size = 0;
+
+#ifdef _WIN32
+    void* FileHandle = nullptr;
+    void* MappingHandle = nullptr;
+#endif
+};
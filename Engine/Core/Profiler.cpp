@@ -0,0 +1,299 @@
+﻿#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+namespace
+{
+    /**
+     * @brief Ring buffer slot; fields are atomic so captures can be read while the owner records
+     */
+    struct FEventSlot
+    {
+        std::atomic<const char*> Name{ nullptr };
+        std::atomic<uint64> BeginTime{ 0 };
+        std::atomic<uint64> EndTime{ 0 };
+        std::atomic<uint32> Depth{ 0 };
+    };
+
+    /**
+     * @brief Zones of one thread, written only by that thread
+     */
+    struct FThreadBuffer
+    {
+        std::unique_ptr<FEventSlot[]> Slots{ new FEventSlot[KProfiler::EventsPerThread] };
+        std::atomic<uint64> Head{ 0 };          // Total zones written
+        std::atomic<uint64> ClearedHead{ 0 };   // Zones before this were discarded by Clear
+        uint32 ThreadIndex = 0;
+        uint32 Depth = 0;                       // Owner thread only
+        std::string ThreadName;                 // Guarded by FRegistry::Mutex
+    };
+
+    struct FRegistry
+    {
+        std::mutex Mutex;
+        std::vector<std::unique_ptr<FThreadBuffer>> Buffers;
+        std::vector<FThreadBuffer*> FreeBuffers;    // Buffers of exited threads
+    };
+
+    FRegistry& GetRegistry()
+    {
+        // Intentionally leaked: threads may still record during static destruction
+        static FRegistry* Registry = new FRegistry();
+        return *Registry;
+    }
+
+    thread_local FThreadBuffer* LocalBuffer = nullptr;
+
+    /**
+     * @brief Hands the thread's buffer back to the registry when the thread exits
+     */
+    struct FThreadExitRelease
+    {
+        ~FThreadExitRelease()
+        {
+            if (LocalBuffer)
+            {
+                FRegistry& Registry = GetRegistry();
+                std::lock_guard<std::mutex> Lock(Registry.Mutex);
+                Registry.FreeBuffers.push_back(LocalBuffer);
+                LocalBuffer = nullptr;
+            }
+        }
+    };
+
+    FThreadBuffer& GetLocalBuffer()
+    {
+        if (!LocalBuffer)
+        {
+            // Separate from LocalBuffer so recording reads a plain thread_local pointer
+            thread_local FThreadExitRelease ExitRelease;
+            (void)ExitRelease;
+
+            FRegistry& Registry = GetRegistry();
+            std::lock_guard<std::mutex> Lock(Registry.Mutex);
+
+            if (!Registry.FreeBuffers.empty())
+            {
+                // Take over the buffer of an exited thread; its zones stay in the ring under
+                // the same thread index (they never overlap the new thread's) until overwritten
+                FThreadBuffer* Buffer = Registry.FreeBuffers.back();
+                Registry.FreeBuffers.pop_back();
+                Buffer->Depth = 0;
+                Buffer->ThreadName = "Thread " + std::to_string(Buffer->ThreadIndex);
+                LocalBuffer = Buffer;
+            }
+            else
+            {
+                auto Buffer = std::make_unique<FThreadBuffer>();
+                Buffer->ThreadIndex = static_cast<uint32>(Registry.Buffers.size());
+                Buffer->ThreadName = "Thread " + std::to_string(Buffer->ThreadIndex);
+                LocalBuffer = Buffer.get();
+                Registry.Buffers.push_back(std::move(Buffer));
+            }
+        }
+        return *LocalBuffer;
+    }
+
+    void AppendJsonString(std::string& Out, const char* Text)
+    {
+        Out += '"';
+        for (const char* Char = Text; *Char; ++Char)
+        {
+            switch (*Char)
+            {
+            case '"':  Out += "\\\""; break;
+            case '\\': Out += "\\\\"; break;
+            case '\n': Out += "\\n"; break;
+            case '\t': Out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(*Char) >= 0x20)
+                {
+                    Out += *Char;
+                }
+                break;
+            }
+        }
+        Out += '"';
+    }
+
+    void AppendMicroseconds(std::string& Out, uint64 Nanoseconds)
+    {
+        char Text[32];
+        std::snprintf(Text, sizeof(Text), "%llu.%03u",
+            static_cast<unsigned long long>(Nanoseconds / 1000), static_cast<unsigned>(Nanoseconds % 1000));
+        Out += Text;
+    }
+}
+
+uint64 KProfiler::GetTime()
+{
+    static const std::chrono::steady_clock::time_point Origin = std::chrono::steady_clock::now();
+    return static_cast<uint64>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - Origin).count());
+}
+
+uint32 KProfiler::GetThreadBufferCount()
+{
+    FRegistry& Registry = GetRegistry();
+    std::lock_guard<std::mutex> Lock(Registry.Mutex);
+    return static_cast<uint32>(Registry.Buffers.size());
+}
+
+void KProfiler::SetThreadName(const char* InName)
+{
+    FThreadBuffer& Buffer = GetLocalBuffer();
+
+    FRegistry& Registry = GetRegistry();
+    std::lock_guard<std::mutex> Lock(Registry.Mutex);
+    Buffer.ThreadName = InName ? InName : "";
+}
+
+uint64 KProfiler::BeginZone()
+{
+    ++GetLocalBuffer().Depth;
+    return GetTime();
+}
+
+void KProfiler::EndZone(const char* InName, uint64 BeginTime)
+{
+    const uint64 EndTime = GetTime();
+
+    FThreadBuffer& Buffer = GetLocalBuffer();
+    --Buffer.Depth;
+
+    const uint64 Index = Buffer.Head.load(std::memory_order_relaxed);
+    FEventSlot& Slot = Buffer.Slots[Index % EventsPerThread];
+    Slot.Name.store(InName, std::memory_order_relaxed);
+    Slot.BeginTime.store(BeginTime, std::memory_order_relaxed);
+    Slot.EndTime.store(EndTime, std::memory_order_relaxed);
+    Slot.Depth.store(Buffer.Depth, std::memory_order_relaxed);
+
+    // Publish the slot
+    Buffer.Head.store(Index + 1, std::memory_order_release);
+}
+
+void KProfiler::Clear()
+{
+    FRegistry& Registry = GetRegistry();
+    std::lock_guard<std::mutex> Lock(Registry.Mutex);
+
+    for (const auto& Buffer : Registry.Buffers)
+    {
+        Buffer->ClearedHead.store(Buffer->Head.load(std::memory_order_acquire), std::memory_order_relaxed);
+    }
+}
+
+void KProfiler::CollectEvents(std::vector<FProfileEvent>& OutEvents)
+{
+    OutEvents.clear();
+
+    FRegistry& Registry = GetRegistry();
+    std::lock_guard<std::mutex> Lock(Registry.Mutex);
+
+    for (const auto& Buffer : Registry.Buffers)
+    {
+        const uint64 Head = Buffer->Head.load(std::memory_order_acquire);
+        uint64 First = Buffer->ClearedHead.load(std::memory_order_relaxed);
+        if (Head > EventsPerThread)
+        {
+            First = std::max(First, Head - EventsPerThread);
+        }
+
+        const size_t CopyStart = OutEvents.size();
+        for (uint64 Index = First; Index < Head; ++Index)
+        {
+            const FEventSlot& Slot = Buffer->Slots[Index % EventsPerThread];
+
+            FProfileEvent Event;
+            Event.Name = Slot.Name.load(std::memory_order_relaxed);
+            Event.BeginTime = Slot.BeginTime.load(std::memory_order_relaxed);
+            Event.EndTime = Slot.EndTime.load(std::memory_order_relaxed);
+            Event.Depth = Slot.Depth.load(std::memory_order_relaxed);
+            Event.ThreadIndex = Buffer->ThreadIndex;
+            OutEvents.push_back(Event);
+        }
+
+        // The owner may have wrapped around while we copied (the slot after the
+        // published head can be half written); drop zones that were overwritten
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64 NewHead = Buffer->Head.load(std::memory_order_relaxed);
+        if (NewHead + 1 > First + EventsPerThread)
+        {
+            const uint64 Overwritten = std::min(NewHead + 1 - EventsPerThread, Head) - First;
+            OutEvents.erase(OutEvents.begin() + CopyStart, OutEvents.begin() + CopyStart + static_cast<size_t>(Overwritten));
+        }
+    }
+
+    std::sort(OutEvents.begin(), OutEvents.end(), [](const FProfileEvent& A, const FProfileEvent& B)
+    {
+        if (A.BeginTime != B.BeginTime)
+        {
+            return A.BeginTime < B.BeginTime;
+        }
+        return A.Depth < B.Depth;
+    });
+}
+
+std::string KProfiler::ExportChromeTrace()
+{
+    std::vector<FProfileEvent> Events;
+    CollectEvents(Events);
+
+    std::string Out;
+    Out.reserve(64 + Events.size() * 96);
+    Out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    bool bFirst = true;
+    {
+        FRegistry& Registry = GetRegistry();
+        std::lock_guard<std::mutex> Lock(Registry.Mutex);
+
+        for (const auto& Buffer : Registry.Buffers)
+        {
+            Out += bFirst ? "\n" : ",\n";
+            bFirst = false;
+            Out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":";
+            Out += std::to_string(Buffer->ThreadIndex);
+            Out += ",\"args\":{\"name\":";
+            AppendJsonString(Out, Buffer->ThreadName.c_str());
+            Out += "}}";
+        }
+    }
+
+    for (const FProfileEvent& Event : Events)
+    {
+        Out += bFirst ? "\n" : ",\n";
+        bFirst = false;
+        Out += "{\"name\":";
+        AppendJsonString(Out, Event.Name ? Event.Name : "");
+        Out += ",\"cat\":\"CPU\",\"ph\":\"X\",\"pid\":1,\"tid\":";
+        Out += std::to_string(Event.ThreadIndex);
+        Out += ",\"ts\":";
+        AppendMicroseconds(Out, Event.BeginTime);
+        Out += ",\"dur\":";
+        AppendMicroseconds(Out, Event.EndTime - Event.BeginTime);
+        Out += '}';
+    }
+
+    Out += "\n]}\n";
+    return Out;
+}
+
+bool KProfiler::WriteChromeTrace(const std::string& Path)
+{
+    const std::string Trace = ExportChromeTrace();
+
+    std::ofstream File(Path, std::ios::binary | std::ios::trunc);
+    if (!File)
+    {
+        return false;
+    }
+
+    File.write(Trace.data(), static_cast<std::streamsize>(Trace.size()));
+    return static_cast<bool>(File);
+}
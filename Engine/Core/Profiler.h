@@ -0,0 +1,131 @@
+﻿#pragma once
+
+#include "../Utils/Types.h"
+#include <atomic>
+#include <string>
+#include <vector>
+
+// Set to 0 to compile all profiling markers out
+#ifndef KE_ENABLE_PROFILER
+#define KE_ENABLE_PROFILER 1
+#endif
+
+/**
+ * @brief One completed profiling zone
+ */
+struct FProfileEvent
+{
+    const char* Name = nullptr;
+    uint64 BeginTime = 0;       // Nanoseconds since KProfiler::GetTime's origin
+    uint64 EndTime = 0;
+    uint32 ThreadIndex = 0;
+    uint32 Depth = 0;           // Nesting level on its thread, 0 for outermost zones
+};
+
+/**
+ * @brief Hierarchical CPU profiler
+ *
+ * Zones are recorded into a fixed-size ring buffer per thread. Only the owning
+ * thread writes a buffer, so recording takes no locks; the oldest zones are
+ * overwritten when a buffer is full. The buffer of an exited thread is reused by
+ * the next new thread, so restarting worker threads does not grow the profiler. While the profiler is disabled a marker
+ * costs a single relaxed atomic load. Platform independent.
+ *
+ * Zone names are stored by pointer and must outlive the capture (use string literals).
+ */
+class KProfiler
+{
+public:
+    static constexpr uint32 EventsPerThread = 1u << 15;
+
+    static void SetEnabled(bool bInEnabled) { bEnabled.store(bInEnabled, std::memory_order_relaxed); }
+    static bool IsEnabled() { return bEnabled.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Monotonic time in nanoseconds
+     */
+    static uint64 GetTime();
+
+    /**
+     * @brief Ring buffers allocated so far (one per concurrently recording thread)
+     */
+    static uint32 GetThreadBufferCount();
+
+    /**
+     * @brief Name the calling thread in exported captures
+     */
+    static void SetThreadName(const char* InName);
+
+    /**
+     * @brief Start a zone on the calling thread
+     * @return Zone start time
+     */
+    static uint64 BeginZone();
+
+    /**
+     * @brief Finish the innermost zone of the calling thread
+     */
+    static void EndZone(const char* InName, uint64 BeginTime);
+
+    /**
+     * @brief Discard all recorded zones
+     */
+    static void Clear();
+
+    /**
+     * @brief Copy recorded zones of every thread, sorted by start time
+     */
+    static void CollectEvents(std::vector<FProfileEvent>& OutEvents);
+
+    /**
+     * @brief Write recorded zones in the Chrome trace-event JSON format
+     *
+     * The result loads in chrome://tracing or https://ui.perfetto.dev.
+     */
+    static std::string ExportChromeTrace();
+    static bool WriteChromeTrace(const std::string& Path);
+
+private:
+    static inline std::atomic<bool> bEnabled{ false };
+};
+
+/**
+ * @brief Records a zone for the lifetime of the object
+ */
+class KProfileScope
+{
+public:
+    explicit KProfileScope(const char* InName)
+    {
+        if (KProfiler::IsEnabled())
+        {
+            Name = InName;
+            BeginTime = KProfiler::BeginZone();
+        }
+    }
+
+    ~KProfileScope()
+    {
+        if (Name)
+        {
+            KProfiler::EndZone(Name, BeginTime);
+        }
+    }
+
+    KProfileScope(const KProfileScope&) = delete;
+    KProfileScope& operator=(const KProfileScope&) = delete;
+
+private:
+    const char* Name = nullptr;
+    uint64 BeginTime = 0;
+};
+
+#if KE_ENABLE_PROFILER
+#define KE_PROFILE_CONCAT_INNER(A, B) A##B
+#define KE_PROFILE_CONCAT(A, B) KE_PROFILE_CONCAT_INNER(A, B)
+#define KE_PROFILE_SCOPE(Name) KProfileScope KE_PROFILE_CONCAT(ProfileScope_, __LINE__)(Name)
+#define KE_PROFILE_FUNCTION() KE_PROFILE_SCOPE(__FUNCTION__)
+#else
+#define KE_PROFILE_SCOPE(Name) ((void)0)
+#define KE_PROFILE_FUNCTION() ((void)0)
+#endif
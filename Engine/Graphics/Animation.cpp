@@ -0,0 +1,991 @@
+﻿#include "Animation.h"
+#include "../Core/JobSystem.h"
+#include "../Core/Profiler.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define KE_ANIMATION_SSE 1
+#endif
+
+namespace
+{
+    constexpr float InvSqrt2 = 0.70710678118654752f;
+    constexpr uint32 BatchesPerThread = 8;
+
+    // Four floats, one per lane; SSE where available
+#if KE_ANIMATION_SSE
+    struct FVector4
+    {
+        __m128 V;
+    };
+
+    inline FVector4 Load(const float* Source) { return { _mm_load_ps(Source) }; }
+    inline FVector4 LoadUnaligned(const float* Source) { return { _mm_loadu_ps(Source) }; }
+    inline void Store(float* Destination, FVector4 A) { _mm_store_ps(Destination, A.V); }
+    inline void StoreUnaligned(float* Destination, FVector4 A) { _mm_storeu_ps(Destination, A.V); }
+    inline FVector4 Splat(float Value) { return { _mm_set1_ps(Value) }; }
+    inline FVector4 operator+(FVector4 A, FVector4 B) { return { _mm_add_ps(A.V, B.V) }; }
+    inline FVector4 operator-(FVector4 A, FVector4 B) { return { _mm_sub_ps(A.V, B.V) }; }
+    inline FVector4 operator*(FVector4 A, FVector4 B) { return { _mm_mul_ps(A.V, B.V) }; }
+
+    inline FVector4 Sqrt(FVector4 A) { return { _mm_sqrt_ps(A.V) }; }
+    inline FVector4 Max(FVector4 A, FVector4 B) { return { _mm_max_ps(A.V, B.V) }; }
+
+    // Lane masks and selection
+    inline FVector4 Equal(FVector4 A, FVector4 B) { return { _mm_cmpeq_ps(A.V, B.V) }; }
+    inline FVector4 Less(FVector4 A, FVector4 B) { return { _mm_cmplt_ps(A.V, B.V) }; }
+    inline FVector4 Select(FVector4 Mask, FVector4 A, FVector4 B) { return { _mm_or_ps(_mm_and_ps(Mask.V, A.V), _mm_andnot_ps(Mask.V, B.V)) }; }
+
+    // One Newton step on the estimate: about 23 bits
+    inline FVector4 ReciprocalSqrt(FVector4 A)
+    {
+        const __m128 Estimate = _mm_rsqrt_ps(A.V);
+        const __m128 HalfA = _mm_mul_ps(_mm_set1_ps(0.5f), A.V);
+        return { _mm_mul_ps(Estimate, _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(HalfA, _mm_mul_ps(Estimate, Estimate)))) };
+    }
+
+    // Value with its sign flipped in lanes where Sign is negative
+    inline FVector4 FlipSign(FVector4 Value, FVector4 Sign)
+    {
+        return { _mm_xor_ps(Value.V, _mm_and_ps(Sign.V, _mm_set1_ps(-0.0f))) };
+    }
+
+    inline void Transpose(FVector4& A, FVector4& B, FVector4& C, FVector4& D)
+    {
+        _MM_TRANSPOSE4_PS(A.V, B.V, C.V, D.V);
+    }
+#else
+    struct FVector4
+    {
+        float V[4];
+    };
+
+    inline FVector4 Load(const float* Source) { return { { Source[0], Source[1], Source[2], Source[3] } }; }
+    inline FVector4 LoadUnaligned(const float* Source) { return Load(Source); }
+    inline void Store(float* Destination, FVector4 A) { std::memcpy(Destination, A.V, sizeof(A.V)); }
+    inline void StoreUnaligned(float* Destination, FVector4 A) { Store(Destination, A); }
+    inline FVector4 Splat(float Value) { return { { Value, Value, Value, Value } }; }
+    inline FVector4 operator+(FVector4 A, FVector4 B) { return { { A.V[0] + B.V[0], A.V[1] + B.V[1], A.V[2] + B.V[2], A.V[3] + B.V[3] } }; }
+    inline FVector4 operator-(FVector4 A, FVector4 B) { return { { A.V[0] - B.V[0], A.V[1] - B.V[1], A.V[2] - B.V[2], A.V[3] - B.V[3] } }; }
+    inline FVector4 operator*(FVector4 A, FVector4 B) { return { { A.V[0] * B.V[0], A.V[1] * B.V[1], A.V[2] * B.V[2], A.V[3] * B.V[3] } }; }
+
+    inline FVector4 Sqrt(FVector4 A) { return { { std::sqrt(A.V[0]), std::sqrt(A.V[1]), std::sqrt(A.V[2]), std::sqrt(A.V[3]) } }; }
+    inline FVector4 Max(FVector4 A, FVector4 B) { return { { std::fmax(A.V[0], B.V[0]), std::fmax(A.V[1], B.V[1]), std::fmax(A.V[2], B.V[2]), std::fmax(A.V[3], B.V[3]) } }; }
+
+    // Masks hold 1 in selected lanes
+    inline FVector4 Equal(FVector4 A, FVector4 B) { return { { A.V[0] == B.V[0] ? 1.0f : 0.0f, A.V[1] == B.V[1] ? 1.0f : 0.0f, A.V[2] == B.V[2] ? 1.0f : 0.0f, A.V[3] == B.V[3] ? 1.0f : 0.0f } }; }
+    inline FVector4 Less(FVector4 A, FVector4 B) { return { { A.V[0] < B.V[0] ? 1.0f : 0.0f, A.V[1] < B.V[1] ? 1.0f : 0.0f, A.V[2] < B.V[2] ? 1.0f : 0.0f, A.V[3] < B.V[3] ? 1.0f : 0.0f } }; }
+    inline FVector4 Select(FVector4 Mask, FVector4 A, FVector4 B) { return { { Mask.V[0] != 0.0f ? A.V[0] : B.V[0], Mask.V[1] != 0.0f ? A.V[1] : B.V[1], Mask.V[2] != 0.0f ? A.V[2] : B.V[2], Mask.V[3] != 0.0f ? A.V[3] : B.V[3] } }; }
+
+    inline FVector4 ReciprocalSqrt(FVector4 A)
+    {
+        return { { 1.0f / std::sqrt(A.V[0]), 1.0f / std::sqrt(A.V[1]), 1.0f / std::sqrt(A.V[2]), 1.0f / std::sqrt(A.V[3]) } };
+    }
+
+    inline FVector4 FlipSign(FVector4 Value, FVector4 Sign)
+    {
+        for (int Lane = 0; Lane < 4; ++Lane)
+        {
+            Value.V[Lane] = Sign.V[Lane] < 0.0f ? -Value.V[Lane] : Value.V[Lane];
+        }
+        return Value;
+    }
+
+    inline void Transpose(FVector4& A, FVector4& B, FVector4& C, FVector4& D)
+    {
+        FVector4* Rows[4] = { &A, &B, &C, &D };
+        for (int Row = 0; Row < 4; ++Row)
+        {
+            for (int Column = Row + 1; Column < 4; ++Column)
+            {
+                const float Temp = Rows[Row]->V[Column];
+                Rows[Row]->V[Column] = Rows[Column]->V[Row];
+                Rows[Column]->V[Row] = Temp;
+            }
+        }
+    }
+#endif
+
+    // Rotation components of a group, flipped into the hemisphere of Reference
+    void LoadAlignedRotation(const FJointTransformSoA& Group, const FVector4 (&Reference)[4], FVector4 (&OutRotation)[4])
+    {
+        FVector4 Rotation[4];
+        for (int Component = 0; Component < 4; ++Component)
+        {
+            Rotation[Component] = Load(Group.Rotation[Component]);
+        }
+
+        const FVector4 Dot = Reference[0] * Rotation[0] + Reference[1] * Rotation[1] +
+                             Reference[2] * Rotation[2] + Reference[3] * Rotation[3];
+        for (int Component = 0; Component < 4; ++Component)
+        {
+            OutRotation[Component] = FlipSign(Rotation[Component], Dot);
+        }
+    }
+
+    void StoreNormalizedRotation(const FVector4 (&Rotation)[4], FJointTransformSoA& OutGroup)
+    {
+        const FVector4 InvLength = ReciprocalSqrt(Rotation[0] * Rotation[0] + Rotation[1] * Rotation[1] +
+                                                  Rotation[2] * Rotation[2] + Rotation[3] * Rotation[3]);
+        for (int Component = 0; Component < 4; ++Component)
+        {
+            Store(OutGroup.Rotation[Component], Rotation[Component] * InvLength);
+        }
+    }
+
+    void SetIdentity(FJointTransformSoA& Group)
+    {
+        std::memset(&Group, 0, sizeof(Group));
+        for (int Lane = 0; Lane < 4; ++Lane)
+        {
+            Group.Rotation[3][Lane] = 1.0f;
+            Group.Scale[0][Lane] = Group.Scale[1][Lane] = Group.Scale[2][Lane] = 1.0f;
+        }
+    }
+
+    void WriteJoint(FJointTransformSoA* Groups, uint32 Joint, const FJointTransform& Transform)
+    {
+        FJointTransformSoA& Group = Groups[Joint / Animation::SoAWidth];
+        const uint32 Lane = Joint % Animation::SoAWidth;
+        for (int Component = 0; Component < 4; ++Component)
+        {
+            Group.Rotation[Component][Lane] = Transform.Rotation[Component];
+        }
+        for (int Axis = 0; Axis < 3; ++Axis)
+        {
+            Group.Translation[Axis][Lane] = Transform.Translation[Axis];
+            Group.Scale[Axis][Lane] = Transform.Scale[Axis];
+        }
+    }
+
+    // Rows of A * B (row-major 4x4, row vectors)
+    void MultiplyRows(const float* A, const float* B, FVector4 (&OutRows)[4])
+    {
+        const FVector4 B0 = LoadUnaligned(B);
+        const FVector4 B1 = LoadUnaligned(B + 4);
+        const FVector4 B2 = LoadUnaligned(B + 8);
+        const FVector4 B3 = LoadUnaligned(B + 12);
+
+        for (int Row = 0; Row < 4; ++Row)
+        {
+            const float* ARow = A + Row * 4;
+            OutRows[Row] = Splat(ARow[0]) * B0 + Splat(ARow[1]) * B1 + Splat(ARow[2]) * B2 + Splat(ARow[3]) * B3;
+        }
+    }
+
+    // Inverse of a matrix whose last column is (0, 0, 0, 1)
+    void InvertAffine(const float* M, float* Out)
+    {
+        const float C00 = M[5] * M[10] - M[6] * M[9];
+        const float C01 = M[6] * M[8] - M[4] * M[10];
+        const float C02 = M[4] * M[9] - M[5] * M[8];
+        const float Determinant = M[0] * C00 + M[1] * C01 + M[2] * C02;
+        const float InvDeterminant = Determinant != 0.0f ? 1.0f / Determinant : 0.0f;
+
+        Out[0] = C00 * InvDeterminant;
+        Out[1] = (M[2] * M[9] - M[1] * M[10]) * InvDeterminant;
+        Out[2] = (M[1] * M[6] - M[2] * M[5]) * InvDeterminant;
+        Out[4] = C01 * InvDeterminant;
+        Out[5] = (M[0] * M[10] - M[2] * M[8]) * InvDeterminant;
+        Out[6] = (M[2] * M[4] - M[0] * M[6]) * InvDeterminant;
+        Out[8] = C02 * InvDeterminant;
+        Out[9] = (M[1] * M[8] - M[0] * M[9]) * InvDeterminant;
+        Out[10] = (M[0] * M[5] - M[1] * M[4]) * InvDeterminant;
+        Out[3] = Out[7] = Out[11] = 0.0f;
+
+        // Translation row: -T * Inverse(3x3)
+        for (int Column = 0; Column < 3; ++Column)
+        {
+            Out[12 + Column] = -(M[12] * Out[Column] + M[13] * Out[4 + Column] + M[14] * Out[8 + Column]);
+        }
+        Out[15] = 1.0f;
+    }
+
+    // Smallest three: the largest component is dropped and made positive, the
+    // others are stored in 15 bits; its index goes into the top bits of the first two words
+    void EncodeRotation(const float Rotation[4], uint16 OutWords[3])
+    {
+        int Largest = 0;
+        for (int Component = 1; Component < 4; ++Component)
+        {
+            if (std::fabs(Rotation[Component]) > std::fabs(Rotation[Largest]))
+            {
+                Largest = Component;
+            }
+        }
+
+        const float Sign = Rotation[Largest] < 0.0f ? -1.0f : 1.0f;
+        int Word = 0;
+        for (int Component = 0; Component < 4; ++Component)
+        {
+            if (Component == Largest)
+            {
+                continue;
+            }
+            float Normalized = Rotation[Component] * Sign * InvSqrt2 + 0.5f;
+            Normalized = Normalized < 0.0f ? 0.0f : (Normalized > 1.0f ? 1.0f : Normalized);
+            OutWords[Word++] = static_cast<uint16>(std::lround(Normalized * 32767.0f));
+        }
+        OutWords[0] |= static_cast<uint16>((Largest & 1) << 15);
+        OutWords[1] |= static_cast<uint16>((Largest >> 1) << 15);
+    }
+
+    // Decode four rotation keys (tracks First..First+Count) into lanes
+    void DecodeRotations(const uint16* Keys, uint32 First, uint32 Count, FVector4 (&OutRotation)[4])
+    {
+        alignas(16) float Stored[3][4] = {};
+        alignas(16) float Largest[4] = {};
+        for (uint32 Lane = 0; Lane < Count; ++Lane)
+        {
+            const uint16* Words = Keys + (First + Lane) * 3;
+            for (int Word = 0; Word < 3; ++Word)
+            {
+                Stored[Word][Lane] = static_cast<float>(Words[Word] & 0x7FFF);
+            }
+            Largest[Lane] = static_cast<float>((Words[0] >> 15) | ((Words[1] >> 15) << 1));
+        }
+
+        const FVector4 Scale = Splat(2.0f / 32767.0f * InvSqrt2);
+        const FVector4 Offset = Splat(InvSqrt2);
+        const FVector4 A = Load(Stored[0]) * Scale - Offset;
+        const FVector4 B = Load(Stored[1]) * Scale - Offset;
+        const FVector4 C = Load(Stored[2]) * Scale - Offset;
+        const FVector4 Dropped = Sqrt(Max(Splat(1.0f) - (A * A + B * B + C * C), Splat(0.0f)));
+
+        // The stored components fill the slots around the dropped one
+        const FVector4 Index = Load(Largest);
+        const FVector4 One = Splat(1.0f);
+        const FVector4 Two = Splat(2.0f);
+        OutRotation[0] = Select(Equal(Index, Splat(0.0f)), Dropped, A);
+        OutRotation[1] = Select(Equal(Index, One), Dropped, Select(Less(Index, One), A, B));
+        OutRotation[2] = Select(Equal(Index, Two), Dropped, Select(Less(Index, Two), B, C));
+        OutRotation[3] = Select(Equal(Index, Splat(3.0f)), Dropped, C);
+    }
+
+    uint16 QuantizeUNorm16(float Value, float Min, float Extent)
+    {
+        if (Extent <= 0.0f)
+        {
+            return 0;
+        }
+        float Normalized = (Value - Min) / Extent;
+        Normalized = Normalized < 0.0f ? 0.0f : (Normalized > 1.0f ? 1.0f : Normalized);
+        return static_cast<uint16>(std::lround(Normalized * 65535.0f));
+    }
+
+    // Largest component difference, for either sign of B
+    float RotationDifference(const float A[4], const float B[4])
+    {
+        float Same = 0.0f;
+        float Opposite = 0.0f;
+        for (int Component = 0; Component < 4; ++Component)
+        {
+            const float DifferenceSame = std::fabs(A[Component] - B[Component]);
+            const float DifferenceOpposite = std::fabs(A[Component] + B[Component]);
+            Same = DifferenceSame > Same ? DifferenceSame : Same;
+            Opposite = DifferenceOpposite > Opposite ? DifferenceOpposite : Opposite;
+        }
+        return Same < Opposite ? Same : Opposite;
+    }
+
+    float VectorDifference(const float A[3], const float B[3])
+    {
+        float Difference = 0.0f;
+        for (int Axis = 0; Axis < 3; ++Axis)
+        {
+            const float AxisDifference = std::fabs(A[Axis] - B[Axis]);
+            Difference = AxisDifference > Difference ? AxisDifference : Difference;
+        }
+        return Difference;
+    }
+
+    // Interpolate animated rotation tracks four at a time and scatter them to their joints
+    void SampleRotationTracks(const uint16* Tracks, uint32 TrackCount, const uint16* Keys0, const uint16* Keys1,
+                              float Alpha, FJointTransformSoA* OutGroups)
+    {
+        const FVector4 Weight = Splat(Alpha);
+        for (uint32 First = 0; First < TrackCount; First += Animation::SoAWidth)
+        {
+            const uint32 Count = TrackCount - First < Animation::SoAWidth ? TrackCount - First : Animation::SoAWidth;
+
+            FVector4 Start[4];
+            FVector4 End[4];
+            DecodeRotations(Keys0, First, Count, Start);
+            DecodeRotations(Keys1, First, Count, End);
+            const FVector4 Dot = Start[0] * End[0] + Start[1] * End[1] + Start[2] * End[2] + Start[3] * End[3];
+
+            FVector4 Rotation[4];
+            for (int Component = 0; Component < 4; ++Component)
+            {
+                Rotation[Component] = Start[Component] + (FlipSign(End[Component], Dot) - Start[Component]) * Weight;
+            }
+            const FVector4 InvLength = ReciprocalSqrt(Rotation[0] * Rotation[0] + Rotation[1] * Rotation[1] +
+                                                      Rotation[2] * Rotation[2] + Rotation[3] * Rotation[3]);
+
+            // [Component][Lane]
+            alignas(16) float Result[4][4];
+            for (int Component = 0; Component < 4; ++Component)
+            {
+                Store(Result[Component], Rotation[Component] * InvLength);
+            }
+
+            for (uint32 Lane = 0; Lane < Count; ++Lane)
+            {
+                const uint32 Joint = Tracks[First + Lane];
+                FJointTransformSoA& Group = OutGroups[Joint / Animation::SoAWidth];
+                for (int Component = 0; Component < 4; ++Component)
+                {
+                    Group.Rotation[Component][Joint % Animation::SoAWidth] = Result[Component][Lane];
+                }
+            }
+        }
+    }
+
+    // Same for translation or scale tracks (Ranges: min and extent per track)
+    void SampleVectorTracks(const uint16* Tracks, uint32 TrackCount, const float* Ranges, const uint16* Keys0, const uint16* Keys1,
+                            float Alpha, float (FJointTransformSoA::*Channel)[3][4], FJointTransformSoA* OutGroups)
+    {
+        constexpr float UNorm16Scale = 1.0f / 65535.0f;
+        const FVector4 Weight = Splat(Alpha);
+        for (uint32 First = 0; First < TrackCount; First += Animation::SoAWidth)
+        {
+            const uint32 Count = TrackCount - First < Animation::SoAWidth ? TrackCount - First : Animation::SoAWidth;
+
+            alignas(16) float Value0[3][4] = {};
+            alignas(16) float Value1[3][4] = {};
+            for (uint32 Lane = 0; Lane < Count; ++Lane)
+            {
+                const uint32 Track = First + Lane;
+                const float* Range = Ranges + Track * 6;
+                for (int Axis = 0; Axis < 3; ++Axis)
+                {
+                    const float Step = Range[3 + Axis] * UNorm16Scale;
+                    Value0[Axis][Lane] = Range[Axis] + static_cast<float>(Keys0[Track * 3 + Axis]) * Step;
+                    Value1[Axis][Lane] = Range[Axis] + static_cast<float>(Keys1[Track * 3 + Axis]) * Step;
+                }
+            }
+
+            for (int Axis = 0; Axis < 3; ++Axis)
+            {
+                const FVector4 Start = Load(Value0[Axis]);
+                Store(Value0[Axis], Start + (Load(Value1[Axis]) - Start) * Weight);
+            }
+
+            for (uint32 Lane = 0; Lane < Count; ++Lane)
+            {
+                const uint32 Joint = Tracks[First + Lane];
+                float (&Destination)[3][4] = OutGroups[Joint / Animation::SoAWidth].*Channel;
+                for (int Axis = 0; Axis < 3; ++Axis)
+                {
+                    Destination[Axis][Joint % Animation::SoAWidth] = Value0[Axis][Lane];
+                }
+            }
+        }
+    }
+}
+
+// KSkeleton
+
+bool KSkeleton::Initialize(const FSkeletonJoint* Joints, uint32 JointCount, bool bComputeInverseBindMatrices)
+{
+    Names.clear();
+    Parents.clear();
+    BindPose.clear();
+    InverseBindMatrices.clear();
+
+    if (!Joints || JointCount == 0 || JointCount > Animation::MaxJoints)
+    {
+        return false;
+    }
+    for (uint32 Joint = 0; Joint < JointCount; ++Joint)
+    {
+        if (Joints[Joint].Parent < -1 || Joints[Joint].Parent >= static_cast<int32>(Joint))
+        {
+            return false;
+        }
+    }
+
+    Names.resize(JointCount);
+    Parents.resize(JointCount);
+    BindPose.resize(Animation::GetSoACount(JointCount));
+    InverseBindMatrices.resize(size_t(JointCount) * 16);
+
+    for (FJointTransformSoA& Group : BindPose)
+    {
+        SetIdentity(Group);
+    }
+    for (uint32 Joint = 0; Joint < JointCount; ++Joint)
+    {
+        Names[Joint] = Joints[Joint].Name;
+        Parents[Joint] = static_cast<int16>(Joints[Joint].Parent);
+        WriteJoint(BindPose.data(), Joint, Joints[Joint].BindPose);
+        std::memcpy(&InverseBindMatrices[size_t(Joint) * 16], Joints[Joint].InverseBindMatrix, sizeof(float) * 16);
+    }
+
+    if (bComputeInverseBindMatrices)
+    {
+        KAnimationPose Pose;
+        Pose.SetBindPose(*this);
+
+        std::vector<float> ModelMatrices(size_t(JointCount) * 16);
+        Animation::ComputeModelMatrices(*this, Pose, ModelMatrices.data());
+        for (uint32 Joint = 0; Joint < JointCount; ++Joint)
+        {
+            InvertAffine(&ModelMatrices[size_t(Joint) * 16], &InverseBindMatrices[size_t(Joint) * 16]);
+        }
+    }
+    return true;
+}
+
+int32 KSkeleton::FindJoint(const std::string& Name) const
+{
+    for (size_t Joint = 0; Joint < Names.size(); ++Joint)
+    {
+        if (Names[Joint] == Name)
+        {
+            return static_cast<int32>(Joint);
+        }
+    }
+    return -1;
+}
+
+// KAnimationPose
+
+void KAnimationPose::Initialize(uint32 InJointCount)
+{
+    if (JointCount == InJointCount && !Groups.empty())
+    {
+        return;
+    }
+
+    // Padding lanes stay identity so they blend and normalize cleanly
+    JointCount = InJointCount;
+    Groups.resize(Animation::GetSoACount(JointCount));
+    for (FJointTransformSoA& Group : Groups)
+    {
+        SetIdentity(Group);
+    }
+}
+
+void KAnimationPose::SetBindPose(const KSkeleton& Skeleton)
+{
+    Initialize(Skeleton.GetJointCount());
+    std::memcpy(Groups.data(), Skeleton.GetBindPose(), sizeof(FJointTransformSoA) * Groups.size());
+}
+
+void KAnimationPose::GetJoint(uint32 Joint, FJointTransform& OutTransform) const
+{
+    const FJointTransformSoA& Group = Groups[Joint / Animation::SoAWidth];
+    const uint32 Lane = Joint % Animation::SoAWidth;
+    for (int Component = 0; Component < 4; ++Component)
+    {
+        OutTransform.Rotation[Component] = Group.Rotation[Component][Lane];
+    }
+    for (int Axis = 0; Axis < 3; ++Axis)
+    {
+        OutTransform.Translation[Axis] = Group.Translation[Axis][Lane];
+        OutTransform.Scale[Axis] = Group.Scale[Axis][Lane];
+    }
+}
+
+void KAnimationPose::SetJoint(uint32 Joint, const FJointTransform& Transform)
+{
+    WriteJoint(Groups.data(), Joint, Transform);
+}
+
+// KAnimationClip
+
+bool KAnimationClip::Compress(const FRawAnimationClip& Raw, const FAnimationCompressionSettings& Settings)
+{
+    KE_PROFILE_FUNCTION();
+
+    *this = KAnimationClip();
+    if (Raw.FrameCount == 0 || Raw.JointCount == 0 || Raw.JointCount > Animation::MaxJoints || !(Raw.SampleRate > 0.0f) ||
+        Raw.Frames.size() < size_t(Raw.FrameCount) * Raw.JointCount)
+    {
+        return false;
+    }
+
+    Name = Raw.Name;
+    SampleRate = Raw.SampleRate;
+    FrameCount = Raw.FrameCount;
+    JointCount = Raw.JointCount;
+
+    auto GetKey = [&Raw](uint32 Frame, uint32 Joint) -> const FJointTransform&
+    {
+        return Raw.Frames[size_t(Frame) * Raw.JointCount + Joint];
+    };
+
+    // Every track starts at its first key; only tracks that move get keys
+    ConstantPose.resize(Animation::GetSoACount(JointCount));
+    for (FJointTransformSoA& Group : ConstantPose)
+    {
+        SetIdentity(Group);
+    }
+
+    for (uint32 Joint = 0; Joint < JointCount; ++Joint)
+    {
+        const FJointTransform& First = GetKey(0, Joint);
+        WriteJoint(ConstantPose.data(), Joint, First);
+
+        bool bRotationAnimated = false;
+        bool bTranslationAnimated = false;
+        bool bScaleAnimated = false;
+        for (uint32 Frame = 1; Frame < FrameCount; ++Frame)
+        {
+            const FJointTransform& Key = GetKey(Frame, Joint);
+            bRotationAnimated |= RotationDifference(First.Rotation, Key.Rotation) > Settings.RotationTolerance;
+            bTranslationAnimated |= VectorDifference(First.Translation, Key.Translation) > Settings.TranslationTolerance;
+            bScaleAnimated |= VectorDifference(First.Scale, Key.Scale) > Settings.ScaleTolerance;
+        }
+
+        if (bRotationAnimated)
+        {
+            AnimatedRotations.push_back(static_cast<uint16>(Joint));
+        }
+        if (bTranslationAnimated)
+        {
+            AnimatedTranslations.push_back(static_cast<uint16>(Joint));
+        }
+        if (bScaleAnimated)
+        {
+            AnimatedScales.push_back(static_cast<uint16>(Joint));
+        }
+    }
+
+    // Quantization ranges of the animated translations, then scales
+    auto AppendRanges = [&](const std::vector<uint16>& Tracks, bool bScale)
+    {
+        for (uint16 Joint : Tracks)
+        {
+            float Min[3];
+            float Max[3];
+            for (int Axis = 0; Axis < 3; ++Axis)
+            {
+                Min[Axis] = Max[Axis] = bScale ? GetKey(0, Joint).Scale[Axis] : GetKey(0, Joint).Translation[Axis];
+            }
+            for (uint32 Frame = 1; Frame < FrameCount; ++Frame)
+            {
+                const float* Value = bScale ? GetKey(Frame, Joint).Scale : GetKey(Frame, Joint).Translation;
+                for (int Axis = 0; Axis < 3; ++Axis)
+                {
+                    Min[Axis] = Value[Axis] < Min[Axis] ? Value[Axis] : Min[Axis];
+                    Max[Axis] = Value[Axis] > Max[Axis] ? Value[Axis] : Max[Axis];
+                }
+            }
+            Ranges.insert(Ranges.end(), Min, Min + 3);
+            for (int Axis = 0; Axis < 3; ++Axis)
+            {
+                Ranges.push_back(Max[Axis] - Min[Axis]);
+            }
+        }
+    };
+    AppendRanges(AnimatedTranslations, false);
+    AppendRanges(AnimatedScales, true);
+
+    FrameStride = GetAnimatedTrackCount() * 3;
+    Keys.resize(size_t(FrameStride) * FrameCount);
+
+    for (uint32 Frame = 0; Frame < FrameCount; ++Frame)
+    {
+        uint16* Words = &Keys[size_t(Frame) * FrameStride];
+        for (uint16 Joint : AnimatedRotations)
+        {
+            float Rotation[4];
+            const float* Source = GetKey(Frame, Joint).Rotation;
+            const float Length = std::sqrt(Source[0] * Source[0] + Source[1] * Source[1] + Source[2] * Source[2] + Source[3] * Source[3]);
+            for (int Component = 0; Component < 4; ++Component)
+            {
+                Rotation[Component] = Length > 0.0f ? Source[Component] / Length : (Component == 3 ? 1.0f : 0.0f);
+            }
+            EncodeRotation(Rotation, Words);
+            Words += 3;
+        }
+
+        const float* Range = Ranges.data();
+        for (uint16 Joint : AnimatedTranslations)
+        {
+            for (int Axis = 0; Axis < 3; ++Axis)
+            {
+                *Words++ = QuantizeUNorm16(GetKey(Frame, Joint).Translation[Axis], Range[Axis], Range[3 + Axis]);
+            }
+            Range += 6;
+        }
+        for (uint16 Joint : AnimatedScales)
+        {
+            for (int Axis = 0; Axis < 3; ++Axis)
+            {
+                *Words++ = QuantizeUNorm16(GetKey(Frame, Joint).Scale[Axis], Range[Axis], Range[3 + Axis]);
+            }
+            Range += 6;
+        }
+    }
+    return true;
+}
+
+void KAnimationClip::Sample(float Time, bool bLoop, KAnimationPose& OutPose) const
+{
+    if (FrameCount == 0)
+    {
+        return;
+    }
+
+    const float Duration = GetDuration();
+    if (bLoop && Duration > 0.0f)
+    {
+        Time = std::fmod(Time, Duration);
+        Time = Time < 0.0f ? Time + Duration : Time;
+    }
+    else
+    {
+        Time = Time < 0.0f ? 0.0f : (Time > Duration ? Duration : Time);
+    }
+
+    const float Position = Time * SampleRate;
+    uint32 Frame = static_cast<uint32>(Position);
+    float Alpha = Position - static_cast<float>(Frame);
+    if (Frame >= FrameCount - 1)
+    {
+        Frame = FrameCount - 1;
+        Alpha = 0.0f;
+    }
+
+    // Constant tracks are copied once; animated ones are interpolated over them
+    OutPose.Initialize(JointCount);
+    FJointTransformSoA* Groups = OutPose.GetData();
+    std::memcpy(Groups, ConstantPose.data(), sizeof(FJointTransformSoA) * ConstantPose.size());
+
+    const uint16* Keys0 = &Keys[size_t(Frame) * FrameStride];
+    const uint16* Keys1 = Alpha > 0.0f ? Keys0 + FrameStride : Keys0;
+    const uint32 RotationCount = static_cast<uint32>(AnimatedRotations.size());
+    const uint32 TranslationCount = static_cast<uint32>(AnimatedTranslations.size());
+    const uint32 TranslationWords = RotationCount * 3;
+    const uint32 ScaleWords = TranslationWords + TranslationCount * 3;
+
+    SampleRotationTracks(AnimatedRotations.data(), RotationCount, Keys0, Keys1, Alpha, Groups);
+    SampleVectorTracks(AnimatedTranslations.data(), TranslationCount, Ranges.data(),
+                       Keys0 + TranslationWords, Keys1 + TranslationWords, Alpha, &FJointTransformSoA::Translation, Groups);
+    SampleVectorTracks(AnimatedScales.data(), static_cast<uint32>(AnimatedScales.size()), Ranges.data() + TranslationCount * 6,
+                       Keys0 + ScaleWords, Keys1 + ScaleWords, Alpha, &FJointTransformSoA::Scale, Groups);
+}
+
+size_t KAnimationClip::GetCompressedSize() const
+{
+    return sizeof(FJointTransformSoA) * ConstantPose.size() +
+           sizeof(uint16) * (AnimatedRotations.size() + AnimatedTranslations.size() + AnimatedScales.size()) +
+           sizeof(float) * Ranges.size() + sizeof(uint16) * Keys.size();
+}
+
+// Pose operations
+
+void Animation::Lerp(const KAnimationPose& A, const KAnimationPose& B, float Alpha, KAnimationPose& OutPose)
+{
+    if (A.GetJointCount() != B.GetJointCount())
+    {
+        return;
+    }
+
+    OutPose.Initialize(A.GetJointCount());
+    const FVector4 Weight = Splat(Alpha);
+
+    const uint32 GroupCount = A.GetSoACount();
+    for (uint32 GroupIndex = 0; GroupIndex < GroupCount; ++GroupIndex)
+    {
+        const FJointTransformSoA& GroupA = A.GetData()[GroupIndex];
+        const FJointTransformSoA& GroupB = B.GetData()[GroupIndex];
+        FJointTransformSoA& Out = OutPose.GetData()[GroupIndex];
+
+        FVector4 RotationA[4];
+        for (int Component = 0; Component < 4; ++Component)
+        {
+            RotationA[Component] = Load(GroupA.Rotation[Component]);
+        }
+        FVector4 RotationB[4];
+        LoadAlignedRotation(GroupB, RotationA, RotationB);
+
+        FVector4 Rotation[4];
+        for (int Component = 0; Component < 4; ++Component)
+        {
+            Rotation[Component] = RotationA[Component] + (RotationB[Component] - RotationA[Component]) * Weight;
+        }
+        StoreNormalizedRotation(Rotation, Out);
+
+        for (int Axis = 0; Axis < 3; ++Axis)
+        {
+            const FVector4 TranslationA = Load(GroupA.Translation[Axis]);
+            const FVector4 ScaleA = Load(GroupA.Scale[Axis]);
+            Store(Out.Translation[Axis], TranslationA + (Load(GroupB.Translation[Axis]) - TranslationA) * Weight);
+            Store(Out.Scale[Axis], ScaleA + (Load(GroupB.Scale[Axis]) - ScaleA) * Weight);
+        }
+    }
+}
+
+void Animation::Accumulate(KAnimationPose& Accumulator, const KAnimationPose& Pose, float Weight, bool bFirst)
+{
+    const FVector4 Weights = Splat(Weight);
+    if (bFirst)
+    {
+        Accumulator.Initialize(Pose.GetJointCount());
+    }
+    else if (Accumulator.GetJointCount() != Pose.GetJointCount())
+    {
+        return;
+    }
+
+    const uint32 GroupCount = Pose.GetSoACount();
+    for (uint32 GroupIndex = 0; GroupIndex < GroupCount; ++GroupIndex)
+    {
+        const FJointTransformSoA& Source = Pose.GetData()[GroupIndex];
+        FJointTransformSoA& Out = Accumulator.GetData()[GroupIndex];
+
+        if (bFirst)
+        {
+            for (int Component = 0; Component < 4; ++Component)
+            {
+                Store(Out.Rotation[Component], Load(Source.Rotation[Component]) * Weights);
+            }
+            for (int Axis = 0; Axis < 3; ++Axis)
+            {
+                Store(Out.Translation[Axis], Load(Source.Translation[Axis]) * Weights);
+                Store(Out.Scale[Axis], Load(Source.Scale[Axis]) * Weights);
+            }
+            continue;
+        }
+
+        FVector4 Sum[4];
+        for (int Component = 0; Component < 4; ++Component)
+        {
+            Sum[Component] = Load(Out.Rotation[Component]);
+        }
+        FVector4 Rotation[4];
+        LoadAlignedRotation(Source, Sum, Rotation);
+        for (int Component = 0; Component < 4; ++Component)
+        {
+            Store(Out.Rotation[Component], Sum[Component] + Rotation[Component] * Weights);
+        }
+        for (int Axis = 0; Axis < 3; ++Axis)
+        {
+            Store(Out.Translation[Axis], Load(Out.Translation[Axis]) + Load(Source.Translation[Axis]) * Weights);
+            Store(Out.Scale[Axis], Load(Out.Scale[Axis]) + Load(Source.Scale[Axis]) * Weights);
+        }
+    }
+}
+
+void Animation::NormalizeAccumulated(KAnimationPose& Accumulator, float TotalWeight)
+{
+    const FVector4 InvWeight = Splat(1.0f / TotalWeight);
+
+    const uint32 GroupCount = Accumulator.GetSoACount();
+    for (uint32 GroupIndex = 0; GroupIndex < GroupCount; ++GroupIndex)
+    {
+        FJointTransformSoA& Group = Accumulator.GetData()[GroupIndex];
+
+        FVector4 Rotation[4];
+        for (int Component = 0; Component < 4; ++Component)
+        {
+            Rotation[Component] = Load(Group.Rotation[Component]);
+        }
+        StoreNormalizedRotation(Rotation, Group);
+
+        for (int Axis = 0; Axis < 3; ++Axis)
+        {
+            Store(Group.Translation[Axis], Load(Group.Translation[Axis]) * InvWeight);
+            Store(Group.Scale[Axis], Load(Group.Scale[Axis]) * InvWeight);
+        }
+    }
+}
+
+void Animation::ComputeModelMatrices(const KSkeleton& Skeleton, const KAnimationPose& Pose, float* OutMatrices)
+{
+    const uint32 JointCount = Skeleton.GetJointCount();
+    const FVector4 Zero = Splat(0.0f);
+    const FVector4 One = Splat(1.0f);
+
+    // Local matrices (scale, rotate, translate), four joints at a time
+    for (uint32 GroupIndex = 0; GroupIndex * SoAWidth < JointCount; ++GroupIndex)
+    {
+        const FJointTransformSoA& Group = Pose.GetData()[GroupIndex];
+        const FVector4 X = Load(Group.Rotation[0]);
+        const FVector4 Y = Load(Group.Rotation[1]);
+        const FVector4 Z = Load(Group.Rotation[2]);
+        const FVector4 W = Load(Group.Rotation[3]);
+
+        const FVector4 X2 = X + X;
+        const FVector4 Y2 = Y + Y;
+        const FVector4 Z2 = Z + Z;
+        const FVector4 XX = X * X2;
+        const FVector4 YY = Y * Y2;
+        const FVector4 ZZ = Z * Z2;
+        const FVector4 XY = X * Y2;
+        const FVector4 XZ = X * Z2;
+        const FVector4 YZ = Y * Z2;
+        const FVector4 WX = W * X2;
+        const FVector4 WY = W * Y2;
+        const FVector4 WZ = W * Z2;
+
+        const FVector4 ScaleX = Load(Group.Scale[0]);
+        const FVector4 ScaleY = Load(Group.Scale[1]);
+        const FVector4 ScaleZ = Load(Group.Scale[2]);
+
+        // Rows[Row][Lane] after the transposes
+        FVector4 Rows[4][4] =
+        {
+            { (One - (YY + ZZ)) * ScaleX, (XY + WZ) * ScaleX, (XZ - WY) * ScaleX, Zero },
+            { (XY - WZ) * ScaleY, (One - (XX + ZZ)) * ScaleY, (YZ + WX) * ScaleY, Zero },
+            { (XZ + WY) * ScaleZ, (YZ - WX) * ScaleZ, (One - (XX + YY)) * ScaleZ, Zero },
+            { Load(Group.Translation[0]), Load(Group.Translation[1]), Load(Group.Translation[2]), One },
+        };
+        for (int Row = 0; Row < 4; ++Row)
+        {
+            Transpose(Rows[Row][0], Rows[Row][1], Rows[Row][2], Rows[Row][3]);
+        }
+
+        const uint32 LaneCount = JointCount - GroupIndex * SoAWidth < SoAWidth ? JointCount - GroupIndex * SoAWidth : SoAWidth;
+        for (uint32 Lane = 0; Lane < LaneCount; ++Lane)
+        {
+            float* Matrix = OutMatrices + size_t(GroupIndex * SoAWidth + Lane) * 16;
+            for (int Row = 0; Row < 4; ++Row)
+            {
+                StoreUnaligned(Matrix + Row * 4, Rows[Row][Lane]);
+            }
+        }
+    }
+
+    // Parents precede their children, so each parent is already in model space
+    for (uint32 Joint = 0; Joint < JointCount; ++Joint)
+    {
+        const int32 Parent = Skeleton.GetParent(Joint);
+        if (Parent >= 0)
+        {
+            float* Matrix = OutMatrices + size_t(Joint) * 16;
+            FVector4 Rows[4];
+            MultiplyRows(Matrix, OutMatrices + size_t(Parent) * 16, Rows);
+            for (int Row = 0; Row < 4; ++Row)
+            {
+                StoreUnaligned(Matrix + Row * 4, Rows[Row]);
+            }
+        }
+    }
+}
+
+void Animation::ComputeSkinningPalette(const KSkeleton& Skeleton, const float* ModelMatrices, FSkinMatrix* OutPalette)
+{
+    const uint32 JointCount = Skeleton.GetJointCount();
+    for (uint32 Joint = 0; Joint < JointCount; ++Joint)
+    {
+        FVector4 Rows[4];
+        MultiplyRows(Skeleton.GetInverseBindMatrix(Joint), ModelMatrices + size_t(Joint) * 16, Rows);
+
+        // Columns of the skinning matrix become the rows read by the shader
+        Transpose(Rows[0], Rows[1], Rows[2], Rows[3]);
+        for (int Row = 0; Row < 3; ++Row)
+        {
+            StoreUnaligned(OutPalette[Joint].Rows[Row], Rows[Row]);
+        }
+    }
+}
+
+// KAnimationEvaluator
+
+void KAnimationEvaluator::Evaluate(const FAnimationInstance* Instances, uint32 Count, KJobSystem* JobSystem)
+{
+    KE_PROFILE_FUNCTION();
+
+    if (!Instances || Count == 0)
+    {
+        return;
+    }
+
+    const uint32 ThreadCount = JobSystem ? JobSystem->GetThreadCount() : 1;
+    if (Scratch.size() < ThreadCount)
+    {
+        Scratch.resize(ThreadCount);
+    }
+
+    if (ThreadCount == 1 || Count == 1)
+    {
+        for (uint32 Index = 0; Index < Count; ++Index)
+        {
+            EvaluateInstance(Instances[Index], Scratch[0]);
+        }
+        return;
+    }
+
+    // Batches keep the per-task overhead small next to a character's evaluation
+    const uint32 MaxBatches = ThreadCount * BatchesPerThread;
+    const uint32 BatchCount = Count < MaxBatches ? Count : MaxBatches;
+    const uint32 BatchSize = (Count + BatchCount - 1) / BatchCount;
+    JobSystem->ParallelFor((Count + BatchSize - 1) / BatchSize, [&](uint32 Batch, uint32 WorkerIndex)
+    {
+        const uint32 Begin = Batch * BatchSize;
+        const uint32 End = Begin + BatchSize < Count ? Begin + BatchSize : Count;
+        for (uint32 Index = Begin; Index < End; ++Index)
+        {
+            EvaluateInstance(Instances[Index], Scratch[WorkerIndex]);
+        }
+    });
+}
+
+void KAnimationEvaluator::EvaluateInstance(const FAnimationInstance& Instance, FScratch& InScratch) const
+{
+    if (!Instance.Skeleton || !Instance.Palette)
+    {
+        return;
+    }
+
+    const KSkeleton& Skeleton = *Instance.Skeleton;
+    const uint32 JointCount = Skeleton.GetJointCount();
+
+    // Layers whose clip matches the skeleton
+    float TotalWeight = 0.0f;
+    uint32 ActiveCount = 0;
+    const FAnimationLayer* LastActive = nullptr;
+    for (uint32 Index = 0; Instance.Layers && Index < Instance.LayerCount; ++Index)
+    {
+        const FAnimationLayer& Layer = Instance.Layers[Index];
+        if (Layer.Clip && Layer.Weight > 0.0f && Layer.Clip->GetJointCount() == JointCount)
+        {
+            TotalWeight += Layer.Weight;
+            LastActive = &Layer;
+            ++ActiveCount;
+        }
+    }
+
+    KAnimationPose& Pose = InScratch.Pose;
+    if (ActiveCount == 0)
+    {
+        Pose.SetBindPose(Skeleton);
+    }
+    else if (ActiveCount == 1)
+    {
+        LastActive->Clip->Sample(LastActive->Time, LastActive->bLoop, Pose);
+    }
+    else
+    {
+        bool bFirst = true;
+        for (uint32 Index = 0; Index < Instance.LayerCount; ++Index)
+        {
+            const FAnimationLayer& Layer = Instance.Layers[Index];
+            if (Layer.Clip && Layer.Weight > 0.0f && Layer.Clip->GetJointCount() == JointCount)
+            {
+                Layer.Clip->Sample(Layer.Time, Layer.bLoop, InScratch.Sample);
+                Animation::Accumulate(Pose, InScratch.Sample, Layer.Weight, bFirst);
+                bFirst = false;
+            }
+        }
+        Animation::NormalizeAccumulated(Pose, TotalWeight);
+    }
+
+    float* ModelMatrices = Instance.ModelMatrices;
+    if (!ModelMatrices)
+    {
+        InScratch.ModelMatrices.resize(size_t(JointCount) * 16);
+        ModelMatrices = InScratch.ModelMatrices.data();
+    }
+
+    Animation::ComputeModelMatrices(Skeleton, Pose, ModelMatrices);
+    Animation::ComputeSkinningPalette(Skeleton, ModelMatrices, Instance.Palette);
+}
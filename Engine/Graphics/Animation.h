@@ -0,0 +1,319 @@
+﻿#pragma once
+
+#include <string>
+#include <vector>
+#include "../Utils/Types.h"
+
+class KJobSystem;
+
+// Skeletons, compressed animation clips, pose blending and skinning palettes.
+// Platform independent. Poses are stored as structure of arrays, four joints
+// per group, and sampled, blended and converted to matrices four joints at a
+// time with SSE (scalar on other targets). Matrices are row-major with row
+// vectors, like Bounds.h.
+
+namespace Animation
+{
+    /**
+     * @brief Joints per skeleton (skinned vertices store 8-bit joint indices)
+     */
+    constexpr uint32 MaxJoints = 256;
+
+    /**
+     * @brief Joints per SoA group
+     */
+    constexpr uint32 SoAWidth = 4;
+
+    inline uint32 GetSoACount(uint32 JointCount) { return (JointCount + SoAWidth - 1) / SoAWidth; }
+}
+
+/**
+ * @brief Local transform of one joint
+ */
+struct FJointTransform
+{
+    float Rotation[4] = { 0.0f, 0.0f, 0.0f, 1.0f };    // Unit quaternion (XYZW)
+    float Translation[3] = { 0.0f, 0.0f, 0.0f };
+    float Scale[3] = { 1.0f, 1.0f, 1.0f };
+};
+
+/**
+ * @brief Local transforms of four joints, one per lane ([Component][Lane])
+ */
+struct alignas(16) FJointTransformSoA
+{
+    float Rotation[4][4];
+    float Translation[3][4];
+    float Scale[3][4];
+};
+
+/**
+ * @brief Skinning matrix of one joint
+ *
+ * Rows of the transposed 4x3 matrix (inverse bind matrix times model matrix),
+ * so a shader skins a position with three dot products against float4(P, 1).
+ */
+struct FSkinMatrix
+{
+    float Rows[3][4];
+};
+
+/**
+ * @brief Joint description for KSkeleton::Initialize
+ */
+struct FSkeletonJoint
+{
+    std::string Name;
+    int32 Parent = -1;                  // Parent joint index (parents precede children), -1 for roots
+    FJointTransform BindPose;           // Local transform at bind time
+    float InverseBindMatrix[16] = { 1.0f, 0.0f, 0.0f, 0.0f,
+                                    0.0f, 1.0f, 0.0f, 0.0f,
+                                    0.0f, 0.0f, 1.0f, 0.0f,
+                                    0.0f, 0.0f, 0.0f, 1.0f };
+};
+
+/**
+ * @brief Joint hierarchy, bind pose and inverse bind matrices
+ */
+class KSkeleton
+{
+public:
+    KSkeleton() = default;
+
+    /**
+     * @brief Build the skeleton
+     * @param Joints Joints, parents before their children
+     * @param JointCount Number of joints (1 to Animation::MaxJoints)
+     * @param bComputeInverseBindMatrices Derive the inverse bind matrices from the bind pose
+     *                                    instead of using FSkeletonJoint::InverseBindMatrix
+     * @return false if the count is out of range or a parent does not precede its child
+     */
+    bool Initialize(const FSkeletonJoint* Joints, uint32 JointCount, bool bComputeInverseBindMatrices = false);
+
+    uint32 GetJointCount() const { return static_cast<uint32>(Parents.size()); }
+    int32 GetParent(uint32 Joint) const { return Parents[Joint]; }
+    const std::string& GetJointName(uint32 Joint) const { return Names[Joint]; }
+
+    /**
+     * @brief Index of a joint by name, -1 if not found
+     */
+    int32 FindJoint(const std::string& Name) const;
+
+    const FJointTransformSoA* GetBindPose() const { return BindPose.data(); }
+    const float* GetInverseBindMatrix(uint32 Joint) const { return &InverseBindMatrices[Joint * 16]; }
+
+private:
+    std::vector<std::string> Names;
+    std::vector<int16> Parents;
+    std::vector<FJointTransformSoA> BindPose;   // Padding lanes hold identity transforms
+    std::vector<float> InverseBindMatrices;     // 16 per joint
+};
+
+/**
+ * @brief Local joint transforms of a skeleton, in SoA groups
+ */
+class KAnimationPose
+{
+public:
+    KAnimationPose() = default;
+
+    /**
+     * @brief Size the pose for a joint count (contents are undefined until written)
+     */
+    void Initialize(uint32 InJointCount);
+
+    /**
+     * @brief Copy the bind pose of a skeleton
+     */
+    void SetBindPose(const KSkeleton& Skeleton);
+
+    uint32 GetJointCount() const { return JointCount; }
+    uint32 GetSoACount() const { return static_cast<uint32>(Groups.size()); }
+    FJointTransformSoA* GetData() { return Groups.data(); }
+    const FJointTransformSoA* GetData() const { return Groups.data(); }
+
+    void GetJoint(uint32 Joint, FJointTransform& OutTransform) const;
+    void SetJoint(uint32 Joint, const FJointTransform& Transform);
+
+private:
+    std::vector<FJointTransformSoA> Groups;
+    uint32 JointCount = 0;
+};
+
+/**
+ * @brief Uniformly sampled source animation
+ */
+struct FRawAnimationClip
+{
+    std::string Name;
+    float SampleRate = 30.0f;           // Frames per second
+    uint32 FrameCount = 0;              // Duration is (FrameCount - 1) / SampleRate
+    uint32 JointCount = 0;
+    std::vector<FJointTransform> Frames;    // FrameCount * JointCount, frame by frame
+};
+
+/**
+ * @brief Limits under which a track is stored as a constant
+ */
+struct FAnimationCompressionSettings
+{
+    float RotationTolerance = 1.0e-4f;      // Quaternion component difference
+    float TranslationTolerance = 1.0e-4f;   // Distance per axis
+    float ScaleTolerance = 1.0e-4f;
+};
+
+/**
+ * @brief Compressed animation clip
+ *
+ * Tracks that do not move are stored once in full precision. Animated
+ * rotations are stored as the smallest three quaternion components (15 bits
+ * each) and animated translations and scales as 16 bits per axis within the
+ * track's range. Keys of all animated tracks of a frame are contiguous, so a
+ * sample reads two short runs of memory, and animated tracks are interpolated
+ * four at a time before they are scattered to their joints.
+ */
+class KAnimationClip
+{
+public:
+    KAnimationClip() = default;
+
+    /**
+     * @brief Compress a raw clip
+     * @return false if the clip has no frames or joints, or the frame array is too short
+     */
+    bool Compress(const FRawAnimationClip& Raw, const FAnimationCompressionSettings& Settings = FAnimationCompressionSettings());
+
+    /**
+     * @brief Sample the clip
+     * @param Time Time in seconds (wrapped when looping, clamped otherwise)
+     * @param bLoop Wrap the time around the duration
+     * @param OutPose Receives the local joint transforms (sized to the clip)
+     */
+    void Sample(float Time, bool bLoop, KAnimationPose& OutPose) const;
+
+    const std::string& GetName() const { return Name; }
+    float GetDuration() const { return FrameCount > 1 ? static_cast<float>(FrameCount - 1) / SampleRate : 0.0f; }
+    uint32 GetFrameCount() const { return FrameCount; }
+    uint32 GetJointCount() const { return JointCount; }
+
+    /**
+     * @brief Animated tracks (rotation, translation and scale tracks counted separately)
+     */
+    uint32 GetAnimatedTrackCount() const
+    {
+        return static_cast<uint32>(AnimatedRotations.size() + AnimatedTranslations.size() + AnimatedScales.size());
+    }
+
+    /**
+     * @brief Bytes of keys and track data
+     */
+    size_t GetCompressedSize() const;
+
+private:
+    std::string Name;
+    float SampleRate = 30.0f;
+    uint32 FrameCount = 0;
+    uint32 JointCount = 0;
+
+    std::vector<FJointTransformSoA> ConstantPose;   // Every track's first key
+    std::vector<uint16> AnimatedRotations;          // Joint indices of animated tracks
+    std::vector<uint16> AnimatedTranslations;
+    std::vector<uint16> AnimatedScales;
+    std::vector<float> Ranges;                      // Min and extent (6 floats) per animated translation, then scale
+    std::vector<uint16> Keys;                       // Per frame: 3 words per animated track
+    uint32 FrameStride = 0;                         // Words per frame
+};
+
+namespace Animation
+{
+    /**
+     * @brief Interpolate two poses of the same joint count (normalized quaternion lerp along the shortest arc)
+     */
+    void Lerp(const KAnimationPose& A, const KAnimationPose& B, float Alpha, KAnimationPose& OutPose);
+
+    /**
+     * @brief Add a weighted pose to an accumulator
+     *
+     * Rotations are flipped into the accumulator's hemisphere. Poses must
+     * have the joint count of the first one. Call NormalizeAccumulated once
+     * every pose is added.
+     * @param bFirst Overwrite the accumulator instead of adding
+     */
+    void Accumulate(KAnimationPose& Accumulator, const KAnimationPose& Pose, float Weight, bool bFirst);
+
+    /**
+     * @brief Turn an accumulator into a pose
+     * @param TotalWeight Sum of the accumulated weights (greater than zero)
+     */
+    void NormalizeAccumulated(KAnimationPose& Accumulator, float TotalWeight);
+
+    /**
+     * @brief Model-space matrices of every joint
+     * @param OutMatrices 16 floats per joint
+     */
+    void ComputeModelMatrices(const KSkeleton& Skeleton, const KAnimationPose& Pose, float* OutMatrices);
+
+    /**
+     * @brief Skinning matrices from model-space matrices
+     */
+    void ComputeSkinningPalette(const KSkeleton& Skeleton, const float* ModelMatrices, FSkinMatrix* OutPalette);
+}
+
+/**
+ * @brief Clip played by an animation instance
+ */
+struct FAnimationLayer
+{
+    const KAnimationClip* Clip = nullptr;
+    float Time = 0.0f;
+    float Weight = 1.0f;
+    bool bLoop = true;
+};
+
+/**
+ * @brief One animated character for KAnimationEvaluator
+ */
+struct FAnimationInstance
+{
+    const KSkeleton* Skeleton = nullptr;
+    const FAnimationLayer* Layers = nullptr;    // Blended by weight; the bind pose if no layer has weight
+    uint32 LayerCount = 0;
+    FSkinMatrix* Palette = nullptr;             // Receives one matrix per joint
+    float* ModelMatrices = nullptr;             // Optional: receives 16 floats per joint (attachments, debug draw)
+};
+
+/**
+ * @brief Evaluates many animation instances in parallel
+ *
+ * Instances are split into batches across the job system; every thread
+ * samples, blends and builds palettes in its own scratch poses, so nothing is
+ * allocated once the scratch has grown to the largest skeleton.
+ */
+class KAnimationEvaluator
+{
+public:
+    KAnimationEvaluator() = default;
+
+    // Prevent copying
+    KAnimationEvaluator(const KAnimationEvaluator&) = delete;
+    KAnimationEvaluator& operator=(const KAnimationEvaluator&) = delete;
+
+    /**
+     * @brief Evaluate instances into their palettes
+     * @param JobSystem Worker pool, nullptr for the calling thread
+     */
+    void Evaluate(const FAnimationInstance* Instances, uint32 Count, KJobSystem* JobSystem = nullptr);
+
+private:
+    struct FScratch
+    {
+        KAnimationPose Pose;
+        KAnimationPose Sample;
+        std::vector<float> ModelMatrices;
+    };
+
+    void EvaluateInstance(const FAnimationInstance& Instance, FScratch& Scratch) const;
+
+private:
+    std::vector<FScratch> Scratch;  // One per job system thread
+};
@@ -1,5 +1,7 @@
 ﻿#include "Camera.h"
 
+#include <cmath>
+
 KCamera::KCamera()
     : Position(0.0f, 0.0f, 0.0f)
     , Rotation(0.0f, 0.0f, 0.0f)
@@ -20,6 +22,13 @@ KCamera::KCamera()
     ProjectionMatrix = XMMatrixIdentity();
 }
 
+void KCamera::SetFrustumSlices(uint32 InSliceCount, float LogarithmicBlend)
+{
+    SliceCount = InSliceCount < 1 ? 1 : (InSliceCount > MaxFrustumSlices ? MaxFrustumSlices : InSliceCount);
+    SliceLogarithmicBlend = LogarithmicBlend < 0.0f ? 0.0f : (LogarithmicBlend > 1.0f ? 1.0f : LogarithmicBlend);
+    bSlicesValid.store(false, std::memory_order_release);
+}
+
 void KCamera::SetPosition(const XMFLOAT3& InPosition)
 {
     Position = InPosition;
@@ -89,6 +98,11 @@ void KCamera::SetOrthographic(float Width, float Height, float InNearZ, float In
 
 void KCamera::UpdateMatrices()
 {
+    if (bViewMatrixDirty || bProjectionMatrixDirty)
+    {
+        InvalidateDerivedData();
+    }
+
     if (bViewMatrixDirty)
     {
         XMVECTOR PositionVec = XMLoadFloat3(&Position);
@@ -115,6 +129,121 @@ void KCamera::UpdateMatrices()
     }
 }
 
+const FCameraFrustumSlice& KCamera::GetFrustumSlice(uint32 Index) const
+{
+    UpdateSlices();
+    return Slices[Index < SliceCount ? Index : SliceCount - 1];
+}
+
+void KCamera::InvalidateDerivedData()
+{
+    bDerivedDataValid.store(false, std::memory_order_release);
+    bSlicesValid.store(false, std::memory_order_release);
+}
+
+void KCamera::UpdateDerivedData() const
+{
+    if (bDerivedDataValid.load(std::memory_order_acquire))
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> Lock(DerivedDataMutex);
+    if (bDerivedDataValid.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    DerivedData.ViewProjectionMatrix = XMMatrixMultiply(ViewMatrix, ProjectionMatrix);
+    DerivedData.InverseViewProjectionMatrix = XMMatrixInverse(nullptr, DerivedData.ViewProjectionMatrix);
+
+    XMFLOAT4X4 ViewProjection;
+    XMFLOAT4X4 InverseViewProjection;
+    XMStoreFloat4x4(&ViewProjection, DerivedData.ViewProjectionMatrix);
+    XMStoreFloat4x4(&InverseViewProjection, DerivedData.InverseViewProjectionMatrix);
+
+    Bounds::ExtractFrustumPlanes(&ViewProjection.m[0][0], DerivedData.Frustum);
+    Bounds::ToSoA(DerivedData.Frustum, DerivedData.PlanesSoA);
+    Bounds::ComputeFrustumCorners(&InverseViewProjection.m[0][0], DerivedData.Corners);
+
+    bDerivedDataValid.store(true, std::memory_order_release);
+}
+
+void KCamera::UpdateSlices() const
+{
+    if (bSlicesValid.load(std::memory_order_acquire))
+    {
+        return;
+    }
+
+    // Slices are cut from the cached corners
+    UpdateDerivedData();
+
+    std::lock_guard<std::mutex> Lock(DerivedDataMutex);
+    if (bSlicesValid.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    // View direction of the view matrix (third column)
+    XMFLOAT4X4 View;
+    XMStoreFloat4x4(&View, ViewMatrix);
+    const float Direction[3] = { View.m[0][2], View.m[1][2], View.m[2][2] };
+    const float Origin = -View.m[3][2];    // Dot(Direction, camera position)
+
+    const FFrustumCorners& Corners = DerivedData.Corners;
+    const float DepthRange = FarZ - NearZ;
+    for (uint32 Slice = 0; Slice < SliceCount; ++Slice)
+    {
+        // Practical split scheme: blend of uniform and logarithmic split depths
+        float SplitDepths[2];
+        for (uint32 End = 0; End < 2; ++End)
+        {
+            const float Fraction = static_cast<float>(Slice + End) / static_cast<float>(SliceCount);
+            const float Uniform = NearZ + DepthRange * Fraction;
+            const float Logarithmic = NearZ > 0.0f ? NearZ * std::pow(FarZ / NearZ, Fraction) : Uniform;
+            SplitDepths[End] = Uniform + (Logarithmic - Uniform) * SliceLogarithmicBlend;
+        }
+        SplitDepths[0] = Slice == 0 ? NearZ : SplitDepths[0];
+        SplitDepths[1] = Slice + 1 == SliceCount ? FarZ : SplitDepths[1];
+
+        FCameraFrustumSlice& Out = Slices[Slice];
+        Out.NearZ = SplitDepths[0];
+        Out.FarZ = SplitDepths[1];
+
+        // View depth is linear along the corner edges, for both projections
+        for (uint32 End = 0; End < 2; ++End)
+        {
+            const float T = DepthRange > 0.0f ? (SplitDepths[End] - NearZ) / DepthRange : 0.0f;
+            for (uint32 Corner = 0; Corner < 4; ++Corner)
+            {
+                const float* Near = Corners.Points[Corner];
+                const float* Far = Corners.Points[Corner | 4];
+                float* Point = Out.Corners.Points[Corner | (End << 2)];
+                Point[0] = Near[0] + (Far[0] - Near[0]) * T;
+                Point[1] = Near[1] + (Far[1] - Near[1]) * T;
+                Point[2] = Near[2] + (Far[2] - Near[2]) * T;
+            }
+        }
+
+        // Side planes of the camera, near/far facing inside at the split depths
+        Out.Frustum = DerivedData.Frustum;
+        FPlane& NearPlane = Out.Frustum.Planes[4];
+        FPlane& FarPlane = Out.Frustum.Planes[5];
+        for (uint32 Axis = 0; Axis < 3; ++Axis)
+        {
+            NearPlane.Normal[Axis] = Direction[Axis];
+            FarPlane.Normal[Axis] = -Direction[Axis];
+        }
+        NearPlane.Distance = -(Origin + Out.NearZ);
+        FarPlane.Distance = Origin + Out.FarZ;
+
+        Out.Sphere = Bounds::ComputeSphere(&Out.Corners.Points[0][0], FFrustumCorners::CornerCount, sizeof(float) * 3);
+    }
+
+    bSlicesValid.store(true, std::memory_order_release);
+}
+
 void KCamera::Move(const XMFLOAT3& Offset)
 {
     XMVECTOR PositionVec = XMLoadFloat3(&Position);
@@ -1,6 +1,12 @@
 ﻿#pragma once
 
-#include "../Utils/Common.h"
+// DirectXMath only (no Windows headers), so the camera also builds off Windows
+#include <DirectXMath.h>
+#include <atomic>
+#include <mutex>
+#include "../Utils/Bounds.h"
+
+using namespace DirectX;
 
 /**
  * @brief 3D Camera class
@@ -14,12 +20,30 @@ enum class ECameraProjectionType
     Orthographic
 };
 
+/**
+ * @brief Depth slice of the camera frustum (shadow cascades, clustered lighting)
+ */
+struct FCameraFrustumSlice
+{
+    float NearZ = 0.0f;          // View-space depth range
+    float FarZ = 0.0f;
+    FFrustum Frustum;            // Side planes of the camera, near/far at the slice depths
+    FFrustumCorners Corners;
+    FBoundingSphere Sphere;      // Encloses the corners
+};
+
 class KCamera
 {
 public:
+    static constexpr uint32 MaxFrustumSlices = 8;
+
     KCamera();
     ~KCamera() = default;
 
+    // Copy prevention (the derived data cache owns a mutex)
+    KCamera(const KCamera&) = delete;
+    KCamera& operator=(const KCamera&) = delete;
+
     /**
      * @brief Set camera position
      * @param InPosition Camera position
@@ -59,9 +83,19 @@ public:
      */
     void SetOrthographic(float Width, float Height, float NearZ, float FarZ);
 
+    /**
+     * @brief Split the view depth range into slices (see GetFrustumSlice)
+     * @param SliceCount Number of slices (1 - MaxFrustumSlices)
+     * @param LogarithmicBlend 0 for uniform splits, 1 for logarithmic, in between blends both
+     */
+    void SetFrustumSlices(uint32 SliceCount, float LogarithmicBlend = 0.5f);
+
     /**
      * @brief Update camera matrices
      * Must be called when position or rotation is changed
+     *
+     * Invalidates the derived data (view-projection, inverse, frustum, slices)
+     * when a matrix changed; it is rebuilt on the next query.
      */
     void UpdateMatrices();
 
@@ -80,6 +114,36 @@ public:
     // Accessors
     const XMMATRIX& GetViewMatrix() const { return ViewMatrix; }
     const XMMATRIX& GetProjectionMatrix() const { return ProjectionMatrix; }
+
+    /**
+     * @brief Derived data of the matrices as of the last UpdateMatrices
+     *
+     * Computed on the first query and cached. Queries may run concurrently
+     * (for example from culling jobs), but not concurrently with UpdateMatrices.
+     */
+    const XMMATRIX& GetViewProjectionMatrix() const { UpdateDerivedData(); return DerivedData.ViewProjectionMatrix; }
+    const XMMATRIX& GetInverseViewProjectionMatrix() const { UpdateDerivedData(); return DerivedData.InverseViewProjectionMatrix; }
+
+    /**
+     * @brief World-space frustum planes extracted from ViewMatrix * ProjectionMatrix
+     */
+    const FFrustum& GetFrustum() const { UpdateDerivedData(); return DerivedData.Frustum; }
+
+    /**
+     * @brief GetFrustum transposed into component arrays
+     */
+    const FFrustumPlanesSoA& GetFrustumPlanesSoA() const { UpdateDerivedData(); return DerivedData.PlanesSoA; }
+
+    /**
+     * @brief World-space frustum corners (index bit 0 = right, bit 1 = top, bit 2 = far)
+     */
+    const FFrustumCorners& GetFrustumCorners() const { UpdateDerivedData(); return DerivedData.Corners; }
+
+    /**
+     * @brief Depth slice of the frustum (SetFrustumSlices), clamped to the slice count
+     */
+    const FCameraFrustumSlice& GetFrustumSlice(uint32 Index) const;
+    uint32 GetFrustumSliceCount() const { return SliceCount; }
     
     const XMFLOAT3& GetPosition() const { return Position; }
     const XMFLOAT3& GetRotation() const { return Rotation; }
@@ -102,6 +166,17 @@ private:
      */
     void UpdateVectors();
 
+    /**
+     * @brief Rebuild the derived data / slices if invalidated (double-checked)
+     */
+    void UpdateDerivedData() const;
+    void UpdateSlices() const;
+
+    /**
+     * @brief Drop the derived data after a matrix change
+     */
+    void InvalidateDerivedData();
+
 private:
     // Camera transform
     XMFLOAT3 Position;       // Position
@@ -128,4 +203,23 @@ private:
     // Flags
     bool bViewMatrixDirty;   // Whether view matrix needs update
     bool bProjectionMatrixDirty; // Whether projection matrix needs update
+
+    // Data derived from ViewMatrix / ProjectionMatrix, rebuilt lazily
+    struct FDerivedData
+    {
+        XMMATRIX ViewProjectionMatrix;
+        XMMATRIX InverseViewProjectionMatrix;
+        FFrustum Frustum;
+        FFrustumPlanesSoA PlanesSoA;
+        FFrustumCorners Corners;
+    };
+    mutable FDerivedData DerivedData;
+    mutable FCameraFrustumSlice Slices[MaxFrustumSlices];
+    mutable std::atomic<bool> bDerivedDataValid{ false };
+    mutable std::atomic<bool> bSlicesValid{ false };
+    mutable std::mutex DerivedDataMutex;
+
+    // Slice settings
+    uint32 SliceCount = 1;
+    float SliceLogarithmicBlend = 0.5f;
 }; 
\ No newline at end of file
@@ -0,0 +1,145 @@
+﻿#include "ConstantBufferAllocator.h"
+#include <cstring>
+
+HRESULT KConstantBufferAllocator::Initialize(IRHIDevice* Device, UINT32 SizeInBytes)
+{
+    if (!Device)
+    {
+        return E_INVALIDARG;
+    }
+
+    // Binding by offset and no-overwrite maps on constant buffers need D3D 11.1
+    if (!Device->SupportsConstantBufferRanges())
+    {
+        LOG_ERROR("Constant buffer offsetting is not supported by this device");
+        return E_NOTIMPL;
+    }
+
+    SizeInBytes = (SizeInBytes + Alignment - 1) & ~(Alignment - 1);
+
+    FRHIBufferDesc BufferDesc;
+    BufferDesc.Usage = ERHIBufferUsage::Dynamic;
+    BufferDesc.ByteWidth = SizeInBytes;
+    BufferDesc.BindFlags = RHIBindFlags::ConstantBuffer;
+
+    Buffer.Reset(Device, Device->CreateBuffer(BufferDesc, nullptr));
+    if (!Buffer)
+    {
+        LOG_ERROR("Constant ring buffer creation failed");
+        return E_FAIL;
+    }
+
+    for (FRHIResourceRef& Fence : FrameFences)
+    {
+        Fence.Reset(Device, Device->CreateFence());
+        if (!Fence)
+        {
+            LOG_ERROR("Frame fence creation failed");
+            return E_FAIL;
+        }
+    }
+
+    Ring.Initialize(SizeInBytes);
+    CurrentFence = 1;
+    CompletedFence = 0;
+    bNeedsDiscard = true;
+    DiscardCount = 0;
+
+    LOG_INFO("Constant buffer allocator initialized, size: " + std::to_string(SizeInBytes));
+    return S_OK;
+}
+
+void KConstantBufferAllocator::BeginFrame(IRHICommandContext& Context)
+{
+    Ring.RetireFrames(PollCompletedFence(Context, false));
+}
+
+void KConstantBufferAllocator::EndFrame(IRHICommandContext& Context)
+{
+    if (!Buffer)
+    {
+        return;
+    }
+
+    // The fence slot is reused every MaxFramesInFlight frames; make sure it is free
+    if (CurrentFence > CompletedFence + MaxFramesInFlight)
+    {
+        PollCompletedFence(Context, true);
+    }
+
+    Context.SignalFence(FrameFences[CurrentFence % MaxFramesInFlight].Get());
+    Ring.FinishFrame(CurrentFence);
+    ++CurrentFence;
+}
+
+bool KConstantBufferAllocator::Upload(IRHICommandContext& Context, const void* Data, UINT32 Size,
+                                      FConstantBufferAllocation& OutAllocation)
+{
+    if (!Buffer || !Data || Size == 0)
+    {
+        return false;
+    }
+
+    const UINT32 AlignedSize = (Size + Alignment - 1) & ~(Alignment - 1);
+
+    uint64 Offset = Ring.Allocate(AlignedSize, Alignment);
+    if (Offset == KFrameRingAllocator::InvalidOffset)
+    {
+        // GPU is too far behind: rename the buffer and start over
+        Ring.Reset();
+        bNeedsDiscard = true;
+        ++DiscardCount;
+
+        Offset = Ring.Allocate(AlignedSize, Alignment);
+        if (Offset == KFrameRingAllocator::InvalidOffset)
+        {
+            LOG_ERROR("Constant data does not fit in the constant ring buffer");
+            return false;
+        }
+    }
+
+    void* Mapped = Context.Map(Buffer.Get(), bNeedsDiscard ? ERHIMapMode::WriteDiscard : ERHIMapMode::WriteNoOverwrite);
+    if (!Mapped)
+    {
+        LOG_ERROR("Constant ring buffer map failed");
+        return false;
+    }
+
+    std::memcpy(static_cast<uint8*>(Mapped) + Offset, Data, Size);
+    Context.Unmap(Buffer.Get());
+    bNeedsDiscard = false;
+
+    OutAllocation.Buffer = Buffer.Get();
+    OutAllocation.FirstConstant = static_cast<UINT32>(Offset / 16);
+    OutAllocation.NumConstants = AlignedSize / 16;
+    return true;
+}
+
+void KConstantBufferAllocator::Cleanup()
+{
+    for (FRHIResourceRef& Fence : FrameFences)
+    {
+        Fence.Reset();
+    }
+    Buffer.Reset();
+    Ring.Initialize(0);
+    CurrentFence = 0;
+    CompletedFence = 0;
+}
+
+uint64 KConstantBufferAllocator::PollCompletedFence(IRHICommandContext& Context, bool bWait)
+{
+    while (CompletedFence + 1 < CurrentFence)
+    {
+        // Only the oldest outstanding fence has to be waited on
+        if (!Context.IsFenceReached(FrameFences[(CompletedFence + 1) % MaxFramesInFlight].Get(), bWait))
+        {
+            break;
+        }
+
+        ++CompletedFence;
+        bWait = false;
+    }
+
+    return CompletedFence;
+}
@@ -0,0 +1,102 @@
+﻿#pragma once
+
+#include "../Utils/Common.h"
+#include "../Utils/Logger.h"
+#include "FrameRingAllocator.h"
+#include "../RHI/RHI.h"
+
+/**
+ * @brief Slice of the shared constant buffer
+ *
+ * FirstConstant/NumConstants are in 16-byte shader constants, as expected by
+ * VSSetConstantBuffers1 and friends.
+ */
+struct FConstantBufferAllocation
+{
+    FRHIResource Buffer = nullptr;
+    UINT32 FirstConstant = 0;
+    UINT32 NumConstants = 0;
+};
+
+/**
+ * @brief Per-frame linear constant buffer allocator
+ * 
+ * Suballocates 256-byte aligned slices from one large dynamic constant buffer.
+ * Slices are written with map-no-overwrite and bound by offset; frames are
+ * retired with GPU fences. When the ring is exhausted the buffer is
+ * map-discarded and allocation restarts from the beginning.
+ * Requires constant buffer ranges (Direct3D 11.1 offsetting, see
+ * IRHIDevice::SupportsConstantBufferRanges).
+ */
+class KConstantBufferAllocator
+{
+public:
+    static constexpr UINT32 DefaultSize = 4 * 1024 * 1024;
+    static constexpr UINT32 Alignment = 256;
+    static constexpr UINT32 MaxFramesInFlight = 8;
+
+    KConstantBufferAllocator() = default;
+    ~KConstantBufferAllocator() = default;
+
+    // Prevent copying
+    KConstantBufferAllocator(const KConstantBufferAllocator&) = delete;
+    KConstantBufferAllocator& operator=(const KConstantBufferAllocator&) = delete;
+
+    /**
+     * @brief Create the backing buffer and frame fences
+     * @param Device RHI device
+     * @param SizeInBytes Size of the ring buffer
+     * @return S_OK on success
+     */
+    HRESULT Initialize(IRHIDevice* Device, UINT32 SizeInBytes = DefaultSize);
+
+    /**
+     * @brief Release completed frames
+     * @param Context RHI command context
+     */
+    void BeginFrame(IRHICommandContext& Context);
+
+    /**
+     * @brief Close the frame and signal its fence
+     * @param Context RHI command context
+     */
+    void EndFrame(IRHICommandContext& Context);
+
+    /**
+     * @brief Allocate a slice and copy constant data into it
+     * @param Context RHI command context
+     * @param Data Constant data
+     * @param Size Size of the data in bytes
+     * @param OutAllocation Allocated slice
+     * @return true on success
+     */
+    bool Upload(IRHICommandContext& Context, const void* Data, UINT32 Size, FConstantBufferAllocation& OutAllocation);
+
+    /**
+     * @brief Cleanup resources
+     */
+    void Cleanup();
+
+    // Accessors
+    FRHIResource GetBuffer() const { return Buffer.Get(); }
+    UINT32 GetSize() const { return static_cast<UINT32>(Ring.GetCapacity()); }
+    UINT32 GetUsedSize() const { return static_cast<UINT32>(Ring.GetUsedSize()); }
+    UINT32 GetDiscardCount() const { return DiscardCount; }
+
+private:
+    /**
+     * @brief Poll frame fences and return the last completed fence value
+     */
+    uint64 PollCompletedFence(IRHICommandContext& Context, bool bWait);
+
+private:
+    FRHIResourceRef Buffer;
+    FRHIResourceRef FrameFences[MaxFramesInFlight];
+
+    KFrameRingAllocator Ring;
+
+    uint64 CurrentFence = 0;     // Fence value of the frame being recorded
+    uint64 CompletedFence = 0;   // Last fence known to be reached by the GPU
+    bool bNeedsDiscard = true;   // Next map must discard (new or exhausted buffer)
+    UINT32 DiscardCount = 0;
+};
@@ -0,0 +1,340 @@
+﻿#include "DebugDraw.h"
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    constexpr uint32 MinCircleSegments = 3;
+    constexpr uint32 MaxCircleSegments = 256;
+
+    inline void SetVertex(FCompactVertex& Vertex, float X, float Y, float Z, uint32 Color)
+    {
+        Vertex.Position[0] = X;
+        Vertex.Position[1] = Y;
+        Vertex.Position[2] = Z;
+        Vertex.Color = Color;
+        Vertex.Normal[0] = 0;
+        Vertex.Normal[1] = 0;
+        Vertex.TexCoord[0] = 0;
+        Vertex.TexCoord[1] = 0;
+    }
+
+    inline void SetVertex(FCompactVertex& Vertex, const float Position[3], uint32 Color)
+    {
+        SetVertex(Vertex, Position[0], Position[1], Position[2], Color);
+    }
+
+    inline void TransformPoint(const float Point[3], const float Matrix[16], float OutPoint[3])
+    {
+        for (int Axis = 0; Axis < 3; ++Axis)
+        {
+            OutPoint[Axis] = Point[0] * Matrix[Axis] + Point[1] * Matrix[4 + Axis] + Point[2] * Matrix[8 + Axis] + Matrix[12 + Axis];
+        }
+    }
+
+    inline void Cross(const float A[3], const float B[3], float Out[3])
+    {
+        Out[0] = A[1] * B[2] - A[2] * B[1];
+        Out[1] = A[2] * B[0] - A[0] * B[2];
+        Out[2] = A[0] * B[1] - A[1] * B[0];
+    }
+
+    // Point shared by three planes; false if two of them are parallel
+    bool IntersectPlanes(const FPlane& A, const FPlane& B, const FPlane& C, float OutPoint[3])
+    {
+        float BC[3], CA[3], AB[3];
+        Cross(B.Normal, C.Normal, BC);
+        Cross(C.Normal, A.Normal, CA);
+        Cross(A.Normal, B.Normal, AB);
+
+        const float Denominator = A.Normal[0] * BC[0] + A.Normal[1] * BC[1] + A.Normal[2] * BC[2];
+        if (std::fabs(Denominator) < 1e-12f)
+        {
+            return false;
+        }
+
+        const float Scale = -1.0f / Denominator;
+        for (int Axis = 0; Axis < 3; ++Axis)
+        {
+            OutPoint[Axis] = (A.Distance * BC[Axis] + B.Distance * CA[Axis] + C.Distance * AB[Axis]) * Scale;
+        }
+        return true;
+    }
+}
+
+FCompactVertex* KDebugDraw::FVertexStream::Append(uint32 VertexCount)
+{
+    // Grow geometrically; resize zero-fills the new tail, but only when the stream
+    // grows, since Count rewinds every frame and the storage is kept across frames
+    if (Count + VertexCount > Storage.size())
+    {
+        const size_t Required = static_cast<size_t>(Count) + VertexCount;
+        Storage.resize(Required > Storage.size() * 2 ? Required : Storage.size() * 2);
+    }
+
+    FCompactVertex* Out = Storage.data() + Count;
+    Count += VertexCount;
+    return Out;
+}
+
+FCompactVertex* KDebugDraw::Allocate(uint32 Count, float Duration, EDebugDrawMode Mode)
+{
+    if (!bEnabled)
+    {
+        return nullptr;
+    }
+
+    const uint32 ModeIndex = static_cast<uint32>(Mode) < DebugDrawModeCount ? static_cast<uint32>(Mode) : 0;
+    FVertexStream& Stream = Duration == 0.0f ? FrameVertices[ModeIndex] : TimedVertices[ModeIndex];
+    if (static_cast<uint64>(Stream.Count) + Count > MaxVertices)
+    {
+        DroppedLineCount += Count / 2;
+        return nullptr;
+    }
+
+    if (Duration != 0.0f)
+    {
+        TimedPrimitives[ModeIndex].push_back({ Duration, Count });
+    }
+
+    return Stream.Append(Count);
+}
+
+const float* KDebugDraw::GetCircle(uint32 Segments)
+{
+    if (Segments != CircleSegments)
+    {
+        CircleTable.resize((Segments + 1) * 2);
+        const float Step = 6.28318530717958647692f / static_cast<float>(Segments);
+        for (uint32 i = 0; i < Segments; ++i)
+        {
+            CircleTable[i * 2] = std::cos(Step * static_cast<float>(i));
+            CircleTable[i * 2 + 1] = std::sin(Step * static_cast<float>(i));
+        }
+        CircleTable[Segments * 2] = CircleTable[0];
+        CircleTable[Segments * 2 + 1] = CircleTable[1];
+        CircleSegments = Segments;
+    }
+    return CircleTable.data();
+}
+
+void KDebugDraw::AddLine(const float Start[3], const float End[3], uint32 Color, float Duration, EDebugDrawMode Mode)
+{
+    FCompactVertex* Out = Allocate(2, Duration, Mode);
+    if (!Out)
+    {
+        return;
+    }
+
+    SetVertex(Out[0], Start, Color);
+    SetVertex(Out[1], End, Color);
+}
+
+void KDebugDraw::AddCorners(const float Corners[8][3], uint32 Color, float Duration, EDebugDrawMode Mode)
+{
+    FCompactVertex* Out = Allocate(24, Duration, Mode);
+    if (!Out)
+    {
+        return;
+    }
+
+    // Every pair of corners differing in one bit is an edge
+    for (uint32 Corner = 0; Corner < 8; ++Corner)
+    {
+        for (uint32 Bit = 1; Bit < 8; Bit <<= 1)
+        {
+            if ((Corner & Bit) == 0)
+            {
+                SetVertex(Out[0], Corners[Corner], Color);
+                SetVertex(Out[1], Corners[Corner | Bit], Color);
+                Out += 2;
+            }
+        }
+    }
+}
+
+void KDebugDraw::AddBox(const FBoundingBox& Box, uint32 Color, float Duration, EDebugDrawMode Mode)
+{
+    float Corners[8][3];
+    for (uint32 Corner = 0; Corner < 8; ++Corner)
+    {
+        for (uint32 Axis = 0; Axis < 3; ++Axis)
+        {
+            Corners[Corner][Axis] = Box.Center[Axis] + ((Corner >> Axis) & 1 ? Box.Extents[Axis] : -Box.Extents[Axis]);
+        }
+    }
+    AddCorners(Corners, Color, Duration, Mode);
+}
+
+void KDebugDraw::AddBox(const FBoundingBox& Box, const float Transform[16], uint32 Color, float Duration, EDebugDrawMode Mode)
+{
+    float Corners[8][3];
+    for (uint32 Corner = 0; Corner < 8; ++Corner)
+    {
+        float Local[3];
+        for (uint32 Axis = 0; Axis < 3; ++Axis)
+        {
+            Local[Axis] = Box.Center[Axis] + ((Corner >> Axis) & 1 ? Box.Extents[Axis] : -Box.Extents[Axis]);
+        }
+        TransformPoint(Local, Transform, Corners[Corner]);
+    }
+    AddCorners(Corners, Color, Duration, Mode);
+}
+
+void KDebugDraw::AddSphere(const FBoundingSphere& Sphere, uint32 Color, uint32 Segments, float Duration, EDebugDrawMode Mode)
+{
+    Segments = Segments < MinCircleSegments ? MinCircleSegments : (Segments > MaxCircleSegments ? MaxCircleSegments : Segments);
+    FCompactVertex* Out = Allocate(Segments * 6, Duration, Mode);
+    if (!Out)
+    {
+        return;
+    }
+
+    // One great circle around each axis
+    const float* Circle = GetCircle(Segments);
+    const float* Center = Sphere.Center;
+    const float Radius = Sphere.Radius;
+    for (uint32 Plane = 0; Plane < 3; ++Plane)
+    {
+        const uint32 AxisU = Plane == 0 ? 1 : 0;
+        const uint32 AxisV = Plane == 2 ? 1 : 2;
+        for (uint32 i = 0; i < Segments; ++i)
+        {
+            for (uint32 End = 0; End < 2; ++End)
+            {
+                float Point[3] = { Center[0], Center[1], Center[2] };
+                Point[AxisU] += Radius * Circle[(i + End) * 2];
+                Point[AxisV] += Radius * Circle[(i + End) * 2 + 1];
+                SetVertex(Out[End], Point, Color);
+            }
+            Out += 2;
+        }
+    }
+}
+
+void KDebugDraw::AddFrustum(const FFrustum& Frustum, uint32 Color, float Duration, EDebugDrawMode Mode)
+{
+    // Planes are left, right, bottom, top, near, far
+    float Corners[8][3];
+    for (uint32 Corner = 0; Corner < 8; ++Corner)
+    {
+        const FPlane& SidePlane = Frustum.Planes[(Corner & 1) ? 1 : 0];
+        const FPlane& HeightPlane = Frustum.Planes[(Corner & 2) ? 3 : 2];
+        const FPlane& DepthPlane = Frustum.Planes[(Corner & 4) ? 5 : 4];
+        if (!IntersectPlanes(SidePlane, HeightPlane, DepthPlane, Corners[Corner]))
+        {
+            return;
+        }
+    }
+    AddCorners(Corners, Color, Duration, Mode);
+}
+
+void KDebugDraw::AddAxes(const float Transform[16], float Size, float Duration, EDebugDrawMode Mode)
+{
+    FCompactVertex* Out = Allocate(6, Duration, Mode);
+    if (!Out)
+    {
+        return;
+    }
+
+    // Unit-length X/Y/Z in red/green/blue, independent of the transform's scale
+    const float* Origin = Transform + 12;
+    const uint32 Colors[3] = { MakeColor(255, 0, 0), MakeColor(0, 255, 0), MakeColor(0, 0, 255) };
+    for (uint32 Axis = 0; Axis < 3; ++Axis)
+    {
+        const float* Row = Transform + Axis * 4;
+        const float Length = std::sqrt(Row[0] * Row[0] + Row[1] * Row[1] + Row[2] * Row[2]);
+        const float Scale = Length > 0.0f ? Size / Length : 0.0f;
+        SetVertex(Out[0], Origin, Colors[Axis]);
+        SetVertex(Out[1], Origin[0] + Row[0] * Scale, Origin[1] + Row[1] * Scale, Origin[2] + Row[2] * Scale, Colors[Axis]);
+        Out += 2;
+    }
+}
+
+void KDebugDraw::Tick(float DeltaSeconds)
+{
+    for (uint32 Mode = 0; Mode < DebugDrawModeCount; ++Mode)
+    {
+        std::vector<FTimedPrimitive>& Primitives = TimedPrimitives[Mode];
+        FCompactVertex* Vertices = TimedVertices[Mode].Storage.data();
+
+        // Compact the survivors in place, keeping their order
+        size_t ReadVertex = 0;
+        size_t WriteVertex = 0;
+        size_t WritePrimitive = 0;
+        for (FTimedPrimitive& Primitive : Primitives)
+        {
+            const bool bKeep = Primitive.Remaining < 0.0f || (Primitive.Remaining -= DeltaSeconds) > 0.0f;
+            if (bKeep)
+            {
+                if (WriteVertex != ReadVertex)
+                {
+                    std::memmove(&Vertices[WriteVertex], &Vertices[ReadVertex], Primitive.VertexCount * sizeof(FCompactVertex));
+                }
+                WriteVertex += Primitive.VertexCount;
+                Primitives[WritePrimitive++] = Primitive;
+            }
+            ReadVertex += Primitive.VertexCount;
+        }
+
+        Primitives.resize(WritePrimitive);
+        TimedVertices[Mode].Count = static_cast<uint32>(WriteVertex);
+    }
+}
+
+uint32 KDebugDraw::GetVertexCount(EDebugDrawMode Mode) const
+{
+    const uint32 ModeIndex = static_cast<uint32>(Mode);
+    return FrameVertices[ModeIndex].Count + TimedVertices[ModeIndex].Count;
+}
+
+void KDebugDraw::CopyVertices(EDebugDrawMode Mode, FCompactVertex* Destination) const
+{
+    const uint32 ModeIndex = static_cast<uint32>(Mode);
+    const FVertexStream& Frame = FrameVertices[ModeIndex];
+    const FVertexStream& Timed = TimedVertices[ModeIndex];
+    if (Frame.Count > 0)
+    {
+        std::memcpy(Destination, Frame.Storage.data(), Frame.Count * sizeof(FCompactVertex));
+    }
+    if (Timed.Count > 0)
+    {
+        std::memcpy(Destination + Frame.Count, Timed.Storage.data(), Timed.Count * sizeof(FCompactVertex));
+    }
+}
+
+void KDebugDraw::EndFrame()
+{
+    for (FVertexStream& Stream : FrameVertices)
+    {
+        Stream.Count = 0;
+    }
+    DroppedLineCount = 0;
+}
+
+void KDebugDraw::ClearTimed()
+{
+    for (uint32 Mode = 0; Mode < DebugDrawModeCount; ++Mode)
+    {
+        TimedVertices[Mode].Count = 0;
+        TimedPrimitives[Mode].clear();
+    }
+}
+
+void KDebugDraw::Clear()
+{
+    EndFrame();
+    ClearTimed();
+}
+
+FDebugDrawStats KDebugDraw::GetStats() const
+{
+    FDebugDrawStats Stats;
+    for (uint32 Mode = 0; Mode < DebugDrawModeCount; ++Mode)
+    {
+        Stats.FrameLineCount += FrameVertices[Mode].Count / 2;
+        Stats.TimedLineCount += TimedVertices[Mode].Count / 2;
+    }
+    Stats.DroppedLineCount = DroppedLineCount;
+    return Stats;
+}
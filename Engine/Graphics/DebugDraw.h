@@ -0,0 +1,157 @@
+﻿#pragma once
+
+#include "../Utils/Types.h"
+#include "../Utils/Bounds.h"
+#include "VertexFormat.h"
+#include <vector>
+
+/**
+ * @brief How debug primitives are composited with the scene
+ */
+enum class EDebugDrawMode : uint8
+{
+    DepthTested,    // Hidden behind scene geometry (when the render target has a depth buffer)
+    Overlay         // Always on top
+};
+
+constexpr uint32 DebugDrawModeCount = 2;
+
+/**
+ * @brief Debug draw counters of the current frame
+ */
+struct FDebugDrawStats
+{
+    uint32 FrameLineCount = 0;      // One-frame lines
+    uint32 TimedLineCount = 0;      // Lines kept for a duration
+    uint32 DroppedLineCount = 0;    // Lines over the vertex budget
+};
+
+/**
+ * @brief Immediate-mode debug primitive collector
+ *
+ * Lines, boxes, spheres, frusta and axes are expanded into line-list
+ * vertices (FCompactVertex, EVertexLayout::Compact) as they are added, so
+ * each mode is one vertex stream and one draw. The streams keep their
+ * capacity across frames; nothing is allocated per primitive once they
+ * have grown. Primitives with a duration live in separate streams that
+ * Tick ages and compacts in place. Platform independent: the renderer
+ * copies the streams into a dynamic vertex buffer (see KRenderer).
+ *
+ * Points are 3 floats; matrices are 16 floats, row-major, for row vectors
+ * (like Bounds.h). Colors are packed RGBA8, red in the lowest byte.
+ */
+class KDebugDraw
+{
+public:
+    static constexpr float Persistent = -1.0f;     // Duration: until ClearTimed
+    static constexpr uint32 DefaultMaxVertices = 4u << 20;
+
+    static constexpr uint32 MakeColor(uint8 R, uint8 G, uint8 B, uint8 A = 255)
+    {
+        return uint32(R) | (uint32(G) << 8) | (uint32(B) << 16) | (uint32(A) << 24);
+    }
+
+    KDebugDraw() = default;
+
+    /**
+     * @brief Enable or disable collection (Add calls are ignored while disabled)
+     */
+    void SetEnabled(bool bInEnabled) { bEnabled = bInEnabled; }
+    bool IsEnabled() const { return bEnabled; }
+
+    /**
+     * @brief Vertex budget per mode and stream; lines over it are dropped and counted
+     */
+    void SetMaxVertices(uint32 InMaxVertices) { MaxVertices = InMaxVertices; }
+
+    /**
+     * @brief Add primitives
+     * @param Duration Seconds to keep the primitive, 0 for this frame only, Persistent until ClearTimed
+     */
+    void AddLine(const float Start[3], const float End[3], uint32 Color, float Duration = 0.0f,
+                 EDebugDrawMode Mode = EDebugDrawMode::DepthTested);
+    void AddBox(const FBoundingBox& Box, uint32 Color, float Duration = 0.0f,
+                EDebugDrawMode Mode = EDebugDrawMode::DepthTested);
+    void AddBox(const FBoundingBox& Box, const float Transform[16], uint32 Color, float Duration = 0.0f,
+                EDebugDrawMode Mode = EDebugDrawMode::DepthTested);
+    void AddSphere(const FBoundingSphere& Sphere, uint32 Color, uint32 Segments = 16, float Duration = 0.0f,
+                   EDebugDrawMode Mode = EDebugDrawMode::DepthTested);
+    void AddFrustum(const FFrustum& Frustum, uint32 Color, float Duration = 0.0f,
+                    EDebugDrawMode Mode = EDebugDrawMode::DepthTested);
+    void AddAxes(const float Transform[16], float Size, float Duration = 0.0f,
+                 EDebugDrawMode Mode = EDebugDrawMode::DepthTested);
+
+    /**
+     * @brief Hexahedron edges; corner bit 0 selects -X/+X, bit 1 -Y/+Y, bit 2 -Z/+Z (near/far)
+     */
+    void AddCorners(const float Corners[8][3], uint32 Color, float Duration = 0.0f,
+                    EDebugDrawMode Mode = EDebugDrawMode::DepthTested);
+
+    /**
+     * @brief Age primitives with a duration and drop the expired ones
+     */
+    void Tick(float DeltaSeconds);
+
+    /**
+     * @brief Vertices of a mode (one-frame and timed), always an even count
+     */
+    uint32 GetVertexCount(EDebugDrawMode Mode) const;
+
+    /**
+     * @brief Copy the vertices of a mode (GetVertexCount of them) into Destination
+     */
+    void CopyVertices(EDebugDrawMode Mode, FCompactVertex* Destination) const;
+
+    /**
+     * @brief Drop the one-frame primitives (call after submitting)
+     */
+    void EndFrame();
+
+    /**
+     * @brief Drop primitives with a duration / everything
+     */
+    void ClearTimed();
+    void Clear();
+
+    FDebugDrawStats GetStats() const;
+
+private:
+    /**
+     * @brief Storage for Count vertices of a new primitive, nullptr if over budget
+     */
+    FCompactVertex* Allocate(uint32 Count, float Duration, EDebugDrawMode Mode);
+
+    /**
+     * @brief Unit circle table for Segments segments
+     */
+    const float* GetCircle(uint32 Segments);
+
+private:
+    struct FTimedPrimitive
+    {
+        float Remaining;        // Seconds, negative for persistent
+        uint32 VertexCount;
+    };
+
+    /**
+     * @brief Vertex array whose storage only grows; Count is the used part
+     */
+    struct FVertexStream
+    {
+        std::vector<FCompactVertex> Storage;
+        uint32 Count = 0;
+
+        FCompactVertex* Append(uint32 VertexCount);
+    };
+
+    bool bEnabled = true;
+    uint32 MaxVertices = DefaultMaxVertices;
+    uint32 DroppedLineCount = 0;
+
+    FVertexStream FrameVertices[DebugDrawModeCount];
+    FVertexStream TimedVertices[DebugDrawModeCount];
+    std::vector<FTimedPrimitive> TimedPrimitives[DebugDrawModeCount];
+
+    std::vector<float> CircleTable;     // Cos/sin pairs, Segments + 1 of them
+    uint32 CircleSegments = 0;
+};
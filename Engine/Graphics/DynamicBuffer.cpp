@@ -0,0 +1,197 @@
+﻿#include "DynamicBuffer.h"
+#include <algorithm>
+
+uint32 DynamicBuffer::GrowCapacity(const FDynamicGrowthPolicy& Policy, uint32 CurrentCapacity, uint32 RequiredCount)
+{
+    if (RequiredCount <= CurrentCapacity)
+    {
+        return CurrentCapacity;
+    }
+    if (Policy.MaxCapacity > 0 && RequiredCount > Policy.MaxCapacity)
+    {
+        return 0;
+    }
+
+    const double Grown = static_cast<double>(CurrentCapacity) * (Policy.Factor > 1.0f ? Policy.Factor : 1.0f);
+    uint64 Target = std::max<uint64>(RequiredCount, static_cast<uint64>(Grown));
+
+    const uint64 Granularity = Policy.Granularity > 0 ? Policy.Granularity : 1;
+    Target = (Target + Granularity - 1) / Granularity * Granularity;
+
+    const uint64 Limit = Policy.MaxCapacity > 0 ? Policy.MaxCapacity : UINT32_MAX;
+    return static_cast<uint32>(std::min(Target, Limit));
+}
+
+void KDynamicAppendCursor::Initialize(uint32 InCapacity)
+{
+    Capacity = InCapacity;
+    Cursor = 0;
+    FrameUsage = 0;
+    LastFrameUsage = 0;
+    DiscardCount = 0;
+    bNeedsDiscard = true;
+}
+
+uint32 KDynamicAppendCursor::Allocate(uint32 Count, EDynamicMapMode& OutMode)
+{
+    if (Count == 0 || Count > Capacity)
+    {
+        return DynamicBuffer::InvalidOffset;
+    }
+
+    FrameUsage = FrameUsage > UINT32_MAX - Count ? UINT32_MAX : FrameUsage + Count;
+
+    if (bNeedsDiscard || static_cast<uint64>(Cursor) + Count > Capacity)
+    {
+        // Start over in a renamed buffer; ranges handed out before stay intact for the GPU
+        if (!bNeedsDiscard)
+        {
+            ++DiscardCount;
+        }
+        OutMode = EDynamicMapMode::Discard;
+        Cursor = 0;
+        bNeedsDiscard = false;
+    }
+    else
+    {
+        OutMode = EDynamicMapMode::NoOverwrite;
+    }
+
+    const uint32 Offset = Cursor;
+    Cursor += Count;
+    return Offset;
+}
+
+void KDynamicAppendCursor::BeginFrame()
+{
+    LastFrameUsage = FrameUsage;
+    FrameUsage = 0;
+}
+
+uint32 KDynamicAppendCursor::GetRecommendedCapacity(const FDynamicGrowthPolicy& Policy) const
+{
+    if (LastFrameUsage <= Capacity)
+    {
+        return Capacity;
+    }
+
+    const uint32 Grown = DynamicBuffer::GrowCapacity(Policy, Capacity, LastFrameUsage);
+    if (Grown == 0)
+    {
+        // Over the maximum: grow as far as allowed, later frames keep discarding
+        return Policy.MaxCapacity > Capacity ? Policy.MaxCapacity : Capacity;
+    }
+    return Grown;
+}
+
+void KDynamicRangeTracker::Initialize(uint32 InCopyCount)
+{
+    CopyCount = std::min(std::max(InCopyCount, 1u), MaxCopies);
+    Current = 0;
+    Invalidate();
+}
+
+void KDynamicRangeTracker::MarkDirty(uint32 First, uint32 Count)
+{
+    if (Count == 0)
+    {
+        return;
+    }
+
+    for (uint32 Copy = 0; Copy < CopyCount; ++Copy)
+    {
+        // Invalid copies are rewritten whole anyway
+        if (!bValid[Copy])
+        {
+            continue;
+        }
+
+        Pending[Copy].push_back({ First, Count });
+        bNormalized[Copy] = false;
+        if (Pending[Copy].size() >= NormalizeThreshold)
+        {
+            Normalize(Copy);
+        }
+    }
+}
+
+void KDynamicRangeTracker::Invalidate()
+{
+    for (uint32 Copy = 0; Copy < MaxCopies; ++Copy)
+    {
+        Pending[Copy].clear();
+        bNormalized[Copy] = true;
+        bValid[Copy] = false;
+    }
+}
+
+uint32 KDynamicRangeTracker::Advance()
+{
+    Current = (Current + 1) % CopyCount;
+    return Current;
+}
+
+EDynamicMapMode KDynamicRangeTracker::ChooseMapMode(uint32 UsedCount, bool bCopyIdle, float MaxPartialRatio)
+{
+    if (!bValid[Current] || !bCopyIdle)
+    {
+        return EDynamicMapMode::Discard;
+    }
+
+    Normalize(Current);
+    uint64 DirtyCount = 0;
+    for (const FDynamicRange& Range : Pending[Current])
+    {
+        if (Range.First < UsedCount)
+        {
+            DirtyCount += std::min(Range.Count, UsedCount - Range.First);
+        }
+    }
+
+    return static_cast<double>(DirtyCount) > static_cast<double>(UsedCount) * MaxPartialRatio
+        ? EDynamicMapMode::Discard : EDynamicMapMode::NoOverwrite;
+}
+
+const std::vector<FDynamicRange>& KDynamicRangeTracker::GetPendingRanges()
+{
+    Normalize(Current);
+    return Pending[Current];
+}
+
+void KDynamicRangeTracker::CompleteUpdate()
+{
+    Pending[Current].clear();
+    bNormalized[Current] = true;
+    bValid[Current] = true;
+}
+
+void KDynamicRangeTracker::Normalize(uint32 Copy)
+{
+    if (bNormalized[Copy])
+    {
+        return;
+    }
+
+    std::vector<FDynamicRange>& Ranges = Pending[Copy];
+    std::sort(Ranges.begin(), Ranges.end(), [](const FDynamicRange& A, const FDynamicRange& B) { return A.First < B.First; });
+
+    size_t Last = 0;
+    for (size_t i = 1; i < Ranges.size(); ++i)
+    {
+        const uint64 LastEnd = static_cast<uint64>(Ranges[Last].First) + Ranges[Last].Count;
+        if (Ranges[i].First <= LastEnd + MergeGap)
+        {
+            const uint64 End = std::max(LastEnd, static_cast<uint64>(Ranges[i].First) + Ranges[i].Count);
+            Ranges[Last].Count = static_cast<uint32>(std::min<uint64>(End - Ranges[Last].First, UINT32_MAX));
+        }
+        else
+        {
+            Ranges[++Last] = Ranges[i];
+        }
+    }
+    if (!Ranges.empty())
+    {
+        Ranges.resize(Last + 1);
+    }
+    bNormalized[Copy] = true;
+}
@@ -0,0 +1,183 @@
+﻿#pragma once
+
+#include "../Utils/Types.h"
+#include <vector>
+
+/**
+ * @brief How a dynamic buffer range is mapped for writing
+ */
+enum class EDynamicMapMode : uint8
+{
+    Discard,        // Rename the buffer; previous contents are undefined afterwards
+    NoOverwrite     // Keep the buffer; only ranges the GPU is not reading may be written
+};
+
+/**
+ * @brief Capacity growth policy of dynamic buffers (capacities in elements)
+ */
+struct FDynamicGrowthPolicy
+{
+    float Factor = 1.5f;            // Growth multiplier of the current capacity (at least the required size)
+    uint32 Granularity = 256;       // Capacities are rounded up to a multiple of this
+    uint32 MaxCapacity = 0;         // Upper bound, 0 for none
+};
+
+/**
+ * @brief Range of elements
+ */
+struct FDynamicRange
+{
+    uint32 First = 0;
+    uint32 Count = 0;
+};
+
+namespace DynamicBuffer
+{
+    constexpr uint32 InvalidOffset = ~uint32(0);
+
+    /**
+     * @brief Capacity to grow to so that RequiredCount elements fit
+     * @return CurrentCapacity if it is large enough, 0 if the policy's maximum is exceeded
+     */
+    uint32 GrowCapacity(const FDynamicGrowthPolicy& Policy, uint32 CurrentCapacity, uint32 RequiredCount);
+}
+
+/**
+ * @brief Append cursor of a per-frame (streaming) dynamic buffer
+ *
+ * Hands out consecutive ranges that are written with map-no-overwrite. When
+ * the rest of the buffer is too small the buffer starts over with a
+ * map-discard; draws issued before keep reading the renamed contents. Frame
+ * usage is tracked so the owner can grow the buffer until a frame fits
+ * without discarding. The owner maps each returned range with the mode
+ * Allocate reports.
+ */
+class KDynamicAppendCursor
+{
+public:
+    KDynamicAppendCursor() = default;
+    explicit KDynamicAppendCursor(uint32 InCapacity) { Initialize(InCapacity); }
+
+    /**
+     * @brief Set the capacity of a new buffer; the next allocation discards
+     */
+    void Initialize(uint32 InCapacity);
+
+    /**
+     * @brief Reserve Count consecutive elements
+     * @param OutMode Map mode the range must be written with
+     * @return First element of the range, or DynamicBuffer::InvalidOffset if Count exceeds the capacity
+     */
+    uint32 Allocate(uint32 Count, EDynamicMapMode& OutMode);
+
+    /**
+     * @brief Start a new frame (the previous frame's usage becomes GetLastFrameUsage)
+     */
+    void BeginFrame();
+
+    /**
+     * @brief Capacity the buffer should be recreated with, or the current capacity
+     *
+     * Grows when the last frame needed more elements than the buffer holds, so
+     * it had to discard mid-frame.
+     */
+    uint32 GetRecommendedCapacity(const FDynamicGrowthPolicy& Policy) const;
+
+    // Accessors
+    uint32 GetCapacity() const { return Capacity; }
+    uint32 GetCursor() const { return Cursor; }
+    uint32 GetFrameUsage() const { return FrameUsage; }
+    uint32 GetLastFrameUsage() const { return LastFrameUsage; }
+    uint32 GetDiscardCount() const { return DiscardCount; }
+
+private:
+    uint32 Capacity = 0;
+    uint32 Cursor = 0;
+    uint32 FrameUsage = 0;
+    uint32 LastFrameUsage = 0;
+    uint32 DiscardCount = 0;
+    bool bNeedsDiscard = true;
+};
+
+/**
+ * @brief Dirty range tracking of a multi-buffered persistent dynamic buffer
+ *
+ * The owner keeps a CPU copy of the data and CopyCount GPU copies, rotating to
+ * the next copy whenever the data changed. Every change is recorded against
+ * every copy, so a copy that comes around again only needs the ranges
+ * changed since it was last written; those are written with map-no-overwrite
+ * once the GPU is done with the copy. A copy still in use, never written, or
+ * mostly dirty is rewritten whole with map-discard instead. The owner calls
+ * CompleteUpdate once the current copy has been written.
+ */
+class KDynamicRangeTracker
+{
+public:
+    static constexpr uint32 MaxCopies = 4;
+
+    KDynamicRangeTracker() = default;
+
+    /**
+     * @brief Set the number of copies (clamped to [1, MaxCopies]) and invalidate them
+     */
+    void Initialize(uint32 InCopyCount);
+
+    /**
+     * @brief Record that elements [First, First + Count) changed
+     */
+    void MarkDirty(uint32 First, uint32 Count);
+
+    /**
+     * @brief Forget the contents of every copy (for example after recreating the buffers)
+     */
+    void Invalidate();
+
+    /**
+     * @brief Whether the current copy is out of date
+     */
+    bool NeedsUpdate() const { return !bValid[Current] || !Pending[Current].empty(); }
+
+    /**
+     * @brief Rotate to the next copy and return it
+     */
+    uint32 Advance();
+
+    /**
+     * @brief How the current copy must be updated
+     * @param UsedCount Elements in use (the size of a whole rewrite)
+     * @param bCopyIdle Whether the GPU is done reading the current copy
+     * @param MaxPartialRatio Rewrite whole once the dirty share of UsedCount exceeds this
+     */
+    EDynamicMapMode ChooseMapMode(uint32 UsedCount, bool bCopyIdle, float MaxPartialRatio = 0.5f);
+
+    /**
+     * @brief Dirty ranges of the current copy: sorted, disjoint, with small gaps merged
+     */
+    const std::vector<FDynamicRange>& GetPendingRanges();
+
+    /**
+     * @brief Mark the current copy as up to date
+     */
+    void CompleteUpdate();
+
+    // Accessors
+    uint32 GetCopyCount() const { return CopyCount; }
+    uint32 GetCurrent() const { return Current; }
+    bool IsValid(uint32 Copy) const { return Copy < CopyCount && bValid[Copy]; }
+
+private:
+    /**
+     * @brief Sort and merge the ranges of one copy
+     */
+    void Normalize(uint32 Copy);
+
+private:
+    static constexpr uint32 MergeGap = 16;          // Ranges closer than this are written as one
+    static constexpr size_t NormalizeThreshold = 1024;
+
+    uint32 CopyCount = 1;
+    uint32 Current = 0;
+    std::vector<FDynamicRange> Pending[MaxCopies];
+    bool bNormalized[MaxCopies] = {};
+    bool bValid[MaxCopies] = {};
+};
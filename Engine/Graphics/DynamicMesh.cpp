@@ -0,0 +1,462 @@
+﻿#include "DynamicMesh.h"
+#include "RenderStateCache.h"
+#include "../Core/Profiler.h"
+#include <cstring>
+
+namespace
+{
+    bool CreateDynamicBuffer(IRHIDevice* Device, UINT32 ByteWidth, uint32 BindFlags, FRHIResourceRef& OutBuffer)
+    {
+        FRHIBufferDesc BufferDesc;
+        BufferDesc.Usage = ERHIBufferUsage::Dynamic;
+        BufferDesc.ByteWidth = ByteWidth;
+        BufferDesc.BindFlags = BindFlags;
+
+        OutBuffer.Reset(Device, Device->CreateBuffer(BufferDesc, nullptr));
+        return static_cast<bool>(OutBuffer);
+    }
+
+    ERHIMapMode ToRHIMapMode(EDynamicMapMode Mode)
+    {
+        return Mode == EDynamicMapMode::Discard ? ERHIMapMode::WriteDiscard : ERHIMapMode::WriteNoOverwrite;
+    }
+}
+
+HRESULT KDynamicMesh::Initialize(IRHIDevice* InDevice, const FDynamicMeshSettings& InSettings)
+{
+    if (!InDevice || InSettings.VertexCapacity == 0)
+    {
+        return E_INVALIDARG;
+    }
+
+    if (VertexFormat::GetStreamCount(InSettings.Layout) != 1 || VertexFormat::HasQuantizedPositions(InSettings.Layout))
+    {
+        LOG_ERROR("Dynamic meshes need a single-stream layout with float positions");
+        return E_INVALIDARG;
+    }
+
+    Cleanup();
+    Device = RHI::ShareDevice(InDevice);
+    Settings = InSettings;
+    VertexStride = VertexFormat::GetStreamStride(Settings.Layout, 0);
+
+    const bool bPersistent = Settings.Usage == EDynamicMeshUsage::Persistent;
+    VertexTracker.Initialize(bPersistent ? Settings.BufferCount : 1);
+    IndexTracker.Initialize(bPersistent ? Settings.BufferCount : 1);
+    Settings.BufferCount = VertexTracker.GetCopyCount();
+
+    HRESULT hr = CreateBuffers(Settings.VertexCapacity, Settings.IndexCapacity);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    if (bPersistent)
+    {
+        for (UINT32 Copy = 0; Copy < Settings.BufferCount; ++Copy)
+        {
+            CopyFences[Copy].Reset(Device.get(), Device->CreateFence());
+            if (!CopyFences[Copy])
+            {
+                LOG_ERROR("Dynamic mesh fence creation failed");
+                return E_FAIL;
+            }
+        }
+    }
+
+    return S_OK;
+}
+
+HRESULT KDynamicMesh::CreateBuffers(UINT32 InVertexCapacity, UINT32 InIndexCapacity)
+{
+    const UINT32 CopyCount = Settings.Usage == EDynamicMeshUsage::Persistent ? Settings.BufferCount : 1;
+    for (UINT32 Copy = 0; Copy < CopyCount; ++Copy)
+    {
+        if (!CreateDynamicBuffer(Device.get(), InVertexCapacity * VertexStride, RHIBindFlags::VertexBuffer, VertexBuffers[Copy]))
+        {
+            LOG_ERROR("Dynamic vertex buffer creation failed");
+            return E_FAIL;
+        }
+
+        if (InIndexCapacity > 0)
+        {
+            if (!CreateDynamicBuffer(Device.get(), InIndexCapacity * GetIndexStride(), RHIBindFlags::IndexBuffer, IndexBuffers[Copy]))
+            {
+                LOG_ERROR("Dynamic index buffer creation failed");
+                return E_FAIL;
+            }
+        }
+        bCopyFenceSignaled[Copy] = false;
+    }
+
+    VertexCapacity = InVertexCapacity;
+    IndexCapacity = InIndexCapacity;
+    VertexCursor.Initialize(VertexCapacity);
+    IndexCursor.Initialize(IndexCapacity);
+    VertexTracker.Invalidate();
+    IndexTracker.Invalidate();
+    CurrentCopy = 0;
+    return S_OK;
+}
+
+HRESULT KDynamicMesh::Reallocate(UINT32 InVertexCapacity, UINT32 InIndexCapacity)
+{
+    // Draws already issued keep the old buffers alive until the GPU is done with them
+    HRESULT hr = CreateBuffers(InVertexCapacity, InIndexCapacity);
+    if (SUCCEEDED(hr))
+    {
+        ++Stats.Reallocations;
+        LOG_INFO("Dynamic mesh buffers grown to " + std::to_string(InVertexCapacity) + " vertices, " +
+                 std::to_string(InIndexCapacity) + " indices");
+    }
+    return hr;
+}
+
+void KDynamicMesh::BeginFrame()
+{
+    if (Settings.Usage != EDynamicMeshUsage::Stream || !VertexBuffers[0])
+    {
+        return;
+    }
+
+    VertexCursor.BeginFrame();
+    IndexCursor.BeginFrame();
+
+    // Grow until a whole frame fits without discarding mid-frame
+    const UINT32 NewVertexCapacity = VertexCursor.GetRecommendedCapacity(Settings.Growth);
+    const UINT32 NewIndexCapacity = HasIndices() ? IndexCursor.GetRecommendedCapacity(Settings.Growth) : 0;
+    if (NewVertexCapacity != VertexCapacity || NewIndexCapacity != IndexCapacity)
+    {
+        Reallocate(NewVertexCapacity, NewIndexCapacity);
+    }
+}
+
+bool KDynamicMesh::Map(IRHICommandContext& Context, UINT32 VertexCount, UINT32 IndexCount, FDynamicMeshWriter& OutWriter)
+{
+    if (Settings.Usage != EDynamicMeshUsage::Stream || !VertexBuffers[0] || bMapped || VertexCount == 0)
+    {
+        return false;
+    }
+    if ((IndexCount > 0 && !HasIndices()) || (IndexCount > 0 && Settings.IndexFormat == EIndexFormat::UInt16 && VertexCount > 65536))
+    {
+        return false;
+    }
+
+    // A single range larger than a buffer grows it right away
+    if (VertexCount > VertexCapacity || IndexCount > IndexCapacity)
+    {
+        const UINT32 NewVertexCapacity = DynamicBuffer::GrowCapacity(Settings.Growth, VertexCapacity, VertexCount);
+        const UINT32 NewIndexCapacity = DynamicBuffer::GrowCapacity(Settings.Growth, IndexCapacity, IndexCount);
+        if (NewVertexCapacity == 0 || (IndexCount > 0 && NewIndexCapacity == 0))
+        {
+            LOG_WARNING("Dynamic mesh range exceeds the maximum capacity");
+            return false;
+        }
+        if (FAILED(Reallocate(NewVertexCapacity, NewIndexCapacity)))
+        {
+            return false;
+        }
+    }
+
+    EDynamicMapMode VertexMode;
+    const UINT32 BaseVertex = VertexCursor.Allocate(VertexCount, VertexMode);
+
+    void* Mapped = Context.Map(VertexBuffers[0].Get(), ToRHIMapMode(VertexMode));
+    if (!Mapped)
+    {
+        LOG_ERROR("Dynamic vertex buffer map failed");
+        return false;
+    }
+    OutWriter.Vertices = static_cast<uint8*>(Mapped) + static_cast<size_t>(BaseVertex) * VertexStride;
+    if (VertexMode == EDynamicMapMode::Discard)
+    {
+        ++Stats.DiscardMaps;
+    }
+    else
+    {
+        ++Stats.NoOverwriteMaps;
+    }
+
+    OutWriter.Indices = nullptr;
+    UINT32 StartIndex = 0;
+    if (IndexCount > 0)
+    {
+        EDynamicMapMode IndexMode;
+        StartIndex = IndexCursor.Allocate(IndexCount, IndexMode);
+        Mapped = Context.Map(IndexBuffers[0].Get(), ToRHIMapMode(IndexMode));
+        if (!Mapped)
+        {
+            LOG_ERROR("Dynamic index buffer map failed");
+            Context.Unmap(VertexBuffers[0].Get());
+            return false;
+        }
+        OutWriter.Indices = static_cast<uint8*>(Mapped) + static_cast<size_t>(StartIndex) * GetIndexStride();
+        if (IndexMode == EDynamicMapMode::Discard)
+        {
+            ++Stats.DiscardMaps;
+        }
+        else
+        {
+            ++Stats.NoOverwriteMaps;
+        }
+    }
+
+    OutWriter.Section.BaseVertex = BaseVertex;
+    OutWriter.Section.VertexCount = VertexCount;
+    OutWriter.Section.StartIndex = StartIndex;
+    OutWriter.Section.IndexCount = IndexCount;
+    Stats.BytesWritten += static_cast<UINT64>(VertexCount) * VertexStride + static_cast<UINT64>(IndexCount) * GetIndexStride();
+    bMapped = true;
+    bIndicesMapped = IndexCount > 0;
+    return true;
+}
+
+void KDynamicMesh::Unmap(IRHICommandContext& Context)
+{
+    if (!bMapped)
+    {
+        return;
+    }
+
+    Context.Unmap(VertexBuffers[0].Get());
+    if (bIndicesMapped)
+    {
+        Context.Unmap(IndexBuffers[0].Get());
+    }
+    bMapped = false;
+    bIndicesMapped = false;
+}
+
+bool KDynamicMesh::Append(IRHICommandContext& Context, const void* Vertices, UINT32 VertexCount,
+                          const void* Indices, UINT32 IndexCount, FDynamicMeshSection& OutSection)
+{
+    if (!Vertices || (IndexCount > 0 && !Indices))
+    {
+        return false;
+    }
+
+    FDynamicMeshWriter Writer;
+    if (!Map(Context, VertexCount, IndexCount, Writer))
+    {
+        return false;
+    }
+
+    std::memcpy(Writer.Vertices, Vertices, static_cast<size_t>(VertexCount) * VertexStride);
+    if (IndexCount > 0)
+    {
+        std::memcpy(Writer.Indices, Indices, static_cast<size_t>(IndexCount) * GetIndexStride());
+    }
+    Unmap(Context);
+
+    OutSection = Writer.Section;
+    return true;
+}
+
+bool KDynamicMesh::SetVertices(const void* Vertices, UINT32 Count)
+{
+    if (Settings.Usage != EDynamicMeshUsage::Persistent || !VertexBuffers[0] || (Count > 0 && !Vertices))
+    {
+        return false;
+    }
+    if (Settings.Growth.MaxCapacity > 0 && Count > Settings.Growth.MaxCapacity)
+    {
+        return false;
+    }
+
+    VertexData.assign(static_cast<const uint8*>(Vertices), static_cast<const uint8*>(Vertices) + static_cast<size_t>(Count) * VertexStride);
+    VertexTracker.MarkDirty(0, Count);
+    return true;
+}
+
+bool KDynamicMesh::SetIndices(const void* Indices, UINT32 Count)
+{
+    if (Settings.Usage != EDynamicMeshUsage::Persistent || !HasIndices() || (Count > 0 && !Indices))
+    {
+        return false;
+    }
+    if (Settings.Growth.MaxCapacity > 0 && Count > Settings.Growth.MaxCapacity)
+    {
+        return false;
+    }
+
+    IndexData.assign(static_cast<const uint8*>(Indices), static_cast<const uint8*>(Indices) + static_cast<size_t>(Count) * GetIndexStride());
+    IndexTracker.MarkDirty(0, Count);
+    return true;
+}
+
+bool KDynamicMesh::UpdateVertices(UINT32 First, UINT32 Count, const void* Vertices)
+{
+    const size_t VertexCount = VertexData.size() / VertexStride;
+    if (Settings.Usage != EDynamicMeshUsage::Persistent || !Vertices || First > VertexCount || Count > VertexCount - First)
+    {
+        return false;
+    }
+
+    std::memcpy(VertexData.data() + static_cast<size_t>(First) * VertexStride, Vertices, static_cast<size_t>(Count) * VertexStride);
+    VertexTracker.MarkDirty(First, Count);
+    return true;
+}
+
+bool KDynamicMesh::UpdateIndices(UINT32 First, UINT32 Count, const void* Indices)
+{
+    const size_t IndexCount = IndexData.size() / GetIndexStride();
+    if (Settings.Usage != EDynamicMeshUsage::Persistent || !Indices || First > IndexCount || Count > IndexCount - First)
+    {
+        return false;
+    }
+
+    std::memcpy(IndexData.data() + static_cast<size_t>(First) * GetIndexStride(), Indices, static_cast<size_t>(Count) * GetIndexStride());
+    IndexTracker.MarkDirty(First, Count);
+    return true;
+}
+
+HRESULT KDynamicMesh::Flush(IRHICommandContext& Context)
+{
+    KE_PROFILE_FUNCTION();
+
+    if (Settings.Usage != EDynamicMeshUsage::Persistent || !VertexBuffers[0])
+    {
+        return E_FAIL;
+    }
+
+    // Grow every copy first; recreated copies are rewritten whole
+    const UINT32 VertexCount = static_cast<UINT32>(VertexData.size() / VertexStride);
+    const UINT32 IndexCount = static_cast<UINT32>(IndexData.size() / GetIndexStride());
+    if (VertexCount > VertexCapacity || IndexCount > IndexCapacity)
+    {
+        HRESULT hr = Reallocate(DynamicBuffer::GrowCapacity(Settings.Growth, VertexCapacity, VertexCount),
+                                DynamicBuffer::GrowCapacity(Settings.Growth, IndexCapacity, IndexCount));
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+    }
+
+    if (!VertexTracker.NeedsUpdate() && !IndexTracker.NeedsUpdate())
+    {
+        return S_OK;
+    }
+
+    // Leave the copy the GPU may still read; its fence tells when it can be patched in place
+    Context.SignalFence(CopyFences[CurrentCopy].Get());
+    bCopyFenceSignaled[CurrentCopy] = true;
+    CurrentCopy = VertexTracker.Advance();
+    IndexTracker.Advance();
+
+    const bool bCopyIdle = !bCopyFenceSignaled[CurrentCopy] || Context.IsFenceReached(CopyFences[CurrentCopy].Get(), false);
+
+    HRESULT hr = UploadPending(Context, VertexBuffers[CurrentCopy].Get(), VertexTracker, VertexData, VertexStride, bCopyIdle);
+    if (SUCCEEDED(hr) && HasIndices())
+    {
+        hr = UploadPending(Context, IndexBuffers[CurrentCopy].Get(), IndexTracker, IndexData, GetIndexStride(), bCopyIdle);
+    }
+    return hr;
+}
+
+HRESULT KDynamicMesh::UploadPending(IRHICommandContext& Context, FRHIResource Buffer, KDynamicRangeTracker& Tracker,
+                                    const std::vector<uint8>& Data, UINT32 Stride, bool bCopyIdle)
+{
+    if (!Tracker.NeedsUpdate())
+    {
+        return S_OK;
+    }
+
+    const UINT32 UsedCount = static_cast<UINT32>(Data.size() / Stride);
+    if (UsedCount == 0)
+    {
+        Tracker.CompleteUpdate();
+        return S_OK;
+    }
+
+    // Busy, never written or mostly dirty copies are renamed and rewritten whole
+    const EDynamicMapMode Mode = Tracker.ChooseMapMode(UsedCount, bCopyIdle);
+
+    uint8* Destination = static_cast<uint8*>(Context.Map(Buffer, ToRHIMapMode(Mode)));
+    if (!Destination)
+    {
+        LOG_ERROR("Dynamic mesh buffer map failed");
+        return E_FAIL;
+    }
+
+    if (Mode == EDynamicMapMode::Discard)
+    {
+        std::memcpy(Destination, Data.data(), Data.size());
+        Stats.BytesWritten += Data.size();
+        ++Stats.DiscardMaps;
+    }
+    else
+    {
+        for (const FDynamicRange& Range : Tracker.GetPendingRanges())
+        {
+            if (Range.First >= UsedCount)
+            {
+                break;
+            }
+            const size_t Count = Range.Count < UsedCount - Range.First ? Range.Count : UsedCount - Range.First;
+            const size_t Offset = static_cast<size_t>(Range.First) * Stride;
+            std::memcpy(Destination + Offset, Data.data() + Offset, Count * Stride);
+            Stats.BytesWritten += Count * Stride;
+        }
+        ++Stats.NoOverwriteMaps;
+    }
+
+    Context.Unmap(Buffer);
+    Tracker.CompleteUpdate();
+    return S_OK;
+}
+
+FDynamicMeshSection KDynamicMesh::GetSection() const
+{
+    FDynamicMeshSection Section;
+    if (VertexStride > 0)
+    {
+        Section.VertexCount = static_cast<UINT32>(VertexData.size() / VertexStride);
+        Section.IndexCount = static_cast<UINT32>(IndexData.size() / GetIndexStride());
+    }
+    return Section;
+}
+
+void KDynamicMesh::Bind(KRenderStateCache& StateCache) const
+{
+    StateCache.SetVertexBuffer(0, VertexBuffers[CurrentCopy].Get(), VertexStride, 0);
+
+    if (HasIndices())
+    {
+        StateCache.SetIndexBuffer(IndexBuffers[CurrentCopy].Get(), Settings.IndexFormat, 0);
+    }
+
+    StateCache.SetPrimitiveTopology(Settings.Topology);
+}
+
+void KDynamicMesh::Draw(IRHICommandContext& Context, const FDynamicMeshSection& Section) const
+{
+    if (Section.IndexCount > 0)
+    {
+        Context.DrawIndexed(Section.IndexCount, Section.StartIndex, static_cast<int32>(Section.BaseVertex));
+    }
+    else if (Section.VertexCount > 0)
+    {
+        Context.Draw(Section.VertexCount, Section.BaseVertex);
+    }
+}
+
+void KDynamicMesh::Cleanup()
+{
+    for (UINT32 Copy = 0; Copy < KDynamicRangeTracker::MaxCopies; ++Copy)
+    {
+        VertexBuffers[Copy].Reset();
+        IndexBuffers[Copy].Reset();
+        CopyFences[Copy].Reset();
+        bCopyFenceSignaled[Copy] = false;
+    }
+
+    VertexData.clear();
+    IndexData.clear();
+    VertexCapacity = 0;
+    IndexCapacity = 0;
+    CurrentCopy = 0;
+    bMapped = false;
+    bIndicesMapped = false;
+    Stats = FDynamicMeshStats();
+    Device = nullptr;
+}
@@ -0,0 +1,220 @@
+﻿#pragma once
+
+#include "../Utils/Common.h"
+#include "../Utils/Logger.h"
+#include "GraphicsTypes.h"
+#include "VertexFormat.h"
+#include "DynamicBuffer.h"
+#include "../RHI/RHI.h"
+
+/**
+ * @brief How the contents of a dynamic mesh change
+ */
+enum class EDynamicMeshUsage : uint8
+{
+    Stream,         // Regenerated every frame (trails, UI, debug geometry): appended ranges
+    Persistent      // Kept across frames and partially updated (deformables): multi-buffered copies
+};
+
+/**
+ * @brief Dynamic mesh creation settings (capacities in vertices / indices)
+ */
+struct FDynamicMeshSettings
+{
+    EDynamicMeshUsage Usage = EDynamicMeshUsage::Stream;
+    EVertexLayout Layout = EVertexLayout::Standard;     // Single-stream, unquantized: Standard or Compact
+    EIndexFormat IndexFormat = EIndexFormat::UInt16;
+    EPrimitiveTopology Topology = EPrimitiveTopology::TriangleList;
+    UINT32 VertexCapacity = 4096;
+    UINT32 IndexCapacity = 8192;                        // 0 for non-indexed geometry
+    UINT32 BufferCount = 3;                             // Persistent: GPU copies, at least frames in flight + 1
+    FDynamicGrowthPolicy Growth;
+};
+
+/**
+ * @brief Drawable range of a dynamic mesh
+ */
+struct FDynamicMeshSection
+{
+    UINT32 BaseVertex = 0;
+    UINT32 VertexCount = 0;
+    UINT32 StartIndex = 0;      // Indices are relative to BaseVertex
+    UINT32 IndexCount = 0;
+};
+
+/**
+ * @brief Mapped memory of an appended range, valid until Unmap
+ */
+struct FDynamicMeshWriter
+{
+    void* Vertices = nullptr;   // VertexCount vertices in the mesh's layout
+    void* Indices = nullptr;    // IndexCount indices in the mesh's index format (nullptr if none)
+    FDynamicMeshSection Section;
+};
+
+/**
+ * @brief Dynamic mesh counters (cumulative)
+ */
+struct FDynamicMeshStats
+{
+    UINT32 DiscardMaps = 0;
+    UINT32 NoOverwriteMaps = 0;
+    UINT32 Reallocations = 0;
+    UINT64 BytesWritten = 0;
+};
+
+/**
+ * @brief Mesh with CPU-written dynamic vertex and index buffers
+ *
+ * Stream meshes append each frame's geometry with map-no-overwrite and
+ * map-discard when a buffer is full (see KDynamicAppendCursor); every append
+ * returns a section to draw. Persistent meshes keep a CPU copy that is
+ * updated by range and mirrored to BufferCount GPU copies; Flush rotates to
+ * the next copy and writes only the ranges it missed (see
+ * KDynamicRangeTracker). Both grow their buffers per the growth policy.
+ * Sections drawn through a state cache must be drawn before the next append
+ * could discard, so dynamic meshes are drawn immediately, not queued.
+ */
+class KDynamicMesh
+{
+public:
+    KDynamicMesh() = default;
+    ~KDynamicMesh() = default;
+
+    // Prevent copying
+    KDynamicMesh(const KDynamicMesh&) = delete;
+    KDynamicMesh& operator=(const KDynamicMesh&) = delete;
+
+    /**
+     * @brief Create the dynamic buffers
+     * @param InDevice RHI device
+     * @param InSettings Usage, layout and initial capacities
+     * @return Success: S_OK
+     */
+    HRESULT Initialize(IRHIDevice* InDevice, const FDynamicMeshSettings& InSettings);
+
+    /**
+     * @brief Stream: start a frame, growing buffers the last frame overflowed
+     */
+    void BeginFrame();
+
+    /**
+     * @brief Stream: reserve and map a range to generate geometry into
+     *
+     * Buffers too small for the range are grown first. Call Unmap before
+     * drawing; only one range can be mapped at a time.
+     * @param Context RHI command context
+     * @param VertexCount Vertices of the range (at most 65536 with 16-bit indices)
+     * @param IndexCount Indices of the range, 0 for non-indexed geometry
+     * @param OutWriter Mapped memory and the section to draw
+     * @return false if the range cannot be allocated or mapped
+     */
+    bool Map(IRHICommandContext& Context, UINT32 VertexCount, UINT32 IndexCount, FDynamicMeshWriter& OutWriter);
+    void Unmap(IRHICommandContext& Context);
+
+    /**
+     * @brief Stream: copy geometry into a new range (Map, copy, Unmap)
+     * @param Vertices VertexCount vertices in the mesh's layout
+     * @param Indices IndexCount indices in the mesh's index format, relative to the first vertex
+     */
+    bool Append(IRHICommandContext& Context, const void* Vertices, UINT32 VertexCount,
+                const void* Indices, UINT32 IndexCount, FDynamicMeshSection& OutSection);
+
+    /**
+     * @brief Persistent: replace all vertices / indices of the CPU copy
+     */
+    bool SetVertices(const void* Vertices, UINT32 Count);
+    bool SetIndices(const void* Indices, UINT32 Count);
+
+    /**
+     * @brief Persistent: overwrite a range of the CPU copy (within the current count)
+     */
+    bool UpdateVertices(UINT32 First, UINT32 Count, const void* Vertices);
+    bool UpdateIndices(UINT32 First, UINT32 Count, const void* Indices);
+
+    /**
+     * @brief Persistent: bring the GPU copy drawn next up to date
+     *
+     * Call once per frame after the updates and before drawing; does nothing
+     * if nothing changed.
+     * @param Context RHI command context
+     * @return Success: S_OK
+     */
+    HRESULT Flush(IRHICommandContext& Context);
+
+    /**
+     * @brief Persistent: the whole mesh
+     */
+    FDynamicMeshSection GetSection() const;
+
+    /**
+     * @brief Bind the current vertex/index buffers and topology through a state cache
+     */
+    void Bind(KRenderStateCache& StateCache) const;
+
+    /**
+     * @brief Draw a section (buffers must already be bound)
+     */
+    void Draw(IRHICommandContext& Context, const FDynamicMeshSection& Section) const;
+
+    /**
+     * @brief Cleanup resources
+     */
+    void Cleanup();
+
+    // Accessors
+    EDynamicMeshUsage GetUsage() const { return Settings.Usage; }
+    EVertexLayout GetVertexLayout() const { return Settings.Layout; }
+    EIndexFormat GetIndexFormat() const { return Settings.IndexFormat; }
+    UINT32 GetVertexStride() const { return VertexStride; }
+    UINT32 GetIndexStride() const { return Settings.IndexFormat == EIndexFormat::UInt16 ? 2 : 4; }
+    UINT32 GetVertexCapacity() const { return VertexCapacity; }
+    UINT32 GetIndexCapacity() const { return IndexCapacity; }
+    bool HasIndices() const { return Settings.IndexCapacity > 0; }
+    const FDynamicMeshStats& GetStats() const { return Stats; }
+
+private:
+    /**
+     * @brief (Re)create the buffers of every copy with the given capacities
+     */
+    HRESULT CreateBuffers(UINT32 InVertexCapacity, UINT32 InIndexCapacity);
+
+    /**
+     * @brief Recreate the buffers with larger capacities
+     */
+    HRESULT Reallocate(UINT32 InVertexCapacity, UINT32 InIndexCapacity);
+
+    /**
+     * @brief Write the CPU copy into the current GPU copy of one buffer
+     */
+    HRESULT UploadPending(IRHICommandContext& Context, FRHIResource Buffer, KDynamicRangeTracker& Tracker,
+                          const std::vector<uint8>& Data, UINT32 Stride, bool bCopyIdle);
+
+private:
+    std::shared_ptr<IRHIDevice> Device;
+    FDynamicMeshSettings Settings;
+    UINT32 VertexStride = 0;
+    UINT32 VertexCapacity = 0;
+    UINT32 IndexCapacity = 0;
+
+    // One buffer pair for stream meshes, BufferCount pairs for persistent meshes
+    FRHIResourceRef VertexBuffers[KDynamicRangeTracker::MaxCopies];
+    FRHIResourceRef IndexBuffers[KDynamicRangeTracker::MaxCopies];
+    UINT32 CurrentCopy = 0;
+
+    // Stream state
+    KDynamicAppendCursor VertexCursor;
+    KDynamicAppendCursor IndexCursor;
+    bool bMapped = false;
+    bool bIndicesMapped = false;
+
+    // Persistent state: CPU copies, dirty ranges and a fence per GPU copy
+    std::vector<uint8> VertexData;
+    std::vector<uint8> IndexData;
+    KDynamicRangeTracker VertexTracker;
+    KDynamicRangeTracker IndexTracker;
+    FRHIResourceRef CopyFences[KDynamicRangeTracker::MaxCopies];
+    bool bCopyFenceSignaled[KDynamicRangeTracker::MaxCopies] = {};
+
+    FDynamicMeshStats Stats;
+};
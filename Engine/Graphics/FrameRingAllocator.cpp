@@ -0,0 +1,91 @@
+﻿#include "FrameRingAllocator.h"
+
+void KFrameRingAllocator::Initialize(uint64 InCapacity)
+{
+    Capacity = InCapacity;
+    Reset();
+}
+
+uint64 KFrameRingAllocator::Allocate(uint64 Size, uint64 Alignment)
+{
+    if (Size == 0 || Size > Capacity)
+    {
+        return InvalidOffset;
+    }
+
+    // Empty ring: restart at the beginning to avoid fragmentation
+    if (UsedSize == 0)
+    {
+        Head = 0;
+        Tail = 0;
+    }
+
+    const uint64 AlignMask = Alignment > 0 ? Alignment - 1 : 0;
+    uint64 Offset = (Head + AlignMask) & ~AlignMask;
+
+    if (Head >= Tail && UsedSize < Capacity)
+    {
+        // Free space is [Head, Capacity) and [0, Tail)
+        if (Offset + Size > Capacity)
+        {
+            // Wrap: the tail end of the buffer is wasted until this frame retires
+            if (Size > Tail)
+            {
+                return InvalidOffset;
+            }
+
+            uint64 Padding = Capacity - Head;
+            UsedSize += Padding;
+            CurrentFrameSize += Padding;
+            Head = 0;
+            Offset = 0;
+        }
+    }
+    else if (Offset + Size > Tail || UsedSize == Capacity)
+    {
+        // Free space is [Head, Tail)
+        return InvalidOffset;
+    }
+
+    uint64 Consumed = (Offset - Head) + Size;
+    UsedSize += Consumed;
+    CurrentFrameSize += Consumed;
+    Head = Offset + Size;
+    if (Head == Capacity)
+    {
+        Head = 0;
+    }
+
+    return Offset;
+}
+
+void KFrameRingAllocator::FinishFrame(uint64 FenceValue)
+{
+    InFlightFrames.push_back({ FenceValue, Head, CurrentFrameSize });
+    CurrentFrameSize = 0;
+}
+
+void KFrameRingAllocator::RetireFrames(uint64 CompletedFenceValue)
+{
+    while (!InFlightFrames.empty() && InFlightFrames.front().FenceValue <= CompletedFenceValue)
+    {
+        const FFrameMarker& Frame = InFlightFrames.front();
+
+        // Empty frames may carry a stale end offset if the ring restarted at 0
+        if (Frame.Size > 0)
+        {
+            Tail = Frame.EndOffset;
+            UsedSize -= Frame.Size;
+        }
+        InFlightFrames.pop_front();
+    }
+}
+
+void KFrameRingAllocator::Reset()
+{
+    Head = 0;
+    Tail = 0;
+    UsedSize = 0;
+    CurrentFrameSize = 0;
+    InFlightFrames.clear();
+}
@@ -0,0 +1,76 @@
+﻿#pragma once
+
+#include "../Utils/Types.h"
+#include <deque>
+
+/**
+ * @brief Fence-tracked linear ring suballocator
+ *
+ * Hands out aligned ranges of a fixed-size buffer. Allocations made between two
+ * FinishFrame calls belong to one frame and are released together once the
+ * GPU fence of that frame has been reached. The caller reports each frame's
+ * fence to FinishFrame and the completed fence value to RetireFrames.
+ */
+class KFrameRingAllocator
+{
+public:
+    static constexpr uint64 InvalidOffset = ~uint64(0);
+
+    KFrameRingAllocator() = default;
+    explicit KFrameRingAllocator(uint64 InCapacity) { Initialize(InCapacity); }
+
+    /**
+     * @brief Set the managed size and release everything
+     * @param InCapacity Size of the underlying buffer in bytes
+     */
+    void Initialize(uint64 InCapacity);
+
+    /**
+     * @brief Allocate a range
+     * @param Size Size in bytes
+     * @param Alignment Alignment of the returned offset (power of two)
+     * @return Offset of the range, or InvalidOffset if the ring is full
+     */
+    uint64 Allocate(uint64 Size, uint64 Alignment);
+
+    /**
+     * @brief Close the current frame
+     * @param FenceValue Fence signaled when the GPU is done with this frame
+     */
+    void FinishFrame(uint64 FenceValue);
+
+    /**
+     * @brief Release every frame whose fence value is <= CompletedFenceValue
+     */
+    void RetireFrames(uint64 CompletedFenceValue);
+
+    /**
+     * @brief Release everything, including frames still in flight
+     *
+     * Only valid once the old contents can no longer be read by the GPU
+     * (for example after a map-discard renamed the buffer).
+     */
+    void Reset();
+
+    // Accessors
+    uint64 GetCapacity() const { return Capacity; }
+    uint64 GetUsedSize() const { return UsedSize; }
+    uint64 GetFreeSize() const { return Capacity - UsedSize; }
+    size_t GetFramesInFlight() const { return InFlightFrames.size(); }
+
+private:
+    struct FFrameMarker
+    {
+        uint64 FenceValue;
+        uint64 EndOffset;   // Head position when the frame was closed
+        uint64 Size;        // Bytes consumed, including alignment and wrap padding
+    };
+
+    uint64 Capacity = 0;
+    uint64 Head = 0;        // Next free byte
+    uint64 Tail = 0;        // Oldest byte still in use
+    uint64 UsedSize = 0;
+    uint64 CurrentFrameSize = 0;
+
+    std::deque<FFrameMarker> InFlightFrames;
+};
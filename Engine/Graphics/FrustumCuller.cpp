@@ -0,0 +1,366 @@
+﻿#include "FrustumCuller.h"
+
+#if defined(__AVX__)
+    #include <immintrin.h>
+    #define KE_CULL_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define KE_CULL_SSE 1
+#endif
+
+namespace
+{
+    bool IsBoxVisible(const FFrustum& Frustum, float CX, float CY, float CZ, float EX, float EY, float EZ)
+    {
+        for (const FPlane& Plane : Frustum.Planes)
+        {
+            const float Distance = Plane.Normal[0] * CX + Plane.Normal[1] * CY + Plane.Normal[2] * CZ + Plane.Distance;
+            const float Radius = EX * std::fabs(Plane.Normal[0]) + EY * std::fabs(Plane.Normal[1]) + EZ * std::fabs(Plane.Normal[2]);
+            if (Distance + Radius < 0.0f)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+#if defined(KE_CULL_AVX) || defined(KE_CULL_SSE)
+#if defined(KE_CULL_AVX)
+    using FCullVector = __m256;
+    inline FCullVector SplatCull(float Value) { return _mm256_set1_ps(Value); }
+#else
+    using FCullVector = __m128;
+    inline FCullVector SplatCull(float Value) { return _mm_set1_ps(Value); }
+#endif
+
+    /**
+     * @brief Plane of one view splatted across the SIMD lanes (normal, distance, absolute normal)
+     */
+    struct FSplatPlane
+    {
+        FCullVector NX, NY, NZ, D, AX, AY, AZ;
+    };
+#endif
+}
+
+void KFrustumCuller::Reset()
+{
+    CenterX.clear();
+    CenterY.clear();
+    CenterZ.clear();
+    ExtentX.clear();
+    ExtentY.clear();
+    ExtentZ.clear();
+}
+
+void KFrustumCuller::Reserve(uint32 Count)
+{
+    CenterX.reserve(Count);
+    CenterY.reserve(Count);
+    CenterZ.reserve(Count);
+    ExtentX.reserve(Count);
+    ExtentY.reserve(Count);
+    ExtentZ.reserve(Count);
+}
+
+uint32 KFrustumCuller::Add(const FBoundingBox& WorldBox)
+{
+    const uint32 Index = GetCount();
+    CenterX.push_back(WorldBox.Center[0]);
+    CenterY.push_back(WorldBox.Center[1]);
+    CenterZ.push_back(WorldBox.Center[2]);
+    ExtentX.push_back(WorldBox.Extents[0]);
+    ExtentY.push_back(WorldBox.Extents[1]);
+    ExtentZ.push_back(WorldBox.Extents[2]);
+    return Index;
+}
+
+uint32 KFrustumCuller::Cull(const FFrustum& Frustum, std::vector<uint32>& OutVisibleIndices) const
+{
+    const uint32 Count = GetCount();
+    OutVisibleIndices.resize(Count);
+
+    const uint32 VisibleCount = CullBoxes(Frustum, CenterX.data(), CenterY.data(), CenterZ.data(),
+                                          ExtentX.data(), ExtentY.data(), ExtentZ.data(),
+                                          Count, OutVisibleIndices.data());
+    OutVisibleIndices.resize(VisibleCount);
+    return VisibleCount;
+}
+
+uint32 KFrustumCuller::CullBoxes(const FFrustum& Frustum,
+                                 const float* CenterX, const float* CenterY, const float* CenterZ,
+                                 const float* ExtentX, const float* ExtentY, const float* ExtentZ,
+                                 uint32 Count, uint32* OutVisibleIndices)
+{
+    uint32 VisibleCount = 0;
+    uint32 i = 0;
+
+#if defined(KE_CULL_AVX)
+    const __m256 SignMask = _mm256_set1_ps(-0.0f);
+    __m256 PlaneNX[FFrustum::PlaneCount], PlaneNY[FFrustum::PlaneCount], PlaneNZ[FFrustum::PlaneCount], PlaneD[FFrustum::PlaneCount];
+    __m256 PlaneAX[FFrustum::PlaneCount], PlaneAY[FFrustum::PlaneCount], PlaneAZ[FFrustum::PlaneCount];
+    for (uint32 p = 0; p < FFrustum::PlaneCount; ++p)
+    {
+        PlaneNX[p] = _mm256_set1_ps(Frustum.Planes[p].Normal[0]);
+        PlaneNY[p] = _mm256_set1_ps(Frustum.Planes[p].Normal[1]);
+        PlaneNZ[p] = _mm256_set1_ps(Frustum.Planes[p].Normal[2]);
+        PlaneD[p] = _mm256_set1_ps(Frustum.Planes[p].Distance);
+        PlaneAX[p] = _mm256_andnot_ps(SignMask, PlaneNX[p]);
+        PlaneAY[p] = _mm256_andnot_ps(SignMask, PlaneNY[p]);
+        PlaneAZ[p] = _mm256_andnot_ps(SignMask, PlaneNZ[p]);
+    }
+
+    for (; i + 8 <= Count; i += 8)
+    {
+        const __m256 CX = _mm256_loadu_ps(CenterX + i);
+        const __m256 CY = _mm256_loadu_ps(CenterY + i);
+        const __m256 CZ = _mm256_loadu_ps(CenterZ + i);
+        const __m256 EX = _mm256_loadu_ps(ExtentX + i);
+        const __m256 EY = _mm256_loadu_ps(ExtentY + i);
+        const __m256 EZ = _mm256_loadu_ps(ExtentZ + i);
+
+        // A box is outside if Distance + Radius < 0 for any plane
+        __m256 Outside = _mm256_setzero_ps();
+        for (uint32 p = 0; p < FFrustum::PlaneCount; ++p)
+        {
+            __m256 Distance = _mm256_add_ps(_mm256_mul_ps(CX, PlaneNX[p]), PlaneD[p]);
+            Distance = _mm256_add_ps(Distance, _mm256_mul_ps(CY, PlaneNY[p]));
+            Distance = _mm256_add_ps(Distance, _mm256_mul_ps(CZ, PlaneNZ[p]));
+            __m256 Radius = _mm256_mul_ps(EX, PlaneAX[p]);
+            Radius = _mm256_add_ps(Radius, _mm256_mul_ps(EY, PlaneAY[p]));
+            Radius = _mm256_add_ps(Radius, _mm256_mul_ps(EZ, PlaneAZ[p]));
+            Outside = _mm256_or_ps(Outside, _mm256_cmp_ps(_mm256_add_ps(Distance, Radius), _mm256_setzero_ps(), _CMP_LT_OQ));
+        }
+
+        const uint32 VisibleMask = ~static_cast<uint32>(_mm256_movemask_ps(Outside)) & 0xFFu;
+        for (uint32 Lane = 0; Lane < 8; ++Lane)
+        {
+            // Branch-free compaction: always write, advance only when visible
+            OutVisibleIndices[VisibleCount] = i + Lane;
+            VisibleCount += (VisibleMask >> Lane) & 1u;
+        }
+    }
+#elif defined(KE_CULL_SSE)
+    const __m128 SignMask = _mm_set1_ps(-0.0f);
+    __m128 PlaneNX[FFrustum::PlaneCount], PlaneNY[FFrustum::PlaneCount], PlaneNZ[FFrustum::PlaneCount], PlaneD[FFrustum::PlaneCount];
+    __m128 PlaneAX[FFrustum::PlaneCount], PlaneAY[FFrustum::PlaneCount], PlaneAZ[FFrustum::PlaneCount];
+    for (uint32 p = 0; p < FFrustum::PlaneCount; ++p)
+    {
+        PlaneNX[p] = _mm_set1_ps(Frustum.Planes[p].Normal[0]);
+        PlaneNY[p] = _mm_set1_ps(Frustum.Planes[p].Normal[1]);
+        PlaneNZ[p] = _mm_set1_ps(Frustum.Planes[p].Normal[2]);
+        PlaneD[p] = _mm_set1_ps(Frustum.Planes[p].Distance);
+        PlaneAX[p] = _mm_andnot_ps(SignMask, PlaneNX[p]);
+        PlaneAY[p] = _mm_andnot_ps(SignMask, PlaneNY[p]);
+        PlaneAZ[p] = _mm_andnot_ps(SignMask, PlaneNZ[p]);
+    }
+
+    for (; i + 4 <= Count; i += 4)
+    {
+        const __m128 CX = _mm_loadu_ps(CenterX + i);
+        const __m128 CY = _mm_loadu_ps(CenterY + i);
+        const __m128 CZ = _mm_loadu_ps(CenterZ + i);
+        const __m128 EX = _mm_loadu_ps(ExtentX + i);
+        const __m128 EY = _mm_loadu_ps(ExtentY + i);
+        const __m128 EZ = _mm_loadu_ps(ExtentZ + i);
+
+        // A box is outside if Distance + Radius < 0 for any plane
+        __m128 Outside = _mm_setzero_ps();
+        for (uint32 p = 0; p < FFrustum::PlaneCount; ++p)
+        {
+            __m128 Distance = _mm_add_ps(_mm_mul_ps(CX, PlaneNX[p]), PlaneD[p]);
+            Distance = _mm_add_ps(Distance, _mm_mul_ps(CY, PlaneNY[p]));
+            Distance = _mm_add_ps(Distance, _mm_mul_ps(CZ, PlaneNZ[p]));
+            __m128 Radius = _mm_mul_ps(EX, PlaneAX[p]);
+            Radius = _mm_add_ps(Radius, _mm_mul_ps(EY, PlaneAY[p]));
+            Radius = _mm_add_ps(Radius, _mm_mul_ps(EZ, PlaneAZ[p]));
+            Outside = _mm_or_ps(Outside, _mm_cmplt_ps(_mm_add_ps(Distance, Radius), _mm_setzero_ps()));
+        }
+
+        const uint32 VisibleMask = ~static_cast<uint32>(_mm_movemask_ps(Outside)) & 0xFu;
+        for (uint32 Lane = 0; Lane < 4; ++Lane)
+        {
+            // Branch-free compaction: always write, advance only when visible
+            OutVisibleIndices[VisibleCount] = i + Lane;
+            VisibleCount += (VisibleMask >> Lane) & 1u;
+        }
+    }
+#endif
+
+    // Remainder (or everything without SIMD)
+    for (; i < Count; ++i)
+    {
+        if (IsBoxVisible(Frustum, CenterX[i], CenterY[i], CenterZ[i], ExtentX[i], ExtentY[i], ExtentZ[i]))
+        {
+            OutVisibleIndices[VisibleCount++] = i;
+        }
+    }
+
+    return VisibleCount;
+}
+
+uint32 KFrustumCuller::CullViews(const FFrustum* Frustums, uint32 ViewCount, std::vector<uint32>& OutViewMasks) const
+{
+    const uint32 Count = GetCount();
+    OutViewMasks.resize(Count);
+
+    return CullBoxesViews(Frustums, ViewCount, CenterX.data(), CenterY.data(), CenterZ.data(),
+                          ExtentX.data(), ExtentY.data(), ExtentZ.data(), Count, OutViewMasks.data());
+}
+
+uint32 KFrustumCuller::CullBoxesViews(const FFrustum* Frustums, uint32 ViewCount,
+                                      const float* CenterX, const float* CenterY, const float* CenterZ,
+                                      const float* ExtentX, const float* ExtentY, const float* ExtentZ,
+                                      uint32 Count, uint32* OutViewMasks)
+{
+    ViewCount = ViewCount < MaxViews ? ViewCount : MaxViews;
+    if (!Frustums || ViewCount == 0)
+    {
+        for (uint32 i = 0; i < Count; ++i)
+        {
+            OutViewMasks[i] = 0;
+        }
+        return 0;
+    }
+
+    uint32 i = 0;
+
+#if defined(KE_CULL_AVX) || defined(KE_CULL_SSE)
+    // Planes of every view, splatted once per call
+    FSplatPlane Planes[MaxViews * FFrustum::PlaneCount];
+    for (uint32 View = 0; View < ViewCount; ++View)
+    {
+        for (uint32 p = 0; p < FFrustum::PlaneCount; ++p)
+        {
+            const FPlane& Plane = Frustums[View].Planes[p];
+            FSplatPlane& Splat = Planes[View * FFrustum::PlaneCount + p];
+            Splat.NX = SplatCull(Plane.Normal[0]);
+            Splat.NY = SplatCull(Plane.Normal[1]);
+            Splat.NZ = SplatCull(Plane.Normal[2]);
+            Splat.D = SplatCull(Plane.Distance);
+            Splat.AX = SplatCull(std::fabs(Plane.Normal[0]));
+            Splat.AY = SplatCull(std::fabs(Plane.Normal[1]));
+            Splat.AZ = SplatCull(std::fabs(Plane.Normal[2]));
+        }
+    }
+
+#if defined(KE_CULL_AVX)
+    for (; i + 8 <= Count; i += 8)
+    {
+        const __m256 CX = _mm256_loadu_ps(CenterX + i);
+        const __m256 CY = _mm256_loadu_ps(CenterY + i);
+        const __m256 CZ = _mm256_loadu_ps(CenterZ + i);
+        const __m256 EX = _mm256_loadu_ps(ExtentX + i);
+        const __m256 EY = _mm256_loadu_ps(ExtentY + i);
+        const __m256 EZ = _mm256_loadu_ps(ExtentZ + i);
+
+        // Masks are built as integer bit patterns in float lanes (AVX has no 256-bit integer logic)
+        __m256 ViewMasks = _mm256_setzero_ps();
+        const FSplatPlane* Plane = Planes;
+        for (uint32 View = 0; View < ViewCount; ++View)
+        {
+            __m256 Outside = _mm256_setzero_ps();
+            for (uint32 p = 0; p < FFrustum::PlaneCount; ++p, ++Plane)
+            {
+                __m256 Distance = _mm256_add_ps(_mm256_mul_ps(CX, Plane->NX), Plane->D);
+                Distance = _mm256_add_ps(Distance, _mm256_mul_ps(CY, Plane->NY));
+                Distance = _mm256_add_ps(Distance, _mm256_mul_ps(CZ, Plane->NZ));
+                __m256 Radius = _mm256_mul_ps(EX, Plane->AX);
+                Radius = _mm256_add_ps(Radius, _mm256_mul_ps(EY, Plane->AY));
+                Radius = _mm256_add_ps(Radius, _mm256_mul_ps(EZ, Plane->AZ));
+                Outside = _mm256_or_ps(Outside, _mm256_cmp_ps(_mm256_add_ps(Distance, Radius), _mm256_setzero_ps(), _CMP_LT_OQ));
+            }
+
+            const __m256 ViewBit = _mm256_castsi256_ps(_mm256_set1_epi32(static_cast<int>(1u << View)));
+            ViewMasks = _mm256_or_ps(ViewMasks, _mm256_andnot_ps(Outside, ViewBit));
+        }
+        _mm256_storeu_ps(reinterpret_cast<float*>(OutViewMasks + i), ViewMasks);
+    }
+#else
+    for (; i + 4 <= Count; i += 4)
+    {
+        const __m128 CX = _mm_loadu_ps(CenterX + i);
+        const __m128 CY = _mm_loadu_ps(CenterY + i);
+        const __m128 CZ = _mm_loadu_ps(CenterZ + i);
+        const __m128 EX = _mm_loadu_ps(ExtentX + i);
+        const __m128 EY = _mm_loadu_ps(ExtentY + i);
+        const __m128 EZ = _mm_loadu_ps(ExtentZ + i);
+
+        __m128i ViewMasks = _mm_setzero_si128();
+        const FSplatPlane* Plane = Planes;
+        for (uint32 View = 0; View < ViewCount; ++View)
+        {
+            __m128 Outside = _mm_setzero_ps();
+            for (uint32 p = 0; p < FFrustum::PlaneCount; ++p, ++Plane)
+            {
+                __m128 Distance = _mm_add_ps(_mm_mul_ps(CX, Plane->NX), Plane->D);
+                Distance = _mm_add_ps(Distance, _mm_mul_ps(CY, Plane->NY));
+                Distance = _mm_add_ps(Distance, _mm_mul_ps(CZ, Plane->NZ));
+                __m128 Radius = _mm_mul_ps(EX, Plane->AX);
+                Radius = _mm_add_ps(Radius, _mm_mul_ps(EY, Plane->AY));
+                Radius = _mm_add_ps(Radius, _mm_mul_ps(EZ, Plane->AZ));
+                Outside = _mm_or_ps(Outside, _mm_cmplt_ps(_mm_add_ps(Distance, Radius), _mm_setzero_ps()));
+            }
+
+            // Visible lanes get the view's bit
+            const __m128i ViewBit = _mm_set1_epi32(static_cast<int>(1u << View));
+            ViewMasks = _mm_or_si128(ViewMasks, _mm_andnot_si128(_mm_castps_si128(Outside), ViewBit));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(OutViewMasks + i), ViewMasks);
+    }
+#endif
+#endif
+
+    // Remainder (or everything without SIMD)
+    for (; i < Count; ++i)
+    {
+        uint32 Mask = 0;
+        for (uint32 View = 0; View < ViewCount; ++View)
+        {
+            if (IsBoxVisible(Frustums[View], CenterX[i], CenterY[i], CenterZ[i], ExtentX[i], ExtentY[i], ExtentZ[i]))
+            {
+                Mask |= 1u << View;
+            }
+        }
+        OutViewMasks[i] = Mask;
+    }
+
+    uint32 VisibleCount = 0;
+    for (i = 0; i < Count; ++i)
+    {
+        VisibleCount += OutViewMasks[i] != 0 ? 1u : 0u;
+    }
+    return VisibleCount;
+}
+
+void KFrustumCuller::GatherViewIndices(const uint32* ViewMasks, uint32 Count, uint32 ViewCount,
+                                       std::vector<uint32>* OutViewIndices)
+{
+    ViewCount = ViewCount < MaxViews ? ViewCount : MaxViews;
+
+    // Visibility bits are close to random, so every index is stored and only kept if its bit is set
+    for (uint32 View = 0; View < ViewCount; ++View)
+    {
+        std::vector<uint32>& Indices = OutViewIndices[View];
+        Indices.resize(Count);
+        uint32* Output = Indices.data();
+        uint32 Size = 0;
+        for (uint32 i = 0; i < Count; ++i)
+        {
+            Output[Size] = i;
+            Size += (ViewMasks[i] >> View) & 1u;
+        }
+        Indices.resize(Size);
+    }
+}
+
+uint32 KFrustumCuller::GetSimdWidth()
+{
+#if defined(KE_CULL_AVX)
+    return 8;
+#elif defined(KE_CULL_SSE)
+    return 4;
+#else
+    return 1;
+#endif
+}
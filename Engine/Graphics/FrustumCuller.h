@@ -0,0 +1,121 @@
+﻿#pragma once
+
+#include <vector>
+
+#include "../Utils/Types.h"
+#include "../Utils/Bounds.h"
+
+/**
+ * @brief Culling statistics
+ */
+struct FCullingStats
+{
+    uint64 Tested = 0;
+    uint64 Culled = 0;
+    uint64 Occluded = 0;    // Passed the frustum test but hidden behind occluders
+};
+
+/**
+ * @brief Batch frustum culler for world-space boxes
+ *
+ * Boxes are stored as structure of arrays and tested 8 (AVX) or 4 (SSE)
+ * at a time against all frustum planes; other targets use a scalar loop.
+ * Platform independent.
+ */
+class KFrustumCuller
+{
+public:
+    // Views of a multi-view cull (bits of a view mask)
+    static constexpr uint32 MaxViews = 32;
+
+    KFrustumCuller() = default;
+
+    /**
+     * @brief Remove all boxes
+     */
+    void Reset();
+
+    void Reserve(uint32 Count);
+
+    /**
+     * @brief Add a world-space box
+     * @return Index of the box
+     */
+    uint32 Add(const FBoundingBox& WorldBox);
+
+    uint32 GetCount() const { return static_cast<uint32>(CenterX.size()); }
+
+    /**
+     * @brief Get a box added earlier
+     */
+    FBoundingBox GetBox(uint32 Index) const
+    {
+        FBoundingBox Box;
+        Box.Center[0] = CenterX[Index];
+        Box.Center[1] = CenterY[Index];
+        Box.Center[2] = CenterZ[Index];
+        Box.Extents[0] = ExtentX[Index];
+        Box.Extents[1] = ExtentY[Index];
+        Box.Extents[2] = ExtentZ[Index];
+        return Box;
+    }
+
+    /**
+     * @brief Test every box against the frustum
+     * @param Frustum Frustum with inward-facing planes
+     * @param OutVisibleIndices Receives the indices of visible boxes in increasing order
+     * @return Number of visible boxes
+     */
+    uint32 Cull(const FFrustum& Frustum, std::vector<uint32>& OutVisibleIndices) const;
+
+    /**
+     * @brief Test boxes given as structure of arrays
+     * @param OutVisibleIndices Must hold Count entries; receives indices of visible boxes
+     * @return Number of visible boxes
+     */
+    static uint32 CullBoxes(const FFrustum& Frustum,
+                            const float* CenterX, const float* CenterY, const float* CenterZ,
+                            const float* ExtentX, const float* ExtentY, const float* ExtentZ,
+                            uint32 Count, uint32* OutVisibleIndices);
+
+    /**
+     * @brief Test every box against several frusta in one pass
+     *
+     * Each box is loaded once and tested against all views.
+     * @param Frustums One frustum per view
+     * @param ViewCount Number of views (at most MaxViews)
+     * @param OutViewMasks Receives one mask per box; bit v is set if the box is visible in view v
+     * @return Number of boxes visible in at least one view
+     */
+    uint32 CullViews(const FFrustum* Frustums, uint32 ViewCount, std::vector<uint32>& OutViewMasks) const;
+
+    /**
+     * @brief Multi-view test of boxes given as structure of arrays
+     * @param OutViewMasks Must hold Count entries
+     * @return Number of boxes visible in at least one view
+     */
+    static uint32 CullBoxesViews(const FFrustum* Frustums, uint32 ViewCount,
+                                 const float* CenterX, const float* CenterY, const float* CenterZ,
+                                 const float* ExtentX, const float* ExtentY, const float* ExtentZ,
+                                 uint32 Count, uint32* OutViewMasks);
+
+    /**
+     * @brief Split view masks into per-view lists of box indices (in increasing order)
+     * @param OutViewIndices Array of ViewCount lists
+     */
+    static void GatherViewIndices(const uint32* ViewMasks, uint32 Count, uint32 ViewCount,
+                                  std::vector<uint32>* OutViewIndices);
+
+    /**
+     * @brief Number of boxes tested per SIMD iteration on this build (1 for scalar)
+     */
+    static uint32 GetSimdWidth();
+
+private:
+    std::vector<float> CenterX;
+    std::vector<float> CenterY;
+    std::vector<float> CenterZ;
+    std::vector<float> ExtentX;
+    std::vector<float> ExtentY;
+    std::vector<float> ExtentZ;
+};
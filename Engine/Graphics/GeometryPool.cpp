@@ -0,0 +1,303 @@
+﻿#include "GeometryPool.h"
+#include "../Core/Profiler.h"
+
+HRESULT KGeometryPool::Initialize(IRHIDevice* InDevice, IRHICommandContext* InContext,
+                                  UINT32 InPageVertices, UINT32 InPageIndices)
+{
+    if (!InDevice || !InContext || InPageVertices == 0 || InPageIndices == 0)
+    {
+        LOG_ERROR("Invalid geometry pool parameters");
+        return E_INVALIDARG;
+    }
+
+    Cleanup();
+
+    Device = RHI::ShareDevice(InDevice);
+    Context = InContext;
+    PageVertices = InPageVertices;
+    PageIndices = InPageIndices;
+
+    // Vertex arenas by layout, then 16-bit and 32-bit index arenas
+    Arenas.resize(VertexLayoutCount + 2);
+    for (UINT32 Layout = 0; Layout < VertexLayoutCount; ++Layout)
+    {
+        FArena& Arena = Arenas[Layout];
+        Arena.StreamCount = VertexFormat::GetStreamCount(static_cast<EVertexLayout>(Layout));
+        for (UINT32 Stream = 0; Stream < Arena.StreamCount; ++Stream)
+        {
+            Arena.Strides[Stream] = VertexFormat::GetStreamStride(static_cast<EVertexLayout>(Layout), Stream);
+        }
+        Arena.BindFlags = RHIBindFlags::VertexBuffer;
+    }
+
+    FArena& ShortIndexArena = Arenas[GetIndexArena(EIndexFormat::UInt16)];
+    ShortIndexArena.StreamCount = 1;
+    ShortIndexArena.Strides[0] = sizeof(uint16);
+    ShortIndexArena.BindFlags = RHIBindFlags::IndexBuffer;
+
+    FArena& IndexArena = Arenas[GetIndexArena(EIndexFormat::UInt32)];
+    IndexArena.StreamCount = 1;
+    IndexArena.Strides[0] = sizeof(uint32);
+    IndexArena.BindFlags = RHIBindFlags::IndexBuffer;
+
+    LOG_INFO("Geometry pool initialized, page vertices: " + std::to_string(PageVertices) +
+             ", page indices: " + std::to_string(PageIndices));
+    return S_OK;
+}
+
+HRESULT KGeometryPool::AllocateVertices(EVertexLayout Layout, const void* const* Streams, UINT32 VertexCount,
+                                        FGeometryPoolRange& OutRange)
+{
+    const UINT32 ArenaIndex = static_cast<UINT32>(Layout);
+    if (!IsInitialized() || ArenaIndex >= VertexLayoutCount || VertexCount == 0)
+    {
+        return E_INVALIDARG;
+    }
+
+    const FArena& Arena = Arenas[ArenaIndex];
+    for (UINT32 Stream = 0; Stream < Arena.StreamCount; ++Stream)
+    {
+        if (!Streams[Stream])
+        {
+            return E_INVALIDARG;
+        }
+    }
+
+    HRESULT hr = AllocateRange(ArenaIndex, VertexCount, OutRange);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    // All streams share the vertex offset, so one base vertex addresses them
+    const UINT32 Offset = GetOffset(OutRange);
+    for (UINT32 Stream = 0; Stream < Arena.StreamCount; ++Stream)
+    {
+        const UINT32 Stride = Arena.Strides[Stream];
+        Context->UpdateBufferRegion(GetBuffer(OutRange, Stream), Offset * Stride, Streams[Stream], VertexCount * Stride);
+    }
+    return S_OK;
+}
+
+HRESULT KGeometryPool::AllocateIndices(EIndexFormat Format, const void* Indices, UINT32 IndexCount,
+                                       FGeometryPoolRange& OutRange)
+{
+    if (!IsInitialized() || !Indices || IndexCount == 0)
+    {
+        return E_INVALIDARG;
+    }
+
+    const UINT32 ArenaIndex = GetIndexArena(Format);
+    HRESULT hr = AllocateRange(ArenaIndex, IndexCount, OutRange);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    const UINT32 Stride = Arenas[ArenaIndex].Strides[0];
+    const UINT32 Offset = GetOffset(OutRange);
+    Context->UpdateBufferRegion(GetBuffer(OutRange), Offset * Stride, Indices, IndexCount * Stride);
+    return S_OK;
+}
+
+void KGeometryPool::Free(FGeometryPoolRange& Range)
+{
+    if (!Range.IsValid() || Range.Arena >= Arenas.size() || Range.Page >= Arenas[Range.Arena].Pages.size())
+    {
+        Range = FGeometryPoolRange();
+        return;
+    }
+
+    FPage& Page = Arenas[Range.Arena].Pages[Range.Page];
+    Page.Allocator.Free(Range.Handle);
+
+    // Give memory of emptied extra pages back; the slot is reused by the next new page
+    if (Range.Page > 0 && Page.Allocator.GetAllocationCount() == 0)
+    {
+        for (FRHIResourceRef& Buffer : Page.Buffers)
+        {
+            Buffer.Reset();
+        }
+        Page.Allocator.Initialize(0);
+    }
+
+    Range = FGeometryPoolRange();
+}
+
+UINT32 KGeometryPool::Defragment(float MinFragmentation)
+{
+    KE_PROFILE_FUNCTION();
+
+    UINT32 MovedCount = 0;
+    for (FArena& Arena : Arenas)
+    {
+        for (FPage& Page : Arena.Pages)
+        {
+            if (!Page.Buffers[0] || Page.Allocator.GetFragmentation() < MinFragmentation)
+            {
+                continue;
+            }
+
+            // Overlapping copies within one buffer are undefined; compact into a new one
+            FPage Compacted;
+            if (FAILED(CreatePageBuffers(Arena, Page.Allocator.GetCapacity(), Compacted)))
+            {
+                LOG_WARNING("Geometry pool defragmentation skipped a page: buffer creation failed");
+                continue;
+            }
+
+            Page.Allocator.Defragment(Relocations);
+
+            // Ranges in front of the first gap keep their offsets
+            const UINT32 PrefixSize = Relocations.empty() ? Page.Allocator.GetUsedSize() : Relocations[0].NewOffset;
+            for (UINT32 Stream = 0; Stream < Arena.StreamCount; ++Stream)
+            {
+                FRHIResource Source = Page.Buffers[Stream].Get();
+                FRHIResource Destination = Compacted.Buffers[Stream].Get();
+                const UINT32 Stride = Arena.Strides[Stream];
+
+                if (PrefixSize > 0)
+                {
+                    Context->CopyBufferRegion(Destination, 0, Source, 0, PrefixSize * Stride);
+                }
+
+                for (const KTLSFAllocator::FRelocation& Relocation : Relocations)
+                {
+                    Context->CopyBufferRegion(Destination, Relocation.NewOffset * Stride,
+                                              Source, Relocation.OldOffset * Stride, Relocation.Size * Stride);
+                }
+
+                Page.Buffers[Stream] = std::move(Compacted.Buffers[Stream]);
+            }
+
+            MovedCount += static_cast<UINT32>(Relocations.size());
+        }
+    }
+
+    if (MovedCount > 0)
+    {
+        LOG_INFO("Geometry pool defragmented, moved ranges: " + std::to_string(MovedCount));
+    }
+    return MovedCount;
+}
+
+void KGeometryPool::Cleanup()
+{
+    Arenas.clear();
+    Relocations.clear();
+    Device = nullptr;
+    Context = nullptr;
+}
+
+FGeometryPoolStats KGeometryPool::GetStats() const
+{
+    FGeometryPoolStats Stats;
+    for (const FArena& Arena : Arenas)
+    {
+        UINT32 ElementSize = 0;
+        for (UINT32 Stream = 0; Stream < Arena.StreamCount; ++Stream)
+        {
+            ElementSize += Arena.Strides[Stream];
+        }
+
+        for (const FPage& Page : Arena.Pages)
+        {
+            if (!Page.Buffers[0])
+            {
+                continue;
+            }
+
+            ++Stats.PageCount;
+            Stats.AllocationCount += Page.Allocator.GetAllocationCount();
+            Stats.FreeBlockCount += Page.Allocator.GetFreeBlockCount();
+            Stats.CapacityBytes += static_cast<UINT64>(Page.Allocator.GetCapacity()) * ElementSize;
+            Stats.UsedBytes += static_cast<UINT64>(Page.Allocator.GetUsedSize()) * ElementSize;
+            Stats.LargestFreeBytes += static_cast<UINT64>(Page.Allocator.GetLargestFreeBlock()) * ElementSize;
+        }
+    }
+    return Stats;
+}
+
+HRESULT KGeometryPool::AllocateRange(UINT32 ArenaIndex, UINT32 Count, FGeometryPoolRange& OutRange)
+{
+    FArena& Arena = Arenas[ArenaIndex];
+
+    // First page with room
+    UINT32 FreeSlot = FGeometryPoolRange::InvalidIndex;
+    for (UINT32 PageIndex = 0; PageIndex < Arena.Pages.size(); ++PageIndex)
+    {
+        FPage& Page = Arena.Pages[PageIndex];
+        if (!Page.Buffers[0])
+        {
+            if (FreeSlot == FGeometryPoolRange::InvalidIndex)
+            {
+                FreeSlot = PageIndex;
+            }
+            continue;
+        }
+
+        const UINT32 Handle = Page.Allocator.Allocate(Count);
+        if (Handle != KTLSFAllocator::InvalidHandle)
+        {
+            OutRange.Arena = ArenaIndex;
+            OutRange.Page = PageIndex;
+            OutRange.Handle = Handle;
+            return S_OK;
+        }
+    }
+
+    // New page, sized up for ranges larger than a page
+    const UINT32 PageSize = Arena.BindFlags == RHIBindFlags::IndexBuffer ? PageIndices : PageVertices;
+    const UINT32 Capacity = Count > PageSize ? Count : PageSize;
+
+    FPage NewPage;
+    HRESULT hr = CreatePageBuffers(Arena, Capacity, NewPage);
+    if (FAILED(hr))
+    {
+        KLogger::HResultError(hr, "Geometry pool page creation failed");
+        return hr;
+    }
+    NewPage.Allocator.Initialize(Capacity);
+
+    if (FreeSlot == FGeometryPoolRange::InvalidIndex)
+    {
+        FreeSlot = static_cast<UINT32>(Arena.Pages.size());
+        Arena.Pages.push_back(std::move(NewPage));
+    }
+    else
+    {
+        Arena.Pages[FreeSlot] = std::move(NewPage);
+    }
+
+    OutRange.Arena = ArenaIndex;
+    OutRange.Page = FreeSlot;
+    OutRange.Handle = Arena.Pages[FreeSlot].Allocator.Allocate(Count);
+
+    LOG_INFO("Geometry pool page created, arena: " + std::to_string(ArenaIndex) +
+             ", elements: " + std::to_string(Capacity));
+    return S_OK;
+}
+
+HRESULT KGeometryPool::CreatePageBuffers(const FArena& Arena, UINT32 Capacity, FPage& Page) const
+{
+    for (UINT32 Stream = 0; Stream < Arena.StreamCount; ++Stream)
+    {
+        const UINT64 ByteWidth = static_cast<UINT64>(Capacity) * Arena.Strides[Stream];
+        if (ByteWidth > 0xFFFFFFFFull)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        FRHIBufferDesc BufferDesc;
+        BufferDesc.Usage = ERHIBufferUsage::Default;
+        BufferDesc.ByteWidth = static_cast<UINT32>(ByteWidth);
+        BufferDesc.BindFlags = Arena.BindFlags;
+
+        Page.Buffers[Stream].Reset(Device.get(), Device->CreateBuffer(BufferDesc, nullptr));
+        if (!Page.Buffers[Stream])
+        {
+            return E_OUTOFMEMORY;
+        }
+    }
+    return S_OK;
+}
@@ -0,0 +1,234 @@
+﻿#pragma once
+
+#include "../Utils/Common.h"
+#include "../Utils/Logger.h"
+#include "GraphicsTypes.h"
+#include "VertexFormat.h"
+#include "TLSFAllocator.h"
+#include "../RHI/RHI.h"
+
+/**
+ * @brief Range of a geometry pool page owned by one mesh
+ *
+ * Offsets are in vertices or indices and may change when the pool is
+ * defragmented; read them through the pool at draw time.
+ */
+struct FGeometryPoolRange
+{
+    static constexpr UINT32 InvalidIndex = ~0u;
+
+    UINT32 Arena = InvalidIndex;
+    UINT32 Page = InvalidIndex;
+    UINT32 Handle = KTLSFAllocator::InvalidHandle;
+
+    bool IsValid() const { return Arena != InvalidIndex; }
+};
+
+/**
+ * @brief Occupancy and fragmentation of the pool
+ */
+struct FGeometryPoolStats
+{
+    UINT32 PageCount = 0;
+    UINT32 AllocationCount = 0;
+    UINT32 FreeBlockCount = 0;
+    UINT64 CapacityBytes = 0;
+    UINT64 UsedBytes = 0;
+    UINT64 LargestFreeBytes = 0;     // Sum over pages of each page's largest free range
+
+    float GetOccupancy() const { return CapacityBytes > 0 ? static_cast<float>(UsedBytes) / CapacityBytes : 0.0f; }
+
+    /**
+     * @brief 1 - largest free ranges / free bytes (0: every page's free space is contiguous)
+     */
+    float GetFragmentation() const
+    {
+        const UINT64 FreeBytes = CapacityBytes - UsedBytes;
+        return FreeBytes > 0 ? 1.0f - static_cast<float>(LargestFreeBytes) / FreeBytes : 0.0f;
+    }
+};
+
+/**
+ * @brief Shared vertex/index buffers suballocated between meshes
+ * 
+ * Keeps one arena per vertex layout (one buffer per stream, ranges in
+ * vertices) and per index format (ranges in indices). Each arena is a list
+ * of large default-usage pages managed by a TLSF allocator; meshes draw with
+ * base-vertex and start-index offsets, so meshes of one page share their
+ * buffer bindings. A range larger than a page gets a page of its own.
+ */
+class KGeometryPool
+{
+public:
+    static constexpr UINT32 DefaultPageVertices = 256 * 1024;
+    static constexpr UINT32 DefaultPageIndices = 1024 * 1024;
+
+    KGeometryPool() = default;
+    ~KGeometryPool() = default;
+
+    // Prevent copying
+    KGeometryPool(const KGeometryPool&) = delete;
+    KGeometryPool& operator=(const KGeometryPool&) = delete;
+
+    /**
+     * @brief Set up the arenas (pages are created on first use)
+     * @param Device RHI device
+     * @param Context Command context used to upload and move ranges
+     * @param PageVertices Vertices per vertex page
+     * @param PageIndices Indices per index page
+     * @return S_OK on success
+     */
+    HRESULT Initialize(IRHIDevice* Device, IRHICommandContext* Context,
+                       UINT32 PageVertices = DefaultPageVertices, UINT32 PageIndices = DefaultPageIndices);
+
+    /**
+     * @brief Allocate a vertex range and upload encoded streams into it
+     * @param Layout Vertex layout of the streams
+     * @param Streams Encoded data of each stream of the layout (VertexCount * stride bytes)
+     * @param VertexCount Number of vertices
+     * @param OutRange Allocated range
+     * @return S_OK on success
+     */
+    HRESULT AllocateVertices(EVertexLayout Layout, const void* const* Streams, UINT32 VertexCount,
+                             FGeometryPoolRange& OutRange);
+
+    /**
+     * @brief Allocate an index range and upload indices into it
+     * @param Format Index format of the data
+     * @param Indices Index data
+     * @param IndexCount Number of indices
+     * @param OutRange Allocated range
+     * @return S_OK on success
+     */
+    HRESULT AllocateIndices(EIndexFormat Format, const void* Indices, UINT32 IndexCount, FGeometryPoolRange& OutRange);
+
+    /**
+     * @brief Release a range (resets it)
+     */
+    void Free(FGeometryPoolRange& Range);
+
+    /**
+     * @brief Compact fragmented pages
+     *
+     * Live ranges are copied to the front of a new buffer on the GPU and the
+     * old buffer is released; only offsets change, ranges stay valid.
+     * @param MinFragmentation Pages below this fragmentation are left alone
+     * @return Number of moved ranges
+     */
+    UINT32 Defragment(float MinFragmentation = 0.25f);
+
+    /**
+     * @brief Cleanup resources
+     */
+    void Cleanup();
+
+    // Range accessors
+    UINT32 GetOffset(const FGeometryPoolRange& Range) const
+    {
+        return Arenas[Range.Arena].Pages[Range.Page].Allocator.GetOffset(Range.Handle);
+    }
+    FRHIResource GetBuffer(const FGeometryPoolRange& Range, UINT32 Stream = 0) const
+    {
+        return Arenas[Range.Arena].Pages[Range.Page].Buffers[Stream].Get();
+    }
+
+    /**
+     * @brief Occupancy and fragmentation over every page
+     */
+    FGeometryPoolStats GetStats() const;
+
+    bool IsInitialized() const { return Device != nullptr; }
+
+private:
+    struct FPage
+    {
+        FRHIResourceRef Buffers[VertexFormat::MaxStreams];
+        KTLSFAllocator Allocator;
+    };
+
+    struct FArena
+    {
+        UINT32 Strides[VertexFormat::MaxStreams] = {};
+        UINT32 StreamCount = 0;
+        UINT32 BindFlags = 0;
+        std::vector<FPage> Pages;
+    };
+
+    /**
+     * @brief Allocate Count elements in an arena, creating a page if needed
+     */
+    HRESULT AllocateRange(UINT32 ArenaIndex, UINT32 Count, FGeometryPoolRange& OutRange);
+
+    /**
+     * @brief Create the buffers of a page
+     */
+    HRESULT CreatePageBuffers(const FArena& Arena, UINT32 Capacity, FPage& Page) const;
+
+    /**
+     * @brief Index arena of an index format (vertex arenas are indexed by layout)
+     */
+    static UINT32 GetIndexArena(EIndexFormat Format)
+    {
+        return VertexLayoutCount + (Format == EIndexFormat::UInt16 ? 0 : 1);
+    }
+
+private:
+    std::shared_ptr<IRHIDevice> Device;     // Shared, so a pool outliving the device's owner can still release its pages
+    IRHICommandContext* Context = nullptr;
+
+    UINT32 PageVertices = DefaultPageVertices;
+    UINT32 PageIndices = DefaultPageIndices;
+
+    std::vector<FArena> Arenas;
+    std::vector<KTLSFAllocator::FRelocation> Relocations;
+};
+
+/**
+ * @brief Pool ranges of one mesh, released when destroyed or moved over
+ */
+struct FGeometryPoolAllocation
+{
+    std::shared_ptr<KGeometryPool> Pool;
+    FGeometryPoolRange Vertices;
+    FGeometryPoolRange Indices;
+
+    FGeometryPoolAllocation() = default;
+    ~FGeometryPoolAllocation() { Release(); }
+
+    FGeometryPoolAllocation(const FGeometryPoolAllocation&) = delete;
+    FGeometryPoolAllocation& operator=(const FGeometryPoolAllocation&) = delete;
+
+    FGeometryPoolAllocation(FGeometryPoolAllocation&& Other) noexcept
+        : Pool(std::move(Other.Pool)), Vertices(Other.Vertices), Indices(Other.Indices)
+    {
+        Other.Vertices = FGeometryPoolRange();
+        Other.Indices = FGeometryPoolRange();
+    }
+
+    FGeometryPoolAllocation& operator=(FGeometryPoolAllocation&& Other) noexcept
+    {
+        if (this != &Other)
+        {
+            Release();
+            Pool = std::move(Other.Pool);
+            Vertices = Other.Vertices;
+            Indices = Other.Indices;
+            Other.Vertices = FGeometryPoolRange();
+            Other.Indices = FGeometryPoolRange();
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Free both ranges and drop the pool reference
+     */
+    void Release()
+    {
+        if (Pool)
+        {
+            Pool->Free(Vertices);
+            Pool->Free(Indices);
+            Pool.reset();
+        }
+    }
+};
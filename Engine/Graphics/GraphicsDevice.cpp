@@ -52,6 +52,8 @@ void KGraphicsDevice::Cleanup()
         Context->ClearState();
     }
 
+    // Meshes and pools still holding resources keep the RHI device alive until they are destroyed
+    RHIDevice.reset();
     RenderTargetView.Reset();
     SwapChain.Reset();
     Context.Reset();
@@ -163,6 +165,8 @@ HRESULT KGraphicsDevice::CreateDevice()
     }
 #endif
 
+    RHIDevice = std::make_shared<KD3D11RHIDevice>(Device.Get(), Context.Get());
+
     LOG_INFO("D3D11 Device created successfully");
     return S_OK;
 }
@@ -2,6 +2,7 @@
 
 #include "../Utils/Common.h"
 #include "../Utils/Logger.h"
+#include "../RHI/D3D11RHI.h"
 
 /**
  * @brief DirectX 11 Graphics Device Manager
@@ -58,6 +59,10 @@ public:
     ID3D11DeviceContext* GetContext() const { return Context.Get(); }
     IDXGISwapChain* GetSwapChain() const { return SwapChain.Get(); }
     ID3D11RenderTargetView* GetRenderTargetView() const { return RenderTargetView.Get(); }
+
+    // Render hardware interface over the same device
+    IRHIDevice* GetRHIDevice() const { return RHIDevice.get(); }
+    IRHICommandContext* GetRHIContext() const { return RHIDevice ? RHIDevice->GetImmediateContext() : nullptr; }
     
     UINT32 GetWidth() const { return Width; }
     UINT32 GetHeight() const { return Height; }
@@ -92,6 +97,8 @@ private:
     ComPtr<IDXGISwapChain> SwapChain;
     ComPtr<ID3D11RenderTargetView> RenderTargetView;
 
+    std::shared_ptr<KD3D11RHIDevice> RHIDevice;
+
     // Device settings
     // Debug interface
 #ifdef _DEBUG
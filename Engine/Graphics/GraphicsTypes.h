@@ -0,0 +1,62 @@
+﻿#pragma once
+
+#include "../Utils/Types.h"
+
+// Platform-independent graphics enumerations shared by the renderer cores
+// and the DirectX 11 implementation.
+
+/**
+ * @brief Shader type enumeration
+ */
+enum class EShaderType
+{
+    Vertex,
+    Pixel,
+    Geometry,
+    Hull,
+    Domain,
+    Compute
+};
+
+constexpr uint32 ShaderTypeCount = 6;
+
+/**
+ * @brief Primitive topology enumeration
+ */
+enum class EPrimitiveTopology : uint8
+{
+    Undefined,
+    PointList,
+    LineList,
+    LineStrip,
+    TriangleList,
+    TriangleStrip
+};
+
+/**
+ * @brief Index buffer element format
+ */
+enum class EIndexFormat : uint8
+{
+    UInt16,
+    UInt32
+};
+
+/**
+ * @brief Viewport rectangle in render target pixels
+ */
+struct FViewportRect
+{
+    float TopLeftX = 0.0f;
+    float TopLeftY = 0.0f;
+    float Width = 0.0f;
+    float Height = 0.0f;
+    float MinDepth = 0.0f;
+    float MaxDepth = 1.0f;
+
+    bool operator==(const FViewportRect& Other) const
+    {
+        return TopLeftX == Other.TopLeftX && TopLeftY == Other.TopLeftY && Width == Other.Width &&
+               Height == Other.Height && MinDepth == Other.MinDepth && MaxDepth == Other.MaxDepth;
+    }
+};
@@ -0,0 +1,356 @@
+﻿#include "LooseOctree.h"
+#include "../Core/Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    constexpr uint32 InvalidNode = 0xFFFFFFFFu;
+
+    struct FNodeEntry
+    {
+        uint32 Node;
+        uint32 State;   // Query specific (plane mask); 0 once the node is known to be fully inside
+    };
+
+    struct FNearestEntry
+    {
+        float DistanceSquared;
+        uint32 Node;
+
+        bool operator<(const FNearestEntry& Other) const
+        {
+            // Reversed for a min-heap
+            return DistanceSquared > Other.DistanceSquared;
+        }
+    };
+}
+
+KLooseOctree::KLooseOctree()
+{
+    Initialize(FLooseOctreeSettings());
+}
+
+KLooseOctree::KLooseOctree(const FLooseOctreeSettings& InSettings)
+{
+    Initialize(InSettings);
+}
+
+void KLooseOctree::Initialize(const FLooseOctreeSettings& InSettings)
+{
+    Settings = InSettings;
+    Settings.MaxDepth = std::min(Settings.MaxDepth, MaxDepthLimit);
+    Settings.HalfSize = Settings.HalfSize > 0.0f ? Settings.HalfSize : 1.0f;
+    for (uint32 Axis = 0; Axis < 3; ++Axis)
+    {
+        WorldMin[Axis] = Settings.Center[Axis] - Settings.HalfSize;
+    }
+    Clear();
+}
+
+void KLooseOctree::Clear()
+{
+    Store.Clear();
+    Nodes.clear();
+    FreeNodes.clear();
+
+    const uint32 RootCoord[3] = { 0, 0, 0 };
+    AllocateNode(InvalidNode, 0, RootCoord);
+}
+
+uint32 KLooseOctree::AllocateNode(uint32 Parent, uint32 Depth, const uint32 Coord[3])
+{
+    uint32 Index;
+    if (!FreeNodes.empty())
+    {
+        Index = FreeNodes.back();
+        FreeNodes.pop_back();
+    }
+    else
+    {
+        Index = static_cast<uint32>(Nodes.size());
+        Nodes.emplace_back();
+    }
+
+    FNode& Node = Nodes[Index];
+    const float CellSize = 2.0f * Settings.HalfSize / float(1u << Depth);
+    for (uint32 Axis = 0; Axis < 3; ++Axis)
+    {
+        const float CellMin = WorldMin[Axis] + float(Coord[Axis]) * CellSize;
+        Node.LooseMin[Axis] = CellMin - 0.5f * CellSize;
+        Node.LooseMax[Axis] = CellMin + 1.5f * CellSize;
+        Node.Coord[Axis] = Coord[Axis];
+    }
+    Node.Parent = Parent;
+    Node.SubtreeCount = 0;
+    Node.Depth = Depth;
+    std::fill(std::begin(Node.Children), std::end(Node.Children), InvalidNode);
+    return Index;
+}
+
+bool KLooseOctree::ComputeCell(const FBoundingBox& Box, uint32& OutDepth, uint32 OutCoord[3]) const
+{
+    // Deepest level whose cells are at least twice the box (the loose bounds then hold it)
+    const float Extent = std::max(Box.Extents[0], std::max(Box.Extents[1], Box.Extents[2]));
+    uint32 Depth = 0;
+    float HalfCell = Settings.HalfSize;
+    while (Depth < Settings.MaxDepth && HalfCell * 0.5f >= Extent)
+    {
+        HalfCell *= 0.5f;
+        ++Depth;
+    }
+
+    const float InvCellSize = 0.5f / HalfCell;
+    const uint32 MaxCoord = (1u << Depth) - 1;
+    for (uint32 Axis = 0; Axis < 3; ++Axis)
+    {
+        const float Local = (Box.Center[Axis] - WorldMin[Axis]) * InvCellSize;
+        if (!(Local >= 0.0f && Local < float(MaxCoord + 1)))
+        {
+            OutDepth = 0;
+            OutCoord[0] = OutCoord[1] = OutCoord[2] = 0;
+            return false;
+        }
+        OutCoord[Axis] = std::min(static_cast<uint32>(Local), MaxCoord);
+    }
+    OutDepth = Depth;
+    return true;
+}
+
+bool KLooseOctree::ContainsCell(const FNode& Node, uint32 Depth, const uint32 Coord[3]) const
+{
+    if (Node.Depth > Depth)
+    {
+        return false;
+    }
+    const uint32 Shift = Depth - Node.Depth;
+    return (Coord[0] >> Shift) == Node.Coord[0] && (Coord[1] >> Shift) == Node.Coord[1] && (Coord[2] >> Shift) == Node.Coord[2];
+}
+
+uint32 KLooseOctree::AcquirePath(uint32 Ancestor, uint32 Depth, const uint32 Coord[3])
+{
+    uint32 Node = Ancestor;
+    for (uint32 Level = Nodes[Ancestor].Depth + 1; Level <= Depth; ++Level)
+    {
+        const uint32 Shift = Depth - Level;
+        const uint32 ChildCoord[3] = { Coord[0] >> Shift, Coord[1] >> Shift, Coord[2] >> Shift };
+        const uint32 Octant = (ChildCoord[0] & 1) | ((ChildCoord[1] & 1) << 1) | ((ChildCoord[2] & 1) << 2);
+
+        uint32 Child = Nodes[Node].Children[Octant];
+        if (Child == InvalidNode)
+        {
+            Child = AllocateNode(Node, Level, ChildCoord);
+            Nodes[Node].Children[Octant] = Child;
+        }
+        Node = Child;
+        ++Nodes[Node].SubtreeCount;
+    }
+    return Node;
+}
+
+void KLooseOctree::ReleasePath(uint32 Node, uint32 Ancestor)
+{
+    while (Node != Ancestor)
+    {
+        FNode& Current = Nodes[Node];
+        const uint32 Parent = Current.Parent;
+        if (--Current.SubtreeCount == 0 && Parent != InvalidNode)
+        {
+            // Empty subtree: the node has no children left, unlink and recycle it
+            const uint32 Octant = (Current.Coord[0] & 1) | ((Current.Coord[1] & 1) << 1) | ((Current.Coord[2] & 1) << 2);
+            Nodes[Parent].Children[Octant] = InvalidNode;
+            FreeNodes.push_back(Node);
+        }
+        Node = Parent;
+    }
+}
+
+uint32 KLooseOctree::Insert(const FBoundingBox& Box, uint32 UserData)
+{
+    uint32 Depth;
+    uint32 Coord[3];
+    ComputeCell(Box, Depth, Coord);
+
+    float Min[3], Max[3];
+    SpatialQuery::ToMinMax(Box, Min, Max);
+    ++Nodes[0].SubtreeCount;
+    return Store.Insert(AcquirePath(0, Depth, Coord), Min, Max, UserData);
+}
+
+void KLooseOctree::Remove(uint32 Id)
+{
+    if (!Store.IsValid(Id))
+    {
+        return;
+    }
+
+    const uint32 Node = Store.GetBucket(Id);
+    Store.Remove(Id);
+    ReleasePath(Node, InvalidNode);
+}
+
+void KLooseOctree::Move(uint32 Id, const FBoundingBox& Box)
+{
+    if (!Store.IsValid(Id))
+    {
+        return;
+    }
+
+    float Min[3], Max[3];
+    SpatialQuery::ToMinMax(Box, Min, Max);
+    Store.SetBox(Id, Min, Max);
+
+    uint32 Depth;
+    uint32 Coord[3];
+    ComputeCell(Box, Depth, Coord);
+
+    const uint32 Node = Store.GetBucket(Id);
+    if (Nodes[Node].Depth == Depth && ContainsCell(Nodes[Node], Depth, Coord))
+    {
+        return;
+    }
+
+    // Only the paths below the common ancestor change their counts
+    uint32 Ancestor = Node;
+    while (!ContainsCell(Nodes[Ancestor], Depth, Coord))
+    {
+        Ancestor = Nodes[Ancestor].Parent;
+    }
+    Store.MoveToBucket(Id, AcquirePath(Ancestor, Depth, Coord));
+    ReleasePath(Node, Ancestor);
+}
+
+template<typename NodeTest, typename ItemTest>
+uint32 KLooseOctree::Query(uint32 InitialState, NodeTest&& TestNode, ItemTest&& TestItem, std::vector<uint32>& OutUserData) const
+{
+    const size_t FirstOutput = OutUserData.size();
+
+    FNodeEntry Stack[8 * MaxDepthLimit + 8];
+    uint32 StackSize = 0;
+    Stack[StackSize++] = { 0, InitialState };
+
+    while (StackSize > 0)
+    {
+        FNodeEntry Entry = Stack[--StackSize];
+        const FNode& Node = Nodes[Entry.Node];
+
+        // The root also holds objects outside the world cube, so it is never culled
+        if (Entry.Node != 0 && Entry.State != 0 && !TestNode(Node.LooseMin, Node.LooseMax, Entry.State))
+        {
+            continue;
+        }
+
+        const uint32 State = Entry.State;
+        Store.ForEachItem(Entry.Node, [&](const FSpatialItem& Item)
+        {
+            if (State == 0 || TestItem(Item, State))
+            {
+                OutUserData.push_back(Item.UserData);
+            }
+        });
+
+        for (uint32 Child : Node.Children)
+        {
+            if (Child != InvalidNode)
+            {
+                Stack[StackSize++] = { Child, State };
+            }
+        }
+    }
+    return static_cast<uint32>(OutUserData.size() - FirstOutput);
+}
+
+uint32 KLooseOctree::QueryFrustum(const FFrustum& Frustum, std::vector<uint32>& OutUserData) const
+{
+    KE_PROFILE_FUNCTION();
+
+    // State is the mask of planes the node is not yet known to be inside of
+    return Query(SpatialQuery::AllPlanes,
+        [&](const float Min[3], const float Max[3], uint32& State)
+        {
+            return SpatialQuery::TestFrustum(Frustum, Min, Max, State);
+        },
+        [&](const FSpatialItem& Item, uint32 State)
+        {
+            return SpatialQuery::TestFrustum(Frustum, Item.Min, Item.Max, State);
+        },
+        OutUserData);
+}
+
+uint32 KLooseOctree::QueryBox(const FBoundingBox& Box, std::vector<uint32>& OutUserData) const
+{
+    float QueryMin[3], QueryMax[3];
+    SpatialQuery::ToMinMax(Box, QueryMin, QueryMax);
+    return Query(1,
+        [&](const float Min[3], const float Max[3], uint32& State)
+        {
+            if (!SpatialQuery::Overlaps(Min, Max, QueryMin, QueryMax))
+            {
+                return false;
+            }
+            State = SpatialQuery::Contains(QueryMin, QueryMax, Min, Max) ? 0 : 1;
+            return true;
+        },
+        [&](const FSpatialItem& Item, uint32)
+        {
+            return SpatialQuery::Overlaps(Item.Min, Item.Max, QueryMin, QueryMax);
+        },
+        OutUserData);
+}
+
+uint32 KLooseOctree::QuerySphere(const FBoundingSphere& Sphere, std::vector<uint32>& OutUserData) const
+{
+    return Query(1,
+        [&](const float Min[3], const float Max[3], uint32& State)
+        {
+            if (!SpatialQuery::OverlapsSphere(Sphere, Min, Max))
+            {
+                return false;
+            }
+            State = SpatialQuery::ContainedInSphere(Sphere, Min, Max) ? 0 : 1;
+            return true;
+        },
+        [&](const FSpatialItem& Item, uint32)
+        {
+            return SpatialQuery::OverlapsSphere(Sphere, Item.Min, Item.Max);
+        },
+        OutUserData);
+}
+
+uint32 KLooseOctree::QueryNearest(const float Point[3], uint32 Count, float MaxDistance,
+                                  std::vector<FSpatialNeighbor>& OutNeighbors) const
+{
+    KNearestCollector Collector(Point, Count, MaxDistance);
+
+    // Best first: nodes in order of their loose bounds' distance, until the farthest kept item is closer
+    std::vector<FNearestEntry> Heap;
+    Heap.push_back({ 0.0f, 0 });
+    while (!Heap.empty())
+    {
+        std::pop_heap(Heap.begin(), Heap.end());
+        const FNearestEntry Entry = Heap.back();
+        Heap.pop_back();
+        if (Entry.DistanceSquared > Collector.GetLimitSquared())
+        {
+            break;
+        }
+
+        Store.ForEachItem(Entry.Node, [&](const FSpatialItem& Item) { Collector.Offer(Item); });
+
+        for (uint32 Child : Nodes[Entry.Node].Children)
+        {
+            if (Child == InvalidNode)
+            {
+                continue;
+            }
+            const float DistanceSquared = SpatialQuery::DistanceSquared(Point, Nodes[Child].LooseMin, Nodes[Child].LooseMax);
+            if (DistanceSquared <= Collector.GetLimitSquared())
+            {
+                Heap.push_back({ DistanceSquared, Child });
+                std::push_heap(Heap.begin(), Heap.end());
+            }
+        }
+    }
+    return Collector.Finish(OutNeighbors);
+}
@@ -0,0 +1,110 @@
+﻿#pragma once
+
+#include "SpatialIndex.h"
+
+/**
+ * @brief World cube and depth of a loose octree
+ */
+struct FLooseOctreeSettings
+{
+    float Center[3] = { 0.0f, 0.0f, 0.0f };
+    float HalfSize = 8192.0f;       // Half the edge of the world cube
+    uint32 MaxDepth = 10;           // Deepest level (cells of 2 * HalfSize / 2^MaxDepth)
+};
+
+/**
+ * @brief Loose octree spatial index
+ *
+ * Node bounds are twice their cell, so an object belongs to the node at the
+ * depth its size fits and the cell its center falls in, found by
+ * arithmetic. A move within that cell only updates the box (O(1)); a move
+ * to another cell relinks the object below the cells' common ancestor,
+ * usually a level or two up for small steps. Nodes
+ * are a flat array created on demand and released when their subtree
+ * empties; objects centered outside the world cube stay in the root.
+ * Platform independent.
+ */
+class KLooseOctree : public ISpatialIndex
+{
+public:
+    static constexpr uint32 MaxDepthLimit = 16;
+
+    KLooseOctree();
+    explicit KLooseOctree(const FLooseOctreeSettings& InSettings);
+
+    /**
+     * @brief Change the world cube and depth (removes every object)
+     */
+    void Initialize(const FLooseOctreeSettings& InSettings);
+    const FLooseOctreeSettings& GetSettings() const { return Settings; }
+
+    uint32 Insert(const FBoundingBox& Box, uint32 UserData) override;
+    void Remove(uint32 Id) override;
+    void Move(uint32 Id, const FBoundingBox& Box) override;
+    void Clear() override;
+    void Update(KJobSystem*) override {}
+
+    uint32 QueryFrustum(const FFrustum& Frustum, std::vector<uint32>& OutUserData) const override;
+    uint32 QueryBox(const FBoundingBox& Box, std::vector<uint32>& OutUserData) const override;
+    uint32 QuerySphere(const FBoundingSphere& Sphere, std::vector<uint32>& OutUserData) const override;
+    uint32 QueryNearest(const float Point[3], uint32 Count, float MaxDistance,
+                        std::vector<FSpatialNeighbor>& OutNeighbors) const override;
+
+    uint32 GetObjectCount() const override { return Store.GetObjectCount(); }
+    bool IsValid(uint32 Id) const override { return Store.IsValid(Id); }
+    uint32 GetUserData(uint32 Id) const override { return Store.GetItem(Id).UserData; }
+
+    uint32 GetNodeCount() const { return static_cast<uint32>(Nodes.size() - FreeNodes.size()); }
+
+private:
+    struct FNode
+    {
+        float LooseMin[3];
+        uint32 Parent;
+        float LooseMax[3];
+        uint32 SubtreeCount;        // Objects in the node and below (the root may hold 0)
+        uint32 Children[8];
+        uint32 Coord[3];            // Cell at Depth
+        uint32 Depth;
+    };
+
+    /**
+     * @brief Cell of an object: depth from its size, coordinates from its center
+     * @return False if the center is outside the world cube (root)
+     */
+    bool ComputeCell(const FBoundingBox& Box, uint32& OutDepth, uint32 OutCoord[3]) const;
+
+    /**
+     * @brief Node of a cell below Ancestor, creating the path to it; counts one more
+     *        object on the path below Ancestor
+     */
+    uint32 AcquirePath(uint32 Ancestor, uint32 Depth, const uint32 Coord[3]);
+
+    /**
+     * @brief Count one object less from Node up to (not including) Ancestor,
+     *        releasing nodes that empty
+     */
+    void ReleasePath(uint32 Node, uint32 Ancestor);
+
+    bool ContainsCell(const FNode& Node, uint32 Depth, const uint32 Coord[3]) const;
+
+    uint32 AllocateNode(uint32 Parent, uint32 Depth, const uint32 Coord[3]);
+
+    /**
+     * @brief Traversal shared by the overlap queries
+     *
+     * TestNode(Min, Max, State) rejects a node or narrows State, 0 meaning fully
+     * inside (its subtree is then taken without tests); TestItem(Item, State)
+     * tests an object of a node that is not fully inside.
+     */
+    template<typename NodeTest, typename ItemTest>
+    uint32 Query(uint32 InitialState, NodeTest&& TestNode, ItemTest&& TestItem, std::vector<uint32>& OutUserData) const;
+
+private:
+    FLooseOctreeSettings Settings;
+    float WorldMin[3] = { 0.0f, 0.0f, 0.0f };
+
+    std::vector<FNode> Nodes;
+    std::vector<uint32> FreeNodes;
+    KSpatialItemStore Store;
+};
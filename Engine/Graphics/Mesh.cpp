@@ -1,15 +1,121 @@
 ﻿#include "Mesh.h"
+#include "RenderStateCache.h"
+#include "MeshImporter.h"
+#include "../Core/Profiler.h"
 #include <cmath>
 
-HRESULT KMesh::Initialize(ID3D11Device* Device, 
+HRESULT KMesh::Initialize(IRHIDevice* Device, 
                         const FVertex* Vertices, UINT32 VertexCount,
-                        const UINT32* Indices, UINT32 IndexCount)
+                        const UINT32* Indices, UINT32 IndexCount,
+                        EVertexLayout Layout, bool bOptimize,
+                        const FMeshLODSettings* LODSettings, KJobSystem* JobSystem,
+                        std::shared_ptr<KGeometryPool> GeometryPool)
 {
-    this->VertexCount = VertexCount;
-    this->IndexCount = IndexCount;
+    KE_PROFILE_FUNCTION();
 
-    // Create vertex buffer
-    HRESULT hr = CreateVertexBuffer(Device, Vertices, VertexCount);
+    if (Layout == EVertexLayout::Position || Layout == EVertexLayout::QuantizedPosition)
+    {
+        LOG_ERROR("Position-only vertex layouts cannot store a mesh");
+        return E_INVALIDARG;
+    }
+
+    // Optimize, generate LODs and encode, then upload the result as is
+    FMeshBuildData Build;
+    if (!MeshFile::Build(reinterpret_cast<const FStandardVertex*>(Vertices), VertexCount, Indices, IndexCount, Layout,
+                         bOptimize, Build, nullptr, 0, LODSettings, JobSystem))
+    {
+        LOG_ERROR("Invalid mesh data (missing vertices or index out of range)");
+        return E_INVALIDARG;
+    }
+
+    return InitializeFromBuild(Device, Build, std::move(GeometryPool));
+}
+
+HRESULT KMesh::InitializeSkinned(IRHIDevice* Device,
+                                 const FSkinnedVertex* Vertices, UINT32 VertexCount,
+                                 const UINT32* Indices, UINT32 IndexCount, bool bOptimize,
+                                 const FMeshLODSettings* LODSettings, KJobSystem* JobSystem,
+                                 std::shared_ptr<KGeometryPool> GeometryPool)
+{
+    KE_PROFILE_FUNCTION();
+
+    FMeshBuildData Build;
+    if (!MeshFile::BuildSkinned(reinterpret_cast<const FStandardSkinnedVertex*>(Vertices), VertexCount, Indices, IndexCount,
+                                bOptimize, Build, nullptr, 0, LODSettings, JobSystem))
+    {
+        LOG_ERROR("Invalid skinned mesh data (missing vertices or index out of range)");
+        return E_INVALIDARG;
+    }
+
+    return InitializeFromBuild(Device, Build, std::move(GeometryPool));
+}
+
+HRESULT KMesh::InitializeFromBuild(IRHIDevice* Device, const FMeshBuildData& Build, std::shared_ptr<KGeometryPool> GeometryPool)
+{
+    if (Build.OptimizeStats.Before.TriangleCount > 0)
+    {
+        LOG_INFO("Mesh optimized, ACMR: " + std::to_string(Build.OptimizeStats.Before.ACMR) + " -> " +
+                 std::to_string(Build.OptimizeStats.After.ACMR) + ", ATVR: " + std::to_string(Build.OptimizeStats.Before.ATVR) +
+                 " -> " + std::to_string(Build.OptimizeStats.After.ATVR));
+    }
+
+    for (size_t LOD = 1; LOD < Build.LODs.size(); ++LOD)
+    {
+        LOG_INFO("Mesh LOD " + std::to_string(LOD) + ": triangles: " + std::to_string(Build.LODs[LOD].IndexCount / 3) +
+                 ", error: " + std::to_string(Build.LODs[LOD].Error) + ", screen size: " + std::to_string(Build.LODs[LOD].ScreenSize));
+    }
+
+    HRESULT hr = Initialize(Device, Build.Data, std::move(GeometryPool));
+    OptimizeStats = Build.OptimizeStats;
+    return hr;
+}
+
+HRESULT KMesh::Initialize(IRHIDevice* Device, const FMeshData& Data, std::shared_ptr<KGeometryPool> GeometryPool)
+{
+    KE_PROFILE_FUNCTION();
+
+    if (!Device || Data.VertexCount == 0 || (Data.Indices && Data.IndexCount == 0))
+    {
+        return E_INVALIDARG;
+    }
+
+    VertexLayout = Data.Layout;
+    VertexCount = Data.VertexCount;
+    IndexFormat = Data.IndexFormat;
+    OptimizeStats = FMeshOptimizeStats();
+
+    // Ranges (small; the vertex and index data are not copied)
+    LODs.assign(Data.LODs, Data.LODs + (Data.LODs ? Data.LODCount : 0));
+    Submeshes.assign(Data.Submeshes, Data.Submeshes + (Data.Submeshes ? Data.SubmeshCount : 0));
+    IndexCount = !Data.Indices ? 0 : (LODs.empty() ? Data.IndexCount : LODs[0].IndexCount);
+
+    // Buffers of a previous initialization are released and its ranges go back to their pool,
+    // whether or not this one is pooled
+    IndexBuffer.Reset();
+    for (FRHIResourceRef& VertexBuffer : VertexBuffers)
+    {
+        VertexBuffer.Reset();
+    }
+    PoolAllocation.Release();
+    if (GeometryPool && GeometryPool->IsInitialized())
+    {
+        PoolAllocation.Pool = std::move(GeometryPool);
+    }
+
+    // Bounds for culling
+    LocalBounds = Data.Bounds;
+    LocalSphere = Data.Sphere;
+
+    // Quantized positions are relative to the bounds
+    if (HasQuantizedPositions())
+    {
+        float Decode[16];
+        VertexFormat::GetPositionDecodeMatrix(LocalBounds, Decode);
+        PositionDecode = XMFLOAT4X4(Decode);
+    }
+
+    // Create vertex buffers
+    HRESULT hr = CreateVertexBuffers(Device, Data.Streams);
     if (FAILED(hr))
     {
         KLogger::HResultError(hr, "Vertex buffer creation failed");
@@ -17,9 +123,9 @@ HRESULT KMesh::Initialize(ID3D11Device* Device,
     }
 
     // Create index buffer (if indices exist)
-    if (Indices && IndexCount > 0)
+    if (Data.Indices)
     {
-        hr = CreateIndexBuffer(Device, Indices, IndexCount);
+        hr = CreateIndexBuffer(Device, Data.Indices, Data.IndexCount);
         if (FAILED(hr))
         {
             KLogger::HResultError(hr, "Index buffer creation failed");
@@ -27,114 +133,271 @@ HRESULT KMesh::Initialize(ID3D11Device* Device,
         }
     }
 
-    // Create constant buffer
-    hr = CreateConstantBuffer(Device);
-    if (FAILED(hr))
-    {
-        KLogger::HResultError(hr, "Constant buffer creation failed");
-        return hr;
-    }
-
     LOG_INFO("Mesh initialization completed, vertices: " + std::to_string(VertexCount) + 
-             ", indices: " + std::to_string(IndexCount));
+             ", indices: " + std::to_string(IndexCount) +
+             (IndexFormat == EIndexFormat::UInt16 ? " (16-bit)" : "") +
+             ", vertex bytes: " + std::to_string(GetVertexDataSize()) + (IsPooled() ? " (pooled)" : ""));
     return S_OK;
 }
 
-void KMesh::Render(ID3D11DeviceContext* Context)
+void KMesh::Render(IRHICommandContext& Context)
 {
-    // Set vertex buffer
-    UINT32 Stride = sizeof(FVertex);
-    UINT32 Offset = 0;
-    Context->IASetVertexBuffers(0, 1, VertexBuffer.GetAddressOf(), &Stride, &Offset);
+    // Set vertex buffers
+    const UINT32 StreamCount = VertexFormat::GetStreamCount(VertexLayout);
+    for (UINT32 Stream = 0; Stream < StreamCount; ++Stream)
+    {
+        Context.SetVertexBuffer(Stream, GetVertexBuffer(Stream), VertexFormat::GetStreamStride(VertexLayout, Stream), 0);
+    }
 
     // Set index buffer (if exists)
     if (HasIndices())
     {
-        Context->IASetIndexBuffer(IndexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+        Context.SetIndexBuffer(GetIndexBuffer(), IndexFormat, 0);
     }
 
     // Set primitive topology
-    Context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-
-    // Bind constant buffer
-    Context->VSSetConstantBuffers(0, 1, ConstantBuffer.GetAddressOf());
+    Context.SetPrimitiveTopology(EPrimitiveTopology::TriangleList);
 
     // Draw
+    Draw(Context);
+}
+
+void KMesh::Bind(KRenderStateCache& StateCache) const
+{
+    const UINT32 StreamCount = VertexFormat::GetStreamCount(VertexLayout);
+    for (UINT32 Stream = 0; Stream < StreamCount; ++Stream)
+    {
+        StateCache.SetVertexBuffer(Stream, GetVertexBuffer(Stream), VertexFormat::GetStreamStride(VertexLayout, Stream), 0);
+    }
+
     if (HasIndices())
     {
-        Context->DrawIndexed(IndexCount, 0, 0);
+        StateCache.SetIndexBuffer(GetIndexBuffer(), IndexFormat, 0);
     }
-    else
+
+    StateCache.SetPrimitiveTopology(EPrimitiveTopology::TriangleList);
+}
+
+void KMesh::BindPositionStream(KRenderStateCache& StateCache) const
+{
+    StateCache.SetVertexBuffer(0, GetVertexBuffer(0), VertexFormat::GetStreamStride(VertexLayout, 0), 0);
+
+    if (HasIndices())
     {
-        Context->Draw(VertexCount, 0);
+        StateCache.SetIndexBuffer(GetIndexBuffer(), IndexFormat, 0);
     }
+
+    StateCache.SetPrimitiveTopology(EPrimitiveTopology::TriangleList);
 }
 
-void KMesh::UpdateConstantBuffer(ID3D11DeviceContext* Context,
-                               const XMMATRIX& WorldMatrix,
-                               const XMMATRIX& ViewMatrix,
-                               const XMMATRIX& ProjMatrix)
+void KMesh::Draw(IRHICommandContext& Context, UINT32 LOD) const
 {
-    FConstantBuffer CB;
-    CB.WorldMatrix = XMMatrixTranspose(WorldMatrix);
-    CB.ViewMatrix = XMMatrixTranspose(ViewMatrix);
-    CB.ProjectionMatrix = XMMatrixTranspose(ProjMatrix);
+    // Pooled meshes address their ranges through base vertex / start index
+    const int32 BaseVertex = static_cast<int32>(GetBaseVertex());
+    if (!LODs.empty())
+    {
+        const FMeshLOD& Range = LODs[LOD < LODs.size() ? LOD : LODs.size() - 1];
+        Context.DrawIndexed(Range.IndexCount, GetStartIndex() + Range.FirstIndex, BaseVertex);
+    }
+    else if (HasIndices())
+    {
+        Context.DrawIndexed(IndexCount, GetStartIndex(), BaseVertex);
+    }
+    else
+    {
+        Context.Draw(VertexCount, static_cast<UINT32>(BaseVertex));
+    }
+}
 
-    Context->UpdateSubresource(ConstantBuffer.Get(), 0, nullptr, &CB, 0, 0);
+void KMesh::DrawInstanced(IRHICommandContext& Context, UINT32 InstanceCount, UINT32 StartInstance, UINT32 LOD) const
+{
+    const int32 BaseVertex = static_cast<int32>(GetBaseVertex());
+    if (!LODs.empty())
+    {
+        const FMeshLOD& Range = LODs[LOD < LODs.size() ? LOD : LODs.size() - 1];
+        Context.DrawIndexedInstanced(Range.IndexCount, InstanceCount, GetStartIndex() + Range.FirstIndex, BaseVertex,
+                                     StartInstance);
+    }
+    else if (HasIndices())
+    {
+        Context.DrawIndexedInstanced(IndexCount, InstanceCount, GetStartIndex(), BaseVertex, StartInstance);
+    }
+    else
+    {
+        Context.DrawInstanced(VertexCount, InstanceCount, static_cast<UINT32>(BaseVertex), StartInstance);
+    }
 }
 
 void KMesh::Cleanup()
 {
-    ConstantBuffer.Reset();
     IndexBuffer.Reset();
-    VertexBuffer.Reset();
+    for (FRHIResourceRef& VertexBuffer : VertexBuffers)
+    {
+        VertexBuffer.Reset();
+    }
+    PoolAllocation.Release();
     
     VertexCount = 0;
     IndexCount = 0;
+    LODs.clear();
+    Submeshes.clear();
 }
 
-HRESULT KMesh::CreateVertexBuffer(ID3D11Device* Device, const FVertex* Vertices, UINT32 VertexCount)
+FRHIResource KMesh::GetVertexBuffer(UINT32 Stream) const
 {
-    D3D11_BUFFER_DESC BufferDesc = {};
-    BufferDesc.Usage = D3D11_USAGE_DEFAULT;
-    BufferDesc.ByteWidth = sizeof(FVertex) * VertexCount;
-    BufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-    BufferDesc.CPUAccessFlags = 0;
+    if (Stream >= VertexFormat::MaxStreams)
+    {
+        return nullptr;
+    }
+    return PoolAllocation.Vertices.IsValid() ? PoolAllocation.Pool->GetBuffer(PoolAllocation.Vertices, Stream)
+                                             : VertexBuffers[Stream].Get();
+}
 
-    D3D11_SUBRESOURCE_DATA InitData = {};
-    InitData.pSysMem = Vertices;
+FRHIResource KMesh::GetIndexBuffer() const
+{
+    return PoolAllocation.Indices.IsValid() ? PoolAllocation.Pool->GetBuffer(PoolAllocation.Indices) : IndexBuffer.Get();
+}
 
-    return Device->CreateBuffer(&BufferDesc, &InitData, &VertexBuffer);
+UINT32 KMesh::GetVertexDataSize() const
+{
+    UINT32 Size = 0;
+    const UINT32 StreamCount = VertexFormat::GetStreamCount(VertexLayout);
+    for (UINT32 Stream = 0; Stream < StreamCount; ++Stream)
+    {
+        Size += VertexFormat::GetStreamStride(VertexLayout, Stream) * VertexCount;
+    }
+    return Size;
 }
 
-HRESULT KMesh::CreateIndexBuffer(ID3D11Device* Device, const UINT32* Indices, UINT32 IndexCount)
+HRESULT KMesh::CreateVertexBuffers(IRHIDevice* Device, const void* const* Streams)
 {
-    D3D11_BUFFER_DESC BufferDesc = {};
-    BufferDesc.Usage = D3D11_USAGE_DEFAULT;
-    BufferDesc.ByteWidth = sizeof(UINT32) * IndexCount;
-    BufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-    BufferDesc.CPUAccessFlags = 0;
+    const UINT32 StreamCount = VertexFormat::GetStreamCount(VertexLayout);
+    for (UINT32 Stream = 0; Stream < StreamCount; ++Stream)
+    {
+        if (!Streams[Stream])
+        {
+            return E_INVALIDARG;
+        }
+    }
+
+    if (PoolAllocation.Pool)
+    {
+        HRESULT hr = PoolAllocation.Pool->AllocateVertices(VertexLayout, Streams, VertexCount, PoolAllocation.Vertices);
+        if (SUCCEEDED(hr))
+        {
+            return S_OK;
+        }
+        LOG_WARNING("Geometry pool vertex allocation failed; using dedicated buffers");
+    }
 
-    D3D11_SUBRESOURCE_DATA InitData = {};
-    InitData.pSysMem = Indices;
+    for (UINT32 Stream = 0; Stream < StreamCount; ++Stream)
+    {
+        FRHIBufferDesc BufferDesc;
+        BufferDesc.Usage = ERHIBufferUsage::Default;
+        BufferDesc.ByteWidth = VertexFormat::GetStreamStride(VertexLayout, Stream) * VertexCount;
+        BufferDesc.BindFlags = RHIBindFlags::VertexBuffer;
 
-    return Device->CreateBuffer(&BufferDesc, &InitData, &IndexBuffer);
+        VertexBuffers[Stream].Reset(Device, Device->CreateBuffer(BufferDesc, Streams[Stream]));
+        if (!VertexBuffers[Stream])
+        {
+            return E_FAIL;
+        }
+    }
+
+    return S_OK;
 }
 
-HRESULT KMesh::CreateConstantBuffer(ID3D11Device* Device)
+HRESULT KMesh::CreateIndexBuffer(IRHIDevice* Device, const void* Indices, UINT32 BufferIndexCount)
 {
-    D3D11_BUFFER_DESC BufferDesc = {};
-    BufferDesc.Usage = D3D11_USAGE_DEFAULT;
-    BufferDesc.ByteWidth = sizeof(FConstantBuffer);
-    BufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-    BufferDesc.CPUAccessFlags = 0;
+    if (PoolAllocation.Pool)
+    {
+        HRESULT hr = PoolAllocation.Pool->AllocateIndices(IndexFormat, Indices, BufferIndexCount, PoolAllocation.Indices);
+        if (SUCCEEDED(hr))
+        {
+            return S_OK;
+        }
+        LOG_WARNING("Geometry pool index allocation failed; using a dedicated buffer");
+    }
+
+    FRHIBufferDesc BufferDesc;
+    BufferDesc.Usage = ERHIBufferUsage::Default;
+    BufferDesc.ByteWidth = (IndexFormat == EIndexFormat::UInt16 ? sizeof(uint16) : sizeof(UINT32)) * BufferIndexCount;
+    BufferDesc.BindFlags = RHIBindFlags::IndexBuffer;
 
-    return Device->CreateBuffer(&BufferDesc, nullptr, &ConstantBuffer);
+    IndexBuffer.Reset(Device, Device->CreateBuffer(BufferDesc, Indices));
+    return IndexBuffer ? S_OK : E_FAIL;
 }
 
 // Static factory methods implementation
 
-std::unique_ptr<KMesh> KMesh::CreateTriangle(ID3D11Device* Device)
+std::unique_ptr<KMesh> KMesh::LoadFromFile(IRHIDevice* Device, const std::wstring& Filename,
+                                           std::shared_ptr<KGeometryPool> GeometryPool)
+{
+    KE_PROFILE_FUNCTION();
+
+    const std::string Path = StringUtils::WideToMultiByte(Filename);
+    KMeshFile File;
+    if (!File.Open(Path))
+    {
+        LOG_ERROR("Failed to open mesh file: " + Path);
+        return nullptr;
+    }
+
+    // Mapped bytes go straight to the buffer upload; the mapping is released afterwards
+    auto Mesh = std::make_unique<KMesh>();
+    HRESULT hr = Mesh->Initialize(Device, File.GetData(), GeometryPool);
+    if (FAILED(hr))
+    {
+        LOG_ERROR("Mesh file upload failed: " + Path);
+        return nullptr;
+    }
+
+    return Mesh;
+}
+
+std::unique_ptr<KMesh> KMesh::Import(IRHIDevice* Device, const std::wstring& Filename, EVertexLayout Layout,
+                                     const FMeshLODSettings* LODSettings, KJobSystem* JobSystem,
+                                     std::shared_ptr<KGeometryPool> GeometryPool)
+{
+    KE_PROFILE_FUNCTION();
+
+    const std::string Path = StringUtils::WideToMultiByte(Filename);
+    FImportedMesh Imported;
+    FMeshImportStats Stats;
+    if (!MeshImporter::Import(Path, Imported, FMeshImportSettings(), JobSystem, &Stats))
+    {
+        LOG_ERROR("Mesh import failed: " + Stats.Error);
+        return nullptr;
+    }
+
+    LOG_INFO("Mesh imported: " + Path + ", vertices: " + std::to_string(Imported.Vertices.size()) +
+             ", triangles: " + std::to_string(Imported.Indices.size() / 3) + ", submeshes: " +
+             std::to_string(Imported.Submeshes.size()) + ", " + std::to_string(Stats.Seconds * 1000.0) + " ms");
+
+    // LODs are only generated for single-material meshes
+    FMeshBuildData Build;
+    if (!MeshFile::Build(Imported.Vertices.data(), static_cast<uint32>(Imported.Vertices.size()),
+                         Imported.Indices.data(), static_cast<uint32>(Imported.Indices.size()), Layout, true, Build,
+                         Imported.Submeshes.data(), static_cast<uint32>(Imported.Submeshes.size()), LODSettings, JobSystem))
+    {
+        LOG_ERROR("Invalid imported mesh data: " + Path);
+        return nullptr;
+    }
+
+    auto Mesh = std::make_unique<KMesh>();
+    HRESULT hr = Mesh->Initialize(Device, Build.Data, GeometryPool);
+    if (FAILED(hr))
+    {
+        LOG_ERROR("Imported mesh upload failed: " + Path);
+        return nullptr;
+    }
+    Mesh->OptimizeStats = Build.OptimizeStats;
+
+    return Mesh;
+}
+
+std::unique_ptr<KMesh> KMesh::CreateTriangle(IRHIDevice* Device, EVertexLayout Layout,
+                                             std::shared_ptr<KGeometryPool> GeometryPool)
 {
     // Triangle vertex data
     FVertex Vertices[] = {
@@ -144,7 +407,7 @@ std::unique_ptr<KMesh> KMesh::CreateTriangle(ID3D11Device* Device)
     };
 
     auto Mesh = std::make_unique<KMesh>();
-    HRESULT hr = Mesh->Initialize(Device, Vertices, 3);
+    HRESULT hr = Mesh->Initialize(Device, Vertices, 3, nullptr, 0, Layout, true, nullptr, nullptr, GeometryPool);
     
     if (FAILED(hr))
     {
@@ -155,7 +418,8 @@ std::unique_ptr<KMesh> KMesh::CreateTriangle(ID3D11Device* Device)
     return Mesh;
 }
 
-std::unique_ptr<KMesh> KMesh::CreateQuad(ID3D11Device* Device)
+std::unique_ptr<KMesh> KMesh::CreateQuad(IRHIDevice* Device, EVertexLayout Layout,
+                                         std::shared_ptr<KGeometryPool> GeometryPool)
 {
     // Quad vertex data
     FVertex Vertices[] = {
@@ -172,7 +436,7 @@ std::unique_ptr<KMesh> KMesh::CreateQuad(ID3D11Device* Device)
     };
 
     auto Mesh = std::make_unique<KMesh>();
-    HRESULT hr = Mesh->Initialize(Device, Vertices, 4, Indices, 6);
+    HRESULT hr = Mesh->Initialize(Device, Vertices, 4, Indices, 6, Layout, true, nullptr, nullptr, GeometryPool);
     
     if (FAILED(hr))
     {
@@ -183,7 +447,8 @@ std::unique_ptr<KMesh> KMesh::CreateQuad(ID3D11Device* Device)
     return Mesh;
 }
 
-std::unique_ptr<KMesh> KMesh::CreateCube(ID3D11Device* Device)
+std::unique_ptr<KMesh> KMesh::CreateCube(IRHIDevice* Device, EVertexLayout Layout,
+                                         std::shared_ptr<KGeometryPool> GeometryPool)
 {
     // Cube vertex data (same as legacy PrimitiveModel but using new Vertex structure)
     FVertex Vertices[] = {
@@ -211,7 +476,7 @@ std::unique_ptr<KMesh> KMesh::CreateCube(ID3D11Device* Device)
     };
 
     auto Mesh = std::make_unique<KMesh>();
-    HRESULT hr = Mesh->Initialize(Device, Vertices, 8, Indices, 36);
+    HRESULT hr = Mesh->Initialize(Device, Vertices, 8, Indices, 36, Layout, true, nullptr, nullptr, GeometryPool);
     
     if (FAILED(hr))
     {
@@ -222,79 +487,34 @@ std::unique_ptr<KMesh> KMesh::CreateCube(ID3D11Device* Device)
     return Mesh;
 }
 
-std::unique_ptr<KMesh> KMesh::CreateSphere(ID3D11Device* Device, UINT32 Slices, UINT32 Stacks)
+std::unique_ptr<KMesh> KMesh::CreateSphere(IRHIDevice* Device, UINT32 Slices, UINT32 Stacks, EVertexLayout Layout,
+                                           const FMeshLODSettings* LODSettings,
+                                           std::shared_ptr<KGeometryPool> GeometryPool)
 {
-    std::vector<FVertex> Vertices;
-    std::vector<UINT32> Indices;
-
-    // Sphere generation algorithm
-    const float Radius = 1.0f;
-    const float Pi = XM_PI;
-
-    // Generate vertices
-    for (UINT32 i = 0; i <= Stacks; ++i)
-    {
-        float StackAngle = Pi * i / Stacks - Pi / 2.0f; // -π/2 to π/2
-        float XY = Radius * cosf(StackAngle);
-        float Z = Radius * sinf(StackAngle);
-
-        for (UINT32 j = 0; j <= Slices; ++j)
-        {
-            float SectorAngle = 2 * Pi * j / Slices; // 0 to 2π
-
-            FVertex Vertex;
-            Vertex.Position.x = XY * cosf(SectorAngle);
-            Vertex.Position.y = Z;
-            Vertex.Position.z = XY * sinf(SectorAngle);
-
-            // Normal vector calculation
-            Vertex.Normal = Vertex.Position;
-
-            // Color based on position
-            Vertex.Color.x = (Vertex.Position.x + 1.0f) * 0.5f;
-            Vertex.Color.y = (Vertex.Position.y + 1.0f) * 0.5f;
-            Vertex.Color.z = (Vertex.Position.z + 1.0f) * 0.5f;
-            Vertex.Color.w = 1.0f;
-
-            // Texture coordinates
-            Vertex.TexCoord.x = (float)j / Slices;
-            Vertex.TexCoord.y = (float)i / Stacks;
+    return CreateProcedural(Device, FProceduralMeshDesc::Sphere(Slices, Stacks), Layout, LODSettings, nullptr, GeometryPool);
+}
 
-            Vertices.push_back(Vertex);
-        }
-    }
+std::unique_ptr<KMesh> KMesh::CreateProcedural(IRHIDevice* Device, const FProceduralMeshDesc& Desc, EVertexLayout Layout,
+                                               const FMeshLODSettings* LODSettings, KJobSystem* JobSystem,
+                                               std::shared_ptr<KGeometryPool> GeometryPool)
+{
+    KE_PROFILE_FUNCTION();
 
-    // Generate indices
-    for (UINT32 i = 0; i < Stacks; ++i)
+    std::vector<FStandardVertex> Vertices;
+    std::vector<uint32> Indices;
+    if (!ProceduralGeometry::Generate(Desc, Vertices, Indices, JobSystem))
     {
-        UINT32 K1 = i * (Slices + 1);
-        UINT32 K2 = K1 + Slices + 1;
-
-        for (UINT32 j = 0; j < Slices; ++j, ++K1, ++K2)
-        {
-            if (i != 0)
-            {
-                Indices.push_back(K1);
-                Indices.push_back(K2);
-                Indices.push_back(K1 + 1);
-            }
-
-            if (i != (Stacks - 1))
-            {
-                Indices.push_back(K1 + 1);
-                Indices.push_back(K2);
-                Indices.push_back(K2 + 1);
-            }
-        }
+        LOG_ERROR("Invalid procedural mesh parameters");
+        return nullptr;
     }
 
     auto Mesh = std::make_unique<KMesh>();
-    HRESULT hr = Mesh->Initialize(Device, Vertices.data(), static_cast<UINT32>(Vertices.size()),
-                                 Indices.data(), static_cast<UINT32>(Indices.size()));
-    
+    HRESULT hr = Mesh->Initialize(Device, reinterpret_cast<const FVertex*>(Vertices.data()), static_cast<UINT32>(Vertices.size()),
+                                  Indices.data(), static_cast<UINT32>(Indices.size()), Layout, true, LODSettings,
+                                  JobSystem, GeometryPool);
     if (FAILED(hr))
     {
-        LOG_ERROR("Sphere mesh creation failed");
+        LOG_ERROR("Procedural mesh creation failed");
         return nullptr;
     }
 
@@ -2,6 +2,16 @@
 
 #include "../Utils/Common.h"
 #include "../Utils/Logger.h"
+#include "../Utils/Bounds.h"
+#include "VertexFormat.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MeshFile.h"
+#include "GeometryPool.h"
+#include "ProceduralGeometry.h"
+
+class KRenderStateCache;
+class KJobSystem;
 
 /**
  * @brief 3D Vertex structure
@@ -20,16 +30,31 @@ struct FVertex
         : Position(InPosition), Color(InColor), Normal(0.0f, 1.0f, 0.0f), TexCoord(0.0f, 0.0f) {}
 };
 
+// FVertex is encoded through its platform-independent twin
+static_assert(sizeof(FVertex) == sizeof(FStandardVertex) &&
+              offsetof(FVertex, Color) == offsetof(FStandardVertex, Color) &&
+              offsetof(FVertex, Normal) == offsetof(FStandardVertex, Normal) &&
+              offsetof(FVertex, TexCoord) == offsetof(FStandardVertex, TexCoord),
+              "FVertex must match FStandardVertex");
+
 /**
- * @brief Constant buffer structure
+ * @brief Skinned vertex: FVertex plus up to four joint influences
  */
-struct FConstantBuffer
+struct FSkinnedVertex : FVertex
 {
-    XMMATRIX WorldMatrix;
-    XMMATRIX ViewMatrix;
-    XMMATRIX ProjectionMatrix;
+    uint8 JointIndices[4];  // Skeleton joint indices
+    float JointWeights[4];  // Influence weights (normalized at upload; unused influences 0)
+
+    FSkinnedVertex() : JointIndices{ 0, 0, 0, 0 }, JointWeights{ 1.0f, 0.0f, 0.0f, 0.0f } {}
+
+    FSkinnedVertex(const FVertex& InVertex) : FVertex(InVertex), JointIndices{ 0, 0, 0, 0 }, JointWeights{ 1.0f, 0.0f, 0.0f, 0.0f } {}
 };
 
+// FSkinnedVertex is encoded through its platform-independent twin
+static_assert(sizeof(FSkinnedVertex) == sizeof(FStandardSkinnedVertex) &&
+              offsetof(FStandardSkinnedVertex, JointIndices) == sizeof(FVertex),
+              "FSkinnedVertex must match FStandardSkinnedVertex");
+
 /**
  * @brief 3D Mesh class
  * 
@@ -49,80 +74,278 @@ public:
 
     /**
      * @brief Initialize the mesh
-     * @param Device DirectX 11 device
+     * @param Device RHI device
      * @param Vertices Vertex array
      * @param VertexCount Number of vertices
      * @param Indices Index array
      * @param IndexCount Number of indices
+     * @param Layout Vertex layout the vertices are encoded to on the GPU
+     * @param bOptimize Reorder triangles and vertices for the vertex cache, overdraw and
+     *                  fetch locality (indexed meshes; unreferenced vertices are dropped)
+     * @param LODSettings Generate a LOD chain into the same buffers (indexed meshes), nullptr for none
+     * @param JobSystem Worker pool the LODs are simplified on, nullptr for the calling thread
+     * @param GeometryPool Shared buffers to suballocate from, nullptr for dedicated buffers
      * @return Success: S_OK
      */
-    HRESULT Initialize(ID3D11Device* Device, 
+    HRESULT Initialize(IRHIDevice* Device, 
                       const FVertex* Vertices, UINT32 VertexCount,
-                      const UINT32* Indices = nullptr, UINT32 IndexCount = 0);
+                      const UINT32* Indices = nullptr, UINT32 IndexCount = 0,
+                      EVertexLayout Layout = EVertexLayout::Standard,
+                      bool bOptimize = true,
+                      const FMeshLODSettings* LODSettings = nullptr,
+                      KJobSystem* JobSystem = nullptr,
+                      std::shared_ptr<KGeometryPool> GeometryPool = nullptr);
+
+    /**
+     * @brief Initialize from GPU-ready data (a mapped mesh file or MeshFile::Build output)
+     *
+     * Streams and indices are handed to the buffer upload as is, without
+     * conversion or intermediate copies.
+     * @param Device RHI device
+     * @param Data Encoded mesh data
+     * @param GeometryPool Shared buffers to suballocate from, nullptr for dedicated buffers
+     * @return Success: S_OK
+     */
+    HRESULT Initialize(IRHIDevice* Device, const FMeshData& Data, std::shared_ptr<KGeometryPool> GeometryPool = nullptr);
+
+    /**
+     * @brief Initialize a skinned mesh (EVertexLayout::Skinned)
+     *
+     * Same as Initialize; draw it with KRenderer::RenderSkinnedMesh and a joint palette.
+     * @param Device RHI device
+     * @param Vertices Skinned vertex array
+     * @param VertexCount Number of vertices
+     * @param Indices Index array
+     * @param IndexCount Number of indices
+     * @param bOptimize Reorder triangles and vertices (indexed meshes)
+     * @param LODSettings Generate a LOD chain into the same buffers (indexed meshes), nullptr for none
+     * @param JobSystem Worker pool the LODs are simplified on, nullptr for the calling thread
+     * @param GeometryPool Shared buffers to suballocate from, nullptr for dedicated buffers
+     * @return Success: S_OK
+     */
+    HRESULT InitializeSkinned(IRHIDevice* Device,
+                              const FSkinnedVertex* Vertices, UINT32 VertexCount,
+                              const UINT32* Indices = nullptr, UINT32 IndexCount = 0,
+                              bool bOptimize = true,
+                              const FMeshLODSettings* LODSettings = nullptr,
+                              KJobSystem* JobSystem = nullptr,
+                              std::shared_ptr<KGeometryPool> GeometryPool = nullptr);
 
     /**
      * @brief Render the mesh
-     * @param Context DirectX 11 device context
+     * 
+     * Binds buffers and draws; constant buffers must be bound by the caller.
+     * @param Context RHI command context
      */
-    void Render(ID3D11DeviceContext* Context);
+    void Render(IRHICommandContext& Context);
 
     /**
-     * @brief Update constant buffer
-     * @param Context DirectX 11 device context
-     * @param WorldMatrix World transformation matrix
-     * @param ViewMatrix View transformation matrix
-     * @param ProjectionMatrix Projection transformation matrix
+     * @brief Bind vertex/index buffers and topology through a state cache
+     * @param StateCache Render state cache
      */
-    void UpdateConstantBuffer(ID3D11DeviceContext* Context,
-                             const XMMATRIX& WorldMatrix,
-                             const XMMATRIX& ViewMatrix,
-                             const XMMATRIX& ProjectionMatrix);
+    void Bind(KRenderStateCache& StateCache) const;
+
+    /**
+     * @brief Bind only the position stream (stream 0) for position-only passes
+     *
+     * Use with a shader program bound with GetPositionLayout(); split layouts
+     * then read 8-12 bytes per vertex.
+     * @param StateCache Render state cache
+     */
+    void BindPositionStream(KRenderStateCache& StateCache) const;
+
+    /**
+     * @brief Issue the draw call only (buffers must already be bound)
+     * @param Context RHI command context
+     * @param LOD Level of detail (clamped to the available LODs)
+     */
+    void Draw(IRHICommandContext& Context, UINT32 LOD = 0) const;
+
+    /**
+     * @brief Issue an instanced draw call (buffers must already be bound)
+     * @param Context RHI command context
+     * @param InstanceCount Number of instances
+     * @param StartInstance Offset of the first instance in the instance stream
+     * @param LOD Level of detail (clamped to the available LODs)
+     */
+    void DrawInstanced(IRHICommandContext& Context, UINT32 InstanceCount, UINT32 StartInstance = 0, UINT32 LOD = 0) const;
 
     /**
      * @brief Cleanup resources
      */
     void Cleanup();
 
-    // Accessors
-    ID3D11Buffer* GetVertexBuffer() const { return VertexBuffer.Get(); }
-    ID3D11Buffer* GetIndexBuffer() const { return IndexBuffer.Get(); }
-    ID3D11Buffer* GetConstantBuffer() const { return ConstantBuffer.Get(); }
+    // Accessors (pooled meshes return the shared page buffers; see GetBaseVertex/GetStartIndex)
+    FRHIResource GetVertexBuffer(UINT32 Stream = 0) const;
+    FRHIResource GetIndexBuffer() const;
+
+    /**
+     * @brief Whether the vertices live in a shared geometry pool
+     */
+    bool IsPooled() const { return PoolAllocation.Vertices.IsValid(); }
+
+    /**
+     * @brief Offset of the mesh's first vertex / index in the bound buffers
+     *
+     * Zero for dedicated buffers; pool offsets change when the pool is defragmented.
+     */
+    UINT32 GetBaseVertex() const
+    {
+        return PoolAllocation.Vertices.IsValid() ? PoolAllocation.Pool->GetOffset(PoolAllocation.Vertices) : 0;
+    }
+    UINT32 GetStartIndex() const
+    {
+        return PoolAllocation.Indices.IsValid() ? PoolAllocation.Pool->GetOffset(PoolAllocation.Indices) : 0;
+    }
     
     UINT32 GetVertexCount() const { return VertexCount; }
-    UINT32 GetIndexCount() const { return IndexCount; }
+    UINT32 GetIndexCount(UINT32 LOD = 0) const { return LOD < LODs.size() ? LODs[LOD].IndexCount : IndexCount; }
     bool HasIndices() const { return IndexCount > 0; }
 
+    /**
+     * @brief 16-bit when every vertex is addressable with 16 bits
+     */
+    EIndexFormat GetIndexFormat() const { return IndexFormat; }
+
+    /**
+     * @brief Vertex cache statistics of the last optimization at Initialize
+     */
+    const FMeshOptimizeStats& GetOptimizeStats() const { return OptimizeStats; }
+
+    /**
+     * @brief LOD chain, finest first (indexed meshes always have LOD 0)
+     */
+    UINT32 GetLODCount() const { return LODs.empty() ? 1 : static_cast<UINT32>(LODs.size()); }
+    const std::vector<FMeshLOD>& GetLODs() const { return LODs; }
+
+    /**
+     * @brief Material ranges of LOD 0 (empty when the whole mesh uses one material)
+     */
+    const std::vector<FMeshSubmesh>& GetSubmeshes() const { return Submeshes; }
+
+    /**
+     * @brief Coarsest LOD whose error stays within the generation settings' screen error
+     * @param ScreenSize Projected bounding sphere diameter / view height
+     */
+    UINT32 SelectLOD(float ScreenSize) const
+    {
+        return MeshSimplifier::SelectLOD(LODs.data(), static_cast<uint32>(LODs.size()), ScreenSize);
+    }
+
+    EVertexLayout GetVertexLayout() const { return VertexLayout; }
+    bool IsSkinned() const { return VertexLayout == EVertexLayout::Skinned; }
+    EVertexLayout GetPositionLayout() const { return VertexFormat::GetPositionLayout(VertexLayout); }
+
+    /**
+     * @brief GPU memory used by the vertex streams in bytes
+     */
+    UINT32 GetVertexDataSize() const;
+
+    /**
+     * @brief Quantized layouts store positions relative to the local bounds
+     *
+     * The decode matrix maps them back to object space; renderers premultiply
+     * it into the world matrix (it is identity for float positions).
+     */
+    bool HasQuantizedPositions() const { return VertexFormat::HasQuantizedPositions(VertexLayout); }
+    XMMATRIX GetPositionDecodeMatrix() const { return XMLoadFloat4x4(&PositionDecode); }
+
+    /**
+     * @brief Object-space bounds, computed from the vertices at Initialize
+     */
+    const FBoundingBox& GetLocalBounds() const { return LocalBounds; }
+    const FBoundingSphere& GetLocalSphere() const { return LocalSphere; }
+
     /**
      * @brief Static factory methods
      */
-    static std::unique_ptr<KMesh> CreateTriangle(ID3D11Device* Device);
-    static std::unique_ptr<KMesh> CreateQuad(ID3D11Device* Device);
-    static std::unique_ptr<KMesh> CreateCube(ID3D11Device* Device);
-    static std::unique_ptr<KMesh> CreateSphere(ID3D11Device* Device, UINT32 Slices = 16, UINT32 Stacks = 16);
+    static std::unique_ptr<KMesh> CreateTriangle(IRHIDevice* Device, EVertexLayout Layout = EVertexLayout::Standard,
+                                                 std::shared_ptr<KGeometryPool> GeometryPool = nullptr);
+    static std::unique_ptr<KMesh> CreateQuad(IRHIDevice* Device, EVertexLayout Layout = EVertexLayout::Standard,
+                                             std::shared_ptr<KGeometryPool> GeometryPool = nullptr);
+    static std::unique_ptr<KMesh> CreateCube(IRHIDevice* Device, EVertexLayout Layout = EVertexLayout::Standard,
+                                             std::shared_ptr<KGeometryPool> GeometryPool = nullptr);
+    static std::unique_ptr<KMesh> CreateSphere(IRHIDevice* Device, UINT32 Slices = 16, UINT32 Stacks = 16,
+                                               EVertexLayout Layout = EVertexLayout::Standard,
+                                               const FMeshLODSettings* LODSettings = nullptr,
+                                               std::shared_ptr<KGeometryPool> GeometryPool = nullptr);
+
+    /**
+     * @brief Generate a procedural shape (see ProceduralGeometry) and upload it
+     * @param Device RHI device
+     * @param Desc Shape and its parameters
+     * @param JobSystem Worker pool for large grids and LOD generation, nullptr for the calling thread
+     * @param GeometryPool Shared buffers to suballocate from, nullptr for dedicated buffers
+     */
+    static std::unique_ptr<KMesh> CreateProcedural(IRHIDevice* Device, const FProceduralMeshDesc& Desc,
+                                                   EVertexLayout Layout = EVertexLayout::Standard,
+                                                   const FMeshLODSettings* LODSettings = nullptr,
+                                                   KJobSystem* JobSystem = nullptr,
+                                                   std::shared_ptr<KGeometryPool> GeometryPool = nullptr);
+
+    /**
+     * @brief Load a mesh file (see MeshFile) through a read-only file mapping
+     * @param Device RHI device
+     * @param Filename Mesh file path
+     * @param GeometryPool Shared buffers to suballocate from, nullptr for dedicated buffers
+     */
+    static std::unique_ptr<KMesh> LoadFromFile(IRHIDevice* Device, const std::wstring& Filename,
+                                               std::shared_ptr<KGeometryPool> GeometryPool = nullptr);
+
+    /**
+     * @brief Import an OBJ or glTF file (see MeshImporter), then optimize, generate LODs and upload it
+     * @param Device RHI device
+     * @param Filename .obj, .gltf or .glb path
+     * @param JobSystem Worker pool for parsing and LOD generation, nullptr for the calling thread
+     * @param GeometryPool Shared buffers to suballocate from, nullptr for dedicated buffers
+     */
+    static std::unique_ptr<KMesh> Import(IRHIDevice* Device, const std::wstring& Filename,
+                                         EVertexLayout Layout = EVertexLayout::Standard,
+                                         const FMeshLODSettings* LODSettings = nullptr, KJobSystem* JobSystem = nullptr,
+                                         std::shared_ptr<KGeometryPool> GeometryPool = nullptr);
 
 private:
     /**
-     * @brief Create vertex buffer
+     * @brief Log the optimization / LOD results of a build and upload it
      */
-    HRESULT CreateVertexBuffer(ID3D11Device* Device, const FVertex* Vertices, UINT32 VertexCount);
+    HRESULT InitializeFromBuild(IRHIDevice* Device, const FMeshBuildData& Build, std::shared_ptr<KGeometryPool> GeometryPool);
 
     /**
-     * @brief Create index buffer
+     * @brief Create vertex buffers (one per stream of the layout), or a pool range
      */
-    HRESULT CreateIndexBuffer(ID3D11Device* Device, const UINT32* Indices, UINT32 IndexCount);
+    HRESULT CreateVertexBuffers(IRHIDevice* Device, const void* const* Streams);
 
     /**
-     * @brief Create constant buffer
+     * @brief Create index buffer in IndexFormat, or a pool range
      */
-    HRESULT CreateConstantBuffer(ID3D11Device* Device);
+    HRESULT CreateIndexBuffer(IRHIDevice* Device, const void* Indices, UINT32 BufferIndexCount);
 
 private:
-    // DirectX resources
-    ComPtr<ID3D11Buffer> VertexBuffer;
-    ComPtr<ID3D11Buffer> IndexBuffer;
-    ComPtr<ID3D11Buffer> ConstantBuffer;
+    // Dedicated buffers
+    FRHIResourceRef VertexBuffers[VertexFormat::MaxStreams];
+    FRHIResourceRef IndexBuffer;
+
+    // Ranges in the shared geometry pool (used instead of the buffers above)
+    FGeometryPoolAllocation PoolAllocation;
 
     // Mesh information
     UINT32 VertexCount = 0;
     UINT32 IndexCount = 0;
+    EIndexFormat IndexFormat = EIndexFormat::UInt32;
+    FMeshOptimizeStats OptimizeStats;
+
+    // LOD index ranges (LOD 0 first) and material ranges of LOD 0
+    std::vector<FMeshLOD> LODs;
+    std::vector<FMeshSubmesh> Submeshes;
+
+    // Vertex layout
+    EVertexLayout VertexLayout = EVertexLayout::Standard;
+    XMFLOAT4X4 PositionDecode = XMFLOAT4X4(1.0f, 0.0f, 0.0f, 0.0f,
+                                           0.0f, 1.0f, 0.0f, 0.0f,
+                                           0.0f, 0.0f, 1.0f, 0.0f,
+                                           0.0f, 0.0f, 0.0f, 1.0f);
+
+    // Object-space bounds
+    FBoundingBox LocalBounds;
+    FBoundingSphere LocalSphere;
 }; 
\ No newline at end of file
@@ -0,0 +1,429 @@
+﻿#include "MeshFile.h"
+#include "../Core/Profiler.h"
+
+#include <cfloat>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+    inline uint64 AlignBlob(uint64 Offset)
+    {
+        return (Offset + MeshFile::BlobAlignment - 1) & ~uint64(MeshFile::BlobAlignment - 1);
+    }
+
+    inline uint32 GetIndexSize(EIndexFormat Format)
+    {
+        return Format == EIndexFormat::UInt16 ? sizeof(uint16) : sizeof(uint32);
+    }
+
+    inline bool IsStorableLayout(EVertexLayout Layout)
+    {
+        return static_cast<uint32>(Layout) < VertexLayoutCount &&
+               Layout != EVertexLayout::Position && Layout != EVertexLayout::QuantizedPosition;
+    }
+
+    // Point the view at the build storage
+    void BindBuildData(FMeshBuildData& Build, EVertexLayout Layout, uint32 VertexCount, EIndexFormat IndexFormat,
+                       uint32 IndexCount)
+    {
+        FMeshData& Data = Build.Data;
+        Data.Layout = Layout;
+        Data.VertexCount = VertexCount;
+        for (uint32 Stream = 0; Stream < VertexFormat::MaxStreams; ++Stream)
+        {
+            Data.Streams[Stream] = Build.Streams[Stream].empty() ? nullptr : Build.Streams[Stream].data();
+        }
+        Data.IndexFormat = IndexFormat;
+        Data.IndexCount = IndexCount;
+        Data.Indices = Build.Indices.empty() ? nullptr : Build.Indices.data();
+        Data.LODs = Build.LODs.empty() ? nullptr : Build.LODs.data();
+        Data.LODCount = static_cast<uint32>(Build.LODs.size());
+        Data.Submeshes = Build.Submeshes.empty() ? nullptr : Build.Submeshes.data();
+        Data.SubmeshCount = static_cast<uint32>(Build.Submeshes.size());
+    }
+
+    inline const float* GetPosition(const FStandardVertex& Vertex) { return Vertex.Position; }
+    inline const float* GetPosition(const FStandardSkinnedVertex& Vertex) { return Vertex.Vertex.Position; }
+
+    inline bool EncodeVertices(const FStandardVertex* Vertices, uint32 VertexCount, EVertexLayout Layout,
+                               const FBoundingBox& Bounds, std::vector<uint8> (&OutStreams)[VertexFormat::MaxStreams])
+    {
+        return VertexFormat::Encode(Vertices, VertexCount, Layout, Bounds, OutStreams);
+    }
+
+    inline bool EncodeVertices(const FStandardSkinnedVertex* Vertices, uint32 VertexCount, EVertexLayout,
+                               const FBoundingBox&, std::vector<uint8> (&OutStreams)[VertexFormat::MaxStreams])
+    {
+        VertexFormat::EncodeSkinned(Vertices, VertexCount, OutStreams);
+        return true;
+    }
+}
+
+// Shared by Build and BuildSkinned: vertices are moved as whole structs
+template<typename TVertex>
+static bool BuildMesh(const TVertex* Vertices, uint32 VertexCount, const uint32* Indices, uint32 IndexCount,
+                      EVertexLayout Layout, bool bOptimize, FMeshBuildData& OutBuild,
+                      const FMeshSubmesh* Submeshes, uint32 SubmeshCount,
+                      const FMeshLODSettings* LODSettings, KJobSystem* JobSystem)
+{
+    OutBuild = FMeshBuildData();
+    if (!IsStorableLayout(Layout) || !Vertices || VertexCount == 0 || (Indices && IndexCount == 0))
+    {
+        return false;
+    }
+
+    for (uint32 i = 0; Indices && i < IndexCount; ++i)
+    {
+        if (Indices[i] >= VertexCount)
+        {
+            return false;
+        }
+    }
+
+    for (uint32 i = 0; Submeshes && i < SubmeshCount; ++i)
+    {
+        if (!Indices || uint64(Submeshes[i].FirstIndex) + Submeshes[i].IndexCount > IndexCount)
+        {
+            return false;
+        }
+    }
+    if (Submeshes)
+    {
+        OutBuild.Submeshes.assign(Submeshes, Submeshes + SubmeshCount);
+    }
+
+    std::vector<TVertex> WorkVertices(Vertices, Vertices + VertexCount);
+    std::vector<uint32> WorkIndices;
+    if (Indices)
+    {
+        WorkIndices.assign(Indices, Indices + IndexCount);
+    }
+
+    // Whole-buffer passes may move triangles between submeshes
+    const bool bWholeMesh = OutBuild.Submeshes.empty() ||
+                            (OutBuild.Submeshes.size() == 1 && OutBuild.Submeshes[0].FirstIndex == 0 &&
+                             OutBuild.Submeshes[0].IndexCount == IndexCount);
+    const uint32 PositionStride = sizeof(TVertex);
+
+    // Optimize index and vertex order
+    if (bOptimize && Indices && IndexCount >= 3)
+    {
+        if (bWholeMesh)
+        {
+            OutBuild.OptimizeStats = MeshOptimizer::OptimizeMesh(WorkVertices.data(), VertexCount, PositionStride,
+                                                                 WorkIndices.data(), IndexCount);
+        }
+        else
+        {
+            FMeshOptimizeStats& Stats = OutBuild.OptimizeStats;
+            Stats.Before = MeshOptimizer::AnalyzeVertexCache(WorkIndices.data(), IndexCount, VertexCount);
+            for (const FMeshSubmesh& Submesh : OutBuild.Submeshes)
+            {
+                uint32* Range = WorkIndices.data() + Submesh.FirstIndex;
+                MeshOptimizer::OptimizeVertexCache(Range, Range, Submesh.IndexCount, VertexCount);
+                Stats.ClusterCount += MeshOptimizer::OptimizeOverdraw(Range, Range, Submesh.IndexCount,
+                                                                      GetPosition(WorkVertices[0]), VertexCount, PositionStride);
+            }
+
+            const uint32 OptimizedCount = MeshOptimizer::OptimizeVertexFetch(WorkVertices.data(), VertexCount, PositionStride,
+                                                                             WorkIndices.data(), IndexCount);
+            Stats.RemovedVertexCount = VertexCount - OptimizedCount;
+            VertexCount = OptimizedCount;
+            Stats.After = MeshOptimizer::AnalyzeVertexCache(WorkIndices.data(), IndexCount, VertexCount);
+        }
+    }
+
+    // Simplified LODs follow LOD 0 in the same index buffer
+    uint32 BufferIndexCount = IndexCount;
+    if (Indices && IndexCount >= 3 && LODSettings && bWholeMesh)
+    {
+        std::vector<uint32> LODIndices;
+        MeshSimplifier::GenerateLODs(WorkIndices.data(), IndexCount, GetPosition(WorkVertices[0]), VertexCount, PositionStride,
+                                     *LODSettings, LODIndices, OutBuild.LODs, JobSystem);
+        WorkIndices.swap(LODIndices);
+        BufferIndexCount = static_cast<uint32>(WorkIndices.size());
+    }
+    else if (Indices)
+    {
+        FMeshLOD BaseLOD;
+        BaseLOD.IndexCount = IndexCount;
+        BaseLOD.ScreenSize = FLT_MAX;
+        OutBuild.LODs.push_back(BaseLOD);
+    }
+
+    // Bounds for culling; quantized positions are relative to them
+    FMeshData& Data = OutBuild.Data;
+    Data.Bounds = Bounds::ComputeBox(GetPosition(WorkVertices[0]), VertexCount, PositionStride);
+    Data.Sphere = Bounds::ComputeSphere(GetPosition(WorkVertices[0]), VertexCount, PositionStride);
+
+    if (!EncodeVertices(WorkVertices.data(), VertexCount, Layout, Data.Bounds, OutBuild.Streams))
+    {
+        return false;
+    }
+
+    // Halve index bandwidth when every vertex fits in 16 bits
+    EIndexFormat IndexFormat = EIndexFormat::UInt32;
+    if (Indices)
+    {
+        if (MeshOptimizer::CanUse16BitIndices(VertexCount))
+        {
+            IndexFormat = EIndexFormat::UInt16;
+            OutBuild.Indices.resize(BufferIndexCount * sizeof(uint16));
+            uint16* ShortIndices = reinterpret_cast<uint16*>(OutBuild.Indices.data());
+            for (uint32 i = 0; i < BufferIndexCount; ++i)
+            {
+                ShortIndices[i] = static_cast<uint16>(WorkIndices[i]);
+            }
+        }
+        else
+        {
+            OutBuild.Indices.resize(BufferIndexCount * sizeof(uint32));
+            std::memcpy(OutBuild.Indices.data(), WorkIndices.data(), OutBuild.Indices.size());
+        }
+    }
+
+    BindBuildData(OutBuild, Layout, VertexCount, IndexFormat, Indices ? BufferIndexCount : 0);
+    return true;
+}
+
+bool MeshFile::Build(const FStandardVertex* Vertices, uint32 VertexCount, const uint32* Indices, uint32 IndexCount,
+                     EVertexLayout Layout, bool bOptimize, FMeshBuildData& OutBuild,
+                     const FMeshSubmesh* Submeshes, uint32 SubmeshCount,
+                     const FMeshLODSettings* LODSettings, KJobSystem* JobSystem)
+{
+    KE_PROFILE_FUNCTION();
+
+    if (Layout == EVertexLayout::Skinned)
+    {
+        OutBuild = FMeshBuildData();
+        return false;
+    }
+    return BuildMesh(Vertices, VertexCount, Indices, IndexCount, Layout, bOptimize, OutBuild,
+                     Submeshes, SubmeshCount, LODSettings, JobSystem);
+}
+
+bool MeshFile::BuildSkinned(const FStandardSkinnedVertex* Vertices, uint32 VertexCount, const uint32* Indices, uint32 IndexCount,
+                            bool bOptimize, FMeshBuildData& OutBuild,
+                            const FMeshSubmesh* Submeshes, uint32 SubmeshCount,
+                            const FMeshLODSettings* LODSettings, KJobSystem* JobSystem)
+{
+    KE_PROFILE_FUNCTION();
+
+    return BuildMesh(Vertices, VertexCount, Indices, IndexCount, EVertexLayout::Skinned, bOptimize, OutBuild,
+                     Submeshes, SubmeshCount, LODSettings, JobSystem);
+}
+
+void MeshFile::Write(const FMeshData& Data, std::vector<uint8>& OutFile)
+{
+    FMeshFileHeader Header = {};
+    Header.Magic = Magic;
+    Header.Version = Version;
+    Header.HeaderSize = sizeof(FMeshFileHeader);
+    Header.Layout = static_cast<uint8>(Data.Layout);
+    Header.IndexFormat = static_cast<uint8>(Data.IndexFormat);
+    Header.VertexCount = Data.VertexCount;
+    Header.IndexCount = Data.Indices ? Data.IndexCount : 0;
+    Header.LODCount = Data.LODs ? Data.LODCount : 0;
+    Header.SubmeshCount = Data.Submeshes ? Data.SubmeshCount : 0;
+    for (uint32 Axis = 0; Axis < 3; ++Axis)
+    {
+        Header.BoundsCenter[Axis] = Data.Bounds.Center[Axis];
+        Header.BoundsExtents[Axis] = Data.Bounds.Extents[Axis];
+        Header.SphereCenter[Axis] = Data.Sphere.Center[Axis];
+    }
+    Header.SphereRadius = Data.Sphere.Radius;
+
+    // Lay the blobs out
+    const uint32 StreamCount = VertexFormat::GetStreamCount(Data.Layout);
+    uint64 StreamSizes[VertexFormat::MaxStreams] = {};
+    uint64 Cursor = AlignBlob(sizeof(FMeshFileHeader));
+    for (uint32 Stream = 0; Stream < StreamCount; ++Stream)
+    {
+        StreamSizes[Stream] = uint64(Data.VertexCount) * VertexFormat::GetStreamStride(Data.Layout, Stream);
+        Header.StreamOffsets[Stream] = Cursor;
+        Cursor = AlignBlob(Cursor + StreamSizes[Stream]);
+    }
+
+    const uint64 IndexSize = uint64(Header.IndexCount) * GetIndexSize(Data.IndexFormat);
+    if (Header.IndexCount > 0)
+    {
+        Header.IndexOffset = Cursor;
+        Cursor = AlignBlob(Cursor + IndexSize);
+    }
+    if (Header.LODCount > 0)
+    {
+        Header.LODOffset = Cursor;
+        Cursor = AlignBlob(Cursor + uint64(Header.LODCount) * sizeof(FMeshLOD));
+    }
+    if (Header.SubmeshCount > 0)
+    {
+        Header.SubmeshOffset = Cursor;
+        Cursor = AlignBlob(Cursor + uint64(Header.SubmeshCount) * sizeof(FMeshSubmesh));
+    }
+    Header.FileSize = Cursor;
+
+    // Padding stays zero
+    OutFile.assign(static_cast<size_t>(Header.FileSize), 0);
+    std::memcpy(OutFile.data(), &Header, sizeof(Header));
+    for (uint32 Stream = 0; Stream < StreamCount; ++Stream)
+    {
+        std::memcpy(&OutFile[Header.StreamOffsets[Stream]], Data.Streams[Stream], StreamSizes[Stream]);
+    }
+    if (Header.IndexCount > 0)
+    {
+        std::memcpy(&OutFile[Header.IndexOffset], Data.Indices, IndexSize);
+    }
+    if (Header.LODCount > 0)
+    {
+        std::memcpy(&OutFile[Header.LODOffset], Data.LODs, Header.LODCount * sizeof(FMeshLOD));
+    }
+    if (Header.SubmeshCount > 0)
+    {
+        std::memcpy(&OutFile[Header.SubmeshOffset], Data.Submeshes, Header.SubmeshCount * sizeof(FMeshSubmesh));
+    }
+}
+
+bool MeshFile::WriteFile(const FMeshData& Data, const std::string& Path)
+{
+    std::vector<uint8> Image;
+    Write(Data, Image);
+
+    std::ofstream File(Path, std::ios::binary | std::ios::trunc);
+    if (!File)
+    {
+        return false;
+    }
+
+    File.write(reinterpret_cast<const char*>(Image.data()), static_cast<std::streamsize>(Image.size()));
+    return static_cast<bool>(File);
+}
+
+bool KMeshFile::Open(const std::string& Path)
+{
+    Close();
+
+    if (!File.Open(Path))
+    {
+        return false;
+    }
+
+    if (!Parse(File.GetData(), File.GetSize()))
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+bool KMeshFile::OpenMemory(const void* FileData, size_t FileSize)
+{
+    Close();
+    return FileData && Parse(static_cast<const uint8*>(FileData), FileSize);
+}
+
+void KMeshFile::Close()
+{
+    File.Close();
+    Data = FMeshData();
+    bOpen = false;
+}
+
+bool KMeshFile::Parse(const uint8* FileData, size_t FileSize)
+{
+    if (FileSize < sizeof(FMeshFileHeader))
+    {
+        return false;
+    }
+
+    // The header is read in place: mapped views and blobs are aligned
+    const FMeshFileHeader& Header = *reinterpret_cast<const FMeshFileHeader*>(FileData);
+    if (Header.Magic != MeshFile::Magic || Header.Version != MeshFile::Version ||
+        Header.HeaderSize != sizeof(FMeshFileHeader) || Header.FileSize > FileSize)
+    {
+        return false;
+    }
+
+    const EVertexLayout Layout = static_cast<EVertexLayout>(Header.Layout);
+    const EIndexFormat IndexFormat = static_cast<EIndexFormat>(Header.IndexFormat);
+    if (!IsStorableLayout(Layout) || Header.IndexFormat > static_cast<uint8>(EIndexFormat::UInt32) ||
+        Header.VertexCount == 0)
+    {
+        return false;
+    }
+
+    // Every blob must be aligned and lie inside the file
+    auto IsBlobValid = [&Header](uint64 Offset, uint64 Size)
+    {
+        return Offset % MeshFile::BlobAlignment == 0 && Offset >= sizeof(FMeshFileHeader) &&
+               Offset <= Header.FileSize && Size <= Header.FileSize - Offset;
+    };
+
+    // Filled locally so a file rejected partway leaves Data empty
+    FMeshData Parsed;
+    const uint32 StreamCount = VertexFormat::GetStreamCount(Layout);
+    for (uint32 Stream = 0; Stream < StreamCount; ++Stream)
+    {
+        const uint64 StreamSize = uint64(Header.VertexCount) * VertexFormat::GetStreamStride(Layout, Stream);
+        if (!IsBlobValid(Header.StreamOffsets[Stream], StreamSize))
+        {
+            return false;
+        }
+        Parsed.Streams[Stream] = FileData + Header.StreamOffsets[Stream];
+    }
+
+    if ((Header.IndexCount > 0 && !IsBlobValid(Header.IndexOffset, uint64(Header.IndexCount) * GetIndexSize(IndexFormat))) ||
+        (Header.LODCount > 0 && !IsBlobValid(Header.LODOffset, uint64(Header.LODCount) * sizeof(FMeshLOD))) ||
+        (Header.SubmeshCount > 0 && !IsBlobValid(Header.SubmeshOffset, uint64(Header.SubmeshCount) * sizeof(FMeshSubmesh))) ||
+        Header.LODCount > FMeshLODSettings::MaxLODs || (Header.LODCount > 0) != (Header.IndexCount > 0))
+    {
+        return false;
+    }
+
+    // Offsets of empty blobs are never validated, so pointers are only formed for non-empty ones
+    if (Header.LODCount > 0)
+    {
+        const FMeshLOD* LODs = reinterpret_cast<const FMeshLOD*>(FileData + Header.LODOffset);
+        for (uint32 LOD = 0; LOD < Header.LODCount; ++LOD)
+        {
+            if (uint64(LODs[LOD].FirstIndex) + LODs[LOD].IndexCount > Header.IndexCount)
+            {
+                return false;
+            }
+        }
+        Parsed.LODs = LODs;
+    }
+
+    if (Header.SubmeshCount > 0)
+    {
+        const FMeshSubmesh* Submeshes = reinterpret_cast<const FMeshSubmesh*>(FileData + Header.SubmeshOffset);
+        for (uint32 Submesh = 0; Submesh < Header.SubmeshCount; ++Submesh)
+        {
+            if (uint64(Submeshes[Submesh].FirstIndex) + Submeshes[Submesh].IndexCount > Header.IndexCount)
+            {
+                return false;
+            }
+        }
+        Parsed.Submeshes = Submeshes;
+    }
+
+    // Index values are not scanned; vertex fetches are bounds-checked by the GPU
+    Parsed.Layout = Layout;
+    Parsed.IndexFormat = IndexFormat;
+    Parsed.VertexCount = Header.VertexCount;
+    Parsed.IndexCount = Header.IndexCount;
+    Parsed.Indices = Header.IndexCount > 0 ? FileData + Header.IndexOffset : nullptr;
+    Parsed.LODCount = Header.LODCount;
+    Parsed.SubmeshCount = Header.SubmeshCount;
+    for (uint32 Axis = 0; Axis < 3; ++Axis)
+    {
+        Parsed.Bounds.Center[Axis] = Header.BoundsCenter[Axis];
+        Parsed.Bounds.Extents[Axis] = Header.BoundsExtents[Axis];
+        Parsed.Sphere.Center[Axis] = Header.SphereCenter[Axis];
+    }
+    Parsed.Sphere.Radius = Header.SphereRadius;
+
+    Data = Parsed;
+    bOpen = true;
+    return true;
+}
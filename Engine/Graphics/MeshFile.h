@@ -0,0 +1,188 @@
+﻿#pragma once
+
+#include <string>
+#include <vector>
+
+#include "../Utils/Types.h"
+#include "../Utils/Bounds.h"
+#include "../Core/MappedFile.h"
+#include "GraphicsTypes.h"
+#include "VertexFormat.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+
+class KJobSystem;
+
+/**
+ * @brief Index range of LOD 0 drawn with one material
+ */
+struct FMeshSubmesh
+{
+    uint32 FirstIndex = 0;
+    uint32 IndexCount = 0;
+    uint32 MaterialIndex = 0;
+    uint32 Reserved = 0;
+};
+
+/**
+ * @brief GPU-ready mesh data: encoded vertex streams, final-format indices, ranges and bounds
+ *
+ * Non-owning view; points into a mapped mesh file or into an FMeshBuildData.
+ * KMesh uploads it as is, without converting or copying.
+ */
+struct FMeshData
+{
+    EVertexLayout Layout = EVertexLayout::Standard;
+    EIndexFormat IndexFormat = EIndexFormat::UInt32;
+
+    uint32 VertexCount = 0;
+    const void* Streams[VertexFormat::MaxStreams] = {};   // VertexCount * stream stride bytes each
+
+    uint32 IndexCount = 0;              // Indices in the buffer (every LOD)
+    const void* Indices = nullptr;      // nullptr for non-indexed meshes
+
+    const FMeshLOD* LODs = nullptr;     // Ranges of the index buffer, LOD 0 first
+    uint32 LODCount = 0;
+    const FMeshSubmesh* Submeshes = nullptr;
+    uint32 SubmeshCount = 0;
+
+    FBoundingBox Bounds;                // Object-space bounds (quantized positions are relative to them)
+    FBoundingSphere Sphere;
+};
+
+/**
+ * @brief Storage behind an FMeshData built from full-precision vertices
+ */
+struct FMeshBuildData
+{
+    std::vector<uint8> Streams[VertexFormat::MaxStreams];
+    std::vector<uint8> Indices;
+    std::vector<FMeshLOD> LODs;
+    std::vector<FMeshSubmesh> Submeshes;
+    FMeshOptimizeStats OptimizeStats;
+    FMeshData Data;                     // Points into the members above
+
+    // Data stays valid across moves, not copies
+    FMeshBuildData() = default;
+    FMeshBuildData(const FMeshBuildData&) = delete;
+    FMeshBuildData& operator=(const FMeshBuildData&) = delete;
+    FMeshBuildData(FMeshBuildData&&) = default;
+    FMeshBuildData& operator=(FMeshBuildData&&) = default;
+};
+
+/**
+ * @brief Mesh file header
+ *
+ * A mesh file is the header followed by blobs, each starting at a multiple of
+ * MeshFile::BlobAlignment: vertex streams, indices, LODs, submeshes. Offsets
+ * are from the start of the file; all values are little endian.
+ */
+struct FMeshFileHeader
+{
+    uint32 Magic;
+    uint16 Version;
+    uint16 HeaderSize;
+    uint8 Layout;                       // EVertexLayout
+    uint8 IndexFormat;                  // EIndexFormat
+    uint16 Flags;                       // Reserved, 0
+    uint32 VertexCount;
+    uint32 IndexCount;
+    uint32 LODCount;
+    uint32 SubmeshCount;
+    float BoundsCenter[3];
+    float BoundsExtents[3];
+    float SphereCenter[3];
+    float SphereRadius;
+    uint32 Padding;                     // 0
+    uint64 StreamOffsets[VertexFormat::MaxStreams];
+    uint64 IndexOffset;
+    uint64 LODOffset;
+    uint64 SubmeshOffset;
+    uint64 FileSize;
+    uint64 Reserved;                    // 0
+};
+
+static_assert(sizeof(FMeshFileHeader) == 128, "Mesh file header layout changed");
+static_assert(sizeof(FMeshLOD) == 16 && sizeof(FMeshSubmesh) == 16, "Mesh file records are stored as is");
+
+/**
+ * @brief Reader of mesh files: maps the file and validates it in place
+ */
+class KMeshFile
+{
+public:
+    /**
+     * @brief Map and validate a mesh file
+     * @param Path UTF-8 file path
+     * @return true if the file is a valid mesh file of a supported version
+     */
+    bool Open(const std::string& Path);
+
+    /**
+     * @brief Validate a mesh file image already in memory (not copied; must outlive the reader)
+     */
+    bool OpenMemory(const void* FileData, size_t FileSize);
+
+    /**
+     * @brief Release the mapping (GetData pointers become invalid)
+     */
+    void Close();
+
+    /**
+     * @brief Mesh data pointing into the mapped file
+     */
+    const FMeshData& GetData() const { return Data; }
+    bool IsOpen() const { return bOpen; }
+
+private:
+    bool Parse(const uint8* FileData, size_t FileSize);
+
+private:
+    KMappedFile File;
+    FMeshData Data;
+    bool bOpen = false;
+};
+
+namespace MeshFile
+{
+    constexpr uint32 Magic = 0x48534D4B;        // "KMSH"
+    constexpr uint16 Version = 1;
+    constexpr uint32 BlobAlignment = 64;
+
+    /**
+     * @brief Prepare full-precision vertices for upload or writing
+     *
+     * Optimizes index and vertex order, generates LODs, encodes the layout's
+     * streams and narrows indices to 16 bits when possible. With several
+     * submeshes each range is optimized on its own and no LODs are generated.
+     * @param Submeshes Ranges of Indices, nullptr for one submesh covering all indices
+     * @param LODSettings LOD chain settings, nullptr for LOD 0 only
+     * @param JobSystem Worker pool the LODs are simplified on, nullptr for the calling thread
+     * @return false if the input is invalid (indices out of range, position-only or skinned layout)
+     */
+    bool Build(const FStandardVertex* Vertices, uint32 VertexCount, const uint32* Indices, uint32 IndexCount,
+               EVertexLayout Layout, bool bOptimize, FMeshBuildData& OutBuild,
+               const FMeshSubmesh* Submeshes = nullptr, uint32 SubmeshCount = 0,
+               const FMeshLODSettings* LODSettings = nullptr, KJobSystem* JobSystem = nullptr);
+
+    /**
+     * @brief Build for skinned vertices (EVertexLayout::Skinned)
+     *
+     * Same steps as Build; joint indices and weights move with their vertices.
+     */
+    bool BuildSkinned(const FStandardSkinnedVertex* Vertices, uint32 VertexCount, const uint32* Indices, uint32 IndexCount,
+                      bool bOptimize, FMeshBuildData& OutBuild,
+                      const FMeshSubmesh* Submeshes = nullptr, uint32 SubmeshCount = 0,
+                      const FMeshLODSettings* LODSettings = nullptr, KJobSystem* JobSystem = nullptr);
+
+    /**
+     * @brief Serialize mesh data into a mesh file image
+     */
+    void Write(const FMeshData& Data, std::vector<uint8>& OutFile);
+
+    /**
+     * @brief Serialize mesh data into a file
+     * @param Path UTF-8 file path
+     */
+    bool WriteFile(const FMeshData& Data, const std::string& Path);
+}
@@ -0,0 +1,1981 @@
+﻿#include "MeshImporter.h"
+#include "../Core/JobSystem.h"
+#include "../Core/MappedFile.h"
+#include "../Core/Profiler.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <unordered_map>
+
+namespace
+{
+    using FClock = std::chrono::steady_clock;
+
+    // Runs Task for every index on the job system, or on the calling thread without one
+    void RunParallel(KJobSystem* JobSystem, uint32 Count, const KJobSystem::FTaskFunction& Task)
+    {
+        if (JobSystem && Count > 1)
+        {
+            JobSystem->ParallelFor(Count, Task);
+            return;
+        }
+        for (uint32 i = 0; i < Count; ++i)
+        {
+            Task(i, 0);
+        }
+    }
+
+    inline uint64 MixHash(uint64 Value)
+    {
+        Value ^= Value >> 33;
+        Value *= 0xFF51AFD7ED558CCDull;
+        Value ^= Value >> 33;
+        Value *= 0xC4CEB9FE1A85EC53ull;
+        Value ^= Value >> 33;
+        return Value;
+    }
+
+    /**
+     * @brief Open-addressing hash table of item indices; the items live in the caller's arrays
+     */
+    class FIndexHashTable
+    {
+    public:
+        static constexpr uint32 Empty = ~0u;
+
+        void Reset(size_t ExpectedCount)
+        {
+            size_t Capacity = 16;
+            while (Capacity < ExpectedCount * 2)
+            {
+                Capacity <<= 1;
+            }
+            Slots.assign(Capacity, Empty);
+            Count = 0;
+        }
+
+        // Grow ahead of a possible insert; HashOf rehashes the stored items
+        template <typename FHashOf>
+        void ReserveOne(FHashOf&& HashOf)
+        {
+            if ((Count + 1) * 2 <= Slots.size())
+            {
+                return;
+            }
+            std::vector<uint32> OldSlots(Slots.size() * 2, Empty);
+            OldSlots.swap(Slots);
+            const size_t Mask = Slots.size() - 1;
+            for (uint32 Item : OldSlots)
+            {
+                if (Item == Empty)
+                {
+                    continue;
+                }
+                size_t Slot = static_cast<size_t>(HashOf(Item)) & Mask;
+                while (Slots[Slot] != Empty)
+                {
+                    Slot = (Slot + 1) & Mask;
+                }
+                Slots[Slot] = Item;
+            }
+        }
+
+        // Slot of the item IsEqual accepts, or the empty slot a new item with this hash goes to
+        template <typename FEqual>
+        uint32& Find(uint64 Hash, FEqual&& IsEqual)
+        {
+            const size_t Mask = Slots.size() - 1;
+            size_t Slot = static_cast<size_t>(Hash) & Mask;
+            while (Slots[Slot] != Empty && !IsEqual(Slots[Slot]))
+            {
+                Slot = (Slot + 1) & Mask;
+            }
+            return Slots[Slot];
+        }
+
+        void OnInsert() { ++Count; }
+
+    private:
+        std::vector<uint32> Slots;
+        size_t Count = 0;
+    };
+
+    inline uint64 HashVertex(const FStandardVertex& Vertex)
+    {
+        uint64 Words[sizeof(FStandardVertex) / sizeof(uint64)];
+        std::memcpy(Words, &Vertex, sizeof(Words));
+        uint64 Hash = 0;
+        for (uint64 Word : Words)
+        {
+            Hash = (Hash ^ Word) * 0x9E3779B97F4A7C15ull;
+            Hash ^= Hash >> 32;
+        }
+        return MixHash(Hash);
+    }
+
+    inline void SetDefaultVertex(FStandardVertex& Vertex)
+    {
+        Vertex = FStandardVertex();
+        Vertex.Color[0] = Vertex.Color[1] = Vertex.Color[2] = Vertex.Color[3] = 1.0f;
+    }
+
+    // Smooth, area-weighted normals for vertices left without one (zero normal)
+    void GenerateMissingNormals(FImportedMesh& Mesh)
+    {
+        std::vector<uint8> Missing(Mesh.Vertices.size());
+        bool bAnyMissing = false;
+        for (size_t v = 0; v < Mesh.Vertices.size(); ++v)
+        {
+            const float* Normal = Mesh.Vertices[v].Normal;
+            Missing[v] = Normal[0] == 0.0f && Normal[1] == 0.0f && Normal[2] == 0.0f;
+            bAnyMissing |= Missing[v] != 0;
+        }
+        if (!bAnyMissing)
+        {
+            return;
+        }
+
+        for (size_t i = 0; i + 2 < Mesh.Indices.size(); i += 3)
+        {
+            const uint32 Corners[3] = { Mesh.Indices[i], Mesh.Indices[i + 1], Mesh.Indices[i + 2] };
+            if (!Missing[Corners[0]] && !Missing[Corners[1]] && !Missing[Corners[2]])
+            {
+                continue;
+            }
+            const float* A = Mesh.Vertices[Corners[0]].Position;
+            const float* B = Mesh.Vertices[Corners[1]].Position;
+            const float* C = Mesh.Vertices[Corners[2]].Position;
+            const float AB[3] = { B[0] - A[0], B[1] - A[1], B[2] - A[2] };
+            const float AC[3] = { C[0] - A[0], C[1] - A[1], C[2] - A[2] };
+            const float FaceNormal[3] = { AB[1] * AC[2] - AB[2] * AC[1], AB[2] * AC[0] - AB[0] * AC[2], AB[0] * AC[1] - AB[1] * AC[0] };
+            for (uint32 Corner : Corners)
+            {
+                if (Missing[Corner])
+                {
+                    float* Normal = Mesh.Vertices[Corner].Normal;
+                    Normal[0] += FaceNormal[0];
+                    Normal[1] += FaceNormal[1];
+                    Normal[2] += FaceNormal[2];
+                }
+            }
+        }
+
+        for (size_t v = 0; v < Mesh.Vertices.size(); ++v)
+        {
+            if (!Missing[v])
+            {
+                continue;
+            }
+            float* Normal = Mesh.Vertices[v].Normal;
+            const float Length = std::sqrt(Normal[0] * Normal[0] + Normal[1] * Normal[1] + Normal[2] * Normal[2]);
+            if (Length > 0.0f)
+            {
+                Normal[0] /= Length;
+                Normal[1] /= Length;
+                Normal[2] /= Length;
+            }
+            else
+            {
+                Normal[1] = 1.0f;
+            }
+        }
+    }
+
+    void FinalizeMesh(FImportedMesh& Mesh, const FMeshImportSettings& Settings)
+    {
+        if (Settings.bGenerateNormals)
+        {
+            GenerateMissingNormals(Mesh);
+        }
+
+        // Mirroring Z keeps the screen-space winding, so it is flipped to stay front facing
+        if (Settings.bConvertToLeftHanded)
+        {
+            for (FStandardVertex& Vertex : Mesh.Vertices)
+            {
+                Vertex.Position[2] = -Vertex.Position[2];
+                Vertex.Normal[2] = -Vertex.Normal[2];
+            }
+            for (size_t i = 0; i + 2 < Mesh.Indices.size(); i += 3)
+            {
+                std::swap(Mesh.Indices[i + 1], Mesh.Indices[i + 2]);
+            }
+        }
+    }
+
+    bool EndsWith(const std::string& Text, const char* Suffix)
+    {
+        const size_t Length = std::strlen(Suffix);
+        if (Text.size() < Length)
+        {
+            return false;
+        }
+        for (size_t i = 0; i < Length; ++i)
+        {
+            const char C = Text[Text.size() - Length + i];
+            if ((C >= 'A' && C <= 'Z' ? C - 'A' + 'a' : C) != Suffix[i])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    //
+    // Wavefront OBJ
+    //
+
+    constexpr uint32 ObjAttributeCount = 3;                              // Position, texture coordinate, normal
+    constexpr uint32 ObjComponents[ObjAttributeCount] = { 3, 2, 3 };
+
+    // Face corner as written: 0-based absolute, or relative to the chunk's attribute counts
+    struct FObjCorner
+    {
+        int32 Index[ObjAttributeCount];
+        uint8 Relative;                 // Bit per attribute: Index is chunk-local count + negative file index
+        uint8 Present;                  // Bit per attribute
+    };
+
+    // Resolved corner: 0-based indices into the file's attributes, -1 when absent
+    struct FObjKey
+    {
+        int32 Index[ObjAttributeCount];
+
+        bool operator==(const FObjKey& Other) const
+        {
+            return Index[0] == Other.Index[0] && Index[1] == Other.Index[1] && Index[2] == Other.Index[2];
+        }
+    };
+
+    inline uint64 HashObjKey(const FObjKey& Key)
+    {
+        return MixHash((uint64(uint32(Key.Index[0])) << 32 | uint32(Key.Index[1])) ^
+                       uint64(uint32(Key.Index[2])) * 0x9E3779B97F4A7C15ull);
+    }
+
+    struct FObjMaterialSwitch
+    {
+        uint32 Triangle;                // First triangle of the chunk using the material
+        std::string Name;
+    };
+
+    struct FObjChunk
+    {
+        const char* Begin = nullptr;
+        const char* End = nullptr;
+        std::vector<float> Attributes[ObjAttributeCount];
+        std::vector<FObjCorner> Corners;            // Three per triangle
+        std::vector<FObjCorner> FaceCorners;        // Polygon being triangulated
+        std::vector<FObjMaterialSwitch> Switches;
+        std::vector<FObjKey> Keys;                  // Distinct resolved corners
+        std::vector<uint32> CornerKeys;             // Corner -> Keys index
+        std::vector<uint32> KeyVertices;            // Keys index -> mesh vertex
+        uint64 Base[ObjAttributeCount] = {};        // Attributes of the file before the chunk
+        FIndexHashTable Table;
+        const char* Error = nullptr;
+
+        void Reset(const char* InBegin, const char* InEnd)
+        {
+            Begin = InBegin;
+            End = InEnd;
+            for (std::vector<float>& Values : Attributes)
+            {
+                Values.clear();
+            }
+            Corners.clear();
+            Switches.clear();
+            Keys.clear();
+            Error = nullptr;
+        }
+    };
+
+    inline const char* SkipSpaces(const char* Cursor, const char* End)
+    {
+        while (Cursor < End && (*Cursor == ' ' || *Cursor == '\t'))
+        {
+            ++Cursor;
+        }
+        return Cursor;
+    }
+
+    inline bool IsSpace(char C)
+    {
+        return C == ' ' || C == '\t';
+    }
+
+    // Returns the end of the number, nullptr if there is none
+    inline const char* ParseFloat(const char* Cursor, const char* End, float& OutValue)
+    {
+        Cursor = SkipSpaces(Cursor, End);
+        if (Cursor < End && *Cursor == '+')
+        {
+            ++Cursor;
+        }
+        const std::from_chars_result Result = std::from_chars(Cursor, End, OutValue);
+        if (Result.ec == std::errc::invalid_argument)
+        {
+            return nullptr;
+        }
+        if (Result.ec == std::errc::result_out_of_range)
+        {
+            OutValue = 0.0f;
+        }
+        return Result.ptr;
+    }
+
+    void ParseObjFace(FObjChunk& Chunk, const char* Cursor, const char* End)
+    {
+        Chunk.FaceCorners.clear();
+        for (Cursor = SkipSpaces(Cursor, End); Cursor < End; Cursor = SkipSpaces(Cursor, End))
+        {
+            // v, v/vt, v//vn or v/vt/vn
+            FObjCorner Corner = {};
+            for (uint32 Attribute = 0; Attribute < ObjAttributeCount; ++Attribute)
+            {
+                if (Attribute > 0)
+                {
+                    if (Cursor >= End || *Cursor != '/')
+                    {
+                        break;
+                    }
+                    ++Cursor;
+                }
+                if (Cursor >= End || *Cursor == '/' || IsSpace(*Cursor))
+                {
+                    continue;
+                }
+
+                int32 Index = 0;
+                const std::from_chars_result Result = std::from_chars(Cursor, End, Index);
+                if (Result.ec != std::errc() || Index == 0)
+                {
+                    Chunk.Error = "Invalid face index";
+                    return;
+                }
+                Cursor = Result.ptr;
+                Corner.Present |= 1 << Attribute;
+                if (Index > 0)
+                {
+                    Corner.Index[Attribute] = Index - 1;
+                }
+                else
+                {
+                    Corner.Index[Attribute] = static_cast<int32>(Chunk.Attributes[Attribute].size() / ObjComponents[Attribute]) + Index;
+                    Corner.Relative |= 1 << Attribute;
+                }
+            }
+            if (!(Corner.Present & 1) || (Cursor < End && !IsSpace(*Cursor)))
+            {
+                Chunk.Error = "Malformed face";
+                return;
+            }
+            Chunk.FaceCorners.push_back(Corner);
+        }
+
+        if (Chunk.FaceCorners.size() < 3)
+        {
+            Chunk.Error = "Face with fewer than three corners";
+            return;
+        }
+
+        // Polygons become triangle fans
+        for (size_t i = 2; i < Chunk.FaceCorners.size(); ++i)
+        {
+            Chunk.Corners.push_back(Chunk.FaceCorners[0]);
+            Chunk.Corners.push_back(Chunk.FaceCorners[i - 1]);
+            Chunk.Corners.push_back(Chunk.FaceCorners[i]);
+        }
+    }
+
+    void ParseObjChunk(FObjChunk& Chunk)
+    {
+        const char* Cursor = Chunk.Begin;
+        while (Cursor < Chunk.End && !Chunk.Error)
+        {
+            const char* LineEnd = static_cast<const char*>(std::memchr(Cursor, '\n', Chunk.End - Cursor));
+            if (!LineEnd)
+            {
+                LineEnd = Chunk.End;
+            }
+            const char* Line = SkipSpaces(Cursor, LineEnd);
+            const char* End = LineEnd;
+            if (End > Line && End[-1] == '\r')
+            {
+                --End;
+            }
+            Cursor = LineEnd < Chunk.End ? LineEnd + 1 : Chunk.End;
+
+            if (End - Line < 2)
+            {
+                continue;
+            }
+
+            if (Line[0] == 'v')
+            {
+                const int32 Attribute = IsSpace(Line[1]) ? 0 : Line[1] == 't' ? 1 : Line[1] == 'n' ? 2 : -1;
+                if (Attribute < 0)
+                {
+                    continue;
+                }
+
+                // Extra components (w, vertex colors) are ignored; texture coordinates may omit v
+                const char* Value = Line + (Attribute == 0 ? 1 : 2);
+                std::vector<float>& Values = Chunk.Attributes[Attribute];
+                for (uint32 Component = 0; Component < ObjComponents[Attribute]; ++Component)
+                {
+                    float Number = 0.0f;
+                    const char* Next = ParseFloat(Value, End, Number);
+                    if (!Next && (Attribute != 1 || Component == 0))
+                    {
+                        Chunk.Error = "Malformed vertex attribute";
+                        return;
+                    }
+                    Values.push_back(Number);
+                    Value = Next ? Next : End;
+                }
+            }
+            else if (Line[0] == 'f' && IsSpace(Line[1]))
+            {
+                ParseObjFace(Chunk, Line + 1, End);
+            }
+            else if (End - Line > 6 && std::memcmp(Line, "usemtl", 6) == 0 && IsSpace(Line[6]))
+            {
+                const char* Name = SkipSpaces(Line + 6, End);
+                const char* NameEnd = End;
+                while (NameEnd > Name && IsSpace(NameEnd[-1]))
+                {
+                    --NameEnd;
+                }
+                Chunk.Switches.push_back({ static_cast<uint32>(Chunk.Corners.size() / 3), std::string(Name, NameEnd) });
+            }
+        }
+    }
+
+    // Resolve the chunk's corners against the attributes before it, then deduplicate them within the chunk
+    void ResolveObjChunk(FObjChunk& Chunk, bool bDeduplicate)
+    {
+        uint64 Limit[ObjAttributeCount];
+        for (uint32 Attribute = 0; Attribute < ObjAttributeCount; ++Attribute)
+        {
+            Limit[Attribute] = Chunk.Base[Attribute] + Chunk.Attributes[Attribute].size() / ObjComponents[Attribute];
+        }
+
+        Chunk.CornerKeys.resize(Chunk.Corners.size());
+        if (bDeduplicate)
+        {
+            Chunk.Table.Reset(Chunk.Corners.size() / 4);
+        }
+
+        for (size_t i = 0; i < Chunk.Corners.size(); ++i)
+        {
+            const FObjCorner& Corner = Chunk.Corners[i];
+            FObjKey Key;
+            for (uint32 Attribute = 0; Attribute < ObjAttributeCount; ++Attribute)
+            {
+                if (!(Corner.Present & (1 << Attribute)))
+                {
+                    Key.Index[Attribute] = -1;
+                    continue;
+                }
+                const int64 Index = (Corner.Relative & (1 << Attribute)) ? int64(Chunk.Base[Attribute]) + Corner.Index[Attribute]
+                                                                         : int64(Corner.Index[Attribute]);
+                if (Index < 0 || uint64(Index) >= Limit[Attribute] || Index > INT32_MAX)
+                {
+                    Chunk.Error = "Face index out of range";
+                    return;
+                }
+                Key.Index[Attribute] = static_cast<int32>(Index);
+            }
+
+            if (!bDeduplicate)
+            {
+                Chunk.CornerKeys[i] = static_cast<uint32>(Chunk.Keys.size());
+                Chunk.Keys.push_back(Key);
+                continue;
+            }
+
+            Chunk.Table.ReserveOne([&](uint32 Item) { return HashObjKey(Chunk.Keys[Item]); });
+            uint32& Slot = Chunk.Table.Find(HashObjKey(Key), [&](uint32 Item) { return Chunk.Keys[Item] == Key; });
+            if (Slot == FIndexHashTable::Empty)
+            {
+                Slot = static_cast<uint32>(Chunk.Keys.size());
+                Chunk.Keys.push_back(Key);
+                Chunk.Table.OnInsert();
+            }
+            Chunk.CornerKeys[i] = Slot;
+        }
+    }
+
+    /**
+     * @brief Streams an OBJ file through windows of parallel-parsed chunks
+     */
+    class FObjImporter
+    {
+    public:
+        FObjImporter(FImportedMesh& InMesh, const FMeshImportSettings& InSettings, KJobSystem* InJobSystem, FMeshImportStats& InStats)
+            : Mesh(InMesh), Settings(InSettings), JobSystem(InJobSystem), Stats(InStats)
+        {
+        }
+
+        bool Import(const std::string& Path)
+        {
+            std::ifstream File(Path, std::ios::binary);
+            if (!File)
+            {
+                return Fail("Cannot open " + Path);
+            }
+
+            const uint32 ThreadCount = JobSystem ? JobSystem->GetThreadCount() : 1;
+            const size_t ChunkSize = Settings.ChunkSize > 4096 ? Settings.ChunkSize : 4096;
+            const size_t ChunksInFlight = Settings.ChunksInFlight ? Settings.ChunksInFlight : ThreadCount * 2;
+            size_t WindowSize = ChunkSize * ChunksInFlight;
+
+            // Small files are read in one window no larger than the file
+            File.seekg(0, std::ios::end);
+            const uint64 FileSize = static_cast<uint64>(File.tellg());
+            File.seekg(0, std::ios::beg);
+            if (FileSize < WindowSize)
+            {
+                WindowSize = static_cast<size_t>(FileSize) + 1;
+            }
+            VertexTable.Reset(1024);
+
+            std::vector<char> Buffer;
+            size_t Carry = 0;
+            bool bEndOfFile = false;
+            while (!bEndOfFile)
+            {
+                if (Buffer.size() < Carry + WindowSize)
+                {
+                    Buffer.resize(Carry + WindowSize);
+                }
+                File.read(Buffer.data() + Carry, static_cast<std::streamsize>(WindowSize));
+                const size_t ReadSize = static_cast<size_t>(File.gcount());
+                if (File.bad())
+                {
+                    return Fail("Read error in " + Path);
+                }
+                Stats.BytesRead += ReadSize;
+                bEndOfFile = ReadSize < WindowSize;
+
+                // Whole lines only; a partial last line carries over to the next window
+                const size_t Filled = Carry + ReadSize;
+                size_t Parsed = Filled;
+                if (!bEndOfFile)
+                {
+                    while (Parsed > 0 && Buffer[Parsed - 1] != '\n')
+                    {
+                        --Parsed;
+                    }
+                    if (Parsed == 0)
+                    {
+                        Carry = Filled;
+                        WindowSize *= 2;
+                        continue;
+                    }
+                }
+
+                if (!ImportWindow(Buffer.data(), Buffer.data() + Parsed, ChunkSize))
+                {
+                    return false;
+                }
+
+                Carry = Filled - Parsed;
+                std::memmove(Buffer.data(), Buffer.data() + Parsed, Carry);
+            }
+
+            // One submesh per material, in order of first use
+            size_t IndexCount = 0;
+            for (const std::vector<uint32>& Indices : MaterialIndices)
+            {
+                IndexCount += Indices.size();
+            }
+            Mesh.Indices.reserve(IndexCount);
+            for (uint32 Material = 0; Material < MaterialIndices.size(); ++Material)
+            {
+                if (MaterialIndices[Material].empty())
+                {
+                    continue;
+                }
+                FMeshSubmesh Submesh;
+                Submesh.FirstIndex = static_cast<uint32>(Mesh.Indices.size());
+                Submesh.IndexCount = static_cast<uint32>(MaterialIndices[Material].size());
+                Submesh.MaterialIndex = Material;
+                Mesh.Submeshes.push_back(Submesh);
+                Mesh.Indices.insert(Mesh.Indices.end(), MaterialIndices[Material].begin(), MaterialIndices[Material].end());
+            }
+            return Mesh.Indices.empty() ? Fail("No faces in " + Path) : true;
+        }
+
+    private:
+        bool Fail(const std::string& Error)
+        {
+            Stats.Error = Error;
+            return false;
+        }
+
+        bool ImportWindow(const char* Begin, const char* End, size_t ChunkSize)
+        {
+            uint32 ChunkCount = 0;
+            for (const char* Cursor = Begin; Cursor < End; ++ChunkCount)
+            {
+                const char* ChunkEnd = size_t(End - Cursor) > ChunkSize ? Cursor + ChunkSize : End;
+                if (ChunkEnd < End)
+                {
+                    const char* LineEnd = static_cast<const char*>(std::memchr(ChunkEnd, '\n', End - ChunkEnd));
+                    ChunkEnd = LineEnd ? LineEnd + 1 : End;
+                }
+                if (ChunkCount == Chunks.size())
+                {
+                    Chunks.push_back(std::make_unique<FObjChunk>());
+                }
+                Chunks[ChunkCount]->Reset(Cursor, ChunkEnd);
+                Cursor = ChunkEnd;
+            }
+            Stats.ChunkCount += ChunkCount;
+
+            {
+                KE_PROFILE_SCOPE("ParseObjChunks");
+                RunParallel(JobSystem, ChunkCount, [&](uint32 Index, uint32) { ParseObjChunk(*Chunks[Index]); });
+            }
+
+            // Attribute offsets of each chunk; the attributes join the file's arrays
+            for (uint32 i = 0; i < ChunkCount; ++i)
+            {
+                FObjChunk& Chunk = *Chunks[i];
+                if (Chunk.Error)
+                {
+                    return Fail(Chunk.Error);
+                }
+                for (uint32 Attribute = 0; Attribute < ObjAttributeCount; ++Attribute)
+                {
+                    Chunk.Base[Attribute] = Attributes[Attribute].size() / ObjComponents[Attribute];
+                    Attributes[Attribute].insert(Attributes[Attribute].end(), Chunk.Attributes[Attribute].begin(),
+                                                 Chunk.Attributes[Attribute].end());
+                }
+            }
+
+            {
+                KE_PROFILE_SCOPE("ResolveObjChunks");
+                RunParallel(JobSystem, ChunkCount, [&](uint32 Index, uint32) { ResolveObjChunk(*Chunks[Index], Settings.bDeduplicate); });
+            }
+
+            KE_PROFILE_SCOPE("MergeObjChunks");
+            for (uint32 i = 0; i < ChunkCount; ++i)
+            {
+                if (Chunks[i]->Error)
+                {
+                    return Fail(Chunks[i]->Error);
+                }
+                MergeChunk(*Chunks[i]);
+            }
+            return true;
+        }
+
+        // Distinct chunk corners become mesh vertices in file order; triangles go to their material
+        void MergeChunk(FObjChunk& Chunk)
+        {
+            Stats.SourceVertexCount += static_cast<uint32>(Chunk.Corners.size());
+
+            Chunk.KeyVertices.resize(Chunk.Keys.size());
+            for (size_t k = 0; k < Chunk.Keys.size(); ++k)
+            {
+                const FObjKey& Key = Chunk.Keys[k];
+                if (!Settings.bDeduplicate)
+                {
+                    Chunk.KeyVertices[k] = AddVertex(Key);
+                    continue;
+                }
+
+                VertexTable.ReserveOne([&](uint32 Item) { return HashObjKey(VertexKeys[Item]); });
+                uint32& Slot = VertexTable.Find(HashObjKey(Key), [&](uint32 Item) { return VertexKeys[Item] == Key; });
+                if (Slot == FIndexHashTable::Empty)
+                {
+                    Slot = AddVertex(Key);
+                    VertexKeys.push_back(Key);
+                    VertexTable.OnInsert();
+                }
+                Chunk.KeyVertices[k] = Slot;
+            }
+
+            const uint32 TriangleCount = static_cast<uint32>(Chunk.Corners.size() / 3);
+            size_t Switch = 0;
+            for (uint32 Triangle = 0; Triangle < TriangleCount; ++Triangle)
+            {
+                for (; Switch < Chunk.Switches.size() && Chunk.Switches[Switch].Triangle <= Triangle; ++Switch)
+                {
+                    SetMaterial(Chunk.Switches[Switch].Name);
+                }
+                if (CurrentMaterial == FIndexHashTable::Empty)
+                {
+                    SetMaterial(std::string());
+                }
+
+                std::vector<uint32>& Indices = MaterialIndices[CurrentMaterial];
+                for (uint32 Corner = Triangle * 3; Corner < Triangle * 3 + 3; ++Corner)
+                {
+                    Indices.push_back(Chunk.KeyVertices[Chunk.CornerKeys[Corner]]);
+                }
+            }
+            for (; Switch < Chunk.Switches.size(); ++Switch)
+            {
+                SetMaterial(Chunk.Switches[Switch].Name);
+            }
+        }
+
+        uint32 AddVertex(const FObjKey& Key)
+        {
+            FStandardVertex Vertex;
+            SetDefaultVertex(Vertex);
+            std::memcpy(Vertex.Position, &Attributes[0][size_t(Key.Index[0]) * 3], sizeof(Vertex.Position));
+            if (Key.Index[1] >= 0)
+            {
+                // OBJ texture coordinates start at the bottom left
+                Vertex.TexCoord[0] = Attributes[1][size_t(Key.Index[1]) * 2];
+                Vertex.TexCoord[1] = 1.0f - Attributes[1][size_t(Key.Index[1]) * 2 + 1];
+            }
+            if (Key.Index[2] >= 0)
+            {
+                std::memcpy(Vertex.Normal, &Attributes[2][size_t(Key.Index[2]) * 3], sizeof(Vertex.Normal));
+            }
+            Mesh.Vertices.push_back(Vertex);
+            return static_cast<uint32>(Mesh.Vertices.size() - 1);
+        }
+
+        void SetMaterial(const std::string& Name)
+        {
+            auto Inserted = MaterialLookup.emplace(Name, static_cast<uint32>(Mesh.Materials.size()));
+            if (Inserted.second)
+            {
+                Mesh.Materials.push_back(Name);
+                MaterialIndices.emplace_back();
+            }
+            CurrentMaterial = Inserted.first->second;
+        }
+
+    private:
+        FImportedMesh& Mesh;
+        const FMeshImportSettings& Settings;
+        KJobSystem* JobSystem;
+        FMeshImportStats& Stats;
+
+        std::vector<std::unique_ptr<FObjChunk>> Chunks;     // Reused by every window
+        std::vector<float> Attributes[ObjAttributeCount];
+        std::vector<FObjKey> VertexKeys;                    // Mesh vertex -> corner, for deduplication
+        FIndexHashTable VertexTable;
+        std::vector<std::vector<uint32>> MaterialIndices;
+        std::unordered_map<std::string, uint32> MaterialLookup;
+        uint32 CurrentMaterial = FIndexHashTable::Empty;
+    };
+
+    //
+    // JSON (glTF documents)
+    //
+
+    struct FJsonValue
+    {
+        enum class EType : uint8 { Null, Bool, Number, String, Array, Object };
+
+        EType Type = EType::Null;
+        bool bBool = false;
+        double Number = 0.0;
+        std::string String;
+        std::vector<FJsonValue> Elements;           // Array elements or object member values
+        std::vector<std::string> Keys;              // Object member names, parallel to Elements
+
+        const FJsonValue* Find(const char* Key) const
+        {
+            for (size_t i = 0; Type == EType::Object && i < Keys.size(); ++i)
+            {
+                if (Keys[i] == Key)
+                {
+                    return &Elements[i];
+                }
+            }
+            return nullptr;
+        }
+
+        const FJsonValue* At(size_t Index) const
+        {
+            return Type == EType::Array && Index < Elements.size() ? &Elements[Index] : nullptr;
+        }
+
+        size_t GetCount() const { return Type == EType::Array ? Elements.size() : 0; }
+
+        double GetNumber(const char* Key, double Default) const
+        {
+            const FJsonValue* Value = Find(Key);
+            return Value && Value->Type == EType::Number ? Value->Number : Default;
+        }
+
+        int64 GetInteger(const char* Key, int64 Default) const
+        {
+            const FJsonValue* Value = Find(Key);
+            return Value && Value->Type == EType::Number ? static_cast<int64>(Value->Number) : Default;
+        }
+
+        const std::string* GetString(const char* Key) const
+        {
+            const FJsonValue* Value = Find(Key);
+            return Value && Value->Type == EType::String ? &Value->String : nullptr;
+        }
+    };
+
+    class FJsonParser
+    {
+    public:
+        FJsonParser(const char* Begin, const char* InEnd) : Cursor(Begin), End(InEnd) {}
+
+        bool Parse(FJsonValue& OutValue)
+        {
+            if (End - Cursor >= 3 && std::memcmp(Cursor, "\xEF\xBB\xBF", 3) == 0)
+            {
+                Cursor += 3;
+            }
+            if (!ParseValue(OutValue, 0))
+            {
+                return false;
+            }
+            SkipWhitespace();
+            return Cursor == End;
+        }
+
+    private:
+        static constexpr uint32 MaxDepth = 64;
+
+        void SkipWhitespace()
+        {
+            while (Cursor < End && (*Cursor == ' ' || *Cursor == '\t' || *Cursor == '\n' || *Cursor == '\r'))
+            {
+                ++Cursor;
+            }
+        }
+
+        bool Match(const char* Literal)
+        {
+            const size_t Length = std::strlen(Literal);
+            if (size_t(End - Cursor) < Length || std::memcmp(Cursor, Literal, Length) != 0)
+            {
+                return false;
+            }
+            Cursor += Length;
+            return true;
+        }
+
+        bool ParseHex4(uint32& OutCode)
+        {
+            if (End - Cursor < 4)
+            {
+                return false;
+            }
+            const std::from_chars_result Result = std::from_chars(Cursor, Cursor + 4, OutCode, 16);
+            if (Result.ec != std::errc() || Result.ptr != Cursor + 4)
+            {
+                return false;
+            }
+            Cursor += 4;
+            return true;
+        }
+
+        static void AppendUtf8(std::string& Out, uint32 Code)
+        {
+            if (Code < 0x80)
+            {
+                Out.push_back(static_cast<char>(Code));
+            }
+            else if (Code < 0x800)
+            {
+                Out.push_back(static_cast<char>(0xC0 | (Code >> 6)));
+                Out.push_back(static_cast<char>(0x80 | (Code & 0x3F)));
+            }
+            else if (Code < 0x10000)
+            {
+                Out.push_back(static_cast<char>(0xE0 | (Code >> 12)));
+                Out.push_back(static_cast<char>(0x80 | ((Code >> 6) & 0x3F)));
+                Out.push_back(static_cast<char>(0x80 | (Code & 0x3F)));
+            }
+            else
+            {
+                Out.push_back(static_cast<char>(0xF0 | (Code >> 18)));
+                Out.push_back(static_cast<char>(0x80 | ((Code >> 12) & 0x3F)));
+                Out.push_back(static_cast<char>(0x80 | ((Code >> 6) & 0x3F)));
+                Out.push_back(static_cast<char>(0x80 | (Code & 0x3F)));
+            }
+        }
+
+        bool ParseString(std::string& OutString)
+        {
+            if (Cursor >= End || *Cursor != '"')
+            {
+                return false;
+            }
+            ++Cursor;
+            OutString.clear();
+            while (Cursor < End)
+            {
+                char C = *Cursor++;
+                if (C == '"')
+                {
+                    return true;
+                }
+                if (C != '\\')
+                {
+                    OutString.push_back(C);
+                    continue;
+                }
+                if (Cursor >= End)
+                {
+                    return false;
+                }
+                switch (C = *Cursor++)
+                {
+                case '"': case '\\': case '/': OutString.push_back(C); break;
+                case 'b': OutString.push_back('\b'); break;
+                case 'f': OutString.push_back('\f'); break;
+                case 'n': OutString.push_back('\n'); break;
+                case 'r': OutString.push_back('\r'); break;
+                case 't': OutString.push_back('\t'); break;
+                case 'u':
+                {
+                    uint32 Code = 0;
+                    if (!ParseHex4(Code))
+                    {
+                        return false;
+                    }
+                    uint32 Low = 0;
+                    if (Code >= 0xD800 && Code < 0xDC00 && Match("\\u") && ParseHex4(Low) && Low >= 0xDC00 && Low < 0xE000)
+                    {
+                        Code = 0x10000 + ((Code - 0xD800) << 10) + (Low - 0xDC00);
+                    }
+                    AppendUtf8(OutString, Code);
+                    break;
+                }
+                default:
+                    return false;
+                }
+            }
+            return false;
+        }
+
+        bool ParseValue(FJsonValue& OutValue, uint32 Depth)
+        {
+            SkipWhitespace();
+            if (Cursor >= End || Depth > MaxDepth)
+            {
+                return false;
+            }
+
+            const char Lead = *Cursor;
+            if (Lead == '{' || Lead == '[')
+            {
+                const bool bObject = Lead == '{';
+                const char Close = bObject ? '}' : ']';
+                OutValue.Type = bObject ? FJsonValue::EType::Object : FJsonValue::EType::Array;
+                ++Cursor;
+                SkipWhitespace();
+                if (Cursor < End && *Cursor == Close)
+                {
+                    ++Cursor;
+                    return true;
+                }
+                while (true)
+                {
+                    if (bObject)
+                    {
+                        SkipWhitespace();
+                        OutValue.Keys.emplace_back();
+                        if (!ParseString(OutValue.Keys.back()))
+                        {
+                            return false;
+                        }
+                        SkipWhitespace();
+                        if (!Match(":"))
+                        {
+                            return false;
+                        }
+                    }
+                    OutValue.Elements.emplace_back();
+                    if (!ParseValue(OutValue.Elements.back(), Depth + 1))
+                    {
+                        return false;
+                    }
+                    SkipWhitespace();
+                    if (Match(","))
+                    {
+                        continue;
+                    }
+                    if (Cursor < End && *Cursor == Close)
+                    {
+                        ++Cursor;
+                        return true;
+                    }
+                    return false;
+                }
+            }
+            if (Lead == '"')
+            {
+                OutValue.Type = FJsonValue::EType::String;
+                return ParseString(OutValue.String);
+            }
+            if (Match("true") || Match("false"))
+            {
+                OutValue.Type = FJsonValue::EType::Bool;
+                OutValue.bBool = Lead == 't';
+                return true;
+            }
+            if (Match("null"))
+            {
+                return true;
+            }
+
+            OutValue.Type = FJsonValue::EType::Number;
+            const std::from_chars_result Result = std::from_chars(Cursor, End, OutValue.Number);
+            if (Result.ec == std::errc::invalid_argument)
+            {
+                return false;
+            }
+            Cursor = Result.ptr;
+            return true;
+        }
+
+    private:
+        const char* Cursor;
+        const char* End;
+    };
+
+    //
+    // glTF 2.0
+    //
+
+    constexpr uint32 GlbMagic = 0x46546C67;        // "glTF"
+    constexpr uint32 GlbJsonChunk = 0x4E4F534A;    // "JSON"
+    constexpr uint32 GlbBinaryChunk = 0x004E4942;  // "BIN\0"
+    constexpr int64 GltfTriangles = 4;
+
+    // Column-major 4x4 matrix, as glTF stores it
+    struct FGltfMatrix
+    {
+        float M[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+
+        FGltfMatrix operator*(const FGltfMatrix& Other) const
+        {
+            FGltfMatrix Result;
+            for (uint32 Column = 0; Column < 4; ++Column)
+            {
+                for (uint32 Row = 0; Row < 4; ++Row)
+                {
+                    float Sum = 0.0f;
+                    for (uint32 k = 0; k < 4; ++k)
+                    {
+                        Sum += M[k * 4 + Row] * Other.M[Column * 4 + k];
+                    }
+                    Result.M[Column * 4 + Row] = Sum;
+                }
+            }
+            return Result;
+        }
+    };
+
+    inline void Cross(const float* A, const float* B, float* Out)
+    {
+        Out[0] = A[1] * B[2] - A[2] * B[1];
+        Out[1] = A[2] * B[0] - A[0] * B[2];
+        Out[2] = A[0] * B[1] - A[1] * B[0];
+    }
+
+    struct FGltfAccessor
+    {
+        const uint8* Data = nullptr;    // nullptr when the accessor has no buffer view (all zeros)
+        uint32 Count = 0;
+        uint32 Stride = 0;
+        uint32 ComponentType = 0;
+        uint32 Components = 0;
+        bool bNormalized = false;
+
+        float ReadComponent(uint32 Element, uint32 Component) const
+        {
+            if (!Data)
+            {
+                return 0.0f;
+            }
+            const uint8* Source = Data + size_t(Element) * Stride;
+            switch (ComponentType)
+            {
+            case 5126: { float Value; std::memcpy(&Value, Source + Component * 4, 4); return Value; }
+            case 5121: { const float Value = Source[Component]; return bNormalized ? Value / 255.0f : Value; }
+            case 5123: { uint16 Value; std::memcpy(&Value, Source + Component * 2, 2); return bNormalized ? Value / 65535.0f : float(Value); }
+            case 5120:
+            {
+                const float Value = static_cast<int8>(Source[Component]);
+                return !bNormalized ? Value : Value < -127.0f ? -1.0f : Value / 127.0f;
+            }
+            case 5122:
+            {
+                int16 Raw;
+                std::memcpy(&Raw, Source + Component * 2, 2);
+                const float Value = Raw;
+                return !bNormalized ? Value : Value < -32767.0f ? -1.0f : Value / 32767.0f;
+            }
+            case 5125: { uint32 Value; std::memcpy(&Value, Source + Component * 4, 4); return float(Value); }
+            default: return 0.0f;
+            }
+        }
+
+        uint32 ReadIndex(uint32 Element) const
+        {
+            if (!Data)
+            {
+                return 0;
+            }
+            const uint8* Source = Data + size_t(Element) * Stride;
+            switch (ComponentType)
+            {
+            case 5121: return Source[0];
+            case 5123: { uint16 Value; std::memcpy(&Value, Source, 2); return Value; }
+            default: { uint32 Value; std::memcpy(&Value, Source, 4); return Value; }
+            }
+        }
+    };
+
+    // One primitive instance of the flattened scene
+    struct FGltfDraw
+    {
+        const FJsonValue* Primitive = nullptr;
+        FGltfMatrix World;
+        uint32 Material = 0;            // FImportedMesh::Materials index
+        FGltfAccessor Attributes[4];    // POSITION, NORMAL, TEXCOORD_0, COLOR_0
+        FGltfAccessor Indices;
+        bool bIndexed = false;
+        uint32 VertexOffset = 0;        // Decoded range of the shared vertex array
+        uint32 VertexCount = 0;
+        uint32 UniqueCount = 0;         // Vertices left after deduplication
+        uint32 IndexOffset = 0;
+        uint32 IndexCount = 0;
+        const char* Error = nullptr;
+    };
+
+    const char* const GltfAttributeNames[4] = { "POSITION", "NORMAL", "TEXCOORD_0", "COLOR_0" };
+
+    bool DecodeBase64(const char* Begin, const char* End, std::vector<uint8>& Out)
+    {
+        auto DecodeChar = [](char C) -> int32
+        {
+            if (C >= 'A' && C <= 'Z') return C - 'A';
+            if (C >= 'a' && C <= 'z') return C - 'a' + 26;
+            if (C >= '0' && C <= '9') return C - '0' + 52;
+            if (C == '+') return 62;
+            if (C == '/') return 63;
+            return -1;
+        };
+
+        Out.clear();
+        Out.reserve(size_t(End - Begin) / 4 * 3);
+        uint32 Bits = 0;
+        uint32 BitCount = 0;
+        for (const char* Cursor = Begin; Cursor < End && *Cursor != '='; ++Cursor)
+        {
+            const int32 Value = DecodeChar(*Cursor);
+            if (Value < 0)
+            {
+                return false;
+            }
+            Bits = (Bits << 6) | uint32(Value);
+            BitCount += 6;
+            if (BitCount >= 8)
+            {
+                BitCount -= 8;
+                Out.push_back(static_cast<uint8>(Bits >> BitCount));
+            }
+        }
+        return true;
+    }
+
+    std::string DecodeUri(const std::string& Uri)
+    {
+        std::string Result;
+        for (size_t i = 0; i < Uri.size(); ++i)
+        {
+            uint32 Code = 0;
+            if (Uri[i] == '%' && i + 2 < Uri.size() &&
+                std::from_chars(Uri.data() + i + 1, Uri.data() + i + 3, Code, 16).ptr == Uri.data() + i + 3)
+            {
+                Result.push_back(static_cast<char>(Code));
+                i += 2;
+            }
+            else
+            {
+                Result.push_back(Uri[i]);
+            }
+        }
+        return Result;
+    }
+
+    /**
+     * @brief Flattens the default scene of a glTF document and decodes its primitives in parallel
+     */
+    class FGltfImporter
+    {
+    public:
+        FGltfImporter(FImportedMesh& InMesh, const FMeshImportSettings& InSettings, KJobSystem* InJobSystem, FMeshImportStats& InStats)
+            : Mesh(InMesh), Settings(InSettings), JobSystem(InJobSystem), Stats(InStats)
+        {
+        }
+
+        bool Import(const std::string& Path)
+        {
+            if (!Document.Open(Path))
+            {
+                return Fail("Cannot open " + Path);
+            }
+            Stats.BytesRead += Document.GetSize();
+
+            const size_t Slash = Path.find_last_of("/\\");
+            Directory = Slash == std::string::npos ? std::string() : Path.substr(0, Slash + 1);
+
+            if (!ParseDocument() || !LoadBuffers() || !CollectDraws() || !PrepareDraws())
+            {
+                return false;
+            }
+            DecodeDraws();
+            for (const FGltfDraw& Draw : Draws)
+            {
+                if (Draw.Error)
+                {
+                    return Fail(Draw.Error);
+                }
+            }
+            Compact();
+            return Mesh.Indices.empty() ? Fail("No triangles in " + Path) : true;
+        }
+
+    private:
+        struct FBuffer
+        {
+            KMappedFile File;
+            std::vector<uint8> Decoded;
+            const uint8* Data = nullptr;
+            size_t Size = 0;
+        };
+
+        bool Fail(const std::string& Error)
+        {
+            Stats.Error = Error;
+            return false;
+        }
+
+        bool ParseDocument()
+        {
+            const uint8* Data = Document.GetData();
+            const size_t Size = Document.GetSize();
+            const char* JsonBegin = reinterpret_cast<const char*>(Data);
+            const char* JsonEnd = JsonBegin + Size;
+
+            uint32 Magic = 0;
+            if (Size >= 4)
+            {
+                std::memcpy(&Magic, Data, 4);
+            }
+            if (Magic == GlbMagic)
+            {
+                // Header (magic, version, length), JSON chunk, optional BIN chunk
+                uint32 Header[3];
+                if (Size < 20)
+                {
+                    return Fail("Truncated GLB file");
+                }
+                std::memcpy(Header, Data, sizeof(Header));
+                if (Header[1] != 2 || Header[2] > Size)
+                {
+                    return Fail("Unsupported GLB file");
+                }
+                size_t Offset = 12;
+                while (Offset + 8 <= Header[2])
+                {
+                    uint32 Chunk[2];
+                    std::memcpy(Chunk, Data + Offset, sizeof(Chunk));
+                    Offset += 8;
+                    if (Chunk[0] > Header[2] - Offset)
+                    {
+                        return Fail("Truncated GLB chunk");
+                    }
+                    if (Chunk[1] == GlbJsonChunk && Offset == 20)
+                    {
+                        JsonBegin = reinterpret_cast<const char*>(Data + Offset);
+                        JsonEnd = JsonBegin + Chunk[0];
+                    }
+                    else if (Chunk[1] == GlbBinaryChunk && !BinaryChunk)
+                    {
+                        BinaryChunk = Data + Offset;
+                        BinaryChunkSize = Chunk[0];
+                    }
+                    Offset += (size_t(Chunk[0]) + 3) & ~size_t(3);
+                }
+                if (JsonBegin == reinterpret_cast<const char*>(Data))
+                {
+                    return Fail("GLB file without a JSON chunk");
+                }
+            }
+
+            if (!FJsonParser(JsonBegin, JsonEnd).Parse(Root) || Root.Type != FJsonValue::EType::Object)
+            {
+                return Fail("Malformed glTF JSON");
+            }
+            const FJsonValue* Asset = Root.Find("asset");
+            const std::string* Version = Asset ? Asset->GetString("version") : nullptr;
+            if (!Version || Version->empty() || (*Version)[0] != '2')
+            {
+                return Fail("Only glTF 2.0 is supported");
+            }
+            return true;
+        }
+
+        bool LoadBuffers()
+        {
+            const FJsonValue* BufferList = Root.Find("buffers");
+            const size_t Count = BufferList ? BufferList->GetCount() : 0;
+            Buffers.resize(Count);
+            for (size_t i = 0; i < Count; ++i)
+            {
+                const FJsonValue& Desc = *BufferList->At(i);
+                FBuffer& Buffer = Buffers[i];
+                const int64 Length = Desc.GetInteger("byteLength", -1);
+                const std::string* Uri = Desc.GetString("uri");
+                if (!Uri)
+                {
+                    if (i != 0 || !BinaryChunk)
+                    {
+                        return Fail("Buffer without data");
+                    }
+                    Buffer.Data = BinaryChunk;
+                    Buffer.Size = BinaryChunkSize;
+                }
+                else if (Uri->compare(0, 5, "data:") == 0)
+                {
+                    const size_t Comma = Uri->find(',');
+                    if (Comma == std::string::npos || Uri->rfind(";base64", Comma) == std::string::npos ||
+                        !DecodeBase64(Uri->data() + Comma + 1, Uri->data() + Uri->size(), Buffer.Decoded))
+                    {
+                        return Fail("Unsupported buffer data URI");
+                    }
+                    Buffer.Data = Buffer.Decoded.data();
+                    Buffer.Size = Buffer.Decoded.size();
+                }
+                else
+                {
+                    const std::string BufferPath = Directory + DecodeUri(*Uri);
+                    if (!Buffer.File.Open(BufferPath))
+                    {
+                        return Fail("Cannot open buffer " + BufferPath);
+                    }
+                    Buffer.Data = Buffer.File.GetData();
+                    Buffer.Size = Buffer.File.GetSize();
+                }
+                if (Length < 0 || size_t(Length) > Buffer.Size)
+                {
+                    return Fail("Buffer shorter than its byteLength");
+                }
+                Buffer.Size = size_t(Length);
+            }
+            return true;
+        }
+
+        bool GetAccessor(int64 Index, FGltfAccessor& OutAccessor)
+        {
+            const FJsonValue* AccessorList = Root.Find("accessors");
+            const FJsonValue* Desc = AccessorList && Index >= 0 ? AccessorList->At(size_t(Index)) : nullptr;
+            if (!Desc)
+            {
+                return Fail("Invalid accessor index");
+            }
+            if (Desc->Find("sparse"))
+            {
+                return Fail("Sparse accessors are not supported");
+            }
+
+            static const struct { const char* Name; uint32 Components; } Types[] = {
+                { "SCALAR", 1 }, { "VEC2", 2 }, { "VEC3", 3 }, { "VEC4", 4 },
+            };
+            const std::string* Type = Desc->GetString("type");
+            OutAccessor.Components = 0;
+            for (const auto& Entry : Types)
+            {
+                if (Type && *Type == Entry.Name)
+                {
+                    OutAccessor.Components = Entry.Components;
+                }
+            }
+            OutAccessor.ComponentType = static_cast<uint32>(Desc->GetInteger("componentType", 0));
+            const uint32 ComponentSize = OutAccessor.ComponentType == 5120 || OutAccessor.ComponentType == 5121 ? 1 :
+                                         OutAccessor.ComponentType == 5122 || OutAccessor.ComponentType == 5123 ? 2 :
+                                         OutAccessor.ComponentType == 5125 || OutAccessor.ComponentType == 5126 ? 4 : 0;
+            const int64 Count = Desc->GetInteger("count", -1);
+            if (OutAccessor.Components == 0 || ComponentSize == 0 || Count < 0 || Count > INT32_MAX)
+            {
+                return Fail("Unsupported accessor");
+            }
+            OutAccessor.Count = static_cast<uint32>(Count);
+            OutAccessor.bNormalized = Desc->Find("normalized") && Desc->Find("normalized")->bBool;
+            OutAccessor.Data = nullptr;
+
+            const uint32 ElementSize = ComponentSize * OutAccessor.Components;
+            OutAccessor.Stride = ElementSize;
+            const FJsonValue* ViewList = Root.Find("bufferViews");
+            const int64 ViewIndex = Desc->GetInteger("bufferView", -1);
+            if (ViewIndex < 0)
+            {
+                return true;
+            }
+
+            const FJsonValue* View = ViewList ? ViewList->At(size_t(ViewIndex)) : nullptr;
+            const int64 BufferIndex = View ? View->GetInteger("buffer", -1) : -1;
+            if (BufferIndex < 0 || size_t(BufferIndex) >= Buffers.size())
+            {
+                return Fail("Invalid buffer view");
+            }
+            const FBuffer& Buffer = Buffers[size_t(BufferIndex)];
+            const int64 ViewOffset = View->GetInteger("byteOffset", 0);
+            const int64 ViewLength = View->GetInteger("byteLength", -1);
+            const int64 ViewStride = View->GetInteger("byteStride", 0);
+            const int64 Offset = Desc->GetInteger("byteOffset", 0);
+            if (ViewStride > 0)
+            {
+                OutAccessor.Stride = static_cast<uint32>(ViewStride);
+            }
+
+            const uint64 Needed = Count == 0 ? 0 : uint64(Offset) + uint64(Count - 1) * OutAccessor.Stride + ElementSize;
+            if (ViewOffset < 0 || ViewLength < 0 || Offset < 0 || ViewStride < 0 || ViewStride > 255 ||
+                uint64(ViewOffset) + uint64(ViewLength) > Buffer.Size || Needed > uint64(ViewLength))
+            {
+                return Fail("Accessor outside its buffer");
+            }
+            OutAccessor.Data = Buffer.Data + ViewOffset + Offset;
+            return true;
+        }
+
+        // Walks the default scene (or every root node without scenes) and records each mesh primitive instance
+        bool CollectDraws()
+        {
+            const FJsonValue* NodeList = Root.Find("nodes");
+            const FJsonValue* MeshList = Root.Find("meshes");
+            const size_t NodeCount = NodeList ? NodeList->GetCount() : 0;
+
+            std::vector<int64> Roots;
+            const FJsonValue* SceneList = Root.Find("scenes");
+            const FJsonValue* Scene = SceneList ? SceneList->At(size_t(Root.GetInteger("scene", 0))) : nullptr;
+            if (const FJsonValue* SceneNodes = Scene ? Scene->Find("nodes") : nullptr)
+            {
+                for (size_t i = 0; i < SceneNodes->GetCount(); ++i)
+                {
+                    Roots.push_back(static_cast<int64>(SceneNodes->At(i)->Number));
+                }
+            }
+            else
+            {
+                std::vector<uint8> IsChild(NodeCount);
+                for (size_t i = 0; i < NodeCount; ++i)
+                {
+                    const FJsonValue* Children = NodeList->At(i)->Find("children");
+                    for (size_t c = 0; Children && c < Children->GetCount(); ++c)
+                    {
+                        const int64 Child = static_cast<int64>(Children->At(c)->Number);
+                        if (Child >= 0 && size_t(Child) < NodeCount)
+                        {
+                            IsChild[size_t(Child)] = 1;
+                        }
+                    }
+                }
+                for (size_t i = 0; i < NodeCount; ++i)
+                {
+                    if (!IsChild[i])
+                    {
+                        Roots.push_back(static_cast<int64>(i));
+                    }
+                }
+            }
+
+            std::vector<uint8> Visited(NodeCount);
+            std::vector<std::pair<int64, FGltfMatrix>> Stack;
+            for (auto It = Roots.rbegin(); It != Roots.rend(); ++It)
+            {
+                Stack.emplace_back(*It, FGltfMatrix());
+            }
+            while (!Stack.empty())
+            {
+                const int64 NodeIndex = Stack.back().first;
+                const FGltfMatrix Parent = Stack.back().second;
+                Stack.pop_back();
+                if (NodeIndex < 0 || size_t(NodeIndex) >= NodeCount || Visited[size_t(NodeIndex)])
+                {
+                    return Fail("Invalid node hierarchy");
+                }
+                Visited[size_t(NodeIndex)] = 1;
+
+                const FJsonValue& Node = *NodeList->At(size_t(NodeIndex));
+                const FGltfMatrix World = Parent * GetLocalMatrix(Node);
+
+                const int64 MeshIndex = Node.GetInteger("mesh", -1);
+                if (MeshIndex >= 0)
+                {
+                    const FJsonValue* MeshDesc = MeshList ? MeshList->At(size_t(MeshIndex)) : nullptr;
+                    const FJsonValue* Primitives = MeshDesc ? MeshDesc->Find("primitives") : nullptr;
+                    if (!Primitives)
+                    {
+                        return Fail("Invalid mesh index");
+                    }
+                    for (size_t p = 0; p < Primitives->GetCount(); ++p)
+                    {
+                        const FJsonValue* Primitive = Primitives->At(p);
+                        if (Primitive->GetInteger("mode", GltfTriangles) != GltfTriangles)
+                        {
+                            continue;
+                        }
+                        FGltfDraw Draw;
+                        Draw.Primitive = Primitive;
+                        Draw.World = World;
+                        Draw.Material = GetMaterial(Primitive->GetInteger("material", -1));
+                        Draws.push_back(Draw);
+                    }
+                }
+
+                const FJsonValue* Children = Node.Find("children");
+                for (size_t c = Children ? Children->GetCount() : 0; c > 0; --c)
+                {
+                    Stack.emplace_back(static_cast<int64>(Children->At(c - 1)->Number), World);
+                }
+            }
+
+            // Meshes without nodes (no scene graph at all)
+            if (NodeCount == 0 && MeshList)
+            {
+                for (size_t m = 0; m < MeshList->GetCount(); ++m)
+                {
+                    const FJsonValue* Primitives = MeshList->At(m)->Find("primitives");
+                    for (size_t p = 0; Primitives && p < Primitives->GetCount(); ++p)
+                    {
+                        const FJsonValue* Primitive = Primitives->At(p);
+                        if (Primitive->GetInteger("mode", GltfTriangles) == GltfTriangles)
+                        {
+                            FGltfDraw Draw;
+                            Draw.Primitive = Primitive;
+                            Draw.Material = GetMaterial(Primitive->GetInteger("material", -1));
+                            Draws.push_back(Draw);
+                        }
+                    }
+                }
+            }
+            return true;
+        }
+
+        static FGltfMatrix GetLocalMatrix(const FJsonValue& Node)
+        {
+            FGltfMatrix Local;
+            if (const FJsonValue* Matrix = Node.Find("matrix"))
+            {
+                for (size_t i = 0; i < 16 && i < Matrix->GetCount(); ++i)
+                {
+                    Local.M[i] = static_cast<float>(Matrix->At(i)->Number);
+                }
+                return Local;
+            }
+
+            float T[3] = { 0, 0, 0 };
+            float R[4] = { 0, 0, 0, 1 };
+            float S[3] = { 1, 1, 1 };
+            auto ReadVector = [&Node](const char* Key, float* Out, size_t Count)
+            {
+                const FJsonValue* Value = Node.Find(Key);
+                for (size_t i = 0; Value && i < Count && i < Value->GetCount(); ++i)
+                {
+                    Out[i] = static_cast<float>(Value->At(i)->Number);
+                }
+            };
+            ReadVector("translation", T, 3);
+            ReadVector("rotation", R, 4);
+            ReadVector("scale", S, 3);
+
+            // T * R * S
+            const float X = R[0], Y = R[1], Z = R[2], W = R[3];
+            const float Rotation[9] = {
+                1 - 2 * (Y * Y + Z * Z), 2 * (X * Y + W * Z), 2 * (X * Z - W * Y),
+                2 * (X * Y - W * Z), 1 - 2 * (X * X + Z * Z), 2 * (Y * Z + W * X),
+                2 * (X * Z + W * Y), 2 * (Y * Z - W * X), 1 - 2 * (X * X + Y * Y),
+            };
+            for (uint32 Column = 0; Column < 3; ++Column)
+            {
+                for (uint32 Row = 0; Row < 3; ++Row)
+                {
+                    Local.M[Column * 4 + Row] = Rotation[Column * 3 + Row] * S[Column];
+                }
+                Local.M[12 + Column] = T[Column];
+            }
+            return Local;
+        }
+
+        uint32 GetMaterial(int64 MaterialIndex)
+        {
+            auto Inserted = MaterialSlots.emplace(MaterialIndex, static_cast<uint32>(Mesh.Materials.size()));
+            if (Inserted.second)
+            {
+                const FJsonValue* MaterialList = Root.Find("materials");
+                const FJsonValue* Material = MaterialList && MaterialIndex >= 0 ? MaterialList->At(size_t(MaterialIndex)) : nullptr;
+                const std::string* Name = Material ? Material->GetString("name") : nullptr;
+                Mesh.Materials.push_back(Name ? *Name : std::string());
+            }
+            return Inserted.first->second;
+        }
+
+        // Resolves accessors and lays the draws out grouped by material
+        bool PrepareDraws()
+        {
+            for (FGltfDraw& Draw : Draws)
+            {
+                const FJsonValue* AttributeMap = Draw.Primitive->Find("attributes");
+                for (uint32 a = 0; a < 4; ++a)
+                {
+                    const int64 Index = AttributeMap ? AttributeMap->GetInteger(GltfAttributeNames[a], -1) : -1;
+                    if (Index < 0)
+                    {
+                        if (a == 0)
+                        {
+                            return Fail("Primitive without positions");
+                        }
+                        continue;
+                    }
+                    if (!GetAccessor(Index, Draw.Attributes[a]))
+                    {
+                        return false;
+                    }
+                    if (Draw.Attributes[a].Count != Draw.Attributes[0].Count)
+                    {
+                        return Fail("Vertex attributes of different lengths");
+                    }
+                }
+                if (Draw.Attributes[0].Components != 3 || Draw.Attributes[0].ComponentType != 5126)
+                {
+                    return Fail("Positions must be float3");
+                }
+                // DecodeDraw reads a fixed number of components per attribute
+                if (Draw.Attributes[1].Count && (Draw.Attributes[1].Components != 3 || Draw.Attributes[1].ComponentType != 5126))
+                {
+                    return Fail("Normals must be float3");
+                }
+                if (Draw.Attributes[2].Count && Draw.Attributes[2].Components != 2)
+                {
+                    return Fail("Texture coordinates must be VEC2");
+                }
+                if (Draw.Attributes[3].Count && Draw.Attributes[3].Components != 3 && Draw.Attributes[3].Components != 4)
+                {
+                    return Fail("Colors must be VEC3 or VEC4");
+                }
+
+                const int64 IndicesIndex = Draw.Primitive->GetInteger("indices", -1);
+                Draw.bIndexed = IndicesIndex >= 0;
+                if (Draw.bIndexed)
+                {
+                    if (!GetAccessor(IndicesIndex, Draw.Indices))
+                    {
+                        return false;
+                    }
+                    if (Draw.Indices.Components != 1 || Draw.Indices.ComponentType == 5126 || Draw.Indices.ComponentType == 5120 ||
+                        Draw.Indices.ComponentType == 5122)
+                    {
+                        return Fail("Invalid index accessor");
+                    }
+                }
+                Draw.VertexCount = Draw.Attributes[0].Count;
+                Draw.IndexCount = Draw.bIndexed ? Draw.Indices.Count : Draw.VertexCount;
+                if (Draw.IndexCount % 3 != 0)
+                {
+                    return Fail("Triangle list with a partial triangle");
+                }
+            }
+
+            std::stable_sort(Draws.begin(), Draws.end(),
+                             [](const FGltfDraw& A, const FGltfDraw& B) { return A.Material < B.Material; });
+
+            uint64 VertexCount = 0;
+            uint64 IndexCount = 0;
+            for (FGltfDraw& Draw : Draws)
+            {
+                Draw.VertexOffset = static_cast<uint32>(VertexCount);
+                Draw.IndexOffset = static_cast<uint32>(IndexCount);
+                VertexCount += Draw.VertexCount;
+                IndexCount += Draw.IndexCount;
+                if (VertexCount > UINT32_MAX || IndexCount > UINT32_MAX)
+                {
+                    return Fail("Mesh too large");
+                }
+            }
+            Stats.SourceVertexCount = static_cast<uint32>(VertexCount);
+            Stats.ChunkCount = static_cast<uint32>(Draws.size());
+            for (const FBuffer& Buffer : Buffers)
+            {
+                Stats.BytesRead += Buffer.Size;
+            }
+
+            Mesh.Vertices.resize(size_t(VertexCount));
+            Mesh.Indices.resize(size_t(IndexCount));
+            return true;
+        }
+
+        void DecodeDraws()
+        {
+            KE_PROFILE_SCOPE("DecodeGltfPrimitives");
+            RunParallel(JobSystem, static_cast<uint32>(Draws.size()), [this](uint32 Index, uint32)
+            {
+                DecodeDraw(Draws[Index]);
+            });
+        }
+
+        void DecodeDraw(FGltfDraw& Draw)
+        {
+            const float* M = Draw.World.M;
+            float NormalMatrix[9];          // Columns of the cofactor matrix (inverse transpose up to scale)
+            Cross(M + 4, M + 8, NormalMatrix);
+            Cross(M + 8, M + 0, NormalMatrix + 3);
+            Cross(M + 0, M + 4, NormalMatrix + 6);
+            const float Determinant = M[0] * NormalMatrix[0] + M[1] * NormalMatrix[1] + M[2] * NormalMatrix[2];
+            const float NormalSign = Determinant < 0.0f ? -1.0f : 1.0f;
+
+            FStandardVertex* Vertices = Mesh.Vertices.data() + Draw.VertexOffset;
+            for (uint32 v = 0; v < Draw.VertexCount; ++v)
+            {
+                FStandardVertex& Vertex = Vertices[v];
+                SetDefaultVertex(Vertex);
+
+                float Local[3];
+                for (uint32 c = 0; c < 3; ++c)
+                {
+                    Local[c] = Draw.Attributes[0].ReadComponent(v, c);
+                }
+                for (uint32 Row = 0; Row < 3; ++Row)
+                {
+                    Vertex.Position[Row] = M[Row] * Local[0] + M[4 + Row] * Local[1] + M[8 + Row] * Local[2] + M[12 + Row];
+                }
+
+                if (Draw.Attributes[1].Count)
+                {
+                    for (uint32 c = 0; c < 3; ++c)
+                    {
+                        Local[c] = Draw.Attributes[1].ReadComponent(v, c);
+                    }
+                    float Length = 0.0f;
+                    for (uint32 Row = 0; Row < 3; ++Row)
+                    {
+                        Vertex.Normal[Row] = NormalSign * (NormalMatrix[Row] * Local[0] + NormalMatrix[3 + Row] * Local[1] +
+                                                           NormalMatrix[6 + Row] * Local[2]);
+                        Length += Vertex.Normal[Row] * Vertex.Normal[Row];
+                    }
+                    if (Length > 0.0f)
+                    {
+                        const float Scale = 1.0f / std::sqrt(Length);
+                        Vertex.Normal[0] *= Scale;
+                        Vertex.Normal[1] *= Scale;
+                        Vertex.Normal[2] *= Scale;
+                    }
+                }
+                if (Draw.Attributes[2].Count)
+                {
+                    Vertex.TexCoord[0] = Draw.Attributes[2].ReadComponent(v, 0);
+                    Vertex.TexCoord[1] = Draw.Attributes[2].ReadComponent(v, 1);
+                }
+                if (Draw.Attributes[3].Count)
+                {
+                    for (uint32 c = 0; c < Draw.Attributes[3].Components && c < 4; ++c)
+                    {
+                        Vertex.Color[c] = Draw.Attributes[3].ReadComponent(v, c);
+                    }
+                }
+            }
+
+            // Local indices for now; the draw's final vertex offset is added after compaction
+            uint32* Indices = Mesh.Indices.data() + Draw.IndexOffset;
+            for (uint32 i = 0; i < Draw.IndexCount; ++i)
+            {
+                Indices[i] = Draw.bIndexed ? Draw.Indices.ReadIndex(i) : i;
+                if (Indices[i] >= Draw.VertexCount)
+                {
+                    Draw.Error = "Index out of range";
+                    return;
+                }
+            }
+
+            // A mirroring transform turns the winding around
+            if (Determinant < 0.0f)
+            {
+                for (uint32 i = 0; i + 2 < Draw.IndexCount; i += 3)
+                {
+                    std::swap(Indices[i + 1], Indices[i + 2]);
+                }
+            }
+
+            Draw.UniqueCount = Draw.VertexCount;
+            if (!Settings.bDeduplicate)
+            {
+                return;
+            }
+
+            // Unique vertices move to the front of the draw's range, first occurrence first
+            std::vector<uint32> Remap(Draw.VertexCount);
+            FIndexHashTable Table;
+            Table.Reset(Draw.VertexCount);
+            uint32 UniqueCount = 0;
+            for (uint32 v = 0; v < Draw.VertexCount; ++v)
+            {
+                const FStandardVertex Vertex = Vertices[v];
+                uint32& Slot = Table.Find(HashVertex(Vertex), [&](uint32 Item)
+                {
+                    return std::memcmp(&Vertices[Item], &Vertex, sizeof(FStandardVertex)) == 0;
+                });
+                if (Slot == FIndexHashTable::Empty)
+                {
+                    Slot = UniqueCount;
+                    Vertices[UniqueCount++] = Vertex;
+                    Table.OnInsert();
+                }
+                Remap[v] = Slot;
+            }
+            for (uint32 i = 0; i < Draw.IndexCount; ++i)
+            {
+                Indices[i] = Remap[Indices[i]];
+            }
+            Draw.UniqueCount = UniqueCount;
+        }
+
+        // Closes the gaps deduplication left and makes the indices absolute
+        void Compact()
+        {
+            uint32 VertexOffset = 0;
+            for (FGltfDraw& Draw : Draws)
+            {
+                if (VertexOffset != Draw.VertexOffset)
+                {
+                    std::memmove(Mesh.Vertices.data() + VertexOffset, Mesh.Vertices.data() + Draw.VertexOffset,
+                                 size_t(Draw.UniqueCount) * sizeof(FStandardVertex));
+                    Draw.VertexOffset = VertexOffset;
+                }
+                VertexOffset += Draw.UniqueCount;
+            }
+            Mesh.Vertices.resize(VertexOffset);
+
+            RunParallel(JobSystem, static_cast<uint32>(Draws.size()), [this](uint32 Index, uint32)
+            {
+                const FGltfDraw& Draw = Draws[Index];
+                uint32* Indices = Mesh.Indices.data() + Draw.IndexOffset;
+                for (uint32 i = 0; i < Draw.IndexCount; ++i)
+                {
+                    Indices[i] += Draw.VertexOffset;
+                }
+            });
+
+            // Draws are grouped by material; each group is one submesh
+            for (const FGltfDraw& Draw : Draws)
+            {
+                if (Draw.IndexCount == 0)
+                {
+                    continue;
+                }
+                if (!Mesh.Submeshes.empty() && Mesh.Submeshes.back().MaterialIndex == Draw.Material)
+                {
+                    Mesh.Submeshes.back().IndexCount += Draw.IndexCount;
+                    continue;
+                }
+                FMeshSubmesh Submesh;
+                Submesh.FirstIndex = Draw.IndexOffset;
+                Submesh.IndexCount = Draw.IndexCount;
+                Submesh.MaterialIndex = Draw.Material;
+                Mesh.Submeshes.push_back(Submesh);
+            }
+        }
+
+    private:
+        FImportedMesh& Mesh;
+        const FMeshImportSettings& Settings;
+        KJobSystem* JobSystem;
+        FMeshImportStats& Stats;
+
+        KMappedFile Document;
+        std::string Directory;
+        FJsonValue Root;
+        const uint8* BinaryChunk = nullptr;
+        size_t BinaryChunkSize = 0;
+        std::vector<FBuffer> Buffers;
+        std::vector<FGltfDraw> Draws;
+        std::unordered_map<int64, uint32> MaterialSlots;    // glTF material index (-1 for none) -> mesh material
+    };
+
+    template <typename FImporter>
+    bool RunImport(const std::string& Path, FImportedMesh& OutMesh, const FMeshImportSettings& Settings, KJobSystem* JobSystem,
+                   FMeshImportStats* OutStats)
+    {
+        const FClock::time_point StartTime = FClock::now();
+        FMeshImportStats Stats;
+        OutMesh = FImportedMesh();
+
+        bool bResult = false;
+        {
+            FImporter Importer(OutMesh, Settings, JobSystem, Stats);
+            bResult = Importer.Import(Path);
+        }
+        if (bResult)
+        {
+            FinalizeMesh(OutMesh, Settings);
+        }
+        else
+        {
+            OutMesh = FImportedMesh();
+        }
+
+        Stats.Seconds = std::chrono::duration<double>(FClock::now() - StartTime).count();
+        if (OutStats)
+        {
+            *OutStats = std::move(Stats);
+        }
+        return bResult;
+    }
+}
+
+bool MeshImporter::ImportObj(const std::string& Path, FImportedMesh& OutMesh, const FMeshImportSettings& Settings,
+                             KJobSystem* JobSystem, FMeshImportStats* OutStats)
+{
+    KE_PROFILE_FUNCTION();
+    return RunImport<FObjImporter>(Path, OutMesh, Settings, JobSystem, OutStats);
+}
+
+bool MeshImporter::ImportGltf(const std::string& Path, FImportedMesh& OutMesh, const FMeshImportSettings& Settings,
+                              KJobSystem* JobSystem, FMeshImportStats* OutStats)
+{
+    KE_PROFILE_FUNCTION();
+    return RunImport<FGltfImporter>(Path, OutMesh, Settings, JobSystem, OutStats);
+}
+
+bool MeshImporter::Import(const std::string& Path, FImportedMesh& OutMesh, const FMeshImportSettings& Settings,
+                          KJobSystem* JobSystem, FMeshImportStats* OutStats)
+{
+    if (EndsWith(Path, ".obj"))
+    {
+        return ImportObj(Path, OutMesh, Settings, JobSystem, OutStats);
+    }
+    if (EndsWith(Path, ".gltf") || EndsWith(Path, ".glb"))
+    {
+        return ImportGltf(Path, OutMesh, Settings, JobSystem, OutStats);
+    }
+
+    OutMesh = FImportedMesh();
+    if (OutStats)
+    {
+        *OutStats = FMeshImportStats();
+        OutStats->Error = "Unsupported mesh file type: " + Path;
+    }
+    return false;
+}
+
+bool MeshImporter::IsSupportedFile(const std::string& Path)
+{
+    return EndsWith(Path, ".obj") || EndsWith(Path, ".gltf") || EndsWith(Path, ".glb");
+}
@@ -0,0 +1,86 @@
+﻿#pragma once
+
+#include <string>
+#include <vector>
+
+#include "../Utils/Types.h"
+#include "VertexFormat.h"
+#include "MeshFile.h"
+
+class KJobSystem;
+
+// Authored geometry import (Wavefront OBJ, glTF 2.0). Platform independent.
+
+/**
+ * @brief Import settings
+ */
+struct FMeshImportSettings
+{
+    uint32 ChunkSize = 4u << 20;        // Text bytes parsed per task
+    uint32 ChunksInFlight = 0;          // Chunks read per window, 0 for two per thread; bounds the text held in memory
+    bool bConvertToLeftHanded = true;   // Negate Z and flip the winding (both formats are right handed)
+    bool bDeduplicate = true;           // Merge identical vertices
+    bool bGenerateNormals = true;       // Smooth normals for vertices the file gives none
+};
+
+/**
+ * @brief Imported triangle list, ready for KMesh::Initialize or MeshFile::Build
+ */
+struct FImportedMesh
+{
+    std::vector<FStandardVertex> Vertices;
+    std::vector<uint32> Indices;
+    std::vector<FMeshSubmesh> Submeshes;    // One per material, in order of first use
+    std::vector<std::string> Materials;     // Indexed by FMeshSubmesh::MaterialIndex ("" when unnamed)
+};
+
+/**
+ * @brief Import statistics
+ */
+struct FMeshImportStats
+{
+    uint64 BytesRead = 0;               // Text and binary buffer bytes
+    uint32 ChunkCount = 0;              // Parse tasks
+    uint32 SourceVertexCount = 0;       // Face corners (OBJ) or accessor vertices (glTF) before deduplication
+    double Seconds = 0.0;
+    std::string Error;                  // Why the import failed, empty on success
+};
+
+namespace MeshImporter
+{
+    /**
+     * @brief Import a Wavefront OBJ file (v, vt, vn, f, usemtl)
+     *
+     * The file is read in windows of ChunksInFlight * ChunkSize bytes, split
+     * at line ends and the chunks parsed in parallel; corners are deduplicated
+     * per chunk in parallel, then merged in file order, so the result does not
+     * depend on the thread count. Polygons are triangulated as fans.
+     * @param Path UTF-8 file path
+     * @param JobSystem Worker pool, nullptr to parse on the calling thread
+     */
+    bool ImportObj(const std::string& Path, FImportedMesh& OutMesh, const FMeshImportSettings& Settings = FMeshImportSettings(),
+                   KJobSystem* JobSystem = nullptr, FMeshImportStats* OutStats = nullptr);
+
+    /**
+     * @brief Import the default scene of a glTF 2.0 file (.gltf with .bin buffers, or .glb)
+     *
+     * Triangle primitives are flattened with their node transforms; each
+     * primitive is decoded in parallel. Buffers are memory mapped, so only
+     * the pages that accessors reference are read.
+     * @param Path UTF-8 file path
+     * @param JobSystem Worker pool, nullptr to decode on the calling thread
+     */
+    bool ImportGltf(const std::string& Path, FImportedMesh& OutMesh, const FMeshImportSettings& Settings = FMeshImportSettings(),
+                    KJobSystem* JobSystem = nullptr, FMeshImportStats* OutStats = nullptr);
+
+    /**
+     * @brief Import by file extension (.obj, .gltf, .glb)
+     */
+    bool Import(const std::string& Path, FImportedMesh& OutMesh, const FMeshImportSettings& Settings = FMeshImportSettings(),
+                KJobSystem* JobSystem = nullptr, FMeshImportStats* OutStats = nullptr);
+
+    /**
+     * @brief Whether Import understands the file extension
+     */
+    bool IsSupportedFile(const std::string& Path);
+}
@@ -0,0 +1,484 @@
+﻿#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    constexpr uint32 InvalidIndex = ~0u;
+
+    /**
+     * @brief FIFO cache simulation; a vertex is cached while fewer than CacheSize misses followed its own
+     */
+    class FFifoCache
+    {
+    public:
+        FFifoCache(uint32 VertexCount, uint32 InCacheSize)
+            : Timestamps(VertexCount, 0), CacheSize(InCacheSize), Timestamp(InCacheSize + 1)
+        {
+        }
+
+        /**
+         * @brief Touch a vertex, returns true on a miss
+         */
+        bool Access(uint32 Vertex)
+        {
+            if (Timestamp - Timestamps[Vertex] > CacheSize)
+            {
+                Timestamps[Vertex] = Timestamp++;
+                return true;
+            }
+            return false;
+        }
+
+        /**
+         * @brief Evict everything
+         */
+        void Flush()
+        {
+            Timestamp += CacheSize + 1;
+        }
+
+    private:
+        std::vector<uint32> Timestamps;
+        uint32 CacheSize;
+        uint32 Timestamp;
+    };
+
+    // Forsyth's scoring: recently used vertices and vertices with few remaining
+    // triangles are preferred, so fans are finished before moving on
+    constexpr uint32 ForsythCacheSize = 32;
+    constexpr uint32 ForsythMaxValence = 64;
+
+    struct FForsythTables
+    {
+        float CacheScore[ForsythCacheSize];
+        float ValenceScore[ForsythMaxValence];
+
+        FForsythTables()
+        {
+            for (uint32 i = 0; i < ForsythCacheSize; ++i)
+            {
+                // The last triangle's vertices get a fixed score so its own edges are not favored
+                CacheScore[i] = i < 3 ? 0.75f
+                    : std::pow(1.0f - static_cast<float>(i - 3) / static_cast<float>(ForsythCacheSize - 3), 1.5f);
+            }
+            ValenceScore[0] = 0.0f;
+            for (uint32 i = 1; i < ForsythMaxValence; ++i)
+            {
+                ValenceScore[i] = 2.0f / std::sqrt(static_cast<float>(i));
+            }
+        }
+    };
+
+    float GetVertexScore(const FForsythTables& Tables, int32 CachePosition, uint32 Valence)
+    {
+        if (Valence == 0)
+        {
+            return -1.0f;
+        }
+
+        const float CacheScore = CachePosition >= 0 ? Tables.CacheScore[CachePosition] : 0.0f;
+        return CacheScore + Tables.ValenceScore[std::min(Valence, ForsythMaxValence - 1)];
+    }
+
+    const float* GetPosition(const float* Positions, uint32 Stride, uint32 Vertex)
+    {
+        return reinterpret_cast<const float*>(reinterpret_cast<const uint8*>(Positions) + static_cast<size_t>(Stride) * Vertex);
+    }
+}
+
+namespace MeshOptimizer
+{
+    FVertexCacheStats AnalyzeVertexCache(const uint32* Indices, uint32 IndexCount, uint32 VertexCount, uint32 CacheSize)
+    {
+        FVertexCacheStats Stats;
+        Stats.TriangleCount = IndexCount / 3;
+
+        FFifoCache Cache(VertexCount, CacheSize);
+        std::vector<uint8> Referenced(VertexCount, 0);
+        for (uint32 i = 0; i < Stats.TriangleCount * 3; ++i)
+        {
+            const uint32 Vertex = Indices[i];
+            Stats.Misses += Cache.Access(Vertex) ? 1 : 0;
+            Stats.VertexCount += Referenced[Vertex] ? 0 : 1;
+            Referenced[Vertex] = 1;
+        }
+
+        Stats.ACMR = Stats.TriangleCount > 0 ? static_cast<float>(Stats.Misses) / Stats.TriangleCount : 0.0f;
+        Stats.ATVR = Stats.VertexCount > 0 ? static_cast<float>(Stats.Misses) / Stats.VertexCount : 0.0f;
+        return Stats;
+    }
+
+    void OptimizeVertexCache(uint32* Destination, const uint32* Indices, uint32 IndexCount, uint32 VertexCount)
+    {
+        static const FForsythTables Tables;
+
+        const uint32 TriangleCount = IndexCount / 3;
+        if (TriangleCount == 0)
+        {
+            return;
+        }
+
+        // Vertex -> triangle adjacency; live triangles are kept at the front of each range
+        std::vector<uint32> Valence(VertexCount, 0);
+        for (uint32 i = 0; i < TriangleCount * 3; ++i)
+        {
+            ++Valence[Indices[i]];
+        }
+
+        std::vector<uint32> AdjacencyOffsets(VertexCount + 1, 0);
+        for (uint32 v = 0; v < VertexCount; ++v)
+        {
+            AdjacencyOffsets[v + 1] = AdjacencyOffsets[v] + Valence[v];
+        }
+
+        std::vector<uint32> Adjacency(TriangleCount * 3);
+        {
+            std::vector<uint32> Fill(AdjacencyOffsets.begin(), AdjacencyOffsets.end() - 1);
+            for (uint32 i = 0; i < TriangleCount * 3; ++i)
+            {
+                Adjacency[Fill[Indices[i]]++] = i / 3;
+            }
+        }
+
+        std::vector<int32> CachePosition(VertexCount, -1);
+        std::vector<float> VertexScore(VertexCount);
+        for (uint32 v = 0; v < VertexCount; ++v)
+        {
+            VertexScore[v] = GetVertexScore(Tables, -1, Valence[v]);
+        }
+
+        std::vector<float> TriangleScore(TriangleCount);
+        std::vector<uint8> Emitted(TriangleCount, 0);
+        uint32 BestTriangle = 0;
+        for (uint32 t = 0; t < TriangleCount; ++t)
+        {
+            TriangleScore[t] = VertexScore[Indices[t * 3]] + VertexScore[Indices[t * 3 + 1]] + VertexScore[Indices[t * 3 + 2]];
+            if (TriangleScore[t] > TriangleScore[BestTriangle])
+            {
+                BestTriangle = t;
+            }
+        }
+
+        // Destination may alias Indices
+        std::vector<uint32> Output(TriangleCount * 3);
+
+        uint32 Cache[ForsythCacheSize + 3];
+        uint32 CacheCount = 0;
+        uint32 NewCache[ForsythCacheSize + 3];
+        uint32 FallbackCursor = 0;
+
+        for (uint32 OutputTriangle = 0; OutputTriangle < TriangleCount; ++OutputTriangle)
+        {
+            if (BestTriangle == InvalidIndex)
+            {
+                // Nothing adjacent to the cache is left: continue with the next unemitted triangle
+                while (Emitted[FallbackCursor])
+                {
+                    ++FallbackCursor;
+                }
+                BestTriangle = FallbackCursor;
+            }
+
+            const uint32 Triangle = BestTriangle;
+            Emitted[Triangle] = 1;
+
+            const uint32* TriangleVertices = &Indices[Triangle * 3];
+            Output[OutputTriangle * 3 + 0] = TriangleVertices[0];
+            Output[OutputTriangle * 3 + 1] = TriangleVertices[1];
+            Output[OutputTriangle * 3 + 2] = TriangleVertices[2];
+
+            // Remove the triangle from its vertices' live lists
+            for (uint32 k = 0; k < 3; ++k)
+            {
+                const uint32 Vertex = TriangleVertices[k];
+                uint32* Begin = &Adjacency[AdjacencyOffsets[Vertex]];
+                uint32* End = Begin + Valence[Vertex];
+                uint32* Found = std::find(Begin, End, Triangle);
+                if (Found != End)
+                {
+                    *Found = *(End - 1);
+                    --Valence[Vertex];
+                }
+            }
+
+            // Emitted vertices move to the front of the LRU cache
+            uint32 NewCacheCount = 0;
+            for (uint32 k = 0; k < 3; ++k)
+            {
+                const uint32 Vertex = TriangleVertices[k];
+                if (std::find(NewCache, NewCache + NewCacheCount, Vertex) == NewCache + NewCacheCount)
+                {
+                    NewCache[NewCacheCount++] = Vertex;
+                }
+            }
+            const uint32 TriangleVertexCount = NewCacheCount;
+            for (uint32 k = 0; k < CacheCount; ++k)
+            {
+                const uint32 Vertex = Cache[k];
+                if (std::find(NewCache, NewCache + TriangleVertexCount, Vertex) == NewCache + TriangleVertexCount)
+                {
+                    NewCache[NewCacheCount++] = Vertex;
+                }
+            }
+
+            // Rescore cached and evicted vertices
+            for (uint32 k = 0; k < NewCacheCount; ++k)
+            {
+                const uint32 Vertex = NewCache[k];
+                CachePosition[Vertex] = k < ForsythCacheSize ? static_cast<int32>(k) : -1;
+                VertexScore[Vertex] = GetVertexScore(Tables, CachePosition[Vertex], Valence[Vertex]);
+            }
+
+            // Rescore triangles around the cache and pick the best one
+            BestTriangle = InvalidIndex;
+            float BestScore = -1.0f;
+            const uint32 KeptCount = std::min(NewCacheCount, ForsythCacheSize);
+            for (uint32 k = 0; k < KeptCount; ++k)
+            {
+                const uint32 Vertex = NewCache[k];
+                const uint32* Begin = &Adjacency[AdjacencyOffsets[Vertex]];
+                for (const uint32* It = Begin; It != Begin + Valence[Vertex]; ++It)
+                {
+                    const uint32 Candidate = *It;
+                    const uint32* CandidateVertices = &Indices[Candidate * 3];
+                    const float Score = VertexScore[CandidateVertices[0]] + VertexScore[CandidateVertices[1]] +
+                                        VertexScore[CandidateVertices[2]];
+                    TriangleScore[Candidate] = Score;
+                    if (Score > BestScore)
+                    {
+                        BestScore = Score;
+                        BestTriangle = Candidate;
+                    }
+                }
+            }
+
+            CacheCount = KeptCount;
+            std::memcpy(Cache, NewCache, sizeof(uint32) * CacheCount);
+        }
+
+        std::memcpy(Destination, Output.data(), sizeof(uint32) * Output.size());
+    }
+
+    uint32 OptimizeOverdraw(uint32* Destination, const uint32* Indices, uint32 IndexCount,
+                            const float* Positions, uint32 VertexCount, uint32 PositionStride, float Threshold)
+    {
+        constexpr uint32 CacheSize = 16;
+
+        const uint32 TriangleCount = IndexCount / 3;
+        if (TriangleCount == 0)
+        {
+            return 0;
+        }
+
+        // Hard boundaries: a triangle whose three vertices all miss shares nothing with its predecessors
+        std::vector<uint32> HardClusters;
+        {
+            FFifoCache Cache(VertexCount, CacheSize);
+            for (uint32 t = 0; t < TriangleCount; ++t)
+            {
+                uint32 Misses = 0;
+                for (uint32 k = 0; k < 3; ++k)
+                {
+                    Misses += Cache.Access(Indices[t * 3 + k]) ? 1 : 0;
+                }
+                if (Misses == 3 || t == 0)
+                {
+                    HardClusters.push_back(t);
+                }
+            }
+            HardClusters.push_back(TriangleCount);
+        }
+
+        // Soft boundaries: split a hard cluster once a prefix reaches Threshold x its ACMR
+        std::vector<uint32> Clusters;
+        {
+            FFifoCache Cache(VertexCount, CacheSize);
+            for (size_t c = 0; c + 1 < HardClusters.size(); ++c)
+            {
+                const uint32 Begin = HardClusters[c];
+                const uint32 End = HardClusters[c + 1];
+
+                Cache.Flush();
+                uint32 ClusterMisses = 0;
+                for (uint32 i = Begin * 3; i < End * 3; ++i)
+                {
+                    ClusterMisses += Cache.Access(Indices[i]) ? 1 : 0;
+                }
+                const float TargetACMR = Threshold * static_cast<float>(ClusterMisses) / static_cast<float>(End - Begin);
+
+                Cache.Flush();
+                Clusters.push_back(Begin);
+                uint32 Misses = 0;
+                uint32 Triangles = 0;
+                for (uint32 t = Begin; t < End; ++t)
+                {
+                    for (uint32 k = 0; k < 3; ++k)
+                    {
+                        Misses += Cache.Access(Indices[t * 3 + k]) ? 1 : 0;
+                    }
+                    ++Triangles;
+
+                    if (t + 1 < End && static_cast<float>(Misses) <= TargetACMR * static_cast<float>(Triangles))
+                    {
+                        Clusters.push_back(t + 1);
+                        Cache.Flush();
+                        Misses = 0;
+                        Triangles = 0;
+                    }
+                }
+            }
+            Clusters.push_back(TriangleCount);
+        }
+
+        const uint32 ClusterCount = static_cast<uint32>(Clusters.size() - 1);
+
+        // Area-weighted centroid and normal per cluster
+        struct FClusterInfo
+        {
+            float Centroid[3] = { 0.0f, 0.0f, 0.0f };
+            float Normal[3] = { 0.0f, 0.0f, 0.0f };
+            float Area = 0.0f;
+            float SortKey = 0.0f;
+        };
+        std::vector<FClusterInfo> Infos(ClusterCount);
+
+        float MeshCentroid[3] = { 0.0f, 0.0f, 0.0f };
+        float MeshArea = 0.0f;
+        for (uint32 c = 0; c < ClusterCount; ++c)
+        {
+            FClusterInfo& Info = Infos[c];
+            for (uint32 t = Clusters[c]; t < Clusters[c + 1]; ++t)
+            {
+                const float* A = GetPosition(Positions, PositionStride, Indices[t * 3 + 0]);
+                const float* B = GetPosition(Positions, PositionStride, Indices[t * 3 + 1]);
+                const float* C = GetPosition(Positions, PositionStride, Indices[t * 3 + 2]);
+
+                const float E1[3] = { B[0] - A[0], B[1] - A[1], B[2] - A[2] };
+                const float E2[3] = { C[0] - A[0], C[1] - A[1], C[2] - A[2] };
+                const float N[3] = { E1[1] * E2[2] - E1[2] * E2[1], E1[2] * E2[0] - E1[0] * E2[2], E1[0] * E2[1] - E1[1] * E2[0] };
+                const float Area = std::sqrt(N[0] * N[0] + N[1] * N[1] + N[2] * N[2]);
+
+                for (int Axis = 0; Axis < 3; ++Axis)
+                {
+                    Info.Centroid[Axis] += (A[Axis] + B[Axis] + C[Axis]) * (Area / 3.0f);
+                    Info.Normal[Axis] += N[Axis];
+                }
+                Info.Area += Area;
+            }
+
+            for (int Axis = 0; Axis < 3; ++Axis)
+            {
+                MeshCentroid[Axis] += Info.Centroid[Axis];
+                Info.Centroid[Axis] = Info.Area > 0.0f ? Info.Centroid[Axis] / Info.Area : 0.0f;
+            }
+            MeshArea += Info.Area;
+        }
+        for (int Axis = 0; Axis < 3; ++Axis)
+        {
+            MeshCentroid[Axis] = MeshArea > 0.0f ? MeshCentroid[Axis] / MeshArea : 0.0f;
+        }
+
+        // Clusters on the outside facing outward occlude the rest: draw them first
+        for (FClusterInfo& Info : Infos)
+        {
+            const float Length = std::sqrt(Info.Normal[0] * Info.Normal[0] + Info.Normal[1] * Info.Normal[1] +
+                                           Info.Normal[2] * Info.Normal[2]);
+            if (Length > 0.0f)
+            {
+                for (int Axis = 0; Axis < 3; ++Axis)
+                {
+                    Info.SortKey += (Info.Centroid[Axis] - MeshCentroid[Axis]) * Info.Normal[Axis] / Length;
+                }
+            }
+        }
+
+        std::vector<uint32> Order(ClusterCount);
+        for (uint32 c = 0; c < ClusterCount; ++c)
+        {
+            Order[c] = c;
+        }
+        std::stable_sort(Order.begin(), Order.end(), [&Infos](uint32 A, uint32 B)
+        {
+            return Infos[A].SortKey > Infos[B].SortKey;
+        });
+
+        std::vector<uint32> Output;
+        Output.reserve(TriangleCount * 3);
+        for (uint32 c : Order)
+        {
+            Output.insert(Output.end(), Indices + Clusters[c] * 3, Indices + Clusters[c + 1] * 3);
+        }
+        std::memcpy(Destination, Output.data(), sizeof(uint32) * Output.size());
+
+        return ClusterCount;
+    }
+
+    uint32 OptimizeVertexFetch(void* Vertices, uint32 VertexCount, uint32 VertexSize, uint32* Indices, uint32 IndexCount)
+    {
+        std::vector<uint32> Remap(VertexCount, InvalidIndex);
+        uint32 NextVertex = 0;
+        for (uint32 i = 0; i < IndexCount; ++i)
+        {
+            uint32& Target = Remap[Indices[i]];
+            if (Target == InvalidIndex)
+            {
+                Target = NextVertex++;
+            }
+            Indices[i] = Target;
+        }
+
+        std::vector<uint8> Source(static_cast<const uint8*>(Vertices),
+                                  static_cast<const uint8*>(Vertices) + static_cast<size_t>(VertexCount) * VertexSize);
+        uint8* Output = static_cast<uint8*>(Vertices);
+        for (uint32 v = 0; v < VertexCount; ++v)
+        {
+            if (Remap[v] != InvalidIndex)
+            {
+                std::memcpy(Output + static_cast<size_t>(Remap[v]) * VertexSize,
+                            Source.data() + static_cast<size_t>(v) * VertexSize, VertexSize);
+            }
+        }
+
+        return NextVertex;
+    }
+
+    FMeshOptimizeStats OptimizeMesh(void* Vertices, uint32& VertexCount, uint32 VertexSize,
+                                    uint32* Indices, uint32 IndexCount, const FMeshOptimizeSettings& Settings)
+    {
+        FMeshOptimizeStats Stats;
+        Stats.Before = AnalyzeVertexCache(Indices, IndexCount, VertexCount, Settings.AnalysisCacheSize);
+
+        if (Settings.bOptimizeVertexCache)
+        {
+            OptimizeVertexCache(Indices, Indices, IndexCount, VertexCount);
+        }
+
+        if (Settings.bOptimizeOverdraw)
+        {
+            Stats.ClusterCount = OptimizeOverdraw(Indices, Indices, IndexCount, static_cast<const float*>(Vertices),
+                                                  VertexCount, VertexSize, Settings.OverdrawThreshold);
+        }
+
+        if (Settings.bOptimizeVertexFetch)
+        {
+            const uint32 NewVertexCount = OptimizeVertexFetch(Vertices, VertexCount, VertexSize, Indices, IndexCount);
+            Stats.RemovedVertexCount = VertexCount - NewVertexCount;
+            VertexCount = NewVertexCount;
+        }
+
+        Stats.After = AnalyzeVertexCache(Indices, IndexCount, VertexCount, Settings.AnalysisCacheSize);
+        return Stats;
+    }
+
+    void ConvertTo16BitIndices(const uint32* Indices, uint32 IndexCount, std::vector<uint16>& OutIndices)
+    {
+        OutIndices.resize(IndexCount);
+        for (uint32 i = 0; i < IndexCount; ++i)
+        {
+            OutIndices[i] = static_cast<uint16>(Indices[i]);
+        }
+    }
+}
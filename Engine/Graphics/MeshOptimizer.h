@@ -0,0 +1,99 @@
+﻿#pragma once
+
+#include <vector>
+#include "../Utils/Types.h"
+
+// Index and vertex order optimization run before mesh upload. Platform independent.
+// All functions take triangle lists.
+
+/**
+ * @brief Post-transform vertex cache statistics (FIFO cache simulation)
+ */
+struct FVertexCacheStats
+{
+    uint32 TriangleCount = 0;
+    uint32 VertexCount = 0;         // Vertices referenced by the indices
+    uint32 Misses = 0;              // Vertex shader invocations
+    float ACMR = 0.0f;              // Misses per triangle (0.5 is ideal for large grids, 3 is worst)
+    float ATVR = 0.0f;              // Misses per referenced vertex (1 is ideal)
+};
+
+/**
+ * @brief Mesh optimization settings
+ */
+struct FMeshOptimizeSettings
+{
+    bool bOptimizeVertexCache = true;
+    bool bOptimizeOverdraw = true;
+    bool bOptimizeVertexFetch = true;
+    float OverdrawThreshold = 1.05f;    // Allowed ACMR growth when splitting clusters for overdraw
+    uint32 AnalysisCacheSize = 16;      // FIFO size used for the reported statistics
+};
+
+/**
+ * @brief Result of MeshOptimizer::OptimizeMesh
+ */
+struct FMeshOptimizeStats
+{
+    FVertexCacheStats Before;
+    FVertexCacheStats After;
+    uint32 ClusterCount = 0;            // Clusters sorted by the overdraw pass
+    uint32 RemovedVertexCount = 0;      // Unreferenced vertices dropped by the fetch pass
+};
+
+namespace MeshOptimizer
+{
+    /**
+     * @brief Simulate a FIFO post-transform cache over an index buffer
+     */
+    FVertexCacheStats AnalyzeVertexCache(const uint32* Indices, uint32 IndexCount, uint32 VertexCount,
+                                         uint32 CacheSize = 16);
+
+    /**
+     * @brief Reorder triangles for post-transform cache hits (Forsyth's linear-speed algorithm)
+     * @param Destination Output indices (may equal Indices)
+     */
+    void OptimizeVertexCache(uint32* Destination, const uint32* Indices, uint32 IndexCount, uint32 VertexCount);
+
+    /**
+     * @brief Reorder clusters of a cache-optimized index buffer to reduce overdraw
+     *
+     * Triangles are split into clusters where the cache has no locality to
+     * lose (and, within Threshold of the cluster ACMR, at soft boundaries);
+     * clusters facing away from the mesh center are drawn first.
+     * @param Destination Output indices (may equal Indices)
+     * @param Positions First position (3 floats)
+     * @param PositionStride Byte distance between positions
+     * @return Number of clusters
+     */
+    uint32 OptimizeOverdraw(uint32* Destination, const uint32* Indices, uint32 IndexCount,
+                            const float* Positions, uint32 VertexCount, uint32 PositionStride, float Threshold = 1.05f);
+
+    /**
+     * @brief Reorder vertices in order of first use and drop unreferenced ones
+     * @param Vertices Vertex data, rewritten in place
+     * @param Indices Index data, remapped in place
+     * @param VertexSize Byte size of one vertex
+     * @return New vertex count
+     */
+    uint32 OptimizeVertexFetch(void* Vertices, uint32 VertexCount, uint32 VertexSize, uint32* Indices, uint32 IndexCount);
+
+    /**
+     * @brief Run the enabled passes (cache, overdraw, fetch) in place
+     * @param Vertices Vertex data; each vertex starts with a float3 position
+     * @param VertexCount Vertex count, updated when unreferenced vertices are dropped
+     */
+    FMeshOptimizeStats OptimizeMesh(void* Vertices, uint32& VertexCount, uint32 VertexSize,
+                                    uint32* Indices, uint32 IndexCount,
+                                    const FMeshOptimizeSettings& Settings = FMeshOptimizeSettings());
+
+    /**
+     * @brief Whether every index fits a 16-bit index buffer
+     */
+    inline bool CanUse16BitIndices(uint32 VertexCount) { return VertexCount < 65536; }
+
+    /**
+     * @brief Narrow indices to 16 bits (caller checks CanUse16BitIndices)
+     */
+    void ConvertTo16BitIndices(const uint32* Indices, uint32 IndexCount, std::vector<uint16>& OutIndices);
+}
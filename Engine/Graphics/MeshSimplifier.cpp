@@ -0,0 +1,1190 @@
+﻿#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include "../Core/JobSystem.h"
+#include "../Core/Profiler.h"
+#include "../Utils/Bounds.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    constexpr uint32 InvalidIndex = ~0u;
+
+    // Border edges resist sliding off their line this much more than faces resist bending
+    constexpr float BorderWeight = 10.0f;
+
+    // Collapses of a pass may exceed the error at the pass goal by this factor,
+    // since many cheap collapses get blocked by their neighbors
+    constexpr float PassErrorSlack = 1.5f;
+
+    // Squared area over squared edge lengths below which a collapsed triangle counts as a sliver (~0.1 degree)
+    constexpr float MinTriangleShape = 1e-6f;
+
+    // Simplifications whose measured deviation exceeds the target error are redone with a tighter quadric limit
+    constexpr uint32 MaxLimitAttempts = 4;
+
+    enum class EVertexKind : uint8
+    {
+        Manifold,   // Interior vertex, may collapse along any edge
+        Border,     // On one open border, may only collapse along it
+        Locked      // Seam, non-manifold or locked border vertex
+    };
+
+    /**
+     * @brief Sum of squared distances to weighted planes
+     *
+     * Double precision: the error of nearby points is a small difference of large terms.
+     */
+    struct FQuadric
+    {
+        double A00 = 0.0, A11 = 0.0, A22 = 0.0;
+        double A10 = 0.0, A20 = 0.0, A21 = 0.0;
+        double B0 = 0.0, B1 = 0.0, B2 = 0.0;
+        double C = 0.0;
+        double Weight = 0.0;
+
+        void AddPlane(const float Normal[3], float Distance, float InWeight)
+        {
+            const double X = Normal[0], Y = Normal[1], Z = Normal[2], D = Distance, W = InWeight;
+            A00 += W * X * X;
+            A11 += W * Y * Y;
+            A22 += W * Z * Z;
+            A10 += W * Y * X;
+            A20 += W * Z * X;
+            A21 += W * Z * Y;
+            B0 += W * X * D;
+            B1 += W * Y * D;
+            B2 += W * Z * D;
+            C += W * D * D;
+            Weight += W;
+        }
+
+        void Add(const FQuadric& Other)
+        {
+            A00 += Other.A00; A11 += Other.A11; A22 += Other.A22;
+            A10 += Other.A10; A20 += Other.A20; A21 += Other.A21;
+            B0 += Other.B0; B1 += Other.B1; B2 += Other.B2;
+            C += Other.C;
+            Weight += Other.Weight;
+        }
+
+        /**
+         * @brief Weighted mean squared distance of a point to the planes
+         */
+        float Evaluate(const float* Point) const
+        {
+            const double X = Point[0], Y = Point[1], Z = Point[2];
+            const double Result = A00 * X * X + A11 * Y * Y + A22 * Z * Z +
+                                  2.0 * (A10 * X * Y + A20 * X * Z + A21 * Y * Z) +
+                                  2.0 * (B0 * X + B1 * Y + B2 * Z) + C;
+            return Weight > 0.0 ? static_cast<float>(std::fabs(Result) / Weight) : 0.0f;
+        }
+    };
+
+    struct FCollapse
+    {
+        uint32 Vertex;      // Vertex that disappears
+        uint32 Target;      // Vertex it is merged into
+        float Error;
+    };
+
+    float Square(float Value)
+    {
+        return Value * Value;
+    }
+
+    void Subtract(const float* A, const float* B, float* Out)
+    {
+        Out[0] = A[0] - B[0];
+        Out[1] = A[1] - B[1];
+        Out[2] = A[2] - B[2];
+    }
+
+    void Cross(const float* A, const float* B, float* Out)
+    {
+        Out[0] = A[1] * B[2] - A[2] * B[1];
+        Out[1] = A[2] * B[0] - A[0] * B[2];
+        Out[2] = A[0] * B[1] - A[1] * B[0];
+    }
+
+    float Dot(const float* A, const float* B)
+    {
+        return A[0] * B[0] + A[1] * B[1] + A[2] * B[2];
+    }
+
+    float Normalize(float* Vector)
+    {
+        const float Length = std::sqrt(Dot(Vector, Vector));
+        if (Length > 0.0f)
+        {
+            Vector[0] /= Length;
+            Vector[1] /= Length;
+            Vector[2] /= Length;
+        }
+        return Length;
+    }
+
+    uint32 HashPosition(const float* Position)
+    {
+        uint32 Bits[3];
+        std::memcpy(Bits, Position, sizeof(Bits));
+        return (Bits[0] * 73856093u) ^ (Bits[1] * 19349663u) ^ (Bits[2] * 83492791u);
+    }
+
+    /**
+     * @brief Map every vertex to the first vertex with the same position
+     * @param OutSeam Set for canonical vertices shared by several vertices
+     */
+    void BuildPositionRemap(const float* Positions, uint32 VertexCount, std::vector<uint32>& OutCanonical,
+                            std::vector<uint8>& OutSeam)
+    {
+        uint32 TableSize = 1;
+        while (TableSize < VertexCount * 2)
+        {
+            TableSize *= 2;
+        }
+
+        std::vector<uint32> Table(TableSize, InvalidIndex);
+        OutCanonical.resize(VertexCount);
+        OutSeam.assign(VertexCount, 0);
+
+        for (uint32 v = 0; v < VertexCount; ++v)
+        {
+            const float* Position = &Positions[v * 3];
+            uint32 Slot = HashPosition(Position) & (TableSize - 1);
+            for (uint32 Probe = 1; ; ++Probe)
+            {
+                const uint32 Existing = Table[Slot];
+                if (Existing == InvalidIndex)
+                {
+                    Table[Slot] = v;
+                    OutCanonical[v] = v;
+                    break;
+                }
+                if (std::memcmp(&Positions[Existing * 3], Position, sizeof(float) * 3) == 0)
+                {
+                    OutCanonical[v] = Existing;
+                    OutSeam[Existing] = 1;
+                    break;
+                }
+                Slot = (Slot + Probe) & (TableSize - 1);
+            }
+        }
+    }
+
+    /**
+     * @brief Vertex -> triangle adjacency over canonical vertices
+     */
+    struct FAdjacency
+    {
+        std::vector<uint32> Offsets;
+        std::vector<uint32> Triangles;
+
+        void Build(const uint32* Indices, uint32 IndexCount, const std::vector<uint32>& Canonical)
+        {
+            const uint32 VertexCount = static_cast<uint32>(Canonical.size());
+            Offsets.assign(VertexCount + 1, 0);
+            for (uint32 i = 0; i < IndexCount; ++i)
+            {
+                ++Offsets[Canonical[Indices[i]] + 1];
+            }
+            for (uint32 v = 0; v < VertexCount; ++v)
+            {
+                Offsets[v + 1] += Offsets[v];
+            }
+
+            Triangles.resize(IndexCount);
+            std::vector<uint32> Fill(Offsets.begin(), Offsets.end() - 1);
+            for (uint32 i = 0; i < IndexCount; ++i)
+            {
+                Triangles[Fill[Canonical[Indices[i]]]++] = i / 3;
+            }
+        }
+    };
+
+    /**
+     * @brief Whether some triangle has the directed edge A -> B (canonical vertices)
+     */
+    bool HasEdge(const FAdjacency& Adjacency, const uint32* Indices, const std::vector<uint32>& Canonical,
+                 uint32 A, uint32 B)
+    {
+        for (uint32 i = Adjacency.Offsets[A]; i < Adjacency.Offsets[A + 1]; ++i)
+        {
+            const uint32* Triangle = &Indices[Adjacency.Triangles[i] * 3];
+            for (uint32 k = 0; k < 3; ++k)
+            {
+                if (Canonical[Triangle[k]] == A && Canonical[Triangle[(k + 1) % 3]] == B)
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Sort collapses by error (counting sort on the top 11 bits of the float)
+     */
+    void SortCollapses(const std::vector<FCollapse>& Collapses, std::vector<uint32>& OutOrder)
+    {
+        constexpr uint32 SortBits = 11;
+        uint32 Histogram[1 << SortBits] = {};
+
+        auto GetKey = [](float Error)
+        {
+            uint32 Bits;
+            std::memcpy(&Bits, &Error, sizeof(Bits));
+            return (Bits >> (32 - SortBits)) & ((1u << SortBits) - 1);
+        };
+
+        for (const FCollapse& Collapse : Collapses)
+        {
+            ++Histogram[GetKey(Collapse.Error)];
+        }
+
+        uint32 Sum = 0;
+        for (uint32& Count : Histogram)
+        {
+            const uint32 Start = Sum;
+            Sum += Count;
+            Count = Start;
+        }
+
+        OutOrder.resize(Collapses.size());
+        for (uint32 i = 0; i < Collapses.size(); ++i)
+        {
+            OutOrder[Histogram[GetKey(Collapses[i].Error)]++] = i;
+        }
+    }
+
+    /**
+     * @brief Squared distance from a point to a triangle (Ericson, Real-Time Collision Detection 5.1.5)
+     */
+    float GetPointTriangleDistanceSquared(const float* P, const float* A, const float* B, const float* C)
+    {
+        float AB[3], AC[3], AP[3];
+        Subtract(B, A, AB);
+        Subtract(C, A, AC);
+        Subtract(P, A, AP);
+        const float D1 = Dot(AB, AP);
+        const float D2 = Dot(AC, AP);
+
+        float Closest[3];
+        auto SetClosest = [&Closest](const float* Origin, const float* Direction, float T)
+        {
+            Closest[0] = Origin[0] + Direction[0] * T;
+            Closest[1] = Origin[1] + Direction[1] * T;
+            Closest[2] = Origin[2] + Direction[2] * T;
+        };
+
+        if (D1 <= 0.0f && D2 <= 0.0f)
+        {
+            SetClosest(A, AB, 0.0f);
+        }
+        else
+        {
+            float BP[3], CP[3];
+            Subtract(P, B, BP);
+            Subtract(P, C, CP);
+            const float D3 = Dot(AB, BP);
+            const float D4 = Dot(AC, BP);
+            const float D5 = Dot(AB, CP);
+            const float D6 = Dot(AC, CP);
+            const float VC = D1 * D4 - D3 * D2;
+            const float VB = D5 * D2 - D1 * D6;
+            const float VA = D3 * D6 - D5 * D4;
+            if (D3 >= 0.0f && D4 <= D3)
+            {
+                SetClosest(B, AB, 0.0f);
+            }
+            else if (D6 >= 0.0f && D5 <= D6)
+            {
+                SetClosest(C, AB, 0.0f);
+            }
+            else if (VC <= 0.0f && D1 >= 0.0f && D3 <= 0.0f)
+            {
+                SetClosest(A, AB, D1 / (D1 - D3));
+            }
+            else if (VB <= 0.0f && D2 >= 0.0f && D6 <= 0.0f)
+            {
+                SetClosest(A, AC, D2 / (D2 - D6));
+            }
+            else if (VA <= 0.0f && (D4 - D3) >= 0.0f && (D5 - D6) >= 0.0f)
+            {
+                float BC[3];
+                Subtract(C, B, BC);
+                SetClosest(B, BC, (D4 - D3) / ((D4 - D3) + (D5 - D6)));
+            }
+            else
+            {
+                const float Denominator = 1.0f / (VA + VB + VC);
+                SetClosest(A, AB, VB * Denominator);
+                Closest[0] += AC[0] * (VC * Denominator);
+                Closest[1] += AC[1] * (VC * Denominator);
+                Closest[2] += AC[2] * (VC * Denominator);
+            }
+        }
+
+        float Delta[3];
+        Subtract(P, Closest, Delta);
+        return Dot(Delta, Delta);
+    }
+
+    /**
+     * @brief Sparse uniform grid of triangles for closest surface point queries
+     *
+     * Each triangle is listed in every cell its bounds overlap, so a query that
+     * has searched a block of cells has seen every triangle that reaches into
+     * it. Occupied cells are found through an open addressing table, which
+     * keeps cells about as small as the triangles on large meshes.
+     */
+    class FTriangleGrid
+    {
+    public:
+        void Build(const uint32* InIndices, uint32 IndexCount, const float* InPositions, uint32 InPositionStride)
+        {
+            Indices = InIndices;
+            Positions = reinterpret_cast<const uint8*>(InPositions);
+            PositionStride = InPositionStride;
+            const uint32 TriangleCount = IndexCount / 3;
+
+            // Cells as large as an average triangle
+            float Min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+            float Max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+            double ExtentSum = 0.0;
+            for (uint32 Triangle = 0; Triangle < TriangleCount; ++Triangle)
+            {
+                float TriangleMin[3], TriangleMax[3];
+                GetTriangleBounds(Triangle, TriangleMin, TriangleMax);
+                float Extent = 0.0f;
+                for (uint32 Axis = 0; Axis < 3; ++Axis)
+                {
+                    Min[Axis] = std::min(Min[Axis], TriangleMin[Axis]);
+                    Max[Axis] = std::max(Max[Axis], TriangleMax[Axis]);
+                    Extent = std::max(Extent, TriangleMax[Axis] - TriangleMin[Axis]);
+                }
+                ExtentSum += Extent;
+            }
+
+            const float Size = std::max(std::max(Max[0] - Min[0], Max[1] - Min[1]), Max[2] - Min[2]);
+            CellSize = std::max(static_cast<float>(ExtentSum / std::max(TriangleCount, 1u)), Size / MaxDimension);
+            CellSize = CellSize > 0.0f ? CellSize : 1.0f;
+            for (uint32 Axis = 0; Axis < 3; ++Axis)
+            {
+                Origin[Axis] = Min[Axis];
+                Dimensions[Axis] = std::min(static_cast<int32>((Max[Axis] - Min[Axis]) / CellSize) + 1, MaxDimension);
+            }
+
+            // Number the occupied cells, remembering the cell of every (triangle, cell) pair
+            std::vector<uint32> PairCells;
+            PairCells.reserve(size_t(TriangleCount) * 4);
+            CellOffsets.assign(1, 0);
+            uint32 TableSize = 64;
+            while (TableSize < TriangleCount)
+            {
+                TableSize *= 2;
+            }
+            SlotKeys.assign(TableSize, EmptyKey);
+            SlotCells.resize(TableSize);
+            for (uint32 Triangle = 0; Triangle < TriangleCount; ++Triangle)
+            {
+                float TriangleMin[3], TriangleMax[3];
+                GetTriangleBounds(Triangle, TriangleMin, TriangleMax);
+                int32 First[3], Last[3];
+                GetCell(TriangleMin, First);
+                GetCell(TriangleMax, Last);
+                for (int32 Z = First[2]; Z <= Last[2]; ++Z)
+                {
+                    for (int32 Y = First[1]; Y <= Last[1]; ++Y)
+                    {
+                        for (int32 X = First[0]; X <= Last[0]; ++X)
+                        {
+                            const uint32 Cell = FindOrAddCell(GetCellKey(X, Y, Z));
+                            ++CellOffsets[Cell + 1];
+                            PairCells.push_back(Cell);
+                        }
+                    }
+                }
+            }
+
+            const uint32 CellCount = static_cast<uint32>(CellOffsets.size()) - 1;
+            for (uint32 Cell = 0; Cell < CellCount; ++Cell)
+            {
+                CellOffsets[Cell + 1] += CellOffsets[Cell];
+            }
+            CellTriangles.resize(PairCells.size());
+            std::vector<uint32> Fill(CellOffsets.begin(), CellOffsets.end() - 1);
+            uint32 Pair = 0;
+            for (uint32 Triangle = 0; Triangle < TriangleCount; ++Triangle)
+            {
+                float TriangleMin[3], TriangleMax[3];
+                GetTriangleBounds(Triangle, TriangleMin, TriangleMax);
+                int32 First[3], Last[3];
+                GetCell(TriangleMin, First);
+                GetCell(TriangleMax, Last);
+                const uint32 CellsCovered = uint32(Last[0] - First[0] + 1) * (Last[1] - First[1] + 1) * (Last[2] - First[2] + 1);
+                for (uint32 i = 0; i < CellsCovered; ++i)
+                {
+                    CellTriangles[Fill[PairCells[Pair++]]++] = Triangle;
+                }
+            }
+        }
+
+        /**
+         * @brief Key of the cell a point falls into (points outside the grid take the nearest cell)
+         */
+        uint64 GetPointKey(const float* Point) const
+        {
+            int32 Cell[3];
+            GetCell(Point, Cell);
+            return GetCellKey(Cell[0], Cell[1], Cell[2]);
+        }
+
+        /**
+         * @brief Squared distance from Point to the closest triangle, FLT_MAX without triangles
+         * @param Threshold Squared distance at which the search may stop early, returning some distance <= Threshold
+         */
+        float GetDistanceSquared(const float* Point, float Threshold = 0.0f) const
+        {
+            // Points outside the grid search from their projection onto it, which is no farther from any cell
+            int32 Center[3];
+            float Projected[3];
+            GetCell(Point, Center);
+            for (uint32 Axis = 0; Axis < 3; ++Axis)
+            {
+                Projected[Axis] = std::min(std::max(Point[Axis], Origin[Axis]), Origin[Axis] + Dimensions[Axis] * CellSize);
+            }
+
+            // A triangle in several searched cells is tested again; that costs less than tracking it
+            float Best = FLT_MAX;
+            for (int32 Ring = 0; ; ++Ring)
+            {
+                const int32 MinZ = std::max(Center[2] - Ring, 0), MaxZ = std::min(Center[2] + Ring, Dimensions[2] - 1);
+                const int32 MinY = std::max(Center[1] - Ring, 0), MaxY = std::min(Center[1] + Ring, Dimensions[1] - 1);
+                const int32 MinX = std::max(Center[0] - Ring, 0), MaxX = std::min(Center[0] + Ring, Dimensions[0] - 1);
+                for (int32 Z = MinZ; Z <= MaxZ; ++Z)
+                {
+                    for (int32 Y = MinY; Y <= MaxY; ++Y)
+                    {
+                        // Inner rows only touch the ring at their ends
+                        const bool bShell = std::abs(Z - Center[2]) == Ring || std::abs(Y - Center[1]) == Ring;
+                        const int32 Step = bShell ? 1 : std::max(2 * Ring, 1);
+                        for (int32 X = Center[0] - Ring; X <= Center[0] + Ring; X += Step)
+                        {
+                            if (X >= MinX && X <= MaxX)
+                            {
+                                if (VisitCell(GetCellKey(X, Y, Z), Point, Threshold, Best))
+                                {
+                                    return Best;
+                                }
+                            }
+                        }
+                    }
+                }
+
+                // Unvisited triangles lie entirely outside the searched block of cells
+                float Reach = FLT_MAX;
+                for (uint32 Axis = 0; Axis < 3; ++Axis)
+                {
+                    if (Center[Axis] - Ring > 0)
+                    {
+                        Reach = std::min(Reach, Projected[Axis] - (Origin[Axis] + (Center[Axis] - Ring) * CellSize));
+                    }
+                    if (Center[Axis] + Ring < Dimensions[Axis] - 1)
+                    {
+                        Reach = std::min(Reach, Origin[Axis] + (Center[Axis] + Ring + 1) * CellSize - Projected[Axis]);
+                    }
+                }
+                if (Reach == FLT_MAX || Best <= Reach * Reach || Best <= Threshold)
+                {
+                    break;
+                }
+            }
+            return Best;
+        }
+
+    private:
+        static constexpr int32 MaxDimension = 1 << 20;      // Cell coordinates are packed into 21 bits each
+        static constexpr uint64 EmptyKey = ~uint64(0);
+
+        const float* GetPosition(uint32 Index) const
+        {
+            return reinterpret_cast<const float*>(Positions + static_cast<size_t>(Index) * PositionStride);
+        }
+
+        void GetTriangleBounds(uint32 Triangle, float* OutMin, float* OutMax) const
+        {
+            const float* Corners[3] = { GetPosition(Indices[Triangle * 3]), GetPosition(Indices[Triangle * 3 + 1]),
+                                        GetPosition(Indices[Triangle * 3 + 2]) };
+            for (uint32 Axis = 0; Axis < 3; ++Axis)
+            {
+                OutMin[Axis] = std::min(std::min(Corners[0][Axis], Corners[1][Axis]), Corners[2][Axis]);
+                OutMax[Axis] = std::max(std::max(Corners[0][Axis], Corners[1][Axis]), Corners[2][Axis]);
+            }
+        }
+
+        void GetCell(const float* Point, int32* OutCell) const
+        {
+            for (uint32 Axis = 0; Axis < 3; ++Axis)
+            {
+                const float Cell = std::floor((Point[Axis] - Origin[Axis]) / CellSize);
+                OutCell[Axis] = Cell <= 0.0f ? 0 : static_cast<int32>(std::min(Cell, static_cast<float>(Dimensions[Axis] - 1)));
+            }
+        }
+
+        static uint64 GetCellKey(int32 X, int32 Y, int32 Z)
+        {
+            return uint64(X) | (uint64(Y) << 21) | (uint64(Z) << 42);
+        }
+
+        static uint32 HashKey(uint64 Key)
+        {
+            Key ^= Key >> 33;
+            Key *= 0xff51afd7ed558ccdull;
+            Key ^= Key >> 33;
+            return static_cast<uint32>(Key);
+        }
+
+        // Table slot holding Key, or the empty slot where it belongs
+        uint32 FindSlot(uint64 Key) const
+        {
+            const uint32 Mask = static_cast<uint32>(SlotKeys.size()) - 1;
+            uint32 Slot = HashKey(Key) & Mask;
+            while (SlotKeys[Slot] != Key && SlotKeys[Slot] != EmptyKey)
+            {
+                Slot = (Slot + 1) & Mask;
+            }
+            return Slot;
+        }
+
+        uint32 FindOrAddCell(uint64 Key)
+        {
+            uint32 Slot = FindSlot(Key);
+            if (SlotKeys[Slot] == Key)
+            {
+                return SlotCells[Slot];
+            }
+
+            // Keep the table at most half full
+            const uint32 Cell = static_cast<uint32>(CellOffsets.size()) - 1;
+            if ((Cell + 1) * 2 > SlotKeys.size())
+            {
+                std::vector<uint64> OldKeys(SlotKeys.size() * 2, EmptyKey);
+                std::vector<uint32> OldCells(SlotKeys.size() * 2);
+                OldKeys.swap(SlotKeys);
+                OldCells.swap(SlotCells);
+                for (size_t i = 0; i < OldKeys.size(); ++i)
+                {
+                    if (OldKeys[i] != EmptyKey)
+                    {
+                        const uint32 NewSlot = FindSlot(OldKeys[i]);
+                        SlotKeys[NewSlot] = OldKeys[i];
+                        SlotCells[NewSlot] = OldCells[i];
+                    }
+                }
+                Slot = FindSlot(Key);
+            }
+
+            SlotKeys[Slot] = Key;
+            SlotCells[Slot] = Cell;
+            CellOffsets.push_back(0);
+            return Cell;
+        }
+
+        /**
+         * @brief Test the triangles of a cell
+         * @return Whether a triangle within Threshold was found
+         */
+        bool VisitCell(uint64 Key, const float* Point, float Threshold, float& Best) const
+        {
+            const uint32 Slot = FindSlot(Key);
+            if (SlotKeys[Slot] == EmptyKey)
+            {
+                return false;
+            }
+            const uint32 Cell = SlotCells[Slot];
+            for (uint32 i = CellOffsets[Cell]; i < CellOffsets[Cell + 1]; ++i)
+            {
+                const uint32* Triangle = &Indices[CellTriangles[i] * 3];
+                Best = std::min(Best, GetPointTriangleDistanceSquared(Point, GetPosition(Triangle[0]),
+                                                                      GetPosition(Triangle[1]), GetPosition(Triangle[2])));
+                if (Best <= Threshold)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    private:
+        const uint32* Indices = nullptr;
+        const uint8* Positions = nullptr;
+        uint32 PositionStride = 0;
+
+        float Origin[3] = {};
+        float CellSize = 1.0f;
+        int32 Dimensions[3] = { 1, 1, 1 };
+
+        std::vector<uint64> SlotKeys;           // Cell key per table slot, EmptyKey if unused
+        std::vector<uint32> SlotCells;          // Occupied cell of each used slot
+        std::vector<uint32> CellOffsets;        // Triangles of cell i: CellTriangles[CellOffsets[i], CellOffsets[i + 1])
+        std::vector<uint32> CellTriangles;
+    };
+
+    /**
+     * @brief Largest distance from a vertex of the source triangles to the simplified surface
+     */
+    float MeasureDeviation(const uint32* SourceIndices, uint32 SourceIndexCount, const std::vector<uint32>& Result,
+                           const float* Positions, uint32 VertexCount, uint32 PositionStride)
+    {
+        KE_PROFILE_FUNCTION();
+
+        if (Result.empty())
+        {
+            return SourceIndexCount > 0 ? FLT_MAX : 0.0f;
+        }
+
+        FTriangleGrid Grid;
+        Grid.Build(Result.data(), static_cast<uint32>(Result.size()), Positions, PositionStride);
+
+        // Vertices the simplified mesh still uses lie on it
+        std::vector<uint8> Measured(VertexCount, 0);
+        for (uint32 Index : Result)
+        {
+            Measured[Index] = 1;
+        }
+
+        // Query the removed vertices cell by cell, so neighboring queries share the triangles they read
+        const uint8* PositionBytes = reinterpret_cast<const uint8*>(Positions);
+        auto GetPosition = [PositionBytes, PositionStride](uint32 Vertex)
+        {
+            return reinterpret_cast<const float*>(PositionBytes + static_cast<size_t>(Vertex) * PositionStride);
+        };
+        std::vector<std::pair<uint64, uint32>> Queries;
+        for (uint32 i = 0; i < SourceIndexCount; ++i)
+        {
+            const uint32 Vertex = SourceIndices[i];
+            if (!Measured[Vertex])
+            {
+                Measured[Vertex] = 1;
+                Queries.emplace_back(Grid.GetPointKey(GetPosition(Vertex)), Vertex);
+            }
+        }
+        std::sort(Queries.begin(), Queries.end());
+
+        // Only the largest distance matters: a query may stop once it finds the surface within it
+        float MaxDistanceSquared = 0.0f;
+        for (const std::pair<uint64, uint32>& Query : Queries)
+        {
+            MaxDistanceSquared = std::max(MaxDistanceSquared, Grid.GetDistanceSquared(GetPosition(Query.second), MaxDistanceSquared));
+        }
+        return std::sqrt(MaxDistanceSquared);
+    }
+
+    /**
+     * @brief Quadric error edge collapses (see MeshSimplifier::Simplify)
+     * @param QuadricLimit Largest object-space quadric error of a collapse, 0 for no limit
+     * @param Result Remaining triangles
+     */
+    void CollapseEdges(const uint32* Indices, uint32 IndexCount, const float* Positions, uint32 VertexCount,
+                       uint32 PositionStride, uint32 TargetIndexCount, float QuadricLimit, bool bLockBorders,
+                       std::vector<uint32>& Result)
+    {
+        // Work in a unit cube so quadric sums keep their precision
+        const FBoundingBox Box = Bounds::ComputeBox(Positions, VertexCount, PositionStride);
+        const float Scale = std::max(std::max(Box.Extents[0], Box.Extents[1]), Box.Extents[2]) * 2.0f;
+        const float InvScale = Scale > 0.0f ? 1.0f / Scale : 0.0f;
+
+        std::vector<float> Scaled(static_cast<size_t>(VertexCount) * 3);
+        const uint8* PositionBytes = reinterpret_cast<const uint8*>(Positions);
+        for (uint32 v = 0; v < VertexCount; ++v)
+        {
+            const float* Position = reinterpret_cast<const float*>(PositionBytes + static_cast<size_t>(v) * PositionStride);
+            for (uint32 Axis = 0; Axis < 3; ++Axis)
+            {
+                Scaled[v * 3 + Axis] = (Position[Axis] - Box.Center[Axis] + Box.Extents[Axis]) * InvScale;
+            }
+        }
+
+        std::vector<uint32> Canonical;
+        std::vector<uint8> Seam;
+        BuildPositionRemap(Scaled.data(), VertexCount, Canonical, Seam);
+
+        // Working copy without triangles that are degenerate by position
+        Result.clear();
+        Result.reserve(IndexCount);
+        for (uint32 i = 0; i < IndexCount; i += 3)
+        {
+            const uint32 A = Canonical[Indices[i]], B = Canonical[Indices[i + 1]], C = Canonical[Indices[i + 2]];
+            if (A != B && B != C && C != A)
+            {
+                Result.insert(Result.end(), &Indices[i], &Indices[i + 3]);
+            }
+        }
+
+        FAdjacency Adjacency;
+        Adjacency.Build(Result.data(), static_cast<uint32>(Result.size()), Canonical);
+
+        // Classify vertices and link open borders (links hold the neighbor as indexed, i.e. its wedge)
+        std::vector<EVertexKind> Kind(VertexCount, EVertexKind::Locked);
+        std::vector<uint32> BorderNext(VertexCount, InvalidIndex);
+        std::vector<uint32> BorderPrev(VertexCount, InvalidIndex);
+        std::vector<uint8> OpenEdge(Result.size(), 0);    // Per corner: its edge to the next corner is open
+        {
+            std::vector<uint8> OpenOut(VertexCount, 0);
+            std::vector<uint8> OpenIn(VertexCount, 0);
+            for (uint32 i = 0; i < Result.size(); ++i)
+            {
+                const uint32 From = Result[i];
+                const uint32 To = Result[i - i % 3 + (i + 1) % 3];
+                if (!HasEdge(Adjacency, Result.data(), Canonical, Canonical[To], Canonical[From]))
+                {
+                    OpenEdge[i] = 1;
+                    const uint32 FromCanonical = Canonical[From], ToCanonical = Canonical[To];
+                    OpenOut[FromCanonical] = static_cast<uint8>(std::min(OpenOut[FromCanonical] + 1, 2));
+                    OpenIn[ToCanonical] = static_cast<uint8>(std::min(OpenIn[ToCanonical] + 1, 2));
+                    BorderNext[FromCanonical] = To;
+                    BorderPrev[ToCanonical] = From;
+                }
+            }
+
+            for (uint32 v = 0; v < VertexCount; ++v)
+            {
+                if (Canonical[v] != v || Seam[v])
+                {
+                    continue;
+                }
+                if (OpenOut[v] == 0 && OpenIn[v] == 0)
+                {
+                    Kind[v] = EVertexKind::Manifold;
+                }
+                else if (OpenOut[v] == 1 && OpenIn[v] == 1 && !bLockBorders)
+                {
+                    Kind[v] = EVertexKind::Border;
+                }
+            }
+        }
+
+        // Plane quadrics per canonical vertex: area-weighted faces plus border edge planes
+        std::vector<FQuadric> Quadrics(VertexCount);
+        for (uint32 i = 0; i < Result.size(); i += 3)
+        {
+            const uint32 Corners[3] = { Canonical[Result[i]], Canonical[Result[i + 1]], Canonical[Result[i + 2]] };
+            const float* P0 = &Scaled[Corners[0] * 3];
+            const float* P1 = &Scaled[Corners[1] * 3];
+            const float* P2 = &Scaled[Corners[2] * 3];
+
+            float Edge1[3], Edge2[3], Normal[3];
+            Subtract(P1, P0, Edge1);
+            Subtract(P2, P0, Edge2);
+            Cross(Edge1, Edge2, Normal);
+            const float Area = Normalize(Normal) * 0.5f;
+            const float Distance = -Dot(Normal, P0);
+
+            for (uint32 k = 0; k < 3; ++k)
+            {
+                Quadrics[Corners[k]].AddPlane(Normal, Distance, Area);
+            }
+
+            for (uint32 k = 0; k < 3; ++k)
+            {
+                if (!OpenEdge[i + k])
+                {
+                    continue;
+                }
+
+                const uint32 From = Corners[k], To = Corners[(k + 1) % 3];
+                float Edge[3], EdgeNormal[3];
+                Subtract(&Scaled[To * 3], &Scaled[From * 3], Edge);
+                Cross(Edge, Normal, EdgeNormal);
+                Normalize(EdgeNormal);
+                const float EdgeDistance = -Dot(EdgeNormal, &Scaled[From * 3]);
+                const float EdgeWeight = Dot(Edge, Edge) * BorderWeight;
+                Quadrics[From].AddPlane(EdgeNormal, EdgeDistance, EdgeWeight);
+                Quadrics[To].AddPlane(EdgeNormal, EdgeDistance, EdgeWeight);
+            }
+        }
+
+        const float ErrorLimit = QuadricLimit > 0.0f ? (QuadricLimit * InvScale) * (QuadricLimit * InvScale) : FLT_MAX;
+        float ResultError = 0.0f;
+
+        std::vector<FCollapse> Collapses;
+        Collapses.reserve(Result.size());
+        std::vector<uint32> Order;
+        std::vector<uint32> Remap(VertexCount);
+        for (uint32 v = 0; v < VertexCount; ++v)
+        {
+            Remap[v] = v;
+        }
+        std::vector<uint8> PassLocked(VertexCount, 0);
+        std::vector<uint32> Collapsed;
+
+        // Corners of a triangle with this pass's collapses applied (the adjacency is rebuilt between passes)
+        auto GetCorners = [&](uint32 Triangle, uint32* OutCorners)
+        {
+            const uint32* TriangleIndices = &Result[Triangle * 3];
+            OutCorners[0] = Canonical[Remap[TriangleIndices[0]]];
+            OutCorners[1] = Canonical[Remap[TriangleIndices[1]]];
+            OutCorners[2] = Canonical[Remap[TriangleIndices[2]]];
+            return OutCorners[0] != OutCorners[1] && OutCorners[1] != OutCorners[2] && OutCorners[2] != OutCorners[0];
+        };
+
+        // Link condition: the edge's only common neighbors are the apexes of its triangles,
+        // otherwise the collapse pinches the surface into duplicate or folded faces
+        std::vector<uint32> NeighborStamp(VertexCount, 0);
+        uint32 Stamp = 0;
+        auto IsLinkValid = [&](uint32 Vertex, uint32 Target)
+        {
+            Stamp += 2;
+            const uint32 NeighborMark = Stamp, ApexMark = Stamp + 1;
+            for (uint32 a = Adjacency.Offsets[Vertex]; a < Adjacency.Offsets[Vertex + 1]; ++a)
+            {
+                uint32 Corners[3];
+                if (!GetCorners(Adjacency.Triangles[a], Corners))
+                {
+                    continue;
+                }
+                const bool bShared = Corners[0] == Target || Corners[1] == Target || Corners[2] == Target;
+                for (uint32 Corner : Corners)
+                {
+                    if (NeighborStamp[Corner] != ApexMark)
+                    {
+                        NeighborStamp[Corner] = bShared ? ApexMark : NeighborMark;
+                    }
+                }
+            }
+            for (uint32 a = Adjacency.Offsets[Target]; a < Adjacency.Offsets[Target + 1]; ++a)
+            {
+                uint32 Corners[3];
+                if (!GetCorners(Adjacency.Triangles[a], Corners))
+                {
+                    continue;
+                }
+                for (uint32 Corner : Corners)
+                {
+                    if (Corner != Vertex && Corner != Target && NeighborStamp[Corner] == NeighborMark)
+                    {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        };
+
+        auto IsBorderEdge = [&](uint32 From, uint32 To)
+        {
+            return (Kind[From] == EVertexKind::Border && Canonical[BorderNext[From]] == To) ||
+                   (Kind[To] == EVertexKind::Border && Canonical[BorderPrev[To]] == From);
+        };
+
+        while (Result.size() > TargetIndexCount)
+        {
+            // Candidate collapses: interior edges once, border edges along the border only
+            Collapses.clear();
+            for (uint32 i = 0; i < Result.size(); ++i)
+            {
+                const uint32 A = Result[i];
+                const uint32 B = Result[i - i % 3 + (i + 1) % 3];
+                const uint32 CanonicalA = Canonical[A], CanonicalB = Canonical[B];
+
+                bool bAllowAB, bAllowBA;
+                if (IsBorderEdge(CanonicalA, CanonicalB))
+                {
+                    bAllowAB = Kind[CanonicalA] == EVertexKind::Border;
+                    bAllowBA = Kind[CanonicalB] == EVertexKind::Border;
+                }
+                else if (CanonicalA < CanonicalB)
+                {
+                    bAllowAB = Kind[CanonicalA] == EVertexKind::Manifold;
+                    bAllowBA = Kind[CanonicalB] == EVertexKind::Manifold;
+                }
+                else
+                {
+                    continue;
+                }
+
+                const float ErrorAB = bAllowAB ? Quadrics[CanonicalA].Evaluate(&Scaled[CanonicalB * 3]) : FLT_MAX;
+                const float ErrorBA = bAllowBA ? Quadrics[CanonicalB].Evaluate(&Scaled[CanonicalA * 3]) : FLT_MAX;
+                if (ErrorAB <= ErrorBA && bAllowAB)
+                {
+                    Collapses.push_back({ A, B, ErrorAB });
+                }
+                else if (bAllowBA)
+                {
+                    Collapses.push_back({ B, A, ErrorBA });
+                }
+            }
+
+            if (Collapses.empty())
+            {
+                break;
+            }
+
+            SortCollapses(Collapses, Order);
+
+            const uint32 TriangleGoal = static_cast<uint32>(Result.size() - TargetIndexCount) / 3;
+            const uint32 EdgeGoal = TriangleGoal / 2;
+            const float ErrorGoal = EdgeGoal < Order.size() ? PassErrorSlack * Collapses[Order[EdgeGoal]].Error : FLT_MAX;
+
+            uint32 RemovedTriangles = 0;
+            for (uint32 CollapseIndex : Order)
+            {
+                const FCollapse& Collapse = Collapses[CollapseIndex];
+                // The pass error goal only applies once a tenth of the pass goal is met
+                if (Collapse.Error > ErrorLimit || RemovedTriangles >= TriangleGoal ||
+                    (Collapse.Error > ErrorGoal && Collapse.Error > ResultError && RemovedTriangles > TriangleGoal / 10))
+                {
+                    break;
+                }
+
+                const uint32 Vertex = Collapse.Vertex;     // Canonical: collapsible vertices have one wedge
+                const uint32 Target = Canonical[Collapse.Target];
+                if (PassLocked[Vertex] || PassLocked[Target])
+                {
+                    continue;
+                }
+
+                // A border vertex between the same neighbor on both sides would close the border
+                if (Kind[Vertex] == EVertexKind::Border && Canonical[BorderNext[Vertex]] == Canonical[BorderPrev[Vertex]])
+                {
+                    continue;
+                }
+
+                // Reject collapses that flip or squash a remaining triangle
+                uint32 Removed = 0;
+                bool bFlipped = false;
+                for (uint32 a = Adjacency.Offsets[Vertex]; a < Adjacency.Offsets[Vertex + 1] && !bFlipped; ++a)
+                {
+                    uint32 Corners[3];
+                    if (!GetCorners(Adjacency.Triangles[a], Corners))
+                    {
+                        continue;
+                    }
+                    if (Corners[0] == Target || Corners[1] == Target || Corners[2] == Target)
+                    {
+                        ++Removed;
+                        continue;
+                    }
+
+                    float Before[3], After[3], Edge1[3], Edge2[3];
+                    Subtract(&Scaled[Corners[1] * 3], &Scaled[Corners[0] * 3], Edge1);
+                    Subtract(&Scaled[Corners[2] * 3], &Scaled[Corners[0] * 3], Edge2);
+                    Cross(Edge1, Edge2, Before);
+                    const float BeforeShape = Dot(Before, Before) / Square(Dot(Edge1, Edge1) + Dot(Edge2, Edge2));
+
+                    for (uint32& Corner : Corners)
+                    {
+                        Corner = Corner == Vertex ? Target : Corner;
+                    }
+                    Subtract(&Scaled[Corners[1] * 3], &Scaled[Corners[0] * 3], Edge1);
+                    Subtract(&Scaled[Corners[2] * 3], &Scaled[Corners[0] * 3], Edge2);
+                    Cross(Edge1, Edge2, After);
+                    const float AfterShape = Dot(After, After) / Square(Dot(Edge1, Edge1) + Dot(Edge2, Edge2));
+
+                    // Normal turns by more than ~75 degrees, or the triangle collapses into a line
+                    const float Alignment = Dot(Before, After);
+                    bFlipped = Alignment <= 0.0f || Alignment * Alignment < 0.0625f * Dot(Before, Before) * Dot(After, After) ||
+                               (AfterShape < MinTriangleShape && AfterShape < BeforeShape);
+                }
+                if (bFlipped || !IsLinkValid(Vertex, Target))
+                {
+                    continue;
+                }
+
+                Remap[Vertex] = Collapse.Target;
+                Collapsed.push_back(Vertex);
+                Quadrics[Target].Add(Quadrics[Vertex]);
+
+                if (Kind[Vertex] == EVertexKind::Border)
+                {
+                    // Splice the vertex out of its border
+                    const bool bTowardsNext = Canonical[BorderNext[Vertex]] == Target;
+                    const uint32 Prev = bTowardsNext ? BorderPrev[Vertex] : Collapse.Target;
+                    const uint32 Next = bTowardsNext ? Collapse.Target : BorderNext[Vertex];
+                    if (Kind[Canonical[Prev]] == EVertexKind::Border)
+                    {
+                        BorderNext[Canonical[Prev]] = Next;
+                    }
+                    if (Kind[Canonical[Next]] == EVertexKind::Border)
+                    {
+                        BorderPrev[Canonical[Next]] = Prev;
+                    }
+                }
+
+                PassLocked[Vertex] = 1;
+                PassLocked[Target] = 1;
+
+                ResultError = std::max(ResultError, Collapse.Error);
+                RemovedTriangles += Removed;
+            }
+
+            if (Collapsed.empty())
+            {
+                break;
+            }
+
+            // Apply the collapses and drop triangles that became degenerate
+            size_t Write = 0;
+            for (size_t i = 0; i < Result.size(); i += 3)
+            {
+                const uint32 A = Remap[Result[i]], B = Remap[Result[i + 1]], C = Remap[Result[i + 2]];
+                const uint32 CanonicalA = Canonical[A], CanonicalB = Canonical[B], CanonicalC = Canonical[C];
+                if (CanonicalA != CanonicalB && CanonicalB != CanonicalC && CanonicalC != CanonicalA)
+                {
+                    Result[Write++] = A;
+                    Result[Write++] = B;
+                    Result[Write++] = C;
+                }
+            }
+            Result.resize(Write);
+
+            for (uint32 Vertex : Collapsed)
+            {
+                Remap[Vertex] = Vertex;
+            }
+            Collapsed.clear();
+            std::fill(PassLocked.begin(), PassLocked.end(), static_cast<uint8>(0));
+
+            Adjacency.Build(Result.data(), static_cast<uint32>(Result.size()), Canonical);
+        }
+    }
+}
+
+namespace MeshSimplifier
+{
+    uint32 Simplify(uint32* Destination, const uint32* Indices, uint32 IndexCount,
+                    const float* Positions, uint32 VertexCount, uint32 PositionStride,
+                    uint32 TargetIndexCount, float TargetError, bool bLockBorders, float* OutError)
+    {
+        KE_PROFILE_FUNCTION();
+
+        IndexCount -= IndexCount % 3;
+
+        std::vector<uint32> Result;
+        CollapseEdges(Indices, IndexCount, Positions, VertexCount, PositionStride, TargetIndexCount, TargetError,
+                      bLockBorders, Result);
+
+        if (OutError || TargetError > 0.0f)
+        {
+            // The quadric error is only an estimate of the surface deviation, which can be about twice as large:
+            // tighten the collapse limit until the measured deviation fits the target
+            float Deviation = MeasureDeviation(Indices, IndexCount, Result, Positions, VertexCount, PositionStride);
+            float QuadricLimit = TargetError;
+            for (uint32 Attempt = 0; TargetError > 0.0f && Deviation > TargetError && Attempt < MaxLimitAttempts; ++Attempt)
+            {
+                QuadricLimit *= 0.9f * TargetError / Deviation;
+                CollapseEdges(Indices, IndexCount, Positions, VertexCount, PositionStride, TargetIndexCount, QuadricLimit,
+                              bLockBorders, Result);
+                Deviation = MeasureDeviation(Indices, IndexCount, Result, Positions, VertexCount, PositionStride);
+            }
+
+            if (TargetError > 0.0f && Deviation > TargetError)
+            {
+                Result.assign(Indices, Indices + IndexCount);
+                Deviation = 0.0f;
+            }
+            if (OutError)
+            {
+                *OutError = Deviation;
+            }
+        }
+
+        std::copy(Result.begin(), Result.end(), Destination);
+        return static_cast<uint32>(Result.size());
+    }
+
+    void GenerateLODs(const uint32* Indices, uint32 IndexCount,
+                      const float* Positions, uint32 VertexCount, uint32 PositionStride,
+                      const FMeshLODSettings& Settings, std::vector<uint32>& OutIndices, std::vector<FMeshLOD>& OutLODs,
+                      KJobSystem* JobSystem)
+    {
+        KE_PROFILE_FUNCTION();
+
+        IndexCount -= IndexCount % 3;
+        OutIndices.assign(Indices, Indices + IndexCount);
+        OutLODs.clear();
+
+        FMeshLOD BaseLOD;
+        BaseLOD.IndexCount = IndexCount;
+        BaseLOD.ScreenSize = FLT_MAX;
+        OutLODs.push_back(BaseLOD);
+
+        const uint32 LevelCount = static_cast<uint32>(
+            std::min<size_t>(Settings.TriangleRatios.size(), FMeshLODSettings::MaxLODs - 1));
+        if (LevelCount == 0 || IndexCount == 0)
+        {
+            return;
+        }
+
+        const float Radius = Bounds::ComputeSphere(Positions, VertexCount, PositionStride).Radius;
+        const float TargetError = Settings.MaxError * Radius;
+
+        // Independent levels: each is simplified from LOD 0 on its own thread
+        std::vector<std::vector<uint32>> LevelIndices(LevelCount);
+        std::vector<float> LevelErrors(LevelCount, 0.0f);
+        auto BuildLevel = [&](uint32 Level, uint32)
+        {
+            const float Ratio = std::min(std::max(Settings.TriangleRatios[Level], 0.0f), 1.0f);
+            const uint32 TargetIndexCount = static_cast<uint32>(static_cast<float>(IndexCount / 3) * Ratio) * 3;
+
+            std::vector<uint32>& Simplified = LevelIndices[Level];
+            Simplified.resize(IndexCount);
+            Simplified.resize(Simplify(Simplified.data(), Indices, IndexCount, Positions, VertexCount, PositionStride,
+                                       TargetIndexCount, TargetError, Settings.bLockBorders, &LevelErrors[Level]));
+
+            if (Settings.bOptimizeVertexCache && !Simplified.empty())
+            {
+                const uint32 Count = static_cast<uint32>(Simplified.size());
+                MeshOptimizer::OptimizeVertexCache(Simplified.data(), Simplified.data(), Count, VertexCount);
+                MeshOptimizer::OptimizeOverdraw(Simplified.data(), Simplified.data(), Count,
+                                                Positions, VertexCount, PositionStride);
+            }
+        };
+
+        if (JobSystem && LevelCount > 1)
+        {
+            JobSystem->ParallelFor(LevelCount, BuildLevel);
+        }
+        else
+        {
+            for (uint32 Level = 0; Level < LevelCount; ++Level)
+            {
+                BuildLevel(Level, 0);
+            }
+        }
+
+        // Keep levels that reduce enough; thresholds follow the error so they never grow
+        for (uint32 Level = 0; Level < LevelCount; ++Level)
+        {
+            const std::vector<uint32>& Simplified = LevelIndices[Level];
+            const FMeshLOD& Previous = OutLODs.back();
+            if (Simplified.empty() ||
+                static_cast<float>(Simplified.size()) > Settings.MinReduction * static_cast<float>(Previous.IndexCount))
+            {
+                continue;
+            }
+
+            FMeshLOD LOD;
+            LOD.FirstIndex = static_cast<uint32>(OutIndices.size());
+            LOD.IndexCount = static_cast<uint32>(Simplified.size());
+            LOD.Error = std::max(LevelErrors[Level], Previous.Error);
+            LOD.ScreenSize = LOD.Error > 0.0f ? 2.0f * Settings.ScreenError * Radius / LOD.Error : FLT_MAX;
+
+            OutIndices.insert(OutIndices.end(), Simplified.begin(), Simplified.end());
+            OutLODs.push_back(LOD);
+        }
+    }
+
+    uint32 SelectLOD(const FMeshLOD* LODs, uint32 LODCount, float ScreenSize)
+    {
+        uint32 Selected = 0;
+        for (uint32 i = 1; i < LODCount && ScreenSize <= LODs[i].ScreenSize; ++i)
+        {
+            Selected = i;
+        }
+        return Selected;
+    }
+}
@@ -0,0 +1,74 @@
+﻿#pragma once
+
+#include <vector>
+#include "../Utils/Types.h"
+
+class KJobSystem;
+
+// Quadric error edge-collapse simplification and LOD chain generation.
+// Platform independent. Vertices are never moved or created: collapses merge a
+// vertex into a neighbor, so every LOD indexes the source vertex buffer.
+
+/**
+ * @brief LOD chain generation settings
+ */
+struct FMeshLODSettings
+{
+    static constexpr uint32 MaxLODs = 8;
+
+    std::vector<float> TriangleRatios{ 0.5f, 0.25f, 0.125f };  // Target of each LOD after LOD 0, relative to LOD 0
+    float MaxError = 0.05f;             // Error limit relative to the mesh radius; a LOD stops short of its target there
+    float MinReduction = 0.9f;          // A LOD is dropped unless it has fewer than this ratio of the previous LOD's triangles
+    float ScreenError = 1.0f / 1080.0f; // Tolerated projected error as a fraction of the view height
+    bool bLockBorders = false;          // Keep open mesh borders intact
+    bool bOptimizeVertexCache = true;   // Run the vertex cache and overdraw passes on each generated LOD
+};
+
+/**
+ * @brief One level of a LOD chain (a range of the shared index buffer)
+ */
+struct FMeshLOD
+{
+    uint32 FirstIndex = 0;
+    uint32 IndexCount = 0;
+    float Error = 0.0f;                 // Largest object-space distance from a LOD 0 vertex to this LOD
+    float ScreenSize = 0.0f;            // Largest screen size (projected diameter / view height) the LOD is used at
+};
+
+namespace MeshSimplifier
+{
+    /**
+     * @brief Simplify a triangle list by quadric error edge collapses
+     *
+     * Vertices sharing a position with different attributes (seams) and
+     * non-manifold vertices are kept; border vertices only slide along the border.
+     * @param Destination Output indices (at least IndexCount entries, may equal Indices)
+     * @param Positions First position (3 floats)
+     * @param PositionStride Byte distance between positions
+     * @param TargetIndexCount Index count to reduce to
+     * @param TargetError Largest object-space error allowed (as reported in OutError), 0 for no limit;
+     *                    the source triangles are returned if it cannot be met
+     * @param OutError Object-space error of the result (optional): the largest distance from
+     *                 a source vertex to the simplified surface, measured after collapsing
+     * @return Resulting index count
+     */
+    uint32 Simplify(uint32* Destination, const uint32* Indices, uint32 IndexCount,
+                    const float* Positions, uint32 VertexCount, uint32 PositionStride,
+                    uint32 TargetIndexCount, float TargetError, bool bLockBorders = false, float* OutError = nullptr);
+
+    /**
+     * @brief Build a LOD chain; each LOD is simplified from LOD 0 in parallel
+     * @param OutIndices Indices of every LOD, LOD 0 (a copy of Indices) first
+     * @param OutLODs Index ranges, errors and screen size thresholds, finest first
+     * @param JobSystem Worker pool, nullptr to simplify on the calling thread
+     */
+    void GenerateLODs(const uint32* Indices, uint32 IndexCount,
+                      const float* Positions, uint32 VertexCount, uint32 PositionStride,
+                      const FMeshLODSettings& Settings, std::vector<uint32>& OutIndices, std::vector<FMeshLOD>& OutLODs,
+                      KJobSystem* JobSystem = nullptr);
+
+    /**
+     * @brief Coarsest LOD whose screen size threshold covers a screen size
+     */
+    uint32 SelectLOD(const FMeshLOD* LODs, uint32 LODCount, float ScreenSize);
+}
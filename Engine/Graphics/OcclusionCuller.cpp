@@ -0,0 +1,783 @@
+﻿#include "OcclusionCuller.h"
+#include "FrustumCuller.h"
+#include "../Core/JobSystem.h"
+#include "../Core/Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX__)
+    #include <immintrin.h>
+    #define KE_OCCLUSION_AVX 1
+    #define KE_OCCLUSION_SSE 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define KE_OCCLUSION_SSE 1
+#endif
+
+namespace
+{
+    // Pyramid levels built inside a tile's job (the tile stays a whole number of texels)
+    constexpr uint32 TileLevelCount = 4;
+    static_assert((KOcclusionCuller::TileHeight >> TileLevelCount) >= 1 &&
+                  (KOcclusionCuller::TileWidth >> TileLevelCount) >= 1, "Tile levels must stay inside a tile");
+    static_assert(KOcclusionCuller::TileWidth % 8 == 0, "Tile rows are rasterized in whole SIMD vectors");
+
+    // Boxes per job when occludees are tested in parallel
+    constexpr uint32 CullChunkSize = 1024;
+
+    // Clip-space outcodes
+    constexpr uint32 OutsideLeft = 1u << 0;
+    constexpr uint32 OutsideRight = 1u << 1;
+    constexpr uint32 OutsideBottom = 1u << 2;
+    constexpr uint32 OutsideTop = 1u << 3;
+    constexpr uint32 OutsideNear = 1u << 4;
+    constexpr uint32 OutsideFar = 1u << 5;
+
+    uint32 ComputeOutcode(const float* Clip)
+    {
+        const float W = Clip[3];
+        return (Clip[0] < -W ? OutsideLeft : 0u) | (Clip[0] > W ? OutsideRight : 0u) |
+               (Clip[1] < -W ? OutsideBottom : 0u) | (Clip[1] > W ? OutsideTop : 0u) |
+               (Clip[2] < 0.0f ? OutsideNear : 0u) | (Clip[2] > W ? OutsideFar : 0u);
+    }
+
+    // Out = A * B (row vectors, so A is applied first)
+    void MultiplyMatrix(const float A[16], const float B[16], float Out[16])
+    {
+        for (uint32 Row = 0; Row < 4; ++Row)
+        {
+            for (uint32 Column = 0; Column < 4; ++Column)
+            {
+                Out[Row * 4 + Column] = A[Row * 4 + 0] * B[0 * 4 + Column] + A[Row * 4 + 1] * B[1 * 4 + Column] +
+                                        A[Row * 4 + 2] * B[2 * 4 + Column] + A[Row * 4 + 3] * B[3 * 4 + Column];
+            }
+        }
+    }
+
+    inline float Clamp(float Value, float Min, float Max)
+    {
+        return Value < Min ? Min : (Value > Max ? Max : Value);
+    }
+
+#if defined(KE_OCCLUSION_SSE)
+    inline float HorizontalMin(__m128 Value)
+    {
+        Value = _mm_min_ps(Value, _mm_shuffle_ps(Value, Value, _MM_SHUFFLE(1, 0, 3, 2)));
+        Value = _mm_min_ps(Value, _mm_shuffle_ps(Value, Value, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtss_f32(Value);
+    }
+
+    inline float HorizontalMax(__m128 Value)
+    {
+        Value = _mm_max_ps(Value, _mm_shuffle_ps(Value, Value, _MM_SHUFFLE(1, 0, 3, 2)));
+        Value = _mm_max_ps(Value, _mm_shuffle_ps(Value, Value, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtss_f32(Value);
+    }
+#endif
+}
+
+void KOcclusionCuller::Initialize(const FOcclusionCullerSettings& InSettings)
+{
+    TilesX = (std::max(InSettings.Width, 1u) + TileWidth - 1) / TileWidth;
+    TilesY = (std::max(InSettings.Height, 1u) + TileHeight - 1) / TileHeight;
+    Width = TilesX * TileWidth;
+    Height = TilesY * TileHeight;
+
+    // Level 0 is the depth buffer; every further level halves it (rounding up) down to 1 x 1
+    Levels.clear();
+    uint32 LevelWidth = Width;
+    uint32 LevelHeight = Height;
+    for (;;)
+    {
+        FLevel Level;
+        Level.Width = LevelWidth;
+        Level.Height = LevelHeight;
+        Level.Depth.assign(static_cast<size_t>(LevelWidth) * LevelHeight, 1.0f);
+        Levels.push_back(std::move(Level));
+
+        if (LevelWidth == 1 && LevelHeight == 1)
+        {
+            break;
+        }
+        LevelWidth = (LevelWidth + 1) / 2;
+        LevelHeight = (LevelHeight + 1) / 2;
+    }
+
+    for (FBinner& Binner : Binners)
+    {
+        Binner.TileBins.assign(static_cast<size_t>(TilesX) * TilesY, std::vector<uint32>());
+    }
+
+    Occluders.clear();
+    bRasterized = false;
+    Stats = FOcclusionStats();
+}
+
+void KOcclusionCuller::Reset()
+{
+    Width = 0;
+    Height = 0;
+    TilesX = 0;
+    TilesY = 0;
+    std::fill(ViewProjection, ViewProjection + 16, 0.0f);
+    bRasterized = false;
+
+    Occluders.clear();
+    Binners.clear();
+    Levels.clear();
+    VisibleFlags.clear();
+    Stats = FOcclusionStats();
+}
+
+void KOcclusionCuller::BeginFrame(const float InViewProjection[16])
+{
+    std::copy(InViewProjection, InViewProjection + 16, ViewProjection);
+    Bounds::ExtractFrustumPlanes(ViewProjection, ViewFrustum);
+
+    Occluders.clear();
+    bRasterized = false;
+    Stats = FOcclusionStats();
+}
+
+void KOcclusionCuller::AddOccluder(const FOccluderMesh& Mesh, const float WorldMatrix[16])
+{
+    if (Levels.empty() || Mesh.Positions.empty() || Mesh.Indices.size() < 3)
+    {
+        return;
+    }
+
+    if (!Bounds::Intersects(ViewFrustum, Bounds::TransformBox(Mesh.Bounds, WorldMatrix)))
+    {
+        return;
+    }
+
+    FOccluder Occluder;
+    Occluder.Mesh = &Mesh;
+    MultiplyMatrix(WorldMatrix, ViewProjection, Occluder.WorldViewProjection);
+    Occluders.push_back(Occluder);
+}
+
+void KOcclusionCuller::Rasterize(KJobSystem* JobSystem)
+{
+    KE_PROFILE_FUNCTION();
+
+    if (Levels.empty())
+    {
+        return;
+    }
+
+    const uint32 ThreadCount = JobSystem ? JobSystem->GetThreadCount() : 1;
+    if (Binners.size() < ThreadCount)
+    {
+        Binners.resize(ThreadCount);
+    }
+
+    const uint32 TileCount = TilesX * TilesY;
+    for (FBinner& Binner : Binners)
+    {
+        Binner.Triangles.clear();
+        Binner.TileBins.resize(TileCount);
+        for (std::vector<uint32>& Bin : Binner.TileBins)
+        {
+            Bin.clear();
+        }
+    }
+
+    // Transform, clip and bin: each thread bins into its own lists, so no locking
+    const uint32 OccluderCount = GetOccluderCount();
+    if (JobSystem && ThreadCount > 1 && OccluderCount > 1)
+    {
+        JobSystem->ParallelFor(OccluderCount, [this](uint32 Index, uint32 WorkerIndex)
+        {
+            SetupOccluder(Occluders[Index], Binners[WorkerIndex]);
+        });
+    }
+    else
+    {
+        for (const FOccluder& Occluder : Occluders)
+        {
+            SetupOccluder(Occluder, Binners[0]);
+        }
+    }
+
+    // Each tile owns its pixels: rasterize and reduce them on one job
+    if (JobSystem && ThreadCount > 1)
+    {
+        JobSystem->ParallelFor(TileCount, [this, ThreadCount](uint32 Tile, uint32)
+        {
+            RasterizeTile(Tile, ThreadCount);
+        });
+    }
+    else
+    {
+        for (uint32 Tile = 0; Tile < TileCount; ++Tile)
+        {
+            RasterizeTile(Tile, ThreadCount);
+        }
+    }
+
+    BuildUpperLevels();
+
+    Stats.OccluderCount = OccluderCount;
+    Stats.TriangleCount = 0;
+    for (uint32 i = 0; i < ThreadCount; ++i)
+    {
+        Stats.TriangleCount += static_cast<uint32>(Binners[i].Triangles.size());
+    }
+    bRasterized = true;
+}
+
+void KOcclusionCuller::SetupOccluder(const FOccluder& Occluder, FBinner& Binner)
+{
+    const FOccluderMesh& Mesh = *Occluder.Mesh;
+    const float* Matrix = Occluder.WorldViewProjection;
+    const uint32 VertexCount = static_cast<uint32>(Mesh.Positions.size() / 3);
+
+    Binner.ClipPositions.resize(static_cast<size_t>(VertexCount) * 4);
+    Binner.ScreenPositions.resize(static_cast<size_t>(VertexCount) * 3);
+    Binner.Outcodes.resize(VertexCount);
+    float* Clip = Binner.ClipPositions.data();
+    const float* Position = Mesh.Positions.data();
+
+#if defined(KE_OCCLUSION_SSE)
+    // Clip = x * Row0 + y * Row1 + z * Row2 + Row3, one vertex per register
+    const __m128 Row0 = _mm_loadu_ps(Matrix + 0);
+    const __m128 Row1 = _mm_loadu_ps(Matrix + 4);
+    const __m128 Row2 = _mm_loadu_ps(Matrix + 8);
+    const __m128 Row3 = _mm_loadu_ps(Matrix + 12);
+    for (uint32 i = 0; i < VertexCount; ++i, Position += 3)
+    {
+        __m128 Result = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(Position[0]), Row0), Row3);
+        Result = _mm_add_ps(Result, _mm_mul_ps(_mm_set1_ps(Position[1]), Row1));
+        Result = _mm_add_ps(Result, _mm_mul_ps(_mm_set1_ps(Position[2]), Row2));
+        _mm_storeu_ps(Clip + i * 4, Result);
+    }
+#else
+    for (uint32 i = 0; i < VertexCount; ++i, Position += 3)
+    {
+        for (uint32 Column = 0; Column < 4; ++Column)
+        {
+            Clip[i * 4 + Column] = Position[0] * Matrix[Column] + Position[1] * Matrix[4 + Column] +
+                                   Position[2] * Matrix[8 + Column] + Matrix[12 + Column];
+        }
+    }
+#endif
+
+    // Vertices in front of the near plane are projected once, not per triangle
+    for (uint32 i = 0; i < VertexCount; ++i)
+    {
+        Binner.Outcodes[i] = static_cast<uint8>(ComputeOutcode(Clip + i * 4));
+        if ((Binner.Outcodes[i] & OutsideNear) == 0)
+        {
+            ProjectVertex(Clip + i * 4, &Binner.ScreenPositions[i * 3]);
+        }
+    }
+
+    const uint32* Indices = Mesh.Indices.data();
+    const size_t IndexCount = Mesh.Indices.size() - Mesh.Indices.size() % 3;
+    for (size_t i = 0; i < IndexCount; i += 3)
+    {
+        const uint32 I0 = Indices[i];
+        const uint32 I1 = Indices[i + 1];
+        const uint32 I2 = Indices[i + 2];
+        if (I0 >= VertexCount || I1 >= VertexCount || I2 >= VertexCount)
+        {
+            continue;
+        }
+
+        const uint32 Outcode0 = Binner.Outcodes[I0];
+        const uint32 Outcode1 = Binner.Outcodes[I1];
+        const uint32 Outcode2 = Binner.Outcodes[I2];
+
+        // Entirely outside one plane
+        if ((Outcode0 & Outcode1 & Outcode2) != 0)
+        {
+            continue;
+        }
+
+        if (((Outcode0 | Outcode1 | Outcode2) & OutsideNear) != 0)
+        {
+            ClipTriangle(Clip + I0 * 4, Clip + I1 * 4, Clip + I2 * 4, Mesh.bTwoSided, Binner);
+        }
+        else
+        {
+            const float* Screen = Binner.ScreenPositions.data();
+            BinTriangle(Screen + I0 * 3, Screen + I1 * 3, Screen + I2 * 3, Mesh.bTwoSided, Binner);
+        }
+    }
+}
+
+void KOcclusionCuller::ProjectVertex(const float* Clip, float* OutScreen) const
+{
+    // Pixel coordinates (y down) and depth
+    const float InvW = 1.0f / Clip[3];
+    OutScreen[0] = (Clip[0] * InvW * 0.5f + 0.5f) * static_cast<float>(Width);
+    OutScreen[1] = (0.5f - Clip[1] * InvW * 0.5f) * static_cast<float>(Height);
+    OutScreen[2] = Clip[2] * InvW;
+}
+
+void KOcclusionCuller::ClipTriangle(const float* V0, const float* V1, const float* V2, bool bTwoSided, FBinner& Binner)
+{
+    // Clip against the near plane (z >= 0): a triangle becomes at most a quad
+    const float* Input[3] = { V0, V1, V2 };
+    float Output[4][4];
+    uint32 OutputCount = 0;
+
+    for (uint32 i = 0; i < 3; ++i)
+    {
+        const float* A = Input[i];
+        const float* B = Input[(i + 1) % 3];
+        const bool bInsideA = A[2] >= 0.0f;
+        const bool bInsideB = B[2] >= 0.0f;
+
+        if (bInsideA)
+        {
+            std::copy(A, A + 4, Output[OutputCount++]);
+        }
+        if (bInsideA != bInsideB)
+        {
+            const float T = A[2] / (A[2] - B[2]);
+            for (uint32 Component = 0; Component < 4; ++Component)
+            {
+                Output[OutputCount][Component] = A[Component] + (B[Component] - A[Component]) * T;
+            }
+            Output[OutputCount++][2] = 0.0f;
+        }
+    }
+
+    float Screen[4][3];
+    for (uint32 i = 0; i < OutputCount; ++i)
+    {
+        if (!(Output[i][3] > 0.0f))
+        {
+            return;
+        }
+        ProjectVertex(Output[i], Screen[i]);
+    }
+
+    for (uint32 i = 1; i + 1 < OutputCount; ++i)
+    {
+        BinTriangle(Screen[0], Screen[i], Screen[i + 1], bTwoSided, Binner);
+    }
+}
+
+void KOcclusionCuller::BinTriangle(const float* S0, const float* S1, const float* S2, bool bTwoSided, FBinner& Binner)
+{
+    const float X[3] = { S0[0], S1[0], S2[0] };
+    const float Y[3] = { S0[1], S1[1], S2[1] };
+    const float Z[3] = { S0[2], S1[2], S2[2] };
+
+    // Positive for clockwise triangles on screen (Direct3D's default front face)
+    const float Area = (X[1] - X[0]) * (Y[2] - Y[0]) - (X[2] - X[0]) * (Y[1] - Y[0]);
+    if (!(std::fabs(Area) > 1e-6f) || (!bTwoSided && Area < 0.0f))
+    {
+        return;
+    }
+
+    // Pixels whose centers lie in the triangle's bounds
+    const float MinX = Clamp(std::min(X[0], std::min(X[1], X[2])) - 0.5f, 0.0f, static_cast<float>(Width));
+    const float MaxX = Clamp(std::max(X[0], std::max(X[1], X[2])) - 0.5f, -1.0f, static_cast<float>(Width - 1));
+    const float MinY = Clamp(std::min(Y[0], std::min(Y[1], Y[2])) - 0.5f, 0.0f, static_cast<float>(Height));
+    const float MaxY = Clamp(std::max(Y[0], std::max(Y[1], Y[2])) - 0.5f, -1.0f, static_cast<float>(Height - 1));
+
+    const int32 FirstX = static_cast<int32>(std::ceil(MinX));
+    const int32 LastX = static_cast<int32>(std::floor(MaxX));
+    const int32 FirstY = static_cast<int32>(std::ceil(MinY));
+    const int32 LastY = static_cast<int32>(std::floor(MaxY));
+    if (FirstX > LastX || FirstY > LastY)
+    {
+        return;
+    }
+
+    FTriangle Triangle;
+    Triangle.MinX = static_cast<uint16>(FirstX);
+    Triangle.MaxX = static_cast<uint16>(LastX);
+    Triangle.MinY = static_cast<uint16>(FirstY);
+    Triangle.MaxY = static_cast<uint16>(LastY);
+
+    // Edge functions are positive inside for either winding
+    const float Sign = Area > 0.0f ? 1.0f : -1.0f;
+    for (uint32 i = 0; i < 3; ++i)
+    {
+        const uint32 Next = (i + 1) % 3;
+        const float DX = X[Next] - X[i];
+        const float DY = Y[Next] - Y[i];
+        Triangle.EdgeA[i] = -DY * Sign;
+        Triangle.EdgeB[i] = DX * Sign;
+        Triangle.EdgeC[i] = (DY * X[i] - DX * Y[i]) * Sign;
+    }
+
+    // Depth is linear in screen space
+    const float InvArea = 1.0f / Area;
+    Triangle.DepthA = ((Z[1] - Z[0]) * (Y[2] - Y[0]) - (Z[2] - Z[0]) * (Y[1] - Y[0])) * InvArea;
+    Triangle.DepthB = ((X[1] - X[0]) * (Z[2] - Z[0]) - (X[2] - X[0]) * (Z[1] - Z[0])) * InvArea;
+    Triangle.DepthC = Z[0] - Triangle.DepthA * X[0] - Triangle.DepthB * Y[0];
+
+    const uint32 TriangleIndex = static_cast<uint32>(Binner.Triangles.size());
+    Binner.Triangles.push_back(Triangle);
+
+    for (uint32 TileY = Triangle.MinY / TileHeight; TileY <= Triangle.MaxY / TileHeight; ++TileY)
+    {
+        for (uint32 TileX = Triangle.MinX / TileWidth; TileX <= Triangle.MaxX / TileWidth; ++TileX)
+        {
+            Binner.TileBins[TileY * TilesX + TileX].push_back(TriangleIndex);
+        }
+    }
+}
+
+void KOcclusionCuller::RasterizeTile(uint32 Tile, uint32 BinnerCount)
+{
+    const uint32 TileMinX = (Tile % TilesX) * TileWidth;
+    const uint32 TileMinY = (Tile / TilesX) * TileHeight;
+    const uint32 TileMaxX = TileMinX + TileWidth - 1;
+    const uint32 TileMaxY = TileMinY + TileHeight - 1;
+    float* Depth = Levels[0].Depth.data();
+
+    for (uint32 Y = TileMinY; Y <= TileMaxY; ++Y)
+    {
+        std::fill(Depth + static_cast<size_t>(Y) * Width + TileMinX, Depth + static_cast<size_t>(Y) * Width + TileMaxX + 1, 1.0f);
+    }
+
+#if defined(KE_OCCLUSION_AVX)
+    constexpr uint32 SimdWidth = 8;
+    const __m256 LaneOffsets = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+    const __m256 Zero = _mm256_setzero_ps();
+#elif defined(KE_OCCLUSION_SSE)
+    constexpr uint32 SimdWidth = 4;
+    const __m128 LaneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    const __m128 Zero = _mm_setzero_ps();
+#endif
+
+    for (uint32 BinnerIndex = 0; BinnerIndex < BinnerCount; ++BinnerIndex)
+    {
+        const FBinner& Binner = Binners[BinnerIndex];
+        for (uint32 TriangleIndex : Binner.TileBins[Tile])
+        {
+            const FTriangle& Triangle = Binner.Triangles[TriangleIndex];
+            const uint32 MinX = std::max<uint32>(Triangle.MinX, TileMinX);
+            const uint32 MaxX = std::min<uint32>(Triangle.MaxX, TileMaxX);
+            const uint32 MinY = std::max<uint32>(Triangle.MinY, TileMinY);
+            const uint32 MaxY = std::min<uint32>(Triangle.MaxY, TileMaxY);
+
+#if defined(KE_OCCLUSION_AVX) || defined(KE_OCCLUSION_SSE)
+            // Whole vectors from the aligned column at or before MinX (the tile width is a multiple)
+            const uint32 FirstX = TileMinX + ((MinX - TileMinX) & ~(SimdWidth - 1));
+#if defined(KE_OCCLUSION_AVX)
+            const __m256 A0 = _mm256_set1_ps(Triangle.EdgeA[0]);
+            const __m256 A1 = _mm256_set1_ps(Triangle.EdgeA[1]);
+            const __m256 A2 = _mm256_set1_ps(Triangle.EdgeA[2]);
+            const __m256 DepthA = _mm256_set1_ps(Triangle.DepthA);
+#else
+            const __m128 A0 = _mm_set1_ps(Triangle.EdgeA[0]);
+            const __m128 A1 = _mm_set1_ps(Triangle.EdgeA[1]);
+            const __m128 A2 = _mm_set1_ps(Triangle.EdgeA[2]);
+            const __m128 DepthA = _mm_set1_ps(Triangle.DepthA);
+#endif
+            for (uint32 Y = MinY; Y <= MaxY; ++Y)
+            {
+                const float PixelY = static_cast<float>(Y) + 0.5f;
+                float* Row = Depth + static_cast<size_t>(Y) * Width;
+#if defined(KE_OCCLUSION_AVX)
+                const __m256 Row0 = _mm256_set1_ps(Triangle.EdgeB[0] * PixelY + Triangle.EdgeC[0]);
+                const __m256 Row1 = _mm256_set1_ps(Triangle.EdgeB[1] * PixelY + Triangle.EdgeC[1]);
+                const __m256 Row2 = _mm256_set1_ps(Triangle.EdgeB[2] * PixelY + Triangle.EdgeC[2]);
+                const __m256 RowDepth = _mm256_set1_ps(Triangle.DepthB * PixelY + Triangle.DepthC);
+                for (uint32 X = FirstX; X <= MaxX; X += SimdWidth)
+                {
+                    const __m256 PixelX = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(X)), LaneOffsets);
+                    const __m256 Edge0 = _mm256_add_ps(_mm256_mul_ps(A0, PixelX), Row0);
+                    const __m256 Edge1 = _mm256_add_ps(_mm256_mul_ps(A1, PixelX), Row1);
+                    const __m256 Edge2 = _mm256_add_ps(_mm256_mul_ps(A2, PixelX), Row2);
+
+                    // Outside where any edge function is negative; those lanes keep the old depth
+                    const __m256 Outside = _mm256_cmp_ps(_mm256_min_ps(_mm256_min_ps(Edge0, Edge1), Edge2), Zero, _CMP_LT_OQ);
+                    const __m256 PixelDepth = _mm256_add_ps(_mm256_mul_ps(DepthA, PixelX), RowDepth);
+                    const __m256 OldDepth = _mm256_loadu_ps(Row + X);
+                    const __m256 NewDepth = _mm256_min_ps(OldDepth, PixelDepth);
+                    _mm256_storeu_ps(Row + X, _mm256_or_ps(_mm256_and_ps(Outside, OldDepth), _mm256_andnot_ps(Outside, NewDepth)));
+                }
+#else
+                const __m128 Row0 = _mm_set1_ps(Triangle.EdgeB[0] * PixelY + Triangle.EdgeC[0]);
+                const __m128 Row1 = _mm_set1_ps(Triangle.EdgeB[1] * PixelY + Triangle.EdgeC[1]);
+                const __m128 Row2 = _mm_set1_ps(Triangle.EdgeB[2] * PixelY + Triangle.EdgeC[2]);
+                const __m128 RowDepth = _mm_set1_ps(Triangle.DepthB * PixelY + Triangle.DepthC);
+                for (uint32 X = FirstX; X <= MaxX; X += SimdWidth)
+                {
+                    const __m128 PixelX = _mm_add_ps(_mm_set1_ps(static_cast<float>(X)), LaneOffsets);
+                    const __m128 Edge0 = _mm_add_ps(_mm_mul_ps(A0, PixelX), Row0);
+                    const __m128 Edge1 = _mm_add_ps(_mm_mul_ps(A1, PixelX), Row1);
+                    const __m128 Edge2 = _mm_add_ps(_mm_mul_ps(A2, PixelX), Row2);
+
+                    // Outside where any edge function is negative; those lanes keep the old depth
+                    const __m128 Outside = _mm_cmplt_ps(_mm_min_ps(_mm_min_ps(Edge0, Edge1), Edge2), Zero);
+                    const __m128 PixelDepth = _mm_add_ps(_mm_mul_ps(DepthA, PixelX), RowDepth);
+                    const __m128 OldDepth = _mm_loadu_ps(Row + X);
+                    const __m128 NewDepth = _mm_min_ps(OldDepth, PixelDepth);
+                    _mm_storeu_ps(Row + X, _mm_or_ps(_mm_and_ps(Outside, OldDepth), _mm_andnot_ps(Outside, NewDepth)));
+                }
+#endif
+            }
+#else
+            for (uint32 Y = MinY; Y <= MaxY; ++Y)
+            {
+                const float PixelY = static_cast<float>(Y) + 0.5f;
+                float* Row = Depth + static_cast<size_t>(Y) * Width;
+                for (uint32 X = MinX; X <= MaxX; ++X)
+                {
+                    const float PixelX = static_cast<float>(X) + 0.5f;
+                    bool bInside = true;
+                    for (uint32 Edge = 0; Edge < 3; ++Edge)
+                    {
+                        bInside &= Triangle.EdgeA[Edge] * PixelX + Triangle.EdgeB[Edge] * PixelY + Triangle.EdgeC[Edge] >= 0.0f;
+                    }
+                    if (bInside)
+                    {
+                        const float PixelDepth = Triangle.DepthA * PixelX + Triangle.DepthB * PixelY + Triangle.DepthC;
+                        Row[X] = PixelDepth < Row[X] ? PixelDepth : Row[X];
+                    }
+                }
+            }
+#endif
+        }
+    }
+
+    // Reduce the tile's own part of the first pyramid levels
+    for (uint32 LevelIndex = 1; LevelIndex <= TileLevelCount && LevelIndex < Levels.size(); ++LevelIndex)
+    {
+        const FLevel& Source = Levels[LevelIndex - 1];
+        FLevel& Target = Levels[LevelIndex];
+        const uint32 MinX = TileMinX >> LevelIndex;
+        const uint32 MinY = TileMinY >> LevelIndex;
+        const uint32 MaxX = (TileMaxX + 1) >> LevelIndex;
+        const uint32 MaxY = (TileMaxY + 1) >> LevelIndex;
+        for (uint32 Y = MinY; Y < MaxY; ++Y)
+        {
+            const float* Source0 = Source.Depth.data() + static_cast<size_t>(Y * 2) * Source.Width;
+            const float* Source1 = Source0 + Source.Width;
+            float* Output = Target.Depth.data() + static_cast<size_t>(Y) * Target.Width;
+            for (uint32 X = MinX; X < MaxX; ++X)
+            {
+                Output[X] = std::max(std::max(Source0[X * 2], Source0[X * 2 + 1]), std::max(Source1[X * 2], Source1[X * 2 + 1]));
+            }
+        }
+    }
+}
+
+void KOcclusionCuller::BuildUpperLevels()
+{
+    for (size_t LevelIndex = TileLevelCount + 1; LevelIndex < Levels.size(); ++LevelIndex)
+    {
+        const FLevel& Source = Levels[LevelIndex - 1];
+        FLevel& Target = Levels[LevelIndex];
+        for (uint32 Y = 0; Y < Target.Height; ++Y)
+        {
+            // Odd sizes: the last texel covers a single source row / column
+            const float* Source0 = Source.Depth.data() + static_cast<size_t>(Y * 2) * Source.Width;
+            const float* Source1 = Y * 2 + 1 < Source.Height ? Source0 + Source.Width : Source0;
+            float* Output = Target.Depth.data() + static_cast<size_t>(Y) * Target.Width;
+            for (uint32 X = 0; X < Target.Width; ++X)
+            {
+                const uint32 X1 = X * 2 + 1 < Source.Width ? X * 2 + 1 : X * 2;
+                Output[X] = std::max(std::max(Source0[X * 2], Source0[X1]), std::max(Source1[X * 2], Source1[X1]));
+            }
+        }
+    }
+}
+
+bool KOcclusionCuller::IsBoxVisible(const FBoundingBox& WorldBox) const
+{
+    if (!bRasterized)
+    {
+        return true;
+    }
+
+    // Clip-space center and half axes; corners are the center plus or minus each axis
+    float Center[4], AxisX[4], AxisY[4], AxisZ[4];
+    for (uint32 Column = 0; Column < 4; ++Column)
+    {
+        Center[Column] = WorldBox.Center[0] * ViewProjection[Column] + WorldBox.Center[1] * ViewProjection[4 + Column] +
+                         WorldBox.Center[2] * ViewProjection[8 + Column] + ViewProjection[12 + Column];
+        AxisX[Column] = WorldBox.Extents[0] * ViewProjection[Column];
+        AxisY[Column] = WorldBox.Extents[1] * ViewProjection[4 + Column];
+        AxisZ[Column] = WorldBox.Extents[2] * ViewProjection[8 + Column];
+    }
+
+    float MinX, MinY, MaxX, MaxY, NearestDepth;
+#if defined(KE_OCCLUSION_SSE)
+    // Corners 0 - 3 in one register, 4 - 7 (the +z half) in the other
+    const __m128 SignX = _mm_setr_ps(-1.0f, 1.0f, -1.0f, 1.0f);
+    const __m128 SignY = _mm_setr_ps(-1.0f, -1.0f, 1.0f, 1.0f);
+    __m128 Low[4], High[4];
+    for (uint32 Column = 0; Column < 4; ++Column)
+    {
+        const __m128 Corner = _mm_add_ps(_mm_mul_ps(SignX, _mm_set1_ps(AxisX[Column])),
+                                         _mm_mul_ps(SignY, _mm_set1_ps(AxisY[Column])));
+        Low[Column] = _mm_add_ps(Corner, _mm_set1_ps(Center[Column] - AxisZ[Column]));
+        High[Column] = _mm_add_ps(Corner, _mm_set1_ps(Center[Column] + AxisZ[Column]));
+    }
+
+    // Reaches the near plane: cannot be bounded on screen
+    const __m128 Zero = _mm_setzero_ps();
+    const __m128 Behind = _mm_or_ps(_mm_or_ps(_mm_cmplt_ps(Low[2], Zero), _mm_cmplt_ps(High[2], Zero)),
+                                    _mm_or_ps(_mm_cmpngt_ps(Low[3], Zero), _mm_cmpngt_ps(High[3], Zero)));
+    if (_mm_movemask_ps(Behind) != 0)
+    {
+        return true;
+    }
+
+    const __m128 InvWLow = _mm_div_ps(_mm_set1_ps(1.0f), Low[3]);
+    const __m128 InvWHigh = _mm_div_ps(_mm_set1_ps(1.0f), High[3]);
+    const __m128 X0 = _mm_mul_ps(Low[0], InvWLow);
+    const __m128 X1 = _mm_mul_ps(High[0], InvWHigh);
+    const __m128 Y0 = _mm_mul_ps(Low[1], InvWLow);
+    const __m128 Y1 = _mm_mul_ps(High[1], InvWHigh);
+    const __m128 Z0 = _mm_mul_ps(Low[2], InvWLow);
+    const __m128 Z1 = _mm_mul_ps(High[2], InvWHigh);
+    MinX = HorizontalMin(_mm_min_ps(X0, X1));
+    MaxX = HorizontalMax(_mm_max_ps(X0, X1));
+    MinY = HorizontalMin(_mm_min_ps(Y0, Y1));
+    MaxY = HorizontalMax(_mm_max_ps(Y0, Y1));
+    NearestDepth = HorizontalMin(_mm_min_ps(Z0, Z1));
+#else
+    MinX = MinY = NearestDepth = 1e30f;
+    MaxX = MaxY = -1e30f;
+    for (uint32 Corner = 0; Corner < 8; ++Corner)
+    {
+        const float SignX = (Corner & 1) ? 1.0f : -1.0f;
+        const float SignY = (Corner & 2) ? 1.0f : -1.0f;
+        const float SignZ = (Corner & 4) ? 1.0f : -1.0f;
+        float Clip[4];
+        for (uint32 Column = 0; Column < 4; ++Column)
+        {
+            Clip[Column] = Center[Column] + SignX * AxisX[Column] + SignY * AxisY[Column] + SignZ * AxisZ[Column];
+        }
+
+        // Reaches the near plane: cannot be bounded on screen
+        if (Clip[2] < 0.0f || !(Clip[3] > 0.0f))
+        {
+            return true;
+        }
+
+        const float InvW = 1.0f / Clip[3];
+        const float X = Clip[0] * InvW;
+        const float Y = Clip[1] * InvW;
+        MinX = std::min(MinX, X);
+        MaxX = std::max(MaxX, X);
+        MinY = std::min(MinY, Y);
+        MaxY = std::max(MaxY, Y);
+        NearestDepth = std::min(NearestDepth, Clip[2] * InvW);
+    }
+#endif
+
+    // Pixels the screen rectangle touches (y down)
+    const float FloatWidth = static_cast<float>(Width);
+    const float FloatHeight = static_cast<float>(Height);
+    const float PixelMinX = Clamp((MinX * 0.5f + 0.5f) * FloatWidth, 0.0f, FloatWidth);
+    const float PixelMaxX = Clamp((MaxX * 0.5f + 0.5f) * FloatWidth, 0.0f, FloatWidth);
+    const float PixelMinY = Clamp((0.5f - MaxY * 0.5f) * FloatHeight, 0.0f, FloatHeight);
+    const float PixelMaxY = Clamp((0.5f - MinY * 0.5f) * FloatHeight, 0.0f, FloatHeight);
+
+    const int32 FirstX = static_cast<int32>(std::floor(PixelMinX));
+    const int32 LastX = static_cast<int32>(std::ceil(PixelMaxX)) - 1;
+    const int32 FirstY = static_cast<int32>(std::floor(PixelMinY));
+    const int32 LastY = static_cast<int32>(std::ceil(PixelMaxY)) - 1;
+    if (FirstX > LastX || FirstY > LastY || FirstX >= static_cast<int32>(Width) || FirstY >= static_cast<int32>(Height))
+    {
+        // Off screen (or empty): left to the frustum test
+        return true;
+    }
+
+    const uint32 Rect[4] = { static_cast<uint32>(FirstX), static_cast<uint32>(FirstY),
+                             static_cast<uint32>(LastX), static_cast<uint32>(LastY) };
+
+    // Start where the rectangle covers at most 2 x 2 texels
+    uint32 Level = 0;
+    while (Level + 1 < Levels.size() &&
+           ((Rect[2] >> Level) - (Rect[0] >> Level) > 1 || (Rect[3] >> Level) - (Rect[1] >> Level) > 1))
+    {
+        ++Level;
+    }
+
+    return !IsRegionOccluded(Level, Rect[0] >> Level, Rect[1] >> Level, Rect[2] >> Level, Rect[3] >> Level,
+                             Rect, NearestDepth);
+}
+
+bool KOcclusionCuller::IsRegionOccluded(uint32 Level, uint32 MinX, uint32 MinY, uint32 MaxX, uint32 MaxY,
+                                        const uint32 Rect[4], float NearestDepth) const
+{
+    const FLevel& Source = Levels[Level];
+    for (uint32 Y = MinY; Y <= MaxY; ++Y)
+    {
+        for (uint32 X = MinX; X <= MaxX; ++X)
+        {
+            // Every occluder under this texel is nearer than the box
+            if (Source.Depth[static_cast<size_t>(Y) * Source.Width + X] < NearestDepth)
+            {
+                continue;
+            }
+            if (Level == 0)
+            {
+                return false;
+            }
+
+            // Refine into the children that overlap the rectangle
+            const uint32 ChildLevel = Level - 1;
+            const uint32 ChildMinX = std::max(X * 2, Rect[0] >> ChildLevel);
+            const uint32 ChildMinY = std::max(Y * 2, Rect[1] >> ChildLevel);
+            const uint32 ChildMaxX = std::min(X * 2 + 1, Rect[2] >> ChildLevel);
+            const uint32 ChildMaxY = std::min(Y * 2 + 1, Rect[3] >> ChildLevel);
+            if (!IsRegionOccluded(ChildLevel, ChildMinX, ChildMinY, ChildMaxX, ChildMaxY, Rect, NearestDepth))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+uint32 KOcclusionCuller::Cull(const KFrustumCuller& Boxes, std::vector<uint32>& InOutIndices, KJobSystem* JobSystem)
+{
+    KE_PROFILE_FUNCTION();
+
+    const uint32 Count = static_cast<uint32>(InOutIndices.size());
+    if (!bRasterized || Count == 0)
+    {
+        return Count;
+    }
+
+    VisibleFlags.resize(Count);
+    auto TestRange = [&](uint32 Begin, uint32 End)
+    {
+        for (uint32 i = Begin; i < End; ++i)
+        {
+            VisibleFlags[i] = IsBoxVisible(Boxes.GetBox(InOutIndices[i])) ? 1 : 0;
+        }
+    };
+
+    if (JobSystem && JobSystem->GetThreadCount() > 1 && Count > CullChunkSize)
+    {
+        JobSystem->ParallelFor((Count + CullChunkSize - 1) / CullChunkSize, [&](uint32 Chunk, uint32)
+        {
+            const uint32 Begin = Chunk * CullChunkSize;
+            TestRange(Begin, std::min(Begin + CullChunkSize, Count));
+        });
+    }
+    else
+    {
+        TestRange(0, Count);
+    }
+
+    // Compact in place, keeping the order
+    uint32 VisibleCount = 0;
+    for (uint32 i = 0; i < Count; ++i)
+    {
+        InOutIndices[VisibleCount] = InOutIndices[i];
+        VisibleCount += VisibleFlags[i];
+    }
+    InOutIndices.resize(VisibleCount);
+
+    Stats.Tested += Count;
+    Stats.Occluded += Count - VisibleCount;
+    return VisibleCount;
+}
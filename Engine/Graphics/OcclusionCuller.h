@@ -0,0 +1,192 @@
+﻿#pragma once
+
+#include <vector>
+
+#include "../Utils/Types.h"
+#include "../Utils/Bounds.h"
+
+class KJobSystem;
+class KFrustumCuller;
+
+/**
+ * @brief Low-polygon occluder geometry kept in memory for the CPU rasterizer
+ *
+ * Occluders should be closed, conservative (inside the render mesh) shapes
+ * with few triangles, e.g. a building's walls as a box; open shapes such as
+ * a single wall need bTwoSided.
+ */
+struct FOccluderMesh
+{
+    std::vector<float> Positions;       // x, y, z per vertex (local space)
+    std::vector<uint32> Indices;        // Three per triangle
+    FBoundingBox Bounds;                // Local bounds (Bounds::ComputeBox), used to skip occluders outside the view
+    bool bTwoSided = false;             // Also rasterize back faces (clockwise triangles are front faces)
+};
+
+/**
+ * @brief Occlusion buffer settings
+ */
+struct FOcclusionCullerSettings
+{
+    uint32 Width = 256;     // Depth buffer size in pixels (rounded up to whole tiles)
+    uint32 Height = 128;
+};
+
+/**
+ * @brief Occlusion statistics of the current frame
+ */
+struct FOcclusionStats
+{
+    uint32 OccluderCount = 0;   // Occluders inside the view
+    uint32 TriangleCount = 0;   // Triangles binned after clipping
+    uint64 Tested = 0;
+    uint64 Occluded = 0;
+};
+
+/**
+ * @brief Software occlusion culling with a tiled SIMD depth rasterizer
+ *
+ * Occluder triangles are transformed by the view-projection, clipped to the
+ * near plane and binned into screen tiles; each tile is then rasterized 8 (AVX)
+ * or 4 (SSE) pixels at a time on its own job, keeping the nearest depth, and
+ * reduced into a max-depth pyramid. A box is occluded when its nearest depth
+ * lies behind the farthest occluder depth everywhere under its screen rectangle;
+ * the pyramid is descended from the level where that rectangle covers at most
+ * 2 x 2 texels. Depth is Direct3D clip space z / w (0 near, 1 far).
+ * Platform independent.
+ */
+class KOcclusionCuller
+{
+public:
+    static constexpr uint32 TileWidth = 32;
+    static constexpr uint32 TileHeight = 16;
+
+    KOcclusionCuller() = default;
+    explicit KOcclusionCuller(const FOcclusionCullerSettings& InSettings) { Initialize(InSettings); }
+
+    /**
+     * @brief Allocate the depth buffer and pyramid
+     */
+    void Initialize(const FOcclusionCullerSettings& InSettings);
+
+    /**
+     * @brief Release the depth buffer, pyramid and occluders (Initialize before the next frame)
+     */
+    void Reset();
+
+    /**
+     * @brief Start a frame: set the view and drop the previous frame's occluders
+     * @param ViewProjection View-projection matrix (row vectors, like DirectXMath)
+     */
+    void BeginFrame(const float ViewProjection[16]);
+
+    /**
+     * @brief Add an occluder instance; skipped when its bounds are outside the view
+     *
+     * Only a reference is kept: Mesh must stay alive until Rasterize.
+     * @param WorldMatrix Local to world matrix
+     */
+    void AddOccluder(const FOccluderMesh& Mesh, const float WorldMatrix[16]);
+
+    /**
+     * @brief Rasterize the occluders and build the max-depth pyramid
+     * @param JobSystem Worker pool (occluders, then screen tiles), nullptr for the calling thread
+     */
+    void Rasterize(KJobSystem* JobSystem = nullptr);
+
+    /**
+     * @brief Test a world-space box against the last rasterized frame
+     * @return false if the box is certainly hidden
+     */
+    bool IsBoxVisible(const FBoundingBox& WorldBox) const;
+
+    /**
+     * @brief Remove occluded boxes from a list of box indices, keeping the order
+     * @param Boxes Boxes addressed by the indices
+     * @param InOutIndices Indices into Boxes (e.g. the frustum culler's visible list)
+     * @param JobSystem Worker pool, nullptr for the calling thread
+     * @return Number of indices left
+     */
+    uint32 Cull(const KFrustumCuller& Boxes, std::vector<uint32>& InOutIndices, KJobSystem* JobSystem = nullptr);
+
+    uint32 GetOccluderCount() const { return static_cast<uint32>(Occluders.size()); }
+    bool IsRasterized() const { return bRasterized; }
+
+    uint32 GetWidth() const { return Width; }
+    uint32 GetHeight() const { return Height; }
+
+    /**
+     * @brief Nearest occluder depth per pixel, row-major from the top-left (1 where empty)
+     */
+    const std::vector<float>& GetDepthBuffer() const { return Levels.empty() ? EmptyLevel : Levels[0].Depth; }
+
+    const FOcclusionStats& GetStats() const { return Stats; }
+
+private:
+    /**
+     * @brief Screen-space triangle: edge functions and depth plane in pixel coordinates
+     */
+    struct FTriangle
+    {
+        float EdgeA[3];
+        float EdgeB[3];
+        float EdgeC[3];
+        float DepthA, DepthB, DepthC;
+        uint16 MinX, MinY, MaxX, MaxY;  // Covered pixels (inclusive)
+    };
+
+    /**
+     * @brief Pyramid level (level 0 is the depth buffer, then 2 x 2 maxima)
+     */
+    struct FLevel
+    {
+        uint32 Width = 0;
+        uint32 Height = 0;
+        std::vector<float> Depth;
+    };
+
+    /**
+     * @brief Per-thread setup output
+     */
+    struct FBinner
+    {
+        std::vector<float> ClipPositions;           // x, y, z, w per vertex of the current occluder
+        std::vector<float> ScreenPositions;         // Pixel x, y and depth per vertex in front of the near plane
+        std::vector<uint8> Outcodes;                // Clip planes each vertex is outside of
+        std::vector<FTriangle> Triangles;
+        std::vector<std::vector<uint32>> TileBins;  // Triangle indices per tile
+    };
+
+    struct FOccluder
+    {
+        const FOccluderMesh* Mesh;
+        float WorldViewProjection[16];
+    };
+
+    void SetupOccluder(const FOccluder& Occluder, FBinner& Binner);
+    void ProjectVertex(const float* Clip, float* OutScreen) const;
+    void ClipTriangle(const float* V0, const float* V1, const float* V2, bool bTwoSided, FBinner& Binner);
+    void BinTriangle(const float* S0, const float* S1, const float* S2, bool bTwoSided, FBinner& Binner);
+    void RasterizeTile(uint32 Tile, uint32 BinnerCount);
+    void BuildUpperLevels();
+
+    bool IsRegionOccluded(uint32 Level, uint32 MinX, uint32 MinY, uint32 MaxX, uint32 MaxY,
+                          const uint32 Rect[4], float NearestDepth) const;
+
+    uint32 Width = 0;
+    uint32 Height = 0;
+    uint32 TilesX = 0;
+    uint32 TilesY = 0;
+
+    float ViewProjection[16] = {};
+    FFrustum ViewFrustum;
+    bool bRasterized = false;
+
+    std::vector<FOccluder> Occluders;
+    std::vector<FBinner> Binners;
+    std::vector<FLevel> Levels;
+    std::vector<uint8> VisibleFlags;
+    std::vector<float> EmptyLevel;
+
+    FOcclusionStats Stats;
+};
@@ -0,0 +1,157 @@
+﻿#include "ParallelCommandRecorder.h"
+#include "../Core/Profiler.h"
+
+bool KParallelCommandRecorder::Initialize(IRHIDevice* InDevice, KJobSystem* InJobSystem, uint32 MaxChunks)
+{
+    Cleanup();
+
+    if (!InDevice || !InJobSystem)
+    {
+        return false;
+    }
+
+    if (MaxChunks == 0)
+    {
+        MaxChunks = InJobSystem->GetThreadCount();
+    }
+
+    ChunkContexts.resize(MaxChunks);
+    for (FChunkContext& ChunkContext : ChunkContexts)
+    {
+        ChunkContext.Context = InDevice->CreateDeferredContext();
+        if (!ChunkContext.Context)
+        {
+            Device = InDevice;
+            Cleanup();
+            return false;
+        }
+        ChunkContext.StateCache.SetSink(ChunkContext.Context);
+    }
+
+    Device = InDevice;
+    JobSystem = InJobSystem;
+    return true;
+}
+
+void KParallelCommandRecorder::Cleanup()
+{
+    if (Device)
+    {
+        ReleaseCommandLists();
+
+        for (FChunkContext& ChunkContext : ChunkContexts)
+        {
+            if (ChunkContext.Context)
+            {
+                Device->DestroyDeferredContext(ChunkContext.Context);
+            }
+        }
+    }
+
+    ChunkContexts.clear();
+    Chunks.clear();
+    Device = nullptr;
+    JobSystem = nullptr;
+}
+
+uint32 KParallelCommandRecorder::Record(uint32 ItemCount, const FRecordFunction& Record, uint32 MinItemsPerChunk)
+{
+    KE_PROFILE_FUNCTION();
+
+    if (!Device || ItemCount == 0)
+    {
+        return 0;
+    }
+
+    // Lists not executed yet are dropped
+    ReleaseCommandLists();
+
+    BuildChunks(ItemCount, GetMaxChunks(), MinItemsPerChunk, Chunks);
+
+    // The immediate context is only read here, on the calling thread
+    FRHIResource OutputState = Device->CaptureOutputState();
+
+    JobSystem->ParallelFor(static_cast<uint32>(Chunks.size()), [this, &Record, OutputState](uint32 ChunkIndex, uint32)
+    {
+        KE_PROFILE_SCOPE("RecordCommandChunk");
+
+        const FCommandChunk& Chunk = Chunks[ChunkIndex];
+        FChunkContext& ChunkContext = ChunkContexts[ChunkIndex];
+
+        // Command lists start from default state
+        Device->BeginCommandList(ChunkContext.Context, OutputState);
+        ChunkContext.StateCache.Invalidate();
+        ChunkContext.StateCache.ResetStats();
+
+        Record(ChunkContext.StateCache, *ChunkContext.Context, Chunk.First, Chunk.Count);
+
+        ChunkContext.CommandList = Device->FinishCommandList(ChunkContext.Context);
+    });
+
+    Stats = FRenderStateStats();
+    for (size_t i = 0; i < Chunks.size(); ++i)
+    {
+        const FRenderStateStats& ChunkStats = ChunkContexts[i].StateCache.GetStats();
+        Stats.CallsIssued += ChunkStats.CallsIssued;
+        Stats.CallsSkipped += ChunkStats.CallsSkipped;
+    }
+
+    return static_cast<uint32>(Chunks.size());
+}
+
+void KParallelCommandRecorder::Execute()
+{
+    if (!Device)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < Chunks.size(); ++i)
+    {
+        Device->ExecuteCommandList(ChunkContexts[i].CommandList);
+    }
+
+    ReleaseCommandLists();
+}
+
+void KParallelCommandRecorder::BuildChunks(uint32 ItemCount, uint32 MaxChunks, uint32 MinItemsPerChunk,
+                                           std::vector<FCommandChunk>& OutChunks)
+{
+    OutChunks.clear();
+    if (ItemCount == 0)
+    {
+        return;
+    }
+
+    MaxChunks = MaxChunks > 0 ? MaxChunks : 1;
+    MinItemsPerChunk = MinItemsPerChunk > 0 ? MinItemsPerChunk : 1;
+
+    uint32 ChunkCount = ItemCount / MinItemsPerChunk;
+    ChunkCount = ChunkCount < 1 ? 1 : (ChunkCount > MaxChunks ? MaxChunks : ChunkCount);
+
+    // The first (ItemCount % ChunkCount) chunks take one extra item
+    const uint32 BaseCount = ItemCount / ChunkCount;
+    const uint32 Remainder = ItemCount % ChunkCount;
+
+    uint32 First = 0;
+    for (uint32 i = 0; i < ChunkCount; ++i)
+    {
+        FCommandChunk Chunk;
+        Chunk.First = First;
+        Chunk.Count = BaseCount + (i < Remainder ? 1 : 0);
+        OutChunks.push_back(Chunk);
+        First += Chunk.Count;
+    }
+}
+
+void KParallelCommandRecorder::ReleaseCommandLists()
+{
+    for (FChunkContext& ChunkContext : ChunkContexts)
+    {
+        if (ChunkContext.CommandList)
+        {
+            Device->ReleaseResource(ChunkContext.CommandList);
+            ChunkContext.CommandList = nullptr;
+        }
+    }
+}
@@ -0,0 +1,114 @@
+﻿#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "../Utils/Types.h"
+#include "../Core/JobSystem.h"
+#include "../RHI/RHI.h"
+#include "RenderStateCache.h"
+
+/**
+ * @brief Contiguous range of items recorded into one command list
+ */
+struct FCommandChunk
+{
+    uint32 First = 0;
+    uint32 Count = 0;
+};
+
+/**
+ * @brief Records a draw list into several command lists in parallel
+ *
+ * The items are split into contiguous chunks, each chunk is recorded by a job
+ * into its own deferred context (behind its own state cache), and Execute
+ * submits the command lists on the immediate context in chunk order, so the
+ * result matches recording the whole list serially. Platform independent:
+ * works with any IRHIDevice that can create deferred contexts.
+ */
+class KParallelCommandRecorder
+{
+public:
+    /**
+     * @brief Records items [First, First + Count) into Context through StateCache
+     *
+     * Called concurrently for different chunks; must only read shared data.
+     */
+    using FRecordFunction = std::function<void(KRenderStateCache& StateCache, IRHICommandContext& Context,
+                                               uint32 First, uint32 Count)>;
+
+    static constexpr uint32 DefaultMinItemsPerChunk = 128;
+
+    KParallelCommandRecorder() = default;
+    ~KParallelCommandRecorder() { Cleanup(); }
+
+    // Prevent copying
+    KParallelCommandRecorder(const KParallelCommandRecorder&) = delete;
+    KParallelCommandRecorder& operator=(const KParallelCommandRecorder&) = delete;
+
+    /**
+     * @brief Create one deferred context per chunk
+     * @param InDevice Device creating deferred contexts and executing command lists
+     * @param InJobSystem Worker pool recording the chunks
+     * @param MaxChunks Upper bound of chunks per Record, 0 for the job system's thread count
+     * @return false if the device cannot record command lists
+     */
+    bool Initialize(IRHIDevice* InDevice, KJobSystem* InJobSystem, uint32 MaxChunks = 0);
+
+    /**
+     * @brief Release pending command lists and deferred contexts
+     */
+    void Cleanup();
+
+    bool IsInitialized() const { return Device != nullptr; }
+
+    /**
+     * @brief Record ItemCount items in parallel
+     * @param ItemCount Number of items
+     * @param Record Recording callback
+     * @param MinItemsPerChunk Smallest chunk worth its own command list
+     * @return Number of command lists recorded
+     */
+    uint32 Record(uint32 ItemCount, const FRecordFunction& Record, uint32 MinItemsPerChunk = DefaultMinItemsPerChunk);
+
+    /**
+     * @brief Execute the recorded command lists in order on the immediate context
+     */
+    void Execute();
+
+    /**
+     * @brief Split ItemCount items into at most MaxChunks balanced contiguous chunks
+     *
+     * Chunks hold at least MinItemsPerChunk items where possible; there is
+     * always at least one chunk when ItemCount > 0.
+     */
+    static void BuildChunks(uint32 ItemCount, uint32 MaxChunks, uint32 MinItemsPerChunk,
+                            std::vector<FCommandChunk>& OutChunks);
+
+    // Accessors
+    uint32 GetMaxChunks() const { return static_cast<uint32>(ChunkContexts.size()); }
+    const std::vector<FCommandChunk>& GetChunks() const { return Chunks; }
+
+    /**
+     * @brief State cache statistics of the last Record, merged over all chunks
+     */
+    const FRenderStateStats& GetStats() const { return Stats; }
+
+private:
+    struct FChunkContext
+    {
+        IRHICommandContext* Context = nullptr;
+        KRenderStateCache StateCache;
+        FRHIResource CommandList = nullptr;
+    };
+
+    void ReleaseCommandLists();
+
+private:
+    IRHIDevice* Device = nullptr;
+    KJobSystem* JobSystem = nullptr;
+
+    std::vector<FChunkContext> ChunkContexts;
+    std::vector<FCommandChunk> Chunks;
+    FRenderStateStats Stats;
+};
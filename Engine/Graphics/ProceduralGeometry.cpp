@@ -0,0 +1,612 @@
+﻿#include "ProceduralGeometry.h"
+#include "MeshSimplifier.h"
+#include "../Core/JobSystem.h"
+#include "../Core/Profiler.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    constexpr float Pi = 3.14159265358979323846f;
+    constexpr uint32 MaxSegments = 1u << 30;
+    constexpr uint64 ParallelVertexThreshold = 1u << 16;   // Smaller shapes are generated on the calling thread
+    constexpr uint32 BandsPerThread = 4;
+
+    /**
+     * @brief Sines and cosines of evenly spaced angles, evaluated once per ring or segment
+     */
+    struct FAngleTable
+    {
+        std::vector<float> Sin;
+        std::vector<float> Cos;
+
+        // Count + 1 angles over a full turn; the last repeats the first exactly so seams close
+        void BuildTurn(uint32 Count)
+        {
+            Sin.resize(Count + 1);
+            Cos.resize(Count + 1);
+            const float Step = 2.0f * Pi / static_cast<float>(Count);
+            for (uint32 i = 0; i < Count; ++i)
+            {
+                Sin[i] = std::sin(Step * static_cast<float>(i));
+                Cos[i] = std::cos(Step * static_cast<float>(i));
+            }
+            Sin[Count] = Sin[0];
+            Cos[Count] = Cos[0];
+        }
+
+        // Count + 1 latitudes from Begin to End; exact at the poles
+        void BuildLatitudes(uint32 Count, float Begin, float End)
+        {
+            Sin.resize(Count + 1);
+            Cos.resize(Count + 1);
+            const float Step = (End - Begin) / static_cast<float>(Count);
+            for (uint32 i = 0; i <= Count; ++i)
+            {
+                const float Angle = Begin + Step * static_cast<float>(i);
+                Sin[i] = std::sin(Angle);
+                Cos[i] = std::cos(Angle);
+                if (Angle <= -0.5f * Pi || Angle >= 0.5f * Pi)
+                {
+                    Sin[i] = Angle < 0.0f ? -1.0f : 1.0f;
+                    Cos[i] = 0.0f;
+                }
+            }
+        }
+    };
+
+    inline void SetVertex(FStandardVertex& Vertex, float X, float Y, float Z, float NormalX, float NormalY, float NormalZ,
+                          float U, float V)
+    {
+        Vertex.Position[0] = X;
+        Vertex.Position[1] = Y;
+        Vertex.Position[2] = Z;
+        Vertex.Normal[0] = NormalX;
+        Vertex.Normal[1] = NormalY;
+        Vertex.Normal[2] = NormalZ;
+        Vertex.Color[0] = NormalX * 0.5f + 0.5f;
+        Vertex.Color[1] = NormalY * 0.5f + 0.5f;
+        Vertex.Color[2] = NormalZ * 0.5f + 0.5f;
+        Vertex.Color[3] = 1.0f;
+        Vertex.TexCoord[0] = U;
+        Vertex.TexCoord[1] = V;
+    }
+
+    // Runs Task(RowBegin, RowEnd) over [0, RowCount) in bands, in parallel for large shapes
+    template <typename FBandTask>
+    void ForEachRowBand(KJobSystem* JobSystem, uint32 RowCount, uint64 VertexCount, FBandTask&& Task)
+    {
+        if (!JobSystem || VertexCount < ParallelVertexThreshold || RowCount < 2)
+        {
+            Task(0u, RowCount);
+            return;
+        }
+
+        const uint32 MaxBands = JobSystem->GetThreadCount() * BandsPerThread;
+        const uint32 BandCount = RowCount < MaxBands ? RowCount : MaxBands;
+        const uint32 RowsPerBand = (RowCount + BandCount - 1) / BandCount;
+        JobSystem->ParallelFor((RowCount + RowsPerBand - 1) / RowsPerBand, [&](uint32 Band, uint32)
+        {
+            const uint32 RowBegin = Band * RowsPerBand;
+            const uint32 RowEnd = RowBegin + RowsPerBand < RowCount ? RowBegin + RowsPerBand : RowCount;
+            Task(RowBegin, RowEnd);
+        });
+    }
+
+    // Two triangles per cell of a (Rows x Columns) cell grid whose vertex rows are Columns + 1 apart
+    void EmitGridIndices(uint32* Indices, uint32 FirstVertex, uint32 Columns, uint32 RowBegin, uint32 RowEnd)
+    {
+        uint32* Out = Indices + size_t(RowBegin) * Columns * 6;
+        for (uint32 Row = RowBegin; Row < RowEnd; ++Row)
+        {
+            uint32 A = FirstVertex + Row * (Columns + 1);
+            uint32 B = A + Columns + 1;
+            for (uint32 Column = 0; Column < Columns; ++Column, ++A, ++B)
+            {
+                Out[0] = A;
+                Out[1] = B;
+                Out[2] = A + 1;
+                Out[3] = A + 1;
+                Out[4] = B;
+                Out[5] = B + 1;
+                Out += 6;
+            }
+        }
+    }
+
+    // Like EmitGridIndices for a grid whose first and last vertex rows collapse to poles:
+    // the degenerate triangle of each cell in the first and last rows is left out
+    void EmitPoleGridIndices(uint32* Indices, uint32 Columns, uint32 Rows, uint32 RowBegin, uint32 RowEnd)
+    {
+        uint32* Out = Indices + (RowBegin == 0 ? 0 : size_t(Columns) * 3 + size_t(RowBegin - 1) * Columns * 6);
+        for (uint32 Row = RowBegin; Row < RowEnd; ++Row)
+        {
+            uint32 A = Row * (Columns + 1);
+            uint32 B = A + Columns + 1;
+            for (uint32 Column = 0; Column < Columns; ++Column, ++A, ++B)
+            {
+                if (Row != 0)
+                {
+                    Out[0] = A;
+                    Out[1] = B;
+                    Out[2] = A + 1;
+                    Out += 3;
+                }
+                if (Row != Rows - 1)
+                {
+                    Out[0] = A + 1;
+                    Out[1] = B;
+                    Out[2] = B + 1;
+                    Out += 3;
+                }
+            }
+        }
+    }
+
+    // Rings of latitude around the Y axis, shared by the sphere and the capsule
+    void GenerateLatitudeRings(FStandardVertex* Vertices, uint32* Indices, uint32 Slices, const FAngleTable& Latitudes,
+                               const float* RowOffsets, float Radius, uint64 VertexCount, KJobSystem* JobSystem)
+    {
+        const uint32 RowCount = static_cast<uint32>(Latitudes.Sin.size());
+        FAngleTable Sectors;
+        Sectors.BuildTurn(Slices);
+
+        ForEachRowBand(JobSystem, RowCount, VertexCount, [&](uint32 RowBegin, uint32 RowEnd)
+        {
+            for (uint32 Row = RowBegin; Row < RowEnd; ++Row)
+            {
+                const float RingRadius = Latitudes.Cos[Row];
+                const float NormalY = Latitudes.Sin[Row];
+                const float V = static_cast<float>(Row) / static_cast<float>(RowCount - 1);
+                FStandardVertex* Out = Vertices + size_t(Row) * (Slices + 1);
+                for (uint32 Slice = 0; Slice <= Slices; ++Slice)
+                {
+                    const float NormalX = RingRadius * Sectors.Cos[Slice];
+                    const float NormalZ = RingRadius * Sectors.Sin[Slice];
+                    SetVertex(Out[Slice], Radius * NormalX, Radius * NormalY + RowOffsets[Row], Radius * NormalZ,
+                              NormalX, NormalY, NormalZ, static_cast<float>(Slice) / static_cast<float>(Slices), V);
+                }
+            }
+        });
+
+        ForEachRowBand(JobSystem, RowCount - 1, VertexCount, [&](uint32 RowBegin, uint32 RowEnd)
+        {
+            EmitPoleGridIndices(Indices, Slices, RowCount - 1, RowBegin, RowEnd);
+        });
+    }
+
+    void GenerateSphere(const FProceduralMeshDesc& Desc, FStandardVertex* Vertices, uint32* Indices, uint64 VertexCount,
+                        KJobSystem* JobSystem)
+    {
+        const uint32 Stacks = Desc.Segments[1];
+        FAngleTable Latitudes;
+        Latitudes.BuildLatitudes(Stacks, -0.5f * Pi, 0.5f * Pi);
+        const std::vector<float> RowOffsets(Stacks + 1, 0.0f);
+        GenerateLatitudeRings(Vertices, Indices, Desc.Segments[0], Latitudes, RowOffsets.data(), Desc.Size[0], VertexCount,
+                              JobSystem);
+    }
+
+    void GenerateCapsule(const FProceduralMeshDesc& Desc, FStandardVertex* Vertices, uint32* Indices, uint64 VertexCount,
+                         KJobSystem* JobSystem)
+    {
+        // Two hemispheres of HemisphereStacks + 1 rings; the band between their equators is the cylinder
+        const uint32 HemisphereStacks = Desc.Segments[1];
+        const float HalfHeight = 0.5f * Desc.Size[1];
+        FAngleTable Bottom;
+        FAngleTable Top;
+        Bottom.BuildLatitudes(HemisphereStacks, -0.5f * Pi, 0.0f);
+        Top.BuildLatitudes(HemisphereStacks, 0.0f, 0.5f * Pi);
+
+        FAngleTable Latitudes;
+        Latitudes.Sin = Bottom.Sin;
+        Latitudes.Sin.insert(Latitudes.Sin.end(), Top.Sin.begin(), Top.Sin.end());
+        Latitudes.Cos = Bottom.Cos;
+        Latitudes.Cos.insert(Latitudes.Cos.end(), Top.Cos.begin(), Top.Cos.end());
+        std::vector<float> RowOffsets(Latitudes.Sin.size(), HalfHeight);
+        std::fill(RowOffsets.begin(), RowOffsets.begin() + HemisphereStacks + 1, -HalfHeight);
+
+        GenerateLatitudeRings(Vertices, Indices, Desc.Segments[0], Latitudes, RowOffsets.data(), Desc.Size[0], VertexCount,
+                              JobSystem);
+    }
+
+    void GenerateTorus(const FProceduralMeshDesc& Desc, FStandardVertex* Vertices, uint32* Indices, uint64 VertexCount,
+                       KJobSystem* JobSystem)
+    {
+        // Rows follow the tube, columns the ring
+        const uint32 RingSegments = Desc.Segments[0];
+        const uint32 TubeSegments = Desc.Segments[1];
+        const float RingRadius = Desc.Size[0];
+        const float TubeRadius = Desc.Size[1];
+        FAngleTable Ring;
+        FAngleTable Tube;
+        Ring.BuildTurn(RingSegments);
+        Tube.BuildTurn(TubeSegments);
+
+        ForEachRowBand(JobSystem, TubeSegments + 1, VertexCount, [&](uint32 RowBegin, uint32 RowEnd)
+        {
+            for (uint32 Row = RowBegin; Row < RowEnd; ++Row)
+            {
+                const float Distance = RingRadius + TubeRadius * Tube.Cos[Row];
+                const float V = static_cast<float>(Row) / static_cast<float>(TubeSegments);
+                FStandardVertex* Out = Vertices + size_t(Row) * (RingSegments + 1);
+                for (uint32 Column = 0; Column <= RingSegments; ++Column)
+                {
+                    SetVertex(Out[Column], Distance * Ring.Cos[Column], TubeRadius * Tube.Sin[Row], Distance * Ring.Sin[Column],
+                              Tube.Cos[Row] * Ring.Cos[Column], Tube.Sin[Row], Tube.Cos[Row] * Ring.Sin[Column],
+                              static_cast<float>(Column) / static_cast<float>(RingSegments), V);
+                }
+            }
+        });
+
+        ForEachRowBand(JobSystem, TubeSegments, VertexCount, [&](uint32 RowBegin, uint32 RowEnd)
+        {
+            EmitGridIndices(Indices, 0, RingSegments, RowBegin, RowEnd);
+        });
+    }
+
+    void GenerateCylinder(const FProceduralMeshDesc& Desc, FStandardVertex* Vertices, uint32* Indices, uint64 VertexCount,
+                          KJobSystem* JobSystem)
+    {
+        const uint32 Slices = Desc.Segments[0];
+        const uint32 Stacks = Desc.Segments[1];
+        const float Radius = Desc.Size[0];
+        const float HalfHeight = 0.5f * Desc.Size[1];
+        FAngleTable Sectors;
+        Sectors.BuildTurn(Slices);
+
+        ForEachRowBand(JobSystem, Stacks + 1, VertexCount, [&](uint32 RowBegin, uint32 RowEnd)
+        {
+            for (uint32 Row = RowBegin; Row < RowEnd; ++Row)
+            {
+                const float V = static_cast<float>(Row) / static_cast<float>(Stacks);
+                const float Y = -HalfHeight + V * Desc.Size[1];
+                FStandardVertex* Out = Vertices + size_t(Row) * (Slices + 1);
+                for (uint32 Slice = 0; Slice <= Slices; ++Slice)
+                {
+                    SetVertex(Out[Slice], Radius * Sectors.Cos[Slice], Y, Radius * Sectors.Sin[Slice],
+                              Sectors.Cos[Slice], 0.0f, Sectors.Sin[Slice], static_cast<float>(Slice) / static_cast<float>(Slices), V);
+                }
+            }
+        });
+
+        ForEachRowBand(JobSystem, Stacks, VertexCount, [&](uint32 RowBegin, uint32 RowEnd)
+        {
+            EmitGridIndices(Indices, 0, Slices, RowBegin, RowEnd);
+        });
+
+        // Caps: a center vertex and a ring each, bottom then top
+        uint32 FirstVertex = (Stacks + 1) * (Slices + 1);
+        uint32* Out = Indices + size_t(Stacks) * Slices * 6;
+        for (uint32 Cap = 0; Cap < 2; ++Cap)
+        {
+            const float NormalY = Cap == 0 ? -1.0f : 1.0f;
+            FStandardVertex* CapVertices = Vertices + FirstVertex;
+            SetVertex(CapVertices[0], 0.0f, NormalY * HalfHeight, 0.0f, 0.0f, NormalY, 0.0f, 0.5f, 0.5f);
+            for (uint32 Slice = 0; Slice <= Slices; ++Slice)
+            {
+                SetVertex(CapVertices[Slice + 1], Radius * Sectors.Cos[Slice], NormalY * HalfHeight, Radius * Sectors.Sin[Slice],
+                          0.0f, NormalY, 0.0f, 0.5f + 0.5f * Sectors.Cos[Slice], 0.5f - 0.5f * NormalY * Sectors.Sin[Slice]);
+            }
+            for (uint32 Slice = 0; Slice < Slices; ++Slice)
+            {
+                const uint32 Current = FirstVertex + 1 + Slice;
+                Out[0] = FirstVertex;
+                Out[1] = Cap == 0 ? Current : Current + 1;
+                Out[2] = Cap == 0 ? Current + 1 : Current;
+                Out += 3;
+            }
+            FirstVertex += Slices + 2;
+        }
+    }
+
+    void GeneratePlane(const FProceduralMeshDesc& Desc, FStandardVertex* Vertices, uint32* Indices, uint64 VertexCount,
+                       KJobSystem* JobSystem)
+    {
+        const uint32 CellsX = Desc.Segments[0];
+        const uint32 CellsZ = Desc.Segments[1];
+        const bool bHeightfield = Desc.Shape == EProceduralShape::Heightfield;
+
+        // Plane: Size is the whole extent; heightfield: Size is one cell
+        const float StepX = bHeightfield ? Desc.Size[0] : Desc.Size[0] / static_cast<float>(CellsX);
+        const float StepZ = bHeightfield ? Desc.Size[1] : Desc.Size[1] / static_cast<float>(CellsZ);
+        const float HeightScale = bHeightfield ? Desc.Size[2] : 0.0f;
+        const float OriginX = -0.5f * StepX * static_cast<float>(CellsX);
+        const float OriginZ = -0.5f * StepZ * static_cast<float>(CellsZ);
+        const float* Heights = Desc.Heights;
+
+        ForEachRowBand(JobSystem, CellsZ + 1, VertexCount, [&](uint32 RowBegin, uint32 RowEnd)
+        {
+            for (uint32 Row = RowBegin; Row < RowEnd; ++Row)
+            {
+                const float Z = OriginZ + StepZ * static_cast<float>(Row);
+                const float V = 1.0f - static_cast<float>(Row) / static_cast<float>(CellsZ);
+                FStandardVertex* Out = Vertices + size_t(Row) * (CellsX + 1);
+                if (!bHeightfield)
+                {
+                    for (uint32 Column = 0; Column <= CellsX; ++Column)
+                    {
+                        SetVertex(Out[Column], OriginX + StepX * static_cast<float>(Column), 0.0f, Z, 0.0f, 1.0f, 0.0f,
+                                  static_cast<float>(Column) / static_cast<float>(CellsX), V);
+                    }
+                    continue;
+                }
+
+                // Normals from central differences (one-sided at the borders)
+                const float* Samples = Heights + size_t(Row) * (CellsX + 1);
+                const float* Previous = Row > 0 ? Samples - (CellsX + 1) : Samples;
+                const float* Next = Row < CellsZ ? Samples + (CellsX + 1) : Samples;
+                const float SlopeScaleZ = HeightScale / (StepZ * static_cast<float>((Row > 0) + (Row < CellsZ)));
+                for (uint32 Column = 0; Column <= CellsX; ++Column)
+                {
+                    const uint32 Left = Column > 0 ? Column - 1 : Column;
+                    const uint32 Right = Column < CellsX ? Column + 1 : Column;
+                    const float SlopeX = (Samples[Right] - Samples[Left]) * HeightScale / (StepX * static_cast<float>(Right - Left));
+                    const float SlopeZ = (Next[Column] - Previous[Column]) * SlopeScaleZ;
+                    const float InverseLength = 1.0f / std::sqrt(SlopeX * SlopeX + 1.0f + SlopeZ * SlopeZ);
+                    SetVertex(Out[Column], OriginX + StepX * static_cast<float>(Column), Samples[Column] * HeightScale, Z,
+                              -SlopeX * InverseLength, InverseLength, -SlopeZ * InverseLength,
+                              static_cast<float>(Column) / static_cast<float>(CellsX), V);
+                }
+            }
+        });
+
+        ForEachRowBand(JobSystem, CellsZ, VertexCount, [&](uint32 RowBegin, uint32 RowEnd)
+        {
+            EmitGridIndices(Indices, 0, CellsX, RowBegin, RowEnd);
+        });
+    }
+
+    inline uint64 MixHash(uint64 Value)
+    {
+        Value ^= Value >> 33;
+        Value *= 0xFF51AFD7ED558CCDull;
+        Value ^= Value >> 33;
+        Value *= 0xC4CEB9FE1A85EC53ull;
+        Value ^= Value >> 33;
+        return Value;
+    }
+
+    inline uint64 HashCombine(uint64 Hash, uint64 Value)
+    {
+        return MixHash(Hash ^ (Value + 0x9E3779B97F4A7C15ull + (Hash << 6) + (Hash >> 2)));
+    }
+
+    inline uint64 HashFloat(uint64 Hash, float Value)
+    {
+        uint32 Bits;
+        std::memcpy(&Bits, &Value, sizeof(Bits));
+        return HashCombine(Hash, Bits);
+    }
+}
+
+FProceduralMeshDesc FProceduralMeshDesc::Sphere(uint32 Slices, uint32 Stacks, float Radius)
+{
+    FProceduralMeshDesc Desc;
+    Desc.Shape = EProceduralShape::Sphere;
+    Desc.Segments[0] = Slices;
+    Desc.Segments[1] = Stacks;
+    Desc.Size[0] = Radius;
+    return Desc;
+}
+
+FProceduralMeshDesc FProceduralMeshDesc::Torus(uint32 RingSegments, uint32 TubeSegments, float RingRadius, float TubeRadius)
+{
+    FProceduralMeshDesc Desc;
+    Desc.Shape = EProceduralShape::Torus;
+    Desc.Segments[0] = RingSegments;
+    Desc.Segments[1] = TubeSegments;
+    Desc.Size[0] = RingRadius;
+    Desc.Size[1] = TubeRadius;
+    return Desc;
+}
+
+FProceduralMeshDesc FProceduralMeshDesc::Cylinder(uint32 Slices, uint32 Stacks, float Radius, float Height)
+{
+    FProceduralMeshDesc Desc;
+    Desc.Shape = EProceduralShape::Cylinder;
+    Desc.Segments[0] = Slices;
+    Desc.Segments[1] = Stacks;
+    Desc.Size[0] = Radius;
+    Desc.Size[1] = Height;
+    return Desc;
+}
+
+FProceduralMeshDesc FProceduralMeshDesc::Capsule(uint32 Slices, uint32 HemisphereStacks, float Radius, float Height)
+{
+    FProceduralMeshDesc Desc;
+    Desc.Shape = EProceduralShape::Capsule;
+    Desc.Segments[0] = Slices;
+    Desc.Segments[1] = HemisphereStacks;
+    Desc.Size[0] = Radius;
+    Desc.Size[1] = Height;
+    return Desc;
+}
+
+FProceduralMeshDesc FProceduralMeshDesc::Plane(uint32 CellsX, uint32 CellsZ, float SizeX, float SizeZ)
+{
+    FProceduralMeshDesc Desc;
+    Desc.Shape = EProceduralShape::Plane;
+    Desc.Segments[0] = CellsX;
+    Desc.Segments[1] = CellsZ;
+    Desc.Size[0] = SizeX;
+    Desc.Size[1] = SizeZ;
+    return Desc;
+}
+
+FProceduralMeshDesc FProceduralMeshDesc::Heightfield(const float* Heights, uint32 CellsX, uint32 CellsZ,
+                                                     float CellSizeX, float CellSizeZ, float HeightScale)
+{
+    FProceduralMeshDesc Desc;
+    Desc.Shape = EProceduralShape::Heightfield;
+    Desc.Segments[0] = CellsX;
+    Desc.Segments[1] = CellsZ;
+    Desc.Size[0] = CellSizeX;
+    Desc.Size[1] = CellSizeZ;
+    Desc.Size[2] = HeightScale;
+    Desc.Heights = Heights;
+    return Desc;
+}
+
+bool ProceduralGeometry::GetCounts(const FProceduralMeshDesc& Desc, uint32& OutVertexCount, uint32& OutIndexCount)
+{
+    OutVertexCount = 0;
+    OutIndexCount = 0;
+
+    const uint64 First = Desc.Segments[0];
+    const uint64 Second = Desc.Segments[1];
+    if (First > MaxSegments || Second > MaxSegments)
+    {
+        return false;
+    }
+
+    uint64 VertexCount = 0;
+    uint64 IndexCount = 0;
+    switch (Desc.Shape)
+    {
+    case EProceduralShape::Sphere:
+        if (First < 3 || Second < 2)
+        {
+            return false;
+        }
+        VertexCount = (Second + 1) * (First + 1);
+        IndexCount = First * (Second - 1) * 6;
+        break;
+    case EProceduralShape::Torus:
+        if (First < 3 || Second < 3)
+        {
+            return false;
+        }
+        VertexCount = (Second + 1) * (First + 1);
+        IndexCount = First * Second * 6;
+        break;
+    case EProceduralShape::Cylinder:
+        if (First < 3 || Second < 1)
+        {
+            return false;
+        }
+        VertexCount = (Second + 1) * (First + 1) + 2 * (First + 2);
+        IndexCount = First * Second * 6 + First * 6;
+        break;
+    case EProceduralShape::Capsule:
+        if (First < 3 || Second < 1)
+        {
+            return false;
+        }
+        VertexCount = (2 * Second + 2) * (First + 1);
+        IndexCount = First * (2 * Second) * 6;
+        break;
+    case EProceduralShape::Plane:
+    case EProceduralShape::Heightfield:
+        if (First < 1 || Second < 1 || (Desc.Shape == EProceduralShape::Heightfield && !Desc.Heights))
+        {
+            return false;
+        }
+        VertexCount = (Second + 1) * (First + 1);
+        IndexCount = First * Second * 6;
+        break;
+    default:
+        return false;
+    }
+
+    if (VertexCount > UINT32_MAX || IndexCount > UINT32_MAX)
+    {
+        return false;
+    }
+    OutVertexCount = static_cast<uint32>(VertexCount);
+    OutIndexCount = static_cast<uint32>(IndexCount);
+    return true;
+}
+
+bool ProceduralGeometry::Generate(const FProceduralMeshDesc& Desc, FStandardVertex* OutVertices, uint32* OutIndices,
+                                  KJobSystem* JobSystem)
+{
+    KE_PROFILE_FUNCTION();
+
+    uint32 VertexCount = 0;
+    uint32 IndexCount = 0;
+    if (!GetCounts(Desc, VertexCount, IndexCount) || !OutVertices || !OutIndices)
+    {
+        return false;
+    }
+
+    switch (Desc.Shape)
+    {
+    case EProceduralShape::Sphere:
+        GenerateSphere(Desc, OutVertices, OutIndices, VertexCount, JobSystem);
+        break;
+    case EProceduralShape::Torus:
+        GenerateTorus(Desc, OutVertices, OutIndices, VertexCount, JobSystem);
+        break;
+    case EProceduralShape::Cylinder:
+        GenerateCylinder(Desc, OutVertices, OutIndices, VertexCount, JobSystem);
+        break;
+    case EProceduralShape::Capsule:
+        GenerateCapsule(Desc, OutVertices, OutIndices, VertexCount, JobSystem);
+        break;
+    case EProceduralShape::Plane:
+    case EProceduralShape::Heightfield:
+        GeneratePlane(Desc, OutVertices, OutIndices, VertexCount, JobSystem);
+        break;
+    }
+    return true;
+}
+
+bool ProceduralGeometry::Generate(const FProceduralMeshDesc& Desc, std::vector<FStandardVertex>& OutVertices,
+                                  std::vector<uint32>& OutIndices, KJobSystem* JobSystem)
+{
+    uint32 VertexCount = 0;
+    uint32 IndexCount = 0;
+    if (!GetCounts(Desc, VertexCount, IndexCount))
+    {
+        OutVertices.clear();
+        OutIndices.clear();
+        return false;
+    }
+
+    OutVertices.resize(VertexCount);
+    OutIndices.resize(IndexCount);
+    return Generate(Desc, OutVertices.data(), OutIndices.data(), JobSystem);
+}
+
+uint64 ProceduralGeometry::GetCacheKey(const FProceduralMeshDesc& Desc, EVertexLayout Layout, const FMeshLODSettings* LODSettings)
+{
+    uint64 Hash = HashCombine(static_cast<uint64>(Desc.Shape), static_cast<uint64>(Layout));
+    Hash = HashCombine(Hash, Desc.Segments[0]);
+    Hash = HashCombine(Hash, Desc.Segments[1]);
+    for (float Size : Desc.Size)
+    {
+        Hash = HashFloat(Hash, Size);
+    }
+
+    // Height samples by content, so a refilled buffer is a different mesh
+    uint32 VertexCount = 0;
+    uint32 IndexCount = 0;
+    if (Desc.Shape == EProceduralShape::Heightfield && GetCounts(Desc, VertexCount, IndexCount))
+    {
+        // One multiply per sample; the full mix runs once at the end
+        uint64 SampleHash = 0xCBF29CE484222325ull;
+        for (uint32 i = 0; i < VertexCount; ++i)
+        {
+            uint32 Bits;
+            std::memcpy(&Bits, &Desc.Heights[i], sizeof(Bits));
+            SampleHash = (SampleHash ^ Bits) * 0x100000001B3ull;
+        }
+        Hash = HashCombine(Hash, SampleHash);
+    }
+
+    Hash = HashCombine(Hash, LODSettings != nullptr);
+    if (LODSettings)
+    {
+        for (float Ratio : LODSettings->TriangleRatios)
+        {
+            Hash = HashFloat(Hash, Ratio);
+        }
+        Hash = HashCombine(Hash, LODSettings->TriangleRatios.size());
+        Hash = HashFloat(Hash, LODSettings->MaxError);
+        Hash = HashFloat(Hash, LODSettings->MinReduction);
+        Hash = HashFloat(Hash, LODSettings->ScreenError);
+        Hash = HashCombine(Hash, (LODSettings->bLockBorders ? 1u : 0u) | (LODSettings->bOptimizeVertexCache ? 2u : 0u));
+    }
+    return Hash;
+}
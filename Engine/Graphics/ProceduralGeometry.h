@@ -0,0 +1,81 @@
+﻿#pragma once
+
+#include <vector>
+#include "../Utils/Types.h"
+#include "VertexFormat.h"
+
+class KJobSystem;
+struct FMeshLODSettings;
+
+// Procedural shape generation. Platform independent.
+// Trigonometry is evaluated once per ring and segment into tables, outputs are
+// sized exactly before generation, and large shapes are generated in row bands
+// in parallel. Shapes are front facing from outside (clockwise in the engine's
+// left-handed convention); vertex colors visualize the normal.
+
+/**
+ * @brief Procedural shapes
+ */
+enum class EProceduralShape : uint8
+{
+    Sphere,         // UV sphere around the origin
+    Torus,          // Ring around the Y axis
+    Cylinder,       // Along the Y axis, centered, with caps
+    Capsule,        // Cylinder with hemispherical ends, along the Y axis, centered
+    Plane,          // Grid on the XZ plane facing +Y, centered
+    Heightfield     // Plane grid displaced along Y by height samples
+};
+
+/**
+ * @brief Shape and parameters of a procedural mesh
+ *
+ * Segments and Size mean, per shape:
+ * - Sphere: slices, stacks; radius
+ * - Torus: ring segments, tube segments; ring radius, tube radius
+ * - Cylinder: slices, stacks; radius, height
+ * - Capsule: slices, stacks per hemisphere; radius, cylinder height
+ * - Plane: cells along X, cells along Z; size along X, size along Z
+ * - Heightfield: cells along X, cells along Z; cell size along X, cell size along Z, height scale
+ */
+struct FProceduralMeshDesc
+{
+    EProceduralShape Shape = EProceduralShape::Sphere;
+    uint32 Segments[2] = { 16, 16 };
+    float Size[3] = { 1.0f, 1.0f, 1.0f };
+    const float* Heights = nullptr;     // Heightfield: (Segments[0] + 1) * (Segments[1] + 1) samples, rows along Z (not owned)
+
+    static FProceduralMeshDesc Sphere(uint32 Slices, uint32 Stacks, float Radius = 1.0f);
+    static FProceduralMeshDesc Torus(uint32 RingSegments, uint32 TubeSegments, float RingRadius = 1.0f, float TubeRadius = 0.25f);
+    static FProceduralMeshDesc Cylinder(uint32 Slices, uint32 Stacks = 1, float Radius = 1.0f, float Height = 2.0f);
+    static FProceduralMeshDesc Capsule(uint32 Slices, uint32 HemisphereStacks, float Radius = 0.5f, float Height = 1.0f);
+    static FProceduralMeshDesc Plane(uint32 CellsX, uint32 CellsZ, float SizeX = 1.0f, float SizeZ = 1.0f);
+    static FProceduralMeshDesc Heightfield(const float* Heights, uint32 CellsX, uint32 CellsZ,
+                                           float CellSizeX = 1.0f, float CellSizeZ = 1.0f, float HeightScale = 1.0f);
+};
+
+namespace ProceduralGeometry
+{
+    /**
+     * @brief Exact vertex and index counts of a shape
+     * @return false if the parameters are invalid (too few segments, missing heights, over 4G vertices)
+     */
+    bool GetCounts(const FProceduralMeshDesc& Desc, uint32& OutVertexCount, uint32& OutIndexCount);
+
+    /**
+     * @brief Generate a shape into caller memory sized by GetCounts
+     * @param JobSystem Worker pool for large shapes, nullptr for the calling thread
+     */
+    bool Generate(const FProceduralMeshDesc& Desc, FStandardVertex* OutVertices, uint32* OutIndices,
+                  KJobSystem* JobSystem = nullptr);
+
+    /**
+     * @brief Generate a shape into vectors resized once to the exact counts
+     */
+    bool Generate(const FProceduralMeshDesc& Desc, std::vector<FStandardVertex>& OutVertices, std::vector<uint32>& OutIndices,
+                  KJobSystem* JobSystem = nullptr);
+
+    /**
+     * @brief Cache key of a generated mesh: shape parameters, height samples, vertex layout and LOD settings
+     */
+    uint64 GetCacheKey(const FProceduralMeshDesc& Desc, EVertexLayout Layout, const FMeshLODSettings* LODSettings);
+}
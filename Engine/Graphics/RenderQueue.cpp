@@ -0,0 +1,114 @@
+﻿#include "RenderQueue.h"
+#include <cstring>
+
+uint32 DrawKey::QuantizeDepth(float ViewDepth, float NearZ, float FarZ, bool bBackToFront)
+{
+    const uint32 MaxDepth = static_cast<uint32>(FieldMask(DepthBits));
+
+    float Range = FarZ - NearZ;
+    float Normalized = Range > 0.0f ? (ViewDepth - NearZ) / Range : 0.0f;
+    if (!(Normalized > 0.0f)) Normalized = 0.0f;    // Also catches NaN (e.g. from a degenerate world matrix)
+    if (Normalized > 1.0f) Normalized = 1.0f;
+
+    uint32 Depth = static_cast<uint32>(Normalized * static_cast<float>(MaxDepth));
+    return bBackToFront ? MaxDepth - Depth : Depth;
+}
+
+void KRenderQueue::Reserve(size_t Count)
+{
+    Items.reserve(Count);
+    ScratchItems.reserve(Count);
+}
+
+void KRenderQueue::Sort()
+{
+    const size_t Count = Items.size();
+    if (Count < 2)
+    {
+        return;
+    }
+
+    constexpr uint32 RadixBits = 8;
+    constexpr uint32 BucketCount = 1 << RadixBits;
+    constexpr uint32 PassCount = 64 / RadixBits;
+
+    // Build all histograms in a single read pass
+    uint32 Histograms[PassCount][BucketCount];
+    std::memset(Histograms, 0, sizeof(Histograms));
+
+    for (const FRenderQueueItem& Item : Items)
+    {
+        uint64 Key = Item.Key;
+        for (uint32 Pass = 0; Pass < PassCount; ++Pass)
+        {
+            ++Histograms[Pass][(Key >> (Pass * RadixBits)) & (BucketCount - 1)];
+        }
+    }
+
+    ScratchItems.resize(Count);
+    FRenderQueueItem* Source = Items.data();
+    FRenderQueueItem* Dest = ScratchItems.data();
+
+    for (uint32 Pass = 0; Pass < PassCount; ++Pass)
+    {
+        uint32* Histogram = Histograms[Pass];
+        const uint32 Shift = Pass * RadixBits;
+
+        // Skip digits where every key falls into the same bucket
+        if (Histogram[(Source[0].Key >> Shift) & (BucketCount - 1)] == Count)
+        {
+            continue;
+        }
+
+        // Exclusive prefix sum
+        uint32 Offset = 0;
+        for (uint32 Bucket = 0; Bucket < BucketCount; ++Bucket)
+        {
+            uint32 BucketSize = Histogram[Bucket];
+            Histogram[Bucket] = Offset;
+            Offset += BucketSize;
+        }
+
+        for (size_t i = 0; i < Count; ++i)
+        {
+            const FRenderQueueItem& Item = Source[i];
+            Dest[Histogram[(Item.Key >> Shift) & (BucketCount - 1)]++] = Item;
+        }
+
+        std::swap(Source, Dest);
+    }
+
+    // Result ended up in the scratch buffer
+    if (Source != Items.data())
+    {
+        Items.swap(ScratchItems);
+    }
+}
+
+size_t KRenderQueue::FindBatchEnd(size_t First, uint64 KeyMask) const
+{
+    const size_t Count = Items.size();
+    if (First >= Count)
+    {
+        return Count;
+    }
+
+    const uint64 BatchKey = Items[First].Key & KeyMask;
+    size_t Last = First + 1;
+    while (Last < Count && (Items[Last].Key & KeyMask) == BatchKey)
+    {
+        ++Last;
+    }
+    return Last;
+}
+
+uint32 KSortIdMap::GetId(const void* Resource)
+{
+    if (!Resource)
+    {
+        return 0;
+    }
+
+    auto Result = Ids.emplace(Resource, static_cast<uint32>(Ids.size() + 1));
+    return Result.first->second;
+}
@@ -0,0 +1,210 @@
+﻿#pragma once
+
+#include "../Utils/Types.h"
+#include <vector>
+#include <unordered_map>
+
+/**
+ * @brief Render pass stored in the most significant bits of a draw key
+ */
+enum class ERenderPass : uint8
+{
+    Opaque = 0,
+    Transparent,
+    Overlay
+};
+
+/**
+ * @brief Packed 64-bit draw sort key
+ *
+ * State-major layout (MSB -> LSB): Pass(4) | Shader(12) | Texture(12) | Mesh(16) | Depth(20).
+ * Depth-major layout (transparent pass): Pass(4) | Depth(20) | Shader(12) | Texture(12) | Mesh(16).
+ * The mesh field holds the mesh id above its LOD (MeshLODBits), so LODs of a mesh batch separately.
+ * Sorting keys ascending groups draws by pass, then by state, then front to back; the transparent
+ * pass sorts by depth first (back to front, see QuantizeDepth) and only uses state as a tie break.
+ */
+namespace DrawKey
+{
+    constexpr uint32 PassBits    = 4;
+    constexpr uint32 ShaderBits  = 12;
+    constexpr uint32 TextureBits = 12;
+    constexpr uint32 MeshBits    = 16;
+    constexpr uint32 DepthBits   = 20;
+    constexpr uint32 MeshLODBits = 3;
+
+    constexpr uint32 DepthShift   = 0;
+    constexpr uint32 MeshShift    = DepthShift + DepthBits;
+    constexpr uint32 TextureShift = MeshShift + MeshBits;
+    constexpr uint32 ShaderShift  = TextureShift + TextureBits;
+    constexpr uint32 PassShift    = ShaderShift + ShaderBits;
+
+    // Depth-major layout (pass bits stay in place)
+    constexpr uint32 SortedMeshShift    = 0;
+    constexpr uint32 SortedTextureShift = SortedMeshShift + MeshBits;
+    constexpr uint32 SortedShaderShift  = SortedTextureShift + TextureBits;
+    constexpr uint32 SortedDepthShift   = SortedShaderShift + ShaderBits;
+
+    static_assert(PassShift + PassBits == 64, "Draw key layout must fill 64 bits");
+    static_assert(SortedDepthShift + DepthBits == PassShift, "Depth-major layout must fill 64 bits");
+
+    constexpr uint64 FieldMask(uint32 Bits) { return (uint64(1) << Bits) - 1; }
+
+    /**
+     * @brief Whether keys of a pass use the depth-major layout
+     */
+    constexpr bool IsDepthMajor(ERenderPass Pass) { return Pass == ERenderPass::Transparent; }
+
+    /**
+     * @brief Mask selecting every field except depth (draws sharing state)
+     */
+    constexpr uint64 StateMask = ~(FieldMask(DepthBits) << DepthShift);
+    constexpr uint64 SortedStateMask = ~(FieldMask(DepthBits) << SortedDepthShift);
+
+    /**
+     * @brief State mask matching the layout used by a pass
+     */
+    constexpr uint64 GetStateMask(ERenderPass Pass) { return IsDepthMajor(Pass) ? SortedStateMask : StateMask; }
+
+    /**
+     * @brief Build a draw key (ids wider than their field are wrapped)
+     *
+     * The layout is picked from the pass, see IsDepthMajor.
+     */
+    constexpr uint64 Make(ERenderPass Pass, uint32 ShaderId, uint32 TextureId, uint32 MeshId, uint32 Depth)
+    {
+        return IsDepthMajor(Pass)
+            ? ((uint64(Pass) & FieldMask(PassBits)) << PassShift) |
+              ((uint64(Depth) & FieldMask(DepthBits)) << SortedDepthShift) |
+              ((uint64(ShaderId) & FieldMask(ShaderBits)) << SortedShaderShift) |
+              ((uint64(TextureId) & FieldMask(TextureBits)) << SortedTextureShift) |
+              ((uint64(MeshId) & FieldMask(MeshBits)) << SortedMeshShift)
+            : ((uint64(Pass) & FieldMask(PassBits)) << PassShift) |
+              ((uint64(ShaderId) & FieldMask(ShaderBits)) << ShaderShift) |
+              ((uint64(TextureId) & FieldMask(TextureBits)) << TextureShift) |
+              ((uint64(MeshId) & FieldMask(MeshBits)) << MeshShift) |
+              ((uint64(Depth) & FieldMask(DepthBits)) << DepthShift);
+    }
+
+    /**
+     * @brief Mesh field value for a LOD of a mesh
+     */
+    constexpr uint32 MakeMeshId(uint32 MeshSortId, uint32 LOD)
+    {
+        return (MeshSortId << MeshLODBits) | (LOD & static_cast<uint32>(FieldMask(MeshLODBits)));
+    }
+
+    constexpr ERenderPass GetPass(uint64 Key) { return static_cast<ERenderPass>((Key >> PassShift) & FieldMask(PassBits)); }
+    constexpr uint64 GetStateMask(uint64 Key) { return GetStateMask(GetPass(Key)); }
+
+    constexpr uint32 GetField(uint64 Key, uint32 StateMajorShift, uint32 DepthMajorShift, uint32 Bits)
+    {
+        return static_cast<uint32>((Key >> (IsDepthMajor(GetPass(Key)) ? DepthMajorShift : StateMajorShift)) & FieldMask(Bits));
+    }
+
+    constexpr uint32 GetShader(uint64 Key) { return GetField(Key, ShaderShift, SortedShaderShift, ShaderBits); }
+    constexpr uint32 GetTexture(uint64 Key) { return GetField(Key, TextureShift, SortedTextureShift, TextureBits); }
+    constexpr uint32 GetMesh(uint64 Key) { return GetField(Key, MeshShift, SortedMeshShift, MeshBits); }
+    constexpr uint32 GetDepth(uint64 Key) { return GetField(Key, DepthShift, SortedDepthShift, DepthBits); }
+
+    /**
+     * @brief Quantize a linear view-space depth into the depth field
+     * @param ViewDepth View-space depth (NaN sorts as the near plane)
+     * @param NearZ Near clipping plane
+     * @param FarZ Far clipping plane
+     * @param bBackToFront Invert ordering (for transparent passes)
+     */
+    uint32 QuantizeDepth(float ViewDepth, float NearZ, float FarZ, bool bBackToFront = false);
+}
+
+/**
+ * @brief Draw queue entry (key + index into the caller's payload array)
+ */
+struct FRenderQueueItem
+{
+    uint64 Key;
+    uint32 Index;
+};
+
+/**
+ * @brief Per-frame draw queue sorted by packed draw keys
+ *
+ * Platform independent; the renderer keeps the payload (render objects)
+ * and only pushes key/index pairs here.
+ */
+class KRenderQueue
+{
+public:
+    KRenderQueue() = default;
+    ~KRenderQueue() = default;
+
+    /**
+     * @brief Remove all queued items (keeps allocated memory)
+     */
+    void Reset() { Items.clear(); }
+
+    /**
+     * @brief Reserve space for a number of submissions
+     */
+    void Reserve(size_t Count);
+
+    /**
+     * @brief Push a draw
+     * @param Key Packed draw key
+     * @param Index Payload index
+     */
+    void Push(uint64 Key, uint32 Index) { Items.push_back({ Key, Index }); }
+
+    /**
+     * @brief Sort queued items by key (stable LSD radix sort)
+     */
+    void Sort();
+
+    /**
+     * @brief Find the end of a run of sorted items sharing the same masked key
+     * @param First Index of the first item of the run
+     * @param KeyMask Key bits that must match (e.g. DrawKey::StateMask)
+     * @return One past the last item of the run
+     */
+    size_t FindBatchEnd(size_t First, uint64 KeyMask) const;
+
+    /**
+     * @brief Find the end of a run of sorted items sharing the same state
+     *
+     * Uses the state mask of the first item's pass (see DrawKey::GetStateMask).
+     */
+    size_t FindBatchEnd(size_t First) const
+    {
+        return First < Items.size() ? FindBatchEnd(First, DrawKey::GetStateMask(Items[First].Key)) : Items.size();
+    }
+
+    // Accessors
+    const std::vector<FRenderQueueItem>& GetItems() const { return Items; }
+    size_t GetCount() const { return Items.size(); }
+    bool IsEmpty() const { return Items.empty(); }
+
+private:
+    std::vector<FRenderQueueItem> Items;
+    std::vector<FRenderQueueItem> ScratchItems;
+};
+
+/**
+ * @brief Maps resource pointers to small dense ids for draw keys
+ *
+ * Ids are handed out in first-seen order; only equality matters for sorting.
+ */
+class KSortIdMap
+{
+public:
+    /**
+     * @brief Get id for a resource (0 is reserved for nullptr)
+     */
+    uint32 GetId(const void* Resource);
+
+    /**
+     * @brief Forget all ids
+     */
+    void Reset() { Ids.clear(); }
+
+private:
+    std::unordered_map<const void*, uint32> Ids;
+};
@@ -0,0 +1,128 @@
+﻿#include "RenderStateCache.h"
+
+void KRenderStateCache::SetSink(IRenderStateSink* InSink)
+{
+    Sink = InSink;
+    Invalidate();
+}
+
+void KRenderStateCache::Invalidate()
+{
+    InputLayout.bKnown = false;
+    Topology.bKnown = false;
+    IndexBuffer.bKnown = false;
+    DepthStencil.bKnown = false;
+    Viewport.bKnown = false;
+
+    for (auto& Shader : Shaders)
+    {
+        Shader.bKnown = false;
+    }
+
+    for (auto& VertexBuffer : VertexBuffers)
+    {
+        VertexBuffer.bKnown = false;
+    }
+
+    for (uint32 Stage = 0; Stage < ShaderTypeCount; ++Stage)
+    {
+        for (auto& ConstantBuffer : ConstantBuffers[Stage])
+        {
+            ConstantBuffer.bKnown = false;
+        }
+        for (auto& ShaderResource : ShaderResources[Stage])
+        {
+            ShaderResource.bKnown = false;
+        }
+        for (auto& Sampler : Samplers[Stage])
+        {
+            Sampler.bKnown = false;
+        }
+    }
+}
+
+void KRenderStateCache::SetInputLayout(const void* InInputLayout)
+{
+    if (Track(InputLayout.Update(InInputLayout)))
+    {
+        Sink->SetInputLayout(InInputLayout);
+    }
+}
+
+void KRenderStateCache::SetShader(EShaderType Stage, const void* Shader)
+{
+    if (Track(Shaders[static_cast<uint32>(Stage)].Update(Shader)))
+    {
+        Sink->SetShader(Stage, Shader);
+    }
+}
+
+void KRenderStateCache::SetPrimitiveTopology(EPrimitiveTopology InTopology)
+{
+    if (Track(Topology.Update(InTopology)))
+    {
+        Sink->SetPrimitiveTopology(InTopology);
+    }
+}
+
+void KRenderStateCache::SetVertexBuffer(uint32 Slot, const void* Buffer, uint32 Stride, uint32 Offset)
+{
+    bool bChanged = Slot >= MaxVertexBufferSlots || VertexBuffers[Slot].Update({ Buffer, Stride, Offset });
+    if (Track(bChanged))
+    {
+        Sink->SetVertexBuffer(Slot, Buffer, Stride, Offset);
+    }
+}
+
+void KRenderStateCache::SetIndexBuffer(const void* Buffer, EIndexFormat Format, uint32 Offset)
+{
+    if (Track(IndexBuffer.Update({ Buffer, Format, Offset })))
+    {
+        Sink->SetIndexBuffer(Buffer, Format, Offset);
+    }
+}
+
+void KRenderStateCache::SetConstantBuffer(EShaderType Stage, uint32 Slot, const void* Buffer,
+                                          uint32 FirstConstant, uint32 NumConstants)
+{
+    bool bChanged = Slot >= MaxConstantBufferSlots ||
+                    ConstantBuffers[static_cast<uint32>(Stage)][Slot].Update({ Buffer, FirstConstant, NumConstants });
+    if (Track(bChanged))
+    {
+        Sink->SetConstantBuffer(Stage, Slot, Buffer, FirstConstant, NumConstants);
+    }
+}
+
+void KRenderStateCache::SetShaderResource(EShaderType Stage, uint32 Slot, const void* View)
+{
+    bool bChanged = Slot >= MaxShaderResourceSlots || ShaderResources[static_cast<uint32>(Stage)][Slot].Update(View);
+    if (Track(bChanged))
+    {
+        Sink->SetShaderResource(Stage, Slot, View);
+    }
+}
+
+void KRenderStateCache::SetSampler(EShaderType Stage, uint32 Slot, const void* Sampler)
+{
+    bool bChanged = Slot >= MaxSamplerSlots || Samplers[static_cast<uint32>(Stage)][Slot].Update(Sampler);
+    if (Track(bChanged))
+    {
+        Sink->SetSampler(Stage, Slot, Sampler);
+    }
+}
+
+void KRenderStateCache::SetDepthStencilState(const void* State, uint32 StencilRef)
+{
+    if (Track(DepthStencil.Update({ State, StencilRef })))
+    {
+        Sink->SetDepthStencilState(State, StencilRef);
+    }
+}
+
+void KRenderStateCache::SetViewport(const FViewportRect& InViewport)
+{
+    if (Track(Viewport.Update(InViewport)))
+    {
+        Sink->SetViewport(InViewport);
+    }
+}
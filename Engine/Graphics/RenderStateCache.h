@@ -0,0 +1,187 @@
+﻿#pragma once
+
+#include "../Utils/Types.h"
+#include "GraphicsTypes.h"
+
+/**
+ * @brief Receiver of pipeline state changes
+ *
+ * Resources are passed as opaque native handles. Constant buffers may be bound
+ * by range (in 16-byte constants); NumConstants == 0 binds the whole buffer.
+ * The DirectX 11 implementation
+ * forwards to ID3D11DeviceContext; tests can implement it to record calls.
+ */
+class IRenderStateSink
+{
+public:
+    virtual ~IRenderStateSink() = default;
+
+    virtual void SetInputLayout(const void* InputLayout) = 0;
+    virtual void SetShader(EShaderType Stage, const void* Shader) = 0;
+    virtual void SetPrimitiveTopology(EPrimitiveTopology Topology) = 0;
+    virtual void SetVertexBuffer(uint32 Slot, const void* Buffer, uint32 Stride, uint32 Offset) = 0;
+    virtual void SetIndexBuffer(const void* Buffer, EIndexFormat Format, uint32 Offset) = 0;
+    virtual void SetConstantBuffer(EShaderType Stage, uint32 Slot, const void* Buffer,
+                                   uint32 FirstConstant, uint32 NumConstants) = 0;
+    virtual void SetShaderResource(EShaderType Stage, uint32 Slot, const void* View) = 0;
+    virtual void SetSampler(EShaderType Stage, uint32 Slot, const void* Sampler) = 0;
+    virtual void SetDepthStencilState(const void* State, uint32 StencilRef) = 0;
+    virtual void SetViewport(const FViewportRect& Viewport) = 0;
+};
+
+/**
+ * @brief State cache statistics
+ */
+struct FRenderStateStats
+{
+    uint64 CallsIssued = 0;
+    uint64 CallsSkipped = 0;
+};
+
+/**
+ * @brief Shadow copy of the bound pipeline state
+ *
+ * Tracks what is currently bound and forwards only actual changes to the sink.
+ * Slots outside the tracked range are always forwarded.
+ */
+class KRenderStateCache
+{
+public:
+    static constexpr uint32 MaxVertexBufferSlots = 4;
+    static constexpr uint32 MaxConstantBufferSlots = 8;
+    static constexpr uint32 MaxShaderResourceSlots = 8;
+    static constexpr uint32 MaxSamplerSlots = 8;
+
+    KRenderStateCache() { Invalidate(); }
+    explicit KRenderStateCache(IRenderStateSink* InSink) : Sink(InSink) { Invalidate(); }
+
+    /**
+     * @brief Set the sink receiving state changes (invalidates the cache)
+     */
+    void SetSink(IRenderStateSink* InSink);
+    IRenderStateSink* GetSink() const { return Sink; }
+
+    /**
+     * @brief Forget all tracked state so every following call is issued
+     *
+     * Required after anything touches the device context behind the cache's back.
+     */
+    void Invalidate();
+
+    void SetInputLayout(const void* InputLayout);
+    void SetShader(EShaderType Stage, const void* Shader);
+    void SetPrimitiveTopology(EPrimitiveTopology Topology);
+    void SetVertexBuffer(uint32 Slot, const void* Buffer, uint32 Stride, uint32 Offset);
+    void SetIndexBuffer(const void* Buffer, EIndexFormat Format, uint32 Offset);
+    void SetConstantBuffer(EShaderType Stage, uint32 Slot, const void* Buffer,
+                           uint32 FirstConstant = 0, uint32 NumConstants = 0);
+    void SetShaderResource(EShaderType Stage, uint32 Slot, const void* View);
+    void SetSampler(EShaderType Stage, uint32 Slot, const void* Sampler);
+    void SetDepthStencilState(const void* State, uint32 StencilRef = 0);
+    void SetViewport(const FViewportRect& Viewport);
+
+    // Statistics
+    const FRenderStateStats& GetStats() const { return Stats; }
+    void ResetStats() { Stats = FRenderStateStats(); }
+
+private:
+    /**
+     * @brief Tracked value; bKnown is false after invalidation
+     */
+    template<typename T>
+    struct TTrackedState
+    {
+        T Value{};
+        bool bKnown = false;
+
+        bool Update(const T& NewValue)
+        {
+            if (bKnown && Value == NewValue)
+            {
+                return false;
+            }
+            Value = NewValue;
+            bKnown = true;
+            return true;
+        }
+    };
+
+    struct FVertexBufferBinding
+    {
+        const void* Buffer;
+        uint32 Stride;
+        uint32 Offset;
+
+        bool operator==(const FVertexBufferBinding& Other) const
+        {
+            return Buffer == Other.Buffer && Stride == Other.Stride && Offset == Other.Offset;
+        }
+    };
+
+    struct FIndexBufferBinding
+    {
+        const void* Buffer;
+        EIndexFormat Format;
+        uint32 Offset;
+
+        bool operator==(const FIndexBufferBinding& Other) const
+        {
+            return Buffer == Other.Buffer && Format == Other.Format && Offset == Other.Offset;
+        }
+    };
+
+    struct FConstantBufferBinding
+    {
+        const void* Buffer;
+        uint32 FirstConstant;
+        uint32 NumConstants;
+
+        bool operator==(const FConstantBufferBinding& Other) const
+        {
+            return Buffer == Other.Buffer && FirstConstant == Other.FirstConstant && NumConstants == Other.NumConstants;
+        }
+    };
+
+    struct FDepthStencilBinding
+    {
+        const void* State;
+        uint32 StencilRef;
+
+        bool operator==(const FDepthStencilBinding& Other) const
+        {
+            return State == Other.State && StencilRef == Other.StencilRef;
+        }
+    };
+
+    /**
+     * @brief Count a call and report whether it has to be issued
+     */
+    bool Track(bool bChanged)
+    {
+        if (bChanged)
+        {
+            ++Stats.CallsIssued;
+        }
+        else
+        {
+            ++Stats.CallsSkipped;
+        }
+        return bChanged && Sink;
+    }
+
+private:
+    IRenderStateSink* Sink = nullptr;
+
+    TTrackedState<const void*> InputLayout;
+    TTrackedState<const void*> Shaders[ShaderTypeCount];
+    TTrackedState<EPrimitiveTopology> Topology;
+    TTrackedState<FVertexBufferBinding> VertexBuffers[MaxVertexBufferSlots];
+    TTrackedState<FIndexBufferBinding> IndexBuffer;
+    TTrackedState<FConstantBufferBinding> ConstantBuffers[ShaderTypeCount][MaxConstantBufferSlots];
+    TTrackedState<const void*> ShaderResources[ShaderTypeCount][MaxShaderResourceSlots];
+    TTrackedState<const void*> Samplers[ShaderTypeCount][MaxSamplerSlots];
+    TTrackedState<FDepthStencilBinding> DepthStencil;
+    TTrackedState<FViewportRect> Viewport;
+
+    FRenderStateStats Stats;
+};
@@ -1,14 +1,40 @@
 ﻿#include "Renderer.h"
+#include "../Core/Profiler.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+static_assert(FMeshLODSettings::MaxLODs <= (1u << DrawKey::MeshLODBits), "Mesh LODs must fit the draw key");
 
 HRESULT KRenderer::Initialize(KGraphicsDevice* InGraphicsDevice)
 {
-    if (!InGraphicsDevice)
+    if (!InGraphicsDevice || !InGraphicsDevice->GetRHIDevice())
     {
         LOG_ERROR("Invalid graphics device");
         return E_INVALIDARG;
     }
 
+    // Frames also clear and present the device's swap chain
     GraphicsDevice = InGraphicsDevice;
+    return Initialize(GraphicsDevice->GetRHIDevice(), GraphicsDevice->GetWidth(), GraphicsDevice->GetHeight());
+}
+
+HRESULT KRenderer::Initialize(IRHIDevice* InRHIDevice, UINT32 Width, UINT32 Height)
+{
+    if (!InRHIDevice)
+    {
+        LOG_ERROR("Invalid RHI device");
+        return E_INVALIDARG;
+    }
+
+    RHIDevice = InRHIDevice;
+    OutputWidth = Width;
+    OutputHeight = Height;
+
+    // Route state changes through the shadow state cache
+    RHIContext = RHIDevice->GetImmediateContext();
+    StateCache.SetSink(RHIContext);
 
     LOG_INFO("Initializing Renderer...");
 
@@ -26,38 +52,221 @@ HRESULT KRenderer::Initialize(KGraphicsDevice* InGraphicsDevice)
 
 void KRenderer::BeginFrame(KCamera* InCamera, const float ClearColor[4])
 {
-    if (!GraphicsDevice || !InCamera)
+    KE_PROFILE_FUNCTION();
+
+    if (!RHIDevice || !InCamera)
     {
         return;
     }
 
-    CurrentCamera = InCamera;
     bInFrame = true;
+    bMultiView = false;
+    RenderViews.clear();
+
+    SetViewCamera(InCamera);
+    BeginFrameCommon(ClearColor);
+}
+
+void KRenderer::BeginFrame(const FRenderView* Views, UINT32 ViewCount, const float ClearColor[4])
+{
+    KE_PROFILE_FUNCTION();
+
+    if (!RHIDevice || !Views || ViewCount == 0 || ViewCount > MaxRenderViews)
+    {
+        LOG_WARNING("Invalid render views, count: " + std::to_string(ViewCount));
+        return;
+    }
+
+    for (UINT32 View = 0; View < ViewCount; ++View)
+    {
+        if (!Views[View].Camera)
+        {
+            LOG_WARNING("Render view without a camera");
+            return;
+        }
+        Views[View].Camera->UpdateMatrices();
+    }
+
+    bInFrame = true;
+    bMultiView = true;
+    RenderViews.assign(Views, Views + ViewCount);
+
+    // Immediate draws go to the first view
+    SetViewCamera(Views[0].Camera);
+    BeginFrameCommon(ClearColor);
+    SetViewport(Views[0].Viewport);
+}
+
+void KRenderer::SetViewCamera(KCamera* InCamera)
+{
+    CurrentCamera = InCamera;
 
     // Update camera matrices
     CurrentCamera->UpdateMatrices();
+    ViewFrustum = CurrentCamera->GetFrustum();
+
+    // Projected size of a unit radius, for LOD selection
+    bLODPerspective = CurrentCamera->GetProjectionType() == ECameraProjectionType::Perspective;
+    if (bLODPerspective)
+    {
+        const float HalfFovTan = std::tan(CurrentCamera->GetFovY() * 0.5f);
+        LODScreenScale = HalfFovTan > 0.0f ? 1.0f / HalfFovTan : 1.0f;
+    }
+    else
+    {
+        const float OrthoHeight = CurrentCamera->GetOrthoHeight();
+        LODScreenScale = OrthoHeight > 0.0f ? 2.0f / OrthoHeight : 1.0f;
+    }
+    LODViewOrigin = CurrentCamera->GetPosition();
+}
+
+void KRenderer::BeginFrameCommon(const float ClearColor[4])
+{
+    CullingStats = FCullingStats();
+
+    // Reset deferred submission state (sort ids are only meaningful within a frame)
+    RenderQueue.Reset();
+    QueuedObjects.clear();
+    QueuedLODs.clear();
+    QueueCuller.Reset();
+    ShaderSortIds.Reset();
+    TextureSortIds.Reset();
+    MeshSortIds.Reset();
+
+    if (bOcclusionCulling)
+    {
+        XMFLOAT4X4 ViewProjection;
+        XMStoreFloat4x4(&ViewProjection, CurrentCamera->GetViewProjectionMatrix());
+        OcclusionCuller.BeginFrame(&ViewProjection.m[0][0]);
+    }
+
+    // Bindings may have been changed outside the renderer since last frame
+    StateCache.Invalidate();
+    StateCache.ResetStats();
+
+    // Recycle constant memory of frames the GPU has finished
+    ConstantAllocator.BeginFrame(*RHIContext);
+    DebugDrawMesh.BeginFrame();
+
+    // View/Projection change once per frame; upload them once
+    UploadFrameConstants();
 
-    // Begin frame on graphics device
-    GraphicsDevice->BeginFrame(ClearColor);
+    // Begin frame on graphics device (headless renderers have no back buffer to clear)
+    if (GraphicsDevice)
+    {
+        GraphicsDevice->BeginFrame(ClearColor);
+    }
 }
 
 void KRenderer::EndFrame(bool bVSync)
 {
-    if (!GraphicsDevice || !bInFrame)
+    KE_PROFILE_FUNCTION();
+
+    if (!RHIDevice || !bInFrame)
     {
         return;
     }
 
+    if (bMultiView)
+    {
+        // Every view draws its list, then the debug primitives over it
+        UploadDebugDraw();
+        FlushMultiViewQueue();
+    }
+    else
+    {
+        // Draw queued objects in sorted order
+        FlushRenderQueue();
+
+        // Debug primitives go over the scene
+        UploadDebugDraw();
+        RenderDebugDraw();
+    }
+    DebugDraw.EndFrame();
+
+    // Fence this frame's constant allocations
+    ConstantAllocator.EndFrame(*RHIContext);
+
     // End frame on graphics device
-    GraphicsDevice->EndFrame(bVSync);
+    if (GraphicsDevice)
+    {
+        GraphicsDevice->EndFrame(bVSync);
+    }
 
     bInFrame = false;
+    bMultiView = false;
+    RenderViews.clear();
     CurrentCamera = nullptr;
 }
 
+void KRenderer::BeginView(const FRenderView& View)
+{
+    SetViewCamera(View.Camera);
+    SetViewport(View.Viewport);
+    UploadFrameConstants();
+}
+
+void KRenderer::SetViewport(const float Viewport[4])
+{
+    // The swap chain may have been resized since Initialize
+    const float Width = static_cast<float>(GraphicsDevice ? GraphicsDevice->GetWidth() : OutputWidth);
+    const float Height = static_cast<float>(GraphicsDevice ? GraphicsDevice->GetHeight() : OutputHeight);
+
+    FViewportRect PixelViewport;
+    PixelViewport.TopLeftX = Viewport[0] * Width;
+    PixelViewport.TopLeftY = Viewport[1] * Height;
+    PixelViewport.Width = Viewport[2] * Width;
+    PixelViewport.Height = Viewport[3] * Height;
+
+    StateCache.SetViewport(PixelViewport);
+}
+
+bool KRenderer::SetParallelRecording(KJobSystem* InJobSystem)
+{
+    ParallelRecorder.Cleanup();
+
+    if (!InJobSystem || !RHIDevice)
+    {
+        return InJobSystem == nullptr;
+    }
+
+    if (!ParallelRecorder.Initialize(RHIDevice, InJobSystem))
+    {
+        LOG_WARNING("Parallel command recording is not available; recording on the calling thread");
+        return false;
+    }
+
+    LOG_INFO("Parallel command recording enabled, chunks: " + std::to_string(ParallelRecorder.GetMaxChunks()));
+    return true;
+}
+
+void KRenderer::SetOcclusionCulling(bool bEnable, KJobSystem* InJobSystem, const FOcclusionCullerSettings& Settings)
+{
+    bOcclusionCulling = bEnable;
+    OcclusionJobSystem = InJobSystem;
+    if (bEnable)
+    {
+        OcclusionCuller.Initialize(Settings);
+    }
+}
+
+void KRenderer::AddOccluder(const FOccluderMesh& Mesh, const XMMATRIX& WorldMatrix)
+{
+    if (!bOcclusionCulling || !bInFrame || bMultiView)
+    {
+        return;
+    }
+
+    XMFLOAT4X4 World;
+    XMStoreFloat4x4(&World, WorldMatrix);
+    OcclusionCuller.AddOccluder(Mesh, &World.m[0][0]);
+}
+
 void KRenderer::RenderObject(const FRenderObject& RenderObject)
 {
-    if (!GraphicsDevice || !CurrentCamera || !bInFrame)
+    KE_PROFILE_FUNCTION();
+
+    if (!RHIDevice || !CurrentCamera || !bInFrame)
     {
         return;
     }
@@ -67,36 +276,721 @@ void KRenderer::RenderObject(const FRenderObject& RenderObject)
         return;
     }
 
-    ID3D11DeviceContext* Context = GraphicsDevice->GetContext();
+    if (bDeferredSubmission || bMultiView)
+    {
+        // Culled as a batch and keyed when the queue is flushed
+        if (bFrustumCulling)
+        {
+            QueueCuller.Add(ComputeWorldBounds(*RenderObject.Mesh, RenderObject.WorldMatrix));
+        }
+        QueuedObjects.push_back(RenderObject);
+        return;
+    }
+
+    if (bFrustumCulling)
+    {
+        ++CullingStats.Tested;
+        if (!Bounds::Intersects(ViewFrustum, ComputeWorldBounds(*RenderObject.Mesh, RenderObject.WorldMatrix)))
+        {
+            ++CullingStats.Culled;
+            return;
+        }
+    }
+
+    DrawRenderObject(RenderObject, SelectMeshLOD(*RenderObject.Mesh, RenderObject.WorldMatrix));
+}
+
+void KRenderer::RenderVisibleObjects(const ISpatialIndex& SpatialIndex, const FRenderObject* Objects, uint32 ObjectCount)
+{
+    KE_PROFILE_FUNCTION();
+
+    if (!RHIDevice || !CurrentCamera || !bInFrame)
+    {
+        return;
+    }
+
+    SpatialQueryResults.clear();
+    if (bMultiView)
+    {
+        for (const FRenderView& View : RenderViews)
+        {
+            SpatialIndex.QueryFrustum(View.Camera->GetFrustum(), SpatialQueryResults);
+        }
+
+        // Objects seen by several views are submitted once
+        std::sort(SpatialQueryResults.begin(), SpatialQueryResults.end());
+        SpatialQueryResults.erase(std::unique(SpatialQueryResults.begin(), SpatialQueryResults.end()),
+                                  SpatialQueryResults.end());
+    }
+    else
+    {
+        SpatialIndex.QueryFrustum(ViewFrustum, SpatialQueryResults);
+    }
+
+    for (uint32 Index : SpatialQueryResults)
+    {
+        if (Index < ObjectCount)
+        {
+            RenderObject(Objects[Index]);
+        }
+    }
+}
+
+void KRenderer::DrawRenderObject(const FRenderObject& RenderObject, UINT32 LOD)
+{
+    // Bind shader program (unchanged state is skipped by the cache)
+    RenderObject.Shader->Bind(StateCache, RenderObject.Mesh->GetVertexLayout());
+
+    // Bind texture
+    BindTexture(StateCache, RenderObject.Texture.get());
+
+    // Upload the world matrix, then bind frame constants
+    // (in this order, so a ring discard during the object upload is noticed)
+    if (!BindObjectConstants(GetMeshWorldMatrix(*RenderObject.Mesh, RenderObject.WorldMatrix)))
+    {
+        return;
+    }
+    BindFrameConstants();
+
+    // Bind mesh buffers, then draw
+    RenderObject.Mesh->Bind(StateCache);
+    RenderObject.Mesh->Draw(*RHIContext, LOD);
+}
 
-    // Bind shader program
-    RenderObject.Shader->Bind(Context);
+void KRenderer::DrawInstancedBatch(const FRenderObject& Template, const XMMATRIX* WorldMatrices, UINT32 InstanceCount,
+                                   UINT32 LOD)
+{
+    KShaderProgram* InstancedProgram = Template.Shader->GetInstancedVariant();
+    if (!InstancedProgram)
+    {
+        // No instanced variant: fall back to one draw per instance
+        FRenderObject Instance = Template;
+        for (UINT32 i = 0; i < InstanceCount; ++i)
+        {
+            Instance.WorldMatrix = WorldMatrices[i];
+            DrawRenderObject(Instance, LOD);
+        }
+        return;
+    }
 
-    // Bind texture if available
-    if (RenderObject.Texture)
+    UINT32 StartInstance = UploadInstanceData(WorldMatrices, InstanceCount, Template.Mesh.get());
+    if (StartInstance == UINT32_MAX)
     {
-        RenderObject.Texture->Bind(Context, 0);
+        return;
     }
 
-    // Update mesh constant buffer with matrices
-    RenderObject.Mesh->UpdateConstantBuffer(
-        Context,
-        RenderObject.WorldMatrix,
-        CurrentCamera->GetViewMatrix(),
-        CurrentCamera->GetProjectionMatrix()
+    // World comes from the instance stream; only frame constants are needed
+    BindFrameConstants();
+
+    // Bind instanced program and texture
+    InstancedProgram->Bind(StateCache, Template.Mesh->GetVertexLayout());
+    BindTexture(StateCache, Template.Texture.get());
+
+    // Bind mesh buffers and instance stream, then draw
+    Template.Mesh->Bind(StateCache);
+    StateCache.SetVertexBuffer(VertexFormat::InstanceStreamSlot, InstanceBuffer.Get(), sizeof(XMFLOAT4X4), 0);
+    Template.Mesh->DrawInstanced(*RHIContext, InstanceCount, StartInstance, LOD);
+}
+
+void KRenderer::DrawInstancedLODs(const FRenderObject& Template, const XMMATRIX* WorldMatrices, UINT32 InstanceCount)
+{
+    const UINT32 LODCount = Template.Mesh->GetLODCount();
+    if (!bLODSelection || LODCount <= 1)
+    {
+        DrawInstancedBatch(Template, WorldMatrices, InstanceCount);
+        return;
+    }
+
+    InstanceLODScratch.resize(InstanceCount);
+    UINT32 LODMask = 0;
+    for (UINT32 i = 0; i < InstanceCount; ++i)
+    {
+        const UINT32 LOD = SelectMeshLOD(*Template.Mesh, WorldMatrices[i]);
+        InstanceLODScratch[i] = static_cast<uint8>(LOD);
+        LODMask |= 1u << LOD;
+    }
+
+    // Common case: every instance picked the same LOD
+    if ((LODMask & (LODMask - 1)) == 0)
+    {
+        DrawInstancedBatch(Template, WorldMatrices, InstanceCount, InstanceLODScratch[0]);
+        return;
+    }
+
+    for (UINT32 LOD = 0; LOD < LODCount; ++LOD)
+    {
+        if ((LODMask & (1u << LOD)) == 0)
+        {
+            continue;
+        }
+
+        LODInstanceScratch.clear();
+        for (UINT32 i = 0; i < InstanceCount; ++i)
+        {
+            if (InstanceLODScratch[i] == LOD)
+            {
+                LODInstanceScratch.push_back(WorldMatrices[i]);
+            }
+        }
+        DrawInstancedBatch(Template, LODInstanceScratch.data(), static_cast<UINT32>(LODInstanceScratch.size()), LOD);
+    }
+}
+
+UINT32 KRenderer::SelectMeshLOD(const KMesh& Mesh, const XMMATRIX& WorldMatrix) const
+{
+    if (!bLODSelection || Mesh.GetLODCount() <= 1)
+    {
+        return 0;
+    }
+
+    // Sphere around the world box: projected diameter over the view height
+    const FBoundingBox WorldBounds = ComputeWorldBounds(Mesh, WorldMatrix);
+    const float Radius = std::sqrt(WorldBounds.Extents[0] * WorldBounds.Extents[0] +
+                                   WorldBounds.Extents[1] * WorldBounds.Extents[1] +
+                                   WorldBounds.Extents[2] * WorldBounds.Extents[2]);
+
+    float ScreenSize = Radius * LODScreenScale;
+    if (bLODPerspective)
+    {
+        const float DX = WorldBounds.Center[0] - LODViewOrigin.x;
+        const float DY = WorldBounds.Center[1] - LODViewOrigin.y;
+        const float DZ = WorldBounds.Center[2] - LODViewOrigin.z;
+        const float Distance = std::sqrt(DX * DX + DY * DY + DZ * DZ);
+
+        // Inside the bounds: full detail
+        ScreenSize = Distance > Radius ? ScreenSize / Distance : FLT_MAX;
+    }
+
+    return Mesh.SelectLOD(ScreenSize * LODScale);
+}
+
+bool KRenderer::UploadFrameConstants()
+{
+    const XMMATRIX& ViewMatrix = CurrentCamera->GetViewMatrix();
+    const XMMATRIX& ProjectionMatrix = CurrentCamera->GetProjectionMatrix();
+
+    FPerFrameConstants Constants;
+    XMStoreFloat4x4(&Constants.ViewMatrix, ViewMatrix);
+    XMStoreFloat4x4(&Constants.ProjectionMatrix, ProjectionMatrix);
+    XMStoreFloat4x4(&Constants.ViewProjectionMatrix, CurrentCamera->GetViewProjectionMatrix());
+
+    FrameConstants = FConstantBufferAllocation();
+    bool bResult = ConstantAllocator.Upload(*RHIContext, &Constants, sizeof(Constants), FrameConstants);
+    FrameConstantsDiscardCount = ConstantAllocator.GetDiscardCount();
+    return bResult;
+}
+
+void KRenderer::BindFrameConstants()
+{
+    // A discard renamed the ring buffer and dropped the frame constants
+    if (FrameConstantsDiscardCount != ConstantAllocator.GetDiscardCount())
+    {
+        UploadFrameConstants();
+    }
+
+    StateCache.SetConstantBuffer(EShaderType::Vertex, ShaderConstantSlots::PerFrame, FrameConstants.Buffer,
+                                 FrameConstants.FirstConstant, FrameConstants.NumConstants);
+}
+
+bool KRenderer::BindObjectConstants(const XMMATRIX& WorldMatrix)
+{
+    // Matrices are row_major in HLSL: no transpose needed
+    FPerObjectConstants Constants;
+    XMStoreFloat4x4(&Constants.WorldMatrix, WorldMatrix);
+
+    FConstantBufferAllocation Allocation;
+    if (!ConstantAllocator.Upload(*RHIContext, &Constants, sizeof(Constants), Allocation))
+    {
+        return false;
+    }
+
+    StateCache.SetConstantBuffer(EShaderType::Vertex, ShaderConstantSlots::PerObject, Allocation.Buffer,
+                                 Allocation.FirstConstant, Allocation.NumConstants);
+    return true;
+}
+
+void KRenderer::BindTexture(KRenderStateCache& InStateCache, const KTexture* InTexture)
+{
+    if (InTexture)
+    {
+        InTexture->Bind(InStateCache, 0);
+    }
+    else
+    {
+        InStateCache.SetShaderResource(EShaderType::Pixel, 0, nullptr);
+        InStateCache.SetSampler(EShaderType::Pixel, 0, nullptr);
+    }
+}
+
+HRESULT KRenderer::CreateInstanceBuffer(UINT32 Capacity)
+{
+    InstanceBuffer.Reset();
+    InstanceBufferCapacity = 0;
+    InstanceBufferCursor = 0;
+
+    FRHIBufferDesc BufferDesc;
+    BufferDesc.Usage = ERHIBufferUsage::Dynamic;
+    BufferDesc.ByteWidth = sizeof(XMFLOAT4X4) * Capacity;
+    BufferDesc.BindFlags = RHIBindFlags::VertexBuffer;
+
+    InstanceBuffer.Reset(RHIDevice, RHIDevice->CreateBuffer(BufferDesc, nullptr));
+    if (!InstanceBuffer)
+    {
+        LOG_ERROR("Instance buffer creation failed");
+        return E_FAIL;
+    }
+
+    InstanceBufferCapacity = Capacity;
+    return S_OK;
+}
+
+UINT32 KRenderer::UploadInstanceData(const XMMATRIX* WorldMatrices, UINT32 InstanceCount, const KMesh* Mesh)
+{
+    // Grow to the next power of two that fits the batch
+    bool bDiscard = false;
+    if (InstanceCount > InstanceBufferCapacity)
+    {
+        UINT32 NewCapacity = InstanceBufferCapacity > 0 ? InstanceBufferCapacity : DefaultInstanceCapacity;
+        while (NewCapacity < InstanceCount)
+        {
+            NewCapacity *= 2;
+        }
+
+        if (FAILED(CreateInstanceBuffer(NewCapacity)))
+        {
+            return UINT32_MAX;
+        }
+        bDiscard = true;
+    }
+
+    // Wrap around: discard so the GPU keeps reading the old contents
+    if (InstanceBufferCursor + InstanceCount > InstanceBufferCapacity)
+    {
+        InstanceBufferCursor = 0;
+        bDiscard = true;
+    }
+
+    void* MappedData = RHIContext->Map(InstanceBuffer.Get(),
+                                       bDiscard ? ERHIMapMode::WriteDiscard : ERHIMapMode::WriteNoOverwrite);
+    if (!MappedData)
+    {
+        return UINT32_MAX;
+    }
+
+    // Rows are stored untransposed; the shader rebuilds the matrix from them
+    XMFLOAT4X4* Destination = static_cast<XMFLOAT4X4*>(MappedData) + InstanceBufferCursor;
+    if (Mesh && Mesh->HasQuantizedPositions())
+    {
+        const XMMATRIX Decode = Mesh->GetPositionDecodeMatrix();
+        for (UINT32 i = 0; i < InstanceCount; ++i)
+        {
+            XMStoreFloat4x4(&Destination[i], XMMatrixMultiply(Decode, WorldMatrices[i]));
+        }
+    }
+    else
+    {
+        for (UINT32 i = 0; i < InstanceCount; ++i)
+        {
+            XMStoreFloat4x4(&Destination[i], WorldMatrices[i]);
+        }
+    }
+
+    RHIContext->Unmap(InstanceBuffer.Get());
+
+    UINT32 StartInstance = InstanceBufferCursor;
+    InstanceBufferCursor += InstanceCount;
+    return StartInstance;
+}
+
+FBoundingBox KRenderer::ComputeWorldBounds(const KMesh& Mesh, const XMMATRIX& WorldMatrix)
+{
+    XMFLOAT4X4 World;
+    XMStoreFloat4x4(&World, WorldMatrix);
+    return Bounds::TransformBox(Mesh.GetLocalBounds(), &World.m[0][0]);
+}
+
+XMMATRIX KRenderer::GetMeshWorldMatrix(const KMesh& Mesh, const XMMATRIX& WorldMatrix)
+{
+    return Mesh.HasQuantizedPositions() ? XMMatrixMultiply(Mesh.GetPositionDecodeMatrix(), WorldMatrix) : WorldMatrix;
+}
+
+void KRenderer::BuildRenderQueue()
+{
+    KE_PROFILE_FUNCTION();
+
+    const uint32 QueuedCount = static_cast<uint32>(QueuedObjects.size());
+    RenderQueue.Reserve(QueuedCount);
+    QueuedLODs.resize(QueuedCount);
+
+    // The culler only matches the queue if culling stayed enabled all frame
+    if (bFrustumCulling && QueueCuller.GetCount() == QueuedCount)
+    {
+        QueueCuller.Cull(ViewFrustum, VisibleIndices);
+        CullingStats.Tested += QueuedCount;
+        CullingStats.Culled += QueuedCount - VisibleIndices.size();
+
+        // Occluders are complete once the queue is flushed
+        if (bOcclusionCulling && OcclusionCuller.GetOccluderCount() > 0)
+        {
+            OcclusionCuller.Rasterize(OcclusionJobSystem);
+            const size_t FrustumVisibleCount = VisibleIndices.size();
+            OcclusionCuller.Cull(QueueCuller, VisibleIndices, OcclusionJobSystem);
+            CullingStats.Occluded += FrustumVisibleCount - VisibleIndices.size();
+        }
+
+        for (uint32 Index : VisibleIndices)
+        {
+            const FRenderObject& Object = QueuedObjects[Index];
+            QueuedLODs[Index] = static_cast<uint8>(SelectMeshLOD(*Object.Mesh, Object.WorldMatrix));
+            RenderQueue.Push(BuildDrawKey(Object, QueuedLODs[Index]), Index);
+        }
+    }
+    else
+    {
+        for (uint32 Index = 0; Index < QueuedCount; ++Index)
+        {
+            const FRenderObject& Object = QueuedObjects[Index];
+            QueuedLODs[Index] = static_cast<uint8>(SelectMeshLOD(*Object.Mesh, Object.WorldMatrix));
+            RenderQueue.Push(BuildDrawKey(Object, QueuedLODs[Index]), Index);
+        }
+    }
+
+    QueueCuller.Reset();
+}
+
+uint64 KRenderer::BuildDrawKey(const FRenderObject& RenderObject, UINT32 LOD)
+{
+    // View-space depth of the object origin
+    XMVECTOR ViewPosition = XMVector3TransformCoord(RenderObject.WorldMatrix.r[3], CurrentCamera->GetViewMatrix());
+    float ViewDepth = XMVectorGetZ(ViewPosition);
+
+    uint32 Depth = DrawKey::QuantizeDepth(ViewDepth, CurrentCamera->GetNearZ(), CurrentCamera->GetFarZ(),
+                                          RenderObject.RenderPass == ERenderPass::Transparent);
+
+    return DrawKey::Make(
+        RenderObject.RenderPass,
+        ShaderSortIds.GetId(RenderObject.Shader.get()),
+        TextureSortIds.GetId(RenderObject.Texture.get()),
+        DrawKey::MakeMeshId(MeshSortIds.GetId(RenderObject.Mesh.get()), LOD),
+        Depth
     );
+}
+
+void KRenderer::FlushRenderQueue()
+{
+    KE_PROFILE_FUNCTION();
+
+    BuildRenderQueue();
+    DrawRenderQueue();
+
+    QueuedObjects.clear();
+    QueuedLODs.clear();
+}
+
+void KRenderer::FlushMultiViewQueue()
+{
+    KE_PROFILE_FUNCTION();
+
+    const uint32 QueuedCount = static_cast<uint32>(QueuedObjects.size());
+    const UINT32 ViewCount = static_cast<UINT32>(RenderViews.size());
+    if (ViewIndices.size() < ViewCount)
+    {
+        ViewIndices.resize(ViewCount);
+    }
+
+    // One pass tests each object against every view; the masks are then split into per-view lists
+    if (bFrustumCulling && QueueCuller.GetCount() == QueuedCount)
+    {
+        ViewFrustums.resize(ViewCount);
+        for (UINT32 View = 0; View < ViewCount; ++View)
+        {
+            ViewFrustums[View] = RenderViews[View].Camera->GetFrustum();
+        }
+
+        QueueCuller.CullViews(ViewFrustums.data(), ViewCount, ViewMasks);
+        KFrustumCuller::GatherViewIndices(ViewMasks.data(), QueuedCount, ViewCount, ViewIndices.data());
+
+        for (UINT32 View = 0; View < ViewCount; ++View)
+        {
+            CullingStats.Tested += QueuedCount;
+            CullingStats.Culled += QueuedCount - ViewIndices[View].size();
+        }
+    }
+    else
+    {
+        for (UINT32 View = 0; View < ViewCount; ++View)
+        {
+            ViewIndices[View].resize(QueuedCount);
+            for (uint32 Index = 0; Index < QueuedCount; ++Index)
+            {
+                ViewIndices[View][Index] = Index;
+            }
+        }
+    }
+    QueueCuller.Reset();
+
+    QueuedLODs.resize(QueuedCount);
+    RenderQueue.Reserve(QueuedCount);
+    for (UINT32 View = 0; View < ViewCount; ++View)
+    {
+        // LODs and sort keys depend on the view's camera
+        BeginView(RenderViews[View]);
+        for (uint32 Index : ViewIndices[View])
+        {
+            const FRenderObject& Object = QueuedObjects[Index];
+            QueuedLODs[Index] = static_cast<uint8>(SelectMeshLOD(*Object.Mesh, Object.WorldMatrix));
+            RenderQueue.Push(BuildDrawKey(Object, QueuedLODs[Index]), Index);
+        }
+
+        DrawRenderQueue();
+        RenderDebugDraw();
+    }
+
+    // Back to the full back buffer for the next frame
+    const float FullViewport[4] = { 0.0f, 0.0f, 1.0f, 1.0f };
+    SetViewport(FullViewport);
+
+    QueuedObjects.clear();
+    QueuedLODs.clear();
+}
+
+void KRenderer::DrawRenderQueue()
+{
+    if (RenderQueue.IsEmpty())
+    {
+        return;
+    }
+
+    RenderQueue.Sort();
+    BuildDrawBatches();
+
+    const UINT32 MaxObjectsPerUpload = ConstantAllocator.GetSize() / (2 * KConstantBufferAllocator::Alignment);
+    if (ParallelRecorder.IsInitialized() && MaxObjectsPerUpload > 0 &&
+        DrawBatches.size() >= 2 * MinDrawsPerRecordChunk)
+    {
+        FlushDrawBatchesParallel();
+    }
+    else
+    {
+        const std::vector<FRenderQueueItem>& Items = RenderQueue.GetItems();
+        for (const FDrawBatch& Batch : DrawBatches)
+        {
+            if (Batch.InstanceCount > 0)
+            {
+                InstanceScratch.clear();
+                for (UINT32 i = 0; i < Batch.InstanceCount; ++i)
+                {
+                    InstanceScratch.push_back(QueuedObjects[Items[Batch.FirstItem + i].Index].WorldMatrix);
+                }
+                DrawInstancedBatch(*Batch.Object, InstanceScratch.data(), Batch.InstanceCount, Batch.LOD);
+            }
+            else
+            {
+                DrawRenderObject(*Batch.Object, Batch.LOD);
+            }
+        }
+    }
+
+    DrawBatches.clear();
+    RenderQueue.Reset();
+}
+
+void KRenderer::BuildDrawBatches()
+{
+    DrawBatches.clear();
+
+    const std::vector<FRenderQueueItem>& Items = RenderQueue.GetItems();
+    size_t First = 0;
+    while (First < Items.size())
+    {
+        const FRenderObject& FirstObject = QueuedObjects[Items[First].Index];
+        const uint8 FirstLOD = QueuedLODs[Items[First].Index];
+
+        // Runs sharing pass/shader/texture/mesh/LOD are merged into one instanced draw;
+        // transparent draws stay individual so their back-to-front order is kept
+        size_t Last = First + 1;
+        if (FirstObject.Shader->GetInstancedVariant() && !DrawKey::IsDepthMajor(FirstObject.RenderPass))
+        {
+            size_t BatchEnd = RenderQueue.FindBatchEnd(First);
+            while (Last < BatchEnd)
+            {
+                // Guard against sort id aliasing
+                const FRenderObject& Object = QueuedObjects[Items[Last].Index];
+                if (Object.Mesh != FirstObject.Mesh || Object.Shader != FirstObject.Shader ||
+                    Object.Texture != FirstObject.Texture || QueuedLODs[Items[Last].Index] != FirstLOD)
+                {
+                    break;
+                }
+                ++Last;
+            }
+        }
+
+        FDrawBatch Batch;
+        Batch.Object = &FirstObject;
+        Batch.FirstItem = static_cast<UINT32>(First);
+        Batch.InstanceCount = Last - First >= MinAutoInstanceCount ? static_cast<UINT32>(Last - First) : 0;
+        Batch.LOD = FirstLOD;
+        DrawBatches.push_back(Batch);
+
+        First = Last;
+    }
+}
+
+void KRenderer::FlushDrawBatchesParallel()
+{
+    KE_PROFILE_FUNCTION();
+
+    // Everything a segment references is uploaded before it is recorded, so a
+    // ring discard may only happen between segments: keep each segment's
+    // object constants within half of the constant ring
+    const UINT32 MaxObjectsPerUpload = ConstantAllocator.GetSize() / (2 * KConstantBufferAllocator::Alignment);
+
+    size_t SegmentFirst = 0;
+    while (SegmentFirst < DrawBatches.size())
+    {
+        size_t SegmentLast = SegmentFirst;
+        UINT32 ObjectCount = 0;
+        while (SegmentLast < DrawBatches.size() &&
+               (DrawBatches[SegmentLast].InstanceCount > 0 || ObjectCount < MaxObjectsPerUpload))
+        {
+            if (DrawBatches[SegmentLast].InstanceCount == 0)
+            {
+                ++ObjectCount;
+            }
+            ++SegmentLast;
+        }
+
+        if (!PrepareDrawBatches(SegmentFirst, SegmentLast))
+        {
+            break;
+        }
+
+        ParallelRecorder.Record(static_cast<uint32>(SegmentLast - SegmentFirst),
+            [this, SegmentFirst](KRenderStateCache& ChunkStateCache, IRHICommandContext& Context, uint32 First, uint32 Count)
+            {
+                for (uint32 i = First; i < First + Count; ++i)
+                {
+                    RecordDrawBatch(DrawBatches[SegmentFirst + i], ChunkStateCache, Context);
+                }
+            },
+            MinDrawsPerRecordChunk);
+        ParallelRecorder.Execute();
+
+        SegmentFirst = SegmentLast;
+    }
 
-    // Render mesh
-    RenderObject.Mesh->Render(Context);
+    // Executing command lists resets the immediate context's bindings
+    StateCache.Invalidate();
+}
+
+bool KRenderer::PrepareDrawBatches(size_t First, size_t Last)
+{
+    const std::vector<FRenderQueueItem>& Items = RenderQueue.GetItems();
+
+    // One 256-byte constant slot per regular draw, one matrix per instance
+    const UINT32 SlotSize = KConstantBufferAllocator::Alignment;
+    ObjectConstantScratch.clear();
+    InstanceScratch.clear();
+
+    for (size_t i = First; i < Last; ++i)
+    {
+        FDrawBatch& Batch = DrawBatches[i];
+        if (Batch.InstanceCount > 0)
+        {
+            Batch.StartInstance = static_cast<UINT32>(InstanceScratch.size());
+            for (UINT32 j = 0; j < Batch.InstanceCount; ++j)
+            {
+                InstanceScratch.push_back(GetMeshWorldMatrix(*Batch.Object->Mesh,
+                                                             QueuedObjects[Items[Batch.FirstItem + j].Index].WorldMatrix));
+            }
+        }
+        else
+        {
+            FPerObjectConstants Constants;
+            XMStoreFloat4x4(&Constants.WorldMatrix, GetMeshWorldMatrix(*Batch.Object->Mesh, Batch.Object->WorldMatrix));
+
+            const size_t Offset = ObjectConstantScratch.size();
+            ObjectConstantScratch.resize(Offset + SlotSize);
+            std::memcpy(&ObjectConstantScratch[Offset], &Constants, sizeof(Constants));
+
+            Batch.ObjectConstants.FirstConstant = static_cast<UINT32>(Offset / 16);
+            Batch.ObjectConstants.NumConstants = SlotSize / 16;
+        }
+    }
+
+    UINT32 BaseInstance = 0;
+    if (!InstanceScratch.empty())
+    {
+        BaseInstance = UploadInstanceData(InstanceScratch.data(), static_cast<UINT32>(InstanceScratch.size()));
+        if (BaseInstance == UINT32_MAX)
+        {
+            return false;
+        }
+    }
+
+    FConstantBufferAllocation ObjectBlock;
+    if (!ObjectConstantScratch.empty())
+    {
+        if (!ConstantAllocator.Upload(*RHIContext, ObjectConstantScratch.data(),
+                                      static_cast<UINT32>(ObjectConstantScratch.size()), ObjectBlock))
+        {
+            return false;
+        }
+    }
+
+    for (size_t i = First; i < Last; ++i)
+    {
+        FDrawBatch& Batch = DrawBatches[i];
+        if (Batch.InstanceCount > 0)
+        {
+            Batch.StartInstance += BaseInstance;
+        }
+        else
+        {
+            Batch.ObjectConstants.Buffer = ObjectBlock.Buffer;
+            Batch.ObjectConstants.FirstConstant += ObjectBlock.FirstConstant;
+        }
+    }
+
+    // A discard during the upload dropped the frame constants
+    if (FrameConstantsDiscardCount != ConstantAllocator.GetDiscardCount())
+    {
+        UploadFrameConstants();
+    }
+    return true;
+}
+
+void KRenderer::RecordDrawBatch(const FDrawBatch& Batch, KRenderStateCache& InStateCache,
+                                IRHICommandContext& Context) const
+{
+    const FRenderObject& Object = *Batch.Object;
 
-    // Unbind texture
-    if (RenderObject.Texture)
+    if (Batch.InstanceCount > 0)
     {
-        RenderObject.Texture->Unbind(Context, 0);
+        Object.Shader->GetInstancedVariant()->Bind(InStateCache, Object.Mesh->GetVertexLayout());
     }
+    else
+    {
+        Object.Shader->Bind(InStateCache, Object.Mesh->GetVertexLayout());
+    }
+    BindTexture(InStateCache, Object.Texture.get());
+
+    InStateCache.SetConstantBuffer(EShaderType::Vertex, ShaderConstantSlots::PerFrame, FrameConstants.Buffer,
+                                   FrameConstants.FirstConstant, FrameConstants.NumConstants);
+
+    Object.Mesh->Bind(InStateCache);
 
-    // Unbind shader program
-    RenderObject.Shader->Unbind(Context);
+    if (Batch.InstanceCount > 0)
+    {
+        InStateCache.SetVertexBuffer(VertexFormat::InstanceStreamSlot, InstanceBuffer.Get(), sizeof(XMFLOAT4X4), 0);
+        Object.Mesh->DrawInstanced(Context, Batch.InstanceCount, Batch.StartInstance, Batch.LOD);
+    }
+    else
+    {
+        InStateCache.SetConstantBuffer(EShaderType::Vertex, ShaderConstantSlots::PerObject, Batch.ObjectConstants.Buffer,
+                                       Batch.ObjectConstants.FirstConstant, Batch.ObjectConstants.NumConstants);
+        Object.Mesh->Draw(Context, Batch.LOD);
+    }
 }
 
 void KRenderer::RenderMesh(std::shared_ptr<KMesh> InMesh, const XMMATRIX& WorldMatrix, 
@@ -117,74 +1011,501 @@ void KRenderer::RenderMeshBasic(std::shared_ptr<KMesh> InMesh, const XMMATRIX& W
     RenderMesh(InMesh, WorldMatrix, nullptr);
 }
 
+void KRenderer::RenderMeshInstanced(std::shared_ptr<KMesh> InMesh, const XMMATRIX* WorldMatrices, UINT32 InstanceCount,
+                                    std::shared_ptr<KTexture> InTexture)
+{
+    KE_PROFILE_FUNCTION();
+
+    if (!RHIDevice || !CurrentCamera || !bInFrame)
+    {
+        return;
+    }
+
+    if (!InMesh || !BasicShader || !WorldMatrices || InstanceCount == 0)
+    {
+        return;
+    }
+
+    FRenderObject RenderObject(InMesh, BasicShader, InTexture);
+
+    if (bDeferredSubmission || bMultiView)
+    {
+        // Queue individually; FlushRenderQueue merges them back into instanced draws
+        for (UINT32 i = 0; i < InstanceCount; ++i)
+        {
+            RenderObject.WorldMatrix = WorldMatrices[i];
+            KRenderer::RenderObject(RenderObject);
+        }
+        return;
+    }
+
+    if (bFrustumCulling)
+    {
+        InstanceCuller.Reset();
+        InstanceCuller.Reserve(InstanceCount);
+        for (UINT32 i = 0; i < InstanceCount; ++i)
+        {
+            InstanceCuller.Add(ComputeWorldBounds(*InMesh, WorldMatrices[i]));
+        }
+
+        const uint32 VisibleCount = InstanceCuller.Cull(ViewFrustum, VisibleIndices);
+        CullingStats.Tested += InstanceCount;
+        CullingStats.Culled += InstanceCount - VisibleCount;
+
+        if (VisibleCount < InstanceCount)
+        {
+            if (VisibleCount == 0)
+            {
+                return;
+            }
+
+            InstanceScratch.clear();
+            for (uint32 Index : VisibleIndices)
+            {
+                InstanceScratch.push_back(WorldMatrices[Index]);
+            }
+            DrawInstancedLODs(RenderObject, InstanceScratch.data(), VisibleCount);
+            return;
+        }
+    }
+
+    DrawInstancedLODs(RenderObject, WorldMatrices, InstanceCount);
+}
+
+void KRenderer::RenderMeshInstanced(std::shared_ptr<KMesh> InMesh, const std::vector<XMMATRIX>& WorldMatrices,
+                                    std::shared_ptr<KTexture> InTexture)
+{
+    RenderMeshInstanced(InMesh, WorldMatrices.data(), static_cast<UINT32>(WorldMatrices.size()), InTexture);
+}
+
+void KRenderer::RenderDynamicMesh(KDynamicMesh& InMesh, const FDynamicMeshSection& Section, const XMMATRIX& WorldMatrix,
+                                  std::shared_ptr<KTexture> InTexture)
+{
+    KE_PROFILE_FUNCTION();
+
+    if (!RHIDevice || !CurrentCamera || !bInFrame || !BasicShader)
+    {
+        return;
+    }
+
+    if (InMesh.GetUsage() == EDynamicMeshUsage::Persistent && FAILED(InMesh.Flush(*RHIContext)))
+    {
+        return;
+    }
+
+    BasicShader->Bind(StateCache, InMesh.GetVertexLayout());
+    BindTexture(StateCache, InTexture.get());
+    if (!BindObjectConstants(WorldMatrix))
+    {
+        return;
+    }
+    BindFrameConstants();
+
+    InMesh.Bind(StateCache);
+    InMesh.Draw(*RHIContext, Section);
+}
+
+void KRenderer::RenderSkinnedMesh(std::shared_ptr<KMesh> InMesh, const FSkinMatrix* Palette, UINT32 JointCount,
+                                  const XMMATRIX& WorldMatrix, std::shared_ptr<KTexture> InTexture)
+{
+    KE_PROFILE_FUNCTION();
+
+    if (!RHIDevice || !CurrentCamera || !bInFrame || !SkinnedShader || !InMesh || !InMesh->IsSkinned())
+    {
+        return;
+    }
+
+    if (!Palette || JointCount == 0 || JointCount > Animation::MaxJoints)
+    {
+        LOG_WARNING("Invalid skinning palette, joints: " + std::to_string(JointCount));
+        return;
+    }
+
+    SkinnedShader->Bind(StateCache, EVertexLayout::Skinned);
+    BindTexture(StateCache, InTexture.get());
+    if (!BindObjectConstants(WorldMatrix))
+    {
+        return;
+    }
+    BindFrameConstants();
+
+    // Uploaded last so a ring discard cannot drop it; the other slices are redone if the palette caused one
+    const UINT32 DiscardCount = ConstantAllocator.GetDiscardCount();
+    FConstantBufferAllocation PaletteAllocation;
+    if (!ConstantAllocator.Upload(*RHIContext, Palette, JointCount * sizeof(FSkinMatrix), PaletteAllocation))
+    {
+        return;
+    }
+    if (ConstantAllocator.GetDiscardCount() != DiscardCount)
+    {
+        if (!BindObjectConstants(WorldMatrix))
+        {
+            return;
+        }
+        BindFrameConstants();
+    }
+
+    StateCache.SetConstantBuffer(EShaderType::Vertex, ShaderConstantSlots::SkinPalette, PaletteAllocation.Buffer,
+                                 PaletteAllocation.FirstConstant, PaletteAllocation.NumConstants);
+
+    InMesh->Bind(StateCache);
+    InMesh->Draw(*RHIContext);
+}
+
+void KRenderer::UploadDebugDraw()
+{
+    KE_PROFILE_FUNCTION();
+
+    for (FDynamicMeshSection& Section : DebugDrawSections)
+    {
+        Section = FDynamicMeshSection();
+    }
+
+    const UINT32 TotalVertexCount = DebugDraw.GetVertexCount(EDebugDrawMode::DepthTested) +
+                                    DebugDraw.GetVertexCount(EDebugDrawMode::Overlay);
+    if (TotalVertexCount == 0 || !BasicShader || !DebugDrawMesh.GetVertexCapacity())
+    {
+        return;
+    }
+
+    // One range for every mode, so no later map can discard or grow the buffer under an earlier one
+    FDynamicMeshWriter Writer;
+    if (!DebugDrawMesh.Map(*RHIContext, TotalVertexCount, 0, Writer))
+    {
+        return;
+    }
+    UINT32 BaseVertex = Writer.Section.BaseVertex;
+    for (UINT32 Mode = 0; Mode < DebugDrawModeCount; ++Mode)
+    {
+        const UINT32 VertexCount = DebugDraw.GetVertexCount(static_cast<EDebugDrawMode>(Mode));
+        DebugDraw.CopyVertices(static_cast<EDebugDrawMode>(Mode),
+                               static_cast<FCompactVertex*>(Writer.Vertices) + (BaseVertex - Writer.Section.BaseVertex));
+        DebugDrawSections[Mode].BaseVertex = BaseVertex;
+        DebugDrawSections[Mode].VertexCount = VertexCount;
+        BaseVertex += VertexCount;
+    }
+    DebugDrawMesh.Unmap(*RHIContext);
+}
+
+void KRenderer::RenderDebugDraw()
+{
+    KE_PROFILE_FUNCTION();
+
+    UINT32 UploadedVertexCount = 0;
+    for (const FDynamicMeshSection& Section : DebugDrawSections)
+    {
+        UploadedVertexCount += Section.VertexCount;
+    }
+    if (UploadedVertexCount == 0)
+    {
+        return;
+    }
+
+    // Vertices are in world space
+    BasicShader->Bind(StateCache, EVertexLayout::Compact);
+    BindTexture(StateCache, nullptr);
+    if (!BindObjectConstants(XMMatrixIdentity()))
+    {
+        return;
+    }
+    BindFrameConstants();
+
+    DebugDrawMesh.Bind(StateCache);
+    for (UINT32 Mode = 0; Mode < DebugDrawModeCount; ++Mode)
+    {
+        if (DebugDrawSections[Mode].VertexCount > 0)
+        {
+            StateCache.SetDepthStencilState(DebugDepthStates[Mode].Get());
+            DebugDrawMesh.Draw(*RHIContext, DebugDrawSections[Mode]);
+        }
+    }
+    StateCache.SetDepthStencilState(nullptr);
+}
+
 void KRenderer::Cleanup()
 {
     LOG_INFO("Cleaning up Renderer...");
 
     // Cleanup resources
     BasicShader.reset();
+    BasicInstancedShader.reset();
+    SkinnedShader.reset();
     TextureManager.Cleanup();
 
+    InstanceBuffer.Reset();
+    InstanceBufferCapacity = 0;
+    InstanceBufferCursor = 0;
+    InstanceScratch.clear();
+
+    ConstantAllocator.Cleanup();
+    FrameConstants = FConstantBufferAllocation();
+    MeshCache.clear();
+    DebugDraw.Clear();
+    DebugDrawMesh.Cleanup();
+    for (FDynamicMeshSection& Section : DebugDrawSections)
+    {
+        Section = FDynamicMeshSection();
+    }
+    for (auto& State : DebugDepthStates)
+    {
+        State.Reset();
+    }
+    GeometryPool.reset();
+
+    ParallelRecorder.Cleanup();
+    DrawBatches.clear();
+    QueueCuller.Reset();
+    InstanceCuller.Reset();
+    OcclusionCuller.Reset();
+    bOcclusionCulling = false;
+    OcclusionJobSystem = nullptr;
+    VisibleIndices.clear();
+    ObjectConstantScratch.clear();
+
+    RenderQueue.Reset();
+    QueuedObjects.clear();
+    QueuedLODs.clear();
+    ShaderSortIds.Reset();
+    TextureSortIds.Reset();
+    MeshSortIds.Reset();
+
+    StateCache.SetSink(nullptr);
+    RHIContext = nullptr;
+
     GraphicsDevice = nullptr;
+    RHIDevice = nullptr;
+    OutputWidth = 0;
+    OutputHeight = 0;
     CurrentCamera = nullptr;
     bInFrame = false;
 
     LOG_INFO("Renderer cleanup completed");
 }
 
-std::shared_ptr<KMesh> KRenderer::CreateTriangleMesh()
+namespace
+{
+    // Cache keys of the fixed factory meshes; procedural keys are full 64-bit hashes
+    enum class EBuiltinMesh : uint64
+    {
+        Triangle = 1,
+        Quad,
+        Cube
+    };
+
+    uint64 GetBuiltinMeshKey(EBuiltinMesh Mesh, EVertexLayout Layout)
+    {
+        return (static_cast<uint64>(Mesh) << 8) | static_cast<uint64>(Layout);
+    }
+}
+
+std::shared_ptr<KMesh> KRenderer::FindCachedMesh(uint64 Key) const
+{
+    auto Found = MeshCache.find(Key);
+    return Found != MeshCache.end() ? Found->second : nullptr;
+}
+
+std::shared_ptr<KMesh> KRenderer::AddCachedMesh(uint64 Key, std::unique_ptr<KMesh> Mesh)
 {
-    if (!GraphicsDevice)
+    if (!Mesh)
     {
         return nullptr;
     }
 
-    return KMesh::CreateTriangle(GraphicsDevice->GetDevice());
+    std::shared_ptr<KMesh> Shared = std::move(Mesh);
+    MeshCache[Key] = Shared;
+    return Shared;
 }
 
-std::shared_ptr<KMesh> KRenderer::CreateQuadMesh()
+std::shared_ptr<KMesh> KRenderer::CreateTriangleMesh(EVertexLayout Layout)
 {
-    if (!GraphicsDevice)
+    if (!RHIDevice)
     {
         return nullptr;
     }
 
-    return KMesh::CreateQuad(GraphicsDevice->GetDevice());
+    const uint64 Key = GetBuiltinMeshKey(EBuiltinMesh::Triangle, Layout);
+    if (auto Cached = FindCachedMesh(Key))
+    {
+        return Cached;
+    }
+    return AddCachedMesh(Key, KMesh::CreateTriangle(RHIDevice, Layout, GeometryPool));
 }
 
-std::shared_ptr<KMesh> KRenderer::CreateCubeMesh()
+std::shared_ptr<KMesh> KRenderer::CreateQuadMesh(EVertexLayout Layout)
 {
-    if (!GraphicsDevice)
+    if (!RHIDevice)
     {
         return nullptr;
     }
 
-    return KMesh::CreateCube(GraphicsDevice->GetDevice());
+    const uint64 Key = GetBuiltinMeshKey(EBuiltinMesh::Quad, Layout);
+    if (auto Cached = FindCachedMesh(Key))
+    {
+        return Cached;
+    }
+    return AddCachedMesh(Key, KMesh::CreateQuad(RHIDevice, Layout, GeometryPool));
 }
 
-std::shared_ptr<KMesh> KRenderer::CreateSphereMesh(UINT32 Slices, UINT32 Stacks)
+std::shared_ptr<KMesh> KRenderer::CreateCubeMesh(EVertexLayout Layout)
 {
-    if (!GraphicsDevice)
+    if (!RHIDevice)
     {
         return nullptr;
     }
 
-    return KMesh::CreateSphere(GraphicsDevice->GetDevice(), Slices, Stacks);
+    const uint64 Key = GetBuiltinMeshKey(EBuiltinMesh::Cube, Layout);
+    if (auto Cached = FindCachedMesh(Key))
+    {
+        return Cached;
+    }
+    return AddCachedMesh(Key, KMesh::CreateCube(RHIDevice, Layout, GeometryPool));
+}
+
+std::shared_ptr<KMesh> KRenderer::CreateSphereMesh(UINT32 Slices, UINT32 Stacks, EVertexLayout Layout,
+                                                   const FMeshLODSettings* LODSettings)
+{
+    return CreateProceduralMesh(FProceduralMeshDesc::Sphere(Slices, Stacks), Layout, LODSettings);
+}
+
+std::shared_ptr<KMesh> KRenderer::CreateProceduralMesh(const FProceduralMeshDesc& Desc, EVertexLayout Layout,
+                                                       const FMeshLODSettings* LODSettings, KJobSystem* JobSystem)
+{
+    if (!RHIDevice)
+    {
+        return nullptr;
+    }
+
+    const uint64 Key = ProceduralGeometry::GetCacheKey(Desc, Layout, LODSettings);
+    if (auto Cached = FindCachedMesh(Key))
+    {
+        return Cached;
+    }
+    return AddCachedMesh(Key, KMesh::CreateProcedural(RHIDevice, Desc, Layout, LODSettings, JobSystem,
+                                                      GeometryPool));
+}
+
+std::shared_ptr<KDynamicMesh> KRenderer::CreateDynamicMesh(const FDynamicMeshSettings& Settings)
+{
+    if (!RHIDevice)
+    {
+        return nullptr;
+    }
+
+    auto Mesh = std::make_shared<KDynamicMesh>();
+    if (FAILED(Mesh->Initialize(RHIDevice, Settings)))
+    {
+        LOG_ERROR("Dynamic mesh creation failed");
+        return nullptr;
+    }
+    return Mesh;
+}
+
+std::shared_ptr<KMesh> KRenderer::LoadMesh(const std::wstring& Filename)
+{
+    if (!RHIDevice)
+    {
+        return nullptr;
+    }
+
+    return KMesh::LoadFromFile(RHIDevice, Filename, GeometryPool);
+}
+
+std::shared_ptr<KMesh> KRenderer::ImportMesh(const std::wstring& Filename, EVertexLayout Layout,
+                                             const FMeshLODSettings* LODSettings, KJobSystem* JobSystem)
+{
+    if (!RHIDevice)
+    {
+        return nullptr;
+    }
+
+    return KMesh::Import(RHIDevice, Filename, Layout, LODSettings, JobSystem, GeometryPool);
 }
 
 HRESULT KRenderer::InitializeDefaultResources()
 {
     // Create basic shader program
     BasicShader = std::make_shared<KShaderProgram>();
-    HRESULT hr = BasicShader->CreateBasicColorShader(GraphicsDevice->GetDevice());
+    HRESULT hr = BasicShader->CreateBasicColorShader(RHIDevice);
     if (FAILED(hr))
     {
         KLogger::HResultError(hr, "Basic shader program creation failed");
         return hr;
     }
 
+    // Create frame constant buffer allocator
+    hr = ConstantAllocator.Initialize(RHIDevice);
+    if (FAILED(hr))
+    {
+        KLogger::HResultError(hr, "Constant buffer allocator creation failed");
+        return hr;
+    }
+
+    // Create instanced variant of the basic shader
+    BasicInstancedShader = std::make_shared<KShaderProgram>();
+    hr = BasicInstancedShader->CreateBasicColorInstancedShader(RHIDevice);
+    if (FAILED(hr))
+    {
+        KLogger::HResultError(hr, "Basic instanced shader program creation failed");
+        return hr;
+    }
+    BasicShader->SetInstancedVariant(BasicInstancedShader);
+
+    // Create skinned variant of the basic shader
+    SkinnedShader = std::make_shared<KShaderProgram>();
+    hr = SkinnedShader->CreateSkinnedColorShader(RHIDevice);
+    if (FAILED(hr))
+    {
+        KLogger::HResultError(hr, "Skinned shader program creation failed");
+        return hr;
+    }
+
+    // Create per-instance vertex stream
+    hr = CreateInstanceBuffer(DefaultInstanceCapacity);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    // Create shared mesh buffers (meshes fall back to dedicated buffers without them)
+    GeometryPool = std::make_shared<KGeometryPool>();
+    if (FAILED(GeometryPool->Initialize(RHIDevice, RHIContext)))
+    {
+        LOG_WARNING("Geometry pool is not available; meshes use dedicated buffers");
+        GeometryPool.reset();
+    }
+
+    // Create debug draw stream (one line list per mode, no indices)
+    FDynamicMeshSettings DebugSettings;
+    DebugSettings.Layout = EVertexLayout::Compact;
+    DebugSettings.Topology = EPrimitiveTopology::LineList;
+    DebugSettings.VertexCapacity = 64 * 1024;
+    DebugSettings.IndexCapacity = 0;
+    hr = DebugDrawMesh.Initialize(RHIDevice, DebugSettings);
+    if (FAILED(hr))
+    {
+        KLogger::HResultError(hr, "Debug draw buffer creation failed");
+        return hr;
+    }
+
+    // Depth-tested lines do not write depth; overlay lines ignore it
+    FRHIDepthStencilDesc DepthDesc;
+    DepthDesc.bDepthEnable = true;
+    DepthDesc.bDepthWrite = false;
+    DepthDesc.DepthFunc = ERHIComparison::LessEqual;
+    FRHIResourceRef& DepthTestedState = DebugDepthStates[static_cast<UINT32>(EDebugDrawMode::DepthTested)];
+    DepthTestedState.Reset(RHIDevice, RHIDevice->CreateDepthStencilState(DepthDesc));
+
+    DepthDesc.bDepthEnable = false;
+    FRHIResourceRef& OverlayState = DebugDepthStates[static_cast<UINT32>(EDebugDrawMode::Overlay)];
+    OverlayState.Reset(RHIDevice, RHIDevice->CreateDepthStencilState(DepthDesc));
+    if (!DepthTestedState || !OverlayState)
+    {
+        LOG_ERROR("Debug draw depth state creation failed");
+        return E_FAIL;
+    }
+
     // Initialize texture manager
-    hr = TextureManager.CreateDefaultTextures(GraphicsDevice->GetDevice());
+    hr = TextureManager.CreateDefaultTextures(RHIDevice);
     if (FAILED(hr))
     {
         KLogger::HResultError(hr, "Default texture creation failed");
@@ -6,7 +6,17 @@
 #include "Camera.h"
 #include "Shader.h"
 #include "Mesh.h"
+#include "DynamicMesh.h"
+#include "DebugDraw.h"
+#include "Animation.h"
 #include "Texture.h"
+#include "RenderQueue.h"
+#include "RenderStateCache.h"
+#include "ConstantBufferAllocator.h"
+#include "ParallelCommandRecorder.h"
+#include "FrustumCuller.h"
+#include "SpatialIndex.h"
+#include "OcclusionCuller.h"
 
 /**
  * @brief Render object containing all rendering components
@@ -17,11 +27,34 @@ struct FRenderObject
     std::shared_ptr<KShaderProgram> Shader;
     std::shared_ptr<KTexture> Texture;
     XMMATRIX WorldMatrix = XMMatrixIdentity();
+    ERenderPass RenderPass = ERenderPass::Opaque;
     
     FRenderObject(std::shared_ptr<KMesh> InMesh, std::shared_ptr<KShaderProgram> InShader, std::shared_ptr<KTexture> InTexture = nullptr)
         : Mesh(InMesh), Shader(InShader), Texture(InTexture) {}
 };
 
+/**
+ * @brief One draw of the sorted queue
+ */
+struct FDrawBatch
+{
+    const FRenderObject* Object = nullptr;  // First (or only) object of the batch
+    UINT32 FirstItem = 0;                   // Position in the sorted queue
+    UINT32 InstanceCount = 0;               // 0: regular draw with per-object constants
+    UINT32 StartInstance = 0;
+    FConstantBufferAllocation ObjectConstants;
+    UINT32 LOD = 0;                         // Mesh LOD drawn by the batch
+};
+
+/**
+ * @brief One view of a multi-view frame
+ */
+struct FRenderView
+{
+    KCamera* Camera = nullptr;
+    float Viewport[4] = { 0.0f, 0.0f, 1.0f, 1.0f };    // X, Y, width, height as fractions of the back buffer
+};
+
 /**
  * @brief Main renderer class
  * 
@@ -31,6 +64,8 @@ struct FRenderObject
 class KRenderer
 {
 public:
+    static constexpr UINT32 MaxRenderViews = KFrustumCuller::MaxViews;
+
     KRenderer() = default;
     ~KRenderer() = default;
 
@@ -45,6 +80,18 @@ public:
      */
     HRESULT Initialize(KGraphicsDevice* InGraphicsDevice);
 
+    /**
+     * @brief Initialize renderer on any RHI backend
+     *
+     * Frames draw into the context's current render targets; there is no
+     * swap chain to clear or present (see KNullRHIDevice for headless runs).
+     * @param InRHIDevice RHI device
+     * @param Width Output width in pixels, for view viewports
+     * @param Height Output height in pixels
+     * @return S_OK on success
+     */
+    HRESULT Initialize(IRHIDevice* InRHIDevice, UINT32 Width, UINT32 Height);
+
     /**
      * @brief Begin rendering frame
      * @param InCamera Camera
@@ -52,6 +99,24 @@ public:
      */
     void BeginFrame(KCamera* InCamera, const float ClearColor[4] = Colors::CornflowerBlue);
 
+    /**
+     * @brief Begin a frame rendered into several views (split-screen, minimap, reflections)
+     * 
+     * Render calls are queued for the whole frame. EndFrame culls every queued
+     * object against all view frusta in one pass into per-object view masks,
+     * then builds, sorts and draws a draw list per view from that shared result.
+     * Immediate draws (dynamic and skinned meshes) go to the first view.
+     * @param Views Views in drawing order; each camera's aspect ratio should match its viewport
+     * @param ViewCount Number of views (1 - MaxRenderViews)
+     * @param ClearColor Clear color of the whole back buffer
+     */
+    void BeginFrame(const FRenderView* Views, UINT32 ViewCount, const float ClearColor[4] = Colors::CornflowerBlue);
+
+    /**
+     * @brief Number of views of the current frame (1 for single-camera frames)
+     */
+    UINT32 GetViewCount() const { return bMultiView ? static_cast<UINT32>(RenderViews.size()) : 1; }
+
     /**
      * @brief End rendering frame
      * @param bVSync Use V-Sync
@@ -60,10 +125,25 @@ public:
 
     /**
      * @brief Render object
+     * 
+     * Draws immediately, or queues the object for sorting when
+     * deferred submission is enabled.
      * @param RenderObject Object to render
      */
     void RenderObject(const FRenderObject& RenderObject);
 
+    /**
+     * @brief Render the objects a spatial index reports as visible
+     * 
+     * Queries the index with each view's frustum; UserData is the index
+     * into Objects. Hits still go through RenderObject, which culls them
+     * against their exact bounds.
+     * @param SpatialIndex Index holding the objects' bounds
+     * @param Objects Objects addressed by UserData
+     * @param ObjectCount Number of objects
+     */
+    void RenderVisibleObjects(const ISpatialIndex& SpatialIndex, const FRenderObject* Objects, uint32 ObjectCount);
+
     /**
      * @brief Render mesh (simple version)
      * @param InMesh Mesh
@@ -80,20 +160,205 @@ public:
      */
     void RenderMeshBasic(std::shared_ptr<KMesh> InMesh, const XMMATRIX& WorldMatrix);
 
+    /**
+     * @brief Render many copies of a mesh with a single instanced draw
+     * 
+     * In deferred submission mode the instances are queued and merged
+     * again by automatic instancing when the queue is flushed.
+     * @param InMesh Mesh
+     * @param WorldMatrices Per-instance world matrices
+     * @param InstanceCount Number of instances
+     * @param InTexture Texture (optional)
+     */
+    void RenderMeshInstanced(std::shared_ptr<KMesh> InMesh, const XMMATRIX* WorldMatrices, UINT32 InstanceCount,
+                             std::shared_ptr<KTexture> InTexture = nullptr);
+    void RenderMeshInstanced(std::shared_ptr<KMesh> InMesh, const std::vector<XMMATRIX>& WorldMatrices,
+                             std::shared_ptr<KTexture> InTexture = nullptr);
+
+    /**
+     * @brief Draw a section of a dynamic mesh right away, also in deferred submission mode
+     *
+     * Persistent meshes are flushed first. Dynamic geometry is not culled.
+     * @param InMesh Dynamic mesh
+     * @param Section Range returned by Append/Map, or GetSection of a persistent mesh
+     * @param WorldMatrix World matrix
+     * @param InTexture Texture (optional)
+     */
+    void RenderDynamicMesh(KDynamicMesh& InMesh, const FDynamicMeshSection& Section, const XMMATRIX& WorldMatrix,
+                           std::shared_ptr<KTexture> InTexture = nullptr);
+
+    /**
+     * @brief Draw a skinned mesh right away, also in deferred submission mode
+     *
+     * The palette is uploaded to the SkinPalette constant slot for this draw;
+     * evaluate it with KAnimationEvaluator. Skinned meshes are not culled.
+     * @param InMesh Mesh created with KMesh::InitializeSkinned
+     * @param Palette Skinning matrices, one per skeleton joint
+     * @param JointCount Number of palette entries (at most Animation::MaxJoints)
+     * @param WorldMatrix World matrix
+     * @param InTexture Texture (optional)
+     */
+    void RenderSkinnedMesh(std::shared_ptr<KMesh> InMesh, const FSkinMatrix* Palette, UINT32 JointCount,
+                           const XMMATRIX& WorldMatrix, std::shared_ptr<KTexture> InTexture = nullptr);
+
     /**
      * @brief Cleanup resources
      */
     void Cleanup();
 
+    /**
+     * @brief Enable deferred (sorted) submission
+     * 
+     * When enabled, render calls only record a draw key and EndFrame sorts
+     * the frame's draws by pass, shader, texture, mesh and depth before drawing.
+     * @param bEnable Whether to defer submissions
+     */
+    void SetDeferredSubmission(bool bEnable) { bDeferredSubmission = bEnable; }
+    bool IsDeferredSubmission() const { return bDeferredSubmission; }
+
+    /**
+     * @brief Record large sorted queues on worker threads
+     * 
+     * Only affects deferred submission: the sorted draws are split into chunks,
+     * recorded in parallel into command lists and executed in order.
+     * @param InJobSystem Worker pool, nullptr to record on the calling thread
+     * @return false if the device cannot record command lists
+     */
+    bool SetParallelRecording(KJobSystem* InJobSystem);
+    bool IsParallelRecording() const { return ParallelRecorder.IsInitialized(); }
+
+    /**
+     * @brief Enable frustum culling of submitted objects (enabled by default)
+     * 
+     * Deferred submissions are culled in one SIMD batch when the queue is
+     * flushed, before any draw key is built; immediate submissions are tested
+     * one by one, instanced draws per batch.
+     * @param bEnable Whether to cull
+     */
+    void SetFrustumCulling(bool bEnable) { bFrustumCulling = bEnable; }
+    bool IsFrustumCulling() const { return bFrustumCulling; }
+
+    /**
+     * @brief Get culling statistics of the current frame (object/view pairs in multi-view frames)
+     */
+    const FCullingStats& GetCullingStats() const { return CullingStats; }
+
+    /**
+     * @brief Cull deferred submissions hidden behind occluders (disabled by default)
+     * 
+     * Occluders added with AddOccluder are rasterized into a small CPU depth
+     * buffer when the queue is flushed, and objects that pass the frustum test
+     * are tested against it. Needs deferred submission and frustum culling;
+     * multi-view frames skip it.
+     * @param bEnable Whether to cull
+     * @param InJobSystem Worker pool for rasterization and tests, nullptr for the calling thread
+     * @param Settings Occlusion buffer size
+     */
+    void SetOcclusionCulling(bool bEnable, KJobSystem* InJobSystem = nullptr,
+                             const FOcclusionCullerSettings& Settings = FOcclusionCullerSettings());
+    bool IsOcclusionCulling() const { return bOcclusionCulling; }
+
+    /**
+     * @brief Add an occluder to the current frame (ignored unless occlusion culling is enabled)
+     * @param Mesh Occluder geometry; must stay alive until EndFrame
+     * @param WorldMatrix World matrix
+     */
+    void AddOccluder(const FOccluderMesh& Mesh, const XMMATRIX& WorldMatrix);
+
+    /**
+     * @brief Get occlusion statistics of the current frame
+     */
+    const FOcclusionStats& GetOcclusionStats() const { return OcclusionCuller.GetStats(); }
+
+    /**
+     * @brief Pick a mesh LOD per draw from its projected screen size (enabled by default)
+     * 
+     * Screen size is the world bounding sphere's projected diameter over the view
+     * height, from the camera FOV (or ortho height) and distance; meshes without
+     * a LOD chain always draw LOD 0.
+     * @param bEnable Whether to select LODs
+     */
+    void SetLODSelection(bool bEnable) { bLODSelection = bEnable; }
+    bool IsLODSelection() const { return bLODSelection; }
+
+    /**
+     * @brief Scale applied to screen sizes before LOD selection (above 1 keeps detail longer)
+     */
+    void SetLODScale(float Scale) { LODScale = Scale; }
+    float GetLODScale() const { return LODScale; }
+
+    /**
+     * @brief Invalidate the shadow state cache
+     * 
+     * Call after binding state on the device context directly
+     * within a frame that also renders through KRenderer.
+     */
+    void InvalidateStateCache() { StateCache.Invalidate(); }
+
+    /**
+     * @brief Get state cache statistics (calls issued / skipped)
+     */
+    const FRenderStateStats& GetStateStats() const { return StateCache.GetStats(); }
+
     // Getters
     KShaderProgram* GetBasicShader() const { return BasicShader.get(); }
     KTextureManager* GetTextureManager() { return &TextureManager; }
 
-    // Basic mesh factory methods
-    std::shared_ptr<KMesh> CreateTriangleMesh();
-    std::shared_ptr<KMesh> CreateQuadMesh();
-    std::shared_ptr<KMesh> CreateCubeMesh();
-    std::shared_ptr<KMesh> CreateSphereMesh(UINT32 Slices = 16, UINT32 Stacks = 16);
+    /**
+     * @brief Shared vertex/index buffers the factory meshes are allocated from
+     *
+     * Pass it to KMesh::Initialize to pool other meshes; call Defragment on it
+     * between frames after many meshes were released. nullptr if unavailable.
+     */
+    std::shared_ptr<KGeometryPool> GetGeometryPool() const { return GeometryPool; }
+
+    // Basic mesh factory methods (allocated from the geometry pool). Results are cached by
+    // their parameters, so repeated requests share one mesh; treat the returned meshes as read-only.
+    std::shared_ptr<KMesh> CreateTriangleMesh(EVertexLayout Layout = EVertexLayout::Standard);
+    std::shared_ptr<KMesh> CreateQuadMesh(EVertexLayout Layout = EVertexLayout::Standard);
+    std::shared_ptr<KMesh> CreateCubeMesh(EVertexLayout Layout = EVertexLayout::Standard);
+    std::shared_ptr<KMesh> CreateSphereMesh(UINT32 Slices = 16, UINT32 Stacks = 16,
+                                            EVertexLayout Layout = EVertexLayout::Standard,
+                                            const FMeshLODSettings* LODSettings = nullptr);
+
+    /**
+     * @brief Generate a procedural shape into the geometry pool, or return the cached mesh
+     *        created earlier with the same parameters (see ProceduralGeometry::GetCacheKey)
+     * @param JobSystem Worker pool for large grids and LOD generation, nullptr for the calling thread
+     */
+    std::shared_ptr<KMesh> CreateProceduralMesh(const FProceduralMeshDesc& Desc, EVertexLayout Layout = EVertexLayout::Standard,
+                                                const FMeshLODSettings* LODSettings = nullptr, KJobSystem* JobSystem = nullptr);
+
+    /**
+     * @brief Release the renderer's references to cached factory meshes
+     */
+    void ClearMeshCache() { MeshCache.clear(); }
+    size_t GetCachedMeshCount() const { return MeshCache.size(); }
+
+    /**
+     * @brief Debug primitives, drawn at EndFrame in one draw per mode over the scene
+     *
+     * Add primitives any time during the frame; Tick it once per frame to age
+     * primitives with a duration (KEngine does).
+     */
+    KDebugDraw& GetDebugDraw() { return DebugDraw; }
+
+    /**
+     * @brief Create a mesh for geometry the CPU rewrites or patches every frame
+     */
+    std::shared_ptr<KDynamicMesh> CreateDynamicMesh(const FDynamicMeshSettings& Settings = FDynamicMeshSettings());
+
+    /**
+     * @brief Load a mesh file into the geometry pool
+     */
+    std::shared_ptr<KMesh> LoadMesh(const std::wstring& Filename);
+
+    /**
+     * @brief Import an OBJ or glTF file into the geometry pool
+     * @param JobSystem Worker pool for parsing and LOD generation, nullptr for the calling thread
+     */
+    std::shared_ptr<KMesh> ImportMesh(const std::wstring& Filename, EVertexLayout Layout = EVertexLayout::Standard,
+                                      const FMeshLODSettings* LODSettings = nullptr, KJobSystem* JobSystem = nullptr);
 
 private:
     /**
@@ -101,15 +366,250 @@ private:
      */
     HRESULT InitializeDefaultResources();
 
+    /**
+     * @brief Bind state and draw a render object right away
+     */
+    void DrawRenderObject(const FRenderObject& RenderObject, UINT32 LOD = 0);
+
+    /**
+     * @brief Draw instances of a render object with its program's instanced variant
+     * @param Template Render object providing mesh, shader and texture
+     * @param WorldMatrices Per-instance world matrices
+     * @param InstanceCount Number of instances
+     * @param LOD Mesh LOD of every instance
+     */
+    void DrawInstancedBatch(const FRenderObject& Template, const XMMATRIX* WorldMatrices, UINT32 InstanceCount,
+                            UINT32 LOD = 0);
+
+    /**
+     * @brief Draw instances grouped into one instanced draw per selected LOD
+     */
+    void DrawInstancedLODs(const FRenderObject& Template, const XMMATRIX* WorldMatrices, UINT32 InstanceCount);
+
+    /**
+     * @brief Make a camera current: matrices, frustum and LOD projection scale
+     */
+    void SetViewCamera(KCamera* InCamera);
+
+    /**
+     * @brief Reset per-frame state, upload frame constants and clear the back buffer
+     */
+    void BeginFrameCommon(const float ClearColor[4]);
+
+    /**
+     * @brief Make a view current: camera, viewport and frame constants
+     */
+    void BeginView(const FRenderView& View);
+
+    /**
+     * @brief Set the viewport from fractions of the back buffer
+     */
+    void SetViewport(const float Viewport[4]);
+
+    /**
+     * @brief LOD of a mesh placed with a world matrix, from its projected screen size
+     */
+    UINT32 SelectMeshLOD(const KMesh& Mesh, const XMMATRIX& WorldMatrix) const;
+
+    /**
+     * @brief Upload per-frame constants (View, Projection, ViewProjection) once per frame
+     * @return true on success
+     */
+    bool UploadFrameConstants();
+
+    /**
+     * @brief Bind this frame's per-frame constants (skipped by the cache when unchanged)
+     * 
+     * Re-uploads them if the constant ring was discarded since the last upload.
+     */
+    void BindFrameConstants();
+
+    /**
+     * @brief Upload per-object constants (World only) and bind them
+     * @param WorldMatrix World matrix
+     * @return true on success
+     */
+    bool BindObjectConstants(const XMMATRIX& WorldMatrix);
+
+    /**
+     * @brief Bind a texture to pixel slot 0, or clear the slot
+     */
+    static void BindTexture(KRenderStateCache& InStateCache, const KTexture* InTexture);
+
+    /**
+     * @brief Create the dynamic per-instance vertex buffer
+     * @param Capacity Number of instances
+     */
+    HRESULT CreateInstanceBuffer(UINT32 Capacity);
+
+    /**
+     * @brief Copy world matrices into the instance buffer
+     * @param Mesh Mesh whose position decode is applied (nullptr if already applied)
+     * @return First instance index of the uploaded range, or UINT32_MAX on failure
+     */
+    UINT32 UploadInstanceData(const XMMATRIX* WorldMatrices, UINT32 InstanceCount, const KMesh* Mesh = nullptr);
+
+    /**
+     * @brief World-space box of a mesh placed with a world matrix
+     */
+    static FBoundingBox ComputeWorldBounds(const KMesh& Mesh, const XMMATRIX& WorldMatrix);
+
+    /**
+     * @brief World matrix uploaded for a mesh (decodes quantized positions)
+     */
+    static XMMATRIX GetMeshWorldMatrix(const KMesh& Mesh, const XMMATRIX& WorldMatrix);
+
+    /**
+     * @brief Upload the debug primitives of this frame (once, before any view draws them)
+     */
+    void UploadDebugDraw();
+
+    /**
+     * @brief Draw the uploaded debug primitives into the current view
+     */
+    void RenderDebugDraw();
+
+    /**
+     * @brief Factory mesh cache lookup; a failed creation (nullptr) is not cached
+     */
+    std::shared_ptr<KMesh> FindCachedMesh(uint64 Key) const;
+    std::shared_ptr<KMesh> AddCachedMesh(uint64 Key, std::unique_ptr<KMesh> Mesh);
+
+    /**
+     * @brief Cull the queued objects and push the visible ones into the render queue
+     */
+    void BuildRenderQueue();
+
+    /**
+     * @brief Build the sort key for a render object drawn at a LOD
+     */
+    uint64 BuildDrawKey(const FRenderObject& RenderObject, UINT32 LOD);
+
+    /**
+     * @brief Sort and draw all queued render objects
+     */
+    void FlushRenderQueue();
+
+    /**
+     * @brief Sort and draw the render queue, then reset it (queued objects are kept)
+     */
+    void DrawRenderQueue();
+
+    /**
+     * @brief Cull the queued objects against all views at once, then draw each view's list
+     */
+    void FlushMultiViewQueue();
+
+    /**
+     * @brief Group the sorted queue into draws (runs of identical resources become instanced draws)
+     */
+    void BuildDrawBatches();
+
+    /**
+     * @brief Draw the batches through the parallel command recorder
+     */
+    void FlushDrawBatchesParallel();
+
+    /**
+     * @brief Upload object constants and instance data of batches [First, Last) in one go each
+     * @return true on success
+     */
+    bool PrepareDrawBatches(size_t First, size_t Last);
+
+    /**
+     * @brief Bind state and draw a prepared batch (called from worker threads)
+     */
+    void RecordDrawBatch(const FDrawBatch& Batch, KRenderStateCache& InStateCache,
+                         IRHICommandContext& Context) const;
+
 private:
-    // Core components
+    // Core components (no graphics device when initialized on a bare RHI device)
     KGraphicsDevice* GraphicsDevice = nullptr;
+    IRHIDevice* RHIDevice = nullptr;
+    UINT32 OutputWidth = 0;
+    UINT32 OutputHeight = 0;
     KCamera* CurrentCamera = nullptr;
 
     // Rendering resources
     std::shared_ptr<KShaderProgram> BasicShader;
+    std::shared_ptr<KShaderProgram> BasicInstancedShader;
+    std::shared_ptr<KShaderProgram> SkinnedShader;
     KTextureManager TextureManager;
 
+    // Frame-scoped constant buffer suballocator
+    KConstantBufferAllocator ConstantAllocator;
+    FConstantBufferAllocation FrameConstants;
+    UINT32 FrameConstantsDiscardCount = 0;
+
+    // Per-instance vertex stream (ring of world matrices)
+    static constexpr UINT32 DefaultInstanceCapacity = 1024;
+    static constexpr UINT32 MinAutoInstanceCount = 2;
+    FRHIResourceRef InstanceBuffer;
+    UINT32 InstanceBufferCapacity = 0;
+    UINT32 InstanceBufferCursor = 0;
+    std::vector<XMMATRIX> InstanceScratch;
+
+    // Shared mesh buffers (meshes keep the pool alive after Cleanup)
+    std::shared_ptr<KGeometryPool> GeometryPool;
+
+    // Factory meshes by parameter hash
+    std::unordered_map<uint64, std::shared_ptr<KMesh>> MeshCache;
+
+    // Debug draw: line-list stream and a depth state per mode
+    KDebugDraw DebugDraw;
+    KDynamicMesh DebugDrawMesh;
+    FDynamicMeshSection DebugDrawSections[DebugDrawModeCount];     // Uploaded ranges of this frame
+    FRHIResourceRef DebugDepthStates[DebugDrawModeCount];
+
     // Current frame state
     bool bInFrame = false;
+
+    // Multi-view frame: views, their frusta, per-object view masks and per-view object lists
+    bool bMultiView = false;
+    std::vector<FRenderView> RenderViews;
+    std::vector<FFrustum> ViewFrustums;
+    std::vector<uint32> ViewMasks;
+    std::vector<std::vector<uint32>> ViewIndices;
+
+    // Shadow state cache for redundant state elimination (forwards to the RHI context)
+    IRHICommandContext* RHIContext = nullptr;
+    KRenderStateCache StateCache;
+
+    // Deferred submission
+    bool bDeferredSubmission = false;
+    KRenderQueue RenderQueue;
+    std::vector<FRenderObject> QueuedObjects;
+    std::vector<uint8> QueuedLODs;
+    KSortIdMap ShaderSortIds;
+    KSortIdMap TextureSortIds;
+    KSortIdMap MeshSortIds;
+
+    // Frustum culling
+    bool bFrustumCulling = true;
+    FFrustum ViewFrustum;
+    KFrustumCuller QueueCuller;
+    KFrustumCuller InstanceCuller;
+    std::vector<uint32> VisibleIndices;
+    std::vector<uint32> SpatialQueryResults;
+    FCullingStats CullingStats;
+
+    // Occlusion culling (single-view deferred frames)
+    bool bOcclusionCulling = false;
+    KOcclusionCuller OcclusionCuller;
+    KJobSystem* OcclusionJobSystem = nullptr;
+
+    // LOD selection (screen scale is the projection's vertical scale, refreshed each frame)
+    bool bLODSelection = true;
+    float LODScale = 1.0f;
+    float LODScreenScale = 1.0f;
+    bool bLODPerspective = true;
+    XMFLOAT3 LODViewOrigin = XMFLOAT3(0.0f, 0.0f, 0.0f);
+    std::vector<uint8> InstanceLODScratch;
+    std::vector<XMMATRIX> LODInstanceScratch;
+
+    // Parallel recording of the sorted queue
+    static constexpr UINT32 MinDrawsPerRecordChunk = 256;
+    KParallelCommandRecorder ParallelRecorder;
+    std::vector<FDrawBatch> DrawBatches;
+    std::vector<uint8> ObjectConstantScratch;
 }; 
\ No newline at end of file
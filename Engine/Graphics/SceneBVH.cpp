@@ -0,0 +1,1274 @@
+﻿#include "SceneBVH.h"
+#include "../Core/JobSystem.h"
+#include "../Core/Profiler.h"
+
+#include <algorithm>
+#include <cfloat>
+
+namespace
+{
+    constexpr uint32 BinCount = 16;
+
+    // SAH costs of visiting a node and of testing one object box
+    constexpr float TraversalCost = 2.0f;
+    constexpr float IntersectCost = 1.0f;
+
+    // Ranges at least this large are bounded and binned in parallel chunks
+    constexpr uint32 ParallelBinThreshold = 65536;
+    constexpr uint32 BinChunkSize = 16384;
+
+    // Subtrees handed to one worker hold at least this many objects
+    constexpr uint32 MinSubtreeSize = 4096;
+
+    // Full refit instead of walking marked paths once this fraction of nodes is marked (1 / N)
+    constexpr uint32 FullRefitDivisor = 32;
+
+    // Rays per job of a batched raycast
+    constexpr uint32 RayChunkSize = 64;
+
+    constexpr uint32 InvalidNode = 0xFFFFFFFFu;
+
+    using FNode = KSceneBVH::FNode;
+    using FPrim = KSceneBVH::FPrim;
+
+    // Left uninitialized so bin arrays cost nothing to declare; Reset before growing
+    struct FAABB
+    {
+        float Min[3];
+        float Max[3];
+
+        void Reset()
+        {
+            for (uint32 Axis = 0; Axis < 3; ++Axis)
+            {
+                Min[Axis] = FLT_MAX;
+                Max[Axis] = -FLT_MAX;
+            }
+        }
+
+        void Grow(const float InMin[3], const float InMax[3])
+        {
+            for (uint32 Axis = 0; Axis < 3; ++Axis)
+            {
+                Min[Axis] = InMin[Axis] < Min[Axis] ? InMin[Axis] : Min[Axis];
+                Max[Axis] = InMax[Axis] > Max[Axis] ? InMax[Axis] : Max[Axis];
+            }
+        }
+
+        void Grow(const FAABB& Other) { Grow(Other.Min, Other.Max); }
+
+        // Half the surface area (only ratios matter), 0 if empty
+        float HalfArea() const
+        {
+            const float X = Max[0] - Min[0];
+            const float Y = Max[1] - Min[1];
+            const float Z = Max[2] - Min[2];
+            if (X < 0.0f || Y < 0.0f || Z < 0.0f)
+            {
+                return 0.0f;
+            }
+            return X * Y + Y * Z + Z * X;
+        }
+    };
+
+    float HalfArea(const float Min[3], const float Max[3])
+    {
+        FAABB Box;
+        Box.Reset();
+        Box.Grow(Min, Max);
+        return Box.HalfArea();
+    }
+
+    // Centroids are kept doubled (Min + Max) so they need no multiply
+    void GrowCentroid(FAABB& Bounds, const FPrim& Prim)
+    {
+        for (uint32 Axis = 0; Axis < 3; ++Axis)
+        {
+            const float Centroid = Prim.Min[Axis] + Prim.Max[Axis];
+            Bounds.Min[Axis] = Centroid < Bounds.Min[Axis] ? Centroid : Bounds.Min[Axis];
+            Bounds.Max[Axis] = Centroid > Bounds.Max[Axis] ? Centroid : Bounds.Max[Axis];
+        }
+    }
+
+    struct FRangeBounds
+    {
+        FAABB Bounds;
+        FAABB CentroidBounds;
+
+        void Reset()
+        {
+            Bounds.Reset();
+            CentroidBounds.Reset();
+        }
+
+        void Grow(const FRangeBounds& Other)
+        {
+            Bounds.Grow(Other.Bounds);
+            CentroidBounds.Grow(Other.CentroidBounds);
+        }
+    };
+
+    struct FBin
+    {
+        FRangeBounds Bounds;
+        uint32 Count;
+    };
+
+    /**
+     * @brief Centroid bins of a range along each axis (the first Used of them)
+     */
+    struct FBinning
+    {
+        FBin Bins[3][BinCount];
+
+        void Reset(uint32 Used)
+        {
+            for (uint32 Axis = 0; Axis < 3; ++Axis)
+            {
+                for (uint32 Bin = 0; Bin < Used; ++Bin)
+                {
+                    Bins[Axis][Bin].Bounds.Reset();
+                    Bins[Axis][Bin].Count = 0;
+                }
+            }
+        }
+
+        void Merge(const FBinning& Other, uint32 Used)
+        {
+            for (uint32 Axis = 0; Axis < 3; ++Axis)
+            {
+                for (uint32 Bin = 0; Bin < Used; ++Bin)
+                {
+                    Bins[Axis][Bin].Bounds.Grow(Other.Bins[Axis][Bin].Bounds);
+                    Bins[Axis][Bin].Count += Other.Bins[Axis][Bin].Count;
+                }
+            }
+        }
+    };
+
+    /**
+     * @brief Maps doubled centroids of a range to bins (axes with no extent are skipped)
+     *
+     * Small ranges use fewer bins: binning cost is per bin, and a handful of
+     * objects cannot fill more bins than they are.
+     */
+    struct FBinMapping
+    {
+        float Origin[3];
+        float Scale[3];
+        uint32 Used;
+
+        FBinMapping(const FAABB& CentroidBounds, uint32 Count)
+        {
+            Used = Count < BinCount ? (Count > 2 ? Count : 2) : BinCount;
+            for (uint32 Axis = 0; Axis < 3; ++Axis)
+            {
+                const float Extent = CentroidBounds.Max[Axis] - CentroidBounds.Min[Axis];
+                Origin[Axis] = CentroidBounds.Min[Axis];
+                Scale[Axis] = Extent > 0.0f ? float(Used) * (1.0f - 1e-6f) / Extent : 0.0f;
+            }
+        }
+
+        uint32 GetBin(const FPrim& Prim, uint32 Axis) const
+        {
+            const float Centroid = Prim.Min[Axis] + Prim.Max[Axis];
+            const uint32 Bin = static_cast<uint32>((Centroid - Origin[Axis]) * Scale[Axis]);
+            return Bin < Used ? Bin : Used - 1;
+        }
+    };
+
+    struct FSplit
+    {
+        uint32 Axis = 0;
+        uint32 Bin = 0;             // Bins below go left
+        float Cost = FLT_MAX;       // Relative to the node area
+        FRangeBounds Left;
+        FRangeBounds Right;
+    };
+
+    FRangeBounds ComputeRangeBounds(const FPrim* Prims, uint32 Begin, uint32 End)
+    {
+        FRangeBounds Result;
+        Result.Reset();
+        for (uint32 Index = Begin; Index < End; ++Index)
+        {
+            Result.Bounds.Grow(Prims[Index].Min, Prims[Index].Max);
+            GrowCentroid(Result.CentroidBounds, Prims[Index]);
+        }
+        return Result;
+    }
+
+    void BinRange(const FPrim* Prims, uint32 Begin, uint32 End, const FBinMapping& Mapping, FBinning& Binning)
+    {
+        for (uint32 Index = Begin; Index < End; ++Index)
+        {
+            const FPrim& Prim = Prims[Index];
+            for (uint32 Axis = 0; Axis < 3; ++Axis)
+            {
+                if (Mapping.Scale[Axis] == 0.0f)
+                {
+                    continue;
+                }
+                FBin& Bin = Binning.Bins[Axis][Mapping.GetBin(Prim, Axis)];
+                Bin.Bounds.Bounds.Grow(Prim.Min, Prim.Max);
+                GrowCentroid(Bin.Bounds.CentroidBounds, Prim);
+                ++Bin.Count;
+            }
+        }
+    }
+
+    uint32 GetChunkCount(uint32 Count)
+    {
+        return (Count + BinChunkSize - 1) / BinChunkSize;
+    }
+
+    bool UseParallelRange(KJobSystem* JobSystem, uint32 Count)
+    {
+        return JobSystem && JobSystem->GetThreadCount() > 1 && Count >= ParallelBinThreshold;
+    }
+
+    FRangeBounds ComputeRangeBounds(const FPrim* Prims, uint32 Begin, uint32 End, KJobSystem* JobSystem)
+    {
+        if (!UseParallelRange(JobSystem, End - Begin))
+        {
+            return ComputeRangeBounds(Prims, Begin, End);
+        }
+
+        std::vector<FRangeBounds> Chunks(GetChunkCount(End - Begin));
+        JobSystem->ParallelFor(static_cast<uint32>(Chunks.size()), [&](uint32 Chunk, uint32)
+        {
+            const uint32 ChunkBegin = Begin + Chunk * BinChunkSize;
+            Chunks[Chunk] = ComputeRangeBounds(Prims, ChunkBegin, std::min(ChunkBegin + BinChunkSize, End));
+        });
+
+        FRangeBounds Result;
+        Result.Reset();
+        for (const FRangeBounds& Chunk : Chunks)
+        {
+            Result.Grow(Chunk);
+        }
+        return Result;
+    }
+
+    /**
+     * @brief Cheapest binned SAH split of a range, Cost stays FLT_MAX if no axis has extent
+     */
+    FSplit FindSplit(const FPrim* Prims, uint32 Begin, uint32 End, const FRangeBounds& Range,
+                     const FBinMapping& Mapping, KJobSystem* JobSystem)
+    {
+        const uint32 Used = Mapping.Used;
+        FBinning Binning;
+        Binning.Reset(Used);
+        if (UseParallelRange(JobSystem, End - Begin))
+        {
+            std::vector<FBinning> Chunks(GetChunkCount(End - Begin));
+            JobSystem->ParallelFor(static_cast<uint32>(Chunks.size()), [&](uint32 Chunk, uint32)
+            {
+                const uint32 ChunkBegin = Begin + Chunk * BinChunkSize;
+                Chunks[Chunk].Reset(Used);
+                BinRange(Prims, ChunkBegin, std::min(ChunkBegin + BinChunkSize, End), Mapping, Chunks[Chunk]);
+            });
+            for (const FBinning& Chunk : Chunks)
+            {
+                Binning.Merge(Chunk, Used);
+            }
+        }
+        else
+        {
+            BinRange(Prims, Begin, End, Mapping, Binning);
+        }
+
+        const float ParentArea = Range.Bounds.HalfArea();
+        const float InvParentArea = ParentArea > 0.0f ? 1.0f / ParentArea : 0.0f;
+
+        FSplit Best;
+        for (uint32 Axis = 0; Axis < 3; ++Axis)
+        {
+            if (Mapping.Scale[Axis] == 0.0f)
+            {
+                continue;
+            }
+
+            // Sweep from the right, then evaluate each plane from the left
+            const FBin* Bins = Binning.Bins[Axis];
+            FRangeBounds RightBounds[BinCount];
+            uint32 RightCounts[BinCount];
+            FRangeBounds Accumulated;
+            Accumulated.Reset();
+            uint32 Count = 0;
+            for (uint32 Bin = Used - 1; Bin > 0; --Bin)
+            {
+                Accumulated.Grow(Bins[Bin].Bounds);
+                Count += Bins[Bin].Count;
+                RightBounds[Bin] = Accumulated;
+                RightCounts[Bin] = Count;
+            }
+
+            Accumulated.Reset();
+            Count = 0;
+            for (uint32 Bin = 1; Bin < Used; ++Bin)
+            {
+                Accumulated.Grow(Bins[Bin - 1].Bounds);
+                Count += Bins[Bin - 1].Count;
+                if (Count == 0 || RightCounts[Bin] == 0)
+                {
+                    continue;
+                }
+
+                const float Cost = TraversalCost + IntersectCost * InvParentArea *
+                    (Accumulated.Bounds.HalfArea() * Count + RightBounds[Bin].Bounds.HalfArea() * RightCounts[Bin]);
+                if (Cost < Best.Cost)
+                {
+                    Best.Axis = Axis;
+                    Best.Bin = Bin;
+                    Best.Cost = Cost;
+                    Best.Left = Accumulated;
+                    Best.Right = RightBounds[Bin];
+                }
+            }
+        }
+        return Best;
+    }
+
+    /**
+     * @brief Range of the tree under construction
+     */
+    struct FBuildTask
+    {
+        uint32 Node = 0;
+        uint32 Begin = 0;
+        uint32 End = 0;
+        uint32 Depth = 0;
+        FRangeBounds Range;
+    };
+
+    void SetNode(FNode& Node, const FAABB& Bounds, uint32 Index, uint32 Count)
+    {
+        for (uint32 Axis = 0; Axis < 3; ++Axis)
+        {
+            Node.Min[Axis] = Bounds.Min[Axis];
+            Node.Max[Axis] = Bounds.Max[Axis];
+        }
+        Node.Index = Index;
+        Node.Count = Count;
+    }
+
+    /**
+     * @brief Split a task's range in place
+     * @return False if the range becomes a leaf
+     */
+    bool SplitTask(FPrim* Prims, const FBuildTask& Task, uint32 MaxLeafSize, KJobSystem* JobSystem,
+                   FBuildTask& OutLeft, FBuildTask& OutRight)
+    {
+        const uint32 Count = Task.End - Task.Begin;
+        if (Count <= 1 || Task.Depth + 1 >= KSceneBVH::MaxDepth)
+        {
+            return false;
+        }
+
+        const FBinMapping Mapping(Task.Range.CentroidBounds, Count);
+        const FSplit Split = FindSplit(Prims, Task.Begin, Task.End, Task.Range, Mapping, JobSystem);
+
+        uint32 Mid = Task.Begin;
+        if (Split.Cost < FLT_MAX)
+        {
+            if (Count <= MaxLeafSize && Split.Cost >= IntersectCost * Count)
+            {
+                return false;
+            }
+            Mid = static_cast<uint32>(std::partition(Prims + Task.Begin, Prims + Task.End, [&](const FPrim& Prim)
+            {
+                return Mapping.GetBin(Prim, Split.Axis) < Split.Bin;
+            }) - Prims);
+        }
+
+        if (Mid == Task.Begin || Mid == Task.End)
+        {
+            // Coincident centroids: any split is as good, halve so the depth stays bounded
+            if (Count <= MaxLeafSize)
+            {
+                return false;
+            }
+            Mid = Task.Begin + Count / 2;
+            OutLeft.Range = ComputeRangeBounds(Prims, Task.Begin, Mid, JobSystem);
+            OutRight.Range = ComputeRangeBounds(Prims, Mid, Task.End, JobSystem);
+        }
+        else
+        {
+            OutLeft.Range = Split.Left;
+            OutRight.Range = Split.Right;
+        }
+
+        OutLeft.Begin = Task.Begin;
+        OutLeft.End = Mid;
+        OutLeft.Depth = Task.Depth + 1;
+        OutRight.Begin = Mid;
+        OutRight.End = Task.End;
+        OutRight.Depth = Task.Depth + 1;
+        return true;
+    }
+
+    /**
+     * @brief Build a subtree on one thread; its root is OutNodes[0] and child indices are local
+     */
+    void BuildSubtree(FPrim* Prims, const FBuildTask& Root, uint32 MaxLeafSize, std::vector<FNode>& OutNodes)
+    {
+        OutNodes.clear();
+        OutNodes.reserve(2 * (Root.End - Root.Begin) / (MaxLeafSize > 1 ? MaxLeafSize / 2 : 1) + 1);
+        OutNodes.emplace_back();
+
+        FBuildTask Stack[KSceneBVH::MaxDepth + 2];
+        uint32 StackSize = 0;
+        Stack[StackSize] = Root;
+        Stack[StackSize++].Node = 0;
+
+        while (StackSize > 0)
+        {
+            const FBuildTask Task = Stack[--StackSize];
+            FBuildTask Left, Right;
+            if (!SplitTask(Prims, Task, MaxLeafSize, nullptr, Left, Right))
+            {
+                SetNode(OutNodes[Task.Node], Task.Range.Bounds, Task.Begin, Task.End - Task.Begin);
+                continue;
+            }
+
+            const uint32 Child = static_cast<uint32>(OutNodes.size());
+            OutNodes.emplace_back();
+            OutNodes.emplace_back();
+            SetNode(OutNodes[Task.Node], Task.Range.Bounds, Child, 0);
+
+            Left.Node = Child;
+            Right.Node = Child + 1;
+            Stack[StackSize++] = Right;
+            Stack[StackSize++] = Left;
+        }
+    }
+
+    bool IsLeaf(const FNode& Node)
+    {
+        return Node.Count > 0;
+    }
+
+    // Leaf-ordered object range under a node: subtrees own contiguous ranges
+    void GetSubtreeRange(const std::vector<FNode>& Nodes, uint32 NodeIndex, uint32& OutBegin, uint32& OutEnd)
+    {
+        uint32 First = NodeIndex;
+        while (!IsLeaf(Nodes[First]))
+        {
+            First = Nodes[First].Index;
+        }
+        uint32 Last = NodeIndex;
+        while (!IsLeaf(Nodes[Last]))
+        {
+            Last = Nodes[Last].Index + 1;
+        }
+        OutBegin = Nodes[First].Index;
+        OutEnd = Nodes[Last].Index + Nodes[Last].Count;
+    }
+
+    uint32 AppendRange(const std::vector<FPrim>& Prims, uint32 Begin, uint32 End, std::vector<uint32>& OutUserData)
+    {
+        uint32 Appended = 0;
+        for (uint32 Index = Begin; Index < End; ++Index)
+        {
+            if (Prims[Index].Id != KSceneBVH::InvalidId)
+            {
+                OutUserData.push_back(Prims[Index].UserData);
+                ++Appended;
+            }
+        }
+        return Appended;
+    }
+
+    struct FRayData
+    {
+        float Origin[3];
+        float InvDirection[3];
+        float MaxDistance;
+
+        explicit FRayData(const FSceneRay& Ray)
+        {
+            for (uint32 Axis = 0; Axis < 3; ++Axis)
+            {
+                // A tiny substitute for zero keeps the slab products finite (no 0 * inf)
+                const float Direction = Ray.Direction[Axis];
+                const float Safe = Direction >= 0.0f ? (Direction < 1e-30f ? 1e-30f : Direction)
+                                                     : (Direction > -1e-30f ? -1e-30f : Direction);
+                Origin[Axis] = Ray.Origin[Axis];
+                InvDirection[Axis] = 1.0f / Safe;
+            }
+            MaxDistance = Ray.MaxDistance;
+        }
+
+        // Entry distance of the ray into the box, FLT_MAX if missed within Limit
+        float Intersect(const float Min[3], const float Max[3], float Limit) const
+        {
+            float Near = 0.0f;
+            float Far = Limit;
+            for (uint32 Axis = 0; Axis < 3; ++Axis)
+            {
+                const float T0 = (Min[Axis] - Origin[Axis]) * InvDirection[Axis];
+                const float T1 = (Max[Axis] - Origin[Axis]) * InvDirection[Axis];
+                Near = std::max(Near, std::min(T0, T1));
+                Far = std::min(Far, std::max(T0, T1));
+            }
+            return Near <= Far ? Near : FLT_MAX;
+        }
+    };
+
+    /**
+     * @brief Build nodes over Prims, reordering them into leaf order
+     *
+     * The top of the tree is split on this thread with parallel binning down
+     * to subtrees of about a thread's share, which are then built in parallel.
+     */
+    void BuildNodes(std::vector<FPrim>& Prims, std::vector<FNode>& Nodes, uint32 MaxLeafSize, KJobSystem* JobSystem)
+    {
+        const uint32 PrimCount = static_cast<uint32>(Prims.size());
+        const uint32 ThreadCount = JobSystem ? JobSystem->GetThreadCount() : 1;
+        const uint32 SubtreeSize = ThreadCount > 1 ? std::max(MinSubtreeSize, PrimCount / (ThreadCount * 8)) : PrimCount;
+
+        FBuildTask RootTask;
+        RootTask.End = PrimCount;
+        RootTask.Range = ComputeRangeBounds(Prims.data(), 0, PrimCount, JobSystem);
+        Nodes.clear();
+        Nodes.emplace_back();
+
+        std::vector<FBuildTask> Subtrees;
+        std::vector<FBuildTask> Stack;
+        Stack.push_back(RootTask);
+        while (!Stack.empty())
+        {
+            const FBuildTask Task = Stack.back();
+            Stack.pop_back();
+            if (Task.End - Task.Begin <= SubtreeSize)
+            {
+                Subtrees.push_back(Task);
+                continue;
+            }
+
+            FBuildTask Left, Right;
+            if (!SplitTask(Prims.data(), Task, MaxLeafSize, JobSystem, Left, Right))
+            {
+                SetNode(Nodes[Task.Node], Task.Range.Bounds, Task.Begin, Task.End - Task.Begin);
+                continue;
+            }
+
+            const uint32 Child = static_cast<uint32>(Nodes.size());
+            Nodes.emplace_back();
+            Nodes.emplace_back();
+            SetNode(Nodes[Task.Node], Task.Range.Bounds, Child, 0);
+            Left.Node = Child;
+            Right.Node = Child + 1;
+            Stack.push_back(Right);
+            Stack.push_back(Left);
+        }
+
+        // Largest subtrees first so the last jobs are short
+        std::sort(Subtrees.begin(), Subtrees.end(), [](const FBuildTask& A, const FBuildTask& B)
+        {
+            return A.End - A.Begin > B.End - B.Begin;
+        });
+
+        std::vector<std::vector<FNode>> SubtreeNodes(Subtrees.size());
+        auto BuildTask = [&](uint32 Index, uint32)
+        {
+            BuildSubtree(Prims.data(), Subtrees[Index], MaxLeafSize, SubtreeNodes[Index]);
+        };
+        if (JobSystem && Subtrees.size() > 1)
+        {
+            JobSystem->ParallelFor(static_cast<uint32>(Subtrees.size()), BuildTask);
+        }
+        else
+        {
+            for (uint32 Index = 0; Index < Subtrees.size(); ++Index)
+            {
+                BuildTask(Index, 0);
+            }
+        }
+
+        // Subtree roots replace their placeholders, the rest is appended with rebased indices
+        size_t TotalNodes = Nodes.size();
+        for (const std::vector<FNode>& Local : SubtreeNodes)
+        {
+            TotalNodes += Local.size() - 1;
+        }
+        Nodes.reserve(TotalNodes);
+
+        for (size_t Index = 0; Index < Subtrees.size(); ++Index)
+        {
+            const std::vector<FNode>& Local = SubtreeNodes[Index];
+            const uint32 Offset = static_cast<uint32>(Nodes.size()) - 1;
+
+            FNode Root = Local[0];
+            if (!IsLeaf(Root))
+            {
+                Root.Index += Offset;
+            }
+            Nodes[Subtrees[Index].Node] = Root;
+
+            for (size_t LocalIndex = 1; LocalIndex < Local.size(); ++LocalIndex)
+            {
+                FNode Node = Local[LocalIndex];
+                if (!IsLeaf(Node))
+                {
+                    Node.Index += Offset;
+                }
+                Nodes.push_back(Node);
+            }
+        }
+    }
+}
+
+void KSceneBVH::FTree::Clear()
+{
+    Nodes.clear();
+    Prims.clear();
+    Parents.clear();
+    PrimLeaves.clear();
+    DirtyNodes.clear();
+    NodeDirty.clear();
+    BuiltCount = 0;
+    RemovedCount = 0;
+    Depth = 0;
+    BuildCost = 0.0f;
+    Cost = 0.0f;
+}
+
+void KSceneBVH::FTree::Build(uint32 MaxLeafSize, KJobSystem* JobSystem)
+{
+    if (RemovedCount > 0)
+    {
+        Prims.erase(std::remove_if(Prims.begin(), Prims.end(), [](const FPrim& Prim)
+        {
+            return Prim.Id == InvalidId;
+        }), Prims.end());
+        RemovedCount = 0;
+    }
+
+    DirtyNodes.clear();
+    Nodes.clear();
+    if (!Prims.empty())
+    {
+        BuildNodes(Prims, Nodes, MaxLeafSize > 0 ? MaxLeafSize : 1, JobSystem);
+    }
+    BuiltCount = static_cast<uint32>(Prims.size());
+    FinalizeBuild();
+}
+
+void KSceneBVH::FTree::FinalizeBuild()
+{
+    const uint32 NodeCount = static_cast<uint32>(Nodes.size());
+
+    Parents.assign(NodeCount, InvalidNode);
+    PrimLeaves.resize(Prims.size());
+    NodeDirty.assign(NodeCount, 0);
+    std::vector<uint32> NodeDepths(NodeCount, 1);
+
+    Depth = NodeCount > 0 ? 1 : 0;
+    float WeightedArea = 0.0f;
+    for (uint32 NodeIndex = 0; NodeIndex < NodeCount; ++NodeIndex)
+    {
+        const FNode& Node = Nodes[NodeIndex];
+        const float Area = HalfArea(Node.Min, Node.Max);
+        if (IsLeaf(Node))
+        {
+            for (uint32 Index = Node.Index; Index < Node.Index + Node.Count; ++Index)
+            {
+                PrimLeaves[Index] = NodeIndex;
+            }
+            WeightedArea += Area * IntersectCost * Node.Count;
+        }
+        else
+        {
+            for (uint32 Child = Node.Index; Child < Node.Index + 2; ++Child)
+            {
+                Parents[Child] = NodeIndex;
+                NodeDepths[Child] = NodeDepths[NodeIndex] + 1;
+                Depth = std::max(Depth, NodeDepths[Child]);
+            }
+            WeightedArea += Area * TraversalCost;
+        }
+    }
+
+    const float RootArea = NodeCount > 0 ? HalfArea(Nodes[0].Min, Nodes[0].Max) : 0.0f;
+    BuildCost = RootArea > 0.0f ? WeightedArea / RootArea : 0.0f;
+    Cost = BuildCost;
+}
+
+void KSceneBVH::FTree::SetBox(uint32 Slot, const FBoundingBox& Box)
+{
+    SpatialQuery::ToMinMax(Box, Prims[Slot].Min, Prims[Slot].Max);
+    if (Slot < BuiltCount)
+    {
+        MarkLeafDirty(PrimLeaves[Slot]);
+    }
+}
+
+void KSceneBVH::FTree::RemovePrim(uint32 Slot)
+{
+    // Leave an empty box in place; the next build drops it
+    FPrim& Prim = Prims[Slot];
+    for (uint32 Axis = 0; Axis < 3; ++Axis)
+    {
+        Prim.Min[Axis] = FLT_MAX;
+        Prim.Max[Axis] = -FLT_MAX;
+    }
+    Prim.Id = InvalidId;
+    ++RemovedCount;
+    if (Slot < BuiltCount)
+    {
+        MarkLeafDirty(PrimLeaves[Slot]);
+    }
+}
+
+void KSceneBVH::FTree::MarkLeafDirty(uint32 Leaf)
+{
+    if (!NodeDirty[Leaf])
+    {
+        NodeDirty[Leaf] = 1;
+        DirtyNodes.push_back(Leaf);
+    }
+}
+
+float KSceneBVH::FTree::ComputeRefitNode(uint32 NodeIndex)
+{
+    FNode& Node = Nodes[NodeIndex];
+    FAABB Bounds;
+    Bounds.Reset();
+    if (IsLeaf(Node))
+    {
+        for (uint32 Index = Node.Index; Index < Node.Index + Node.Count; ++Index)
+        {
+            Bounds.Grow(Prims[Index].Min, Prims[Index].Max);
+        }
+    }
+    else
+    {
+        Bounds.Grow(Nodes[Node.Index].Min, Nodes[Node.Index].Max);
+        Bounds.Grow(Nodes[Node.Index + 1].Min, Nodes[Node.Index + 1].Max);
+    }
+
+    for (uint32 Axis = 0; Axis < 3; ++Axis)
+    {
+        Node.Min[Axis] = Bounds.Min[Axis];
+        Node.Max[Axis] = Bounds.Max[Axis];
+    }
+    return Bounds.HalfArea();
+}
+
+bool KSceneBVH::FTree::Refit()
+{
+    if (DirtyNodes.empty())
+    {
+        return false;
+    }
+
+    if (DirtyNodes.size() * FullRefitDivisor > Nodes.size())
+    {
+        RefitAll();
+        return true;
+    }
+
+    // Add the ancestors of the marked leaves once, then refit children before parents
+    const size_t LeafCount = DirtyNodes.size();
+    for (size_t Index = 0; Index < LeafCount; ++Index)
+    {
+        uint32 Node = Parents[DirtyNodes[Index]];
+        while (Node != InvalidNode && !NodeDirty[Node])
+        {
+            NodeDirty[Node] = 1;
+            DirtyNodes.push_back(Node);
+            Node = Parents[Node];
+        }
+    }
+
+    std::sort(DirtyNodes.begin(), DirtyNodes.end(), [](uint32 A, uint32 B) { return A > B; });
+    for (uint32 Node : DirtyNodes)
+    {
+        ComputeRefitNode(Node);
+        NodeDirty[Node] = 0;
+    }
+    DirtyNodes.clear();
+    return false;
+}
+
+void KSceneBVH::FTree::RefitAll()
+{
+    // Children follow their parents, so one reverse pass refits bottom-up
+    float WeightedArea = 0.0f;
+    for (uint32 NodeIndex = static_cast<uint32>(Nodes.size()); NodeIndex-- > 0;)
+    {
+        const float Area = ComputeRefitNode(NodeIndex);
+        const FNode& Node = Nodes[NodeIndex];
+        WeightedArea += Area * (IsLeaf(Node) ? IntersectCost * Node.Count : TraversalCost);
+    }
+
+    for (uint32 Node : DirtyNodes)
+    {
+        NodeDirty[Node] = 0;
+    }
+    DirtyNodes.clear();
+
+    const float RootArea = Nodes.empty() ? 0.0f : HalfArea(Nodes[0].Min, Nodes[0].Max);
+    Cost = RootArea > 0.0f ? WeightedArea / RootArea : 0.0f;
+}
+
+template<typename NodeTest, typename ItemTest>
+uint32 KSceneBVH::FTree::Query(uint32 InitialState, NodeTest&& TestNode, ItemTest&& TestItem,
+                               std::vector<uint32>& OutUserData) const
+{
+    uint32 Appended = 0;
+    if (!Nodes.empty())
+    {
+        struct FEntry
+        {
+            uint32 Node;
+            uint32 State;
+        };
+        FEntry Stack[MaxDepth + 2];
+        uint32 StackSize = 0;
+        Stack[StackSize++] = { 0, InitialState };
+
+        while (StackSize > 0)
+        {
+            const FEntry Entry = Stack[--StackSize];
+            const FNode& Node = Nodes[Entry.Node];
+            uint32 State = Entry.State;
+            if (!TestNode(Node.Min, Node.Max, State))
+            {
+                continue;
+            }
+
+            // Fully inside: take the whole subtree without further tests
+            if (State == 0)
+            {
+                uint32 Begin, End;
+                GetSubtreeRange(Nodes, Entry.Node, Begin, End);
+                Appended += AppendRange(Prims, Begin, End, OutUserData);
+                continue;
+            }
+
+            if (!IsLeaf(Node))
+            {
+                Stack[StackSize++] = { Node.Index + 1, State };
+                Stack[StackSize++] = { Node.Index, State };
+                continue;
+            }
+
+            for (uint32 Index = Node.Index; Index < Node.Index + Node.Count; ++Index)
+            {
+                const FPrim& Prim = Prims[Index];
+                if (Prim.Id != InvalidId && TestItem(Prim, State))
+                {
+                    OutUserData.push_back(Prim.UserData);
+                    ++Appended;
+                }
+            }
+        }
+    }
+
+    for (uint32 Index = BuiltCount; Index < Prims.size(); ++Index)
+    {
+        const FPrim& Prim = Prims[Index];
+        if (Prim.Id != InvalidId && TestItem(Prim, InitialState))
+        {
+            OutUserData.push_back(Prim.UserData);
+            ++Appended;
+        }
+    }
+    return Appended;
+}
+
+void KSceneBVH::FTree::CollectNearest(KNearestCollector& Collector) const
+{
+    for (uint32 Index = BuiltCount; Index < Prims.size(); ++Index)
+    {
+        if (Prims[Index].Id != InvalidId)
+        {
+            Collector.Offer(Prims[Index]);
+        }
+    }
+
+    if (Nodes.empty())
+    {
+        return;
+    }
+
+    // Best first: nodes in order of their distance, until the farthest kept object is closer
+    struct FEntry
+    {
+        float DistanceSquared;
+        uint32 Node;
+
+        bool operator<(const FEntry& Other) const
+        {
+            // Reversed for a min-heap
+            return DistanceSquared > Other.DistanceSquared;
+        }
+    };
+    const float* Point = Collector.GetPoint();
+    std::vector<FEntry> Heap;
+    Heap.push_back({ SpatialQuery::DistanceSquared(Point, Nodes[0].Min, Nodes[0].Max), 0 });
+    while (!Heap.empty())
+    {
+        std::pop_heap(Heap.begin(), Heap.end());
+        const FEntry Entry = Heap.back();
+        Heap.pop_back();
+        if (Entry.DistanceSquared > Collector.GetLimitSquared())
+        {
+            break;
+        }
+
+        const FNode& Node = Nodes[Entry.Node];
+        if (IsLeaf(Node))
+        {
+            for (uint32 Index = Node.Index; Index < Node.Index + Node.Count; ++Index)
+            {
+                if (Prims[Index].Id != InvalidId)
+                {
+                    Collector.Offer(Prims[Index]);
+                }
+            }
+            continue;
+        }
+
+        for (uint32 Child = Node.Index; Child < Node.Index + 2; ++Child)
+        {
+            const float DistanceSquared = SpatialQuery::DistanceSquared(Point, Nodes[Child].Min, Nodes[Child].Max);
+            if (DistanceSquared <= Collector.GetLimitSquared())
+            {
+                Heap.push_back({ DistanceSquared, Child });
+                std::push_heap(Heap.begin(), Heap.end());
+            }
+        }
+    }
+}
+
+void KSceneBVH::FTree::Raycast(const FSceneRay& Ray, FSceneRayHit& InOutHit, float& InOutClosest) const
+{
+    const FRayData Data(Ray);
+    auto TestPrim = [&](const FPrim& Prim)
+    {
+        if (Prim.Id == InvalidId)
+        {
+            return;
+        }
+        const float Distance = Data.Intersect(Prim.Min, Prim.Max, InOutClosest);
+        if (Distance < FLT_MAX && (Distance < InOutClosest || InOutHit.UserData == FSceneRayHit::NoHit))
+        {
+            InOutClosest = Distance;
+            InOutHit.UserData = Prim.UserData;
+        }
+    };
+
+    for (uint32 Index = BuiltCount; Index < Prims.size(); ++Index)
+    {
+        TestPrim(Prims[Index]);
+    }
+
+    if (Nodes.empty() || Data.Intersect(Nodes[0].Min, Nodes[0].Max, InOutClosest) == FLT_MAX)
+    {
+        return;
+    }
+
+    struct FEntry
+    {
+        uint32 Node;
+        float Distance;
+    };
+    FEntry Stack[MaxDepth + 2];
+    uint32 StackSize = 0;
+    Stack[StackSize++] = { 0, 0.0f };
+
+    while (StackSize > 0)
+    {
+        const FEntry Entry = Stack[--StackSize];
+        if (Entry.Distance > InOutClosest)
+        {
+            continue;
+        }
+
+        const FNode& Node = Nodes[Entry.Node];
+        if (IsLeaf(Node))
+        {
+            for (uint32 Index = Node.Index; Index < Node.Index + Node.Count; ++Index)
+            {
+                TestPrim(Prims[Index]);
+            }
+            continue;
+        }
+
+        // Nearer child on top of the stack, so it can shorten the ray first
+        const FEntry EntryA = { Node.Index, Data.Intersect(Nodes[Node.Index].Min, Nodes[Node.Index].Max, InOutClosest) };
+        const FEntry EntryB = { Node.Index + 1, Data.Intersect(Nodes[Node.Index + 1].Min, Nodes[Node.Index + 1].Max, InOutClosest) };
+        const bool bAFirst = EntryA.Distance <= EntryB.Distance;
+        const FEntry& Nearer = bAFirst ? EntryA : EntryB;
+        const FEntry& Farther = bAFirst ? EntryB : EntryA;
+        if (Farther.Distance < FLT_MAX)
+        {
+            Stack[StackSize++] = Farther;
+        }
+        if (Nearer.Distance < FLT_MAX)
+        {
+            Stack[StackSize++] = Nearer;
+        }
+    }
+}
+
+uint32 KSceneBVH::Insert(const FBoundingBox& Box, uint32 UserData)
+{
+    uint32 Id;
+    if (!FreeIds.empty())
+    {
+        Id = FreeIds.back();
+        FreeIds.pop_back();
+    }
+    else
+    {
+        Id = static_cast<uint32>(Objects.size());
+        Objects.emplace_back();
+    }
+
+    FPrim Prim;
+    SpatialQuery::ToMinMax(Box, Prim.Min, Prim.Max);
+    Prim.Id = Id;
+    Prim.UserData = UserData;
+
+    Objects[Id].Slot = PendingBit | static_cast<uint32>(PendingTree.Prims.size());
+    Objects[Id].UserData = UserData;
+    PendingTree.Prims.push_back(Prim);
+    return Id;
+}
+
+void KSceneBVH::Remove(uint32 Id)
+{
+    if (!IsValid(Id))
+    {
+        return;
+    }
+
+    const uint32 Slot = Objects[Id].Slot;
+    if (Slot & PendingBit)
+    {
+        PendingTree.RemovePrim(Slot & ~PendingBit);
+    }
+    else
+    {
+        Tree.RemovePrim(Slot);
+    }
+
+    Objects[Id].Slot = InvalidId;
+    FreeIds.push_back(Id);
+}
+
+void KSceneBVH::Move(uint32 Id, const FBoundingBox& Box)
+{
+    if (!IsValid(Id))
+    {
+        return;
+    }
+
+    const uint32 Slot = Objects[Id].Slot;
+    if (Slot & PendingBit)
+    {
+        PendingTree.SetBox(Slot & ~PendingBit, Box);
+    }
+    else
+    {
+        Tree.SetBox(Slot, Box);
+    }
+}
+
+void KSceneBVH::Clear()
+{
+    Objects.clear();
+    FreeIds.clear();
+    Tree.Clear();
+    PendingTree.Clear();
+}
+
+void KSceneBVH::Update(KJobSystem* JobSystem)
+{
+    KE_PROFILE_FUNCTION();
+
+    const uint32 PendingCount = PendingTree.GetLiveCount();
+    const bool bPendingRebuild = PendingCount > 0 &&
+        (Tree.Nodes.empty() || (PendingCount >= Settings.MinPendingForRebuild &&
+                                PendingCount > Settings.RebuildPendingFraction * GetObjectCount()));
+    const bool bRemovedRebuild = Tree.RemovedCount > 0 && Tree.RemovedCount * 2 >= Tree.Prims.size();
+    if (bPendingRebuild || bRemovedRebuild)
+    {
+        Rebuild(JobSystem);
+        return;
+    }
+
+    if (PendingTree.Prims.size() - PendingTree.BuiltCount > Settings.PendingTailSize ||
+        PendingTree.RemovedCount * 2 > PendingTree.Prims.size())
+    {
+        RebuildPending();
+    }
+    else
+    {
+        PendingTree.Refit();
+    }
+
+    // The cost is only known after a full refit, so only those can trigger a rebuild
+    if (Tree.Refit() && Tree.Cost > Tree.BuildCost * Settings.RebuildCostRatio)
+    {
+        Rebuild(JobSystem);
+    }
+}
+
+void KSceneBVH::Rebuild(KJobSystem* JobSystem)
+{
+    KE_PROFILE_FUNCTION();
+
+    for (const FPrim& Prim : PendingTree.Prims)
+    {
+        if (Prim.Id != InvalidId)
+        {
+            Tree.Prims.push_back(Prim);
+        }
+    }
+    PendingTree.Clear();
+
+    Tree.Build(Settings.MaxLeafSize, JobSystem);
+    AssignSlots(Tree, 0);
+    ++RebuildCount;
+}
+
+void KSceneBVH::RebuildPending()
+{
+    PendingTree.Build(Settings.MaxLeafSize, nullptr);
+    AssignSlots(PendingTree, PendingBit);
+}
+
+void KSceneBVH::AssignSlots(const FTree& InTree, uint32 SlotBit)
+{
+    for (uint32 Index = 0; Index < InTree.Prims.size(); ++Index)
+    {
+        Objects[InTree.Prims[Index].Id].Slot = SlotBit | Index;
+    }
+}
+
+uint32 KSceneBVH::QueryFrustum(const FFrustum& Frustum, std::vector<uint32>& OutUserData) const
+{
+    KE_PROFILE_FUNCTION();
+
+    // State is the mask of planes the node is not yet known to be inside of
+    auto TestNode = [&](const float Min[3], const float Max[3], uint32& State)
+    {
+        return SpatialQuery::TestFrustum(Frustum, Min, Max, State);
+    };
+    auto TestItem = [&](const FPrim& Prim, uint32 State)
+    {
+        return SpatialQuery::TestFrustum(Frustum, Prim.Min, Prim.Max, State);
+    };
+    return Tree.Query(SpatialQuery::AllPlanes, TestNode, TestItem, OutUserData) +
+           PendingTree.Query(SpatialQuery::AllPlanes, TestNode, TestItem, OutUserData);
+}
+
+uint32 KSceneBVH::QueryBox(const FBoundingBox& Box, std::vector<uint32>& OutUserData) const
+{
+    float QueryMin[3], QueryMax[3];
+    SpatialQuery::ToMinMax(Box, QueryMin, QueryMax);
+
+    auto TestNode = [&](const float Min[3], const float Max[3], uint32& State)
+    {
+        if (!SpatialQuery::Overlaps(Min, Max, QueryMin, QueryMax))
+        {
+            return false;
+        }
+        State = SpatialQuery::Contains(QueryMin, QueryMax, Min, Max) ? 0 : 1;
+        return true;
+    };
+    auto TestItem = [&](const FPrim& Prim, uint32)
+    {
+        return SpatialQuery::Overlaps(Prim.Min, Prim.Max, QueryMin, QueryMax);
+    };
+    return Tree.Query(1, TestNode, TestItem, OutUserData) + PendingTree.Query(1, TestNode, TestItem, OutUserData);
+}
+
+uint32 KSceneBVH::QuerySphere(const FBoundingSphere& Sphere, std::vector<uint32>& OutUserData) const
+{
+    auto TestNode = [&](const float Min[3], const float Max[3], uint32& State)
+    {
+        if (!SpatialQuery::OverlapsSphere(Sphere, Min, Max))
+        {
+            return false;
+        }
+        State = SpatialQuery::ContainedInSphere(Sphere, Min, Max) ? 0 : 1;
+        return true;
+    };
+    auto TestItem = [&](const FPrim& Prim, uint32)
+    {
+        return SpatialQuery::OverlapsSphere(Sphere, Prim.Min, Prim.Max);
+    };
+    return Tree.Query(1, TestNode, TestItem, OutUserData) + PendingTree.Query(1, TestNode, TestItem, OutUserData);
+}
+
+uint32 KSceneBVH::QueryNearest(const float Point[3], uint32 Count, float MaxDistance,
+                               std::vector<FSpatialNeighbor>& OutNeighbors) const
+{
+    KNearestCollector Collector(Point, Count, MaxDistance);
+    PendingTree.CollectNearest(Collector);
+    Tree.CollectNearest(Collector);
+    return Collector.Finish(OutNeighbors);
+}
+
+FSceneRayHit KSceneBVH::Raycast(const FSceneRay& Ray) const
+{
+    FSceneRayHit Hit;
+    float Closest = Ray.MaxDistance;
+    Tree.Raycast(Ray, Hit, Closest);
+    PendingTree.Raycast(Ray, Hit, Closest);
+    Hit.Distance = Hit.UserData != FSceneRayHit::NoHit ? Closest : 0.0f;
+    return Hit;
+}
+
+void KSceneBVH::RaycastBatch(const FSceneRay* Rays, uint32 RayCount, FSceneRayHit* OutHits,
+                             KJobSystem* JobSystem) const
+{
+    KE_PROFILE_FUNCTION();
+
+    auto CastChunk = [&](uint32 Chunk, uint32)
+    {
+        const uint32 Begin = Chunk * RayChunkSize;
+        const uint32 End = std::min(Begin + RayChunkSize, RayCount);
+        for (uint32 Index = Begin; Index < End; ++Index)
+        {
+            OutHits[Index] = Raycast(Rays[Index]);
+        }
+    };
+
+    const uint32 ChunkCount = (RayCount + RayChunkSize - 1) / RayChunkSize;
+    if (JobSystem && ChunkCount > 1)
+    {
+        JobSystem->ParallelFor(ChunkCount, CastChunk);
+    }
+    else
+    {
+        for (uint32 Chunk = 0; Chunk < ChunkCount; ++Chunk)
+        {
+            CastChunk(Chunk, 0);
+        }
+    }
+}
+
+FSceneBVHStats KSceneBVH::GetStats() const
+{
+    FSceneBVHStats Stats;
+    Stats.ObjectCount = GetObjectCount();
+    Stats.PendingCount = PendingTree.GetLiveCount();
+    Stats.NodeCount = static_cast<uint32>(Tree.Nodes.size());
+    for (const FNode& Node : Tree.Nodes)
+    {
+        Stats.LeafCount += IsLeaf(Node) ? 1 : 0;
+    }
+    Stats.Depth = Tree.Depth;
+    Stats.BuildCost = Tree.BuildCost;
+    Stats.Cost = Tree.Cost;
+    Stats.RebuildCount = RebuildCount;
+    return Stats;
+}
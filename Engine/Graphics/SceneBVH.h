@@ -0,0 +1,263 @@
+﻿#pragma once
+
+#include "SpatialIndex.h"
+
+/**
+ * @brief Ray for scene queries (Direction need not be normalized; distances are in its units)
+ */
+struct FSceneRay
+{
+    float Origin[3] = { 0.0f, 0.0f, 0.0f };
+    float Direction[3] = { 0.0f, 0.0f, 1.0f };
+    float MaxDistance = 3.402823466e+38f;
+};
+
+/**
+ * @brief Closest object box hit by a ray
+ */
+struct FSceneRayHit
+{
+    static constexpr uint32 NoHit = 0xFFFFFFFFu;
+
+    uint32 UserData = NoHit;    // UserData of the hit object, NoHit if none
+    float Distance = 0.0f;      // Ray parameter of the box entry (0 if the origin is inside)
+};
+
+/**
+ * @brief Rebuild and build settings of a scene BVH
+ */
+struct FSceneBVHSettings
+{
+    uint32 MaxLeafSize = 8;                 // Leaves hold 1 - MaxLeafSize objects (SAH decides)
+    float RebuildCostRatio = 1.5f;          // Rebuild when refits grew the SAH cost by this factor
+    float RebuildPendingFraction = 0.05f;   // Rebuild when objects inserted since the build exceed this fraction
+    uint32 MinPendingForRebuild = 256;      // ... and this count
+    uint32 PendingTailSize = 64;            // Inserts tested linearly before the pending tree is rebuilt
+};
+
+/**
+ * @brief Scene BVH statistics
+ */
+struct FSceneBVHStats
+{
+    uint32 ObjectCount = 0;
+    uint32 PendingCount = 0;    // Inserted since the last full build (in the pending tree)
+    uint32 NodeCount = 0;
+    uint32 LeafCount = 0;
+    uint32 Depth = 0;
+    float BuildCost = 0.0f;     // SAH cost right after the last build
+    float Cost = 0.0f;          // SAH cost after the last full refit
+    uint32 RebuildCount = 0;
+};
+
+/**
+ * @brief Dynamic bounding volume hierarchy over scene object boxes
+ *
+ * Built top-down with a binned SAH builder: large nodes are binned in
+ * parallel on the job system, then the remaining subtrees are built in
+ * parallel. Nodes are a flat array (children adjacent, after their parent)
+ * and the object boxes are stored in leaf order, so a full refit is one
+ * reverse pass and leaf tests read contiguous memory.
+ *
+ * Move updates an object's box in place and marks its leaf; Update refits
+ * the marked paths (or every node when many moved) and rebuilds when the
+ * SAH cost degraded or many objects were inserted since the build. Inserts
+ * go to a small pending tree, rebuilt whenever its linearly tested tail
+ * grows past PendingTailSize, so a full build is only needed once they are
+ * a sizable fraction of the scene. Queries are const and may run
+ * concurrently with each other. Platform independent.
+ */
+class KSceneBVH : public ISpatialIndex
+{
+public:
+    static constexpr uint32 MaxDepth = 64;
+
+    KSceneBVH() = default;
+
+    void SetSettings(const FSceneBVHSettings& InSettings) { Settings = InSettings; }
+    const FSceneBVHSettings& GetSettings() const { return Settings; }
+
+    /**
+     * @brief Add an object
+     * @param Box World-space box
+     * @param UserData Value the queries report for the object
+     * @return Object id (stable until Remove)
+     */
+    uint32 Insert(const FBoundingBox& Box, uint32 UserData) override;
+
+    /**
+     * @brief Remove an object; its id may be reused by a later Insert
+     */
+    void Remove(uint32 Id) override;
+
+    /**
+     * @brief Update an object's box (applied to the tree at the next Update)
+     */
+    void Move(uint32 Id, const FBoundingBox& Box) override;
+
+    /**
+     * @brief Remove every object and the tree
+     */
+    void Clear() override;
+
+    /**
+     * @brief Refit moved objects, rebuild if the tree degraded
+     * @param JobSystem Worker pool for a rebuild, nullptr for the calling thread
+     */
+    void Update(KJobSystem* JobSystem = nullptr) override;
+
+    /**
+     * @brief Build the tree over all objects
+     * @param JobSystem Worker pool, nullptr for the calling thread
+     */
+    void Rebuild(KJobSystem* JobSystem = nullptr);
+
+    /**
+     * @brief Append the UserData of objects whose box intersects the frustum (conservative)
+     * @return Number of objects appended
+     */
+    uint32 QueryFrustum(const FFrustum& Frustum, std::vector<uint32>& OutUserData) const override;
+
+    /**
+     * @brief Append the UserData of objects whose box overlaps Box
+     * @return Number of objects appended
+     */
+    uint32 QueryBox(const FBoundingBox& Box, std::vector<uint32>& OutUserData) const override;
+
+    /**
+     * @brief Append the UserData of objects whose box overlaps the sphere
+     * @return Number of objects appended
+     */
+    uint32 QuerySphere(const FBoundingSphere& Sphere, std::vector<uint32>& OutUserData) const override;
+
+    /**
+     * @brief Up to Count objects closest to Point within MaxDistance, nearest first
+     * @return Number of neighbors appended
+     */
+    uint32 QueryNearest(const float Point[3], uint32 Count, float MaxDistance,
+                        std::vector<FSpatialNeighbor>& OutNeighbors) const override;
+
+    /**
+     * @brief Closest object box hit by each ray
+     * @param JobSystem Worker pool the rays are split across, nullptr for the calling thread
+     */
+    void RaycastBatch(const FSceneRay* Rays, uint32 RayCount, FSceneRayHit* OutHits,
+                      KJobSystem* JobSystem = nullptr) const;
+
+    /**
+     * @brief Closest object box hit by one ray
+     */
+    FSceneRayHit Raycast(const FSceneRay& Ray) const;
+
+    uint32 GetObjectCount() const override { return static_cast<uint32>(Objects.size() - FreeIds.size()); }
+    bool IsValid(uint32 Id) const override { return Id < Objects.size() && Objects[Id].Slot != InvalidId; }
+    uint32 GetUserData(uint32 Id) const override { return Objects[Id].UserData; }
+
+    /**
+     * @brief Statistics (Cost is refreshed by full refits and builds)
+     */
+    FSceneBVHStats GetStats() const;
+
+public:
+    /**
+     * @brief Node: leaf if Count > 0 (objects [Index, Index + Count) of the leaf-ordered
+     *        boxes), else internal with children Index and Index + 1
+     */
+    struct FNode
+    {
+        float Min[3];
+        uint32 Index;
+        float Max[3];
+        uint32 Count;
+    };
+
+    /**
+     * @brief Object box in leaf order (Id is InvalidId once removed, the box is then empty)
+     */
+    using FPrim = FSpatialItem;
+
+private:
+    struct FObject
+    {
+        uint32 Slot = InvalidId;    // Index in the main tree's Prims, or in the pending tree's with PendingBit set
+        uint32 UserData = 0;
+    };
+
+    static constexpr uint32 PendingBit = 0x80000000u;
+
+    /**
+     * @brief Node array over leaf-ordered object boxes, followed by an unbuilt tail
+     */
+    struct FTree
+    {
+        std::vector<FNode> Nodes;
+        std::vector<FPrim> Prims;
+        std::vector<uint32> Parents;
+        std::vector<uint32> PrimLeaves;
+        uint32 BuiltCount = 0;      // Prims covered by the nodes; the rest are tested linearly
+        uint32 RemovedCount = 0;    // Removed prims still holding a slot
+
+        // Leaves whose objects moved, and the per-node mark
+        std::vector<uint32> DirtyNodes;
+        std::vector<uint8> NodeDirty;
+
+        uint32 Depth = 0;
+        float BuildCost = 0.0f;
+        float Cost = 0.0f;
+
+        uint32 GetLiveCount() const { return static_cast<uint32>(Prims.size()) - RemovedCount; }
+
+        void Clear();
+
+        /**
+         * @brief Build over the live prims (removed ones are dropped, the order changes)
+         */
+        void Build(uint32 MaxLeafSize, KJobSystem* JobSystem);
+
+        void SetBox(uint32 Slot, const FBoundingBox& Box);
+        void RemovePrim(uint32 Slot);
+
+        /**
+         * @brief Recompute the bounds of marked nodes and their ancestors, or of every node
+         * @return True if every node was refit (Cost is then current)
+         */
+        bool Refit();
+        void RefitAll();
+
+        /**
+         * @brief Traversal shared by the overlap queries (same tests as the loose octree's)
+         *
+         * TestNode(Min, Max, State) rejects a node or narrows State, 0 meaning fully
+         * inside (its object range is then taken without tests); TestItem(Item, State)
+         * tests an object of a node that is not fully inside.
+         */
+        template<typename NodeTest, typename ItemTest>
+        uint32 Query(uint32 InitialState, NodeTest&& TestNode, ItemTest&& TestItem, std::vector<uint32>& OutUserData) const;
+
+        void CollectNearest(KNearestCollector& Collector) const;
+        void Raycast(const FSceneRay& Ray, FSceneRayHit& InOutHit, float& InOutClosest) const;
+
+    private:
+        void FinalizeBuild();
+        void MarkLeafDirty(uint32 Leaf);
+        float ComputeRefitNode(uint32 NodeIndex);
+    };
+
+    /**
+     * @brief Point the objects of a freshly built tree at their new slots
+     */
+    void AssignSlots(const FTree& InTree, uint32 SlotBit);
+
+    void RebuildPending();
+
+private:
+    FSceneBVHSettings Settings;
+
+    std::vector<FObject> Objects;
+    std::vector<uint32> FreeIds;
+
+    FTree Tree;
+    FTree PendingTree;
+
+    uint32 RebuildCount = 0;
+};
@@ -1,51 +1,32 @@
 ﻿#include "Shader.h"
+#include "RenderStateCache.h"
+#include "../Core/Profiler.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
 
 // UShader class implementation
 
-HRESULT KShader::LoadFromFile(ID3D11Device* Device, const std::wstring& Filename, 
+HRESULT KShader::LoadFromFile(IRHIDevice* Device, const std::wstring& Filename, 
                             const std::string& EntryPoint, EShaderType InType)
 {
-    Type = InType;
-
-    DWORD ShaderFlags = D3DCOMPILE_ENABLE_STRICTNESS;
-#ifdef _DEBUG
-    ShaderFlags |= D3DCOMPILE_DEBUG;
-    ShaderFlags |= D3DCOMPILE_SKIP_OPTIMIZATION;
-#endif
-
-    ComPtr<ID3DBlob> ErrorBlob;
-    std::string Profile = GetProfileString(InType);
-
-    // Compile shader from file
-    HRESULT hr = D3DCompileFromFile(
-        Filename.c_str(),
-        nullptr,
-        nullptr,
-        EntryPoint.c_str(),
-        Profile.c_str(),
-        ShaderFlags,
-        0,
-        &Blob,
-        &ErrorBlob
-    );
+    KE_PROFILE_FUNCTION();
 
-    if (FAILED(hr))
+    const std::string SourceName = StringUtils::WideToMultiByte(Filename);
+    std::ifstream File(std::filesystem::path(Filename), std::ios::binary);
+    if (!File)
     {
-        if (ErrorBlob)
-        {
-            std::string ErrorMsg = "Shader Compilation Error: ";
-            ErrorMsg += static_cast<const char*>(ErrorBlob->GetBufferPointer());
-            LOG_ERROR(ErrorMsg);
-        }
-        KLogger::HResultError(hr, "Shader file compilation failed");
-        return hr;
+        LOG_ERROR("Shader file not found: " + SourceName);
+        return E_INVALIDARG;
     }
 
-    // Create shader object
-    hr = CreateShaderFromBlob(Device);
+    std::ostringstream Source;
+    Source << File.rdbuf();
+
+    HRESULT hr = Compile(Device, Source.str(), SourceName, EntryPoint, InType);
     if (FAILED(hr))
     {
-        KLogger::HResultError(hr, "Shader object creation failed");
+        KLogger::HResultError(hr, "Shader file compilation failed");
         return hr;
     }
 
@@ -53,201 +34,82 @@ HRESULT KShader::LoadFromFile(ID3D11Device* Device, const std::wstring& Filename
     return S_OK;
 }
 
-HRESULT KShader::CompileFromString(ID3D11Device* Device, const std::string& Source,
+HRESULT KShader::CompileFromString(IRHIDevice* Device, const std::string& Source,
                                  const std::string& EntryPoint, EShaderType InType)
 {
-    Type = InType;
-
-    DWORD ShaderFlags = D3DCOMPILE_ENABLE_STRICTNESS;
-#ifdef _DEBUG
-    ShaderFlags |= D3DCOMPILE_DEBUG;
-    ShaderFlags |= D3DCOMPILE_SKIP_OPTIMIZATION;
-#endif
-
-    ComPtr<ID3DBlob> ErrorBlob;
-    std::string Profile = GetProfileString(InType);
-
-    // Compile shader from string
-    HRESULT hr = D3DCompile(
-        Source.c_str(),
-        Source.length(),
-        nullptr,
-        nullptr,
-        nullptr,
-        EntryPoint.c_str(),
-        Profile.c_str(),
-        ShaderFlags,
-        0,
-        &Blob,
-        &ErrorBlob
-    );
+    KE_PROFILE_FUNCTION();
 
+    HRESULT hr = Compile(Device, Source, std::string(), EntryPoint, InType);
     if (FAILED(hr))
     {
-        if (ErrorBlob)
-        {
-            std::string ErrorMsg = "Shader Compilation Error: ";
-            ErrorMsg += static_cast<const char*>(ErrorBlob->GetBufferPointer());
-            LOG_ERROR(ErrorMsg);
-        }
         KLogger::HResultError(hr, "Shader string compilation failed");
         return hr;
     }
 
-    // Create shader object
-    hr = CreateShaderFromBlob(Device);
-    if (FAILED(hr))
-    {
-        KLogger::HResultError(hr, "Shader object creation failed");
-        return hr;
-    }
-
     LOG_INFO("Shader string compilation completed");
     return S_OK;
 }
 
-void KShader::Bind(ID3D11DeviceContext* Context) const
+void KShader::Bind(IRHICommandContext& Context) const
 {
-    switch (Type)
-    {
-    case EShaderType::Vertex:
-        Context->VSSetShader(VertexShader.Get(), nullptr, 0);
-        break;
-    case EShaderType::Pixel:
-        Context->PSSetShader(PixelShader.Get(), nullptr, 0);
-        break;
-    case EShaderType::Geometry:
-        Context->GSSetShader(GeometryShader.Get(), nullptr, 0);
-        break;
-    case EShaderType::Hull:
-        Context->HSSetShader(HullShader.Get(), nullptr, 0);
-        break;
-    case EShaderType::Domain:
-        Context->DSSetShader(DomainShader.Get(), nullptr, 0);
-        break;
-    case EShaderType::Compute:
-        Context->CSSetShader(ComputeShader.Get(), nullptr, 0);
-        break;
-    }
+    Context.SetShader(Type, Shader.Get());
 }
 
-void KShader::Unbind(ID3D11DeviceContext* Context) const
+void KShader::Unbind(IRHICommandContext& Context) const
 {
-    switch (Type)
-    {
-    case EShaderType::Vertex:
-        Context->VSSetShader(nullptr, nullptr, 0);
-        break;
-    case EShaderType::Pixel:
-        Context->PSSetShader(nullptr, nullptr, 0);
-        break;
-    case EShaderType::Geometry:
-        Context->GSSetShader(nullptr, nullptr, 0);
-        break;
-    case EShaderType::Hull:
-        Context->HSSetShader(nullptr, nullptr, 0);
-        break;
-    case EShaderType::Domain:
-        Context->DSSetShader(nullptr, nullptr, 0);
-        break;
-    case EShaderType::Compute:
-        Context->CSSetShader(nullptr, nullptr, 0);
-        break;
-    }
+    Context.SetShader(Type, nullptr);
 }
 
-std::string KShader::GetProfileString(EShaderType InType) const
+HRESULT KShader::Compile(IRHIDevice* Device, const std::string& Source, const std::string& SourceName,
+                         const std::string& EntryPoint, EShaderType InType)
 {
-    switch (InType)
+    if (!Device)
     {
-    case EShaderType::Vertex:   return "vs_4_0";
-    case EShaderType::Pixel:    return "ps_4_0";
-    case EShaderType::Geometry: return "gs_4_0";
-    case EShaderType::Hull:     return "hs_5_0";
-    case EShaderType::Domain:   return "ds_5_0";
-    case EShaderType::Compute:  return "cs_4_0";
-    default:                    return "vs_4_0";
+        return E_INVALIDARG;
     }
-}
 
-HRESULT KShader::CreateShaderFromBlob(ID3D11Device* Device)
-{
-    HRESULT hr = S_OK;
+    Type = InType;
+    Shader.Reset();
 
-    switch (Type)
+    std::string Errors;
+    if (!Device->CompileShader(InType, Source, SourceName, EntryPoint, Bytecode, Errors))
     {
-    case EShaderType::Vertex:
-        hr = Device->CreateVertexShader(
-            Blob->GetBufferPointer(),
-            Blob->GetBufferSize(),
-            nullptr,
-            &VertexShader
-        );
-        break;
-
-    case EShaderType::Pixel:
-        hr = Device->CreatePixelShader(
-            Blob->GetBufferPointer(),
-            Blob->GetBufferSize(),
-            nullptr,
-            &PixelShader
-        );
-        break;
-
-    case EShaderType::Geometry:
-        hr = Device->CreateGeometryShader(
-            Blob->GetBufferPointer(),
-            Blob->GetBufferSize(),
-            nullptr,
-            &GeometryShader
-        );
-        break;
-
-    case EShaderType::Hull:
-        hr = Device->CreateHullShader(
-            Blob->GetBufferPointer(),
-            Blob->GetBufferSize(),
-            nullptr,
-            &HullShader
-        );
-        break;
-
-    case EShaderType::Domain:
-        hr = Device->CreateDomainShader(
-            Blob->GetBufferPointer(),
-            Blob->GetBufferSize(),
-            nullptr,
-            &DomainShader
-        );
-        break;
-
-    case EShaderType::Compute:
-        hr = Device->CreateComputeShader(
-            Blob->GetBufferPointer(),
-            Blob->GetBufferSize(),
-            nullptr,
-            &ComputeShader
-        );
-        break;
-
-    default:
-        return E_INVALIDARG;
+        if (!Errors.empty())
+        {
+            LOG_ERROR("Shader Compilation Error: " + Errors);
+        }
+        return E_FAIL;
+    }
+
+    // Create shader object
+    Shader.Reset(Device, Device->CreateShader(InType, Bytecode.data(), Bytecode.size()));
+    if (!Shader)
+    {
+        LOG_ERROR("Shader object creation failed");
+        return E_FAIL;
     }
 
-    return hr;
+    return S_OK;
 }
 
 // UShaderProgram class implementation
 
-HRESULT KShaderProgram::CreateBasicColorShader(ID3D11Device* Device)
+HRESULT KShaderProgram::CreateBasicColorShader(IRHIDevice* Device)
 {
+    KE_PROFILE_FUNCTION();
+
     // Basic color shader source code (improved version of original TutorialShader.fxh)
     const std::string ShaderSource = R"(
-        cbuffer ConstantBuffer : register(b0)
+        cbuffer PerFrame : register(b0)
+        {
+            row_major matrix View;
+            row_major matrix Projection;
+            row_major matrix ViewProjection;
+        }
+
+        cbuffer PerObject : register(b1)
         {
-            matrix World;
-            matrix View;
-            matrix Projection;
+            row_major matrix World;
         }
 
         struct VS_INPUT
@@ -267,8 +129,77 @@ HRESULT KShaderProgram::CreateBasicColorShader(ID3D11Device* Device)
         {
             PS_INPUT output = (PS_INPUT)0;
             output.Pos = mul(input.Pos, World);
-            output.Pos = mul(output.Pos, View);
-            output.Pos = mul(output.Pos, Projection);
+            output.Pos = mul(output.Pos, ViewProjection);
+            output.Color = input.Color;
+            return output;
+        }
+
+        // Pixel Shader
+        float4 PS(PS_INPUT input) : SV_Target
+        {
+            return input.Color;
+        }
+    )";
+
+    // Create vertex shader
+    auto VertexShader = std::make_shared<KShader>();
+    HRESULT hr = VertexShader->CompileFromString(Device, ShaderSource, "VS", EShaderType::Vertex);
+    if (FAILED(hr)) return hr;
+
+    // Create pixel shader
+    auto PixelShader = std::make_shared<KShader>();
+    hr = PixelShader->CompileFromString(Device, ShaderSource, "PS", EShaderType::Pixel);
+    if (FAILED(hr)) return hr;
+
+    // Add shaders to program
+    AddShader(VertexShader);
+    AddShader(PixelShader);
+
+    // Create input layouts for every mesh vertex layout
+    hr = CreateVertexLayouts(Device);
+    if (FAILED(hr)) return hr;
+
+    LOG_INFO("Basic color shader creation completed");
+    return S_OK;
+}
+
+HRESULT KShaderProgram::CreateBasicColorInstancedShader(IRHIDevice* Device)
+{
+    KE_PROFILE_FUNCTION();
+
+    // Same as the basic color shader, but World comes from the instance stream
+    const std::string ShaderSource = R"(
+        cbuffer PerFrame : register(b0)
+        {
+            row_major matrix View;
+            row_major matrix Projection;
+            row_major matrix ViewProjection;
+        }
+
+        struct VS_INPUT
+        {
+            float4 Pos : POSITION;
+            float4 Color : COLOR;
+            float4 World0 : INSTANCE_WORLD0;
+            float4 World1 : INSTANCE_WORLD1;
+            float4 World2 : INSTANCE_WORLD2;
+            float4 World3 : INSTANCE_WORLD3;
+        };
+
+        struct PS_INPUT
+        {
+            float4 Pos : SV_POSITION;
+            float4 Color : COLOR;
+        };
+
+        // Vertex Shader
+        PS_INPUT VS(VS_INPUT input)
+        {
+            float4x4 InstanceWorld = float4x4(input.World0, input.World1, input.World2, input.World3);
+
+            PS_INPUT output = (PS_INPUT)0;
+            output.Pos = mul(input.Pos, InstanceWorld);
+            output.Pos = mul(output.Pos, ViewProjection);
             output.Color = input.Color;
             return output;
         }
@@ -294,17 +225,117 @@ HRESULT KShaderProgram::CreateBasicColorShader(ID3D11Device* Device)
     AddShader(VertexShader);
     AddShader(PixelShader);
 
-    // Create input layout
-    D3D11_INPUT_ELEMENT_DESC Layout[] =
+    // Create input layouts (mesh streams first, then the per-instance world matrix rows)
+    FRHIInputElement InstanceElements[4];
+    for (UINT32 Row = 0; Row < 4; ++Row)
     {
-        { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-        { "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-    };
+        InstanceElements[Row].SemanticName = "INSTANCE_WORLD";
+        InstanceElements[Row].SemanticIndex = Row;
+        InstanceElements[Row].Format = ERHIFormat::R32G32B32A32_Float;
+        InstanceElements[Row].InputSlot = VertexFormat::InstanceStreamSlot;
+        InstanceElements[Row].AlignedByteOffset = Row * 16;
+        InstanceElements[Row].bPerInstance = true;
+        InstanceElements[Row].InstanceStepRate = 1;
+    }
 
-    hr = CreateInputLayout(Device, Layout, ARRAYSIZE(Layout));
+    hr = CreateVertexLayouts(Device, false, InstanceElements, ARRAYSIZE(InstanceElements));
     if (FAILED(hr)) return hr;
 
-    LOG_INFO("Basic color shader creation completed");
+    LOG_INFO("Basic color instanced shader creation completed");
+    return S_OK;
+}
+
+HRESULT KShaderProgram::CreateSkinnedColorShader(IRHIDevice* Device)
+{
+    KE_PROFILE_FUNCTION();
+
+    // Same as the basic color shader, with linear blend skinning before World
+    const std::string ShaderSource = R"(
+        cbuffer PerFrame : register(b0)
+        {
+            row_major matrix View;
+            row_major matrix Projection;
+            row_major matrix ViewProjection;
+        }
+
+        cbuffer PerObject : register(b1)
+        {
+            row_major matrix World;
+        }
+
+        // Three rows (the transposed 4x3 skinning matrix) per joint
+        cbuffer SkinPalette : register(b2)
+        {
+            float4 Palette[768];
+        }
+
+        struct VS_INPUT
+        {
+            float4 Pos : POSITION;
+            float4 Color : COLOR;
+            uint4 Joints : BLENDINDICES;
+            float4 Weights : BLENDWEIGHT;
+        };
+
+        struct PS_INPUT
+        {
+            float4 Pos : SV_POSITION;
+            float4 Color : COLOR;
+        };
+
+        // Vertex Shader
+        PS_INPUT VS(VS_INPUT input)
+        {
+            float4 Row0 = 0.0f;
+            float4 Row1 = 0.0f;
+            float4 Row2 = 0.0f;
+
+            [unroll]
+            for (int i = 0; i < 4; ++i)
+            {
+                uint Base = input.Joints[i] * 3;
+                Row0 += Palette[Base + 0] * input.Weights[i];
+                Row1 += Palette[Base + 1] * input.Weights[i];
+                Row2 += Palette[Base + 2] * input.Weights[i];
+            }
+
+            float4 LocalPos = float4(input.Pos.xyz, 1.0f);
+            float4 SkinnedPos = float4(dot(LocalPos, Row0), dot(LocalPos, Row1), dot(LocalPos, Row2), 1.0f);
+
+            PS_INPUT output = (PS_INPUT)0;
+            output.Pos = mul(SkinnedPos, World);
+            output.Pos = mul(output.Pos, ViewProjection);
+            output.Color = input.Color;
+            return output;
+        }
+
+        // Pixel Shader
+        float4 PS(PS_INPUT input) : SV_Target
+        {
+            return input.Color;
+        }
+    )";
+
+    // Create vertex shader
+    auto VertexShader = std::make_shared<KShader>();
+    HRESULT hr = VertexShader->CompileFromString(Device, ShaderSource, "VS", EShaderType::Vertex);
+    if (FAILED(hr)) return hr;
+
+    // Create pixel shader
+    auto PixelShader = std::make_shared<KShader>();
+    hr = PixelShader->CompileFromString(Device, ShaderSource, "PS", EShaderType::Pixel);
+    if (FAILED(hr)) return hr;
+
+    // Add shaders to program
+    AddShader(VertexShader);
+    AddShader(PixelShader);
+
+    // Only the skinned layout carries joint influences
+    const EVertexLayout SkinnedLayout = EVertexLayout::Skinned;
+    hr = CreateVertexLayouts(Device, &SkinnedLayout, 1);
+    if (FAILED(hr)) return hr;
+
+    LOG_INFO("Skinned color shader creation completed");
     return S_OK;
 }
 
@@ -313,8 +344,8 @@ void KShaderProgram::AddShader(std::shared_ptr<KShader> InShader)
     Shaders.push_back(InShader);
 }
 
-HRESULT KShaderProgram::CreateInputLayout(ID3D11Device* Device, 
-                                        const D3D11_INPUT_ELEMENT_DESC* InputElements, 
+HRESULT KShaderProgram::CreateInputLayout(IRHIDevice* Device, 
+                                        const FRHIInputElement* InputElements, 
                                         UINT32 NumElements)
 {
     // Vertex shader bytecode is required
@@ -325,29 +356,82 @@ HRESULT KShaderProgram::CreateInputLayout(ID3D11Device* Device,
         return E_FAIL;
     }
 
-    HRESULT hr = Device->CreateInputLayout(
-        InputElements,
-        NumElements,
-        VertexShader->GetBlob()->GetBufferPointer(),
-        VertexShader->GetBlob()->GetBufferSize(),
-        &InputLayout
-    );
+    const std::vector<uint8>& Bytecode = VertexShader->GetBytecode();
+    CustomInputLayout.Reset(Device, Device->CreateInputLayout(InputElements, NumElements, Bytecode.data(), Bytecode.size()));
+    if (!CustomInputLayout)
+    {
+        LOG_ERROR("Input layout creation failed");
+        return E_FAIL;
+    }
 
-    if (FAILED(hr))
+    InputLayout = CustomInputLayout.Get();
+    return S_OK;
+}
+
+HRESULT KShaderProgram::CreateVertexLayouts(IRHIDevice* Device, bool bPositionOnly,
+                                           const FRHIInputElement* InstanceElements, UINT32 NumInstanceElements)
+{
+    // Skinned meshes draw in their bind pose with shaders that ignore the influences
+    const EVertexLayout MeshLayouts[] = {
+        EVertexLayout::Standard, EVertexLayout::Compact, EVertexLayout::CompactSplit,
+        EVertexLayout::Quantized, EVertexLayout::QuantizedSplit, EVertexLayout::Skinned
+    };
+    const EVertexLayout PositionLayouts[] = { EVertexLayout::Position, EVertexLayout::QuantizedPosition };
+
+    return bPositionOnly
+        ? CreateVertexLayouts(Device, PositionLayouts, ARRAYSIZE(PositionLayouts), InstanceElements, NumInstanceElements)
+        : CreateVertexLayouts(Device, MeshLayouts, ARRAYSIZE(MeshLayouts), InstanceElements, NumInstanceElements);
+}
+
+HRESULT KShaderProgram::CreateVertexLayouts(IRHIDevice* Device, const EVertexLayout* Layouts, UINT32 LayoutCount,
+                                           const FRHIInputElement* InstanceElements, UINT32 NumInstanceElements)
+{
+    auto VertexShader = GetShader(EShaderType::Vertex);
+    if (!VertexShader)
     {
-        KLogger::HResultError(hr, "Input layout creation failed");
-        return hr;
+        LOG_ERROR("Vertex shader not found for input layout creation");
+        return E_FAIL;
+    }
+
+    if (!Layouts || LayoutCount == 0)
+    {
+        return E_INVALIDARG;
     }
 
+    const std::vector<uint8>& Bytecode = VertexShader->GetBytecode();
+    std::vector<FRHIInputElement> Elements;
+    for (UINT32 i = 0; i < LayoutCount; ++i)
+    {
+        Elements.clear();
+        VertexFormat::AppendInputElements(Layouts[i], Elements);
+        Elements.insert(Elements.end(), InstanceElements, InstanceElements + NumInstanceElements);
+
+        FRHIResourceRef& Layout = VertexLayouts[static_cast<UINT32>(Layouts[i])];
+        Layout.Reset(Device, Device->CreateInputLayout(Elements.data(), static_cast<uint32>(Elements.size()),
+                                                       Bytecode.data(), Bytecode.size()));
+        if (!Layout)
+        {
+            LOG_ERROR("Input layout creation failed");
+            return E_FAIL;
+        }
+    }
+
+    InputLayout = VertexLayouts[static_cast<UINT32>(Layouts[0])].Get();
     return S_OK;
 }
 
-void KShaderProgram::Bind(ID3D11DeviceContext* Context) const
+FRHIResource KShaderProgram::GetInputLayout(EVertexLayout Layout) const
+{
+    FRHIResource VertexLayout = VertexLayouts[static_cast<UINT32>(Layout)].Get();
+    return VertexLayout ? VertexLayout : InputLayout;
+}
+
+void KShaderProgram::Bind(IRHICommandContext& Context) const
 {
     // Set input layout
     if (InputLayout)
     {
-        Context->IASetInputLayout(InputLayout.Get());
+        Context.SetInputLayout(InputLayout);
     }
 
     // Bind all shaders
@@ -357,7 +441,7 @@ void KShaderProgram::Bind(ID3D11DeviceContext* Context) const
     }
 }
 
-void KShaderProgram::Unbind(ID3D11DeviceContext* Context) const
+void KShaderProgram::Unbind(IRHICommandContext& Context) const
 {
     // Unbind all shaders
     for (const auto& Shader : Shaders)
@@ -366,7 +450,32 @@ void KShaderProgram::Unbind(ID3D11DeviceContext* Context) const
     }
 
     // Remove input layout
-    Context->IASetInputLayout(nullptr);
+    Context.SetInputLayout(nullptr);
+}
+
+void KShaderProgram::Bind(KRenderStateCache& StateCache, EVertexLayout Layout) const
+{
+    StateCache.SetInputLayout(GetInputLayout(Layout));
+
+    // Graphics pipeline stages (compute is left untouched)
+    const EShaderType GraphicsStages[] = {
+        EShaderType::Vertex, EShaderType::Pixel, EShaderType::Geometry,
+        EShaderType::Hull, EShaderType::Domain
+    };
+
+    for (EShaderType Stage : GraphicsStages)
+    {
+        const void* NativeShader = nullptr;
+        for (const auto& Shader : Shaders)
+        {
+            if (Shader->GetType() == Stage)
+            {
+                NativeShader = Shader->GetNativeShader();
+                break;
+            }
+        }
+        StateCache.SetShader(Stage, NativeShader);
+    }
 }
 
 std::shared_ptr<KShader> KShaderProgram::GetShader(EShaderType Type) const
@@ -2,24 +2,45 @@
 
 #include "../Utils/Common.h"
 #include "../Utils/Logger.h"
+#include "GraphicsTypes.h"
+#include "VertexFormat.h"
+#include "../RHI/RHI.h"
 
 /**
- * @brief Shader type enumeration
+ * @brief Constant buffer slots shared by the built-in shaders
  */
-enum class EShaderType
+namespace ShaderConstantSlots
 {
-    Vertex,
-    Pixel,
-    Geometry,
-    Hull,
-    Domain,
-    Compute
+    constexpr UINT32 PerFrame = 0;
+    constexpr UINT32 PerObject = 1;
+    constexpr UINT32 SkinPalette = 2;
+}
+
+/**
+ * @brief Per-frame constants (cbuffer PerFrame : register(b0))
+ * 
+ * Matrices are declared row_major in HLSL, so they are uploaded untransposed.
+ */
+struct FPerFrameConstants
+{
+    XMFLOAT4X4 ViewMatrix;
+    XMFLOAT4X4 ProjectionMatrix;
+    XMFLOAT4X4 ViewProjectionMatrix;
+};
+
+/**
+ * @brief Per-object constants (cbuffer PerObject : register(b1))
+ */
+struct FPerObjectConstants
+{
+    XMFLOAT4X4 WorldMatrix;
 };
 
 /**
  * @brief Individual shader class
  * 
- * Manages individual shaders such as VS, PS, etc.
+ * Manages individual shaders such as VS, PS, etc. Source is compiled by the
+ * RHI device, which keeps the bytecode for input layout creation.
  */
 class KShader
 {
@@ -29,67 +50,58 @@ public:
 
     /**
      * @brief Load shader from file
-     * @param device DirectX 11 device
-     * @param filename Shader file path
-     * @param entryPoint Entry point function name
-     * @param type Shader type
+     * @param Device RHI device
+     * @param Filename Shader file path (#include resolves relative to it)
+     * @param EntryPoint Entry point function name
+     * @param Type Shader type
      * @return Success: S_OK
      */
-    HRESULT LoadFromFile(ID3D11Device* Device, const std::wstring& Filename, 
+    HRESULT LoadFromFile(IRHIDevice* Device, const std::wstring& Filename, 
                         const std::string& EntryPoint, EShaderType Type);
 
     /**
      * @brief Compile shader from string
-     * @param Device DirectX 11 device
+     * @param Device RHI device
      * @param Source Shader source code
      * @param EntryPoint Entry point function name
      * @param Type Shader type
      * @return Success: S_OK
      */
-    HRESULT CompileFromString(ID3D11Device* Device, const std::string& Source,
+    HRESULT CompileFromString(IRHIDevice* Device, const std::string& Source,
                              const std::string& EntryPoint, EShaderType Type);
 
     /**
      * @brief Bind shader
-     * @param Context DirectX 11 device context
+     * @param Context RHI command context
      */
-    void Bind(ID3D11DeviceContext* Context) const;
+    void Bind(IRHICommandContext& Context) const;
 
     /**
      * @brief Unbind shader
-     * @param Context DirectX 11 device context
+     * @param Context RHI command context
      */
-    void Unbind(ID3D11DeviceContext* Context) const;
+    void Unbind(IRHICommandContext& Context) const;
 
     // Getters
-    ID3D11VertexShader* GetVertexShader() const { return VertexShader.Get(); }
-    ID3D11PixelShader* GetPixelShader() const { return PixelShader.Get(); }
-    ID3D11GeometryShader* GetGeometryShader() const { return GeometryShader.Get(); }
-    ID3DBlob* GetBlob() const { return Blob.Get(); }
+    const std::vector<uint8>& GetBytecode() const { return Bytecode; }
     EShaderType GetType() const { return Type; }
 
-private:
     /**
-     * @brief Get profile string corresponding to shader type
+     * @brief Get the shader object of the shader type
      */
-    std::string GetProfileString(EShaderType InType) const;
+    FRHIResource GetNativeShader() const { return Shader.Get(); }
 
+private:
     /**
-     * @brief Create shader object from compiled bytecode blob
+     * @brief Compile source and create the shader object from the bytecode
      */
-    HRESULT CreateShaderFromBlob(ID3D11Device* Device);
+    HRESULT Compile(IRHIDevice* Device, const std::string& Source, const std::string& SourceName,
+                    const std::string& EntryPoint, EShaderType InType);
 
 private:
     EShaderType Type = EShaderType::Vertex;
-    ComPtr<ID3DBlob> Blob;
-
-    // Shader objects (only one is used depending on type)
-    ComPtr<ID3D11VertexShader> VertexShader;
-    ComPtr<ID3D11PixelShader> PixelShader;
-    ComPtr<ID3D11GeometryShader> GeometryShader;
-    ComPtr<ID3D11HullShader> HullShader;
-    ComPtr<ID3D11DomainShader> DomainShader;
-    ComPtr<ID3D11ComputeShader> ComputeShader;
+    std::vector<uint8> Bytecode;
+    FRHIResourceRef Shader;
 };
 
 /**
@@ -105,10 +117,31 @@ public:
 
     /**
      * @brief Create basic colored shader program
-     * @param Device DirectX 11 device
+     * @param Device RHI device
+     * @return Success: S_OK
+     */
+    HRESULT CreateBasicColorShader(IRHIDevice* Device);
+
+    /**
+     * @brief Create hardware-instanced variant of the basic color shader
+     * 
+     * Reads the world matrix per instance from vertex buffer slot
+     * VertexFormat::InstanceStreamSlot (four float4 rows, INSTANCE_WORLD0..3).
+     * @param Device RHI device
+     * @return Success: S_OK
+     */
+    HRESULT CreateBasicColorInstancedShader(IRHIDevice* Device);
+
+    /**
+     * @brief Create skinned variant of the basic color shader
+     * 
+     * Blends up to four joints per vertex from the palette in
+     * cbuffer SkinPalette : register(b2) (FSkinMatrix rows, see Animation.h).
+     * Only has an input layout for EVertexLayout::Skinned.
+     * @param Device RHI device
      * @return Success: S_OK
      */
-    HRESULT CreateBasicColorShader(ID3D11Device* Device);
+    HRESULT CreateSkinnedColorShader(IRHIDevice* Device);
 
     /**
      * @brief Add shader
@@ -118,32 +151,84 @@ public:
 
     /**
      * @brief Create input layout
-     * @param Device DirectX 11 device
+     * @param Device RHI device
      * @param InputElements Input element array
      * @param NumElements Number of input elements
      * @return Success: S_OK
      */
-    HRESULT CreateInputLayout(ID3D11Device* Device, 
-                             const D3D11_INPUT_ELEMENT_DESC* InputElements, 
+    HRESULT CreateInputLayout(IRHIDevice* Device, 
+                             const FRHIInputElement* InputElements, 
                              UINT32 NumElements);
 
+    /**
+     * @brief Create input layouts for the vertex layouts from their declarations
+     * 
+     * The Standard layout also becomes the default input layout.
+     * @param Device RHI device
+     * @param bPositionOnly Create the position-only layouts (for shaders that only read POSITION)
+     * @param InstanceElements Per-instance elements appended to every layout (optional)
+     * @param NumInstanceElements Number of per-instance elements
+     * @return Success: S_OK
+     */
+    HRESULT CreateVertexLayouts(IRHIDevice* Device, bool bPositionOnly = false,
+                               const FRHIInputElement* InstanceElements = nullptr,
+                               UINT32 NumInstanceElements = 0);
+
+    /**
+     * @brief Create input layouts for the given vertex layouts only
+     * 
+     * The first layout becomes the default input layout.
+     */
+    HRESULT CreateVertexLayouts(IRHIDevice* Device, const EVertexLayout* Layouts, UINT32 LayoutCount,
+                               const FRHIInputElement* InstanceElements = nullptr,
+                               UINT32 NumInstanceElements = 0);
+
     /**
      * @brief Bind shader program
-     * @param Context DirectX 11 device context
+     * @param Context RHI command context
      */
-    void Bind(ID3D11DeviceContext* Context) const;
+    void Bind(IRHICommandContext& Context) const;
 
     /**
      * @brief Unbind shader program
-     * @param Context DirectX 11 device context
+     * @param Context RHI command context
+     */
+    void Unbind(IRHICommandContext& Context) const;
+
+    /**
+     * @brief Bind shader program through a state cache
+     * 
+     * Graphics stages not used by this program are set to null, so no
+     * explicit unbind is needed between programs.
+     * @param StateCache Render state cache
+     * @param Layout Vertex layout of the mesh drawn next
+     */
+    void Bind(KRenderStateCache& StateCache, EVertexLayout Layout = EVertexLayout::Standard) const;
+
+    /**
+     * @brief Set the program used when draws with this program are instanced
+     * @param InInstancedVariant Instanced shader program
      */
-    void Unbind(ID3D11DeviceContext* Context) const;
+    void SetInstancedVariant(std::shared_ptr<KShaderProgram> InInstancedVariant) { InstancedVariant = InInstancedVariant; }
 
     // Getters
-    ID3D11InputLayout* GetInputLayout() const { return InputLayout.Get(); }
+    FRHIResource GetInputLayout() const { return InputLayout; }
+
+    /**
+     * @brief Input layout for a vertex layout (the default input layout if none was created)
+     */
+    FRHIResource GetInputLayout(EVertexLayout Layout) const;
     std::shared_ptr<KShader> GetShader(EShaderType Type) const;
+    KShaderProgram* GetInstancedVariant() const { return InstancedVariant.get(); }
 
 private:
     std::vector<std::shared_ptr<KShader>> Shaders;
-    ComPtr<ID3D11InputLayout> InputLayout;
+    FRHIResourceRef CustomInputLayout;
+    FRHIResourceRef VertexLayouts[VertexLayoutCount];
+
+    // Default input layout (one of the above)
+    FRHIResource InputLayout = nullptr;
+
+    // Instanced counterpart of this program (optional)
+    std::shared_ptr<KShaderProgram> InstancedVariant;
 };
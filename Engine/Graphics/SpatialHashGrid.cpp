@@ -0,0 +1,463 @@
+﻿#include "SpatialHashGrid.h"
+#include "../Core/Profiler.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+    constexpr uint32 EmptySlot = 0xFFFFFFFFu;
+    constexpr uint32 MinHashSlots = 64;
+
+    // Cell coordinates are clamped so far-away objects share border cells instead of overflowing
+    constexpr float MaxCoord = 1073741823.0f;
+
+    uint32 HashCoord(const int32 Coord[3])
+    {
+        uint64 Hash = static_cast<uint32>(Coord[0]) * 0x9E3779B97F4A7C15ull;
+        Hash ^= static_cast<uint32>(Coord[1]) * 0xC2B2AE3D27D4EB4Full;
+        Hash ^= static_cast<uint32>(Coord[2]) * 0x165667B19E3779F9ull;
+        return static_cast<uint32>(Hash ^ (Hash >> 29));
+    }
+
+    bool SameCoord(const int32 A[3], const int32 B[3])
+    {
+        return A[0] == B[0] && A[1] == B[1] && A[2] == B[2];
+    }
+}
+
+KSpatialHashGrid::KSpatialHashGrid()
+{
+    Initialize(FSpatialHashGridSettings());
+}
+
+KSpatialHashGrid::KSpatialHashGrid(const FSpatialHashGridSettings& InSettings)
+{
+    Initialize(InSettings);
+}
+
+void KSpatialHashGrid::Initialize(const FSpatialHashGridSettings& InSettings)
+{
+    Settings = InSettings;
+    Settings.CellSize = Settings.CellSize > 0.0f ? Settings.CellSize : 1.0f;
+    InvCellSize = 1.0f / Settings.CellSize;
+    Clear();
+}
+
+void KSpatialHashGrid::Clear()
+{
+    Store.Clear();
+    Cells.clear();
+    FreeCells.clear();
+    HashSlots.assign(MinHashSlots, EmptySlot);
+    HashMask = MinHashSlots - 1;
+    GlobalMaxExtent = 0.0f;
+}
+
+void KSpatialHashGrid::ComputeCoord(const float Center[3], int32 OutCoord[3]) const
+{
+    for (uint32 Axis = 0; Axis < 3; ++Axis)
+    {
+        const float Cell = std::floor(Center[Axis] * InvCellSize);
+        OutCoord[Axis] = static_cast<int32>(Cell > MaxCoord ? MaxCoord : (Cell < -MaxCoord ? -MaxCoord : Cell));
+    }
+}
+
+uint32 KSpatialHashGrid::FindCell(const int32 Coord[3]) const
+{
+    for (uint32 Slot = HashCoord(Coord) & HashMask; HashSlots[Slot] != EmptySlot; Slot = (Slot + 1) & HashMask)
+    {
+        if (SameCoord(Cells[HashSlots[Slot]].Coord, Coord))
+        {
+            return HashSlots[Slot];
+        }
+    }
+    return EmptySlot;
+}
+
+void KSpatialHashGrid::Rehash(uint32 SlotCount)
+{
+    HashSlots.assign(SlotCount, EmptySlot);
+    HashMask = SlotCount - 1;
+    for (uint32 Cell = 0; Cell < Cells.size(); ++Cell)
+    {
+        if (Store.GetBucketItemCount(Cell) == 0)
+        {
+            continue;
+        }
+        uint32 Slot = HashCoord(Cells[Cell].Coord) & HashMask;
+        while (HashSlots[Slot] != EmptySlot)
+        {
+            Slot = (Slot + 1) & HashMask;
+        }
+        HashSlots[Slot] = Cell;
+    }
+}
+
+uint32 KSpatialHashGrid::AcquireCell(const int32 Coord[3])
+{
+    const uint32 Existing = FindCell(Coord);
+    if (Existing != EmptySlot)
+    {
+        return Existing;
+    }
+
+    // Keep the table at most half full
+    if ((GetCellCount() + 1) * 2 > HashSlots.size())
+    {
+        Rehash(static_cast<uint32>(HashSlots.size()) * 2);
+    }
+
+    uint32 Cell;
+    if (!FreeCells.empty())
+    {
+        Cell = FreeCells.back();
+        FreeCells.pop_back();
+    }
+    else
+    {
+        Cell = static_cast<uint32>(Cells.size());
+        Cells.emplace_back();
+    }
+
+    FCell& Data = Cells[Cell];
+    for (uint32 Axis = 0; Axis < 3; ++Axis)
+    {
+        Data.Coord[Axis] = Coord[Axis];
+        Data.LooseMin[Axis] = float(Coord[Axis]) * Settings.CellSize;
+        Data.LooseMax[Axis] = float(Coord[Axis] + 1) * Settings.CellSize;
+    }
+    Data.MaxExtent = 0.0f;
+
+    uint32 Slot = HashCoord(Coord) & HashMask;
+    while (HashSlots[Slot] != EmptySlot)
+    {
+        Slot = (Slot + 1) & HashMask;
+    }
+    HashSlots[Slot] = Cell;
+    return Cell;
+}
+
+void KSpatialHashGrid::ReleaseCell(uint32 Cell)
+{
+    FCell& Data = Cells[Cell];
+
+    uint32 Hole = HashCoord(Data.Coord) & HashMask;
+    while (HashSlots[Hole] != Cell)
+    {
+        Hole = (Hole + 1) & HashMask;
+    }
+
+    // Backward-shift deletion: pull later entries of the probe run into the hole
+    HashSlots[Hole] = EmptySlot;
+    for (uint32 Slot = (Hole + 1) & HashMask; HashSlots[Slot] != EmptySlot; Slot = (Slot + 1) & HashMask)
+    {
+        const uint32 Home = HashCoord(Cells[HashSlots[Slot]].Coord) & HashMask;
+        const bool bMovable = Hole <= Slot ? (Home <= Hole || Home > Slot) : (Home <= Hole && Home > Slot);
+        if (bMovable)
+        {
+            HashSlots[Hole] = HashSlots[Slot];
+            HashSlots[Slot] = EmptySlot;
+            Hole = Slot;
+        }
+    }
+
+    for (uint32 Axis = 0; Axis < 3; ++Axis)
+    {
+        Data.LooseMin[Axis] = FLT_MAX;
+        Data.LooseMax[Axis] = -FLT_MAX;
+    }
+    FreeCells.push_back(Cell);
+}
+
+void KSpatialHashGrid::GrowCell(uint32 Cell, const FBoundingBox& Box)
+{
+    const float Extent = std::max(Box.Extents[0], std::max(Box.Extents[1], Box.Extents[2]));
+    FCell& Data = Cells[Cell];
+    if (Extent <= Data.MaxExtent)
+    {
+        return;
+    }
+
+    Data.MaxExtent = Extent;
+    GlobalMaxExtent = std::max(GlobalMaxExtent, Extent);
+    for (uint32 Axis = 0; Axis < 3; ++Axis)
+    {
+        Data.LooseMin[Axis] = float(Data.Coord[Axis]) * Settings.CellSize - Extent;
+        Data.LooseMax[Axis] = float(Data.Coord[Axis] + 1) * Settings.CellSize + Extent;
+    }
+}
+
+uint32 KSpatialHashGrid::Insert(const FBoundingBox& Box, uint32 UserData)
+{
+    int32 Coord[3];
+    ComputeCoord(Box.Center, Coord);
+    const uint32 Cell = AcquireCell(Coord);
+    GrowCell(Cell, Box);
+
+    float Min[3], Max[3];
+    SpatialQuery::ToMinMax(Box, Min, Max);
+    return Store.Insert(Cell, Min, Max, UserData);
+}
+
+void KSpatialHashGrid::Remove(uint32 Id)
+{
+    if (!Store.IsValid(Id))
+    {
+        return;
+    }
+
+    const uint32 Cell = Store.GetBucket(Id);
+    Store.Remove(Id);
+    if (Store.GetBucketItemCount(Cell) == 0)
+    {
+        ReleaseCell(Cell);
+    }
+}
+
+void KSpatialHashGrid::Move(uint32 Id, const FBoundingBox& Box)
+{
+    if (!Store.IsValid(Id))
+    {
+        return;
+    }
+
+    float Min[3], Max[3];
+    SpatialQuery::ToMinMax(Box, Min, Max);
+    Store.SetBox(Id, Min, Max);
+
+    int32 Coord[3];
+    ComputeCoord(Box.Center, Coord);
+    const uint32 Cell = Store.GetBucket(Id);
+    if (SameCoord(Cells[Cell].Coord, Coord))
+    {
+        GrowCell(Cell, Box);
+        return;
+    }
+
+    const uint32 NewCell = AcquireCell(Coord);
+    GrowCell(NewCell, Box);
+    Store.MoveToBucket(Id, NewCell);
+    if (Store.GetBucketItemCount(Cell) == 0)
+    {
+        ReleaseCell(Cell);
+    }
+}
+
+template<typename CellFunction>
+void KSpatialHashGrid::ForEachCellInRegion(const float RegionMin[3], const float RegionMax[3], CellFunction&& Function) const
+{
+    // Objects reach at most GlobalMaxExtent out of their cell
+    float Min[3], Max[3];
+    for (uint32 Axis = 0; Axis < 3; ++Axis)
+    {
+        Min[Axis] = RegionMin[Axis] - GlobalMaxExtent;
+        Max[Axis] = RegionMax[Axis] + GlobalMaxExtent;
+    }
+    int32 First[3], Last[3];
+    ComputeCoord(Min, First);
+    ComputeCoord(Max, Last);
+
+    const double RegionCells = double(Last[0] - First[0] + 1) * double(Last[1] - First[1] + 1) * double(Last[2] - First[2] + 1);
+    if (RegionCells > double(GetCellCount()))
+    {
+        // Cheaper to scan the occupied cells than to look up mostly empty ones
+        for (uint32 Cell = 0; Cell < Cells.size(); ++Cell)
+        {
+            Function(Cell);
+        }
+        return;
+    }
+
+    int32 Coord[3];
+    for (Coord[2] = First[2]; Coord[2] <= Last[2]; ++Coord[2])
+    {
+        for (Coord[1] = First[1]; Coord[1] <= Last[1]; ++Coord[1])
+        {
+            for (Coord[0] = First[0]; Coord[0] <= Last[0]; ++Coord[0])
+            {
+                const uint32 Cell = FindCell(Coord);
+                if (Cell != EmptySlot)
+                {
+                    Function(Cell);
+                }
+            }
+        }
+    }
+}
+
+template<typename CellTest, typename ItemTest>
+uint32 KSpatialHashGrid::Query(const float* RegionMin, const float* RegionMax, uint32 InitialState,
+                               CellTest&& TestCell, ItemTest&& TestItem, std::vector<uint32>& OutUserData) const
+{
+    const size_t FirstOutput = OutUserData.size();
+
+    // Free cells have inverted bounds and fail every cell test
+    auto VisitCell = [&](uint32 Cell)
+    {
+        uint32 State = InitialState;
+        if (!TestCell(Cells[Cell].LooseMin, Cells[Cell].LooseMax, State))
+        {
+            return;
+        }
+        Store.ForEachItem(Cell, [&](const FSpatialItem& Item)
+        {
+            if (State == 0 || TestItem(Item, State))
+            {
+                OutUserData.push_back(Item.UserData);
+            }
+        });
+    };
+
+    if (RegionMin)
+    {
+        ForEachCellInRegion(RegionMin, RegionMax, VisitCell);
+    }
+    else
+    {
+        for (uint32 Cell = 0; Cell < Cells.size(); ++Cell)
+        {
+            VisitCell(Cell);
+        }
+    }
+    return static_cast<uint32>(OutUserData.size() - FirstOutput);
+}
+
+uint32 KSpatialHashGrid::QueryFrustum(const FFrustum& Frustum, std::vector<uint32>& OutUserData) const
+{
+    KE_PROFILE_FUNCTION();
+
+    // Look up the cells around the frustum when they are fewer than the occupied ones
+    float RegionMin[3], RegionMax[3];
+    const bool bBounded = SpatialQuery::ComputeFrustumBounds(Frustum, RegionMin, RegionMax);
+
+    return Query(bBounded ? RegionMin : nullptr, RegionMax, SpatialQuery::AllPlanes,
+        [&](const float Min[3], const float Max[3], uint32& State)
+        {
+            return SpatialQuery::TestFrustum(Frustum, Min, Max, State);
+        },
+        [&](const FSpatialItem& Item, uint32 State)
+        {
+            return SpatialQuery::TestFrustum(Frustum, Item.Min, Item.Max, State);
+        },
+        OutUserData);
+}
+
+uint32 KSpatialHashGrid::QueryBox(const FBoundingBox& Box, std::vector<uint32>& OutUserData) const
+{
+    float QueryMin[3], QueryMax[3];
+    SpatialQuery::ToMinMax(Box, QueryMin, QueryMax);
+    return Query(QueryMin, QueryMax, 1,
+        [&](const float Min[3], const float Max[3], uint32& State)
+        {
+            if (!SpatialQuery::Overlaps(Min, Max, QueryMin, QueryMax))
+            {
+                return false;
+            }
+            State = SpatialQuery::Contains(QueryMin, QueryMax, Min, Max) ? 0 : 1;
+            return true;
+        },
+        [&](const FSpatialItem& Item, uint32)
+        {
+            return SpatialQuery::Overlaps(Item.Min, Item.Max, QueryMin, QueryMax);
+        },
+        OutUserData);
+}
+
+uint32 KSpatialHashGrid::QuerySphere(const FBoundingSphere& Sphere, std::vector<uint32>& OutUserData) const
+{
+    float QueryMin[3], QueryMax[3];
+    for (uint32 Axis = 0; Axis < 3; ++Axis)
+    {
+        QueryMin[Axis] = Sphere.Center[Axis] - Sphere.Radius;
+        QueryMax[Axis] = Sphere.Center[Axis] + Sphere.Radius;
+    }
+    return Query(QueryMin, QueryMax, 1,
+        [&](const float Min[3], const float Max[3], uint32& State)
+        {
+            if (!SpatialQuery::OverlapsSphere(Sphere, Min, Max))
+            {
+                return false;
+            }
+            State = SpatialQuery::ContainedInSphere(Sphere, Min, Max) ? 0 : 1;
+            return true;
+        },
+        [&](const FSpatialItem& Item, uint32)
+        {
+            return SpatialQuery::OverlapsSphere(Sphere, Item.Min, Item.Max);
+        },
+        OutUserData);
+}
+
+uint32 KSpatialHashGrid::QueryNearest(const float Point[3], uint32 Count, float MaxDistance,
+                                      std::vector<FSpatialNeighbor>& OutNeighbors) const
+{
+    KNearestCollector Collector(Point, Count, MaxDistance);
+    const uint32 CellCount = GetCellCount();
+    if (CellCount == 0 || Count == 0)
+    {
+        return 0;
+    }
+
+    auto VisitCell = [&](uint32 Cell)
+    {
+        if (SpatialQuery::DistanceSquared(Point, Cells[Cell].LooseMin, Cells[Cell].LooseMax) <= Collector.GetLimitSquared())
+        {
+            Store.ForEachItem(Cell, [&](const FSpatialItem& Item) { Collector.Offer(Item); });
+        }
+    };
+
+    // Rings of cells around the point's cell (Chebyshev distance Ring), until no closer object can remain
+    int32 Center[3];
+    ComputeCoord(Point, Center);
+    for (int32 Ring = 0; ; ++Ring)
+    {
+        // Centers in this ring are at least Ring - 1 cells away, their boxes reach GlobalMaxExtent closer
+        const float Bound = std::max(0.0f, float(Ring - 1) * Settings.CellSize - GlobalMaxExtent);
+        if (Bound * Bound > Collector.GetLimitSquared())
+        {
+            break;
+        }
+
+        const uint64 Side = uint64(2 * Ring + 1);
+        if (Side * Side * Side > uint64(CellCount) * 2)
+        {
+            // The rings would visit more empty coordinates than there are cells: scan the rest
+            for (uint32 Cell = 0; Cell < Cells.size(); ++Cell)
+            {
+                const FCell& Data = Cells[Cell];
+                const int32 Distance = std::max(std::abs(Data.Coord[0] - Center[0]),
+                                       std::max(std::abs(Data.Coord[1] - Center[1]), std::abs(Data.Coord[2] - Center[2])));
+                if (Distance >= Ring && Store.GetBucketItemCount(Cell) > 0)
+                {
+                    VisitCell(Cell);
+                }
+            }
+            break;
+        }
+
+        int32 Coord[3];
+        for (int32 DZ = -Ring; DZ <= Ring; ++DZ)
+        {
+            for (int32 DY = -Ring; DY <= Ring; ++DY)
+            {
+                // Inner rows only contribute their two end cells
+                const bool bFullRow = Ring == 0 || DZ == -Ring || DZ == Ring || DY == -Ring || DY == Ring;
+                const int32 Step = bFullRow ? 1 : 2 * Ring;
+                for (int32 DX = -Ring; DX <= Ring; DX += Step)
+                {
+                    Coord[0] = Center[0] + DX;
+                    Coord[1] = Center[1] + DY;
+                    Coord[2] = Center[2] + DZ;
+                    const uint32 Cell = FindCell(Coord);
+                    if (Cell != EmptySlot)
+                    {
+                        VisitCell(Cell);
+                    }
+                }
+            }
+        }
+    }
+    return Collector.Finish(OutNeighbors);
+}
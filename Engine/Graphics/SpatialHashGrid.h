@@ -0,0 +1,96 @@
+﻿#pragma once
+
+#include "SpatialIndex.h"
+
+/**
+ * @brief Cell size of a spatial hash grid
+ */
+struct FSpatialHashGridSettings
+{
+    float CellSize = 128.0f;    // Best when cells hold a few to a few tens of objects
+};
+
+/**
+ * @brief Hashed uniform grid spatial index (unbounded, sparse)
+ *
+ * An object belongs to the cell its center falls in; each cell's bounds
+ * grow by the largest object it held, so objects are never split across
+ * cells. Occupied cells are a flat array found through an open-addressing
+ * hash of their coordinates; a move updates the box in place or relinks
+ * the object to another cell, O(1) either way. Queries look up the cells
+ * covering the query's bounds when they are fewer than the occupied cells,
+ * and scan the occupied cells otherwise. Platform independent.
+ */
+class KSpatialHashGrid : public ISpatialIndex
+{
+public:
+    KSpatialHashGrid();
+    explicit KSpatialHashGrid(const FSpatialHashGridSettings& InSettings);
+
+    /**
+     * @brief Change the cell size (removes every object)
+     */
+    void Initialize(const FSpatialHashGridSettings& InSettings);
+    const FSpatialHashGridSettings& GetSettings() const { return Settings; }
+
+    uint32 Insert(const FBoundingBox& Box, uint32 UserData) override;
+    void Remove(uint32 Id) override;
+    void Move(uint32 Id, const FBoundingBox& Box) override;
+    void Clear() override;
+    void Update(KJobSystem*) override {}
+
+    uint32 QueryFrustum(const FFrustum& Frustum, std::vector<uint32>& OutUserData) const override;
+    uint32 QueryBox(const FBoundingBox& Box, std::vector<uint32>& OutUserData) const override;
+    uint32 QuerySphere(const FBoundingSphere& Sphere, std::vector<uint32>& OutUserData) const override;
+    uint32 QueryNearest(const float Point[3], uint32 Count, float MaxDistance,
+                        std::vector<FSpatialNeighbor>& OutNeighbors) const override;
+
+    uint32 GetObjectCount() const override { return Store.GetObjectCount(); }
+    bool IsValid(uint32 Id) const override { return Store.IsValid(Id); }
+    uint32 GetUserData(uint32 Id) const override { return Store.GetItem(Id).UserData; }
+
+    uint32 GetCellCount() const { return static_cast<uint32>(Cells.size() - FreeCells.size()); }
+
+private:
+    struct FCell
+    {
+        float LooseMin[3];          // Empty (inverted) while the cell is free
+        float MaxExtent;            // Largest object half-extent since the cell was occupied
+        float LooseMax[3];
+        int32 Coord[3];
+    };
+
+    void ComputeCoord(const float Center[3], int32 OutCoord[3]) const;
+    uint32 FindCell(const int32 Coord[3]) const;
+    uint32 AcquireCell(const int32 Coord[3]);
+    void ReleaseCell(uint32 Cell);
+    void GrowCell(uint32 Cell, const FBoundingBox& Box);
+    void Rehash(uint32 SlotCount);
+
+    /**
+     * @brief Traversal shared by the overlap queries (same tests as the loose octree's)
+     *
+     * Visits the cells whose objects may overlap [RegionMin, RegionMax], or
+     * every cell if RegionMin is nullptr. TestCell(Min, Max, State) rejects a
+     * cell or narrows State, 0 meaning fully inside (its objects are then
+     * taken without tests); TestItem(Item, State) tests one object.
+     */
+    template<typename CellTest, typename ItemTest>
+    uint32 Query(const float* RegionMin, const float* RegionMax, uint32 InitialState,
+                 CellTest&& TestCell, ItemTest&& TestItem, std::vector<uint32>& OutUserData) const;
+
+    template<typename CellFunction>
+    void ForEachCellInRegion(const float RegionMin[3], const float RegionMax[3], CellFunction&& Function) const;
+
+private:
+    FSpatialHashGridSettings Settings;
+    float InvCellSize = 1.0f;
+    float GlobalMaxExtent = 0.0f;   // Largest object half-extent since the last Clear
+
+    std::vector<FCell> Cells;
+    std::vector<uint32> FreeCells;
+    std::vector<uint32> HashSlots;  // Cell index per slot, linear probing
+    uint32 HashMask = 0;
+
+    KSpatialItemStore Store;
+};
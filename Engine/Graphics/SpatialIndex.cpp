@@ -0,0 +1,185 @@
+﻿#include "SpatialIndex.h"
+
+#include <algorithm>
+#include <cfloat>
+
+namespace
+{
+    bool IsCloser(const FSpatialNeighbor& A, const FSpatialNeighbor& B)
+    {
+        return A.DistanceSquared < B.DistanceSquared;
+    }
+}
+
+KNearestCollector::KNearestCollector(const float InPoint[3], uint32 InCount, float MaxDistance)
+    : Count(InCount)
+{
+    Point[0] = InPoint[0];
+    Point[1] = InPoint[1];
+    Point[2] = InPoint[2];
+    LimitSquared = MaxDistance < 1.8e19f ? MaxDistance * MaxDistance : FLT_MAX;
+    Heap.reserve(Count);
+}
+
+void KNearestCollector::Offer(const FSpatialItem& Item)
+{
+    const float DistanceSquared = SpatialQuery::DistanceSquared(Point, Item.Min, Item.Max);
+    if (Count == 0 || DistanceSquared > LimitSquared)
+    {
+        return;
+    }
+
+    FSpatialNeighbor Neighbor;
+    Neighbor.UserData = Item.UserData;
+    Neighbor.DistanceSquared = DistanceSquared;
+
+    if (Heap.size() == Count)
+    {
+        std::pop_heap(Heap.begin(), Heap.end(), IsCloser);
+        Heap.back() = Neighbor;
+    }
+    else
+    {
+        Heap.push_back(Neighbor);
+    }
+    std::push_heap(Heap.begin(), Heap.end(), IsCloser);
+
+    // Once full, only items closer than the farthest kept one matter
+    if (Heap.size() == Count)
+    {
+        LimitSquared = Heap.front().DistanceSquared;
+    }
+}
+
+uint32 KNearestCollector::Finish(std::vector<FSpatialNeighbor>& OutNeighbors)
+{
+    std::sort_heap(Heap.begin(), Heap.end(), IsCloser);
+    OutNeighbors.insert(OutNeighbors.end(), Heap.begin(), Heap.end());
+    const uint32 Appended = static_cast<uint32>(Heap.size());
+    Heap.clear();
+    return Appended;
+}
+
+uint32 KSpatialItemStore::Insert(uint32 Bucket, const float Min[3], const float Max[3], uint32 UserData)
+{
+    uint32 Id;
+    if (!FreeIds.empty())
+    {
+        Id = FreeIds.back();
+        FreeIds.pop_back();
+    }
+    else
+    {
+        Id = static_cast<uint32>(Locations.size());
+        Locations.emplace_back();
+    }
+
+    FSpatialItem Item;
+    for (uint32 Axis = 0; Axis < 3; ++Axis)
+    {
+        Item.Min[Axis] = Min[Axis];
+        Item.Max[Axis] = Max[Axis];
+    }
+    Item.Id = Id;
+    Item.UserData = UserData;
+    Attach(Id, Bucket, Item);
+    return Id;
+}
+
+void KSpatialItemStore::Remove(uint32 Id)
+{
+    Detach(Id);
+    Locations[Id].Bucket = InvalidId;
+    FreeIds.push_back(Id);
+}
+
+void KSpatialItemStore::SetBox(uint32 Id, const float Min[3], const float Max[3])
+{
+    const FLocation& Location = Locations[Id];
+    FSpatialItem& Item = Chunks[Location.Chunk].Items[Location.Slot];
+    for (uint32 Axis = 0; Axis < 3; ++Axis)
+    {
+        Item.Min[Axis] = Min[Axis];
+        Item.Max[Axis] = Max[Axis];
+    }
+}
+
+void KSpatialItemStore::MoveToBucket(uint32 Id, uint32 Bucket)
+{
+    if (Locations[Id].Bucket == Bucket)
+    {
+        return;
+    }
+    const FSpatialItem Item = GetItem(Id);
+    Detach(Id);
+    Attach(Id, Bucket, Item);
+}
+
+void KSpatialItemStore::Clear()
+{
+    Locations.clear();
+    FreeIds.clear();
+    Chunks.clear();
+    FreeChunks.clear();
+    Buckets.clear();
+}
+
+void KSpatialItemStore::Attach(uint32 Id, uint32 Bucket, const FSpatialItem& Item)
+{
+    if (Bucket >= Buckets.size())
+    {
+        Buckets.resize(Bucket + 1);
+    }
+
+    FBucket& Target = Buckets[Bucket];
+    if (Target.Head == InvalidId || Chunks[Target.Head].Count == ChunkCapacity)
+    {
+        uint32 Chunk;
+        if (!FreeChunks.empty())
+        {
+            Chunk = FreeChunks.back();
+            FreeChunks.pop_back();
+        }
+        else
+        {
+            Chunk = static_cast<uint32>(Chunks.size());
+            Chunks.emplace_back();
+        }
+        Chunks[Chunk].Count = 0;
+        Chunks[Chunk].Next = Target.Head;
+        Target.Head = Chunk;
+    }
+
+    FChunk& Head = Chunks[Target.Head];
+    const uint32 Slot = Head.Count++;
+    Head.Items[Slot] = Item;
+    ++Target.Count;
+
+    FLocation& Location = Locations[Id];
+    Location.Bucket = Bucket;
+    Location.Chunk = Target.Head;
+    Location.Slot = Slot;
+}
+
+void KSpatialItemStore::Detach(uint32 Id)
+{
+    const FLocation Location = Locations[Id];
+    FBucket& Source = Buckets[Location.Bucket];
+    FChunk& Head = Chunks[Source.Head];
+
+    // Fill the hole with the head chunk's last item
+    const FSpatialItem& Last = Head.Items[Head.Count - 1];
+    if (Last.Id != Id)
+    {
+        Chunks[Location.Chunk].Items[Location.Slot] = Last;
+        Locations[Last.Id].Chunk = Location.Chunk;
+        Locations[Last.Id].Slot = Location.Slot;
+    }
+
+    --Source.Count;
+    if (--Head.Count == 0)
+    {
+        FreeChunks.push_back(Source.Head);
+        Source.Head = Head.Next;
+    }
+}
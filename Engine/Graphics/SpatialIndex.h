@@ -0,0 +1,347 @@
+﻿#pragma once
+
+#include "../Utils/Types.h"
+#include "../Utils/Bounds.h"
+#include <vector>
+
+class KJobSystem;
+
+/**
+ * @brief Object box as stored by the spatial indexes
+ */
+struct FSpatialItem
+{
+    float Min[3];
+    uint32 Id;          // Object id (InvalidId once removed, where kept in place)
+    float Max[3];
+    uint32 UserData;
+};
+
+/**
+ * @brief Result of a nearest-object query
+ */
+struct FSpatialNeighbor
+{
+    uint32 UserData = 0;
+    float DistanceSquared = 0.0f;   // From the query point to the object box (0 inside)
+};
+
+/**
+ * @brief Spatial index over scene object boxes
+ *
+ * Objects are added with a box and a UserData value the queries report
+ * (typically an index into the caller's object array). Queries append to
+ * the output and return the number appended; they are const and may run
+ * concurrently with each other, but not with Insert / Remove / Move / Update.
+ */
+class ISpatialIndex
+{
+public:
+    static constexpr uint32 InvalidId = 0xFFFFFFFFu;
+
+    virtual ~ISpatialIndex() = default;
+
+    /**
+     * @brief Add an object
+     * @return Object id (stable until Remove, then reused)
+     */
+    virtual uint32 Insert(const FBoundingBox& Box, uint32 UserData) = 0;
+    virtual void Remove(uint32 Id) = 0;
+    virtual void Move(uint32 Id, const FBoundingBox& Box) = 0;
+    virtual void Clear() = 0;
+
+    /**
+     * @brief Apply pending changes before the frame's queries (may be a no-op)
+     * @param JobSystem Worker pool, nullptr for the calling thread
+     */
+    virtual void Update(KJobSystem* JobSystem) = 0;
+
+    /**
+     * @brief Objects whose box intersects the frustum (conservative)
+     */
+    virtual uint32 QueryFrustum(const FFrustum& Frustum, std::vector<uint32>& OutUserData) const = 0;
+
+    /**
+     * @brief Objects whose box overlaps Box
+     */
+    virtual uint32 QueryBox(const FBoundingBox& Box, std::vector<uint32>& OutUserData) const = 0;
+
+    /**
+     * @brief Objects whose box overlaps the sphere
+     */
+    virtual uint32 QuerySphere(const FBoundingSphere& Sphere, std::vector<uint32>& OutUserData) const = 0;
+
+    /**
+     * @brief Up to Count objects closest to Point within MaxDistance, nearest first
+     */
+    virtual uint32 QueryNearest(const float Point[3], uint32 Count, float MaxDistance,
+                                std::vector<FSpatialNeighbor>& OutNeighbors) const = 0;
+
+    virtual uint32 GetObjectCount() const = 0;
+    virtual bool IsValid(uint32 Id) const = 0;
+    virtual uint32 GetUserData(uint32 Id) const = 0;
+};
+
+/**
+ * @brief Box tests shared by the spatial indexes (boxes as min/max corners)
+ */
+namespace SpatialQuery
+{
+    constexpr uint32 AllPlanes = (1u << FFrustum::PlaneCount) - 1;
+
+    inline void ToMinMax(const FBoundingBox& Box, float OutMin[3], float OutMax[3])
+    {
+        for (uint32 Axis = 0; Axis < 3; ++Axis)
+        {
+            OutMin[Axis] = Box.Center[Axis] - Box.Extents[Axis];
+            OutMax[Axis] = Box.Center[Axis] + Box.Extents[Axis];
+        }
+    }
+
+    /**
+     * @brief Frustum test against the planes in PlaneMask
+     * @return False if outside; clears the bits of planes the box is fully inside of
+     */
+    inline bool TestFrustum(const FFrustum& Frustum, const float Min[3], const float Max[3], uint32& PlaneMask)
+    {
+        for (uint32 PlaneIndex = 0; PlaneIndex < FFrustum::PlaneCount; ++PlaneIndex)
+        {
+            if (!(PlaneMask & (1u << PlaneIndex)))
+            {
+                continue;
+            }
+
+            const FPlane& Plane = Frustum.Planes[PlaneIndex];
+            float Far = Plane.Distance;
+            float Near = Plane.Distance;
+            for (uint32 Axis = 0; Axis < 3; ++Axis)
+            {
+                const float Normal = Plane.Normal[Axis];
+                Far += Normal * (Normal >= 0.0f ? Max[Axis] : Min[Axis]);
+                Near += Normal * (Normal >= 0.0f ? Min[Axis] : Max[Axis]);
+            }
+            if (Far < 0.0f)
+            {
+                return false;
+            }
+            if (Near >= 0.0f)
+            {
+                PlaneMask &= ~(1u << PlaneIndex);
+            }
+        }
+        return true;
+    }
+
+    inline bool Overlaps(const float MinA[3], const float MaxA[3], const float MinB[3], const float MaxB[3])
+    {
+        return MinA[0] <= MaxB[0] && MaxA[0] >= MinB[0] &&
+               MinA[1] <= MaxB[1] && MaxA[1] >= MinB[1] &&
+               MinA[2] <= MaxB[2] && MaxA[2] >= MinB[2];
+    }
+
+    inline bool Contains(const float OuterMin[3], const float OuterMax[3], const float Min[3], const float Max[3])
+    {
+        return Min[0] >= OuterMin[0] && Max[0] <= OuterMax[0] &&
+               Min[1] >= OuterMin[1] && Max[1] <= OuterMax[1] &&
+               Min[2] >= OuterMin[2] && Max[2] <= OuterMax[2];
+    }
+
+    /**
+     * @brief Squared distance from a point to a box (0 inside)
+     */
+    inline float DistanceSquared(const float Point[3], const float Min[3], const float Max[3])
+    {
+        float Result = 0.0f;
+        for (uint32 Axis = 0; Axis < 3; ++Axis)
+        {
+            const float Delta = Point[Axis] < Min[Axis] ? Min[Axis] - Point[Axis] :
+                                Point[Axis] > Max[Axis] ? Point[Axis] - Max[Axis] : 0.0f;
+            Result += Delta * Delta;
+        }
+        return Result;
+    }
+
+    /**
+     * @brief Squared distance from a point to the farthest corner of a box
+     */
+    inline float FarthestDistanceSquared(const float Point[3], const float Min[3], const float Max[3])
+    {
+        float Result = 0.0f;
+        for (uint32 Axis = 0; Axis < 3; ++Axis)
+        {
+            const float ToMin = Point[Axis] - Min[Axis];
+            const float ToMax = Max[Axis] - Point[Axis];
+            const float Delta = ToMin > ToMax ? ToMin : ToMax;
+            Result += Delta * Delta;
+        }
+        return Result;
+    }
+
+    /**
+     * @brief Box around the frustum's corners (intersections of side, top/bottom and near/far planes)
+     * @return False if planes are parallel (no finite corners)
+     */
+    inline bool ComputeFrustumBounds(const FFrustum& Frustum, float OutMin[3], float OutMax[3])
+    {
+        for (uint32 Axis = 0; Axis < 3; ++Axis)
+        {
+            OutMin[Axis] = 3.402823466e+38f;
+            OutMax[Axis] = -3.402823466e+38f;
+        }
+
+        for (uint32 Corner = 0; Corner < 8; ++Corner)
+        {
+            const FPlane& A = Frustum.Planes[0 + (Corner & 1)];
+            const FPlane& B = Frustum.Planes[2 + ((Corner >> 1) & 1)];
+            const FPlane& C = Frustum.Planes[4 + ((Corner >> 2) & 1)];
+
+            const float BC[3] = { B.Normal[1] * C.Normal[2] - B.Normal[2] * C.Normal[1],
+                                  B.Normal[2] * C.Normal[0] - B.Normal[0] * C.Normal[2],
+                                  B.Normal[0] * C.Normal[1] - B.Normal[1] * C.Normal[0] };
+            const float CA[3] = { C.Normal[1] * A.Normal[2] - C.Normal[2] * A.Normal[1],
+                                  C.Normal[2] * A.Normal[0] - C.Normal[0] * A.Normal[2],
+                                  C.Normal[0] * A.Normal[1] - C.Normal[1] * A.Normal[0] };
+            const float AB[3] = { A.Normal[1] * B.Normal[2] - A.Normal[2] * B.Normal[1],
+                                  A.Normal[2] * B.Normal[0] - A.Normal[0] * B.Normal[2],
+                                  A.Normal[0] * B.Normal[1] - A.Normal[1] * B.Normal[0] };
+            const float Determinant = A.Normal[0] * BC[0] + A.Normal[1] * BC[1] + A.Normal[2] * BC[2];
+            if (Determinant > -1e-12f && Determinant < 1e-12f)
+            {
+                return false;
+            }
+
+            for (uint32 Axis = 0; Axis < 3; ++Axis)
+            {
+                const float Point = -(A.Distance * BC[Axis] + B.Distance * CA[Axis] + C.Distance * AB[Axis]) / Determinant;
+                OutMin[Axis] = Point < OutMin[Axis] ? Point : OutMin[Axis];
+                OutMax[Axis] = Point > OutMax[Axis] ? Point : OutMax[Axis];
+            }
+        }
+        return true;
+    }
+
+    inline bool OverlapsSphere(const FBoundingSphere& Sphere, const float Min[3], const float Max[3])
+    {
+        return DistanceSquared(Sphere.Center, Min, Max) <= Sphere.Radius * Sphere.Radius;
+    }
+
+    inline bool ContainedInSphere(const FBoundingSphere& Sphere, const float Min[3], const float Max[3])
+    {
+        return FarthestDistanceSquared(Sphere.Center, Min, Max) <= Sphere.Radius * Sphere.Radius;
+    }
+}
+
+/**
+ * @brief Keeps the Count closest items offered to it
+ */
+class KNearestCollector
+{
+public:
+    KNearestCollector(const float InPoint[3], uint32 InCount, float MaxDistance);
+
+    /**
+     * @brief Squared distance an item or node must not exceed to still matter
+     */
+    float GetLimitSquared() const { return LimitSquared; }
+
+    const float* GetPoint() const { return Point; }
+
+    void Offer(const FSpatialItem& Item);
+
+    /**
+     * @brief Append the kept items, nearest first
+     * @return Number appended
+     */
+    uint32 Finish(std::vector<FSpatialNeighbor>& OutNeighbors);
+
+private:
+    float Point[3];
+    uint32 Count;
+    float LimitSquared;
+
+    // Max-heap on distance while collecting
+    std::vector<FSpatialNeighbor> Heap;
+};
+
+/**
+ * @brief Object storage of the bucketed spatial indexes (loose octree, hash grid)
+ *
+ * Each bucket (octree node, grid cell) owns a list of fixed-size chunks of
+ * items; only the head chunk is partially filled. Removing an item moves the
+ * head chunk's last item into its place, so inserts, removes and moves
+ * between buckets are O(1), and a bucket's items are read a chunk at a time.
+ */
+class KSpatialItemStore
+{
+public:
+    static constexpr uint32 InvalidId = ISpatialIndex::InvalidId;
+    static constexpr uint32 ChunkCapacity = 8;
+
+    struct FChunk
+    {
+        FSpatialItem Items[ChunkCapacity];
+        uint32 Count = 0;
+        uint32 Next = InvalidId;
+    };
+
+    /**
+     * @brief Add an object to a bucket
+     * @return Object id
+     */
+    uint32 Insert(uint32 Bucket, const float Min[3], const float Max[3], uint32 UserData);
+    void Remove(uint32 Id);
+    void SetBox(uint32 Id, const float Min[3], const float Max[3]);
+    void MoveToBucket(uint32 Id, uint32 Bucket);
+    void Clear();
+
+    uint32 GetBucket(uint32 Id) const { return Locations[Id].Bucket; }
+    uint32 GetBucketItemCount(uint32 Bucket) const { return Bucket < Buckets.size() ? Buckets[Bucket].Count : 0; }
+    const FSpatialItem& GetItem(uint32 Id) const { return Chunks[Locations[Id].Chunk].Items[Locations[Id].Slot]; }
+
+    uint32 GetObjectCount() const { return static_cast<uint32>(Locations.size() - FreeIds.size()); }
+    bool IsValid(uint32 Id) const { return Id < Locations.size() && Locations[Id].Bucket != InvalidId; }
+
+    /**
+     * @brief Call Function(const FSpatialItem&) for every item of a bucket
+     */
+    template<typename FunctionType>
+    void ForEachItem(uint32 Bucket, FunctionType&& Function) const
+    {
+        if (Bucket >= Buckets.size())
+        {
+            return;
+        }
+        for (uint32 Chunk = Buckets[Bucket].Head; Chunk != InvalidId; Chunk = Chunks[Chunk].Next)
+        {
+            const FChunk& Data = Chunks[Chunk];
+            for (uint32 Slot = 0; Slot < Data.Count; ++Slot)
+            {
+                Function(Data.Items[Slot]);
+            }
+        }
+    }
+
+private:
+    struct FLocation
+    {
+        uint32 Bucket = InvalidId;  // InvalidId while the id is free
+        uint32 Chunk = 0;
+        uint32 Slot = 0;
+    };
+
+    struct FBucket
+    {
+        uint32 Head = InvalidId;
+        uint32 Count = 0;
+    };
+
+    void Attach(uint32 Id, uint32 Bucket, const FSpatialItem& Item);
+    void Detach(uint32 Id);
+
+private:
+    std::vector<FLocation> Locations;
+    std::vector<uint32> FreeIds;
+    std::vector<FChunk> Chunks;
+    std::vector<uint32> FreeChunks;
+    std::vector<FBucket> Buckets;
+};
@@ -0,0 +1,393 @@
+﻿#include "TLSFAllocator.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+    // Index of the lowest / highest set bit (Value must be non-zero)
+    inline uint32 FindLowestBit(uint32 Value)
+    {
+#ifdef _MSC_VER
+        unsigned long Index;
+        _BitScanForward(&Index, Value);
+        return static_cast<uint32>(Index);
+#else
+        return static_cast<uint32>(__builtin_ctz(Value));
+#endif
+    }
+
+    inline uint32 FindHighestBit(uint32 Value)
+    {
+#ifdef _MSC_VER
+        unsigned long Index;
+        _BitScanReverse(&Index, Value);
+        return static_cast<uint32>(Index);
+#else
+        return static_cast<uint32>(31 - __builtin_clz(Value));
+#endif
+    }
+}
+
+void KTLSFAllocator::Initialize(uint32 InCapacity)
+{
+    Capacity = InCapacity;
+    Reset();
+}
+
+void KTLSFAllocator::Reset()
+{
+    Blocks.clear();
+    UnusedBlocks.clear();
+    UsedSize = 0;
+    AllocationCount = 0;
+    FreeBlockCount = 0;
+    FirstBlock = InvalidHandle;
+
+    FirstLevelBitmap = 0;
+    for (uint32 FirstLevel = 0; FirstLevel < FirstLevelCount; ++FirstLevel)
+    {
+        SecondLevelBitmaps[FirstLevel] = 0;
+        for (uint32 SecondLevel = 0; SecondLevel < SecondLevelCount; ++SecondLevel)
+        {
+            FreeHeads[FirstLevel][SecondLevel] = InvalidHandle;
+        }
+    }
+
+    if (Capacity > 0)
+    {
+        FirstBlock = CreateBlock();
+        Blocks[FirstBlock].Size = Capacity;
+        InsertFreeBlock(FirstBlock);
+    }
+}
+
+uint32 KTLSFAllocator::Allocate(uint32 Size)
+{
+    if (Size == 0 || Size > GetFreeSize())
+    {
+        return InvalidHandle;
+    }
+
+    const uint32 Block = FindFreeBlock(Size);
+    if (Block == InvalidHandle)
+    {
+        return InvalidHandle;
+    }
+
+    RemoveFreeBlock(Block);
+
+    // Return the tail to the free lists
+    if (Blocks[Block].Size > Size)
+    {
+        const uint32 Remainder = CreateBlock();
+        FBlock& Allocated = Blocks[Block];
+        FBlock& Tail = Blocks[Remainder];
+        Tail.Offset = Allocated.Offset + Size;
+        Tail.Size = Allocated.Size - Size;
+        Tail.PrevPhysical = Block;
+        Tail.NextPhysical = Allocated.NextPhysical;
+        if (Tail.NextPhysical != InvalidHandle)
+        {
+            Blocks[Tail.NextPhysical].PrevPhysical = Remainder;
+        }
+        Allocated.NextPhysical = Remainder;
+        Allocated.Size = Size;
+        InsertFreeBlock(Remainder);
+    }
+
+    UsedSize += Size;
+    ++AllocationCount;
+    return Block;
+}
+
+void KTLSFAllocator::Free(uint32 Handle)
+{
+    if (Handle >= Blocks.size() || Blocks[Handle].bFree)
+    {
+        return;
+    }
+
+    UsedSize -= Blocks[Handle].Size;
+    --AllocationCount;
+
+    // Merge with the following range
+    uint32 Block = Handle;
+    const uint32 Next = Blocks[Block].NextPhysical;
+    if (Next != InvalidHandle && Blocks[Next].bFree)
+    {
+        RemoveFreeBlock(Next);
+        Blocks[Block].Size += Blocks[Next].Size;
+        Blocks[Block].NextPhysical = Blocks[Next].NextPhysical;
+        if (Blocks[Block].NextPhysical != InvalidHandle)
+        {
+            Blocks[Blocks[Block].NextPhysical].PrevPhysical = Block;
+        }
+        ReleaseBlock(Next);
+    }
+
+    // Merge into the preceding range (the lowest block is never released)
+    const uint32 Prev = Blocks[Block].PrevPhysical;
+    if (Prev != InvalidHandle && Blocks[Prev].bFree)
+    {
+        RemoveFreeBlock(Prev);
+        Blocks[Prev].Size += Blocks[Block].Size;
+        Blocks[Prev].NextPhysical = Blocks[Block].NextPhysical;
+        if (Blocks[Prev].NextPhysical != InvalidHandle)
+        {
+            Blocks[Blocks[Prev].NextPhysical].PrevPhysical = Prev;
+        }
+        ReleaseBlock(Block);
+        Block = Prev;
+    }
+
+    InsertFreeBlock(Block);
+}
+
+void KTLSFAllocator::Defragment(std::vector<FRelocation>& OutRelocations)
+{
+    OutRelocations.clear();
+    if (FreeBlockCount == 0)
+    {
+        return;
+    }
+
+    // Already compact: the only free block is the last one
+    if (FreeBlockCount == 1)
+    {
+        const uint32 FirstLevel = FindLowestBit(FirstLevelBitmap);
+        const uint32 FreeBlock = FreeHeads[FirstLevel][FindLowestBit(SecondLevelBitmaps[FirstLevel])];
+        if (Blocks[FreeBlock].NextPhysical == InvalidHandle)
+        {
+            return;
+        }
+    }
+
+    // Slide allocations down in address order, dropping the free blocks between them
+    uint32 Cursor = 0;
+    uint32 LastAllocated = InvalidHandle;
+    uint32 Block = FirstBlock;
+    FirstBlock = InvalidHandle;
+    while (Block != InvalidHandle)
+    {
+        const uint32 Next = Blocks[Block].NextPhysical;
+        FBlock& Current = Blocks[Block];
+        if (Current.bFree)
+        {
+            ReleaseBlock(Block);
+        }
+        else
+        {
+            if (Current.Offset != Cursor)
+            {
+                OutRelocations.push_back({ Block, Current.Offset, Cursor, Current.Size });
+                Current.Offset = Cursor;
+            }
+            Cursor += Current.Size;
+
+            Current.PrevPhysical = LastAllocated;
+            Current.NextPhysical = InvalidHandle;
+            if (LastAllocated != InvalidHandle)
+            {
+                Blocks[LastAllocated].NextPhysical = Block;
+            }
+            else
+            {
+                FirstBlock = Block;
+            }
+            LastAllocated = Block;
+        }
+        Block = Next;
+    }
+
+    // Rebuild the free lists: one range after the last allocation
+    FreeBlockCount = 0;
+    FirstLevelBitmap = 0;
+    for (uint32 FirstLevel = 0; FirstLevel < FirstLevelCount; ++FirstLevel)
+    {
+        SecondLevelBitmaps[FirstLevel] = 0;
+        for (uint32 SecondLevel = 0; SecondLevel < SecondLevelCount; ++SecondLevel)
+        {
+            FreeHeads[FirstLevel][SecondLevel] = InvalidHandle;
+        }
+    }
+
+    if (Cursor < Capacity)
+    {
+        const uint32 Tail = CreateBlock();
+        Blocks[Tail].Offset = Cursor;
+        Blocks[Tail].Size = Capacity - Cursor;
+        Blocks[Tail].PrevPhysical = LastAllocated;
+        if (LastAllocated != InvalidHandle)
+        {
+            Blocks[LastAllocated].NextPhysical = Tail;
+        }
+        else
+        {
+            FirstBlock = Tail;
+        }
+        InsertFreeBlock(Tail);
+    }
+}
+
+uint32 KTLSFAllocator::GetLargestFreeBlock() const
+{
+    if (FirstLevelBitmap == 0)
+    {
+        return 0;
+    }
+
+    // Every block of the highest non-empty list is at least as large as any other free block
+    const uint32 FirstLevel = FindHighestBit(FirstLevelBitmap);
+    const uint32 SecondLevel = FindHighestBit(SecondLevelBitmaps[FirstLevel]);
+
+    uint32 Largest = 0;
+    for (uint32 Block = FreeHeads[FirstLevel][SecondLevel]; Block != InvalidHandle; Block = Blocks[Block].NextFree)
+    {
+        if (Blocks[Block].Size > Largest)
+        {
+            Largest = Blocks[Block].Size;
+        }
+    }
+    return Largest;
+}
+
+float KTLSFAllocator::GetFragmentation() const
+{
+    const uint32 FreeSize = GetFreeSize();
+    return FreeSize > 0 ? 1.0f - static_cast<float>(GetLargestFreeBlock()) / static_cast<float>(FreeSize) : 0.0f;
+}
+
+void KTLSFAllocator::Mapping(uint32 Size, uint32& OutFirstLevel, uint32& OutSecondLevel)
+{
+    if (Size < SecondLevelCount)
+    {
+        // Small sizes get one exact list each
+        OutFirstLevel = 0;
+        OutSecondLevel = Size;
+    }
+    else
+    {
+        const uint32 HighestBit = FindHighestBit(Size);
+        OutFirstLevel = HighestBit - SecondLevelBits + 1;
+        OutSecondLevel = (Size >> (HighestBit - SecondLevelBits)) - SecondLevelCount;
+    }
+}
+
+uint32 KTLSFAllocator::CreateBlock()
+{
+    uint32 Block;
+    if (!UnusedBlocks.empty())
+    {
+        Block = UnusedBlocks.back();
+        UnusedBlocks.pop_back();
+        Blocks[Block] = FBlock();
+    }
+    else
+    {
+        Block = static_cast<uint32>(Blocks.size());
+        Blocks.emplace_back();
+    }
+    return Block;
+}
+
+void KTLSFAllocator::ReleaseBlock(uint32 Block)
+{
+    // Released slots look free so a stale Free is ignored
+    Blocks[Block].bFree = true;
+    Blocks[Block].Size = 0;
+    UnusedBlocks.push_back(Block);
+}
+
+void KTLSFAllocator::InsertFreeBlock(uint32 Block)
+{
+    uint32 FirstLevel, SecondLevel;
+    Mapping(Blocks[Block].Size, FirstLevel, SecondLevel);
+
+    FBlock& Inserted = Blocks[Block];
+    Inserted.bFree = true;
+    Inserted.PrevFree = InvalidHandle;
+    Inserted.NextFree = FreeHeads[FirstLevel][SecondLevel];
+    if (Inserted.NextFree != InvalidHandle)
+    {
+        Blocks[Inserted.NextFree].PrevFree = Block;
+    }
+    FreeHeads[FirstLevel][SecondLevel] = Block;
+
+    FirstLevelBitmap |= 1u << FirstLevel;
+    SecondLevelBitmaps[FirstLevel] |= 1u << SecondLevel;
+    ++FreeBlockCount;
+}
+
+void KTLSFAllocator::RemoveFreeBlock(uint32 Block)
+{
+    FBlock& Removed = Blocks[Block];
+    if (Removed.PrevFree != InvalidHandle)
+    {
+        Blocks[Removed.PrevFree].NextFree = Removed.NextFree;
+    }
+    else
+    {
+        uint32 FirstLevel, SecondLevel;
+        Mapping(Removed.Size, FirstLevel, SecondLevel);
+        FreeHeads[FirstLevel][SecondLevel] = Removed.NextFree;
+        if (Removed.NextFree == InvalidHandle)
+        {
+            SecondLevelBitmaps[FirstLevel] &= ~(1u << SecondLevel);
+            if (SecondLevelBitmaps[FirstLevel] == 0)
+            {
+                FirstLevelBitmap &= ~(1u << FirstLevel);
+            }
+        }
+    }
+    if (Removed.NextFree != InvalidHandle)
+    {
+        Blocks[Removed.NextFree].PrevFree = Removed.PrevFree;
+    }
+
+    Removed.bFree = false;
+    Removed.PrevFree = InvalidHandle;
+    Removed.NextFree = InvalidHandle;
+    --FreeBlockCount;
+}
+
+uint32 KTLSFAllocator::FindFreeBlock(uint32 Size) const
+{
+    uint32 FirstLevel, SecondLevel;
+    Mapping(Size, FirstLevel, SecondLevel);
+
+    // Round up to the next size class so any block of the found list fits
+    const uint64 Granularity = Size < SecondLevelCount ? 1 : uint64(1) << (FindHighestBit(Size) - SecondLevelBits);
+    const uint64 RoundedSize = (uint64(Size) + Granularity - 1) & ~(Granularity - 1);
+    if (RoundedSize <= ~uint32(0))
+    {
+        uint32 SearchFirstLevel, SearchSecondLevel;
+        Mapping(static_cast<uint32>(RoundedSize), SearchFirstLevel, SearchSecondLevel);
+
+        uint32 SecondLevelMap = SecondLevelBitmaps[SearchFirstLevel] & (~0u << SearchSecondLevel);
+        if (SecondLevelMap == 0)
+        {
+            const uint32 FirstLevelMap = SearchFirstLevel + 1 < 32 ? FirstLevelBitmap & (~0u << (SearchFirstLevel + 1)) : 0;
+            if (FirstLevelMap != 0)
+            {
+                SearchFirstLevel = FindLowestBit(FirstLevelMap);
+                SecondLevelMap = SecondLevelBitmaps[SearchFirstLevel];
+            }
+        }
+        if (SecondLevelMap != 0)
+        {
+            return FreeHeads[SearchFirstLevel][FindLowestBit(SecondLevelMap)];
+        }
+    }
+
+    // Fall back to the blocks sharing the request's own size class
+    for (uint32 Block = FreeHeads[FirstLevel][SecondLevel]; Block != InvalidHandle; Block = Blocks[Block].NextFree)
+    {
+        if (Blocks[Block].Size >= Size)
+        {
+            return Block;
+        }
+    }
+    return InvalidHandle;
+}
@@ -0,0 +1,139 @@
+﻿#pragma once
+
+#include "../Utils/Types.h"
+#include <vector>
+
+/**
+ * @brief Two-level segregated fit (TLSF) range suballocator
+ *
+ * Hands out ranges of a fixed-size space in constant time: free ranges are
+ * kept in size-class lists indexed by two bitmaps, and freed ranges merge
+ * with their free neighbours right away. Sizes and offsets are in abstract
+ * units (vertices, indices, bytes) and ranges need no alignment beyond one
+ * unit. Freeing is immediate, so the owner must not free a range the GPU
+ * may still read.
+ *
+ * Allocations are identified by handles that stay valid until freed, so
+ * Defragment can move them.
+ */
+class KTLSFAllocator
+{
+public:
+    static constexpr uint32 InvalidHandle = ~uint32(0);
+    static constexpr uint32 InvalidOffset = ~uint32(0);
+
+    /**
+     * @brief Range moved by Defragment
+     */
+    struct FRelocation
+    {
+        uint32 Handle;
+        uint32 OldOffset;
+        uint32 NewOffset;
+        uint32 Size;
+    };
+
+    KTLSFAllocator() = default;
+    explicit KTLSFAllocator(uint32 InCapacity) { Initialize(InCapacity); }
+
+    /**
+     * @brief Set the managed size and release everything
+     * @param InCapacity Size of the managed space in units
+     */
+    void Initialize(uint32 InCapacity);
+
+    /**
+     * @brief Allocate a range
+     * @param Size Size in units
+     * @return Handle of the range, or InvalidHandle if no free range is large enough
+     */
+    uint32 Allocate(uint32 Size);
+
+    /**
+     * @brief Release a range returned by Allocate
+     */
+    void Free(uint32 Handle);
+
+    /**
+     * @brief Release everything
+     */
+    void Reset();
+
+    /**
+     * @brief Move every allocation to the front, keeping their order
+     *
+     * Leaves a single free range at the end. Relocations are reported in
+     * address order with NewOffset <= OldOffset, so copying them in order
+     * never overwrites a range that has yet to be copied.
+     * @param OutRelocations Moved ranges (cleared first)
+     */
+    void Defragment(std::vector<FRelocation>& OutRelocations);
+
+    // Range accessors
+    uint32 GetOffset(uint32 Handle) const { return Blocks[Handle].Offset; }
+    uint32 GetSize(uint32 Handle) const { return Blocks[Handle].Size; }
+
+    // Statistics
+    uint32 GetCapacity() const { return Capacity; }
+    uint32 GetUsedSize() const { return UsedSize; }
+    uint32 GetFreeSize() const { return Capacity - UsedSize; }
+    uint32 GetAllocationCount() const { return AllocationCount; }
+    uint32 GetFreeBlockCount() const { return FreeBlockCount; }
+
+    /**
+     * @brief Size of the largest free range
+     */
+    uint32 GetLargestFreeBlock() const;
+
+    /**
+     * @brief 1 - largest free range / free size (0: all free space is contiguous)
+     */
+    float GetFragmentation() const;
+
+private:
+    static constexpr uint32 SecondLevelBits = 4;
+    static constexpr uint32 SecondLevelCount = 1u << SecondLevelBits;
+    static constexpr uint32 FirstLevelCount = 32 - SecondLevelBits + 1;
+
+    struct FBlock
+    {
+        uint32 Offset = 0;
+        uint32 Size = 0;
+        uint32 PrevPhysical = InvalidHandle;
+        uint32 NextPhysical = InvalidHandle;
+        uint32 PrevFree = InvalidHandle;
+        uint32 NextFree = InvalidHandle;
+        bool bFree = false;
+    };
+
+    /**
+     * @brief Size class of a size (first and second level list)
+     */
+    static void Mapping(uint32 Size, uint32& OutFirstLevel, uint32& OutSecondLevel);
+
+    uint32 CreateBlock();
+    void ReleaseBlock(uint32 Block);
+    void InsertFreeBlock(uint32 Block);
+    void RemoveFreeBlock(uint32 Block);
+
+    /**
+     * @brief Free block of at least Size units, InvalidHandle if none
+     */
+    uint32 FindFreeBlock(uint32 Size) const;
+
+private:
+    uint32 Capacity = 0;
+    uint32 UsedSize = 0;
+    uint32 AllocationCount = 0;
+    uint32 FreeBlockCount = 0;
+
+    // Block pool; handles index into it
+    std::vector<FBlock> Blocks;
+    std::vector<uint32> UnusedBlocks;
+    uint32 FirstBlock = InvalidHandle;
+
+    // Free lists: bit per non-empty first level, bit per non-empty list of a first level
+    uint32 FirstLevelBitmap = 0;
+    uint32 SecondLevelBitmaps[FirstLevelCount] = {};
+    uint32 FreeHeads[FirstLevelCount][SecondLevelCount] = {};
+};
@@ -1,8 +1,10 @@
 ﻿#include "Texture.h"
+#include "RenderStateCache.h"
+#include "../Core/Profiler.h"
 
 // UTexture class implementation
 
-HRESULT KTexture::LoadFromFile(ID3D11Device* Device, const std::wstring& Filename)
+HRESULT KTexture::LoadFromFile(IRHIDevice* Device, const std::wstring& Filename)
 {
     // For now, return success (texture loading implementation can be added later)
     // This would typically use DirectXTex library or similar
@@ -10,11 +12,13 @@ HRESULT KTexture::LoadFromFile(ID3D11Device* Device, const std::wstring& Filenam
     return S_OK;
 }
 
-HRESULT KTexture::CreateSolidColor(ID3D11Device* Device, UINT32 InWidth, UINT32 InHeight, const XMFLOAT4& Color)
+HRESULT KTexture::CreateSolidColor(IRHIDevice* Device, UINT32 InWidth, UINT32 InHeight, const XMFLOAT4& Color)
 {
+    KE_PROFILE_FUNCTION();
+
     Width = InWidth;
     Height = InHeight;
-    Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    Format = ERHIFormat::R8G8B8A8_UNorm;
 
     // Create texture data
     std::vector<UINT32> TextureData(InWidth * InHeight);
@@ -26,40 +30,14 @@ HRESULT KTexture::CreateSolidColor(ID3D11Device* Device, UINT32 InWidth, UINT32
 
     std::fill(TextureData.begin(), TextureData.end(), ColorValue);
 
-    // Create texture description
-    D3D11_TEXTURE2D_DESC TextureDesc = {};
-    TextureDesc.Width = InWidth;
-    TextureDesc.Height = InHeight;
-    TextureDesc.MipLevels = 1;
-    TextureDesc.ArraySize = 1;
-    TextureDesc.Format = Format;
-    TextureDesc.SampleDesc.Count = 1;
-    TextureDesc.SampleDesc.Quality = 0;
-    TextureDesc.Usage = D3D11_USAGE_DEFAULT;
-    TextureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-    TextureDesc.CPUAccessFlags = 0;
-
-    // Create subresource data
-    D3D11_SUBRESOURCE_DATA InitData = {};
-    InitData.pSysMem = TextureData.data();
-    InitData.SysMemPitch = InWidth * sizeof(UINT32);
-    InitData.SysMemSlicePitch = 0;
-
-    // Create texture
-    HRESULT hr = Device->CreateTexture2D(&TextureDesc, &InitData, &Texture);
+    // Create texture and shader resource view
+    HRESULT hr = CreateShaderResourceView(Device, TextureData.data());
     if (FAILED(hr))
     {
         KLogger::HResultError(hr, "Solid color texture creation failed");
         return hr;
     }
 
-    // Create shader resource view
-    hr = CreateShaderResourceView(Device);
-    if (FAILED(hr))
-    {
-        return hr;
-    }
-
     // Create sampler state
     hr = CreateSamplerState(Device);
     if (FAILED(hr))
@@ -70,12 +48,14 @@ HRESULT KTexture::CreateSolidColor(ID3D11Device* Device, UINT32 InWidth, UINT32
     return S_OK;
 }
 
-HRESULT KTexture::CreateCheckerboard(ID3D11Device* Device, UINT32 InWidth, UINT32 InHeight,
+HRESULT KTexture::CreateCheckerboard(IRHIDevice* Device, UINT32 InWidth, UINT32 InHeight,
                                      const XMFLOAT4& Color1, const XMFLOAT4& Color2, UINT32 CheckSize)
 {
+    KE_PROFILE_FUNCTION();
+
     Width = InWidth;
     Height = InHeight;
-    Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    Format = ERHIFormat::R8G8B8A8_UNorm;
 
     // Create texture data
     std::vector<UINT32> TextureData(InWidth * InHeight);
@@ -102,40 +82,14 @@ HRESULT KTexture::CreateCheckerboard(ID3D11Device* Device, UINT32 InWidth, UINT3
         }
     }
 
-    // Create texture description
-    D3D11_TEXTURE2D_DESC TextureDesc = {};
-    TextureDesc.Width = InWidth;
-    TextureDesc.Height = InHeight;
-    TextureDesc.MipLevels = 1;
-    TextureDesc.ArraySize = 1;
-    TextureDesc.Format = Format;
-    TextureDesc.SampleDesc.Count = 1;
-    TextureDesc.SampleDesc.Quality = 0;
-    TextureDesc.Usage = D3D11_USAGE_DEFAULT;
-    TextureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-    TextureDesc.CPUAccessFlags = 0;
-
-    // Create subresource data
-    D3D11_SUBRESOURCE_DATA InitData = {};
-    InitData.pSysMem = TextureData.data();
-    InitData.SysMemPitch = InWidth * sizeof(UINT32);
-    InitData.SysMemSlicePitch = 0;
-
-    // Create texture
-    HRESULT hr = Device->CreateTexture2D(&TextureDesc, &InitData, &Texture);
+    // Create texture and shader resource view
+    HRESULT hr = CreateShaderResourceView(Device, TextureData.data());
     if (FAILED(hr))
     {
         KLogger::HResultError(hr, "Checkerboard texture creation failed");
         return hr;
     }
 
-    // Create shader resource view
-    hr = CreateShaderResourceView(Device);
-    if (FAILED(hr))
-    {
-        return hr;
-    }
-
     // Create sampler state
     hr = CreateSamplerState(Device);
     if (FAILED(hr))
@@ -146,77 +100,73 @@ HRESULT KTexture::CreateCheckerboard(ID3D11Device* Device, UINT32 InWidth, UINT3
     return S_OK;
 }
 
-void KTexture::Bind(ID3D11DeviceContext* Context, UINT32 Slot) const
+void KTexture::Bind(IRHICommandContext& Context, UINT32 Slot) const
 {
     if (ShaderResourceView)
     {
-        Context->PSSetShaderResources(Slot, 1, ShaderResourceView.GetAddressOf());
+        Context.SetShaderResource(EShaderType::Pixel, Slot, ShaderResourceView.Get());
     }
 
     if (SamplerState)
     {
-        Context->PSSetSamplers(Slot, 1, SamplerState.GetAddressOf());
+        Context.SetSampler(EShaderType::Pixel, Slot, SamplerState.Get());
     }
 }
 
-void KTexture::Unbind(ID3D11DeviceContext* Context, UINT32 Slot) const
+void KTexture::Unbind(IRHICommandContext& Context, UINT32 Slot) const
 {
-    ID3D11ShaderResourceView* NullSRV = nullptr;
-    ID3D11SamplerState* NullSampler = nullptr;
-    
-    Context->PSSetShaderResources(Slot, 1, &NullSRV);
-    Context->PSSetSamplers(Slot, 1, &NullSampler);
+    Context.SetShaderResource(EShaderType::Pixel, Slot, nullptr);
+    Context.SetSampler(EShaderType::Pixel, Slot, nullptr);
+}
+
+void KTexture::Bind(KRenderStateCache& StateCache, UINT32 Slot) const
+{
+    StateCache.SetShaderResource(EShaderType::Pixel, Slot, ShaderResourceView.Get());
+    StateCache.SetSampler(EShaderType::Pixel, Slot, SamplerState.Get());
 }
 
 void KTexture::Cleanup()
 {
     SamplerState.Reset();
     ShaderResourceView.Reset();
-    Texture.Reset();
     Width = 0;
     Height = 0;
-    Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    Format = ERHIFormat::R8G8B8A8_UNorm;
 }
 
-HRESULT KTexture::CreateShaderResourceView(ID3D11Device* Device)
+HRESULT KTexture::CreateShaderResourceView(IRHIDevice* Device, const UINT32* Texels)
 {
-    if (!Texture)
+    if (!Device)
     {
-        return E_FAIL;
+        return E_INVALIDARG;
     }
 
-    HRESULT hr = Device->CreateShaderResourceView(Texture.Get(), nullptr, &ShaderResourceView);
-    if (FAILED(hr))
+    FRHITextureDesc TextureDesc;
+    TextureDesc.Width = Width;
+    TextureDesc.Height = Height;
+    TextureDesc.Format = Format;
+
+    ShaderResourceView.Reset(Device, Device->CreateTexture2D(TextureDesc, Texels, Width * sizeof(UINT32)));
+    if (!ShaderResourceView)
     {
-        KLogger::HResultError(hr, "Shader resource view creation failed");
-        return hr;
+        LOG_ERROR("Shader resource view creation failed");
+        return E_FAIL;
     }
 
     return S_OK;
 }
 
-HRESULT KTexture::CreateSamplerState(ID3D11Device* Device)
+HRESULT KTexture::CreateSamplerState(IRHIDevice* Device)
 {
-    D3D11_SAMPLER_DESC SamplerDesc = {};
-    SamplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
-    SamplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
-    SamplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
-    SamplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
-    SamplerDesc.MipLODBias = 0.0f;
-    SamplerDesc.MaxAnisotropy = 1;
-    SamplerDesc.ComparisonFunc = D3D11_COMPARISON_ALWAYS;
-    SamplerDesc.BorderColor[0] = 0.0f;
-    SamplerDesc.BorderColor[1] = 0.0f;
-    SamplerDesc.BorderColor[2] = 0.0f;
-    SamplerDesc.BorderColor[3] = 0.0f;
-    SamplerDesc.MinLOD = 0.0f;
-    SamplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
-
-    HRESULT hr = Device->CreateSamplerState(&SamplerDesc, &SamplerState);
-    if (FAILED(hr))
+    FRHISamplerDesc SamplerDesc;
+    SamplerDesc.Filter = ERHIFilter::Linear;
+    SamplerDesc.AddressMode = ERHIAddressMode::Wrap;
+
+    SamplerState.Reset(Device, Device->CreateSampler(SamplerDesc));
+    if (!SamplerState)
     {
-        KLogger::HResultError(hr, "Sampler state creation failed");
-        return hr;
+        LOG_ERROR("Sampler state creation failed");
+        return E_FAIL;
     }
 
     return S_OK;
@@ -224,7 +174,7 @@ HRESULT KTexture::CreateSamplerState(ID3D11Device* Device)
 
 // UTextureManager class implementation
 
-HRESULT KTextureManager::CreateDefaultTextures(ID3D11Device* Device)
+HRESULT KTextureManager::CreateDefaultTextures(IRHIDevice* Device)
 {
     // Create white texture
     WhiteTexture = std::make_shared<KTexture>();
@@ -294,7 +244,7 @@ void KTextureManager::Cleanup()
     LOG_INFO("Texture manager cleanup completed");
 }
 
-std::shared_ptr<KTexture> KTextureManager::LoadTexture(ID3D11Device* Device, const std::wstring& Filename)
+std::shared_ptr<KTexture> KTextureManager::LoadTexture(IRHIDevice* Device, const std::wstring& Filename)
 {
     // Check if texture is already loaded
     auto It = TextureCache.find(Filename);
@@ -2,6 +2,7 @@
 
 #include "../Utils/Common.h"
 #include "../Utils/Logger.h"
+#include "../RHI/RHI.h"
 
 /**
  * @brief Texture class
@@ -22,25 +23,25 @@ public:
 
     /**
      * @brief Load texture from file
-     * @param Device DirectX 11 device
+     * @param Device RHI device
      * @param Filename Texture file path
      * @return S_OK on success
      */
-    HRESULT LoadFromFile(ID3D11Device* Device, const std::wstring& Filename);
+    HRESULT LoadFromFile(IRHIDevice* Device, const std::wstring& Filename);
 
     /**
      * @brief Create texture from memory (solid color texture, etc.)
-     * @param Device DirectX 11 device
+     * @param Device RHI device
      * @param Width Texture width
      * @param Height Texture height
      * @param Color Color (RGBA)
      * @return S_OK on success
      */
-    HRESULT CreateSolidColor(ID3D11Device* Device, UINT32 Width, UINT32 Height, const XMFLOAT4& Color);
+    HRESULT CreateSolidColor(IRHIDevice* Device, UINT32 Width, UINT32 Height, const XMFLOAT4& Color);
 
     /**
      * @brief Create checkerboard pattern texture
-     * @param Device DirectX 11 device
+     * @param Device RHI device
      * @param Width Texture width
      * @param Height Texture height
      * @param Color1 First color
@@ -48,22 +49,29 @@ public:
      * @param CheckSize Check size
      * @return S_OK on success
      */
-    HRESULT CreateCheckerboard(ID3D11Device* Device, UINT32 Width, UINT32 Height,
+    HRESULT CreateCheckerboard(IRHIDevice* Device, UINT32 Width, UINT32 Height,
                               const XMFLOAT4& Color1, const XMFLOAT4& Color2, UINT32 CheckSize = 32);
 
     /**
      * @brief Bind texture (to make it usable in shaders)
-     * @param Context DirectX 11 device context
+     * @param Context RHI command context
      * @param Slot Texture slot number
      */
-    void Bind(ID3D11DeviceContext* Context, UINT32 Slot = 0) const;
+    void Bind(IRHICommandContext& Context, UINT32 Slot = 0) const;
 
     /**
      * @brief Unbind texture
-     * @param Context DirectX 11 device context
+     * @param Context RHI command context
      * @param Slot Texture slot number
      */
-    void Unbind(ID3D11DeviceContext* Context, UINT32 Slot = 0) const;
+    void Unbind(IRHICommandContext& Context, UINT32 Slot = 0) const;
+
+    /**
+     * @brief Bind texture through a state cache
+     * @param StateCache Render state cache
+     * @param Slot Texture slot number
+     */
+    void Bind(KRenderStateCache& StateCache, UINT32 Slot = 0) const;
 
     /**
      * @brief Cleanup resources
@@ -71,33 +79,31 @@ public:
     void Cleanup();
 
     // Accessors
-    ID3D11Texture2D* GetTexture() const { return Texture.Get(); }
-    ID3D11ShaderResourceView* GetShaderResourceView() const { return ShaderResourceView.Get(); }
-    ID3D11SamplerState* GetSamplerState() const { return SamplerState.Get(); }
+    FRHIResource GetShaderResourceView() const { return ShaderResourceView.Get(); }
+    FRHIResource GetSamplerState() const { return SamplerState.Get(); }
     
     UINT32 GetWidth() const { return Width; }
     UINT32 GetHeight() const { return Height; }
-    DXGI_FORMAT GetFormat() const { return Format; }
+    ERHIFormat GetFormat() const { return Format; }
 
 private:
     /**
-     * @brief Create shader resource view
+     * @brief Create the texture and its shader resource view from RGBA8 texels
      */
-    HRESULT CreateShaderResourceView(ID3D11Device* Device);
+    HRESULT CreateShaderResourceView(IRHIDevice* Device, const UINT32* Texels);
 
     /**
      * @brief Create sampler state
      */
-    HRESULT CreateSamplerState(ID3D11Device* Device);
+    HRESULT CreateSamplerState(IRHIDevice* Device);
 
 private:
-    ComPtr<ID3D11Texture2D> Texture;
-    ComPtr<ID3D11ShaderResourceView> ShaderResourceView;
-    ComPtr<ID3D11SamplerState> SamplerState;
+    FRHIResourceRef ShaderResourceView;
+    FRHIResourceRef SamplerState;
 
     UINT32 Width = 0;
     UINT32 Height = 0;
-    DXGI_FORMAT Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    ERHIFormat Format = ERHIFormat::R8G8B8A8_UNorm;
 };
 
 /**
@@ -117,18 +123,18 @@ public:
 
     /**
      * @brief Load texture (with caching support)
-     * @param Device DirectX 11 device
+     * @param Device RHI device
      * @param Filename Texture file path
      * @return Texture pointer (nullptr on failure)
      */
-    std::shared_ptr<KTexture> LoadTexture(ID3D11Device* Device, const std::wstring& Filename);
+    std::shared_ptr<KTexture> LoadTexture(IRHIDevice* Device, const std::wstring& Filename);
 
     /**
      * @brief Create default textures
-     * @param Device DirectX 11 device
+     * @param Device RHI device
      * @return S_OK on success
      */
-    HRESULT CreateDefaultTextures(ID3D11Device* Device);
+    HRESULT CreateDefaultTextures(IRHIDevice* Device);
 
     /**
      * @brief Get default white texture
@@ -0,0 +1,405 @@
+﻿#include "VertexFormat.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    /**
+     * @brief Declaration and stride of one stream
+     */
+    struct FStreamDecl
+    {
+        const FVertexElementDecl* Elements = nullptr;
+        uint32 ElementCount = 0;
+        uint32 Stride = 0;
+    };
+
+    template<typename TVertex>
+    constexpr FStreamDecl MakeStream()
+    {
+        return FStreamDecl{ TVertexDeclaration<TVertex>::Elements,
+                            static_cast<uint32>(sizeof(TVertexDeclaration<TVertex>::Elements) / sizeof(FVertexElementDecl)),
+                            static_cast<uint32>(sizeof(TVertex)) };
+    }
+
+    struct FLayoutDecl
+    {
+        FStreamDecl Streams[VertexFormat::MaxStreams];
+        bool bQuantizedPositions = false;
+    };
+
+    // Indexed by EVertexLayout
+    const FLayoutDecl LayoutDecls[VertexLayoutCount] =
+    {
+        { { MakeStream<FStandardVertex>(), {} }, false },
+        { { MakeStream<FCompactVertex>(), {} }, false },
+        { { MakeStream<FPositionVertex>(), MakeStream<FPackedVertexAttributes>() }, false },
+        { { MakeStream<FQuantizedVertex>(), {} }, true },
+        { { MakeStream<FQuantizedPositionVertex>(), MakeStream<FPackedVertexAttributes>() }, true },
+        { { MakeStream<FPositionVertex>(), {} }, false },
+        { { MakeStream<FQuantizedPositionVertex>(), {} }, true },
+        { { MakeStream<FCompactVertex>(), MakeStream<FSkinInfluences>() }, false },
+    };
+
+    const FLayoutDecl& GetLayoutDecl(EVertexLayout Layout)
+    {
+        return LayoutDecls[static_cast<uint32>(Layout)];
+    }
+
+    float Clamp(float Value, float Min, float Max)
+    {
+        return Value < Min ? Min : (Value > Max ? Max : Value);
+    }
+
+    void QuantizePosition(const float Position[3], const FBoundingBox& Bounds, int16 OutPosition[4])
+    {
+        for (int Axis = 0; Axis < 3; ++Axis)
+        {
+            const float Extent = Bounds.Extents[Axis];
+            const float Normalized = Extent > 0.0f ? (Position[Axis] - Bounds.Center[Axis]) / Extent : 0.0f;
+            OutPosition[Axis] = VertexFormat::QuantizeSNorm16(Normalized);
+        }
+        OutPosition[3] = 32767; // W = 1
+    }
+
+    void PackAttributes(const FStandardVertex& Vertex, uint32& OutColor, int16 OutNormal[2], uint16 OutTexCoord[2])
+    {
+        OutColor = VertexFormat::PackColorRGBA8(Vertex.Color);
+        VertexFormat::EncodeOctahedralNormal(Vertex.Normal, OutNormal);
+        OutTexCoord[0] = VertexFormat::FloatToHalf(Vertex.TexCoord[0]);
+        OutTexCoord[1] = VertexFormat::FloatToHalf(Vertex.TexCoord[1]);
+    }
+}
+
+namespace VertexFormat
+{
+    uint32 GetStreamCount(EVertexLayout Layout)
+    {
+        const FLayoutDecl& Decl = GetLayoutDecl(Layout);
+        uint32 Count = 0;
+        while (Count < MaxStreams && Decl.Streams[Count].Stride > 0)
+        {
+            ++Count;
+        }
+        return Count;
+    }
+
+    uint32 GetStreamStride(EVertexLayout Layout, uint32 Stream)
+    {
+        return Stream < MaxStreams ? GetLayoutDecl(Layout).Streams[Stream].Stride : 0;
+    }
+
+    bool HasQuantizedPositions(EVertexLayout Layout)
+    {
+        return GetLayoutDecl(Layout).bQuantizedPositions;
+    }
+
+    EVertexLayout GetPositionLayout(EVertexLayout Layout)
+    {
+        return HasQuantizedPositions(Layout) ? EVertexLayout::QuantizedPosition : EVertexLayout::Position;
+    }
+
+    void AppendInputElements(EVertexLayout Layout, std::vector<FRHIInputElement>& OutElements)
+    {
+        const FLayoutDecl& Decl = GetLayoutDecl(Layout);
+        for (uint32 Stream = 0; Stream < MaxStreams; ++Stream)
+        {
+            const FStreamDecl& StreamDecl = Decl.Streams[Stream];
+            for (uint32 i = 0; i < StreamDecl.ElementCount; ++i)
+            {
+                const FVertexElementDecl& Source = StreamDecl.Elements[i];
+
+                FRHIInputElement Element;
+                Element.SemanticName = Source.SemanticName;
+                Element.SemanticIndex = Source.SemanticIndex;
+                Element.Format = Source.Format;
+                Element.InputSlot = Stream;
+                Element.AlignedByteOffset = Source.Offset;
+                OutElements.push_back(Element);
+            }
+        }
+    }
+
+    bool Encode(const FStandardVertex* Vertices, uint32 VertexCount, EVertexLayout Layout,
+                const FBoundingBox& PositionBounds, std::vector<uint8> (&OutStreams)[MaxStreams])
+    {
+        for (uint32 Stream = 0; Stream < MaxStreams; ++Stream)
+        {
+            OutStreams[Stream].assign(static_cast<size_t>(GetStreamStride(Layout, Stream)) * VertexCount, 0);
+        }
+
+        switch (Layout)
+        {
+        case EVertexLayout::Standard:
+            if (VertexCount > 0)
+            {
+                std::memcpy(OutStreams[0].data(), Vertices, sizeof(FStandardVertex) * VertexCount);
+            }
+            return true;
+
+        case EVertexLayout::Compact:
+        {
+            FCompactVertex* Destination = reinterpret_cast<FCompactVertex*>(OutStreams[0].data());
+            for (uint32 i = 0; i < VertexCount; ++i)
+            {
+                std::memcpy(Destination[i].Position, Vertices[i].Position, sizeof(float) * 3);
+                PackAttributes(Vertices[i], Destination[i].Color, Destination[i].Normal, Destination[i].TexCoord);
+            }
+            return true;
+        }
+
+        case EVertexLayout::Quantized:
+        {
+            FQuantizedVertex* Destination = reinterpret_cast<FQuantizedVertex*>(OutStreams[0].data());
+            for (uint32 i = 0; i < VertexCount; ++i)
+            {
+                QuantizePosition(Vertices[i].Position, PositionBounds, Destination[i].Position);
+                PackAttributes(Vertices[i], Destination[i].Color, Destination[i].Normal, Destination[i].TexCoord);
+            }
+            return true;
+        }
+
+        case EVertexLayout::CompactSplit:
+        case EVertexLayout::QuantizedSplit:
+        {
+            FPackedVertexAttributes* Attributes = reinterpret_cast<FPackedVertexAttributes*>(OutStreams[1].data());
+            for (uint32 i = 0; i < VertexCount; ++i)
+            {
+                if (Layout == EVertexLayout::CompactSplit)
+                {
+                    std::memcpy(reinterpret_cast<FPositionVertex*>(OutStreams[0].data())[i].Position,
+                                Vertices[i].Position, sizeof(float) * 3);
+                }
+                else
+                {
+                    QuantizePosition(Vertices[i].Position, PositionBounds,
+                                     reinterpret_cast<FQuantizedPositionVertex*>(OutStreams[0].data())[i].Position);
+                }
+                PackAttributes(Vertices[i], Attributes[i].Color, Attributes[i].Normal, Attributes[i].TexCoord);
+            }
+            return true;
+        }
+
+        default:
+            // Position-only layouts are views of another layout's stream 0;
+            // skinned vertices go through EncodeSkinned
+            return false;
+        }
+    }
+
+    void EncodeSkinned(const FStandardSkinnedVertex* Vertices, uint32 VertexCount,
+                       std::vector<uint8> (&OutStreams)[MaxStreams])
+    {
+        OutStreams[0].assign(sizeof(FCompactVertex) * size_t(VertexCount), 0);
+        OutStreams[1].assign(sizeof(FSkinInfluences) * size_t(VertexCount), 0);
+
+        FCompactVertex* Destination = reinterpret_cast<FCompactVertex*>(OutStreams[0].data());
+        FSkinInfluences* Influences = reinterpret_cast<FSkinInfluences*>(OutStreams[1].data());
+        for (uint32 i = 0; i < VertexCount; ++i)
+        {
+            std::memcpy(Destination[i].Position, Vertices[i].Vertex.Position, sizeof(float) * 3);
+            PackAttributes(Vertices[i].Vertex, Destination[i].Color, Destination[i].Normal, Destination[i].TexCoord);
+            EncodeSkinInfluences(Vertices[i].JointIndices, Vertices[i].JointWeights, Influences[i]);
+        }
+    }
+
+    void EncodeSkinInfluences(const uint8 JointIndices[4], const float JointWeights[4], FSkinInfluences& OutInfluences)
+    {
+        float Sum = 0.0f;
+        for (int i = 0; i < 4; ++i)
+        {
+            Sum += JointWeights[i] > 0.0f ? JointWeights[i] : 0.0f;
+        }
+
+        int Largest = 0;
+        int Total = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            const float Weight = Sum > 0.0f && JointWeights[i] > 0.0f ? JointWeights[i] / Sum : (Sum > 0.0f || i > 0 ? 0.0f : 1.0f);
+            OutInfluences.JointIndices[i] = JointIndices[i];
+            OutInfluences.JointWeights[i] = static_cast<uint8>(std::lround(Clamp(Weight, 0.0f, 1.0f) * 255.0f));
+            Total += OutInfluences.JointWeights[i];
+            Largest = OutInfluences.JointWeights[i] > OutInfluences.JointWeights[Largest] ? i : Largest;
+        }
+
+        // Rounding error goes to the largest weight
+        OutInfluences.JointWeights[Largest] = static_cast<uint8>(OutInfluences.JointWeights[Largest] + (255 - Total));
+    }
+
+    void GetPositionDecodeMatrix(const FBoundingBox& PositionBounds, float OutMatrix[16])
+    {
+        // Scale by the extents, then translate to the center
+        std::memset(OutMatrix, 0, sizeof(float) * 16);
+        for (int Axis = 0; Axis < 3; ++Axis)
+        {
+            OutMatrix[Axis * 4 + Axis] = PositionBounds.Extents[Axis];
+            OutMatrix[12 + Axis] = PositionBounds.Center[Axis];
+        }
+        OutMatrix[15] = 1.0f;
+    }
+
+    uint32 PackColorRGBA8(const float Color[4])
+    {
+        uint32 Packed = 0;
+        for (int Channel = 0; Channel < 4; ++Channel)
+        {
+            const uint32 Value = static_cast<uint32>(Clamp(Color[Channel], 0.0f, 1.0f) * 255.0f + 0.5f);
+            Packed |= Value << (Channel * 8);
+        }
+        return Packed;
+    }
+
+    void UnpackColorRGBA8(uint32 Packed, float OutColor[4])
+    {
+        for (int Channel = 0; Channel < 4; ++Channel)
+        {
+            OutColor[Channel] = static_cast<float>((Packed >> (Channel * 8)) & 0xFF) / 255.0f;
+        }
+    }
+
+    void EncodeOctahedralNormal(const float Normal[3], int16 OutEncoded[2])
+    {
+        // Project onto the octahedron |x| + |y| + |z| = 1, then fold the lower hemisphere
+        const float L1 = std::fabs(Normal[0]) + std::fabs(Normal[1]) + std::fabs(Normal[2]);
+        float X = L1 > 0.0f ? Normal[0] / L1 : 0.0f;
+        float Y = L1 > 0.0f ? Normal[1] / L1 : 0.0f;
+        const float Z = L1 > 0.0f ? Normal[2] / L1 : 1.0f;
+
+        if (Z < 0.0f)
+        {
+            const float FoldedX = (1.0f - std::fabs(Y)) * (X >= 0.0f ? 1.0f : -1.0f);
+            const float FoldedY = (1.0f - std::fabs(X)) * (Y >= 0.0f ? 1.0f : -1.0f);
+            X = FoldedX;
+            Y = FoldedY;
+        }
+
+        OutEncoded[0] = QuantizeSNorm16(X);
+        OutEncoded[1] = QuantizeSNorm16(Y);
+    }
+
+    void DecodeOctahedralNormal(const int16 Encoded[2], float OutNormal[3])
+    {
+        float X = DequantizeSNorm16(Encoded[0]);
+        float Y = DequantizeSNorm16(Encoded[1]);
+        const float Z = 1.0f - std::fabs(X) - std::fabs(Y);
+
+        if (Z < 0.0f)
+        {
+            const float UnfoldedX = (1.0f - std::fabs(Y)) * (X >= 0.0f ? 1.0f : -1.0f);
+            const float UnfoldedY = (1.0f - std::fabs(X)) * (Y >= 0.0f ? 1.0f : -1.0f);
+            X = UnfoldedX;
+            Y = UnfoldedY;
+        }
+
+        const float Length = std::sqrt(X * X + Y * Y + Z * Z);
+        OutNormal[0] = X / Length;
+        OutNormal[1] = Y / Length;
+        OutNormal[2] = Z / Length;
+    }
+
+    uint16 FloatToHalf(float Value)
+    {
+        uint32 Bits;
+        std::memcpy(&Bits, &Value, sizeof(Bits));
+
+        const uint32 Sign = (Bits >> 16) & 0x8000;
+        const uint32 Exponent = (Bits >> 23) & 0xFF;
+        uint32 Mantissa = Bits & 0x007FFFFF;
+
+        // NaN / infinity
+        if (Exponent == 0xFF)
+        {
+            return static_cast<uint16>(Sign | 0x7C00 | (Mantissa ? 0x0200 : 0));
+        }
+
+        const int32 HalfExponent = static_cast<int32>(Exponent) - 127 + 15;
+
+        // Overflow to infinity
+        if (HalfExponent >= 31)
+        {
+            return static_cast<uint16>(Sign | 0x7C00);
+        }
+
+        // Denormals and underflow to zero
+        if (HalfExponent <= 0)
+        {
+            if (HalfExponent < -10)
+            {
+                return static_cast<uint16>(Sign);
+            }
+            Mantissa |= 0x00800000;
+            const uint32 Shift = static_cast<uint32>(14 - HalfExponent);
+            uint32 HalfMantissa = Mantissa >> Shift;
+
+            // Round to nearest even
+            const uint32 Remainder = Mantissa & ((1u << Shift) - 1);
+            const uint32 Halfway = 1u << (Shift - 1);
+            if (Remainder > Halfway || (Remainder == Halfway && (HalfMantissa & 1)))
+            {
+                ++HalfMantissa;
+            }
+            return static_cast<uint16>(Sign | HalfMantissa);
+        }
+
+        uint32 Half = Sign | (static_cast<uint32>(HalfExponent) << 10) | (Mantissa >> 13);
+
+        // Round to nearest even (a carry into the exponent is still correct)
+        const uint32 Remainder = Mantissa & 0x1FFF;
+        if (Remainder > 0x1000 || (Remainder == 0x1000 && (Half & 1)))
+        {
+            ++Half;
+        }
+        return static_cast<uint16>(Half);
+    }
+
+    float HalfToFloat(uint16 Value)
+    {
+        const uint32 Sign = static_cast<uint32>(Value & 0x8000) << 16;
+        uint32 Exponent = (Value >> 10) & 0x1F;
+        uint32 Mantissa = Value & 0x03FF;
+
+        uint32 Bits;
+        if (Exponent == 0x1F)
+        {
+            Bits = Sign | 0x7F800000 | (Mantissa << 13);
+        }
+        else if (Exponent == 0)
+        {
+            if (Mantissa == 0)
+            {
+                Bits = Sign;
+            }
+            else
+            {
+                // Normalize the denormal
+                Exponent = 127 - 15 + 1;
+                while ((Mantissa & 0x0400) == 0)
+                {
+                    Mantissa <<= 1;
+                    --Exponent;
+                }
+                Bits = Sign | (Exponent << 23) | ((Mantissa & 0x03FF) << 13);
+            }
+        }
+        else
+        {
+            Bits = Sign | ((Exponent + 127 - 15) << 23) | (Mantissa << 13);
+        }
+
+        float Result;
+        std::memcpy(&Result, &Bits, sizeof(Result));
+        return Result;
+    }
+
+    int16 QuantizeSNorm16(float Value)
+    {
+        return static_cast<int16>(std::lround(Clamp(Value, -1.0f, 1.0f) * 32767.0f));
+    }
+
+    float DequantizeSNorm16(int16 Value)
+    {
+        // -32768 and -32767 both map to -1, as on the GPU
+        return Clamp(static_cast<float>(Value) / 32767.0f, -1.0f, 1.0f);
+    }
+}
@@ -0,0 +1,310 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "../Utils/Types.h"
+#include "../Utils/Bounds.h"
+#include "../RHI/RHI.h"
+
+// Vertex layouts, their compile-time declarations and the attribute encoders.
+// Platform independent.
+
+/**
+ * @brief Vertex layouts a mesh can be stored in
+ *
+ * Position is always the first element of stream 0, so any layout can feed a
+ * position-only pass (Position / QuantizedPosition) from its stream 0 (skinned
+ * meshes then appear in their bind pose).
+ */
+enum class EVertexLayout : uint8
+{
+    Standard,           // FStandardVertex (48 bytes)
+    Compact,            // FCompactVertex (24 bytes)
+    CompactSplit,       // FPositionVertex (12) + FPackedVertexAttributes (12)
+    Quantized,          // FQuantizedVertex (20 bytes)
+    QuantizedSplit,     // FQuantizedPositionVertex (8) + FPackedVertexAttributes (12)
+    Position,           // Position-only view of Standard/Compact/CompactSplit stream 0
+    QuantizedPosition,  // Position-only view of Quantized/QuantizedSplit stream 0
+    Skinned             // FCompactVertex (24) + FSkinInfluences (8)
+};
+
+constexpr uint32 VertexLayoutCount = 8;
+
+/**
+ * @brief Full-precision vertex (matches FVertex)
+ */
+struct FStandardVertex
+{
+    float Position[3];
+    float Color[4];
+    float Normal[3];
+    float TexCoord[2];
+};
+
+/**
+ * @brief Float position, RGBA8 color, octahedral SNorm16 normal, half-float UV
+ */
+struct FCompactVertex
+{
+    float Position[3];
+    uint32 Color;
+    int16 Normal[2];
+    uint16 TexCoord[2];
+};
+
+/**
+ * @brief Like FCompactVertex, with SNorm16 positions relative to the mesh bounds (W = 1)
+ */
+struct FQuantizedVertex
+{
+    int16 Position[4];
+    uint32 Color;
+    int16 Normal[2];
+    uint16 TexCoord[2];
+};
+
+/**
+ * @brief Split stream 0: positions only
+ */
+struct FPositionVertex
+{
+    float Position[3];
+};
+
+struct FQuantizedPositionVertex
+{
+    int16 Position[4];
+};
+
+/**
+ * @brief Split stream 1: everything but the position
+ */
+struct FPackedVertexAttributes
+{
+    uint32 Color;
+    int16 Normal[2];
+    uint16 TexCoord[2];
+};
+
+/**
+ * @brief Skinned stream 1: four joint indices and UNorm8 weights summing to 255
+ */
+struct FSkinInfluences
+{
+    uint8 JointIndices[4];
+    uint8 JointWeights[4];
+};
+
+/**
+ * @brief Full-precision skinned vertex (matches FSkinnedVertex)
+ */
+struct FStandardSkinnedVertex
+{
+    FStandardVertex Vertex;
+    uint8 JointIndices[4];
+    float JointWeights[4];      // Normalized when encoded; unused influences have weight 0
+};
+
+/**
+ * @brief One element of a vertex declaration
+ */
+struct FVertexElementDecl
+{
+    const char* SemanticName = nullptr;
+    uint32 SemanticIndex = 0;
+    ERHIFormat Format = ERHIFormat::Unknown;
+    uint32 Offset = 0;
+    uint32 Size = 0;    // Size of the struct member, checked against the format
+};
+
+/**
+ * @brief Vertex declaration of a vertex struct
+ *
+ * Specializations list every member with KE_VERTEX_ELEMENT and are checked by
+ * VertexFormat::IsValidDeclaration, so a struct and its input layout cannot
+ * drift apart.
+ */
+template<typename TVertex>
+struct TVertexDeclaration;
+
+#define KE_VERTEX_ELEMENT(Type, Member, Semantic, Index, Format) \
+    FVertexElementDecl{ Semantic, Index, Format, static_cast<uint32>(offsetof(Type, Member)), static_cast<uint32>(sizeof(Type::Member)) }
+
+namespace VertexFormat
+{
+    /**
+     * @brief Number of vertex buffer slots a mesh can use; instance data is bound after them
+     */
+    constexpr uint32 MaxStreams = 2;
+    constexpr uint32 InstanceStreamSlot = MaxStreams;
+
+    /**
+     * @brief Elements are in member order, match their formats and cover the struct without gaps
+     */
+    template<typename TVertex>
+    constexpr bool IsValidDeclaration()
+    {
+        uint32 End = 0;
+        for (const FVertexElementDecl& Element : TVertexDeclaration<TVertex>::Elements)
+        {
+            if (Element.Offset != End || Element.Size != GetRHIFormatSize(Element.Format))
+            {
+                return false;
+            }
+            End += Element.Size;
+        }
+        return End == sizeof(TVertex);
+    }
+
+    /**
+     * @brief Number of vertex buffers of a layout
+     */
+    uint32 GetStreamCount(EVertexLayout Layout);
+
+    /**
+     * @brief Byte stride of one stream of a layout (0 if the stream does not exist)
+     */
+    uint32 GetStreamStride(EVertexLayout Layout, uint32 Stream);
+
+    /**
+     * @brief Whether stream 0 holds SNorm16 positions relative to the bounds
+     */
+    bool HasQuantizedPositions(EVertexLayout Layout);
+
+    /**
+     * @brief Position-only layout that reads stream 0 of a layout
+     */
+    EVertexLayout GetPositionLayout(EVertexLayout Layout);
+
+    /**
+     * @brief Input elements of a layout (appended to OutElements)
+     */
+    void AppendInputElements(EVertexLayout Layout, std::vector<FRHIInputElement>& OutElements);
+
+    /**
+     * @brief Encode full-precision vertices into the streams of a layout
+     * @param Vertices Source vertices
+     * @param VertexCount Number of vertices
+     * @param Layout Destination layout (not a position-only one)
+     * @param PositionBounds Range for quantized positions (usually the mesh bounds)
+     * @param OutStreams One byte array per stream
+     * @return False for position-only layouts
+     */
+    bool Encode(const FStandardVertex* Vertices, uint32 VertexCount, EVertexLayout Layout,
+                const FBoundingBox& PositionBounds, std::vector<uint8> (&OutStreams)[MaxStreams]);
+
+    /**
+     * @brief Encode full-precision skinned vertices into the streams of the Skinned layout
+     */
+    void EncodeSkinned(const FStandardSkinnedVertex* Vertices, uint32 VertexCount,
+                       std::vector<uint8> (&OutStreams)[MaxStreams]);
+
+    /**
+     * @brief Quantize influence weights to UNorm8 so they sum to exactly 255
+     *
+     * Weights are normalized first; if they sum to zero the first joint gets
+     * the whole weight.
+     */
+    void EncodeSkinInfluences(const uint8 JointIndices[4], const float JointWeights[4], FSkinInfluences& OutInfluences);
+
+    /**
+     * @brief Matrix (row-major, row vectors) that maps quantized positions back to object space
+     */
+    void GetPositionDecodeMatrix(const FBoundingBox& PositionBounds, float OutMatrix[16]);
+
+    // Attribute encoders
+    uint32 PackColorRGBA8(const float Color[4]);
+    void UnpackColorRGBA8(uint32 Packed, float OutColor[4]);
+
+    void EncodeOctahedralNormal(const float Normal[3], int16 OutEncoded[2]);
+    void DecodeOctahedralNormal(const int16 Encoded[2], float OutNormal[3]);
+
+    uint16 FloatToHalf(float Value);
+    float HalfToFloat(uint16 Value);
+
+    int16 QuantizeSNorm16(float Value);
+    float DequantizeSNorm16(int16 Value);
+}
+
+template<>
+struct TVertexDeclaration<FStandardVertex>
+{
+    static constexpr FVertexElementDecl Elements[] =
+    {
+        KE_VERTEX_ELEMENT(FStandardVertex, Position, "POSITION", 0, ERHIFormat::R32G32B32_Float),
+        KE_VERTEX_ELEMENT(FStandardVertex, Color, "COLOR", 0, ERHIFormat::R32G32B32A32_Float),
+        KE_VERTEX_ELEMENT(FStandardVertex, Normal, "NORMAL", 0, ERHIFormat::R32G32B32_Float),
+        KE_VERTEX_ELEMENT(FStandardVertex, TexCoord, "TEXCOORD", 0, ERHIFormat::R32G32_Float),
+    };
+};
+
+template<>
+struct TVertexDeclaration<FCompactVertex>
+{
+    static constexpr FVertexElementDecl Elements[] =
+    {
+        KE_VERTEX_ELEMENT(FCompactVertex, Position, "POSITION", 0, ERHIFormat::R32G32B32_Float),
+        KE_VERTEX_ELEMENT(FCompactVertex, Color, "COLOR", 0, ERHIFormat::R8G8B8A8_UNorm),
+        KE_VERTEX_ELEMENT(FCompactVertex, Normal, "NORMAL", 0, ERHIFormat::R16G16_SNorm),
+        KE_VERTEX_ELEMENT(FCompactVertex, TexCoord, "TEXCOORD", 0, ERHIFormat::R16G16_Float),
+    };
+};
+
+template<>
+struct TVertexDeclaration<FQuantizedVertex>
+{
+    static constexpr FVertexElementDecl Elements[] =
+    {
+        KE_VERTEX_ELEMENT(FQuantizedVertex, Position, "POSITION", 0, ERHIFormat::R16G16B16A16_SNorm),
+        KE_VERTEX_ELEMENT(FQuantizedVertex, Color, "COLOR", 0, ERHIFormat::R8G8B8A8_UNorm),
+        KE_VERTEX_ELEMENT(FQuantizedVertex, Normal, "NORMAL", 0, ERHIFormat::R16G16_SNorm),
+        KE_VERTEX_ELEMENT(FQuantizedVertex, TexCoord, "TEXCOORD", 0, ERHIFormat::R16G16_Float),
+    };
+};
+
+template<>
+struct TVertexDeclaration<FPositionVertex>
+{
+    static constexpr FVertexElementDecl Elements[] =
+    {
+        KE_VERTEX_ELEMENT(FPositionVertex, Position, "POSITION", 0, ERHIFormat::R32G32B32_Float),
+    };
+};
+
+template<>
+struct TVertexDeclaration<FQuantizedPositionVertex>
+{
+    static constexpr FVertexElementDecl Elements[] =
+    {
+        KE_VERTEX_ELEMENT(FQuantizedPositionVertex, Position, "POSITION", 0, ERHIFormat::R16G16B16A16_SNorm),
+    };
+};
+
+template<>
+struct TVertexDeclaration<FPackedVertexAttributes>
+{
+    static constexpr FVertexElementDecl Elements[] =
+    {
+        KE_VERTEX_ELEMENT(FPackedVertexAttributes, Color, "COLOR", 0, ERHIFormat::R8G8B8A8_UNorm),
+        KE_VERTEX_ELEMENT(FPackedVertexAttributes, Normal, "NORMAL", 0, ERHIFormat::R16G16_SNorm),
+        KE_VERTEX_ELEMENT(FPackedVertexAttributes, TexCoord, "TEXCOORD", 0, ERHIFormat::R16G16_Float),
+    };
+};
+
+template<>
+struct TVertexDeclaration<FSkinInfluences>
+{
+    static constexpr FVertexElementDecl Elements[] =
+    {
+        KE_VERTEX_ELEMENT(FSkinInfluences, JointIndices, "BLENDINDICES", 0, ERHIFormat::R8G8B8A8_UInt),
+        KE_VERTEX_ELEMENT(FSkinInfluences, JointWeights, "BLENDWEIGHT", 0, ERHIFormat::R8G8B8A8_UNorm),
+    };
+};
+
+static_assert(VertexFormat::IsValidDeclaration<FStandardVertex>(), "FStandardVertex declaration mismatch");
+static_assert(VertexFormat::IsValidDeclaration<FCompactVertex>(), "FCompactVertex declaration mismatch");
+static_assert(VertexFormat::IsValidDeclaration<FQuantizedVertex>(), "FQuantizedVertex declaration mismatch");
+static_assert(VertexFormat::IsValidDeclaration<FPositionVertex>(), "FPositionVertex declaration mismatch");
+static_assert(VertexFormat::IsValidDeclaration<FQuantizedPositionVertex>(), "FQuantizedPositionVertex declaration mismatch");
+static_assert(VertexFormat::IsValidDeclaration<FPackedVertexAttributes>(), "FPackedVertexAttributes declaration mismatch");
+static_assert(VertexFormat::IsValidDeclaration<FSkinInfluences>(), "FSkinInfluences declaration mismatch");
@@ -0,0 +1,660 @@
+﻿#include "D3D11RHI.h"
+
+// Native handles arrive as const void*; D3D11 binding calls take non-const pointers
+template<typename T>
+static T* ToNative(const void* Handle)
+{
+    return static_cast<T*>(const_cast<void*>(Handle));
+}
+
+void KD3D11CommandContext::SetContext(ID3D11DeviceContext* InContext)
+{
+    Context = InContext;
+    Context1.Reset();
+
+    if (Context)
+    {
+        Context->QueryInterface(IID_PPV_ARGS(&Context1));
+    }
+}
+
+void KD3D11CommandContext::SetInputLayout(const void* InputLayout)
+{
+    Context->IASetInputLayout(ToNative<ID3D11InputLayout>(InputLayout));
+}
+
+void KD3D11CommandContext::SetShader(EShaderType Stage, const void* Shader)
+{
+    switch (Stage)
+    {
+    case EShaderType::Vertex:
+        Context->VSSetShader(ToNative<ID3D11VertexShader>(Shader), nullptr, 0);
+        break;
+    case EShaderType::Pixel:
+        Context->PSSetShader(ToNative<ID3D11PixelShader>(Shader), nullptr, 0);
+        break;
+    case EShaderType::Geometry:
+        Context->GSSetShader(ToNative<ID3D11GeometryShader>(Shader), nullptr, 0);
+        break;
+    case EShaderType::Hull:
+        Context->HSSetShader(ToNative<ID3D11HullShader>(Shader), nullptr, 0);
+        break;
+    case EShaderType::Domain:
+        Context->DSSetShader(ToNative<ID3D11DomainShader>(Shader), nullptr, 0);
+        break;
+    case EShaderType::Compute:
+        Context->CSSetShader(ToNative<ID3D11ComputeShader>(Shader), nullptr, 0);
+        break;
+    }
+}
+
+void KD3D11CommandContext::SetPrimitiveTopology(EPrimitiveTopology Topology)
+{
+    Context->IASetPrimitiveTopology(ToD3D11Topology(Topology));
+}
+
+void KD3D11CommandContext::SetVertexBuffer(uint32 Slot, const void* Buffer, uint32 Stride, uint32 Offset)
+{
+    ID3D11Buffer* NativeBuffer = ToNative<ID3D11Buffer>(Buffer);
+    Context->IASetVertexBuffers(Slot, 1, &NativeBuffer, &Stride, &Offset);
+}
+
+void KD3D11CommandContext::SetIndexBuffer(const void* Buffer, EIndexFormat Format, uint32 Offset)
+{
+    Context->IASetIndexBuffer(ToNative<ID3D11Buffer>(Buffer), ToDXGIFormat(Format), Offset);
+}
+
+void KD3D11CommandContext::SetConstantBuffer(EShaderType Stage, uint32 Slot, const void* Buffer,
+                                             uint32 FirstConstant, uint32 NumConstants)
+{
+    ID3D11Buffer* NativeBuffer = ToNative<ID3D11Buffer>(Buffer);
+
+    if (NumConstants > 0 && Context1)
+    {
+        switch (Stage)
+        {
+        case EShaderType::Vertex:   Context1->VSSetConstantBuffers1(Slot, 1, &NativeBuffer, &FirstConstant, &NumConstants); break;
+        case EShaderType::Pixel:    Context1->PSSetConstantBuffers1(Slot, 1, &NativeBuffer, &FirstConstant, &NumConstants); break;
+        case EShaderType::Geometry: Context1->GSSetConstantBuffers1(Slot, 1, &NativeBuffer, &FirstConstant, &NumConstants); break;
+        case EShaderType::Hull:     Context1->HSSetConstantBuffers1(Slot, 1, &NativeBuffer, &FirstConstant, &NumConstants); break;
+        case EShaderType::Domain:   Context1->DSSetConstantBuffers1(Slot, 1, &NativeBuffer, &FirstConstant, &NumConstants); break;
+        case EShaderType::Compute:  Context1->CSSetConstantBuffers1(Slot, 1, &NativeBuffer, &FirstConstant, &NumConstants); break;
+        }
+        return;
+    }
+
+    switch (Stage)
+    {
+    case EShaderType::Vertex:   Context->VSSetConstantBuffers(Slot, 1, &NativeBuffer); break;
+    case EShaderType::Pixel:    Context->PSSetConstantBuffers(Slot, 1, &NativeBuffer); break;
+    case EShaderType::Geometry: Context->GSSetConstantBuffers(Slot, 1, &NativeBuffer); break;
+    case EShaderType::Hull:     Context->HSSetConstantBuffers(Slot, 1, &NativeBuffer); break;
+    case EShaderType::Domain:   Context->DSSetConstantBuffers(Slot, 1, &NativeBuffer); break;
+    case EShaderType::Compute:  Context->CSSetConstantBuffers(Slot, 1, &NativeBuffer); break;
+    }
+}
+
+void KD3D11CommandContext::SetShaderResource(EShaderType Stage, uint32 Slot, const void* View)
+{
+    ID3D11ShaderResourceView* NativeView = ToNative<ID3D11ShaderResourceView>(View);
+
+    switch (Stage)
+    {
+    case EShaderType::Vertex:   Context->VSSetShaderResources(Slot, 1, &NativeView); break;
+    case EShaderType::Pixel:    Context->PSSetShaderResources(Slot, 1, &NativeView); break;
+    case EShaderType::Geometry: Context->GSSetShaderResources(Slot, 1, &NativeView); break;
+    case EShaderType::Hull:     Context->HSSetShaderResources(Slot, 1, &NativeView); break;
+    case EShaderType::Domain:   Context->DSSetShaderResources(Slot, 1, &NativeView); break;
+    case EShaderType::Compute:  Context->CSSetShaderResources(Slot, 1, &NativeView); break;
+    }
+}
+
+void KD3D11CommandContext::SetSampler(EShaderType Stage, uint32 Slot, const void* Sampler)
+{
+    ID3D11SamplerState* NativeSampler = ToNative<ID3D11SamplerState>(Sampler);
+
+    switch (Stage)
+    {
+    case EShaderType::Vertex:   Context->VSSetSamplers(Slot, 1, &NativeSampler); break;
+    case EShaderType::Pixel:    Context->PSSetSamplers(Slot, 1, &NativeSampler); break;
+    case EShaderType::Geometry: Context->GSSetSamplers(Slot, 1, &NativeSampler); break;
+    case EShaderType::Hull:     Context->HSSetSamplers(Slot, 1, &NativeSampler); break;
+    case EShaderType::Domain:   Context->DSSetSamplers(Slot, 1, &NativeSampler); break;
+    case EShaderType::Compute:  Context->CSSetSamplers(Slot, 1, &NativeSampler); break;
+    }
+}
+
+void KD3D11CommandContext::SetDepthStencilState(const void* State, uint32 StencilRef)
+{
+    Context->OMSetDepthStencilState(ToNative<ID3D11DepthStencilState>(State), StencilRef);
+}
+
+void KD3D11CommandContext::SetViewport(const FViewportRect& Viewport)
+{
+    D3D11_VIEWPORT NativeViewport = {};
+    NativeViewport.TopLeftX = Viewport.TopLeftX;
+    NativeViewport.TopLeftY = Viewport.TopLeftY;
+    NativeViewport.Width = Viewport.Width;
+    NativeViewport.Height = Viewport.Height;
+    NativeViewport.MinDepth = Viewport.MinDepth;
+    NativeViewport.MaxDepth = Viewport.MaxDepth;
+    Context->RSSetViewports(1, &NativeViewport);
+}
+
+void* KD3D11CommandContext::Map(FRHIResource Buffer, ERHIMapMode Mode)
+{
+    D3D11_MAPPED_SUBRESOURCE Mapped = {};
+    HRESULT hr = Context->Map(ToNative<ID3D11Buffer>(Buffer), 0,
+                              Mode == ERHIMapMode::WriteDiscard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE,
+                              0, &Mapped);
+    if (FAILED(hr))
+    {
+        KLogger::HResultError(hr, "Buffer map failed");
+        return nullptr;
+    }
+    return Mapped.pData;
+}
+
+void KD3D11CommandContext::Unmap(FRHIResource Buffer)
+{
+    Context->Unmap(ToNative<ID3D11Buffer>(Buffer), 0);
+}
+
+void KD3D11CommandContext::UpdateBuffer(FRHIResource Buffer, const void* Data, uint32 Size)
+{
+    // Constant buffers cannot be partially updated on feature level 11.0, so the whole buffer is replaced
+    (void)Size;
+    Context->UpdateSubresource(ToNative<ID3D11Buffer>(Buffer), 0, nullptr, Data, 0, 0);
+}
+
+void KD3D11CommandContext::UpdateBufferRegion(FRHIResource Buffer, uint32 Offset, const void* Data, uint32 Size)
+{
+    D3D11_BOX Box = { Offset, 0, 0, Offset + Size, 1, 1 };
+    Context->UpdateSubresource(ToNative<ID3D11Buffer>(Buffer), 0, &Box, Data, 0, 0);
+}
+
+void KD3D11CommandContext::CopyBufferRegion(FRHIResource Destination, uint32 DestinationOffset,
+                                            FRHIResource Source, uint32 SourceOffset, uint32 Size)
+{
+    D3D11_BOX Box = { SourceOffset, 0, 0, SourceOffset + Size, 1, 1 };
+    Context->CopySubresourceRegion(ToNative<ID3D11Buffer>(Destination), 0, DestinationOffset, 0, 0,
+                                   ToNative<ID3D11Buffer>(Source), 0, &Box);
+}
+
+void KD3D11CommandContext::SignalFence(FRHIResource Fence)
+{
+    Context->End(ToNative<ID3D11Query>(Fence));
+}
+
+bool KD3D11CommandContext::IsFenceReached(FRHIResource Fence, bool bWait)
+{
+    ID3D11Query* Query = ToNative<ID3D11Query>(Fence);
+
+    HRESULT hr = Context->GetData(Query, nullptr, 0, bWait ? 0 : D3D11_ASYNC_GETDATA_DONOTFLUSH);
+    while (bWait && hr == S_FALSE)
+    {
+        hr = Context->GetData(Query, nullptr, 0, 0);
+    }
+    return hr == S_OK;
+}
+
+void KD3D11CommandContext::Draw(uint32 VertexCount, uint32 StartVertex)
+{
+    Context->Draw(VertexCount, StartVertex);
+}
+
+void KD3D11CommandContext::DrawIndexed(uint32 IndexCount, uint32 StartIndex, int32 BaseVertex)
+{
+    Context->DrawIndexed(IndexCount, StartIndex, BaseVertex);
+}
+
+void KD3D11CommandContext::DrawInstanced(uint32 VertexCountPerInstance, uint32 InstanceCount,
+                                         uint32 StartVertex, uint32 StartInstance)
+{
+    Context->DrawInstanced(VertexCountPerInstance, InstanceCount, StartVertex, StartInstance);
+}
+
+void KD3D11CommandContext::DrawIndexedInstanced(uint32 IndexCountPerInstance, uint32 InstanceCount,
+                                                uint32 StartIndex, int32 BaseVertex, uint32 StartInstance)
+{
+    Context->DrawIndexedInstanced(IndexCountPerInstance, InstanceCount, StartIndex, BaseVertex, StartInstance);
+}
+
+D3D11_PRIMITIVE_TOPOLOGY KD3D11CommandContext::ToD3D11Topology(EPrimitiveTopology Topology)
+{
+    switch (Topology)
+    {
+    case EPrimitiveTopology::PointList:     return D3D11_PRIMITIVE_TOPOLOGY_POINTLIST;
+    case EPrimitiveTopology::LineList:      return D3D11_PRIMITIVE_TOPOLOGY_LINELIST;
+    case EPrimitiveTopology::LineStrip:     return D3D11_PRIMITIVE_TOPOLOGY_LINESTRIP;
+    case EPrimitiveTopology::TriangleList:  return D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+    case EPrimitiveTopology::TriangleStrip: return D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP;
+    default:                                return D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED;
+    }
+}
+
+DXGI_FORMAT KD3D11CommandContext::ToDXGIFormat(EIndexFormat Format)
+{
+    return Format == EIndexFormat::UInt16 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+}
+
+DXGI_FORMAT KD3D11CommandContext::ToDXGIFormat(ERHIFormat Format)
+{
+    switch (Format)
+    {
+    case ERHIFormat::R32_Float:          return DXGI_FORMAT_R32_FLOAT;
+    case ERHIFormat::R32G32_Float:       return DXGI_FORMAT_R32G32_FLOAT;
+    case ERHIFormat::R32G32B32_Float:    return DXGI_FORMAT_R32G32B32_FLOAT;
+    case ERHIFormat::R32G32B32A32_Float: return DXGI_FORMAT_R32G32B32A32_FLOAT;
+    case ERHIFormat::R16G16_Float:       return DXGI_FORMAT_R16G16_FLOAT;
+    case ERHIFormat::R16G16B16A16_Float: return DXGI_FORMAT_R16G16B16A16_FLOAT;
+    case ERHIFormat::R16G16B16A16_SNorm: return DXGI_FORMAT_R16G16B16A16_SNORM;
+    case ERHIFormat::R16G16B16A16_UNorm: return DXGI_FORMAT_R16G16B16A16_UNORM;
+    case ERHIFormat::R16G16_SNorm:       return DXGI_FORMAT_R16G16_SNORM;
+    case ERHIFormat::R8G8B8A8_UNorm:     return DXGI_FORMAT_R8G8B8A8_UNORM;
+    case ERHIFormat::R8G8B8A8_UInt:      return DXGI_FORMAT_R8G8B8A8_UINT;
+    case ERHIFormat::R16_UInt:           return DXGI_FORMAT_R16_UINT;
+    case ERHIFormat::R32_UInt:           return DXGI_FORMAT_R32_UINT;
+    default:                             return DXGI_FORMAT_UNKNOWN;
+    }
+}
+
+D3D11_COMPARISON_FUNC KD3D11CommandContext::ToD3D11Comparison(ERHIComparison Comparison)
+{
+    switch (Comparison)
+    {
+    case ERHIComparison::Never:        return D3D11_COMPARISON_NEVER;
+    case ERHIComparison::Less:         return D3D11_COMPARISON_LESS;
+    case ERHIComparison::Equal:        return D3D11_COMPARISON_EQUAL;
+    case ERHIComparison::LessEqual:    return D3D11_COMPARISON_LESS_EQUAL;
+    case ERHIComparison::Greater:      return D3D11_COMPARISON_GREATER;
+    case ERHIComparison::NotEqual:     return D3D11_COMPARISON_NOT_EQUAL;
+    case ERHIComparison::GreaterEqual: return D3D11_COMPARISON_GREATER_EQUAL;
+    default:                           return D3D11_COMPARISON_ALWAYS;
+    }
+}
+
+// KD3D11RHIDevice class implementation
+
+KD3D11RHIDevice::KD3D11RHIDevice(ID3D11Device* InDevice, ID3D11DeviceContext* InImmediateContext)
+    : Device(InDevice)
+    , NativeImmediateContext(InImmediateContext)
+    , ImmediateContext(InImmediateContext)
+{
+}
+
+FRHIResource KD3D11RHIDevice::CreateBuffer(const FRHIBufferDesc& Desc, const void* InitialData)
+{
+    D3D11_BUFFER_DESC BufferDesc = {};
+    BufferDesc.ByteWidth = Desc.ByteWidth;
+    BufferDesc.StructureByteStride = Desc.StructureByteStride;
+
+    switch (Desc.Usage)
+    {
+    case ERHIBufferUsage::Immutable:
+        BufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+        break;
+    case ERHIBufferUsage::Dynamic:
+        BufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+        BufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+        break;
+    default:
+        BufferDesc.Usage = D3D11_USAGE_DEFAULT;
+        break;
+    }
+
+    if (Desc.BindFlags & RHIBindFlags::VertexBuffer)   BufferDesc.BindFlags |= D3D11_BIND_VERTEX_BUFFER;
+    if (Desc.BindFlags & RHIBindFlags::IndexBuffer)    BufferDesc.BindFlags |= D3D11_BIND_INDEX_BUFFER;
+    if (Desc.BindFlags & RHIBindFlags::ConstantBuffer) BufferDesc.BindFlags |= D3D11_BIND_CONSTANT_BUFFER;
+    if (Desc.BindFlags & RHIBindFlags::ShaderResource) BufferDesc.BindFlags |= D3D11_BIND_SHADER_RESOURCE;
+
+    if (Desc.StructureByteStride > 0)
+    {
+        BufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+    }
+
+    D3D11_SUBRESOURCE_DATA InitData = {};
+    InitData.pSysMem = InitialData;
+
+    ID3D11Buffer* Buffer = nullptr;
+    HRESULT hr = Device->CreateBuffer(&BufferDesc, InitialData ? &InitData : nullptr, &Buffer);
+    if (FAILED(hr))
+    {
+        KLogger::HResultError(hr, "RHI buffer creation failed");
+        return nullptr;
+    }
+    return Buffer;
+}
+
+FRHIResource KD3D11RHIDevice::CreateTexture2D(const FRHITextureDesc& Desc, const void* InitialData, uint32 RowPitch)
+{
+    D3D11_TEXTURE2D_DESC TextureDesc = {};
+    TextureDesc.Width = Desc.Width;
+    TextureDesc.Height = Desc.Height;
+    TextureDesc.MipLevels = 1;
+    TextureDesc.ArraySize = 1;
+    TextureDesc.Format = KD3D11CommandContext::ToDXGIFormat(Desc.Format);
+    TextureDesc.SampleDesc.Count = 1;
+    TextureDesc.Usage = D3D11_USAGE_DEFAULT;
+    TextureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+    D3D11_SUBRESOURCE_DATA InitData = {};
+    InitData.pSysMem = InitialData;
+    InitData.SysMemPitch = RowPitch;
+
+    ComPtr<ID3D11Texture2D> Texture;
+    HRESULT hr = Device->CreateTexture2D(&TextureDesc, InitialData ? &InitData : nullptr, &Texture);
+    if (FAILED(hr))
+    {
+        KLogger::HResultError(hr, "RHI texture creation failed");
+        return nullptr;
+    }
+
+    // The view keeps the texture alive
+    ID3D11ShaderResourceView* ShaderResourceView = nullptr;
+    hr = Device->CreateShaderResourceView(Texture.Get(), nullptr, &ShaderResourceView);
+    if (FAILED(hr))
+    {
+        KLogger::HResultError(hr, "RHI shader resource view creation failed");
+        return nullptr;
+    }
+    return ShaderResourceView;
+}
+
+FRHIResource KD3D11RHIDevice::CreateShader(EShaderType Type, const void* Bytecode, size_t BytecodeSize)
+{
+    HRESULT hr = E_INVALIDARG;
+    ID3D11DeviceChild* Shader = nullptr;
+
+    switch (Type)
+    {
+    case EShaderType::Vertex:
+        hr = Device->CreateVertexShader(Bytecode, BytecodeSize, nullptr, reinterpret_cast<ID3D11VertexShader**>(&Shader));
+        break;
+    case EShaderType::Pixel:
+        hr = Device->CreatePixelShader(Bytecode, BytecodeSize, nullptr, reinterpret_cast<ID3D11PixelShader**>(&Shader));
+        break;
+    case EShaderType::Geometry:
+        hr = Device->CreateGeometryShader(Bytecode, BytecodeSize, nullptr, reinterpret_cast<ID3D11GeometryShader**>(&Shader));
+        break;
+    case EShaderType::Hull:
+        hr = Device->CreateHullShader(Bytecode, BytecodeSize, nullptr, reinterpret_cast<ID3D11HullShader**>(&Shader));
+        break;
+    case EShaderType::Domain:
+        hr = Device->CreateDomainShader(Bytecode, BytecodeSize, nullptr, reinterpret_cast<ID3D11DomainShader**>(&Shader));
+        break;
+    case EShaderType::Compute:
+        hr = Device->CreateComputeShader(Bytecode, BytecodeSize, nullptr, reinterpret_cast<ID3D11ComputeShader**>(&Shader));
+        break;
+    }
+
+    if (FAILED(hr))
+    {
+        KLogger::HResultError(hr, "RHI shader creation failed");
+        return nullptr;
+    }
+    return Shader;
+}
+
+FRHIResource KD3D11RHIDevice::CreateInputLayout(const FRHIInputElement* Elements, uint32 ElementCount,
+                                                const void* VertexShaderBytecode, size_t BytecodeSize)
+{
+    std::vector<D3D11_INPUT_ELEMENT_DESC> InputElements(ElementCount);
+    for (uint32 i = 0; i < ElementCount; ++i)
+    {
+        const FRHIInputElement& Element = Elements[i];
+        D3D11_INPUT_ELEMENT_DESC& Desc = InputElements[i];
+        Desc.SemanticName = Element.SemanticName;
+        Desc.SemanticIndex = Element.SemanticIndex;
+        Desc.Format = KD3D11CommandContext::ToDXGIFormat(Element.Format);
+        Desc.InputSlot = Element.InputSlot;
+        Desc.AlignedByteOffset = Element.AlignedByteOffset;
+        Desc.InputSlotClass = Element.bPerInstance ? D3D11_INPUT_PER_INSTANCE_DATA : D3D11_INPUT_PER_VERTEX_DATA;
+        Desc.InstanceDataStepRate = Element.bPerInstance ? Element.InstanceStepRate : 0;
+    }
+
+    ID3D11InputLayout* InputLayout = nullptr;
+    HRESULT hr = Device->CreateInputLayout(InputElements.data(), ElementCount,
+                                           VertexShaderBytecode, BytecodeSize, &InputLayout);
+    if (FAILED(hr))
+    {
+        KLogger::HResultError(hr, "RHI input layout creation failed");
+        return nullptr;
+    }
+    return InputLayout;
+}
+
+FRHIResource KD3D11RHIDevice::CreateSampler(const FRHISamplerDesc& Desc)
+{
+    const D3D11_TEXTURE_ADDRESS_MODE AddressMode =
+        Desc.AddressMode == ERHIAddressMode::Clamp ? D3D11_TEXTURE_ADDRESS_CLAMP : D3D11_TEXTURE_ADDRESS_WRAP;
+
+    D3D11_SAMPLER_DESC SamplerDesc = {};
+    SamplerDesc.Filter = Desc.Filter == ERHIFilter::Point ? D3D11_FILTER_MIN_MAG_MIP_POINT : D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+    SamplerDesc.AddressU = AddressMode;
+    SamplerDesc.AddressV = AddressMode;
+    SamplerDesc.AddressW = AddressMode;
+    SamplerDesc.MaxAnisotropy = 1;
+    SamplerDesc.ComparisonFunc = D3D11_COMPARISON_ALWAYS;
+    SamplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+
+    ID3D11SamplerState* Sampler = nullptr;
+    HRESULT hr = Device->CreateSamplerState(&SamplerDesc, &Sampler);
+    if (FAILED(hr))
+    {
+        KLogger::HResultError(hr, "RHI sampler creation failed");
+        return nullptr;
+    }
+    return Sampler;
+}
+
+FRHIResource KD3D11RHIDevice::CreateDepthStencilState(const FRHIDepthStencilDesc& Desc)
+{
+    D3D11_DEPTH_STENCIL_DESC DepthDesc = {};
+    DepthDesc.DepthEnable = Desc.bDepthEnable ? TRUE : FALSE;
+    DepthDesc.DepthWriteMask = Desc.bDepthWrite ? D3D11_DEPTH_WRITE_MASK_ALL : D3D11_DEPTH_WRITE_MASK_ZERO;
+    DepthDesc.DepthFunc = KD3D11CommandContext::ToD3D11Comparison(Desc.DepthFunc);
+
+    ID3D11DepthStencilState* State = nullptr;
+    HRESULT hr = Device->CreateDepthStencilState(&DepthDesc, &State);
+    if (FAILED(hr))
+    {
+        KLogger::HResultError(hr, "RHI depth stencil state creation failed");
+        return nullptr;
+    }
+    return State;
+}
+
+FRHIResource KD3D11RHIDevice::CreateFence()
+{
+    D3D11_QUERY_DESC QueryDesc = {};
+    QueryDesc.Query = D3D11_QUERY_EVENT;
+
+    ID3D11Query* Query = nullptr;
+    HRESULT hr = Device->CreateQuery(&QueryDesc, &Query);
+    if (FAILED(hr))
+    {
+        KLogger::HResultError(hr, "RHI fence creation failed");
+        return nullptr;
+    }
+    return Query;
+}
+
+bool KD3D11RHIDevice::CompileShader(EShaderType Type, const std::string& Source, const std::string& SourceName,
+                                    const std::string& EntryPoint, std::vector<uint8>& OutBytecode,
+                                    std::string& OutErrors)
+{
+    const char* Profile = "vs_4_0";
+    switch (Type)
+    {
+    case EShaderType::Vertex:   Profile = "vs_4_0"; break;
+    case EShaderType::Pixel:    Profile = "ps_4_0"; break;
+    case EShaderType::Geometry: Profile = "gs_4_0"; break;
+    case EShaderType::Hull:     Profile = "hs_5_0"; break;
+    case EShaderType::Domain:   Profile = "ds_5_0"; break;
+    case EShaderType::Compute:  Profile = "cs_4_0"; break;
+    }
+
+    DWORD ShaderFlags = D3DCOMPILE_ENABLE_STRICTNESS;
+#ifdef _DEBUG
+    ShaderFlags |= D3DCOMPILE_DEBUG;
+    ShaderFlags |= D3DCOMPILE_SKIP_OPTIMIZATION;
+#endif
+
+    // Includes of file sources resolve relative to the file
+    ComPtr<ID3DBlob> Blob;
+    ComPtr<ID3DBlob> ErrorBlob;
+    HRESULT hr = D3DCompile(
+        Source.c_str(),
+        Source.length(),
+        SourceName.empty() ? nullptr : SourceName.c_str(),
+        nullptr,
+        SourceName.empty() ? nullptr : D3D_COMPILE_STANDARD_FILE_INCLUDE,
+        EntryPoint.c_str(),
+        Profile,
+        ShaderFlags,
+        0,
+        &Blob,
+        &ErrorBlob
+    );
+
+    OutErrors.clear();
+    if (ErrorBlob)
+    {
+        OutErrors.assign(static_cast<const char*>(ErrorBlob->GetBufferPointer()), ErrorBlob->GetBufferSize());
+    }
+    if (FAILED(hr))
+    {
+        return false;
+    }
+
+    const uint8* Bytes = static_cast<const uint8*>(Blob->GetBufferPointer());
+    OutBytecode.assign(Bytes, Bytes + Blob->GetBufferSize());
+    return true;
+}
+
+bool KD3D11RHIDevice::SupportsConstantBufferRanges() const
+{
+    D3D11_FEATURE_DATA_D3D11_OPTIONS Options = {};
+    HRESULT hr = Device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &Options, sizeof(Options));
+    return SUCCEEDED(hr) && Options.ConstantBufferOffsetting && Options.MapNoOverwriteOnDynamicConstantBuffer;
+}
+
+void KD3D11RHIDevice::ReleaseResource(FRHIResource Resource)
+{
+    if (Resource)
+    {
+        ToNative<IUnknown>(Resource)->Release();
+    }
+}
+
+IRHICommandContext* KD3D11RHIDevice::CreateDeferredContext()
+{
+    auto Deferred = std::make_unique<FDeferredContext>();
+
+    HRESULT hr = Device->CreateDeferredContext(0, &Deferred->NativeContext);
+    if (FAILED(hr))
+    {
+        KLogger::HResultError(hr, "Deferred context creation failed");
+        return nullptr;
+    }
+    Deferred->Context.SetContext(Deferred->NativeContext.Get());
+
+    DeferredContexts.push_back(std::move(Deferred));
+    return &DeferredContexts.back()->Context;
+}
+
+void KD3D11RHIDevice::DestroyDeferredContext(IRHICommandContext* Context)
+{
+    for (auto It = DeferredContexts.begin(); It != DeferredContexts.end(); ++It)
+    {
+        if (&(*It)->Context == Context)
+        {
+            DeferredContexts.erase(It);
+            return;
+        }
+    }
+}
+
+FRHIResource KD3D11RHIDevice::CaptureOutputState()
+{
+    CapturedOutputState.Capture(ImmediateContext.GetContext());
+    return &CapturedOutputState;
+}
+
+void KD3D11RHIDevice::BeginCommandList(IRHICommandContext* DeferredContext, FRHIResource OutputState)
+{
+    ID3D11DeviceContext* NativeContext = GetNativeContext(DeferredContext);
+    NativeContext->ClearState();
+
+    if (OutputState)
+    {
+        static_cast<const FOutputState*>(OutputState)->Apply(NativeContext);
+    }
+}
+
+FRHIResource KD3D11RHIDevice::FinishCommandList(IRHICommandContext* DeferredContext)
+{
+    ID3D11CommandList* CommandList = nullptr;
+    HRESULT hr = GetNativeContext(DeferredContext)->FinishCommandList(FALSE, &CommandList);
+    if (FAILED(hr))
+    {
+        KLogger::HResultError(hr, "Command list recording failed");
+        return nullptr;
+    }
+    return CommandList;
+}
+
+void KD3D11RHIDevice::ExecuteCommandList(FRHIResource CommandList)
+{
+    if (!CommandList)
+    {
+        return;
+    }
+
+    // Executing without restoring state clears the immediate context; only
+    // the output bindings are put back, everything else is re-bound by the caller
+    ID3D11DeviceContext* NativeContext = ImmediateContext.GetContext();
+
+    FOutputState OutputState;
+    OutputState.Capture(NativeContext);
+    NativeContext->ExecuteCommandList(ToNative<ID3D11CommandList>(CommandList), FALSE);
+    OutputState.Apply(NativeContext);
+}
+
+ID3D11DeviceContext* KD3D11RHIDevice::GetNativeContext(IRHICommandContext* Context)
+{
+    return static_cast<KD3D11CommandContext*>(Context)->GetContext();
+}
+
+void KD3D11RHIDevice::FOutputState::Capture(ID3D11DeviceContext* Context)
+{
+    ID3D11RenderTargetView* Views[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT] = {};
+    ID3D11DepthStencilView* DepthView = nullptr;
+    Context->OMGetRenderTargets(D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT, Views, &DepthView);
+
+    // Take ownership of the references added by OMGetRenderTargets
+    for (UINT i = 0; i < D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT; ++i)
+    {
+        RenderTargets[i].Attach(Views[i]);
+    }
+    DepthStencil.Attach(DepthView);
+
+    ViewportCount = D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE;
+    Context->RSGetViewports(&ViewportCount, Viewports);
+}
+
+void KD3D11RHIDevice::FOutputState::Apply(ID3D11DeviceContext* Context) const
+{
+    ID3D11RenderTargetView* Views[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT] = {};
+    for (UINT i = 0; i < D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT; ++i)
+    {
+        Views[i] = RenderTargets[i].Get();
+    }
+    Context->OMSetRenderTargets(D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT, Views, DepthStencil.Get());
+
+    if (ViewportCount > 0)
+    {
+        Context->RSSetViewports(ViewportCount, Viewports);
+    }
+}
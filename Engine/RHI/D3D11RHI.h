@@ -0,0 +1,149 @@
+﻿#pragma once
+
+#include "../Utils/Common.h"
+#include "../Utils/Logger.h"
+#include "RHI.h"
+
+/**
+ * @brief DirectX 11 command context
+ *
+ * Forwards state changes (usually filtered by KRenderStateCache) and draw
+ * commands to a device context.
+ */
+class KD3D11CommandContext : public IRHICommandContext
+{
+public:
+    KD3D11CommandContext() = default;
+    explicit KD3D11CommandContext(ID3D11DeviceContext* InContext) { SetContext(InContext); }
+
+    void SetContext(ID3D11DeviceContext* InContext);
+    ID3D11DeviceContext* GetContext() const { return Context; }
+
+    void SetInputLayout(const void* InputLayout) override;
+    void SetShader(EShaderType Stage, const void* Shader) override;
+    void SetPrimitiveTopology(EPrimitiveTopology Topology) override;
+    void SetVertexBuffer(uint32 Slot, const void* Buffer, uint32 Stride, uint32 Offset) override;
+    void SetIndexBuffer(const void* Buffer, EIndexFormat Format, uint32 Offset) override;
+    void SetConstantBuffer(EShaderType Stage, uint32 Slot, const void* Buffer,
+                           uint32 FirstConstant, uint32 NumConstants) override;
+    void SetShaderResource(EShaderType Stage, uint32 Slot, const void* View) override;
+    void SetSampler(EShaderType Stage, uint32 Slot, const void* Sampler) override;
+    void SetDepthStencilState(const void* State, uint32 StencilRef) override;
+    void SetViewport(const FViewportRect& Viewport) override;
+
+    void* Map(FRHIResource Buffer, ERHIMapMode Mode) override;
+    void Unmap(FRHIResource Buffer) override;
+    void UpdateBuffer(FRHIResource Buffer, const void* Data, uint32 Size) override;
+    void UpdateBufferRegion(FRHIResource Buffer, uint32 Offset, const void* Data, uint32 Size) override;
+    void CopyBufferRegion(FRHIResource Destination, uint32 DestinationOffset,
+                          FRHIResource Source, uint32 SourceOffset, uint32 Size) override;
+    void SignalFence(FRHIResource Fence) override;
+    bool IsFenceReached(FRHIResource Fence, bool bWait) override;
+
+    void Draw(uint32 VertexCount, uint32 StartVertex) override;
+    void DrawIndexed(uint32 IndexCount, uint32 StartIndex, int32 BaseVertex) override;
+    void DrawInstanced(uint32 VertexCountPerInstance, uint32 InstanceCount,
+                       uint32 StartVertex, uint32 StartInstance) override;
+    void DrawIndexedInstanced(uint32 IndexCountPerInstance, uint32 InstanceCount,
+                              uint32 StartIndex, int32 BaseVertex, uint32 StartInstance) override;
+
+    /**
+     * @brief Convert engine topology to D3D11 topology
+     */
+    static D3D11_PRIMITIVE_TOPOLOGY ToD3D11Topology(EPrimitiveTopology Topology);
+
+    /**
+     * @brief Convert engine index format to DXGI format
+     */
+    static DXGI_FORMAT ToDXGIFormat(EIndexFormat Format);
+
+    /**
+     * @brief Convert RHI format to DXGI format
+     */
+    static DXGI_FORMAT ToDXGIFormat(ERHIFormat Format);
+
+    /**
+     * @brief Convert RHI comparison to D3D11 comparison
+     */
+    static D3D11_COMPARISON_FUNC ToD3D11Comparison(ERHIComparison Comparison);
+
+private:
+    ID3D11DeviceContext* Context = nullptr;
+    ComPtr<ID3D11DeviceContext1> Context1;  // Required for binding constant buffer ranges
+};
+
+/**
+ * @brief DirectX 11 render hardware interface device
+ * 
+ * Wraps an existing device and immediate context; handles are ID3D11* objects.
+ */
+class KD3D11RHIDevice : public IRHIDevice
+{
+public:
+    KD3D11RHIDevice(ID3D11Device* InDevice, ID3D11DeviceContext* InImmediateContext);
+    ~KD3D11RHIDevice() override = default;
+
+    // Prevent copying
+    KD3D11RHIDevice(const KD3D11RHIDevice&) = delete;
+    KD3D11RHIDevice& operator=(const KD3D11RHIDevice&) = delete;
+
+    FRHIResource CreateBuffer(const FRHIBufferDesc& Desc, const void* InitialData) override;
+    FRHIResource CreateTexture2D(const FRHITextureDesc& Desc, const void* InitialData, uint32 RowPitch) override;
+    FRHIResource CreateShader(EShaderType Type, const void* Bytecode, size_t BytecodeSize) override;
+    FRHIResource CreateInputLayout(const FRHIInputElement* Elements, uint32 ElementCount,
+                                   const void* VertexShaderBytecode, size_t BytecodeSize) override;
+    FRHIResource CreateSampler(const FRHISamplerDesc& Desc) override;
+    FRHIResource CreateDepthStencilState(const FRHIDepthStencilDesc& Desc) override;
+    FRHIResource CreateFence() override;
+    void ReleaseResource(FRHIResource Resource) override;
+
+    bool CompileShader(EShaderType Type, const std::string& Source, const std::string& SourceName,
+                       const std::string& EntryPoint, std::vector<uint8>& OutBytecode,
+                       std::string& OutErrors) override;
+    bool SupportsConstantBufferRanges() const override;
+
+    IRHICommandContext* GetImmediateContext() override { return &ImmediateContext; }
+
+    IRHICommandContext* CreateDeferredContext() override;
+    void DestroyDeferredContext(IRHICommandContext* Context) override;
+    FRHIResource CaptureOutputState() override;
+    void BeginCommandList(IRHICommandContext* DeferredContext, FRHIResource OutputState) override;
+    FRHIResource FinishCommandList(IRHICommandContext* DeferredContext) override;
+    void ExecuteCommandList(FRHIResource CommandList) override;
+
+    ID3D11Device* GetDevice() const { return Device.Get(); }
+
+private:
+    /**
+     * @brief Render targets and viewports, carried over to deferred contexts
+     */
+    struct FOutputState
+    {
+        ComPtr<ID3D11RenderTargetView> RenderTargets[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT];
+        ComPtr<ID3D11DepthStencilView> DepthStencil;
+        D3D11_VIEWPORT Viewports[D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE];
+        UINT ViewportCount = 0;
+
+        void Capture(ID3D11DeviceContext* Context);
+        void Apply(ID3D11DeviceContext* Context) const;
+    };
+
+    /**
+     * @brief Deferred context and the command context wrapping it
+     */
+    struct FDeferredContext
+    {
+        ComPtr<ID3D11DeviceContext> NativeContext;
+        KD3D11CommandContext Context;
+    };
+
+    static ID3D11DeviceContext* GetNativeContext(IRHICommandContext* Context);
+
+private:
+    // Referenced, so the device stays usable while resources outlive KGraphicsDevice
+    ComPtr<ID3D11Device> Device;
+    ComPtr<ID3D11DeviceContext> NativeImmediateContext;
+    KD3D11CommandContext ImmediateContext;
+    std::vector<std::unique_ptr<FDeferredContext>> DeferredContexts;
+    FOutputState CapturedOutputState;
+};
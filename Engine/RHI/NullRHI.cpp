@@ -0,0 +1,638 @@
+﻿#include "NullRHI.h"
+
+#include <cstring>
+#include <sstream>
+
+namespace
+{
+    /**
+     * @brief Backing object for every null resource handle
+     */
+    struct FNullResource
+    {
+        std::vector<uint8> Storage;
+    };
+
+    uint64 CountPrimitives(EPrimitiveTopology Topology, uint64 VertexCount)
+    {
+        switch (Topology)
+        {
+        case EPrimitiveTopology::PointList:     return VertexCount;
+        case EPrimitiveTopology::LineList:      return VertexCount / 2;
+        case EPrimitiveTopology::LineStrip:     return VertexCount > 1 ? VertexCount - 1 : 0;
+        case EPrimitiveTopology::TriangleList:  return VertexCount / 3;
+        case EPrimitiveTopology::TriangleStrip: return VertexCount > 2 ? VertexCount - 2 : 0;
+        default:                                return 0;
+        }
+    }
+
+    // Argument layout of each command in the recorded stream, used for decoding
+    enum class EArg : uint8 { Handle, U32, I32, U8, F32 };
+
+    struct FCommandLayout
+    {
+        const char* Name;
+        EArg Args[6];
+        uint32 ArgCount;
+    };
+
+    const FCommandLayout CommandLayouts[NullRHICommandCount] =
+    {
+        { "SetInputLayout",       { EArg::Handle }, 1 },
+        { "SetShader",            { EArg::U8, EArg::Handle }, 2 },
+        { "SetPrimitiveTopology", { EArg::U8 }, 1 },
+        { "SetVertexBuffer",      { EArg::U32, EArg::Handle, EArg::U32, EArg::U32 }, 4 },
+        { "SetIndexBuffer",       { EArg::Handle, EArg::U8, EArg::U32 }, 3 },
+        { "SetConstantBuffer",    { EArg::U8, EArg::U32, EArg::Handle, EArg::U32, EArg::U32 }, 5 },
+        { "SetShaderResource",    { EArg::U8, EArg::U32, EArg::Handle }, 3 },
+        { "SetSampler",           { EArg::U8, EArg::U32, EArg::Handle }, 3 },
+        { "SetDepthStencilState", { EArg::Handle, EArg::U32 }, 2 },
+        { "SetViewport",          { EArg::F32, EArg::F32, EArg::F32, EArg::F32, EArg::F32, EArg::F32 }, 6 },
+        { "Map",                  { EArg::Handle, EArg::U8 }, 2 },
+        { "Unmap",                { EArg::Handle }, 1 },
+        { "UpdateBuffer",         { EArg::Handle, EArg::U32 }, 2 },
+        { "Draw",                 { EArg::U32, EArg::U32 }, 2 },
+        { "DrawIndexed",          { EArg::U32, EArg::U32, EArg::I32 }, 3 },
+        { "DrawInstanced",        { EArg::U32, EArg::U32, EArg::U32, EArg::U32 }, 4 },
+        { "DrawIndexedInstanced", { EArg::U32, EArg::U32, EArg::U32, EArg::I32, EArg::U32 }, 5 },
+        { "UpdateBufferRegion",   { EArg::Handle, EArg::U32, EArg::U32 }, 3 },
+        { "CopyBufferRegion",     { EArg::Handle, EArg::U32, EArg::Handle, EArg::U32, EArg::U32 }, 5 },
+        { "SignalFence",          { EArg::Handle }, 1 },
+    };
+
+    struct FDecodedCommand
+    {
+        ENullRHICommand Command = ENullRHICommand::Count;
+        uint64 Args[6] = {};
+    };
+
+    /**
+     * @brief Read one command from a recorded stream and advance the cursor
+     * @return false on a truncated stream or unknown opcode
+     */
+    bool DecodeCommand(const uint8* Data, size_t Size, size_t& Cursor, FDecodedCommand& OutCommand)
+    {
+        if (Cursor >= Size || Data[Cursor] >= NullRHICommandCount)
+        {
+            return false;
+        }
+
+        const uint8 Opcode = Data[Cursor++];
+        const FCommandLayout& Layout = CommandLayouts[Opcode];
+        OutCommand.Command = static_cast<ENullRHICommand>(Opcode);
+
+        for (uint32 i = 0; i < Layout.ArgCount; ++i)
+        {
+            size_t ArgSize = 0;
+            switch (Layout.Args[i])
+            {
+            case EArg::Handle: ArgSize = sizeof(const void*); break;
+            case EArg::U32:    ArgSize = sizeof(uint32); break;
+            case EArg::I32:    ArgSize = sizeof(int32); break;
+            case EArg::U8:     ArgSize = sizeof(uint8); break;
+            case EArg::F32:    ArgSize = sizeof(float); break;
+            }
+
+            if (Cursor + ArgSize > Size)
+            {
+                return false;
+            }
+
+            // Little-endian host assumed; values are zero-extended, I32 is cast back by the reader
+            uint64 Value = 0;
+            memcpy(&Value, Data + Cursor, ArgSize);
+            OutCommand.Args[i] = Value;
+            Cursor += ArgSize;
+        }
+        return true;
+    }
+}
+
+// KNullCommandContext class implementation
+
+void KNullCommandContext::SetInputLayout(const void* InputLayout)
+{
+    BeginCommand(ENullRHICommand::SetInputLayout);
+    Write(InputLayout);
+}
+
+void KNullCommandContext::SetShader(EShaderType Stage, const void* Shader)
+{
+    BeginCommand(ENullRHICommand::SetShader);
+    Write(static_cast<uint8>(Stage));
+    Write(Shader);
+}
+
+void KNullCommandContext::SetPrimitiveTopology(EPrimitiveTopology Topology)
+{
+    CurrentTopology = Topology;
+
+    BeginCommand(ENullRHICommand::SetPrimitiveTopology);
+    Write(static_cast<uint8>(Topology));
+}
+
+void KNullCommandContext::SetVertexBuffer(uint32 Slot, const void* Buffer, uint32 Stride, uint32 Offset)
+{
+    BeginCommand(ENullRHICommand::SetVertexBuffer);
+    Write(Slot);
+    Write(Buffer);
+    Write(Stride);
+    Write(Offset);
+}
+
+void KNullCommandContext::SetIndexBuffer(const void* Buffer, EIndexFormat Format, uint32 Offset)
+{
+    BeginCommand(ENullRHICommand::SetIndexBuffer);
+    Write(Buffer);
+    Write(static_cast<uint8>(Format));
+    Write(Offset);
+}
+
+void KNullCommandContext::SetConstantBuffer(EShaderType Stage, uint32 Slot, const void* Buffer,
+                                            uint32 FirstConstant, uint32 NumConstants)
+{
+    BeginCommand(ENullRHICommand::SetConstantBuffer);
+    Write(static_cast<uint8>(Stage));
+    Write(Slot);
+    Write(Buffer);
+    Write(FirstConstant);
+    Write(NumConstants);
+}
+
+void KNullCommandContext::SetShaderResource(EShaderType Stage, uint32 Slot, const void* View)
+{
+    BeginCommand(ENullRHICommand::SetShaderResource);
+    Write(static_cast<uint8>(Stage));
+    Write(Slot);
+    Write(View);
+}
+
+void KNullCommandContext::SetSampler(EShaderType Stage, uint32 Slot, const void* Sampler)
+{
+    BeginCommand(ENullRHICommand::SetSampler);
+    Write(static_cast<uint8>(Stage));
+    Write(Slot);
+    Write(Sampler);
+}
+
+void KNullCommandContext::SetDepthStencilState(const void* State, uint32 StencilRef)
+{
+    BeginCommand(ENullRHICommand::SetDepthStencilState);
+    Write(State);
+    Write(StencilRef);
+}
+
+void KNullCommandContext::SetViewport(const FViewportRect& Viewport)
+{
+    BeginCommand(ENullRHICommand::SetViewport);
+    Write(Viewport.TopLeftX);
+    Write(Viewport.TopLeftY);
+    Write(Viewport.Width);
+    Write(Viewport.Height);
+    Write(Viewport.MinDepth);
+    Write(Viewport.MaxDepth);
+}
+
+void* KNullCommandContext::Map(FRHIResource Buffer, ERHIMapMode Mode)
+{
+    BeginCommand(ENullRHICommand::Map);
+    Write(Buffer);
+    Write(static_cast<uint8>(Mode));
+
+    return KNullRHIDevice::GetStorage(Buffer);
+}
+
+void KNullCommandContext::Unmap(FRHIResource Buffer)
+{
+    BeginCommand(ENullRHICommand::Unmap);
+    Write(Buffer);
+}
+
+void KNullCommandContext::UpdateBuffer(FRHIResource Buffer, const void* Data, uint32 Size)
+{
+    BeginCommand(ENullRHICommand::UpdateBuffer);
+    Write(Buffer);
+    Write(Size);
+
+    uint8* Storage = KNullRHIDevice::GetStorage(Buffer);
+    if (Storage && Data && Size <= KNullRHIDevice::GetStorageSize(Buffer))
+    {
+        memcpy(Storage, Data, Size);
+    }
+}
+
+void KNullCommandContext::UpdateBufferRegion(FRHIResource Buffer, uint32 Offset, const void* Data, uint32 Size)
+{
+    BeginCommand(ENullRHICommand::UpdateBufferRegion);
+    Write(Buffer);
+    Write(Offset);
+    Write(Size);
+
+    uint8* Storage = KNullRHIDevice::GetStorage(Buffer);
+    if (Storage && Data && static_cast<size_t>(Offset) + Size <= KNullRHIDevice::GetStorageSize(Buffer))
+    {
+        memcpy(Storage + Offset, Data, Size);
+    }
+}
+
+void KNullCommandContext::CopyBufferRegion(FRHIResource Destination, uint32 DestinationOffset,
+                                           FRHIResource Source, uint32 SourceOffset, uint32 Size)
+{
+    BeginCommand(ENullRHICommand::CopyBufferRegion);
+    Write(Destination);
+    Write(DestinationOffset);
+    Write(Source);
+    Write(SourceOffset);
+    Write(Size);
+
+    // Copied when issued; a replayed copy repeats it
+    uint8* DestinationStorage = KNullRHIDevice::GetStorage(Destination);
+    const uint8* SourceStorage = KNullRHIDevice::GetStorage(Source);
+    if (DestinationStorage && SourceStorage && Destination != Source &&
+        static_cast<size_t>(DestinationOffset) + Size <= KNullRHIDevice::GetStorageSize(Destination) &&
+        static_cast<size_t>(SourceOffset) + Size <= KNullRHIDevice::GetStorageSize(Source))
+    {
+        memcpy(DestinationStorage + DestinationOffset, SourceStorage + SourceOffset, Size);
+    }
+}
+
+void KNullCommandContext::SignalFence(FRHIResource Fence)
+{
+    BeginCommand(ENullRHICommand::SignalFence);
+    Write(Fence);
+}
+
+void KNullCommandContext::Draw(uint32 VertexCount, uint32 StartVertex)
+{
+    PrimitiveCount += CountPrimitives(CurrentTopology, VertexCount);
+
+    BeginCommand(ENullRHICommand::Draw);
+    Write(VertexCount);
+    Write(StartVertex);
+}
+
+void KNullCommandContext::DrawIndexed(uint32 IndexCount, uint32 StartIndex, int32 BaseVertex)
+{
+    PrimitiveCount += CountPrimitives(CurrentTopology, IndexCount);
+
+    BeginCommand(ENullRHICommand::DrawIndexed);
+    Write(IndexCount);
+    Write(StartIndex);
+    Write(BaseVertex);
+}
+
+void KNullCommandContext::DrawInstanced(uint32 VertexCountPerInstance, uint32 InstanceCount,
+                                        uint32 StartVertex, uint32 StartInstance)
+{
+    PrimitiveCount += CountPrimitives(CurrentTopology, VertexCountPerInstance) * InstanceCount;
+
+    BeginCommand(ENullRHICommand::DrawInstanced);
+    Write(VertexCountPerInstance);
+    Write(InstanceCount);
+    Write(StartVertex);
+    Write(StartInstance);
+}
+
+void KNullCommandContext::DrawIndexedInstanced(uint32 IndexCountPerInstance, uint32 InstanceCount,
+                                               uint32 StartIndex, int32 BaseVertex, uint32 StartInstance)
+{
+    PrimitiveCount += CountPrimitives(CurrentTopology, IndexCountPerInstance) * InstanceCount;
+
+    BeginCommand(ENullRHICommand::DrawIndexedInstanced);
+    Write(IndexCountPerInstance);
+    Write(InstanceCount);
+    Write(StartIndex);
+    Write(BaseVertex);
+    Write(StartInstance);
+}
+
+void KNullCommandContext::Reset()
+{
+    for (uint64& Count : CommandCounts)
+    {
+        Count = 0;
+    }
+    PrimitiveCount = 0;
+    CurrentTopology = EPrimitiveTopology::Undefined;
+    Stream.clear();
+}
+
+uint64 KNullCommandContext::GetTotalCommandCount() const
+{
+    uint64 Total = 0;
+    for (uint64 Count : CommandCounts)
+    {
+        Total += Count;
+    }
+    return Total;
+}
+
+uint64 KNullCommandContext::GetDrawCallCount() const
+{
+    return GetCommandCount(ENullRHICommand::Draw) +
+           GetCommandCount(ENullRHICommand::DrawIndexed) +
+           GetCommandCount(ENullRHICommand::DrawInstanced) +
+           GetCommandCount(ENullRHICommand::DrawIndexedInstanced);
+}
+
+std::string KNullCommandContext::DumpRecordedStream() const
+{
+    std::ostringstream Out;
+    size_t Cursor = 0;
+    FDecodedCommand Command;
+
+    while (Cursor < Stream.size())
+    {
+        if (!DecodeCommand(Stream.data(), Stream.size(), Cursor, Command))
+        {
+            Out << "<invalid command at " << Cursor << ">\n";
+            break;
+        }
+
+        const FCommandLayout& Layout = CommandLayouts[static_cast<uint32>(Command.Command)];
+        Out << Layout.Name;
+
+        for (uint32 i = 0; i < Layout.ArgCount; ++i)
+        {
+            Out << (i == 0 ? " " : ", ");
+            switch (Layout.Args[i])
+            {
+            case EArg::Handle: Out << reinterpret_cast<const void*>(static_cast<uintptr_t>(Command.Args[i])); break;
+            case EArg::I32:    Out << static_cast<int32>(Command.Args[i]); break;
+            case EArg::F32:
+            {
+                float Value;
+                uint32 Bits = static_cast<uint32>(Command.Args[i]);
+                memcpy(&Value, &Bits, sizeof(Value));
+                Out << Value;
+                break;
+            }
+            default:           Out << Command.Args[i]; break;
+            }
+        }
+        Out << '\n';
+    }
+
+    return Out.str();
+}
+
+bool KNullCommandContext::Replay(const uint8* Data, size_t Size)
+{
+    size_t Cursor = 0;
+    FDecodedCommand Command;
+
+    while (Cursor < Size)
+    {
+        if (!DecodeCommand(Data, Size, Cursor, Command))
+        {
+            return false;
+        }
+
+        const uint64* Args = Command.Args;
+        auto Handle = [](uint64 Value) { return reinterpret_cast<const void*>(static_cast<uintptr_t>(Value)); };
+        auto U32 = [](uint64 Value) { return static_cast<uint32>(Value); };
+        auto I32 = [](uint64 Value) { return static_cast<int32>(Value); };
+        auto Stage = [](uint64 Value) { return static_cast<EShaderType>(Value); };
+        auto F32 = [](uint64 Value)
+        {
+            const uint32 Bits = static_cast<uint32>(Value);
+            float Result;
+            memcpy(&Result, &Bits, sizeof(Result));
+            return Result;
+        };
+
+        switch (Command.Command)
+        {
+        case ENullRHICommand::SetInputLayout:       SetInputLayout(Handle(Args[0])); break;
+        case ENullRHICommand::SetShader:            SetShader(Stage(Args[0]), Handle(Args[1])); break;
+        case ENullRHICommand::SetPrimitiveTopology: SetPrimitiveTopology(static_cast<EPrimitiveTopology>(Args[0])); break;
+        case ENullRHICommand::SetVertexBuffer:      SetVertexBuffer(U32(Args[0]), Handle(Args[1]), U32(Args[2]), U32(Args[3])); break;
+        case ENullRHICommand::SetIndexBuffer:       SetIndexBuffer(Handle(Args[0]), static_cast<EIndexFormat>(Args[1]), U32(Args[2])); break;
+        case ENullRHICommand::SetConstantBuffer:    SetConstantBuffer(Stage(Args[0]), U32(Args[1]), Handle(Args[2]), U32(Args[3]), U32(Args[4])); break;
+        case ENullRHICommand::SetShaderResource:    SetShaderResource(Stage(Args[0]), U32(Args[1]), Handle(Args[2])); break;
+        case ENullRHICommand::SetSampler:           SetSampler(Stage(Args[0]), U32(Args[1]), Handle(Args[2])); break;
+        case ENullRHICommand::SetDepthStencilState: SetDepthStencilState(Handle(Args[0]), U32(Args[1])); break;
+        case ENullRHICommand::SetViewport:
+            SetViewport({ F32(Args[0]), F32(Args[1]), F32(Args[2]), F32(Args[3]), F32(Args[4]), F32(Args[5]) });
+            break;
+        case ENullRHICommand::Map:                  Map(Handle(Args[0]), static_cast<ERHIMapMode>(Args[1])); break;
+        case ENullRHICommand::Unmap:                Unmap(Handle(Args[0])); break;
+        // Buffer contents were written when the command was recorded
+        case ENullRHICommand::UpdateBuffer:         UpdateBuffer(Handle(Args[0]), nullptr, U32(Args[1])); break;
+        case ENullRHICommand::Draw:                 Draw(U32(Args[0]), U32(Args[1])); break;
+        case ENullRHICommand::DrawIndexed:          DrawIndexed(U32(Args[0]), U32(Args[1]), I32(Args[2])); break;
+        case ENullRHICommand::DrawInstanced:        DrawInstanced(U32(Args[0]), U32(Args[1]), U32(Args[2]), U32(Args[3])); break;
+        case ENullRHICommand::DrawIndexedInstanced: DrawIndexedInstanced(U32(Args[0]), U32(Args[1]), U32(Args[2]), I32(Args[3]), U32(Args[4])); break;
+        case ENullRHICommand::UpdateBufferRegion:   UpdateBufferRegion(Handle(Args[0]), U32(Args[1]), nullptr, U32(Args[2])); break;
+        case ENullRHICommand::CopyBufferRegion:     CopyBufferRegion(Handle(Args[0]), U32(Args[1]), Handle(Args[2]), U32(Args[3]), U32(Args[4])); break;
+        case ENullRHICommand::SignalFence:          SignalFence(Handle(Args[0])); break;
+        default: return false;
+        }
+    }
+
+    return true;
+}
+
+const char* KNullCommandContext::GetCommandName(ENullRHICommand Command)
+{
+    const uint32 Index = static_cast<uint32>(Command);
+    return Index < NullRHICommandCount ? CommandLayouts[Index].Name : "Unknown";
+}
+
+void KNullCommandContext::BeginCommand(ENullRHICommand Command)
+{
+    ++CommandCounts[static_cast<uint32>(Command)];
+
+    if (bRecording)
+    {
+        Stream.push_back(static_cast<uint8>(Command));
+    }
+}
+
+void KNullCommandContext::Write(const void* Data, size_t Size)
+{
+    if (!bRecording)
+    {
+        return;
+    }
+
+    const uint8* Bytes = static_cast<const uint8*>(Data);
+    Stream.insert(Stream.end(), Bytes, Bytes + Size);
+}
+
+// KNullRHIDevice class implementation
+
+KNullRHIDevice::~KNullRHIDevice()
+{
+    for (FRHIResource Resource : LiveResources)
+    {
+        delete static_cast<const FNullResource*>(Resource);
+    }
+    LiveResources.clear();
+}
+
+FRHIResource KNullRHIDevice::CreateBuffer(const FRHIBufferDesc& Desc, const void* InitialData)
+{
+    if (Desc.ByteWidth == 0)
+    {
+        return nullptr;
+    }
+    return AddResource(Desc.ByteWidth, InitialData);
+}
+
+FRHIResource KNullRHIDevice::CreateTexture2D(const FRHITextureDesc& Desc, const void* InitialData, uint32 RowPitch)
+{
+    const uint32 TexelSize = GetRHIFormatSize(Desc.Format);
+    if (Desc.Width == 0 || Desc.Height == 0 || TexelSize == 0)
+    {
+        return nullptr;
+    }
+
+    const uint32 TightPitch = Desc.Width * TexelSize;
+    FRHIResource Resource = AddResource(static_cast<size_t>(TightPitch) * Desc.Height, nullptr);
+
+    if (InitialData)
+    {
+        uint8* Storage = GetStorage(Resource);
+        const uint8* Source = static_cast<const uint8*>(InitialData);
+        const uint32 SourcePitch = RowPitch > 0 ? RowPitch : TightPitch;
+
+        for (uint32 Row = 0; Row < Desc.Height; ++Row)
+        {
+            memcpy(Storage + static_cast<size_t>(Row) * TightPitch, Source + static_cast<size_t>(Row) * SourcePitch, TightPitch);
+        }
+    }
+    return Resource;
+}
+
+FRHIResource KNullRHIDevice::CreateShader(EShaderType Type, const void* Bytecode, size_t BytecodeSize)
+{
+    (void)Type;
+    return AddResource(BytecodeSize, Bytecode);
+}
+
+FRHIResource KNullRHIDevice::CreateInputLayout(const FRHIInputElement* Elements, uint32 ElementCount,
+                                               const void* VertexShaderBytecode, size_t BytecodeSize)
+{
+    (void)VertexShaderBytecode;
+    (void)BytecodeSize;
+    return AddResource(sizeof(FRHIInputElement) * ElementCount, Elements);
+}
+
+FRHIResource KNullRHIDevice::CreateSampler(const FRHISamplerDesc& Desc)
+{
+    return AddResource(sizeof(Desc), &Desc);
+}
+
+FRHIResource KNullRHIDevice::CreateDepthStencilState(const FRHIDepthStencilDesc& Desc)
+{
+    return AddResource(sizeof(Desc), &Desc);
+}
+
+FRHIResource KNullRHIDevice::CreateFence()
+{
+    return AddResource(0, nullptr);
+}
+
+void KNullRHIDevice::ReleaseResource(FRHIResource Resource)
+{
+    std::lock_guard<std::mutex> Lock(ResourceMutex);
+    if (LiveResources.erase(Resource) > 0)
+    {
+        delete static_cast<const FNullResource*>(Resource);
+    }
+}
+
+bool KNullRHIDevice::CompileShader(EShaderType Type, const std::string& Source, const std::string& SourceName,
+                                   const std::string& EntryPoint, std::vector<uint8>& OutBytecode,
+                                   std::string& OutErrors)
+{
+    (void)Type;
+    (void)SourceName;
+    (void)EntryPoint;
+    OutErrors.clear();
+    OutBytecode.assign(Source.begin(), Source.end());
+    return !Source.empty();
+}
+
+IRHICommandContext* KNullRHIDevice::CreateDeferredContext()
+{
+    DeferredContexts.push_back(std::make_unique<KNullCommandContext>());
+    DeferredContexts.back()->SetRecording(true);
+    return DeferredContexts.back().get();
+}
+
+void KNullRHIDevice::DestroyDeferredContext(IRHICommandContext* Context)
+{
+    for (auto It = DeferredContexts.begin(); It != DeferredContexts.end(); ++It)
+    {
+        if (It->get() == Context)
+        {
+            DeferredContexts.erase(It);
+            return;
+        }
+    }
+}
+
+void KNullRHIDevice::BeginCommandList(IRHICommandContext* DeferredContext, FRHIResource)
+{
+    static_cast<KNullCommandContext*>(DeferredContext)->Reset();
+}
+
+FRHIResource KNullRHIDevice::FinishCommandList(IRHICommandContext* DeferredContext)
+{
+    KNullCommandContext* Context = static_cast<KNullCommandContext*>(DeferredContext);
+    const std::vector<uint8>& RecordedStream = Context->GetRecordedStream();
+
+    FRHIResource CommandList = AddResource(RecordedStream.size(), RecordedStream.data());
+    Context->Reset();
+    return CommandList;
+}
+
+void KNullRHIDevice::ExecuteCommandList(FRHIResource CommandList)
+{
+    if (!CommandList)
+    {
+        return;
+    }
+
+    const FNullResource* Resource = static_cast<const FNullResource*>(CommandList);
+    ImmediateContext.Replay(Resource->Storage.data(), Resource->Storage.size());
+}
+
+size_t KNullRHIDevice::GetLiveResourceCount() const
+{
+    std::lock_guard<std::mutex> Lock(ResourceMutex);
+    return LiveResources.size();
+}
+
+uint8* KNullRHIDevice::GetStorage(FRHIResource Resource)
+{
+    if (!Resource)
+    {
+        return nullptr;
+    }
+
+    FNullResource* NullResource = static_cast<FNullResource*>(const_cast<void*>(Resource));
+    return NullResource->Storage.empty() ? nullptr : NullResource->Storage.data();
+}
+
+size_t KNullRHIDevice::GetStorageSize(FRHIResource Resource)
+{
+    return Resource ? static_cast<const FNullResource*>(Resource)->Storage.size() : 0;
+}
+
+FRHIResource KNullRHIDevice::AddResource(size_t StorageSize, const void* InitialData)
+{
+    FNullResource* Resource = new FNullResource();
+    Resource->Storage.resize(StorageSize);
+
+    if (InitialData && StorageSize > 0)
+    {
+        memcpy(Resource->Storage.data(), InitialData, StorageSize);
+    }
+
+    std::lock_guard<std::mutex> Lock(ResourceMutex);
+    LiveResources.insert(Resource);
+    return Resource;
+}
@@ -0,0 +1,193 @@
+﻿#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "RHI.h"
+
+/**
+ * @brief Commands understood by the null backend
+ */
+enum class ENullRHICommand : uint8
+{
+    SetInputLayout,
+    SetShader,
+    SetPrimitiveTopology,
+    SetVertexBuffer,
+    SetIndexBuffer,
+    SetConstantBuffer,
+    SetShaderResource,
+    SetSampler,
+    SetDepthStencilState,
+    SetViewport,
+    Map,
+    Unmap,
+    UpdateBuffer,
+    Draw,
+    DrawIndexed,
+    DrawInstanced,
+    DrawIndexedInstanced,
+    UpdateBufferRegion,
+    CopyBufferRegion,
+    SignalFence,
+
+    Count
+};
+
+constexpr uint32 NullRHICommandCount = static_cast<uint32>(ENullRHICommand::Count);
+
+/**
+ * @brief Null command context
+ *
+ * Executes nothing. Every command is counted and, when recording is enabled,
+ * serialized into a compact byte stream (opcode followed by its arguments) so
+ * the submission path can be benchmarked and compared without a GPU.
+ */
+class KNullCommandContext : public IRHICommandContext
+{
+public:
+    KNullCommandContext() = default;
+
+    void SetInputLayout(const void* InputLayout) override;
+    void SetShader(EShaderType Stage, const void* Shader) override;
+    void SetPrimitiveTopology(EPrimitiveTopology Topology) override;
+    void SetVertexBuffer(uint32 Slot, const void* Buffer, uint32 Stride, uint32 Offset) override;
+    void SetIndexBuffer(const void* Buffer, EIndexFormat Format, uint32 Offset) override;
+    void SetConstantBuffer(EShaderType Stage, uint32 Slot, const void* Buffer,
+                           uint32 FirstConstant, uint32 NumConstants) override;
+    void SetShaderResource(EShaderType Stage, uint32 Slot, const void* View) override;
+    void SetSampler(EShaderType Stage, uint32 Slot, const void* Sampler) override;
+    void SetDepthStencilState(const void* State, uint32 StencilRef) override;
+    void SetViewport(const FViewportRect& Viewport) override;
+
+    void* Map(FRHIResource Buffer, ERHIMapMode Mode) override;
+    void Unmap(FRHIResource Buffer) override;
+    void UpdateBuffer(FRHIResource Buffer, const void* Data, uint32 Size) override;
+    void UpdateBufferRegion(FRHIResource Buffer, uint32 Offset, const void* Data, uint32 Size) override;
+    void CopyBufferRegion(FRHIResource Destination, uint32 DestinationOffset,
+                          FRHIResource Source, uint32 SourceOffset, uint32 Size) override;
+    void SignalFence(FRHIResource Fence) override;
+    bool IsFenceReached(FRHIResource, bool) override { return true; }
+
+    void Draw(uint32 VertexCount, uint32 StartVertex) override;
+    void DrawIndexed(uint32 IndexCount, uint32 StartIndex, int32 BaseVertex) override;
+    void DrawInstanced(uint32 VertexCountPerInstance, uint32 InstanceCount,
+                       uint32 StartVertex, uint32 StartInstance) override;
+    void DrawIndexedInstanced(uint32 IndexCountPerInstance, uint32 InstanceCount,
+                              uint32 StartIndex, int32 BaseVertex, uint32 StartInstance) override;
+
+    /**
+     * @brief Enable or disable serialization of commands (counting is always on)
+     */
+    void SetRecording(bool bInRecording) { bRecording = bInRecording; }
+    bool IsRecording() const { return bRecording; }
+
+    /**
+     * @brief Clear counters and the recorded stream
+     */
+    void Reset();
+
+    uint64 GetCommandCount(ENullRHICommand Command) const { return CommandCounts[static_cast<uint32>(Command)]; }
+    uint64 GetTotalCommandCount() const;
+    uint64 GetDrawCallCount() const;
+    uint64 GetPrimitiveCount() const { return PrimitiveCount; }
+
+    const std::vector<uint8>& GetRecordedStream() const { return Stream; }
+
+    /**
+     * @brief Decode the recorded stream into one line of text per command
+     */
+    std::string DumpRecordedStream() const;
+
+    /**
+     * @brief Issue every command of a recorded stream on this context
+     * @return false if the stream is malformed (commands up to the error are issued)
+     */
+    bool Replay(const uint8* Data, size_t Size);
+
+    static const char* GetCommandName(ENullRHICommand Command);
+
+private:
+    void BeginCommand(ENullRHICommand Command);
+    void Write(const void* Data, size_t Size);
+
+    template<typename T>
+    void Write(const T& Value) { Write(&Value, sizeof(T)); }
+
+private:
+    uint64 CommandCounts[NullRHICommandCount] = {};
+    uint64 PrimitiveCount = 0;
+    EPrimitiveTopology CurrentTopology = EPrimitiveTopology::Undefined;
+
+    bool bRecording = false;
+    std::vector<uint8> Stream;
+};
+
+/**
+ * @brief Null device
+ *
+ * Resources are heap blocks owning CPU storage, so mapped buffers can be
+ * written to like real ones. Handles stay valid until ReleaseResource.
+ * Shaders "compile" to their source text and fences are always reached.
+ * Deferred contexts always record; their command lists hold the serialized
+ * stream, which ExecuteCommandList replays on the immediate context.
+ * Resource creation and release are thread-safe, like on D3D11.
+ */
+class KNullRHIDevice : public IRHIDevice
+{
+public:
+    KNullRHIDevice() = default;
+    ~KNullRHIDevice() override;
+
+    // Prevent copying
+    KNullRHIDevice(const KNullRHIDevice&) = delete;
+    KNullRHIDevice& operator=(const KNullRHIDevice&) = delete;
+
+    FRHIResource CreateBuffer(const FRHIBufferDesc& Desc, const void* InitialData) override;
+    FRHIResource CreateTexture2D(const FRHITextureDesc& Desc, const void* InitialData, uint32 RowPitch) override;
+    FRHIResource CreateShader(EShaderType Type, const void* Bytecode, size_t BytecodeSize) override;
+    FRHIResource CreateInputLayout(const FRHIInputElement* Elements, uint32 ElementCount,
+                                   const void* VertexShaderBytecode, size_t BytecodeSize) override;
+    FRHIResource CreateSampler(const FRHISamplerDesc& Desc) override;
+    FRHIResource CreateDepthStencilState(const FRHIDepthStencilDesc& Desc) override;
+    FRHIResource CreateFence() override;
+    void ReleaseResource(FRHIResource Resource) override;
+
+    bool CompileShader(EShaderType Type, const std::string& Source, const std::string& SourceName,
+                       const std::string& EntryPoint, std::vector<uint8>& OutBytecode,
+                       std::string& OutErrors) override;
+    bool SupportsConstantBufferRanges() const override { return true; }
+
+    IRHICommandContext* GetImmediateContext() override { return &ImmediateContext; }
+    KNullCommandContext& GetNullContext() { return ImmediateContext; }
+
+    IRHICommandContext* CreateDeferredContext() override;
+    void DestroyDeferredContext(IRHICommandContext* Context) override;
+    FRHIResource CaptureOutputState() override { return this; }
+    void BeginCommandList(IRHICommandContext* DeferredContext, FRHIResource OutputState) override;
+    FRHIResource FinishCommandList(IRHICommandContext* DeferredContext) override;
+    void ExecuteCommandList(FRHIResource CommandList) override;
+
+    size_t GetLiveResourceCount() const;
+
+    /**
+     * @brief CPU storage behind a buffer or texture handle
+     *
+     * nullptr for a null handle and for resources without storage (shaders, fences,
+     * state objects). The handle is not validated: it must come from a null device.
+     */
+    static uint8* GetStorage(FRHIResource Resource);
+    static size_t GetStorageSize(FRHIResource Resource);
+
+private:
+    FRHIResource AddResource(size_t StorageSize, const void* InitialData);
+
+private:
+    KNullCommandContext ImmediateContext;
+    std::vector<std::unique_ptr<KNullCommandContext>> DeferredContexts;
+    mutable std::mutex ResourceMutex;
+    std::unordered_set<FRHIResource> LiveResources;
+};
@@ -0,0 +1,404 @@
+﻿#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../Utils/Types.h"
+#include "../Graphics/GraphicsTypes.h"
+#include "../Graphics/RenderStateCache.h"
+
+/**
+ * @brief Thin render hardware interface
+ *
+ * Platform independent description of buffers, textures, shaders, input layouts
+ * and the draw/bind command stream. Resources are opaque native handles
+ * (ID3D11* objects on the DirectX 11 backend), which keeps them compatible with
+ * KRenderStateCache and the existing D3D11 code.
+ *
+ * The resource classes (KMesh, KTexture, KShader, KGeometryPool, KDynamicMesh)
+ * and KRenderer create everything through the device and update it through the
+ * command context, so the whole renderer also runs on the null backend.
+ */
+
+using FRHIResource = const void*;
+
+/**
+ * @brief Element formats used by buffers, textures and vertex inputs
+ */
+enum class ERHIFormat : uint8
+{
+    Unknown,
+    R32_Float,
+    R32G32_Float,
+    R32G32B32_Float,
+    R32G32B32A32_Float,
+    R16G16_Float,
+    R16G16B16A16_Float,
+    R16G16B16A16_SNorm,
+    R16G16B16A16_UNorm,
+    R16G16_SNorm,
+    R8G8B8A8_UNorm,
+    R8G8B8A8_UInt,
+    R16_UInt,
+    R32_UInt
+};
+
+/**
+ * @brief Buffer usage
+ */
+enum class ERHIBufferUsage : uint8
+{
+    Default,    // GPU read/write, updated with UpdateBuffer
+    Immutable,  // Initialized once
+    Dynamic     // CPU writes through Map
+};
+
+/**
+ * @brief Buffer bind flags
+ */
+namespace RHIBindFlags
+{
+    constexpr uint32 VertexBuffer   = 1 << 0;
+    constexpr uint32 IndexBuffer    = 1 << 1;
+    constexpr uint32 ConstantBuffer = 1 << 2;
+    constexpr uint32 ShaderResource = 1 << 3;
+}
+
+/**
+ * @brief Map modes for dynamic buffers
+ */
+enum class ERHIMapMode : uint8
+{
+    WriteDiscard,
+    WriteNoOverwrite
+};
+
+/**
+ * @brief Texture filtering of a sampler
+ */
+enum class ERHIFilter : uint8
+{
+    Point,
+    Linear
+};
+
+/**
+ * @brief Texture addressing outside [0, 1] of a sampler
+ */
+enum class ERHIAddressMode : uint8
+{
+    Wrap,
+    Clamp
+};
+
+/**
+ * @brief Depth test comparison
+ */
+enum class ERHIComparison : uint8
+{
+    Never,
+    Less,
+    Equal,
+    LessEqual,
+    Greater,
+    NotEqual,
+    GreaterEqual,
+    Always
+};
+
+/**
+ * @brief Buffer description
+ */
+struct FRHIBufferDesc
+{
+    uint32 ByteWidth = 0;
+    ERHIBufferUsage Usage = ERHIBufferUsage::Default;
+    uint32 BindFlags = 0;
+    uint32 StructureByteStride = 0;
+};
+
+/**
+ * @brief 2D texture description (single mip, sampled in shaders)
+ */
+struct FRHITextureDesc
+{
+    uint32 Width = 0;
+    uint32 Height = 0;
+    ERHIFormat Format = ERHIFormat::R8G8B8A8_UNorm;
+};
+
+/**
+ * @brief Sampler description (same filter and addressing on every axis)
+ */
+struct FRHISamplerDesc
+{
+    ERHIFilter Filter = ERHIFilter::Linear;
+    ERHIAddressMode AddressMode = ERHIAddressMode::Wrap;
+};
+
+/**
+ * @brief Depth state description (stencil disabled)
+ */
+struct FRHIDepthStencilDesc
+{
+    bool bDepthEnable = true;
+    bool bDepthWrite = true;
+    ERHIComparison DepthFunc = ERHIComparison::Less;
+};
+
+/**
+ * @brief Vertex input element
+ */
+struct FRHIInputElement
+{
+    const char* SemanticName = nullptr;
+    uint32 SemanticIndex = 0;
+    ERHIFormat Format = ERHIFormat::Unknown;
+    uint32 InputSlot = 0;
+    uint32 AlignedByteOffset = 0;
+    bool bPerInstance = false;
+    uint32 InstanceStepRate = 0;
+};
+
+/**
+ * @brief Size of one element of a format in bytes (0 if unknown)
+ */
+constexpr uint32 GetRHIFormatSize(ERHIFormat Format)
+{
+    switch (Format)
+    {
+    case ERHIFormat::R32_Float:          return 4;
+    case ERHIFormat::R32G32_Float:       return 8;
+    case ERHIFormat::R32G32B32_Float:    return 12;
+    case ERHIFormat::R32G32B32A32_Float: return 16;
+    case ERHIFormat::R16G16_Float:       return 4;
+    case ERHIFormat::R16G16B16A16_Float: return 8;
+    case ERHIFormat::R16G16B16A16_SNorm: return 8;
+    case ERHIFormat::R16G16B16A16_UNorm: return 8;
+    case ERHIFormat::R16G16_SNorm:       return 4;
+    case ERHIFormat::R8G8B8A8_UNorm:     return 4;
+    case ERHIFormat::R8G8B8A8_UInt:      return 4;
+    case ERHIFormat::R16_UInt:           return 2;
+    case ERHIFormat::R32_UInt:           return 4;
+    default:                             return 0;
+    }
+}
+
+/**
+ * @brief Command context: state binding plus draw and buffer update commands
+ *
+ * State binding comes from IRenderStateSink so a KRenderStateCache can sit
+ * in front of any backend.
+ */
+class IRHICommandContext : public IRenderStateSink
+{
+public:
+    virtual ~IRHICommandContext() = default;
+
+    /**
+     * @brief Map a dynamic buffer for writing
+     * @return Pointer to the buffer memory, nullptr on failure
+     */
+    virtual void* Map(FRHIResource Buffer, ERHIMapMode Mode) = 0;
+    virtual void Unmap(FRHIResource Buffer) = 0;
+
+    /**
+     * @brief Replace the contents of a default-usage buffer
+     * @param Size Must match the buffer size
+     */
+    virtual void UpdateBuffer(FRHIResource Buffer, const void* Data, uint32 Size) = 0;
+
+    /**
+     * @brief Overwrite a byte range of a default-usage vertex or index buffer
+     */
+    virtual void UpdateBufferRegion(FRHIResource Buffer, uint32 Offset, const void* Data, uint32 Size) = 0;
+
+    /**
+     * @brief Copy a byte range between two different default-usage buffers on the GPU
+     */
+    virtual void CopyBufferRegion(FRHIResource Destination, uint32 DestinationOffset,
+                                  FRHIResource Source, uint32 SourceOffset, uint32 Size) = 0;
+
+    /**
+     * @brief Signal a fence once the GPU has finished the commands issued so far
+     */
+    virtual void SignalFence(FRHIResource Fence) = 0;
+
+    /**
+     * @brief Whether the GPU has reached the last signal of a fence
+     * @param bWait Block until it has
+     */
+    virtual bool IsFenceReached(FRHIResource Fence, bool bWait) = 0;
+
+    virtual void Draw(uint32 VertexCount, uint32 StartVertex) = 0;
+    virtual void DrawIndexed(uint32 IndexCount, uint32 StartIndex, int32 BaseVertex) = 0;
+    virtual void DrawInstanced(uint32 VertexCountPerInstance, uint32 InstanceCount,
+                               uint32 StartVertex, uint32 StartInstance) = 0;
+    virtual void DrawIndexedInstanced(uint32 IndexCountPerInstance, uint32 InstanceCount,
+                                      uint32 StartIndex, int32 BaseVertex, uint32 StartInstance) = 0;
+};
+
+/**
+ * @brief Device: resource creation and the immediate command context
+ *
+ * Creation functions return nullptr on failure. Every returned handle must be
+ * released with ReleaseResource.
+ */
+class IRHIDevice : public std::enable_shared_from_this<IRHIDevice>
+{
+public:
+    virtual ~IRHIDevice() = default;
+
+    virtual FRHIResource CreateBuffer(const FRHIBufferDesc& Desc, const void* InitialData) = 0;
+
+    /**
+     * @brief Create a sampled 2D texture
+     * @param RowPitch Byte distance between rows of InitialData
+     * @return Shader resource view handle
+     */
+    virtual FRHIResource CreateTexture2D(const FRHITextureDesc& Desc, const void* InitialData, uint32 RowPitch) = 0;
+
+    virtual FRHIResource CreateShader(EShaderType Type, const void* Bytecode, size_t BytecodeSize) = 0;
+
+    virtual FRHIResource CreateInputLayout(const FRHIInputElement* Elements, uint32 ElementCount,
+                                           const void* VertexShaderBytecode, size_t BytecodeSize) = 0;
+
+    virtual FRHIResource CreateSampler(const FRHISamplerDesc& Desc) = 0;
+    virtual FRHIResource CreateDepthStencilState(const FRHIDepthStencilDesc& Desc) = 0;
+
+    /**
+     * @brief Create a fence for SignalFence / IsFenceReached (query it only once signaled)
+     */
+    virtual FRHIResource CreateFence() = 0;
+
+    virtual void ReleaseResource(FRHIResource Resource) = 0;
+
+    /**
+     * @brief Compile HLSL source into bytecode for CreateShader and CreateInputLayout
+     * @param SourceName File name used in messages and to resolve #include (may be empty)
+     * @param OutErrors Compiler messages on failure
+     * @return false if compilation failed
+     */
+    virtual bool CompileShader(EShaderType Type, const std::string& Source, const std::string& SourceName,
+                               const std::string& EntryPoint, std::vector<uint8>& OutBytecode,
+                               std::string& OutErrors) = 0;
+
+    /**
+     * @brief Whether constant buffers can be bound by range and mapped with no-overwrite
+     */
+    virtual bool SupportsConstantBufferRanges() const = 0;
+
+    virtual IRHICommandContext* GetImmediateContext() = 0;
+
+    /**
+     * @brief Create a context that records into command lists instead of executing
+     *
+     * Each deferred context may be used by one thread at a time.
+     * @return nullptr if the backend cannot record command lists
+     */
+    virtual IRHICommandContext* CreateDeferredContext() = 0;
+    virtual void DestroyDeferredContext(IRHICommandContext* Context) = 0;
+
+    /**
+     * @brief Snapshot the immediate context's render targets and viewport
+     *
+     * Must be called on the thread driving the immediate context. The snapshot
+     * is owned by the device and stays valid until the next capture.
+     * @return Handle passed to BeginCommandList
+     */
+    virtual FRHIResource CaptureOutputState() = 0;
+
+    /**
+     * @brief Start recording a command list
+     *
+     * The deferred context starts from default state, with the render targets
+     * and viewport of OutputState (see CaptureOutputState). Only touches the
+     * deferred context, so chunks may begin on worker threads.
+     */
+    virtual void BeginCommandList(IRHICommandContext* DeferredContext, FRHIResource OutputState) = 0;
+
+    /**
+     * @brief Close the recorded commands into a command list
+     * @return Command list handle, released with ReleaseResource
+     */
+    virtual FRHIResource FinishCommandList(IRHICommandContext* DeferredContext) = 0;
+
+    /**
+     * @brief Execute a command list on the immediate context
+     *
+     * Bindings of the immediate context are undefined afterwards (except
+     * render targets and viewport); invalidate any state cache in front of it.
+     */
+    virtual void ExecuteCommandList(FRHIResource CommandList) = 0;
+};
+
+namespace RHI
+{
+    /**
+     * @brief Shared reference to a device
+     *
+     * Shares ownership when a std::shared_ptr owns the device (KGraphicsDevice does),
+     * so resources can outlive the owner's shutdown. Any other device (e.g. one on the
+     * stack) gets a non-owning reference and must outlive it.
+     */
+    inline std::shared_ptr<IRHIDevice> ShareDevice(IRHIDevice* Device)
+    {
+        std::shared_ptr<IRHIDevice> Owner = Device ? Device->weak_from_this().lock() : nullptr;
+        return Owner ? Owner : std::shared_ptr<IRHIDevice>(std::shared_ptr<IRHIDevice>(), Device);
+    }
+}
+
+/**
+ * @brief Owning reference to an RHI resource, released through its device when reset or destroyed
+ *
+ * Keeps its device alive through RHI::ShareDevice.
+ */
+struct FRHIResourceRef
+{
+    std::shared_ptr<IRHIDevice> Device;
+    FRHIResource Resource = nullptr;
+
+    FRHIResourceRef() = default;
+    FRHIResourceRef(IRHIDevice* InDevice, FRHIResource InResource)
+        : Device(InResource ? RHI::ShareDevice(InDevice) : nullptr), Resource(InResource) {}
+    ~FRHIResourceRef() { Reset(); }
+
+    FRHIResourceRef(const FRHIResourceRef&) = delete;
+    FRHIResourceRef& operator=(const FRHIResourceRef&) = delete;
+
+    FRHIResourceRef(FRHIResourceRef&& Other) noexcept : Device(std::move(Other.Device)), Resource(Other.Resource)
+    {
+        Other.Resource = nullptr;
+    }
+
+    FRHIResourceRef& operator=(FRHIResourceRef&& Other) noexcept
+    {
+        if (this != &Other)
+        {
+            Reset();
+            Device = std::move(Other.Device);
+            Resource = Other.Resource;
+            Other.Resource = nullptr;
+        }
+        return *this;
+    }
+
+    FRHIResource Get() const { return Resource; }
+    explicit operator bool() const { return Resource != nullptr; }
+
+    /**
+     * @brief Release the resource (if any) and take a new one
+     */
+    void Reset(IRHIDevice* InDevice = nullptr, FRHIResource InResource = nullptr)
+    {
+        // Shared before releasing, in case this reference holds the last one to the same device
+        std::shared_ptr<IRHIDevice> NewDevice = InResource ? RHI::ShareDevice(InDevice) : nullptr;
+        if (Resource && Device)
+        {
+            Device->ReleaseResource(Resource);
+        }
+        Device = std::move(NewDevice);
+        Resource = InResource;
+    }
+};
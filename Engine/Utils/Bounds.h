@@ -0,0 +1,294 @@
+﻿#pragma once
+
+// Platform-independent bounding volumes and frustum tests.
+// Matrices are 16 floats, row-major, for row vectors (v * M) like DirectXMath.
+
+#include <cmath>
+#include "Types.h"
+
+/**
+ * @brief Axis-aligned bounding box (center / half extents)
+ */
+struct FBoundingBox
+{
+    float Center[3] = { 0.0f, 0.0f, 0.0f };
+    float Extents[3] = { 0.0f, 0.0f, 0.0f };
+};
+
+/**
+ * @brief Bounding sphere
+ */
+struct FBoundingSphere
+{
+    float Center[3] = { 0.0f, 0.0f, 0.0f };
+    float Radius = 0.0f;
+};
+
+/**
+ * @brief Plane: Dot(Normal, P) + Distance = 0, normal points to the inside
+ */
+struct FPlane
+{
+    float Normal[3] = { 0.0f, 0.0f, 0.0f };
+    float Distance = 0.0f;
+
+    float GetSignedDistance(const float Point[3]) const
+    {
+        return Normal[0] * Point[0] + Normal[1] * Point[1] + Normal[2] * Point[2] + Distance;
+    }
+};
+
+/**
+ * @brief View frustum (left, right, bottom, top, near, far)
+ */
+struct FFrustum
+{
+    static constexpr uint32 PlaneCount = 6;
+    FPlane Planes[PlaneCount];
+};
+
+/**
+ * @brief Frustum planes as component arrays for SIMD tests (4 or 8 planes per register)
+ *
+ * Entries past the six planes repeat the far plane, so they never reject more.
+ */
+struct alignas(32) FFrustumPlanesSoA
+{
+    static constexpr uint32 PaddedPlaneCount = 8;
+    float NormalX[PaddedPlaneCount] = {};
+    float NormalY[PaddedPlaneCount] = {};
+    float NormalZ[PaddedPlaneCount] = {};
+    float Distance[PaddedPlaneCount] = {};
+};
+
+/**
+ * @brief Frustum corner points; index bit 0 = right, bit 1 = top, bit 2 = far
+ */
+struct FFrustumCorners
+{
+    static constexpr uint32 CornerCount = 8;
+    float Points[CornerCount][3] = {};
+};
+
+namespace Bounds
+{
+    /**
+     * @brief Box enclosing a set of points
+     * @param Positions First point (3 floats)
+     * @param Count Number of points
+     * @param Stride Byte distance between points
+     */
+    inline FBoundingBox ComputeBox(const float* Positions, uint32 Count, uint32 Stride)
+    {
+        FBoundingBox Box;
+        if (!Positions || Count == 0)
+        {
+            return Box;
+        }
+
+        float Min[3] = { Positions[0], Positions[1], Positions[2] };
+        float Max[3] = { Positions[0], Positions[1], Positions[2] };
+
+        const uint8* Bytes = reinterpret_cast<const uint8*>(Positions);
+        for (uint32 i = 1; i < Count; ++i)
+        {
+            const float* Point = reinterpret_cast<const float*>(Bytes + static_cast<size_t>(i) * Stride);
+            for (uint32 Axis = 0; Axis < 3; ++Axis)
+            {
+                Min[Axis] = Point[Axis] < Min[Axis] ? Point[Axis] : Min[Axis];
+                Max[Axis] = Point[Axis] > Max[Axis] ? Point[Axis] : Max[Axis];
+            }
+        }
+
+        for (uint32 Axis = 0; Axis < 3; ++Axis)
+        {
+            Box.Center[Axis] = (Min[Axis] + Max[Axis]) * 0.5f;
+            Box.Extents[Axis] = (Max[Axis] - Min[Axis]) * 0.5f;
+        }
+        return Box;
+    }
+
+    /**
+     * @brief Sphere around the box center enclosing a set of points
+     */
+    inline FBoundingSphere ComputeSphere(const float* Positions, uint32 Count, uint32 Stride)
+    {
+        FBoundingSphere Sphere;
+        if (!Positions || Count == 0)
+        {
+            return Sphere;
+        }
+
+        const FBoundingBox Box = ComputeBox(Positions, Count, Stride);
+        Sphere.Center[0] = Box.Center[0];
+        Sphere.Center[1] = Box.Center[1];
+        Sphere.Center[2] = Box.Center[2];
+
+        float MaxDistanceSq = 0.0f;
+        const uint8* Bytes = reinterpret_cast<const uint8*>(Positions);
+        for (uint32 i = 0; i < Count; ++i)
+        {
+            const float* Point = reinterpret_cast<const float*>(Bytes + static_cast<size_t>(i) * Stride);
+            const float DX = Point[0] - Sphere.Center[0];
+            const float DY = Point[1] - Sphere.Center[1];
+            const float DZ = Point[2] - Sphere.Center[2];
+            const float DistanceSq = DX * DX + DY * DY + DZ * DZ;
+            MaxDistanceSq = DistanceSq > MaxDistanceSq ? DistanceSq : MaxDistanceSq;
+        }
+
+        Sphere.Radius = std::sqrt(MaxDistanceSq);
+        return Sphere;
+    }
+
+    /**
+     * @brief Axis-aligned box enclosing a transformed box
+     */
+    inline FBoundingBox TransformBox(const FBoundingBox& Box, const float Matrix[16])
+    {
+        FBoundingBox Result;
+        for (uint32 Column = 0; Column < 3; ++Column)
+        {
+            Result.Center[Column] = Matrix[12 + Column];
+            Result.Extents[Column] = 0.0f;
+            for (uint32 Row = 0; Row < 3; ++Row)
+            {
+                const float Element = Matrix[Row * 4 + Column];
+                Result.Center[Column] += Box.Center[Row] * Element;
+                Result.Extents[Column] += Box.Extents[Row] * std::fabs(Element);
+            }
+        }
+        return Result;
+    }
+
+    /**
+     * @brief Sphere enclosing a transformed sphere (scaled by the largest axis scale)
+     */
+    inline FBoundingSphere TransformSphere(const FBoundingSphere& Sphere, const float Matrix[16])
+    {
+        FBoundingSphere Result;
+        float MaxScaleSq = 0.0f;
+        for (uint32 Column = 0; Column < 3; ++Column)
+        {
+            Result.Center[Column] = Matrix[12 + Column];
+            for (uint32 Row = 0; Row < 3; ++Row)
+            {
+                Result.Center[Column] += Sphere.Center[Row] * Matrix[Row * 4 + Column];
+            }
+
+            const float* Axis = &Matrix[Column * 4];
+            const float ScaleSq = Axis[0] * Axis[0] + Axis[1] * Axis[1] + Axis[2] * Axis[2];
+            MaxScaleSq = ScaleSq > MaxScaleSq ? ScaleSq : MaxScaleSq;
+        }
+        Result.Radius = Sphere.Radius * std::sqrt(MaxScaleSq);
+        return Result;
+    }
+
+    /**
+     * @brief Extract normalized frustum planes from a view-projection matrix
+     *
+     * Assumes Direct3D clip space (0 <= z <= w).
+     */
+    inline void ExtractFrustumPlanes(const float ViewProjection[16], FFrustum& OutFrustum)
+    {
+        // Clip space x, y, z, w are dot products with the matrix columns
+        float Coefficients[FFrustum::PlaneCount][4];
+        for (uint32 Row = 0; Row < 4; ++Row)
+        {
+            const float* Element = &ViewProjection[Row * 4];
+            Coefficients[0][Row] = Element[3] + Element[0];  // Left:   x >= -w
+            Coefficients[1][Row] = Element[3] - Element[0];  // Right:  x <= w
+            Coefficients[2][Row] = Element[3] + Element[1];  // Bottom: y >= -w
+            Coefficients[3][Row] = Element[3] - Element[1];  // Top:    y <= w
+            Coefficients[4][Row] = Element[2];               // Near:   z >= 0
+            Coefficients[5][Row] = Element[3] - Element[2];  // Far:    z <= w
+        }
+
+        for (uint32 i = 0; i < FFrustum::PlaneCount; ++i)
+        {
+            const float* C = Coefficients[i];
+            const float Length = std::sqrt(C[0] * C[0] + C[1] * C[1] + C[2] * C[2]);
+            const float InvLength = Length > 0.0f ? 1.0f / Length : 0.0f;
+
+            FPlane& Plane = OutFrustum.Planes[i];
+            Plane.Normal[0] = C[0] * InvLength;
+            Plane.Normal[1] = C[1] * InvLength;
+            Plane.Normal[2] = C[2] * InvLength;
+            Plane.Distance = C[3] * InvLength;
+        }
+    }
+
+    /**
+     * @brief Transpose frustum planes into component arrays
+     */
+    inline void ToSoA(const FFrustum& Frustum, FFrustumPlanesSoA& OutPlanes)
+    {
+        for (uint32 i = 0; i < FFrustumPlanesSoA::PaddedPlaneCount; ++i)
+        {
+            const FPlane& Plane = Frustum.Planes[i < FFrustum::PlaneCount ? i : FFrustum::PlaneCount - 1];
+            OutPlanes.NormalX[i] = Plane.Normal[0];
+            OutPlanes.NormalY[i] = Plane.Normal[1];
+            OutPlanes.NormalZ[i] = Plane.Normal[2];
+            OutPlanes.Distance[i] = Plane.Distance;
+        }
+    }
+
+    /**
+     * @brief Unproject the clip-space cube corners with an inverse view-projection matrix
+     *
+     * Assumes Direct3D clip space (0 <= z <= w).
+     */
+    inline void ComputeFrustumCorners(const float InverseViewProjection[16], FFrustumCorners& OutCorners)
+    {
+        const float* M = InverseViewProjection;
+        for (uint32 Corner = 0; Corner < FFrustumCorners::CornerCount; ++Corner)
+        {
+            const float X = (Corner & 1) ? 1.0f : -1.0f;
+            const float Y = (Corner & 2) ? 1.0f : -1.0f;
+            const float Z = (Corner & 4) ? 1.0f : 0.0f;
+
+            float Point[4];
+            for (uint32 Column = 0; Column < 4; ++Column)
+            {
+                Point[Column] = X * M[Column] + Y * M[4 + Column] + Z * M[8 + Column] + M[12 + Column];
+            }
+
+            const float InvW = Point[3] != 0.0f ? 1.0f / Point[3] : 0.0f;
+            OutCorners.Points[Corner][0] = Point[0] * InvW;
+            OutCorners.Points[Corner][1] = Point[1] * InvW;
+            OutCorners.Points[Corner][2] = Point[2] * InvW;
+        }
+    }
+
+    /**
+     * @brief Conservative box/frustum test (false only if the box is fully outside one plane)
+     */
+    inline bool Intersects(const FFrustum& Frustum, const FBoundingBox& Box)
+    {
+        for (const FPlane& Plane : Frustum.Planes)
+        {
+            const float Radius = Box.Extents[0] * std::fabs(Plane.Normal[0]) +
+                                 Box.Extents[1] * std::fabs(Plane.Normal[1]) +
+                                 Box.Extents[2] * std::fabs(Plane.Normal[2]);
+            if (Plane.GetSignedDistance(Box.Center) + Radius < 0.0f)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Conservative sphere/frustum test
+     */
+    inline bool Intersects(const FFrustum& Frustum, const FBoundingSphere& Sphere)
+    {
+        for (const FPlane& Plane : Frustum.Planes)
+        {
+            if (Plane.GetSignedDistance(Sphere.Center) + Sphere.Radius < 0.0f)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
@@ -25,19 +25,12 @@
 #include <iostream>
 #include <crtdbg.h>
 
+// Platform-independent type definitions
+#include "Types.h"
+
 // DirectX namespace usage
 using namespace DirectX;
 
-// Unreal Engine style type definitions
-using int8   = int8_t;
-using int16  = int16_t;
-using int32  = int32_t;
-using int64  = int64_t;
-using uint8  = uint8_t;
-using uint16 = uint16_t;
-using uint32 = uint32_t;
-using uint64 = uint64_t;
-
 // Common macro definitions
 #define SAFE_RELEASE(p) if(p) { p->Release(); p = nullptr; }
 #define SAFE_DELETE(p) if(p) { delete p; p = nullptr; }
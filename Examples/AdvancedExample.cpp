@@ -117,18 +117,19 @@ public:
                               XMMatrixTranslation(4.0f, 0.0f, 0.0f);
         renderer->RenderMeshBasic(m_sphereMesh, sphereWorld);
 
-        // 4. Small cubes orbiting above
+        // 4. Small cubes orbiting above (single instanced draw)
+        XMMATRIX smallCubeWorlds[6];
         for (int i = 0; i < 6; ++i)
         {
             float angle = (m_rotationAngle + i * 60.0f);
             float x = 2.0f * cosf(XMConvertToRadians(angle));
             float z = 2.0f * sinf(XMConvertToRadians(angle));
             
-            XMMATRIX smallCubeWorld = XMMatrixScaling(0.3f, 0.3f, 0.3f) *
-                                     XMMatrixRotationY(XMConvertToRadians(angle * 2.0f)) *
-                                     XMMatrixTranslation(x, 3.0f, z);
-            renderer->RenderMeshBasic(m_cubeMesh, smallCubeWorld);
+            smallCubeWorlds[i] = XMMatrixScaling(0.3f, 0.3f, 0.3f) *
+                                 XMMatrixRotationY(XMConvertToRadians(angle * 2.0f)) *
+                                 XMMatrixTranslation(x, 3.0f, z);
         }
+        renderer->RenderMeshInstanced(m_cubeMesh, smallCubeWorlds, 6);
 
         // 5. Large rectangle on floor (grid-like)
         XMMATRIX floorWorld = XMMatrixScaling(10.0f, 0.1f, 10.0f) *
@@ -140,7 +141,7 @@ public:
         renderer->RenderMesh(m_cubeMesh, floorWorld, checkerTexture);
 
         // End frame
-        renderer->EndFrame(true);
+        renderer->EndFrame(IsVSync());
     }
 
 private:
@@ -40,7 +40,7 @@ public:
         // Example: 3D models, UI rendering, etc.
 
         // End frame - present back buffer
-        GetGraphicsDevice()->EndFrame(true);
+        GetGraphicsDevice()->EndFrame(IsVSync());
     }
 };
 
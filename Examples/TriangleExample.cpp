@@ -72,7 +72,7 @@ public:
         RenderTriangle(context);
 
         // End frame
-        device->EndFrame(true);
+        device->EndFrame(IsVSync());
     }
 
 private:
@@ -0,0 +1,367 @@
+﻿#include "Test.h"
+#include "TestScene.h"
+#include "Graphics/Animation.h"
+#include "Core/JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+namespace
+{
+    /**
+     * @brief Smooth clip; every third joint holds still, scale is animated on every fifth
+     */
+    void MakeRawClip(uint32 JointCount, uint32 FrameCount, std::mt19937& Random, FRawAnimationClip& OutClip)
+    {
+        std::uniform_real_distribution<float> Unit(-1.0f, 1.0f);
+        OutClip.Name = "Test";
+        OutClip.SampleRate = 30.0f;
+        OutClip.FrameCount = FrameCount;
+        OutClip.JointCount = JointCount;
+        OutClip.Frames.resize(size_t(FrameCount) * JointCount);
+        for (uint32 Joint = 0; Joint < JointCount; ++Joint)
+        {
+            const float Axis[3] = { Unit(Random), Unit(Random), Unit(Random) };
+            const float Amplitude = 2.0f * Unit(Random);
+            const float Speed = 2.0f + Unit(Random);
+            const float Offset[3] = { Unit(Random), Unit(Random) * 5.0f, Unit(Random) };
+            for (uint32 Frame = 0; Frame < FrameCount; ++Frame)
+            {
+                FJointTransform& Transform = OutClip.Frames[size_t(Frame) * JointCount + Joint];
+                const float Time = Joint % 3 == 0 ? 0.0f : static_cast<float>(Frame) / OutClip.SampleRate;
+                TestScene::MakeQuaternion(Axis, Amplitude * std::sin(Speed * Time), Transform.Rotation);
+                for (int Axis3 = 0; Axis3 < 3; ++Axis3)
+                {
+                    Transform.Translation[Axis3] = Offset[Axis3] + 0.3f * std::sin(Speed * Time + Axis3);
+                    Transform.Scale[Axis3] = Joint % 5 == 1 ? 1.0f + 0.5f * std::sin(Time) : 1.0f;
+                }
+            }
+        }
+    }
+
+    float GetRotationError(const float A[4], const float B[4])
+    {
+        // q and -q are the same rotation
+        const float Dot = A[0] * B[0] + A[1] * B[1] + A[2] * B[2] + A[3] * B[3];
+        const float Sign = Dot < 0.0f ? -1.0f : 1.0f;
+        float Error = 0.0f;
+        for (int i = 0; i < 4; ++i)
+        {
+            Error = std::max(Error, std::fabs(A[i] - Sign * B[i]));
+        }
+        return Error;
+    }
+
+    float GetTransformError(const FJointTransform& A, const FJointTransform& B, float& OutRotationError)
+    {
+        OutRotationError = GetRotationError(A.Rotation, B.Rotation);
+        float Error = 0.0f;
+        for (int i = 0; i < 3; ++i)
+        {
+            Error = std::max(Error, std::fabs(A.Translation[i] - B.Translation[i]));
+            Error = std::max(Error, std::fabs(A.Scale[i] - B.Scale[i]));
+        }
+        return Error;
+    }
+
+    /**
+     * @brief Scalar reference: scale, then rotate, then translate (row vectors)
+     */
+    void ComposeLocal(const FJointTransform& Transform, float OutMatrix[16])
+    {
+        const float X = Transform.Rotation[0], Y = Transform.Rotation[1], Z = Transform.Rotation[2], W = Transform.Rotation[3];
+        const float Rotation[3][3] = {
+            { 1 - 2 * (Y * Y + Z * Z), 2 * (X * Y + Z * W), 2 * (X * Z - Y * W) },
+            { 2 * (X * Y - Z * W), 1 - 2 * (X * X + Z * Z), 2 * (Y * Z + X * W) },
+            { 2 * (X * Z + Y * W), 2 * (Y * Z - X * W), 1 - 2 * (X * X + Y * Y) },
+        };
+        for (int Row = 0; Row < 3; ++Row)
+        {
+            for (int Column = 0; Column < 3; ++Column)
+            {
+                OutMatrix[Row * 4 + Column] = Rotation[Row][Column] * Transform.Scale[Row];
+            }
+            OutMatrix[Row * 4 + 3] = 0.0f;
+        }
+        OutMatrix[12] = Transform.Translation[0];
+        OutMatrix[13] = Transform.Translation[1];
+        OutMatrix[14] = Transform.Translation[2];
+        OutMatrix[15] = 1.0f;
+    }
+
+    void Multiply(const float A[16], const float B[16], float OutMatrix[16])
+    {
+        for (int Row = 0; Row < 4; ++Row)
+        {
+            for (int Column = 0; Column < 4; ++Column)
+            {
+                float Sum = 0.0f;
+                for (int k = 0; k < 4; ++k)
+                {
+                    Sum += A[Row * 4 + k] * B[k * 4 + Column];
+                }
+                OutMatrix[Row * 4 + Column] = Sum;
+            }
+        }
+    }
+}
+
+KE_TEST(CompressedClipStaysWithinQuantizationError)
+{
+    std::mt19937 Random(20);
+    const uint32 JointCount = 37;
+    FRawAnimationClip Raw;
+    MakeRawClip(JointCount, 61, Random, Raw);
+
+    KAnimationClip Clip;
+    KE_REQUIRE(Clip.Compress(Raw));
+    KE_CHECK(Clip.GetJointCount() == JointCount);
+    KE_CHECK(std::fabs(Clip.GetDuration() - 2.0f) < 1e-6f);
+
+    // Still joints have constant tracks; scale is only animated where it changes
+    const uint32 MovingJoints = JointCount - (JointCount + 2) / 3;
+    uint32 ScaledJoints = 0;
+    for (uint32 Joint = 1; Joint < JointCount; Joint += 5)
+    {
+        ScaledJoints += Joint % 3 != 0 ? 1 : 0;
+    }
+    KE_CHECK(Clip.GetAnimatedTrackCount() == MovingJoints * 2 + ScaledJoints);
+    KE_CHECK(Clip.GetCompressedSize() < Raw.Frames.size() * sizeof(FJointTransform) / 4);
+
+    // At the keys: 15-bit smallest-three rotations, 16 bits across each translation and scale range
+    KAnimationPose Pose;
+    float MaxRotationError = 0.0f;
+    float MaxError = 0.0f;
+    for (uint32 Frame = 0; Frame < Raw.FrameCount; ++Frame)
+    {
+        Clip.Sample(static_cast<float>(Frame) / Raw.SampleRate, false, Pose);
+        KE_REQUIRE(Pose.GetJointCount() == JointCount);
+        for (uint32 Joint = 0; Joint < JointCount; ++Joint)
+        {
+            FJointTransform Sampled;
+            Pose.GetJoint(Joint, Sampled);
+            float RotationError;
+            const float Error = GetTransformError(Sampled, Raw.Frames[size_t(Frame) * JointCount + Joint], RotationError);
+            MaxRotationError = std::max(MaxRotationError, RotationError);
+            MaxError = std::max(MaxError, Error);
+            if (Joint % 3 == 0)
+            {
+                KE_REQUIRE(Error < 1e-6f && RotationError < 1e-6f);
+            }
+        }
+    }
+    // Smallest-three components span 1.414 in 15 bits; half a step plus renormalization stays under two steps
+    KE_CHECK(MaxRotationError < 2.0f / 32767.0f);
+
+    // Half a 16-bit step of the widest track (scale, range 1)
+    KE_CHECK(MaxError < 0.5f / 65535.0f + 1e-6f);
+
+    // Between keys: the normalized lerp of the neighbouring keys
+    Clip.Sample(10.5f / Raw.SampleRate, false, Pose);
+    for (uint32 Joint = 0; Joint < JointCount; ++Joint)
+    {
+        const FJointTransform& A = Raw.Frames[size_t(10) * JointCount + Joint];
+        const FJointTransform& B = Raw.Frames[size_t(11) * JointCount + Joint];
+        const float Sign = A.Rotation[0] * B.Rotation[0] + A.Rotation[1] * B.Rotation[1] +
+                           A.Rotation[2] * B.Rotation[2] + A.Rotation[3] * B.Rotation[3] < 0.0f ? -1.0f : 1.0f;
+        FJointTransform Expected;
+        float Length = 0.0f;
+        for (int i = 0; i < 4; ++i)
+        {
+            Expected.Rotation[i] = 0.5f * (A.Rotation[i] + Sign * B.Rotation[i]);
+            Length += Expected.Rotation[i] * Expected.Rotation[i];
+        }
+        for (int i = 0; i < 4; ++i)
+        {
+            Expected.Rotation[i] /= std::sqrt(Length);
+        }
+        for (int i = 0; i < 3; ++i)
+        {
+            Expected.Translation[i] = 0.5f * (A.Translation[i] + B.Translation[i]);
+            Expected.Scale[i] = 0.5f * (A.Scale[i] + B.Scale[i]);
+        }
+
+        FJointTransform Sampled;
+        Pose.GetJoint(Joint, Sampled);
+        float RotationError;
+        KE_CHECK(GetTransformError(Sampled, Expected, RotationError) < 1e-3f);
+        KE_CHECK(RotationError < 1e-3f);
+    }
+}
+
+KE_TEST(LoopingWrapsAndClampingHolds)
+{
+    std::mt19937 Random(21);
+    FRawAnimationClip Raw;
+    MakeRawClip(9, 31, Random, Raw);
+    KAnimationClip Clip;
+    KE_REQUIRE(Clip.Compress(Raw));
+
+    KAnimationPose A, B;
+    Clip.Sample(0.3f, true, A);
+    Clip.Sample(0.3f + Clip.GetDuration() * 2.0f, true, B);
+    Clip.Sample(Clip.GetDuration(), false, B);
+    KAnimationPose C;
+    Clip.Sample(Clip.GetDuration() + 5.0f, false, C);
+    for (uint32 Joint = 0; Joint < 9; ++Joint)
+    {
+        FJointTransform End, Clamped;
+        B.GetJoint(Joint, End);
+        C.GetJoint(Joint, Clamped);
+        float RotationError;
+        KE_CHECK(GetTransformError(End, Clamped, RotationError) == 0.0f && RotationError == 0.0f);
+    }
+
+    Clip.Sample(0.3f + Clip.GetDuration() * 2.0f, true, B);
+    for (uint32 Joint = 0; Joint < 9; ++Joint)
+    {
+        FJointTransform First, Wrapped;
+        A.GetJoint(Joint, First);
+        B.GetJoint(Joint, Wrapped);
+        float RotationError;
+        KE_CHECK(GetTransformError(First, Wrapped, RotationError) < 1e-4f);
+        KE_CHECK(RotationError < 1e-4f);
+    }
+
+    FRawAnimationClip Empty;
+    KE_CHECK(!Clip.Compress(Empty));
+}
+
+KE_TEST(ModelMatricesMatchScalarReference)
+{
+    std::mt19937 Random(22);
+    KSkeleton Skeleton;
+    TestScene::MakeSkeleton(23, Random, Skeleton);
+    KE_REQUIRE(Skeleton.GetJointCount() == 23);
+    KE_CHECK(Skeleton.FindJoint("Joint7") == 7 && Skeleton.FindJoint("Missing") == -1);
+
+    FRawAnimationClip Raw;
+    MakeRawClip(23, 31, Random, Raw);
+    KAnimationClip Clip;
+    KE_REQUIRE(Clip.Compress(Raw));
+    KAnimationPose Pose;
+    Clip.Sample(0.4f, true, Pose);
+
+    std::vector<float> Matrices(23 * 16);
+    Animation::ComputeModelMatrices(Skeleton, Pose, Matrices.data());
+
+    std::vector<float> Expected(23 * 16);
+    for (uint32 Joint = 0; Joint < 23; ++Joint)
+    {
+        FJointTransform Transform;
+        Pose.GetJoint(Joint, Transform);
+        float Local[16];
+        ComposeLocal(Transform, Local);
+        const int32 Parent = Skeleton.GetParent(Joint);
+        if (Parent < 0)
+        {
+            std::copy(Local, Local + 16, &Expected[Joint * 16]);
+        }
+        else
+        {
+            Multiply(Local, &Expected[size_t(Parent) * 16], &Expected[Joint * 16]);
+        }
+    }
+    for (size_t i = 0; i < Expected.size(); ++i)
+    {
+        KE_REQUIRE(std::fabs(Matrices[i] - Expected[i]) < 1e-3f * (1.0f + std::fabs(Expected[i])));
+    }
+}
+
+KE_TEST(BindPosePaletteIsIdentity)
+{
+    std::mt19937 Random(23);
+    KSkeleton Skeleton;
+    TestScene::MakeSkeleton(13, Random, Skeleton);
+
+    KAnimationPose Pose;
+    Pose.SetBindPose(Skeleton);
+    std::vector<float> Matrices(13 * 16);
+    Animation::ComputeModelMatrices(Skeleton, Pose, Matrices.data());
+    std::vector<FSkinMatrix> Palette(13);
+    Animation::ComputeSkinningPalette(Skeleton, Matrices.data(), Palette.data());
+    for (const FSkinMatrix& Matrix : Palette)
+    {
+        for (int Row = 0; Row < 3; ++Row)
+        {
+            for (int Column = 0; Column < 4; ++Column)
+            {
+                KE_CHECK(std::fabs(Matrix.Rows[Row][Column] - (Row == Column ? 1.0f : 0.0f)) < 1e-4f);
+            }
+        }
+    }
+}
+
+KE_TEST(BlendingAndParallelEvaluation)
+{
+    std::mt19937 Random(24);
+    KSkeleton Skeleton;
+    TestScene::MakeSkeleton(30, Random, Skeleton);
+    FRawAnimationClip RawA, RawB;
+    MakeRawClip(30, 31, Random, RawA);
+    MakeRawClip(30, 45, Random, RawB);
+    KAnimationClip ClipA, ClipB;
+    KE_REQUIRE(ClipA.Compress(RawA) && ClipB.Compress(RawB));
+
+    // Lerp at 0 and 1 returns the inputs; a weighted blend of a pose with itself is the pose
+    KAnimationPose A, B, Blended;
+    ClipA.Sample(0.2f, true, A);
+    ClipB.Sample(0.7f, true, B);
+    Animation::Lerp(A, B, 0.0f, Blended);
+    for (uint32 Joint = 0; Joint < 30; ++Joint)
+    {
+        FJointTransform Expected, Actual;
+        A.GetJoint(Joint, Expected);
+        Blended.GetJoint(Joint, Actual);
+        float RotationError;
+        KE_CHECK(GetTransformError(Expected, Actual, RotationError) < 1e-5f && RotationError < 1e-5f);
+    }
+    Animation::Accumulate(Blended, B, 0.25f, true);
+    Animation::Accumulate(Blended, B, 0.75f, false);
+    Animation::NormalizeAccumulated(Blended, 1.0f);
+    for (uint32 Joint = 0; Joint < 30; ++Joint)
+    {
+        FJointTransform Expected, Actual;
+        B.GetJoint(Joint, Expected);
+        Blended.GetJoint(Joint, Actual);
+        float RotationError;
+        KE_CHECK(GetTransformError(Expected, Actual, RotationError) < 1e-5f && RotationError < 1e-5f);
+    }
+
+    // Many two-layer instances: the job system gives the calling thread's results
+    const uint32 InstanceCount = 64;
+    std::vector<FAnimationLayer> Layers(InstanceCount * 2);
+    std::vector<FAnimationInstance> Instances(InstanceCount);
+    std::vector<FSkinMatrix> SerialPalettes(InstanceCount * 30), ParallelPalettes(InstanceCount * 30);
+    for (uint32 i = 0; i < InstanceCount; ++i)
+    {
+        Layers[i * 2] = { &ClipA, 0.05f * i, 1.0f - i / 64.0f, true };
+        Layers[i * 2 + 1] = { &ClipB, 0.03f * i, i / 64.0f, true };
+        Instances[i].Skeleton = &Skeleton;
+        Instances[i].Layers = &Layers[i * 2];
+        Instances[i].LayerCount = 2;
+        Instances[i].Palette = &SerialPalettes[i * 30];
+    }
+    KAnimationEvaluator Evaluator;
+    Evaluator.Evaluate(Instances.data(), InstanceCount);
+
+    for (uint32 i = 0; i < InstanceCount; ++i)
+    {
+        Instances[i].Palette = &ParallelPalettes[i * 30];
+    }
+    KJobSystem JobSystem;
+    JobSystem.Initialize(3);
+    Evaluator.Evaluate(Instances.data(), InstanceCount, &JobSystem);
+    JobSystem.Shutdown();
+    KE_CHECK(std::memcmp(SerialPalettes.data(), ParallelPalettes.data(), SerialPalettes.size() * sizeof(FSkinMatrix)) == 0);
+
+    // The first instance plays clip A alone
+    std::vector<float> Matrices(30 * 16);
+    std::vector<FSkinMatrix> Expected(30);
+    ClipA.Sample(0.0f, true, A);
+    Animation::ComputeModelMatrices(Skeleton, A, Matrices.data());
+    Animation::ComputeSkinningPalette(Skeleton, Matrices.data(), Expected.data());
+    KE_CHECK(std::memcmp(Expected.data(), SerialPalettes.data(), Expected.size() * sizeof(FSkinMatrix)) == 0);
+}
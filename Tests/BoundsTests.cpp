@@ -0,0 +1,236 @@
+﻿#include "Test.h"
+#include "TestScene.h"
+
+#include <utility>
+
+namespace
+{
+    constexpr float CornerTolerance = 1.0e-3f;
+
+    /**
+     * @brief General 4x4 inverse (Gauss-Jordan with partial pivoting, in double)
+     */
+    bool Invert(const float Matrix[16], float OutInverse[16])
+    {
+        double Work[4][8];
+        for (int Row = 0; Row < 4; ++Row)
+        {
+            for (int Column = 0; Column < 4; ++Column)
+            {
+                Work[Row][Column] = Matrix[Row * 4 + Column];
+                Work[Row][4 + Column] = Row == Column ? 1.0 : 0.0;
+            }
+        }
+
+        for (int Pivot = 0; Pivot < 4; ++Pivot)
+        {
+            int Best = Pivot;
+            for (int Row = Pivot + 1; Row < 4; ++Row)
+            {
+                Best = std::fabs(Work[Row][Pivot]) > std::fabs(Work[Best][Pivot]) ? Row : Best;
+            }
+            if (std::fabs(Work[Best][Pivot]) < 1.0e-12)
+            {
+                return false;
+            }
+            std::swap(Work[Pivot], Work[Best]);
+
+            const double Scale = 1.0 / Work[Pivot][Pivot];
+            for (double& Element : Work[Pivot])
+            {
+                Element *= Scale;
+            }
+            for (int Row = 0; Row < 4; ++Row)
+            {
+                const double Factor = Row == Pivot ? 0.0 : Work[Row][Pivot];
+                for (int Column = 0; Column < 8; ++Column)
+                {
+                    Work[Row][Column] -= Factor * Work[Pivot][Column];
+                }
+            }
+        }
+
+        for (int Row = 0; Row < 4; ++Row)
+        {
+            for (int Column = 0; Column < 4; ++Column)
+            {
+                OutInverse[Row * 4 + Column] = static_cast<float>(Work[Row][4 + Column]);
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Corners of a camera frustum built from its basis, without any matrix
+     */
+    void ComputeCornersDirectly(const float Eye[3], const float Right[3], const float Up[3], const float Forward[3],
+                                float FovY, float Aspect, float NearZ, float FarZ, FFrustumCorners& OutCorners)
+    {
+        const float TanHalfFov = std::tan(FovY * 0.5f);
+        for (uint32 Corner = 0; Corner < FFrustumCorners::CornerCount; ++Corner)
+        {
+            const float Depth = (Corner & 4) ? FarZ : NearZ;
+            const float X = ((Corner & 1) ? 1.0f : -1.0f) * Depth * TanHalfFov * Aspect;
+            const float Y = ((Corner & 2) ? 1.0f : -1.0f) * Depth * TanHalfFov;
+            for (int Axis = 0; Axis < 3; ++Axis)
+            {
+                OutCorners.Points[Corner][Axis] = Eye[Axis] + Right[Axis] * X + Up[Axis] * Y + Forward[Axis] * Depth;
+            }
+        }
+    }
+
+    void CheckCorners(const FFrustumCorners& Corners, const FFrustumCorners& Expected, float Tolerance)
+    {
+        for (uint32 Corner = 0; Corner < FFrustumCorners::CornerCount; ++Corner)
+        {
+            for (int Axis = 0; Axis < 3; ++Axis)
+            {
+                KE_CHECK_NEAR(Corners.Points[Corner][Axis], Expected.Points[Corner][Axis], Tolerance);
+            }
+        }
+    }
+}
+
+KE_TEST(FrustumCornersMatchCameraBasis)
+{
+    const float FovY = 1.2f;
+    const float Aspect = 1.5f;
+    const float NearZ = 0.5f;
+    const float FarZ = 200.0f;
+
+    // Looking down +z from (1, 2, 3)
+    {
+        const float Eye[3] = { 1.0f, 2.0f, 3.0f };
+        const float At[3] = { 1.0f, 2.0f, 10.0f };
+        const float Right[3] = { 1.0f, 0.0f, 0.0f };
+        const float Up[3] = { 0.0f, 1.0f, 0.0f };
+        const float Forward[3] = { 0.0f, 0.0f, 1.0f };
+
+        float ViewProjection[16];
+        float Inverse[16];
+        TestScene::MakeViewProjection(Eye, At, FovY, Aspect, NearZ, FarZ, ViewProjection);
+        KE_REQUIRE(Invert(ViewProjection, Inverse));
+
+        FFrustumCorners Corners;
+        FFrustumCorners Expected;
+        Bounds::ComputeFrustumCorners(Inverse, Corners);
+        ComputeCornersDirectly(Eye, Right, Up, Forward, FovY, Aspect, NearZ, FarZ, Expected);
+        CheckCorners(Corners, Expected, FarZ * CornerTolerance);
+    }
+
+    // Looking down +x from the origin: right is -z in a left-handed frame
+    {
+        const float Eye[3] = { 0.0f, 0.0f, 0.0f };
+        const float At[3] = { 5.0f, 0.0f, 0.0f };
+        const float Right[3] = { 0.0f, 0.0f, -1.0f };
+        const float Up[3] = { 0.0f, 1.0f, 0.0f };
+        const float Forward[3] = { 1.0f, 0.0f, 0.0f };
+
+        float ViewProjection[16];
+        float Inverse[16];
+        TestScene::MakeViewProjection(Eye, At, FovY, Aspect, NearZ, FarZ, ViewProjection);
+        KE_REQUIRE(Invert(ViewProjection, Inverse));
+
+        FFrustumCorners Corners;
+        FFrustumCorners Expected;
+        Bounds::ComputeFrustumCorners(Inverse, Corners);
+        ComputeCornersDirectly(Eye, Right, Up, Forward, FovY, Aspect, NearZ, FarZ, Expected);
+        CheckCorners(Corners, Expected, FarZ * CornerTolerance);
+    }
+
+    // An orthographic projection (w = 1) maps the clip cube to a box
+    {
+        const float Ortho[16] = {
+            2.0f / 40.0f, 0.0f, 0.0f, 0.0f,
+            0.0f, 2.0f / 20.0f, 0.0f, 0.0f,
+            0.0f, 0.0f, 1.0f / 90.0f, 0.0f,
+            0.0f, 0.0f, -10.0f / 90.0f, 1.0f
+        };
+        float Inverse[16];
+        KE_REQUIRE(Invert(Ortho, Inverse));
+
+        FFrustumCorners Corners;
+        Bounds::ComputeFrustumCorners(Inverse, Corners);
+        for (uint32 Corner = 0; Corner < FFrustumCorners::CornerCount; ++Corner)
+        {
+            KE_CHECK_NEAR(Corners.Points[Corner][0], (Corner & 1) ? 20.0f : -20.0f, 1.0e-4f);
+            KE_CHECK_NEAR(Corners.Points[Corner][1], (Corner & 2) ? 10.0f : -10.0f, 1.0e-4f);
+            KE_CHECK_NEAR(Corners.Points[Corner][2], (Corner & 4) ? 100.0f : 10.0f, 1.0e-4f);
+        }
+    }
+}
+
+KE_TEST(FrustumCornersLieOnTheirPlanes)
+{
+    std::mt19937 Random(23);
+    std::uniform_real_distribution<float> Position(-100.0f, 100.0f);
+    for (int i = 0; i < 200; ++i)
+    {
+        const float Eye[3] = { Position(Random), Position(Random), Position(Random) };
+        const float At[3] = { Position(Random), Position(Random), Position(Random) };
+        const float FarZ = 300.0f;
+
+        float ViewProjection[16];
+        float Inverse[16];
+        TestScene::MakeViewProjection(Eye, At, 1.0f, 16.0f / 9.0f, 0.1f, FarZ, ViewProjection);
+        KE_REQUIRE(Invert(ViewProjection, Inverse));
+
+        FFrustum Frustum;
+        FFrustumCorners Corners;
+        Bounds::ExtractFrustumPlanes(ViewProjection, Frustum);
+        Bounds::ComputeFrustumCorners(Inverse, Corners);
+
+        // Each corner is on its left/right, bottom/top and near/far plane and inside the others
+        for (uint32 Corner = 0; Corner < FFrustumCorners::CornerCount; ++Corner)
+        {
+            const uint32 OnPlanes[3] = { (Corner & 1) ? 1u : 0u, (Corner & 2) ? 3u : 2u, (Corner & 4) ? 5u : 4u };
+            for (uint32 Plane = 0; Plane < FFrustum::PlaneCount; ++Plane)
+            {
+                const float Distance = Frustum.Planes[Plane].GetSignedDistance(Corners.Points[Corner]);
+                const bool bOnPlane = Plane == OnPlanes[0] || Plane == OnPlanes[1] || Plane == OnPlanes[2];
+                if (bOnPlane)
+                {
+                    KE_CHECK_NEAR(Distance, 0.0f, FarZ * CornerTolerance);
+                }
+                else
+                {
+                    KE_CHECK(Distance > -FarZ * CornerTolerance);
+                }
+            }
+        }
+    }
+}
+
+KE_TEST(PlanesSoAMatchesFrustumAndPadsWithFarPlane)
+{
+    std::mt19937 Random(29);
+    for (int i = 0; i < 100; ++i)
+    {
+        const FFrustum Frustum = TestScene::RandomFrustum(Random, 100.0f, 250.0f);
+        FFrustumPlanesSoA Planes;
+        Bounds::ToSoA(Frustum, Planes);
+
+        for (uint32 Index = 0; Index < FFrustumPlanesSoA::PaddedPlaneCount; ++Index)
+        {
+            const FPlane& Plane = Frustum.Planes[Index < FFrustum::PlaneCount ? Index : FFrustum::PlaneCount - 1];
+            KE_CHECK(Planes.NormalX[Index] == Plane.Normal[0]);
+            KE_CHECK(Planes.NormalY[Index] == Plane.Normal[1]);
+            KE_CHECK(Planes.NormalZ[Index] == Plane.Normal[2]);
+            KE_CHECK(Planes.Distance[Index] == Plane.Distance);
+        }
+
+        // The padding never rejects a box the six planes accept
+        const FBoundingBox Box = TestScene::RandomBox(Random, 100.0f, 1.0f, 20.0f);
+        bool bInsideSoA = true;
+        for (uint32 Index = 0; Index < FFrustumPlanesSoA::PaddedPlaneCount; ++Index)
+        {
+            const float Radius = Box.Extents[0] * std::fabs(Planes.NormalX[Index]) +
+                                 Box.Extents[1] * std::fabs(Planes.NormalY[Index]) +
+                                 Box.Extents[2] * std::fabs(Planes.NormalZ[Index]);
+            const float Distance = Planes.NormalX[Index] * Box.Center[0] + Planes.NormalY[Index] * Box.Center[1] +
+                                   Planes.NormalZ[Index] * Box.Center[2] + Planes.Distance[Index];
+            bInsideSoA = bInsideSoA && Distance + Radius >= 0.0f;
+        }
+        KE_CHECK(bInsideSoA == Bounds::Intersects(Frustum, Box));
+    }
+}
@@ -0,0 +1,341 @@
+﻿#include "Test.h"
+#include "Graphics/Camera.h"
+
+#include <cmath>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // Relative to the far distance: corners and plane offsets go through a 4x4 inverse in float
+    constexpr float Tolerance = 1.0e-3f;
+
+    float Dot(const float A[3], const float B[3])
+    {
+        return A[0] * B[0] + A[1] * B[1] + A[2] * B[2];
+    }
+
+    /**
+     * @brief Perspective corners at two view depths, from the camera basis without any matrix
+     */
+    void ComputeCornersDirectly(const KCamera& Camera, float NearZ, float FarZ, FFrustumCorners& OutCorners)
+    {
+        const XMFLOAT3 Position = Camera.GetPosition();
+        const XMFLOAT3 Right = Camera.GetRight();
+        const XMFLOAT3 Up = Camera.GetUp();
+        const XMFLOAT3 Forward = Camera.GetForward();
+        const bool bPerspective = Camera.GetProjectionType() == ECameraProjectionType::Perspective;
+        const float TanHalfFov = std::tan(Camera.GetFovY() * 0.5f);
+
+        for (uint32 Corner = 0; Corner < FFrustumCorners::CornerCount; ++Corner)
+        {
+            const float Depth = (Corner & 4) ? FarZ : NearZ;
+            const float HalfWidth = bPerspective ? Depth * TanHalfFov * Camera.GetAspectRatio() : Camera.GetOrthoWidth() * 0.5f;
+            const float HalfHeight = bPerspective ? Depth * TanHalfFov : Camera.GetOrthoHeight() * 0.5f;
+            const float X = (Corner & 1) ? HalfWidth : -HalfWidth;
+            const float Y = (Corner & 2) ? HalfHeight : -HalfHeight;
+
+            OutCorners.Points[Corner][0] = Position.x + Right.x * X + Up.x * Y + Forward.x * Depth;
+            OutCorners.Points[Corner][1] = Position.y + Right.y * X + Up.y * Y + Forward.y * Depth;
+            OutCorners.Points[Corner][2] = Position.z + Right.z * X + Up.z * Y + Forward.z * Depth;
+        }
+    }
+
+    /**
+     * @brief Inward planes of a perspective camera (left, right, bottom, top, near, far) from its basis
+     */
+    void ComputePlanesDirectly(const KCamera& Camera, FFrustum& OutFrustum)
+    {
+        const XMFLOAT3 P = Camera.GetPosition();
+        const XMFLOAT3 R = Camera.GetRight();
+        const XMFLOAT3 U = Camera.GetUp();
+        const XMFLOAT3 F = Camera.GetForward();
+        const float TanY = std::tan(Camera.GetFovY() * 0.5f);
+        const float TanX = TanY * Camera.GetAspectRatio();
+
+        // A side plane through the eye contains its edge direction, e.g. F - TanX * R for the left one
+        const float Normals[4][3] =
+        {
+            { R.x + TanX * F.x, R.y + TanX * F.y, R.z + TanX * F.z },
+            { -R.x + TanX * F.x, -R.y + TanX * F.y, -R.z + TanX * F.z },
+            { U.x + TanY * F.x, U.y + TanY * F.y, U.z + TanY * F.z },
+            { -U.x + TanY * F.x, -U.y + TanY * F.y, -U.z + TanY * F.z }
+        };
+        const float Position[3] = { P.x, P.y, P.z };
+        for (uint32 i = 0; i < 4; ++i)
+        {
+            const float Length = std::sqrt(Dot(Normals[i], Normals[i]));
+            FPlane& Plane = OutFrustum.Planes[i];
+            for (uint32 Axis = 0; Axis < 3; ++Axis)
+            {
+                Plane.Normal[Axis] = Normals[i][Axis] / Length;
+            }
+            Plane.Distance = -Dot(Plane.Normal, Position);
+        }
+
+        const float Forward[3] = { F.x, F.y, F.z };
+        const float EyeDepth = Dot(Forward, Position);
+        for (uint32 Axis = 0; Axis < 3; ++Axis)
+        {
+            OutFrustum.Planes[4].Normal[Axis] = Forward[Axis];
+            OutFrustum.Planes[5].Normal[Axis] = -Forward[Axis];
+        }
+        OutFrustum.Planes[4].Distance = -(EyeDepth + Camera.GetNearZ());
+        OutFrustum.Planes[5].Distance = EyeDepth + Camera.GetFarZ();
+    }
+
+    void CheckCorners(const FFrustumCorners& Corners, const FFrustumCorners& Expected, float MaxError)
+    {
+        for (uint32 Corner = 0; Corner < FFrustumCorners::CornerCount; ++Corner)
+        {
+            for (uint32 Axis = 0; Axis < 3; ++Axis)
+            {
+                KE_CHECK_NEAR(Corners.Points[Corner][Axis], Expected.Points[Corner][Axis], MaxError);
+            }
+        }
+    }
+
+    void CheckPlane(const FPlane& Plane, const FPlane& Expected, float MaxDistanceError)
+    {
+        for (uint32 Axis = 0; Axis < 3; ++Axis)
+        {
+            KE_CHECK_NEAR(Plane.Normal[Axis], Expected.Normal[Axis], 1.0e-4f);
+        }
+        KE_CHECK_NEAR(Plane.Distance, Expected.Distance, MaxDistanceError);
+    }
+
+    void SetUpCamera(KCamera& Camera)
+    {
+        Camera.SetPosition(3.0f, 4.0f, -20.0f);
+        Camera.LookAt(XMFLOAT3(10.0f, 2.0f, 30.0f));
+        Camera.SetPerspective(1.1f, 1.6f, 0.5f, 400.0f);
+        Camera.UpdateMatrices();
+    }
+}
+
+KE_TEST(FrustumMatchesCameraBasis)
+{
+    KCamera Camera;
+    SetUpCamera(Camera);
+    const float MaxError = Camera.GetFarZ() * Tolerance;
+
+    FFrustumCorners Expected;
+    ComputeCornersDirectly(Camera, Camera.GetNearZ(), Camera.GetFarZ(), Expected);
+    CheckCorners(Camera.GetFrustumCorners(), Expected, MaxError);
+
+    FFrustum ExpectedPlanes;
+    ComputePlanesDirectly(Camera, ExpectedPlanes);
+    const FFrustum& Frustum = Camera.GetFrustum();
+    for (uint32 i = 0; i < FFrustum::PlaneCount; ++i)
+    {
+        CheckPlane(Frustum.Planes[i], ExpectedPlanes.Planes[i], MaxError);
+    }
+
+    // The SoA copy is the same planes, padded with the far plane
+    const FFrustumPlanesSoA& Planes = Camera.GetFrustumPlanesSoA();
+    for (uint32 i = 0; i < FFrustumPlanesSoA::PaddedPlaneCount; ++i)
+    {
+        const FPlane& Plane = Frustum.Planes[i < FFrustum::PlaneCount ? i : FFrustum::PlaneCount - 1];
+        KE_CHECK(Planes.NormalX[i] == Plane.Normal[0]);
+        KE_CHECK(Planes.NormalY[i] == Plane.Normal[1]);
+        KE_CHECK(Planes.NormalZ[i] == Plane.Normal[2]);
+        KE_CHECK(Planes.Distance[i] == Plane.Distance);
+    }
+
+    // The inverse really inverts the view-projection
+    const XMMATRIX Product = XMMatrixMultiply(Camera.GetViewProjectionMatrix(), Camera.GetInverseViewProjectionMatrix());
+    XMFLOAT4X4 Identity;
+    XMStoreFloat4x4(&Identity, Product);
+    for (uint32 Row = 0; Row < 4; ++Row)
+    {
+        for (uint32 Column = 0; Column < 4; ++Column)
+        {
+            KE_CHECK_NEAR(Identity.m[Row][Column], Row == Column ? 1.0f : 0.0f, 1.0e-3f);
+        }
+    }
+}
+
+KE_TEST(OrthographicFrustumIsABox)
+{
+    KCamera Camera;
+    Camera.SetPosition(-5.0f, 10.0f, 2.0f);
+    Camera.SetRotation(0.3f, -1.2f, 0.0f);
+    Camera.SetOrthographic(40.0f, 20.0f, 1.0f, 100.0f);
+    Camera.UpdateMatrices();
+
+    FFrustumCorners Expected;
+    ComputeCornersDirectly(Camera, 1.0f, 100.0f, Expected);
+    CheckCorners(Camera.GetFrustumCorners(), Expected, 100.0f * Tolerance);
+
+    // Opposite side planes are parallel and the box width apart
+    const FFrustum& Frustum = Camera.GetFrustum();
+    for (uint32 Pair = 0; Pair < 3; ++Pair)
+    {
+        const FPlane& A = Frustum.Planes[Pair * 2];
+        const FPlane& B = Frustum.Planes[Pair * 2 + 1];
+        for (uint32 Axis = 0; Axis < 3; ++Axis)
+        {
+            KE_CHECK_NEAR(A.Normal[Axis], -B.Normal[Axis], 1.0e-4f);
+        }
+        const float Width = Pair == 0 ? 40.0f : (Pair == 1 ? 20.0f : 99.0f);
+        KE_CHECK_NEAR(A.Distance + B.Distance, Width, 100.0f * Tolerance);
+    }
+}
+
+KE_TEST(FrustumSlicesSplitTheDepthRange)
+{
+    KCamera Camera;
+    SetUpCamera(Camera);
+    const float NearZ = Camera.GetNearZ();
+    const float FarZ = Camera.GetFarZ();
+    const float MaxError = FarZ * Tolerance;
+
+    for (float Blend : { 0.0f, 0.5f, 1.0f })
+    {
+        constexpr uint32 SliceCount = 4;
+        Camera.SetFrustumSlices(SliceCount, Blend);
+        KE_REQUIRE(Camera.GetFrustumSliceCount() == SliceCount);
+
+        const FFrustum& Frustum = Camera.GetFrustum();
+        const XMFLOAT3 F = Camera.GetForward();
+        const XMFLOAT3 P = Camera.GetPosition();
+        const float Forward[3] = { F.x, F.y, F.z };
+        const float Position[3] = { P.x, P.y, P.z };
+
+        for (uint32 Index = 0; Index < SliceCount; ++Index)
+        {
+            const FCameraFrustumSlice& Slice = Camera.GetFrustumSlice(Index);
+
+            // Split depths blend uniform and logarithmic splits, the ends are exact
+            float Expected[2];
+            for (uint32 End = 0; End < 2; ++End)
+            {
+                const float Fraction = static_cast<float>(Index + End) / SliceCount;
+                const float Uniform = NearZ + (FarZ - NearZ) * Fraction;
+                const float Logarithmic = NearZ * std::pow(FarZ / NearZ, Fraction);
+                Expected[End] = Uniform + (Logarithmic - Uniform) * Blend;
+            }
+            KE_CHECK_NEAR(Slice.NearZ, Expected[0], 1.0e-3f);
+            KE_CHECK_NEAR(Slice.FarZ, Expected[1], 1.0e-3f);
+            KE_CHECK(Index > 0 || Slice.NearZ == NearZ);
+            KE_CHECK(Index + 1 < SliceCount || Slice.FarZ == FarZ);
+            KE_CHECK(Index == 0 || Slice.NearZ == Camera.GetFrustumSlice(Index - 1).FarZ);
+
+            FFrustumCorners ExpectedCorners;
+            ComputeCornersDirectly(Camera, Slice.NearZ, Slice.FarZ, ExpectedCorners);
+            CheckCorners(Slice.Corners, ExpectedCorners, MaxError);
+
+            // Camera side planes, near/far at the split depths
+            for (uint32 i = 0; i < 4; ++i)
+            {
+                CheckPlane(Slice.Frustum.Planes[i], Frustum.Planes[i], 0.0f);
+            }
+            for (uint32 Corner = 0; Corner < FFrustumCorners::CornerCount; ++Corner)
+            {
+                const float Depth = Dot(Forward, ExpectedCorners.Points[Corner]) - Dot(Forward, Position);
+                KE_CHECK_NEAR(Depth, (Corner & 4) ? Slice.FarZ : Slice.NearZ, MaxError);
+                const FPlane& DepthPlane = Slice.Frustum.Planes[(Corner & 4) ? 5 : 4];
+                KE_CHECK_NEAR(DepthPlane.GetSignedDistance(ExpectedCorners.Points[Corner]), 0.0f, MaxError);
+
+                // The sphere encloses the slice
+                const float* Point = Slice.Corners.Points[Corner];
+                const float Offset[3] = { Point[0] - Slice.Sphere.Center[0], Point[1] - Slice.Sphere.Center[1],
+                                          Point[2] - Slice.Sphere.Center[2] };
+                KE_CHECK(std::sqrt(Dot(Offset, Offset)) <= Slice.Sphere.Radius * (1.0f + 1.0e-5f));
+            }
+        }
+
+        // Out-of-range indices clamp to the last slice
+        KE_CHECK(&Camera.GetFrustumSlice(SliceCount + 3) == &Camera.GetFrustumSlice(SliceCount - 1));
+    }
+}
+
+KE_TEST(UpdateMatricesInvalidatesDerivedData)
+{
+    KCamera Camera;
+    SetUpCamera(Camera);
+    Camera.SetFrustumSlices(3, 0.5f);
+
+    const FFrustumCorners Before = Camera.GetFrustumCorners();
+    const float SliceFarBefore = Camera.GetFrustumSlice(0).FarZ;
+    const float MaxError = Camera.GetFarZ() * Tolerance;
+
+    // Derived data follows the matrices, which only change in UpdateMatrices
+    Camera.Move(XMFLOAT3(0.0f, 50.0f, 0.0f));
+    CheckCorners(Camera.GetFrustumCorners(), Before, 0.0f);
+
+    Camera.UpdateMatrices();
+    FFrustumCorners Expected;
+    ComputeCornersDirectly(Camera, Camera.GetNearZ(), Camera.GetFarZ(), Expected);
+    CheckCorners(Camera.GetFrustumCorners(), Expected, MaxError);
+    KE_CHECK_NEAR(Camera.GetFrustumCorners().Points[0][1], Before.Points[0][1] + 50.0f, MaxError);
+
+    FFrustum ExpectedPlanes;
+    ComputePlanesDirectly(Camera, ExpectedPlanes);
+    for (uint32 i = 0; i < FFrustum::PlaneCount; ++i)
+    {
+        CheckPlane(Camera.GetFrustum().Planes[i], ExpectedPlanes.Planes[i], MaxError);
+        KE_CHECK(Camera.GetFrustumPlanesSoA().Distance[i] == Camera.GetFrustum().Planes[i].Distance);
+    }
+    for (uint32 Corner = 4; Corner < FFrustumCorners::CornerCount; ++Corner)
+    {
+        for (uint32 Axis = 0; Axis < 3; ++Axis)
+        {
+            KE_CHECK_NEAR(Camera.GetFrustumSlice(2).Corners.Points[Corner][Axis], Expected.Points[Corner][Axis], MaxError);
+        }
+    }
+
+    // A projection change rebuilds the slices too
+    Camera.SetPerspective(0.8f, 1.0f, 1.0f, 100.0f);
+    Camera.UpdateMatrices();
+    KE_CHECK(Camera.GetFrustumSlice(0).FarZ != SliceFarBefore);
+    KE_CHECK(Camera.GetFrustumSlice(2).FarZ == 100.0f);
+    ComputeCornersDirectly(Camera, 1.0f, 100.0f, Expected);
+    CheckCorners(Camera.GetFrustumCorners(), Expected, 100.0f * Tolerance);
+
+    // Slice settings invalidate the slices without UpdateMatrices
+    Camera.SetFrustumSlices(2, 0.0f);
+    KE_CHECK(Camera.GetFrustumSliceCount() == 2);
+    KE_CHECK_NEAR(Camera.GetFrustumSlice(0).FarZ, 50.5f, 1.0e-3f);
+
+    // Nothing dirty: the cached data stays as it is
+    const FFrustum Cached = Camera.GetFrustum();
+    Camera.UpdateMatrices();
+    for (uint32 i = 0; i < FFrustum::PlaneCount; ++i)
+    {
+        CheckPlane(Camera.GetFrustum().Planes[i], Cached.Planes[i], 0.0f);
+    }
+}
+
+KE_TEST(ConcurrentQueriesSeeTheSameData)
+{
+    KCamera Camera;
+    SetUpCamera(Camera);
+    Camera.SetFrustumSlices(4);
+
+    FFrustumCorners Expected;
+    ComputeCornersDirectly(Camera, Camera.GetNearZ(), Camera.GetFarZ(), Expected);
+
+    // The first query happens on several threads at once
+    std::vector<FFrustumCorners> Corners(4);
+    std::vector<float> SliceFar(4);
+    std::vector<std::thread> Threads;
+    for (size_t i = 0; i < Corners.size(); ++i)
+    {
+        Threads.emplace_back([&, i]()
+        {
+            SliceFar[i] = Camera.GetFrustumSlice(1).FarZ;
+            Corners[i] = Camera.GetFrustumCorners();
+        });
+    }
+    for (std::thread& Thread : Threads)
+    {
+        Thread.join();
+    }
+
+    for (size_t i = 0; i < Corners.size(); ++i)
+    {
+        CheckCorners(Corners[i], Expected, Camera.GetFarZ() * Tolerance);
+        KE_CHECK(SliceFar[i] == SliceFar[0]);
+    }
+}
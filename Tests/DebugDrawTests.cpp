@@ -0,0 +1,103 @@
+﻿#include "Test.h"
+#include "Graphics/DebugDraw.h"
+
+#include <cmath>
+
+namespace
+{
+    std::vector<FCompactVertex> GetVertices(const KDebugDraw& DebugDraw, EDebugDrawMode Mode)
+    {
+        std::vector<FCompactVertex> Vertices(DebugDraw.GetVertexCount(Mode));
+        DebugDraw.CopyVertices(Mode, Vertices.data());
+        return Vertices;
+    }
+}
+
+KE_TEST(PrimitivesExpandToLineLists)
+{
+    KDebugDraw DebugDraw;
+    const uint32 Red = KDebugDraw::MakeColor(255, 0, 0);
+    KE_CHECK(Red == 0xFF0000FFu);
+
+    FBoundingBox Box;
+    Box.Center[0] = 1.0f;
+    Box.Center[1] = 2.0f;
+    Box.Center[2] = 3.0f;
+    Box.Extents[0] = Box.Extents[1] = Box.Extents[2] = 0.5f;
+    DebugDraw.AddBox(Box, Red);
+
+    std::vector<FCompactVertex> Vertices = GetVertices(DebugDraw, EDebugDrawMode::DepthTested);
+    KE_REQUIRE(Vertices.size() == 24);
+    for (const FCompactVertex& Vertex : Vertices)
+    {
+        KE_CHECK(Vertex.Color == Red);
+        for (int Axis = 0; Axis < 3; ++Axis)
+        {
+            KE_CHECK(std::fabs(std::fabs(Vertex.Position[Axis] - Box.Center[Axis]) - 0.5f) < 1e-6f);
+        }
+    }
+
+    // Three great circles, all on the sphere, in the overlay stream
+    FBoundingSphere Sphere;
+    Sphere.Center[0] = Sphere.Center[1] = Sphere.Center[2] = 0.0f;
+    Sphere.Radius = 2.0f;
+    DebugDraw.AddSphere(Sphere, Red, 16, 0.0f, EDebugDrawMode::Overlay);
+    Vertices = GetVertices(DebugDraw, EDebugDrawMode::Overlay);
+    KE_REQUIRE(Vertices.size() == 16 * 6);
+    for (const FCompactVertex& Vertex : Vertices)
+    {
+        const float* P = Vertex.Position;
+        KE_CHECK(std::fabs(std::sqrt(P[0] * P[0] + P[1] * P[1] + P[2] * P[2]) - 2.0f) < 1e-5f);
+    }
+    KE_CHECK(DebugDraw.GetVertexCount(EDebugDrawMode::DepthTested) == 24);
+
+    DebugDraw.EndFrame();
+    KE_CHECK(DebugDraw.GetVertexCount(EDebugDrawMode::DepthTested) == 0);
+    KE_CHECK(DebugDraw.GetVertexCount(EDebugDrawMode::Overlay) == 0);
+}
+
+KE_TEST(DurationsExpireOnTick)
+{
+    KDebugDraw DebugDraw;
+    const float Start[3] = { 0, 0, 0 };
+    const float End[3] = { 1, 0, 0 };
+    DebugDraw.AddLine(Start, End, 1, 0.0f);
+    DebugDraw.AddLine(Start, End, 2, 1.0f);
+    DebugDraw.AddLine(Start, End, 3, 0.25f);
+    DebugDraw.AddLine(Start, End, 4, KDebugDraw::Persistent);
+    KE_CHECK(DebugDraw.GetStats().FrameLineCount == 1);
+    KE_CHECK(DebugDraw.GetStats().TimedLineCount == 3);
+
+    DebugDraw.EndFrame();
+    DebugDraw.Tick(0.5f);
+    std::vector<FCompactVertex> Vertices = GetVertices(DebugDraw, EDebugDrawMode::DepthTested);
+    KE_REQUIRE(Vertices.size() == 4);
+    KE_CHECK(Vertices[0].Color == 2 && Vertices[2].Color == 4);
+
+    DebugDraw.Tick(0.5f);
+    Vertices = GetVertices(DebugDraw, EDebugDrawMode::DepthTested);
+    KE_REQUIRE(Vertices.size() == 2);
+    KE_CHECK(Vertices[0].Color == 4);
+
+    DebugDraw.Tick(1000.0f);
+    KE_CHECK(DebugDraw.GetVertexCount(EDebugDrawMode::DepthTested) == 2);
+    DebugDraw.ClearTimed();
+    KE_CHECK(DebugDraw.GetVertexCount(EDebugDrawMode::DepthTested) == 0);
+}
+
+KE_TEST(BudgetDropsWholePrimitives)
+{
+    KDebugDraw DebugDraw;
+    DebugDraw.SetMaxVertices(30);
+    FBoundingBox Box;
+    DebugDraw.AddBox(Box, 1);
+    DebugDraw.AddBox(Box, 1);
+    KE_CHECK(DebugDraw.GetVertexCount(EDebugDrawMode::DepthTested) == 24);
+    KE_CHECK(DebugDraw.GetStats().DroppedLineCount == 12);
+
+    DebugDraw.SetEnabled(false);
+    DebugDraw.EndFrame();
+    DebugDraw.AddBox(Box, 1);
+    KE_CHECK(DebugDraw.GetVertexCount(EDebugDrawMode::DepthTested) == 0);
+    KE_CHECK(DebugDraw.GetStats().DroppedLineCount == 0);
+}
@@ -0,0 +1,190 @@
+﻿#include "Test.h"
+#include "Graphics/DynamicBuffer.h"
+
+#include <algorithm>
+#include <random>
+
+KE_TEST(GrowCapacityFollowsPolicy)
+{
+    FDynamicGrowthPolicy Policy;
+    KE_CHECK(DynamicBuffer::GrowCapacity(Policy, 1000, 1000) == 1000);
+    KE_CHECK(DynamicBuffer::GrowCapacity(Policy, 1000, 1001) == 1536);     // 1.5x rounded up to 256
+    KE_CHECK(DynamicBuffer::GrowCapacity(Policy, 1000, 4000) == 4096);     // The requirement wins over the factor
+    KE_CHECK(DynamicBuffer::GrowCapacity(Policy, 0, 1) == 256);
+
+    Policy.MaxCapacity = 3000;
+    KE_CHECK(DynamicBuffer::GrowCapacity(Policy, 2000, 2100) == 3000);     // Clamped to the maximum
+    KE_CHECK(DynamicBuffer::GrowCapacity(Policy, 2000, 3001) == 0);
+
+    Policy.Factor = 0.5f;
+    Policy.Granularity = 0;
+    KE_CHECK(DynamicBuffer::GrowCapacity(Policy, 100, 101) == 101);
+}
+
+KE_TEST(AppendCursorWrapsWithDiscard)
+{
+    KDynamicAppendCursor Cursor(100);
+    EDynamicMapMode Mode;
+
+    // A new buffer is discarded once, then appended to
+    KE_CHECK(Cursor.Allocate(40, Mode) == 0 && Mode == EDynamicMapMode::Discard);
+    KE_CHECK(Cursor.Allocate(40, Mode) == 40 && Mode == EDynamicMapMode::NoOverwrite);
+    KE_CHECK(Cursor.Allocate(20, Mode) == 80 && Mode == EDynamicMapMode::NoOverwrite);
+    KE_CHECK(Cursor.GetDiscardCount() == 0);
+
+    // Out of room: start over in a renamed buffer
+    KE_CHECK(Cursor.Allocate(1, Mode) == 0 && Mode == EDynamicMapMode::Discard);
+    KE_CHECK(Cursor.GetDiscardCount() == 1);
+    KE_CHECK(Cursor.Allocate(101, Mode) == DynamicBuffer::InvalidOffset);
+    KE_CHECK(Cursor.Allocate(0, Mode) == DynamicBuffer::InvalidOffset);
+    KE_CHECK(Cursor.GetCursor() == 1);
+
+    // The frame needed 101 elements: recommend growing until it fits without discarding
+    KE_CHECK(Cursor.GetFrameUsage() == 101);
+    Cursor.BeginFrame();
+    KE_CHECK(Cursor.GetLastFrameUsage() == 101 && Cursor.GetFrameUsage() == 0);
+    FDynamicGrowthPolicy Policy;
+    KE_CHECK(Cursor.GetRecommendedCapacity(Policy) == 256);
+    Policy.MaxCapacity = 100;
+    KE_CHECK(Cursor.GetRecommendedCapacity(Policy) == 100);
+
+    Cursor.Initialize(256);
+    KE_CHECK(Cursor.Allocate(101, Mode) == 0 && Mode == EDynamicMapMode::Discard);
+    Cursor.BeginFrame();
+    KE_CHECK(Cursor.GetRecommendedCapacity(FDynamicGrowthPolicy()) == 256);
+}
+
+KE_TEST(AppendCursorRangesNeverOverlapWithinABuffer)
+{
+    std::mt19937 Random(18);
+    KDynamicAppendCursor Cursor(4096);
+    std::vector<uint8> Owner(4096, 0);
+    uint32 Generation = 0;
+    for (int Step = 0; Step < 20000; ++Step)
+    {
+        if (Step % 37 == 0)
+        {
+            Cursor.BeginFrame();
+        }
+
+        EDynamicMapMode Mode;
+        const uint32 Count = 1 + Random() % 300;
+        const uint32 Offset = Cursor.Allocate(Count, Mode);
+        KE_REQUIRE(Offset != DynamicBuffer::InvalidOffset);
+        KE_REQUIRE(Offset + Count <= Cursor.GetCapacity());
+        if (Mode == EDynamicMapMode::Discard)
+        {
+            // Renamed buffer: everything handed out before belongs to the old one
+            std::fill(Owner.begin(), Owner.end(), 0);
+            ++Generation;
+        }
+        for (uint32 i = Offset; i < Offset + Count; ++i)
+        {
+            KE_REQUIRE(Owner[i] == 0);
+            Owner[i] = 1;
+        }
+    }
+    KE_CHECK(Generation == Cursor.GetDiscardCount() + 1);
+}
+
+KE_TEST(RangeTrackerKeepsEveryCopyCurrent)
+{
+    // Model of KDynamicMesh::Flush: a CPU copy and CopyCount GPU copies
+    for (uint32 CopyCount = 1; CopyCount <= KDynamicRangeTracker::MaxCopies; ++CopyCount)
+    {
+        std::mt19937 Random(CopyCount);
+        const uint32 ElementCount = 2048;
+        std::vector<uint32> Data(ElementCount, 0);
+        std::vector<std::vector<uint32>> Copies(CopyCount, std::vector<uint32>(ElementCount, 0xDEAD));
+
+        KDynamicRangeTracker Tracker;
+        Tracker.Initialize(CopyCount);
+        KE_REQUIRE(Tracker.GetCopyCount() == CopyCount);
+        Tracker.MarkDirty(0, ElementCount);
+
+        uint32 PartialUpdates = 0;
+        uint32 Value = 1;
+        for (int Frame = 0; Frame < 2000; ++Frame)
+        {
+            // A few scattered edits, sometimes none
+            const uint32 EditCount = Random() % 4 == 0 ? 0 : 1 + Random() % 12;
+            for (uint32 Edit = 0; Edit < EditCount; ++Edit)
+            {
+                const uint32 First = Random() % ElementCount;
+                const uint32 Count = 1 + Random() % std::min<uint32>(64, ElementCount - First);
+                std::fill_n(Data.begin() + First, Count, Value++);
+                Tracker.MarkDirty(First, Count);
+            }
+
+            if (!Tracker.NeedsUpdate())
+            {
+                KE_REQUIRE(Copies[Tracker.GetCurrent()] == Data);
+                continue;
+            }
+
+            const uint32 Current = Tracker.Advance();
+            std::vector<uint32>& Copy = Copies[Current];
+            const bool bCopyIdle = Random() % 8 != 0;
+            if (Tracker.ChooseMapMode(ElementCount, bCopyIdle) == EDynamicMapMode::Discard)
+            {
+                // Renamed: the old contents are gone
+                std::fill(Copy.begin(), Copy.end(), 0xDEAD);
+                Copy = Data;
+            }
+            else
+            {
+                KE_REQUIRE(bCopyIdle && Tracker.IsValid(Current));
+                const std::vector<FDynamicRange>& Ranges = Tracker.GetPendingRanges();
+                for (size_t i = 0; i < Ranges.size(); ++i)
+                {
+                    KE_REQUIRE(Ranges[i].First + Ranges[i].Count <= ElementCount);
+                    KE_REQUIRE(i == 0 || Ranges[i].First > Ranges[i - 1].First + Ranges[i - 1].Count);
+                    std::copy_n(Data.begin() + Ranges[i].First, Ranges[i].Count, Copy.begin() + Ranges[i].First);
+                }
+                ++PartialUpdates;
+            }
+            Tracker.CompleteUpdate();
+            KE_REQUIRE(Copy == Data);
+        }
+
+        KE_CHECK(PartialUpdates > 1000);
+        Tracker.Invalidate();
+        KE_CHECK(!Tracker.IsValid(Tracker.GetCurrent()));
+        KE_CHECK(Tracker.ChooseMapMode(ElementCount, true) == EDynamicMapMode::Discard);
+    }
+}
+
+KE_TEST(RangeTrackerMergesAndChoosesDiscardWhenMostlyDirty)
+{
+    KDynamicRangeTracker Tracker;
+    Tracker.Initialize(2);
+    Tracker.Advance();
+    Tracker.CompleteUpdate();
+    Tracker.Advance();
+    Tracker.CompleteUpdate();
+
+    Tracker.MarkDirty(100, 10);
+    Tracker.MarkDirty(0, 10);
+    Tracker.MarkDirty(20, 5);       // 10 apart from [0, 10): merged
+    Tracker.MarkDirty(105, 20);     // Overlaps [100, 110)
+    Tracker.MarkDirty(500, 0);      // Ignored
+    KE_REQUIRE(Tracker.NeedsUpdate());
+    KE_CHECK(Tracker.ChooseMapMode(1000, true) == EDynamicMapMode::NoOverwrite);
+    KE_CHECK(Tracker.ChooseMapMode(1000, false) == EDynamicMapMode::Discard);
+
+    const std::vector<FDynamicRange>& Ranges = Tracker.GetPendingRanges();
+    KE_REQUIRE(Ranges.size() == 2);
+    KE_CHECK(Ranges[0].First == 0 && Ranges[0].Count == 25);
+    KE_CHECK(Ranges[1].First == 100 && Ranges[1].Count == 25);
+
+    // 25 of 40 used elements dirty; ranges past the used count do not count
+    KE_CHECK(Tracker.ChooseMapMode(40, true) == EDynamicMapMode::Discard);
+    KE_CHECK(Tracker.ChooseMapMode(40, true, 0.9f) == EDynamicMapMode::NoOverwrite);
+
+    // The other copy collected the same changes
+    Tracker.CompleteUpdate();
+    KE_CHECK(!Tracker.NeedsUpdate());
+    Tracker.Advance();
+    KE_CHECK(Tracker.NeedsUpdate());
+    KE_CHECK(Tracker.GetPendingRanges().size() == 2);
+}
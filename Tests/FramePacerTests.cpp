@@ -0,0 +1,196 @@
+﻿#include "Test.h"
+#include "Core/FramePacer.h"
+
+namespace
+{
+    constexpr uint64 Millisecond = 1000000;
+
+    /**
+     * @brief Clock advanced by the test; waits jump straight to the deadline
+     */
+    class KFakeFrameClock : public IFrameClock
+    {
+    public:
+        uint64 Now() override { return Time; }
+
+        void SleepUntil(uint64 Deadline, uint64 SpinThreshold) override
+        {
+            (void)SpinThreshold;
+            ++SleepCount;
+            Time = Deadline > Time ? Deadline + Oversleep : Time;
+        }
+
+        void Advance(uint64 Nanoseconds) { Time += Nanoseconds; }
+
+        uint64 Time = 1000 * Millisecond;
+        uint64 Oversleep = 0;
+        uint32 SleepCount = 0;
+    };
+
+    FFramePacerSettings MakeSettings(float TargetFPS)
+    {
+        FFramePacerSettings Settings;
+        Settings.TargetFPS = TargetFPS;
+        Settings.SmoothingFrames = 1;
+        return Settings;
+    }
+}
+
+KE_TEST(UnlimitedFramesNeverWait)
+{
+    KFakeFrameClock Clock;
+    KFramePacer Pacer(&Clock);
+    Pacer.SetSettings(MakeSettings(0.0f));
+
+    Pacer.WaitForNextFrame();
+    for (uint32 Frame = 0; Frame < 10; ++Frame)
+    {
+        Clock.Advance(3 * Millisecond);
+        Pacer.WaitForNextFrame();
+        KE_CHECK_NEAR(Pacer.GetDeltaTime(), 0.003f, 1.0e-6f);
+        KE_CHECK(Pacer.GetWaitTime() == 0.0f);
+    }
+    KE_CHECK(Clock.SleepCount == 0);
+    KE_CHECK(Pacer.GetFrameCount() == 11);
+}
+
+KE_TEST(FixedRateFramesStartOnThePeriodGrid)
+{
+    KFakeFrameClock Clock;
+    KFramePacer Pacer(&Clock);
+    Pacer.SetSettings(MakeSettings(50.0f));
+    KE_CHECK(Pacer.GetFramePeriod() == 20 * Millisecond);
+
+    Pacer.WaitForNextFrame();
+    const uint64 Origin = Clock.Now();
+    for (uint64 Frame = 1; Frame <= 100; ++Frame)
+    {
+        Clock.Advance(5 * Millisecond);
+        Pacer.WaitForNextFrame();
+        KE_CHECK(Clock.Now() == Origin + Frame * 20 * Millisecond);
+        KE_CHECK_NEAR(Pacer.GetDeltaTime(), 0.020f, 1.0e-6f);
+        KE_CHECK_NEAR(Pacer.GetWaitTime(), 0.015f, 1.0e-6f);
+    }
+}
+
+KE_TEST(WakeUpErrorsDoNotAccumulate)
+{
+    KFakeFrameClock Clock;
+    Clock.Oversleep = Millisecond / 2;
+    KFramePacer Pacer(&Clock);
+    Pacer.SetSettings(MakeSettings(50.0f));
+
+    // The first frame already waits one period (and oversleeps)
+    const uint64 Start = Clock.Now();
+    Pacer.WaitForNextFrame();
+    KE_CHECK(Clock.Now() == Start + 20 * Millisecond + Clock.Oversleep);
+
+    for (uint64 Frame = 2; Frame <= 100; ++Frame)
+    {
+        Clock.Advance(5 * Millisecond);
+        Pacer.WaitForNextFrame();
+
+        // Every frame starts half a millisecond late, never later
+        KE_CHECK(Clock.Now() == Start + Frame * 20 * Millisecond + Clock.Oversleep);
+    }
+}
+
+KE_TEST(SlightlyLateFrameIsCaughtUp)
+{
+    KFakeFrameClock Clock;
+    KFramePacer Pacer(&Clock);
+    Pacer.SetSettings(MakeSettings(50.0f));
+
+    Pacer.WaitForNextFrame();
+    const uint64 Origin = Clock.Now();
+
+    // 25 ms of work misses one deadline by 5 ms
+    Clock.Advance(25 * Millisecond);
+    Pacer.WaitForNextFrame();
+    KE_CHECK(Pacer.GetWaitTime() == 0.0f);
+
+    // The next frame is shortened to get back on the grid
+    Clock.Advance(5 * Millisecond);
+    Pacer.WaitForNextFrame();
+    KE_CHECK(Clock.Now() == Origin + 40 * Millisecond);
+}
+
+KE_TEST(LongFrameRestartsTheSchedule)
+{
+    KFakeFrameClock Clock;
+    KFramePacer Pacer(&Clock);
+    FFramePacerSettings Settings = MakeSettings(50.0f);
+    Settings.MaxDeltaTime = 0.1f;
+    Pacer.SetSettings(Settings);
+
+    Pacer.WaitForNextFrame();
+
+    // A breakpoint: the delta is clamped and no burst of catch-up frames follows
+    Clock.Advance(500 * Millisecond);
+    Pacer.WaitForNextFrame();
+    KE_CHECK_NEAR(Pacer.GetDeltaTime(), 0.1f, 1.0e-6f);
+
+    const uint64 Restart = Clock.Now();
+    for (uint64 Frame = 1; Frame <= 5; ++Frame)
+    {
+        Clock.Advance(Millisecond);
+        Pacer.WaitForNextFrame();
+        KE_CHECK(Clock.Now() == Restart + Frame * 20 * Millisecond);
+    }
+}
+
+KE_TEST(BackgroundLimitAppliesOnlyWhenLower)
+{
+    KFakeFrameClock Clock;
+    KFramePacer Pacer(&Clock);
+    FFramePacerSettings Settings = MakeSettings(0.0f);
+    Settings.BackgroundFPS = 10.0f;
+    Pacer.SetSettings(Settings);
+
+    KE_CHECK(Pacer.GetFramePeriod() == 0);
+    Pacer.SetBackground(true);
+    KE_CHECK(Pacer.GetFramePeriod() == 100 * Millisecond);
+
+    Pacer.WaitForNextFrame();
+    const uint64 Origin = Clock.Now();
+    Clock.Advance(Millisecond);
+    Pacer.WaitForNextFrame();
+    KE_CHECK(Clock.Now() == Origin + 100 * Millisecond);
+
+    // A foreground limit below the background one wins
+    Settings.TargetFPS = 5.0f;
+    Pacer.SetSettings(Settings);
+    KE_CHECK(Pacer.GetFramePeriod() == 200 * Millisecond);
+
+    Pacer.SetBackground(false);
+    Settings.TargetFPS = 60.0f;
+    Pacer.SetSettings(Settings);
+    KE_CHECK(Pacer.GetFramePeriod() == static_cast<uint64>(1.0e9 / 60.0));
+}
+
+KE_TEST(SmoothedDeltaAveragesTheWindow)
+{
+    KFakeFrameClock Clock;
+    KFramePacer Pacer(&Clock);
+    FFramePacerSettings Settings = MakeSettings(0.0f);
+    Settings.SmoothingFrames = 4;
+    Pacer.SetSettings(Settings);
+
+    Pacer.WaitForNextFrame();
+    const uint64 FrameTimes[] = { 10, 20, 10, 20, 10, 20 };
+    for (uint64 FrameTime : FrameTimes)
+    {
+        Clock.Advance(FrameTime * Millisecond);
+        Pacer.WaitForNextFrame();
+    }
+    KE_CHECK_NEAR(Pacer.GetSmoothedDeltaTime(), 0.015f, 1.0e-5f);
+    KE_CHECK_NEAR(Pacer.GetDeltaTime(), 0.020f, 1.0e-6f);
+}
+
+KE_TEST(SystemClockWaitsUntilTheDeadline)
+{
+    KSystemFrameClock Clock;
+    const uint64 Deadline = Clock.Now() + 3 * Millisecond;
+    Clock.SleepUntil(Deadline, Millisecond);
+    KE_CHECK(Clock.Now() >= Deadline);
+}
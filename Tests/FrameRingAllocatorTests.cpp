@@ -0,0 +1,112 @@
+﻿#include "Test.h"
+#include "Graphics/FrameRingAllocator.h"
+
+#include <deque>
+#include <random>
+
+namespace
+{
+    struct FRange
+    {
+        uint64 Offset;
+        uint64 Size;
+    };
+
+    bool Overlaps(const FRange& A, const FRange& B)
+    {
+        return A.Offset < B.Offset + B.Size && B.Offset < A.Offset + A.Size;
+    }
+}
+
+KE_TEST(AllocationsAreAlignedAndInBounds)
+{
+    KFrameRingAllocator Allocator(1024);
+    const uint64 First = Allocator.Allocate(10, 1);
+    const uint64 Second = Allocator.Allocate(64, 256);
+    KE_CHECK(First == 0);
+    KE_CHECK(Second == 256);
+    KE_CHECK(Allocator.GetUsedSize() == 256 + 64);
+}
+
+KE_TEST(FullRingFailsUntilFenceRetires)
+{
+    KFrameRingAllocator Allocator(1024);
+    KE_CHECK(Allocator.Allocate(600, 16) == 0);
+    Allocator.FinishFrame(1);
+    KE_CHECK(Allocator.Allocate(600, 16) == KFrameRingAllocator::InvalidOffset);
+
+    // An older fence does not release frame 1
+    Allocator.RetireFrames(0);
+    KE_CHECK(Allocator.GetFramesInFlight() == 1);
+    KE_CHECK(Allocator.Allocate(600, 16) == KFrameRingAllocator::InvalidOffset);
+
+    Allocator.RetireFrames(1);
+    KE_CHECK(Allocator.GetFramesInFlight() == 0);
+    KE_CHECK(Allocator.GetUsedSize() == 0);
+    KE_CHECK(Allocator.Allocate(600, 16) != KFrameRingAllocator::InvalidOffset);
+}
+
+KE_TEST(WrapNeverOverlapsFramesInFlight)
+{
+    constexpr uint64 Capacity = 4096;
+    constexpr uint32 FramesInFlight = 3;
+
+    KFrameRingAllocator Allocator(Capacity);
+    std::mt19937 Random(3);
+    std::deque<std::vector<FRange>> Frames;
+    std::vector<FRange> Current;
+    uint64 Fence = 0;
+
+    for (uint32 Step = 0; Step < 20000; ++Step)
+    {
+        const uint64 Size = 1 + Random() % 300;
+        const uint64 Alignment = uint64(1) << (Random() % 9);
+        const uint64 Offset = Allocator.Allocate(Size, Alignment);
+        if (Offset != KFrameRingAllocator::InvalidOffset)
+        {
+            KE_REQUIRE(Offset % Alignment == 0);
+            KE_REQUIRE(Offset + Size <= Capacity);
+
+            const FRange Range = { Offset, Size };
+            for (const std::vector<FRange>& Frame : Frames)
+            {
+                for (const FRange& Live : Frame)
+                {
+                    KE_REQUIRE(!Overlaps(Range, Live));
+                }
+            }
+            for (const FRange& Live : Current)
+            {
+                KE_REQUIRE(!Overlaps(Range, Live));
+            }
+            Current.push_back(Range);
+        }
+
+        // End a frame every few allocations (or when the ring is full)
+        if (Offset == KFrameRingAllocator::InvalidOffset || Random() % 8 == 0)
+        {
+            Allocator.FinishFrame(++Fence);
+            Frames.push_back(std::move(Current));
+            Current.clear();
+
+            if (Frames.size() > FramesInFlight)
+            {
+                Allocator.RetireFrames(Fence - FramesInFlight);
+                Frames.pop_front();
+            }
+        }
+    }
+
+    KE_CHECK(Allocator.GetFramesInFlight() == Frames.size());
+}
+
+KE_TEST(ResetReleasesFramesInFlight)
+{
+    KFrameRingAllocator Allocator(256);
+    Allocator.Allocate(200, 4);
+    Allocator.FinishFrame(5);
+    Allocator.Reset();
+    KE_CHECK(Allocator.GetFramesInFlight() == 0);
+    KE_CHECK(Allocator.GetFreeSize() == 256);
+    KE_CHECK(Allocator.Allocate(256, 4) == 0);
+}
@@ -0,0 +1,133 @@
+﻿#include "Test.h"
+#include "TestScene.h"
+#include "Graphics/FrustumCuller.h"
+
+namespace
+{
+    // SIMD and scalar sums may round differently for boxes touching a plane
+    constexpr float MarginTolerance = 1.0e-3f;
+
+    void CheckAgainstReference(const KFrustumCuller& Culler, const std::vector<FBoundingBox>& Boxes,
+                               const FFrustum& Frustum)
+    {
+        std::vector<uint32> Visible;
+        const uint32 VisibleCount = Culler.Cull(Frustum, Visible);
+        KE_CHECK(VisibleCount == Visible.size());
+
+        size_t Cursor = 0;
+        for (uint32 i = 0; i < Boxes.size(); ++i)
+        {
+            const bool bVisible = Cursor < Visible.size() && Visible[Cursor] == i;
+            Cursor += bVisible ? 1 : 0;
+
+            if (bVisible != Bounds::Intersects(Frustum, Boxes[i]))
+            {
+                KE_CHECK(std::fabs(TestScene::GetFrustumMargin(Frustum, Boxes[i])) < MarginTolerance);
+            }
+        }
+
+        // Every index was consumed in order, so the list is increasing and in range
+        KE_CHECK(Cursor == Visible.size());
+    }
+}
+
+KE_TEST(CullMatchesScalarReference)
+{
+    std::mt19937 Random(11);
+    KFrustumCuller Culler;
+    std::vector<FBoundingBox> Boxes;
+    for (uint32 i = 0; i < 10000; ++i)
+    {
+        Boxes.push_back(TestScene::RandomBox(Random, 500.0f, 0.1f, 20.0f));
+        Culler.Add(Boxes.back());
+    }
+
+    for (uint32 View = 0; View < 32; ++View)
+    {
+        CheckAgainstReference(Culler, Boxes, TestScene::RandomFrustum(Random, 500.0f, 400.0f));
+    }
+}
+
+KE_TEST(CullHandlesPartialSimdBatches)
+{
+    std::mt19937 Random(5);
+    const FFrustum Frustum = TestScene::RandomFrustum(Random, 50.0f, 100.0f);
+
+    for (uint32 Count = 0; Count <= 2 * KFrustumCuller::GetSimdWidth() + 1; ++Count)
+    {
+        KFrustumCuller Culler;
+        std::vector<FBoundingBox> Boxes;
+        for (uint32 i = 0; i < Count; ++i)
+        {
+            Boxes.push_back(TestScene::RandomBox(Random, 50.0f, 1.0f, 10.0f));
+            Culler.Add(Boxes.back());
+        }
+        CheckAgainstReference(Culler, Boxes, Frustum);
+    }
+}
+
+KE_TEST(BoxesAroundTheCameraAreVisible)
+{
+    const float Eye[3] = { 0.0f, 0.0f, 0.0f };
+    const float At[3] = { 0.0f, 0.0f, 1.0f };
+    const FFrustum Frustum = TestScene::MakeFrustum(Eye, At);
+
+    KFrustumCuller Culler;
+    FBoundingBox Box;
+    Box.Extents[0] = Box.Extents[1] = Box.Extents[2] = 1.0f;
+    Culler.Add(Box);                         // Contains the eye
+    Box.Center[2] = 50.0f;
+    Culler.Add(Box);                         // Straight ahead
+    Box.Center[2] = -50.0f;
+    Culler.Add(Box);                         // Behind
+    Box.Center[2] = 2000.0f;
+    Culler.Add(Box);                         // Past the far plane
+
+    std::vector<uint32> Visible;
+    KE_REQUIRE(Culler.Cull(Frustum, Visible) == 2);
+    KE_CHECK(Visible[0] == 0 && Visible[1] == 1);
+
+    const FBoundingBox Stored = Culler.GetBox(3);
+    KE_CHECK(Stored.Center[2] == 2000.0f && Stored.Extents[0] == 1.0f);
+}
+
+KE_TEST(CullViewsMatchesPerViewCull)
+{
+    std::mt19937 Random(22);
+    KFrustumCuller Culler;
+    for (uint32 i = 0; i < 5003; ++i)
+    {
+        Culler.Add(TestScene::RandomBox(Random, 500.0f, 0.1f, 20.0f));
+    }
+
+    for (const uint32 ViewCount : { 1u, 2u, 4u, 7u, 8u, KFrustumCuller::MaxViews })
+    {
+        std::vector<FFrustum> Frustums;
+        for (uint32 View = 0; View < ViewCount; ++View)
+        {
+            Frustums.push_back(TestScene::RandomFrustum(Random, 500.0f, 400.0f));
+        }
+
+        std::vector<uint32> Masks;
+        const uint32 VisibleCount = Culler.CullViews(Frustums.data(), ViewCount, Masks);
+        KE_REQUIRE(Masks.size() == Culler.GetCount());
+
+        uint32 AnyVisible = 0;
+        for (const uint32 Mask : Masks)
+        {
+            KE_CHECK(ViewCount == 32 || (Mask >> ViewCount) == 0);
+            AnyVisible += Mask != 0 ? 1 : 0;
+        }
+        KE_CHECK(VisibleCount == AnyVisible);
+
+        // The shared pass and its per-view lists give each view's own cull
+        std::vector<std::vector<uint32>> ViewIndices(ViewCount);
+        KFrustumCuller::GatherViewIndices(Masks.data(), Culler.GetCount(), ViewCount, ViewIndices.data());
+        for (uint32 View = 0; View < ViewCount; ++View)
+        {
+            std::vector<uint32> Visible;
+            Culler.Cull(Frustums[View], Visible);
+            KE_CHECK(ViewIndices[View] == Visible);
+        }
+    }
+}
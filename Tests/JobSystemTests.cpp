@@ -0,0 +1,65 @@
+﻿#include "Test.h"
+#include "Core/JobSystem.h"
+
+#include <atomic>
+#include <chrono>
+
+namespace
+{
+    // Runs Count slow tasks and checks every one of them finished before ParallelFor returned
+    bool RunsEveryTaskBeforeReturning(KJobSystem& JobSystem, uint32 Count)
+    {
+        std::atomic<uint32> Finished{ 0 };
+        JobSystem.ParallelFor(Count, [&Finished](uint32, uint32)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+            Finished.fetch_add(1, std::memory_order_relaxed);
+        });
+        return Finished.load() == Count;
+    }
+}
+
+KE_TEST(ParallelForRunsEveryIndexOnce)
+{
+    KJobSystem JobSystem;
+    JobSystem.Initialize(3);
+    KE_CHECK(JobSystem.GetThreadCount() == 4);
+
+    std::vector<std::atomic<uint32>> Runs(1000);
+    std::atomic<bool> bBadWorker{ false };
+    JobSystem.ParallelFor(static_cast<uint32>(Runs.size()), [&](uint32 Index, uint32 WorkerIndex)
+    {
+        Runs[Index].fetch_add(1, std::memory_order_relaxed);
+        if (WorkerIndex >= JobSystem.GetThreadCount())
+        {
+            bBadWorker = true;
+        }
+    });
+
+    bool bEveryIndexOnce = true;
+    for (const std::atomic<uint32>& Count : Runs)
+    {
+        bEveryIndexOnce &= Count.load() == 1;
+    }
+    KE_CHECK(bEveryIndexOnce);
+    KE_CHECK(!bBadWorker.load());
+}
+
+KE_TEST(ReinitializedWorkersWaitForTheNextBatch)
+{
+    // Workers that start while the first batch is being set up must count into it exactly once
+    KJobSystem JobSystem;
+    uint32 EarlyReturns = 0;
+    for (uint32 Round = 0; Round < 500; ++Round)
+    {
+        JobSystem.Initialize(3);
+        EarlyReturns += RunsEveryTaskBeforeReturning(JobSystem, 8) ? 0 : 1;
+        JobSystem.Shutdown();
+    }
+    KE_CHECK(EarlyReturns == 0);
+
+    // Re-initializing without an explicit shutdown
+    JobSystem.Initialize(2);
+    JobSystem.Initialize(3);
+    KE_CHECK(RunsEveryTaskBeforeReturning(JobSystem, 32));
+}
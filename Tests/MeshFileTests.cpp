@@ -0,0 +1,133 @@
+﻿#include "Test.h"
+#include "TestMesh.h"
+#include "Graphics/MeshFile.h"
+#include "Graphics/ProceduralGeometry.h"
+
+#include <cstring>
+
+namespace
+{
+    void BuildSphere(EVertexLayout Layout, FMeshBuildData& OutBuild)
+    {
+        std::vector<FStandardVertex> Vertices;
+        std::vector<uint32> Indices;
+        ProceduralGeometry::Generate(FProceduralMeshDesc::Sphere(32, 16), Vertices, Indices);
+
+        FMeshLODSettings LODSettings;
+        LODSettings.MaxError = 1.0f;
+        MeshFile::Build(Vertices.data(), static_cast<uint32>(Vertices.size()), Indices.data(),
+                        static_cast<uint32>(Indices.size()), Layout, true, OutBuild, nullptr, 0, &LODSettings);
+    }
+
+    bool IsSameData(const FMeshData& A, const FMeshData& B)
+    {
+        if (A.Layout != B.Layout || A.IndexFormat != B.IndexFormat || A.VertexCount != B.VertexCount ||
+            A.IndexCount != B.IndexCount || A.LODCount != B.LODCount || A.SubmeshCount != B.SubmeshCount)
+        {
+            return false;
+        }
+        for (uint32 Stream = 0; Stream < VertexFormat::GetStreamCount(A.Layout); ++Stream)
+        {
+            if (std::memcmp(A.Streams[Stream], B.Streams[Stream],
+                            size_t(A.VertexCount) * VertexFormat::GetStreamStride(A.Layout, Stream)) != 0)
+            {
+                return false;
+            }
+        }
+        // Empty blobs have null pointers, which memcmp must not be given
+        auto IsSameBlob = [](const void* BlobA, const void* BlobB, size_t Size)
+        {
+            return Size == 0 || std::memcmp(BlobA, BlobB, Size) == 0;
+        };
+        const size_t IndexSize = A.IndexFormat == EIndexFormat::UInt16 ? 2 : 4;
+        return IsSameBlob(A.Indices, B.Indices, A.IndexCount * IndexSize) &&
+               IsSameBlob(A.LODs, B.LODs, A.LODCount * sizeof(FMeshLOD)) &&
+               IsSameBlob(A.Submeshes, B.Submeshes, A.SubmeshCount * sizeof(FMeshSubmesh)) &&
+               std::memcmp(&A.Bounds, &B.Bounds, sizeof(A.Bounds)) == 0;
+    }
+}
+
+KE_TEST(WriteAndReadBackEveryLayout)
+{
+    for (const EVertexLayout Layout : { EVertexLayout::Standard, EVertexLayout::Compact, EVertexLayout::CompactSplit,
+                                        EVertexLayout::Quantized, EVertexLayout::QuantizedSplit })
+    {
+        FMeshBuildData Build;
+        BuildSphere(Layout, Build);
+        KE_REQUIRE(Build.Data.VertexCount > 0);
+        KE_CHECK(Build.Data.IndexFormat == EIndexFormat::UInt16);
+        KE_CHECK(Build.Data.LODCount > 1);
+
+        std::vector<uint8> Image;
+        MeshFile::Write(Build.Data, Image);
+        KE_CHECK(Image.size() % MeshFile::BlobAlignment == 0);
+
+        KMeshFile File;
+        KE_REQUIRE(File.OpenMemory(Image.data(), Image.size()));
+        KE_CHECK(IsSameData(File.GetData(), Build.Data));
+
+        // Blobs point into the image instead of copies
+        const uint8* Begin = Image.data();
+        const uint8* Stream = static_cast<const uint8*>(File.GetData().Streams[0]);
+        KE_CHECK(Stream > Begin && Stream < Begin + Image.size());
+        KE_CHECK((Stream - Begin) % MeshFile::BlobAlignment == 0);
+    }
+}
+
+KE_TEST(MappedFileMatchesImage)
+{
+    FMeshBuildData Build;
+    BuildSphere(EVertexLayout::Quantized, Build);
+
+    const std::string Directory = TestMesh::MakeTempDirectory("KojeomMeshFileTests");
+    const std::string Path = Directory + "/Sphere.kmesh";
+    KE_REQUIRE(MeshFile::WriteFile(Build.Data, Path));
+
+    KMeshFile File;
+    KE_CHECK(File.Open(Path));
+    KE_CHECK(File.IsOpen() && IsSameData(File.GetData(), Build.Data));
+    File.Close();
+    KE_CHECK(!File.IsOpen());
+    KE_CHECK(!File.Open(Directory + "/Missing.kmesh"));
+    TestMesh::RemoveDirectory(Directory);
+}
+
+KE_TEST(RejectsDamagedFiles)
+{
+    FMeshBuildData Build;
+    BuildSphere(EVertexLayout::Compact, Build);
+    std::vector<uint8> Image;
+    MeshFile::Write(Build.Data, Image);
+
+    KMeshFile File;
+    KE_CHECK(!File.OpenMemory(Image.data(), sizeof(FMeshFileHeader) - 1));
+    KE_CHECK(!File.OpenMemory(Image.data(), Image.size() - 1));
+
+    auto IsRejected = [&Image](void (*Damage)(FMeshFileHeader&))
+    {
+        std::vector<uint8> Damaged = Image;
+        Damage(*reinterpret_cast<FMeshFileHeader*>(Damaged.data()));
+        KMeshFile Reader;
+        return !Reader.OpenMemory(Damaged.data(), Damaged.size());
+    };
+    KE_CHECK(IsRejected([](FMeshFileHeader& Header) { Header.Magic ^= 1; }));
+    KE_CHECK(IsRejected([](FMeshFileHeader& Header) { ++Header.Version; }));
+    KE_CHECK(IsRejected([](FMeshFileHeader& Header) { Header.Layout = static_cast<uint8>(EVertexLayout::Position); }));
+    KE_CHECK(IsRejected([](FMeshFileHeader& Header) { Header.IndexOffset += 4; }));
+    KE_CHECK(IsRejected([](FMeshFileHeader& Header) { Header.StreamOffsets[0] = Header.FileSize; }));
+    KE_CHECK(IsRejected([](FMeshFileHeader& Header) { Header.VertexCount = ~0u; }));
+    KE_CHECK(IsRejected([](FMeshFileHeader& Header) { Header.LODCount = FMeshLODSettings::MaxLODs + 1; }));
+
+    // A LOD range past the index buffer
+    std::vector<uint8> Damaged = Image;
+    const FMeshFileHeader& Header = *reinterpret_cast<const FMeshFileHeader*>(Damaged.data());
+    reinterpret_cast<FMeshLOD*>(Damaged.data() + Header.LODOffset)->IndexCount = Header.IndexCount + 3;
+    KE_CHECK(!File.OpenMemory(Damaged.data(), Damaged.size()));
+
+    // Streams were valid before the LOD table failed; none of them may be left behind
+    KE_CHECK(!File.IsOpen());
+    KE_CHECK(File.GetData().Streams[0] == nullptr && File.GetData().VertexCount == 0);
+
+    // Empty blobs with wild offsets are ignored rather than turned into pointers
+    KE_CHECK(!IsRejected([](FMeshFileHeader& Header) { Header.SubmeshCount = 0; Header.SubmeshOffset = ~0ull; }));
+}
@@ -0,0 +1,245 @@
+﻿#include "Test.h"
+#include "TestMesh.h"
+#include "Graphics/MeshImporter.h"
+#include "Graphics/ProceduralGeometry.h"
+#include "Core/JobSystem.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    bool IsNear(const float* A, const float* B, int Count)
+    {
+        for (int i = 0; i < Count; ++i)
+        {
+            if (std::fabs(A[i] - B[i]) > 1e-5f)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    FMeshImportSettings GetRightHandedSettings()
+    {
+        FMeshImportSettings Settings;
+        Settings.bConvertToLeftHanded = false;
+        return Settings;
+    }
+}
+
+KE_TEST(ObjMatchesSourceMesh)
+{
+    std::vector<FStandardVertex> Vertices;
+    std::vector<uint32> Indices;
+    ProceduralGeometry::Generate(FProceduralMeshDesc::Torus(32, 16), Vertices, Indices);
+    std::string Obj;
+    TestMesh::AppendObj(Vertices, Indices, Obj);
+
+    const std::string Directory = TestMesh::MakeTempDirectory("KojeomMeshImporterTests");
+    const std::string Path = Directory + "/Torus.obj";
+    KE_REQUIRE(TestMesh::WriteTextFile(Path, Obj));
+
+    FImportedMesh Mesh;
+    FMeshImportStats Stats;
+    KE_REQUIRE(MeshImporter::Import(Path, Mesh, GetRightHandedSettings(), nullptr, &Stats));
+    TestMesh::RemoveDirectory(Directory);
+
+    KE_CHECK(Stats.Error.empty());
+    KE_CHECK(Stats.BytesRead == Obj.size());
+    KE_CHECK(Stats.SourceVertexCount == Indices.size());
+    KE_CHECK(Mesh.Vertices.size() <= Vertices.size());
+    KE_REQUIRE(Mesh.Indices.size() == Indices.size());
+    KE_REQUIRE(Mesh.Submeshes.size() == 1);
+    KE_CHECK(Mesh.Submeshes[0].IndexCount == Indices.size());
+
+    for (size_t i = 0; i < Indices.size(); ++i)
+    {
+        const FStandardVertex& Expected = Vertices[Indices[i]];
+        const FStandardVertex& Actual = Mesh.Vertices[Mesh.Indices[i]];
+        KE_REQUIRE(IsNear(Actual.Position, Expected.Position, 3));
+        KE_REQUIRE(IsNear(Actual.Normal, Expected.Normal, 3));
+        KE_REQUIRE(IsNear(Actual.TexCoord, Expected.TexCoord, 2));
+    }
+}
+
+KE_TEST(ChunkedParallelImportMatchesSerial)
+{
+    std::vector<FStandardVertex> Vertices;
+    std::vector<uint32> Indices;
+    ProceduralGeometry::Generate(FProceduralMeshDesc::Sphere(96, 48), Vertices, Indices);
+    std::string Obj = "# sphere\nusemtl First\n";
+    TestMesh::AppendObj(Vertices, Indices, Obj);
+    Obj += "usemtl Second\nf 1/1/1 2/2/2 3/3/3\n";
+
+    const std::string Directory = TestMesh::MakeTempDirectory("KojeomMeshImporterTests");
+    const std::string Path = Directory + "/Sphere.obj";
+    KE_REQUIRE(TestMesh::WriteTextFile(Path, Obj));
+
+    FImportedMesh Serial;
+    KE_REQUIRE(MeshImporter::ImportObj(Path, Serial));
+
+    // Chunks far smaller than the file, with a window of a few chunks
+    FMeshImportSettings Settings;
+    Settings.ChunkSize = 4096;
+    Settings.ChunksInFlight = 3;
+    KJobSystem JobSystem;
+    JobSystem.Initialize(3);
+    FImportedMesh Parallel;
+    FMeshImportStats Stats;
+    const bool bImported = MeshImporter::ImportObj(Path, Parallel, Settings, &JobSystem, &Stats);
+    JobSystem.Shutdown();
+    TestMesh::RemoveDirectory(Directory);
+
+    KE_REQUIRE(bImported);
+    KE_CHECK(Stats.ChunkCount > Obj.size() / 8192);
+    KE_CHECK(Parallel.Indices == Serial.Indices);
+    KE_REQUIRE(Parallel.Vertices.size() == Serial.Vertices.size());
+    KE_CHECK(std::memcmp(Parallel.Vertices.data(), Serial.Vertices.data(),
+                         Serial.Vertices.size() * sizeof(FStandardVertex)) == 0);
+    KE_REQUIRE(Parallel.Submeshes.size() == 2);
+    KE_CHECK(Parallel.Submeshes[1].IndexCount == 3);
+    KE_CHECK(Parallel.Materials == Serial.Materials);
+}
+
+KE_TEST(ObjPolygonsNegativeIndicesAndMaterials)
+{
+    const std::string Directory = TestMesh::MakeTempDirectory("KojeomMeshImporterTests");
+    const std::string Path = Directory + "/Quad.obj";
+    KE_REQUIRE(TestMesh::WriteTextFile(Path,
+        "v 0 0 1\nv 1 0 1\nv 1 1 1\nv 0 1 1\n"
+        "usemtl A\nf 1 2 3 4\n"
+        "usemtl B\nf -4 -2 -1\n"));
+
+    FImportedMesh RightHanded;
+    KE_REQUIRE(MeshImporter::ImportObj(Path, RightHanded, GetRightHandedSettings()));
+    FImportedMesh LeftHanded;
+    KE_REQUIRE(MeshImporter::ImportObj(Path, LeftHanded));
+    TestMesh::RemoveDirectory(Directory);
+
+    KE_REQUIRE(RightHanded.Indices.size() == 9);
+    KE_REQUIRE(RightHanded.Submeshes.size() == 2);
+    KE_CHECK(RightHanded.Materials.size() == 2 && RightHanded.Materials[0] == "A" && RightHanded.Materials[1] == "B");
+    KE_CHECK(RightHanded.Submeshes[0].FirstIndex == 0 && RightHanded.Submeshes[0].IndexCount == 6);
+    KE_CHECK(RightHanded.Submeshes[1].FirstIndex == 6 && RightHanded.Submeshes[1].IndexCount == 3);
+
+    // Fan triangulation, then v1 v3 v4 from the negative indices
+    const float Expected[9][3] = {
+        { 0, 0, 1 }, { 1, 0, 1 }, { 1, 1, 1 },
+        { 0, 0, 1 }, { 1, 1, 1 }, { 0, 1, 1 },
+        { 0, 0, 1 }, { 1, 1, 1 }, { 0, 1, 1 },
+    };
+    for (size_t i = 0; i < 9; ++i)
+    {
+        KE_CHECK(IsNear(RightHanded.Vertices[RightHanded.Indices[i]].Position, Expected[i], 3));
+    }
+
+    // Generated smooth normals face the counter-clockwise side
+    KE_CHECK(std::fabs(RightHanded.Vertices[RightHanded.Indices[0]].Normal[2] - 1.0f) < 1e-4f);
+
+    // Left-handed: Z negated, winding flipped, so the normal still faces the front
+    KE_REQUIRE(LeftHanded.Indices.size() == 9);
+    const FStandardVertex& A = LeftHanded.Vertices[LeftHanded.Indices[0]];
+    const FStandardVertex& B = LeftHanded.Vertices[LeftHanded.Indices[1]];
+    const FStandardVertex& C = LeftHanded.Vertices[LeftHanded.Indices[2]];
+    KE_CHECK(A.Position[2] == -1.0f);
+    const float Winding = (B.Position[0] - A.Position[0]) * (C.Position[1] - A.Position[1]) -
+                          (B.Position[1] - A.Position[1]) * (C.Position[0] - A.Position[0]);
+    KE_CHECK(Winding < 0.0f);
+    KE_CHECK(std::fabs(A.Normal[2] + 1.0f) < 1e-4f);
+}
+
+KE_TEST(GltfWithBinaryBufferAndNodeTransform)
+{
+    const std::string Directory = TestMesh::MakeTempDirectory("KojeomMeshImporterTests");
+    KE_REQUIRE(TestMesh::WriteTextFile(Directory + "/Quad.gltf",
+        R"({"asset":{"version":"2.0"},"scene":0,"scenes":[{"nodes":[0]}],)"
+        R"("nodes":[{"mesh":0,"translation":[0,0,5]}],)"
+        R"("meshes":[{"primitives":[{"attributes":{"POSITION":0},"indices":1}]}],)"
+        R"("buffers":[{"uri":"Quad.bin","byteLength":60}],)"
+        R"("bufferViews":[{"buffer":0,"byteOffset":0,"byteLength":48},{"buffer":0,"byteOffset":48,"byteLength":12}],)"
+        R"("accessors":[{"bufferView":0,"componentType":5126,"count":4,"type":"VEC3","min":[0,0,0],"max":[1,1,0]},)"
+        R"({"bufferView":1,"componentType":5123,"count":6,"type":"SCALAR"}]})"));
+
+    const float Positions[12] = { 0, 0, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0 };
+    const uint16 QuadIndices[6] = { 0, 1, 2, 0, 2, 3 };
+    std::string Buffer(reinterpret_cast<const char*>(Positions), sizeof(Positions));
+    Buffer.append(reinterpret_cast<const char*>(QuadIndices), sizeof(QuadIndices));
+    KE_REQUIRE(TestMesh::WriteTextFile(Directory + "/Quad.bin", Buffer));
+
+    FImportedMesh Mesh;
+    FMeshImportStats Stats;
+    const bool bImported = MeshImporter::Import(Directory + "/Quad.gltf", Mesh, GetRightHandedSettings(), nullptr, &Stats);
+    TestMesh::RemoveDirectory(Directory);
+
+    KE_REQUIRE(bImported);
+    KE_CHECK(Stats.SourceVertexCount == 4);
+    KE_CHECK(Mesh.Vertices.size() == 4);
+    KE_REQUIRE(Mesh.Indices.size() == 6);
+    for (size_t i = 0; i < 6; ++i)
+    {
+        const float* Source = &Positions[QuadIndices[i] * 3];
+        const float Expected[3] = { Source[0], Source[1], Source[2] + 5.0f };
+        KE_CHECK(IsNear(Mesh.Vertices[Mesh.Indices[i]].Position, Expected, 3));
+    }
+}
+
+KE_TEST(GltfRejectsMistypedAttributes)
+{
+    // Each attribute sits at the end of the buffer, so reading more components than its type holds would overrun it
+    struct FCase
+    {
+        const char* Attribute;
+        const char* Type;
+        uint32 ComponentType;
+    };
+    const FCase Cases[] = {
+        { "NORMAL", "SCALAR", 5126 },
+        { "NORMAL", "VEC3", 5121 },
+        { "TEXCOORD_0", "SCALAR", 5126 },
+        { "COLOR_0", "VEC2", 5126 },
+    };
+
+    const std::string Directory = TestMesh::MakeTempDirectory("KojeomMeshImporterTests");
+    const float Positions[9] = { 0, 0, 0, 1, 0, 0, 0, 1, 0 };
+    const float Attribute[3] = { 0, 0, 1 };
+    std::string Buffer(reinterpret_cast<const char*>(Positions), sizeof(Positions));
+    Buffer.append(reinterpret_cast<const char*>(Attribute), sizeof(Attribute));
+    KE_REQUIRE(TestMesh::WriteTextFile(Directory + "/Triangle.bin", Buffer));
+
+    for (const FCase& Case : Cases)
+    {
+        const uint32 ComponentSize = Case.ComponentType == 5126 ? 4 : 1;
+        const uint32 Components = std::strcmp(Case.Type, "SCALAR") == 0 ? 1 : Case.Type[3] - '0';
+        const uint32 Stride = ComponentSize * Components;
+        const std::string Gltf =
+            R"({"asset":{"version":"2.0"},"meshes":[{"primitives":[{"attributes":{"POSITION":0,")" +
+            std::string(Case.Attribute) + R"(":1}}]}],"nodes":[{"mesh":0}],)"
+            R"("buffers":[{"uri":"Triangle.bin","byteLength":48}],)"
+            R"("bufferViews":[{"buffer":0,"byteOffset":0,"byteLength":36},)"
+            R"({"buffer":0,"byteOffset":)" + std::to_string(48 - 3 * Stride) + R"(,"byteLength":)" +
+            std::to_string(3 * Stride) + R"(}],)"
+            R"("accessors":[{"bufferView":0,"componentType":5126,"count":3,"type":"VEC3"},)"
+            R"({"bufferView":1,"componentType":)" + std::to_string(Case.ComponentType) + R"(,"count":3,"type":")" +
+            Case.Type + R"("}]})";
+        KE_REQUIRE(TestMesh::WriteTextFile(Directory + "/Triangle.gltf", Gltf));
+
+        FImportedMesh Mesh;
+        FMeshImportStats Stats;
+        KE_CHECK(!MeshImporter::Import(Directory + "/Triangle.gltf", Mesh, GetRightHandedSettings(), nullptr, &Stats));
+        KE_CHECK(!Stats.Error.empty());
+        KE_CHECK(Mesh.Vertices.empty() && Mesh.Indices.empty());
+    }
+    TestMesh::RemoveDirectory(Directory);
+}
+
+KE_TEST(ReportsErrors)
+{
+    FImportedMesh Mesh;
+    FMeshImportStats Stats;
+    KE_CHECK(!MeshImporter::Import("/nonexistent/Mesh.obj", Mesh, FMeshImportSettings(), nullptr, &Stats));
+    KE_CHECK(!Stats.Error.empty());
+    KE_CHECK(!MeshImporter::IsSupportedFile("Mesh.fbx"));
+    KE_CHECK(MeshImporter::IsSupportedFile("Mesh.glb"));
+}
@@ -0,0 +1,160 @@
+﻿#include "Test.h"
+#include "Graphics/MeshOptimizer.h"
+#include "Graphics/ProceduralGeometry.h"
+
+#include <algorithm>
+#include <array>
+#include <random>
+
+namespace
+{
+    using FTriangle = std::array<float, 9>;
+
+    /**
+     * @brief Triangles as position triples, rotated to a canonical start (winding kept) and sorted
+     */
+    std::vector<FTriangle> GetTriangles(const std::vector<FStandardVertex>& Vertices, const std::vector<uint32>& Indices)
+    {
+        std::vector<FTriangle> Triangles;
+        for (size_t i = 0; i + 2 < Indices.size(); i += 3)
+        {
+            std::array<std::array<float, 3>, 3> Corners;
+            for (int Corner = 0; Corner < 3; ++Corner)
+            {
+                const float* Position = Vertices[Indices[i + Corner]].Position;
+                Corners[Corner] = { Position[0], Position[1], Position[2] };
+            }
+            const int First = static_cast<int>(std::min_element(Corners.begin(), Corners.end()) - Corners.begin());
+
+            FTriangle Triangle;
+            for (int Corner = 0; Corner < 3; ++Corner)
+            {
+                const std::array<float, 3>& Position = Corners[(First + Corner) % 3];
+                std::copy(Position.begin(), Position.end(), Triangle.begin() + Corner * 3);
+            }
+            Triangles.push_back(Triangle);
+        }
+        std::sort(Triangles.begin(), Triangles.end());
+        return Triangles;
+    }
+
+    void MakeShuffledSphere(std::vector<FStandardVertex>& OutVertices, std::vector<uint32>& OutIndices)
+    {
+        ProceduralGeometry::Generate(FProceduralMeshDesc::Sphere(64, 32), OutVertices, OutIndices);
+
+        std::mt19937 Random(9);
+        const size_t TriangleCount = OutIndices.size() / 3;
+        for (size_t i = TriangleCount - 1; i > 0; --i)
+        {
+            const size_t j = Random() % (i + 1);
+            for (int Corner = 0; Corner < 3; ++Corner)
+            {
+                std::swap(OutIndices[i * 3 + Corner], OutIndices[j * 3 + Corner]);
+            }
+        }
+    }
+}
+
+KE_TEST(VertexCacheOrderKeepsTrianglesAndLowersACMR)
+{
+    std::vector<FStandardVertex> Vertices;
+    std::vector<uint32> Indices;
+    MakeShuffledSphere(Vertices, Indices);
+    const uint32 VertexCount = static_cast<uint32>(Vertices.size());
+    const uint32 IndexCount = static_cast<uint32>(Indices.size());
+
+    std::vector<uint32> Optimized(IndexCount);
+    MeshOptimizer::OptimizeVertexCache(Optimized.data(), Indices.data(), IndexCount, VertexCount);
+    KE_CHECK(GetTriangles(Vertices, Optimized) == GetTriangles(Vertices, Indices));
+
+    const FVertexCacheStats Before = MeshOptimizer::AnalyzeVertexCache(Indices.data(), IndexCount, VertexCount);
+    const FVertexCacheStats After = MeshOptimizer::AnalyzeVertexCache(Optimized.data(), IndexCount, VertexCount);
+    KE_CHECK(Before.ACMR > 1.5f);
+    KE_CHECK(After.ACMR < 0.8f);
+    KE_CHECK(After.ATVR >= 1.0f);
+}
+
+KE_TEST(OverdrawOrderKeepsTriangles)
+{
+    std::vector<FStandardVertex> Vertices;
+    std::vector<uint32> Indices;
+    MakeShuffledSphere(Vertices, Indices);
+    const uint32 VertexCount = static_cast<uint32>(Vertices.size());
+    const uint32 IndexCount = static_cast<uint32>(Indices.size());
+
+    std::vector<uint32> CacheOrder(IndexCount);
+    MeshOptimizer::OptimizeVertexCache(CacheOrder.data(), Indices.data(), IndexCount, VertexCount);
+    const float CacheACMR = MeshOptimizer::AnalyzeVertexCache(CacheOrder.data(), IndexCount, VertexCount).ACMR;
+
+    std::vector<uint32> Optimized(IndexCount);
+    const uint32 ClusterCount = MeshOptimizer::OptimizeOverdraw(Optimized.data(), CacheOrder.data(), IndexCount,
+                                                                Vertices[0].Position, VertexCount, sizeof(FStandardVertex));
+    KE_CHECK(ClusterCount >= 1);
+    KE_CHECK(GetTriangles(Vertices, Optimized) == GetTriangles(Vertices, Indices));
+
+    // Cluster reordering stays within the threshold (plus cluster boundary misses)
+    const float ACMR = MeshOptimizer::AnalyzeVertexCache(Optimized.data(), IndexCount, VertexCount).ACMR;
+    KE_CHECK(ACMR < CacheACMR * 1.2f);
+}
+
+KE_TEST(VertexFetchOrderDropsUnusedVertices)
+{
+    std::vector<FStandardVertex> Vertices;
+    std::vector<uint32> Indices;
+    MakeShuffledSphere(Vertices, Indices);
+    const std::vector<FTriangle> Expected = GetTriangles(Vertices, Indices);
+
+    std::vector<uint32> Referenced(Indices);
+    std::sort(Referenced.begin(), Referenced.end());
+    const size_t ReferencedCount = std::unique(Referenced.begin(), Referenced.end()) - Referenced.begin();
+
+    // Unreferenced vertices at the front and the back
+    Vertices.insert(Vertices.begin(), Vertices[5]);
+    Vertices.push_back(Vertices[7]);
+    for (uint32& Index : Indices)
+    {
+        ++Index;
+    }
+
+    const uint32 VertexCount = MeshOptimizer::OptimizeVertexFetch(Vertices.data(), static_cast<uint32>(Vertices.size()),
+                                                                  sizeof(FStandardVertex), Indices.data(),
+                                                                  static_cast<uint32>(Indices.size()));
+    KE_CHECK(VertexCount == ReferencedCount);
+    Vertices.resize(VertexCount);
+    KE_CHECK(GetTriangles(Vertices, Indices) == Expected);
+
+    // Vertices appear in order of first use
+    uint32 NextNew = 0;
+    for (uint32 Index : Indices)
+    {
+        KE_REQUIRE(Index <= NextNew);
+        NextNew += Index == NextNew ? 1 : 0;
+    }
+}
+
+KE_TEST(OptimizeMeshReportsStats)
+{
+    std::vector<FStandardVertex> Vertices;
+    std::vector<uint32> Indices;
+    MakeShuffledSphere(Vertices, Indices);
+    const std::vector<FTriangle> Expected = GetTriangles(Vertices, Indices);
+
+    uint32 VertexCount = static_cast<uint32>(Vertices.size());
+    const FMeshOptimizeStats Stats = MeshOptimizer::OptimizeMesh(Vertices.data(), VertexCount, sizeof(FStandardVertex),
+                                                                 Indices.data(), static_cast<uint32>(Indices.size()));
+    Vertices.resize(VertexCount);
+    KE_CHECK(GetTriangles(Vertices, Indices) == Expected);
+    KE_CHECK(Stats.After.ACMR < Stats.Before.ACMR);
+    KE_CHECK(Stats.Before.TriangleCount == Indices.size() / 3);
+}
+
+KE_TEST(SixteenBitConversion)
+{
+    const uint32 Indices[] = { 0, 1, 65535, 2 };
+    std::vector<uint16> Narrow;
+    MeshOptimizer::ConvertTo16BitIndices(Indices, 4, Narrow);
+    KE_REQUIRE(Narrow.size() == 4);
+    KE_CHECK(Narrow[2] == 65535);
+    KE_CHECK(MeshOptimizer::CanUse16BitIndices(65535));
+    KE_CHECK(!MeshOptimizer::CanUse16BitIndices(65536));
+}
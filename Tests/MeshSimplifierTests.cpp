@@ -0,0 +1,255 @@
+﻿#include "Test.h"
+#include "Graphics/MeshSimplifier.h"
+#include "Graphics/ProceduralGeometry.h"
+#include "Core/JobSystem.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+    struct FVec3
+    {
+        float X, Y, Z;
+    };
+
+    FVec3 operator-(const FVec3& A, const FVec3& B) { return { A.X - B.X, A.Y - B.Y, A.Z - B.Z }; }
+    FVec3 operator+(const FVec3& A, const FVec3& B) { return { A.X + B.X, A.Y + B.Y, A.Z + B.Z }; }
+    FVec3 operator*(const FVec3& A, float S) { return { A.X * S, A.Y * S, A.Z * S }; }
+    float Dot(const FVec3& A, const FVec3& B) { return A.X * B.X + A.Y * B.Y + A.Z * B.Z; }
+
+    FVec3 GetPosition(const std::vector<FStandardVertex>& Vertices, uint32 Index)
+    {
+        const float* Position = Vertices[Index].Position;
+        return { Position[0], Position[1], Position[2] };
+    }
+
+    /**
+     * @brief Distance from a point to a triangle (Ericson, Real-Time Collision Detection 5.1.5)
+     */
+    float GetPointTriangleDistance(const FVec3& P, const FVec3& A, const FVec3& B, const FVec3& C)
+    {
+        const FVec3 AB = B - A;
+        const FVec3 AC = C - A;
+        const FVec3 AP = P - A;
+        const float D1 = Dot(AB, AP);
+        const float D2 = Dot(AC, AP);
+        FVec3 Closest;
+        if (D1 <= 0.0f && D2 <= 0.0f)
+        {
+            Closest = A;
+        }
+        else
+        {
+            const FVec3 BP = P - B;
+            const float D3 = Dot(AB, BP);
+            const float D4 = Dot(AC, BP);
+            const FVec3 CP = P - C;
+            const float D5 = Dot(AB, CP);
+            const float D6 = Dot(AC, CP);
+            const float VC = D1 * D4 - D3 * D2;
+            const float VB = D5 * D2 - D1 * D6;
+            const float VA = D3 * D6 - D5 * D4;
+            if (D3 >= 0.0f && D4 <= D3)
+            {
+                Closest = B;
+            }
+            else if (D6 >= 0.0f && D5 <= D6)
+            {
+                Closest = C;
+            }
+            else if (VC <= 0.0f && D1 >= 0.0f && D3 <= 0.0f)
+            {
+                Closest = A + AB * (D1 / (D1 - D3));
+            }
+            else if (VB <= 0.0f && D2 >= 0.0f && D6 <= 0.0f)
+            {
+                Closest = A + AC * (D2 / (D2 - D6));
+            }
+            else if (VA <= 0.0f && (D4 - D3) >= 0.0f && (D5 - D6) >= 0.0f)
+            {
+                Closest = B + (C - B) * ((D4 - D3) / ((D4 - D3) + (D5 - D6)));
+            }
+            else
+            {
+                const float Denominator = 1.0f / (VA + VB + VC);
+                Closest = A + AB * (VB * Denominator) + AC * (VC * Denominator);
+            }
+        }
+        const FVec3 Delta = P - Closest;
+        return std::sqrt(Dot(Delta, Delta));
+    }
+
+    /**
+     * @brief Largest distance from a source vertex to the simplified surface, by brute force
+     */
+    float GetMaxDeviation(const std::vector<FStandardVertex>& Vertices, const std::vector<uint32>& SourceIndices,
+                          const uint32* Indices, uint32 IndexCount)
+    {
+        float MaxDistance = 0.0f;
+        for (uint32 Source : SourceIndices)
+        {
+            const FVec3 P = GetPosition(Vertices, Source);
+            float Distance = FLT_MAX;
+            for (uint32 i = 0; i < IndexCount; i += 3)
+            {
+                Distance = std::min(Distance, GetPointTriangleDistance(P, GetPosition(Vertices, Indices[i]),
+                                                                       GetPosition(Vertices, Indices[i + 1]),
+                                                                       GetPosition(Vertices, Indices[i + 2])));
+            }
+            MaxDistance = std::max(MaxDistance, Distance);
+        }
+        return MaxDistance;
+    }
+
+    bool HasValidTriangles(const uint32* Indices, uint32 IndexCount, uint32 VertexCount)
+    {
+        for (uint32 i = 0; i < IndexCount; i += 3)
+        {
+            const uint32 A = Indices[i];
+            const uint32 B = Indices[i + 1];
+            const uint32 C = Indices[i + 2];
+            if (A >= VertexCount || B >= VertexCount || C >= VertexCount || A == B || B == C || A == C)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+KE_TEST(SimplifyReachesTargetWithinReportedError)
+{
+    std::vector<FStandardVertex> Vertices;
+    std::vector<uint32> Indices;
+    ProceduralGeometry::Generate(FProceduralMeshDesc::Torus(48, 24, 1.0f, 0.3f), Vertices, Indices);
+    const uint32 VertexCount = static_cast<uint32>(Vertices.size());
+    const uint32 IndexCount = static_cast<uint32>(Indices.size());
+
+    for (const uint32 Divisor : { 2u, 4u, 8u, 16u })
+    {
+        const uint32 Target = IndexCount / Divisor / 3 * 3;
+        std::vector<uint32> Simplified(IndexCount);
+        float Error = -1.0f;
+        const uint32 Count = MeshSimplifier::Simplify(Simplified.data(), Indices.data(), IndexCount, Vertices[0].Position,
+                                                      VertexCount, sizeof(FStandardVertex), Target, 0.0f, false, &Error);
+        KE_CHECK(Count % 3 == 0);
+        KE_CHECK(Count <= Target);
+        KE_CHECK(Count > Target / 2);
+        KE_CHECK(HasValidTriangles(Simplified.data(), Count, VertexCount));
+        KE_CHECK(Error > 0.0f);
+
+        // The reported error is the measured deviation
+        const float Deviation = GetMaxDeviation(Vertices, Indices, Simplified.data(), Count);
+        KE_CHECK(Deviation <= Error);
+        KE_CHECK(Deviation >= Error * 0.999f);
+    }
+}
+
+KE_TEST(SimplifyStopsAtTargetError)
+{
+    std::vector<FStandardVertex> Vertices;
+    std::vector<uint32> Indices;
+    ProceduralGeometry::Generate(FProceduralMeshDesc::Sphere(48, 24), Vertices, Indices);
+    const uint32 IndexCount = static_cast<uint32>(Indices.size());
+
+    const float TargetError = 0.01f;
+    std::vector<uint32> Simplified(IndexCount);
+    float Error = -1.0f;
+    const uint32 Count = MeshSimplifier::Simplify(Simplified.data(), Indices.data(), IndexCount, Vertices[0].Position,
+                                                  static_cast<uint32>(Vertices.size()), sizeof(FStandardVertex),
+                                                  0, TargetError, false, &Error);
+    KE_CHECK(Count > 0);
+    KE_CHECK(Count < IndexCount);
+    KE_CHECK(Error <= TargetError);
+    KE_CHECK(GetMaxDeviation(Vertices, Indices, Simplified.data(), Count) <= TargetError);
+}
+
+KE_TEST(LockedBordersKeepEveryBorderVertex)
+{
+    std::vector<FStandardVertex> Vertices;
+    std::vector<uint32> Indices;
+    ProceduralGeometry::Generate(FProceduralMeshDesc::Plane(16, 16), Vertices, Indices);
+    const uint32 IndexCount = static_cast<uint32>(Indices.size());
+
+    std::vector<uint32> Simplified(IndexCount);
+    const uint32 Count = MeshSimplifier::Simplify(Simplified.data(), Indices.data(), IndexCount, Vertices[0].Position,
+                                                  static_cast<uint32>(Vertices.size()), sizeof(FStandardVertex),
+                                                  IndexCount / 8 / 3 * 3, 0.0f, true);
+    KE_CHECK(Count < IndexCount / 2);
+
+    std::vector<bool> Used(Vertices.size(), false);
+    for (uint32 i = 0; i < Count; ++i)
+    {
+        Used[Simplified[i]] = true;
+    }
+    for (size_t v = 0; v < Vertices.size(); ++v)
+    {
+        const float X = std::fabs(Vertices[v].Position[0]);
+        const float Z = std::fabs(Vertices[v].Position[2]);
+        if (X > 0.4999f || Z > 0.4999f)
+        {
+            KE_CHECK(Used[v]);
+        }
+    }
+}
+
+KE_TEST(LODChainShrinksAndMatchesSerialBuild)
+{
+    std::vector<FStandardVertex> Vertices;
+    std::vector<uint32> Indices;
+    ProceduralGeometry::Generate(FProceduralMeshDesc::Sphere(64, 32), Vertices, Indices);
+
+    FMeshLODSettings Settings;
+    Settings.MaxError = 1.0f;
+    std::vector<uint32> LODIndices;
+    std::vector<FMeshLOD> LODs;
+    MeshSimplifier::GenerateLODs(Indices.data(), static_cast<uint32>(Indices.size()), Vertices[0].Position,
+                                 static_cast<uint32>(Vertices.size()), sizeof(FStandardVertex), Settings, LODIndices, LODs);
+    KE_REQUIRE(LODs.size() == 4);
+    KE_CHECK(LODs[0].IndexCount == Indices.size());
+    KE_CHECK(std::equal(Indices.begin(), Indices.end(), LODIndices.begin()));
+
+    uint32 NextIndex = 0;
+    for (size_t i = 0; i < LODs.size(); ++i)
+    {
+        KE_CHECK(LODs[i].FirstIndex == NextIndex);
+        KE_CHECK(HasValidTriangles(&LODIndices[LODs[i].FirstIndex], LODs[i].IndexCount,
+                                   static_cast<uint32>(Vertices.size())));
+        NextIndex += LODs[i].IndexCount;
+        KE_CHECK(GetMaxDeviation(Vertices, Indices, &LODIndices[LODs[i].FirstIndex], LODs[i].IndexCount) <= LODs[i].Error);
+        if (i > 0)
+        {
+            KE_CHECK(LODs[i].IndexCount <= Settings.MinReduction * LODs[i - 1].IndexCount);
+            KE_CHECK(LODs[i].Error >= LODs[i - 1].Error);
+            KE_CHECK(LODs[i].ScreenSize <= LODs[i - 1].ScreenSize);
+        }
+    }
+    KE_CHECK(NextIndex == LODIndices.size());
+
+    KJobSystem JobSystem;
+    JobSystem.Initialize(3);
+    std::vector<uint32> ParallelIndices;
+    std::vector<FMeshLOD> ParallelLODs;
+    MeshSimplifier::GenerateLODs(Indices.data(), static_cast<uint32>(Indices.size()), Vertices[0].Position,
+                                 static_cast<uint32>(Vertices.size()), sizeof(FStandardVertex), Settings,
+                                 ParallelIndices, ParallelLODs, &JobSystem);
+    JobSystem.Shutdown();
+    KE_CHECK(ParallelIndices == LODIndices);
+    KE_CHECK(ParallelLODs.size() == LODs.size());
+}
+
+KE_TEST(SelectLODByScreenSize)
+{
+    FMeshLOD LODs[3];
+    LODs[0].ScreenSize = FLT_MAX;
+    LODs[1].ScreenSize = 0.5f;
+    LODs[2].ScreenSize = 0.1f;
+
+    KE_CHECK(MeshSimplifier::SelectLOD(LODs, 3, 2.0f) == 0);
+    KE_CHECK(MeshSimplifier::SelectLOD(LODs, 3, 0.5f) == 1);
+    KE_CHECK(MeshSimplifier::SelectLOD(LODs, 3, 0.2f) == 1);
+    KE_CHECK(MeshSimplifier::SelectLOD(LODs, 3, 0.05f) == 2);
+    KE_CHECK(MeshSimplifier::SelectLOD(LODs, 1, 0.05f) == 0);
+}
@@ -0,0 +1,152 @@
+﻿#include "Test.h"
+#include "RHI/NullRHI.h"
+
+#include <cstring>
+
+namespace
+{
+    FRHIResource CreateTestBuffer(KNullRHIDevice& Device, const uint8* Data, uint32 Size)
+    {
+        FRHIBufferDesc Desc;
+        Desc.ByteWidth = Size;
+        Desc.BindFlags = RHIBindFlags::VertexBuffer;
+        return Device.CreateBuffer(Desc, Data);
+    }
+}
+
+KE_TEST(BufferRegionsAreUpdatedInBounds)
+{
+    KNullRHIDevice Device;
+    KNullCommandContext& Context = Device.GetNullContext();
+    const uint8 Zeros[8] = {};
+    FRHIResourceRef Buffer(&Device, CreateTestBuffer(Device, Zeros, 8));
+
+    const uint8 Data[3] = { 1, 2, 3 };
+    Context.UpdateBufferRegion(Buffer.Get(), 4, Data, 3);
+    const uint8* Storage = KNullRHIDevice::GetStorage(Buffer.Get());
+    KE_CHECK(Storage[3] == 0 && Storage[4] == 1 && Storage[6] == 3 && Storage[7] == 0);
+
+    // Past the end: recorded, but the storage is left alone
+    Context.UpdateBufferRegion(Buffer.Get(), 6, Data, 3);
+    KE_CHECK(Storage[6] == 3 && Storage[7] == 0);
+    KE_CHECK(Context.GetCommandCount(ENullRHICommand::UpdateBufferRegion) == 2);
+
+    // Whole-buffer updates larger than the buffer are ignored the same way
+    const uint8 Oversized[16] = { 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9 };
+    Context.UpdateBuffer(Buffer.Get(), Oversized, 16);
+    KE_CHECK(Storage[0] == 0 && Storage[4] == 1);
+    Context.UpdateBuffer(Buffer.Get(), Oversized, 8);
+    KE_CHECK(Storage[0] == 9 && Storage[7] == 9);
+    KE_CHECK(Context.GetCommandCount(ENullRHICommand::UpdateBuffer) == 2);
+}
+
+KE_TEST(BufferRegionsAreCopied)
+{
+    KNullRHIDevice Device;
+    KNullCommandContext& Context = Device.GetNullContext();
+    const uint8 SourceData[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    const uint8 Zeros[8] = {};
+    FRHIResourceRef Source(&Device, CreateTestBuffer(Device, SourceData, 8));
+    FRHIResourceRef Destination(&Device, CreateTestBuffer(Device, Zeros, 8));
+
+    Context.CopyBufferRegion(Destination.Get(), 2, Source.Get(), 4, 4);
+    const uint8 Expected[8] = { 0, 0, 5, 6, 7, 8, 0, 0 };
+    KE_CHECK(memcmp(KNullRHIDevice::GetStorage(Destination.Get()), Expected, 8) == 0);
+
+    // Out of range on either side is ignored
+    Context.CopyBufferRegion(Destination.Get(), 6, Source.Get(), 0, 4);
+    Context.CopyBufferRegion(Destination.Get(), 0, Source.Get(), 6, 4);
+    KE_CHECK(memcmp(KNullRHIDevice::GetStorage(Destination.Get()), Expected, 8) == 0);
+    KE_CHECK(Context.GetCommandCount(ENullRHICommand::CopyBufferRegion) == 3);
+}
+
+KE_TEST(StateObjectsAndFencesAreCreated)
+{
+    KNullRHIDevice Device;
+    KNullCommandContext& Context = Device.GetNullContext();
+    {
+        FRHIDepthStencilDesc DepthDesc;
+        DepthDesc.bDepthWrite = false;
+        DepthDesc.DepthFunc = ERHIComparison::LessEqual;
+        FRHIResourceRef Sampler(&Device, Device.CreateSampler(FRHISamplerDesc()));
+        FRHIResourceRef DepthState(&Device, Device.CreateDepthStencilState(DepthDesc));
+        FRHIResourceRef Fence(&Device, Device.CreateFence());
+        KE_CHECK(Sampler && DepthState && Fence);
+        KE_CHECK(Device.GetLiveResourceCount() == 3);
+
+        Context.SignalFence(Fence.Get());
+        KE_CHECK(Context.GetCommandCount(ENullRHICommand::SignalFence) == 1);
+        KE_CHECK(Context.IsFenceReached(Fence.Get(), false));
+        KE_CHECK(Device.SupportsConstantBufferRanges());
+    }
+    KE_CHECK(Device.GetLiveResourceCount() == 0);
+}
+
+KE_TEST(ShadersCompileToTheirSource)
+{
+    KNullRHIDevice Device;
+    std::vector<uint8> Bytecode;
+    std::string Errors;
+    KE_CHECK(Device.CompileShader(EShaderType::Vertex, "float4 VS() : SV_POSITION { return 0; }", "Test.hlsl", "VS",
+                                  Bytecode, Errors));
+    KE_CHECK(!Bytecode.empty() && Errors.empty());
+
+    FRHIResourceRef Shader(&Device, Device.CreateShader(EShaderType::Vertex, Bytecode.data(), Bytecode.size()));
+    KE_CHECK(Shader);
+
+    KE_CHECK(!Device.CompileShader(EShaderType::Pixel, "", "Empty.hlsl", "PS", Bytecode, Errors));
+    KE_CHECK(Bytecode.empty());
+}
+
+KE_TEST(ResourceRefsReleaseOnce)
+{
+    KNullRHIDevice Device;
+    FRHIResourceRef First(&Device, Device.CreateFence());
+    FRHIResourceRef Second(&Device, Device.CreateFence());
+    KE_CHECK(Device.GetLiveResourceCount() == 2);
+
+    // Moving transfers ownership and releases the overwritten resource
+    const FRHIResource Moved = First.Get();
+    Second = std::move(First);
+    KE_CHECK(!First && Second.Get() == Moved);
+    KE_CHECK(Device.GetLiveResourceCount() == 1);
+
+    FRHIResourceRef Third(std::move(Second));
+    KE_CHECK(!Second && Third.Get() == Moved);
+    Second.Reset();
+    KE_CHECK(Device.GetLiveResourceCount() == 1);
+
+    Third.Reset();
+    KE_CHECK(!Third && Device.GetLiveResourceCount() == 0);
+}
+
+KE_TEST(ResourceRefsKeepASharedDeviceAlive)
+{
+    // A mesh or pool destroyed after the engine dropped its device still releases through it
+    std::shared_ptr<KNullRHIDevice> Device = std::make_shared<KNullRHIDevice>();
+    std::weak_ptr<KNullRHIDevice> WeakDevice = Device;
+    const uint8 Data[16] = {};
+    FRHIResourceRef VertexBuffer(Device.get(), CreateTestBuffer(*Device, Data, 16));
+    FRHIResourceRef IndexBuffer;
+    IndexBuffer.Reset(Device.get(), CreateTestBuffer(*Device, Data, 16));
+    KE_CHECK(RHI::ShareDevice(Device.get()).get() == Device.get());
+
+    Device.reset();
+    KE_CHECK(!WeakDevice.expired());
+    KE_CHECK(WeakDevice.lock()->GetLiveResourceCount() == 2);
+
+    VertexBuffer.Reset();
+    KE_CHECK(WeakDevice.lock()->GetLiveResourceCount() == 1);
+    FRHIResourceRef Moved(std::move(IndexBuffer));
+    KE_CHECK(!WeakDevice.expired());
+    Moved.Reset();
+    KE_CHECK(WeakDevice.expired());
+}
+
+KE_TEST(ResourceRefsDoNotOwnAnUnsharedDevice)
+{
+    KNullRHIDevice Device;
+    std::shared_ptr<IRHIDevice> Shared = RHI::ShareDevice(&Device);
+    KE_CHECK(Shared.get() == &Device && Shared.use_count() == 0);
+    KE_CHECK(!RHI::ShareDevice(nullptr));
+}
@@ -0,0 +1,373 @@
+﻿#include "Test.h"
+#include "TestScene.h"
+#include "Graphics/OcclusionCuller.h"
+#include "Graphics/FrustumCuller.h"
+#include "Core/JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace
+{
+    FBoundingBox MakeBox(float X, float Y, float Z, float ExtentX, float ExtentY, float ExtentZ)
+    {
+        FBoundingBox Box;
+        Box.Center[0] = X;
+        Box.Center[1] = Y;
+        Box.Center[2] = Z;
+        Box.Extents[0] = ExtentX;
+        Box.Extents[1] = ExtentY;
+        Box.Extents[2] = ExtentZ;
+        return Box;
+    }
+
+    /**
+     * @brief Whether the segment from Origin to Origin + Direction passes through Box
+     */
+    bool SegmentHitsBox(const float Origin[3], const float Direction[3], const FBoundingBox& Box)
+    {
+        float Enter = 0.0f;
+        float Exit = 1.0f;
+        for (uint32 Axis = 0; Axis < 3; ++Axis)
+        {
+            const float Min = Box.Center[Axis] - Box.Extents[Axis];
+            const float Max = Box.Center[Axis] + Box.Extents[Axis];
+            if (Direction[Axis] == 0.0f)
+            {
+                if (Origin[Axis] < Min || Origin[Axis] > Max)
+                {
+                    return false;
+                }
+                continue;
+            }
+            const float A = (Min - Origin[Axis]) / Direction[Axis];
+            const float B = (Max - Origin[Axis]) / Direction[Axis];
+            Enter = std::max(Enter, std::min(A, B));
+            Exit = std::min(Exit, std::max(A, B));
+        }
+        return Enter <= Exit;
+    }
+
+    /**
+     * @brief Whether some point of a 5 x 5 x 5 lattice over Box can be seen from Eye past the buildings
+     *
+     * The depth buffer samples pixel centers, so a building may hide what passes
+     * less than half a pixel beside it: each building is grown by half PixelAngle
+     * times its farthest distance from Eye.
+     */
+    bool IsBoxSeen(const float Eye[3], const FBoundingBox& Box, const std::vector<FBoundingBox>& Buildings, float PixelAngle)
+    {
+        std::vector<FBoundingBox> Grown = Buildings;
+        for (FBoundingBox& Building : Grown)
+        {
+            float FarthestSquared = 0.0f;
+            for (uint32 Axis = 0; Axis < 3; ++Axis)
+            {
+                const float Delta = std::fabs(Eye[Axis] - Building.Center[Axis]) + Building.Extents[Axis];
+                FarthestSquared += Delta * Delta;
+            }
+            const float Margin = 0.5f * PixelAngle * std::sqrt(FarthestSquared);
+            for (uint32 Axis = 0; Axis < 3; ++Axis)
+            {
+                Building.Extents[Axis] += Margin;
+            }
+        }
+
+        constexpr int Steps = 2;
+        for (int X = -Steps; X <= Steps; ++X)
+        {
+            for (int Y = -Steps; Y <= Steps; ++Y)
+            {
+                for (int Z = -Steps; Z <= Steps; ++Z)
+                {
+                    const float Point[3] = { Box.Center[0] + Box.Extents[0] * X / Steps,
+                                             Box.Center[1] + Box.Extents[1] * Y / Steps,
+                                             Box.Center[2] + Box.Extents[2] * Z / Steps };
+                    // Stop just short of the point so a box touching a building is not blocked by it
+                    const float Direction[3] = { 0.999f * (Point[0] - Eye[0]), 0.999f * (Point[1] - Eye[1]),
+                                                 0.999f * (Point[2] - Eye[2]) };
+                    bool bBlocked = false;
+                    for (const FBoundingBox& Building : Grown)
+                    {
+                        if (SegmentHitsBox(Eye, Direction, Building))
+                        {
+                            bBlocked = true;
+                            break;
+                        }
+                    }
+                    if (!bBlocked)
+                    {
+                        return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    struct FCityView
+    {
+        float Eye[3];
+        float At[3];
+    };
+
+    /**
+     * @brief Street-level cameras looking along and across streets, and a few above the roofs
+     */
+    std::vector<FCityView> MakeCityViews(uint32 BlockCount)
+    {
+        std::vector<FCityView> Views;
+        for (uint32 View = 0; View < 12; ++View)
+        {
+            const float Street = 70.0f + 80.0f * static_cast<float>(View % BlockCount);
+            const float Along = 10.0f + 37.0f * static_cast<float>(View);
+            const float Height = View < 9 ? 1.8f : 60.0f;
+            const float Turn = View % 3 == 0 ? 30.0f : (View % 3 == 1 ? -20.0f : 5.0f);
+            FCityView City = { { Street, Height, Along }, { Street + Turn, View < 9 ? 1.8f : 20.0f, Along + 100.0f } };
+            if (View % 2 == 1)
+            {
+                std::swap(City.Eye[0], City.Eye[2]);
+                std::swap(City.At[0], City.At[2]);
+            }
+            Views.push_back(City);
+        }
+        return Views;
+    }
+
+    void BeginView(KOcclusionCuller& Culler, const float Eye[3], const float At[3], float OutViewProjection[16])
+    {
+        TestScene::MakeViewProjection(Eye, At, 1.0f, 2.0f, 0.5f, 3000.0f, OutViewProjection);
+        Culler.BeginFrame(OutViewProjection);
+    }
+
+    void AddBoxOccluder(KOcclusionCuller& Culler, const FOccluderMesh& Cube, const FBoundingBox& Box)
+    {
+        float World[16];
+        TestScene::MakeBoxMatrix(Box, World);
+        Culler.AddOccluder(Cube, World);
+    }
+}
+
+KE_TEST(EmptyFrameCullsNothing)
+{
+    KOcclusionCuller Culler(FOcclusionCullerSettings{});
+    const float Eye[3] = { 0.0f, 0.0f, 0.0f };
+    const float At[3] = { 0.0f, 0.0f, 1.0f };
+    float ViewProjection[16];
+    BeginView(Culler, Eye, At, ViewProjection);
+    Culler.Rasterize();
+
+    KE_CHECK(Culler.IsRasterized());
+    KE_CHECK(Culler.GetStats().OccluderCount == 0);
+    const std::vector<float>& Depth = Culler.GetDepthBuffer();
+    KE_CHECK(Depth.size() == Culler.GetWidth() * Culler.GetHeight());
+    KE_CHECK(std::all_of(Depth.begin(), Depth.end(), [](float Value) { return Value == 1.0f; }));
+    KE_CHECK(Culler.IsBoxVisible(MakeBox(0.0f, 0.0f, 100.0f, 1.0f, 1.0f, 1.0f)));
+}
+
+KE_TEST(WallHidesBoxesBehindIt)
+{
+    KOcclusionCuller Culler(FOcclusionCullerSettings{});
+    const FOccluderMesh Cube = TestScene::MakeUnitCube();
+    const float Eye[3] = { 0.0f, 0.0f, 0.0f };
+    const float At[3] = { 0.0f, 0.0f, 1.0f };
+    float ViewProjection[16];
+    BeginView(Culler, Eye, At, ViewProjection);
+
+    // A wall 20 m ahead, 20 m wide, 40 m tall and 1 m thick
+    AddBoxOccluder(Culler, Cube, MakeBox(0.0f, 0.0f, 20.0f, 10.0f, 20.0f, 0.5f));
+    Culler.Rasterize();
+    KE_CHECK(Culler.GetStats().OccluderCount == 1);
+    KE_CHECK(Culler.GetStats().TriangleCount > 0);
+
+    KE_CHECK(!Culler.IsBoxVisible(MakeBox(0.0f, 0.0f, 40.0f, 1.0f, 1.0f, 1.0f)));
+    KE_CHECK(!Culler.IsBoxVisible(MakeBox(2.0f, -5.0f, 100.0f, 10.0f, 10.0f, 10.0f)));
+
+    // In front of the wall, touching it, peeking past its edge, around the camera, behind the camera
+    KE_CHECK(Culler.IsBoxVisible(MakeBox(0.0f, 0.0f, 10.0f, 1.0f, 1.0f, 1.0f)));
+    KE_CHECK(Culler.IsBoxVisible(MakeBox(0.0f, 0.0f, 20.0f, 1.0f, 1.0f, 1.0f)));
+    KE_CHECK(Culler.IsBoxVisible(MakeBox(21.0f, 0.0f, 40.0f, 3.0f, 1.0f, 1.0f)));
+    KE_CHECK(Culler.IsBoxVisible(MakeBox(0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f)));
+    KE_CHECK(Culler.IsBoxVisible(MakeBox(0.0f, 0.0f, -30.0f, 1.0f, 1.0f, 1.0f)));
+}
+
+KE_TEST(ResetDropsOccludersAndDepth)
+{
+    KOcclusionCuller Culler(FOcclusionCullerSettings{});
+    const FOccluderMesh Cube = TestScene::MakeUnitCube();
+    const float Eye[3] = { 0.0f, 0.0f, 0.0f };
+    const float At[3] = { 0.0f, 0.0f, 1.0f };
+    float ViewProjection[16];
+    BeginView(Culler, Eye, At, ViewProjection);
+    AddBoxOccluder(Culler, Cube, MakeBox(0.0f, 0.0f, 20.0f, 10.0f, 20.0f, 0.5f));
+    Culler.Rasterize();
+    const FBoundingBox Hidden = MakeBox(0.0f, 0.0f, 40.0f, 1.0f, 1.0f, 1.0f);
+    KE_REQUIRE(!Culler.IsBoxVisible(Hidden));
+
+    Culler.Reset();
+    KE_CHECK(!Culler.IsRasterized() && Culler.GetOccluderCount() == 0);
+    KE_CHECK(Culler.GetDepthBuffer().empty() && Culler.GetStats().OccluderCount == 0);
+    KE_CHECK(Culler.IsBoxVisible(Hidden));
+
+    // Re-initialized, the first frame starts without the old wall
+    Culler.Initialize(FOcclusionCullerSettings{});
+    BeginView(Culler, Eye, At, ViewProjection);
+    Culler.Rasterize();
+    KE_CHECK(Culler.IsBoxVisible(Hidden));
+}
+
+KE_TEST(OneSidedOccluderOnlyHidesFromItsFront)
+{
+    // A single quad in the z = 20 plane, facing the camera only when the winding is reversed
+    FOccluderMesh Quad;
+    Quad.Positions = { -20.0f, -20.0f, 20.0f, 20.0f, -20.0f, 20.0f, -20.0f, 20.0f, 20.0f, 20.0f, 20.0f, 20.0f };
+    Quad.Indices = { 0, 1, 2, 2, 1, 3 };
+    Quad.Bounds = Bounds::ComputeBox(Quad.Positions.data(), 4, 3 * sizeof(float));
+    const float Identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+    const FBoundingBox Hidden = MakeBox(0.0f, 0.0f, 40.0f, 1.0f, 1.0f, 1.0f);
+
+    KOcclusionCuller Culler(FOcclusionCullerSettings{});
+    const float Eye[3] = { 0.0f, 0.0f, 0.0f };
+    const float At[3] = { 0.0f, 0.0f, 1.0f };
+    float ViewProjection[16];
+    bool bVisible[2][2];
+    for (uint32 Winding = 0; Winding < 2; ++Winding)
+    {
+        for (uint32 TwoSided = 0; TwoSided < 2; ++TwoSided)
+        {
+            FOccluderMesh Mesh = Quad;
+            Mesh.bTwoSided = TwoSided == 1;
+            if (Winding == 1)
+            {
+                std::swap(Mesh.Indices[1], Mesh.Indices[2]);
+                std::swap(Mesh.Indices[4], Mesh.Indices[5]);
+            }
+            BeginView(Culler, Eye, At, ViewProjection);
+            Culler.AddOccluder(Mesh, Identity);
+            Culler.Rasterize();
+            bVisible[Winding][TwoSided] = Culler.IsBoxVisible(Hidden);
+        }
+    }
+
+    // The quad is counter-clockwise on screen, so only the swapped winding is a front face;
+    // two-sided occluders hide either way
+    KE_CHECK(bVisible[0][0]);
+    KE_CHECK(!bVisible[1][0]);
+    KE_CHECK(!bVisible[0][1] && !bVisible[1][1]);
+}
+
+KE_TEST(CityNeverCullsVisibleObjects)
+{
+    std::mt19937 Random(25);
+    constexpr uint32 BlockCount = 8;
+    std::vector<FBoundingBox> Buildings;
+    TestScene::MakeCity(Random, BlockCount, Buildings);
+
+    // Street furniture and vehicles, some inside buildings, some on the roofs' level
+    KFrustumCuller Boxes;
+    std::uniform_real_distribution<float> Position(0.0f, 80.0f * BlockCount);
+    std::uniform_real_distribution<float> Size(0.25f, 2.5f);
+    for (uint32 i = 0; i < 4000; ++i)
+    {
+        const float Extent = Size(Random);
+        const float Y = i % 10 == 0 ? 90.0f * Position(Random) / (80.0f * BlockCount) : Extent;
+        Boxes.Add(MakeBox(Position(Random), Y, Position(Random), Extent, Extent, Extent));
+    }
+
+    const FOccluderMesh Cube = TestScene::MakeUnitCube();
+    KOcclusionCuller Culler(FOcclusionCullerSettings{});
+    std::vector<uint32> Indices;
+
+    // Angle of one pixel at the center of the view (vertical field of view of 1 radian)
+    const float PixelAngle = 2.0f * std::tan(0.5f) / static_cast<float>(Culler.GetHeight());
+    uint64 InFrustum = 0;
+    uint64 Occluded = 0;
+    for (const FCityView& View : MakeCityViews(BlockCount))
+    {
+        float ViewProjection[16];
+        BeginView(Culler, View.Eye, View.At, ViewProjection);
+        for (const FBoundingBox& Building : Buildings)
+        {
+            AddBoxOccluder(Culler, Cube, Building);
+        }
+        Culler.Rasterize();
+
+        FFrustum Frustum;
+        Bounds::ExtractFrustumPlanes(ViewProjection, Frustum);
+        Boxes.Cull(Frustum, Indices);
+        const std::vector<uint32> Before = Indices;
+        Culler.Cull(Boxes, Indices);
+        InFrustum += Before.size();
+        Occluded += Before.size() - Indices.size();
+        KE_CHECK(Culler.GetStats().Tested == Before.size());
+        KE_CHECK(Culler.GetStats().Occluded == Before.size() - Indices.size());
+
+        // Every box the culler removed must be hidden from every lattice point, to within half a pixel
+        KE_CHECK(std::includes(Before.begin(), Before.end(), Indices.begin(), Indices.end()));
+        for (const uint32 Index : Before)
+        {
+            if (!std::binary_search(Indices.begin(), Indices.end(), Index))
+            {
+                KE_CHECK(!IsBoxSeen(View.Eye, Boxes.GetBox(Index), Buildings, PixelAngle));
+            }
+        }
+    }
+
+    // And it removes a useful share of what the frustum keeps
+    KE_CHECK(InFrustum > 0);
+    KE_CHECK(Occluded * 2 > InFrustum);
+}
+
+KE_TEST(ParallelRasterizeMatchesSerial)
+{
+    std::mt19937 Random(26);
+    std::vector<FBoundingBox> Buildings;
+    TestScene::MakeCity(Random, 6, Buildings);
+    KFrustumCuller Boxes;
+    for (uint32 i = 0; i < 20000; ++i)
+    {
+        FBoundingBox Box = TestScene::RandomBox(Random, 240.0f, 0.25f, 2.0f);
+        Box.Center[0] += 240.0f;
+        Box.Center[1] = Box.Extents[1];
+        Box.Center[2] += 240.0f;
+        Boxes.Add(Box);
+    }
+
+    const FOccluderMesh Cube = TestScene::MakeUnitCube();
+    KJobSystem JobSystem;
+    JobSystem.Initialize(3);
+    FOcclusionCullerSettings Settings;
+    Settings.Width = 320;
+    Settings.Height = 180;
+    KOcclusionCuller Serial(Settings);
+    KOcclusionCuller Parallel(Settings);
+    KE_CHECK(Serial.GetWidth() % KOcclusionCuller::TileWidth == 0 && Serial.GetWidth() >= 320);
+    KE_CHECK(Serial.GetHeight() % KOcclusionCuller::TileHeight == 0 && Serial.GetHeight() >= 180);
+
+    for (const FCityView& View : MakeCityViews(6))
+    {
+        float ViewProjection[16];
+        BeginView(Serial, View.Eye, View.At, ViewProjection);
+        BeginView(Parallel, View.Eye, View.At, ViewProjection);
+        for (const FBoundingBox& Building : Buildings)
+        {
+            AddBoxOccluder(Serial, Cube, Building);
+            AddBoxOccluder(Parallel, Cube, Building);
+        }
+        Serial.Rasterize();
+        Parallel.Rasterize(&JobSystem);
+        KE_CHECK(Serial.GetDepthBuffer() == Parallel.GetDepthBuffer());
+        KE_CHECK(Serial.GetStats().TriangleCount == Parallel.GetStats().TriangleCount);
+
+        FFrustum Frustum;
+        Bounds::ExtractFrustumPlanes(ViewProjection, Frustum);
+        std::vector<uint32> SerialIndices;
+        Boxes.Cull(Frustum, SerialIndices);
+        std::vector<uint32> ParallelIndices = SerialIndices;
+        Serial.Cull(Boxes, SerialIndices);
+        Parallel.Cull(Boxes, ParallelIndices, &JobSystem);
+        KE_CHECK(SerialIndices == ParallelIndices);
+    }
+    JobSystem.Shutdown();
+}
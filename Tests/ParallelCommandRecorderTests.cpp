@@ -0,0 +1,207 @@
+﻿#include "Test.h"
+#include "Graphics/ParallelCommandRecorder.h"
+#include "RHI/NullRHI.h"
+
+#include <random>
+
+namespace
+{
+    const int Handles[64] = {};
+    const void* Handle(uint32 Index) { return &Handles[Index % 64]; }
+
+    struct FDraw
+    {
+        uint32 Shader;
+        uint32 Texture;
+        uint32 Mesh;
+        uint32 IndexCount;
+    };
+
+    std::vector<FDraw> MakeDraws(uint32 Count)
+    {
+        std::mt19937 Random(7);
+        std::vector<FDraw> Draws(Count);
+        for (uint32 i = 0; i < Count; ++i)
+        {
+            // Runs of shared state, as in a sorted queue, so the state cache skips calls
+            Draws[i].Shader = (i / 37) % 4;
+            Draws[i].Texture = (i / 5) % 8;
+            Draws[i].Mesh = static_cast<uint32>(Random() % 16);
+            Draws[i].IndexCount = 3 * (1 + i);
+        }
+        return Draws;
+    }
+
+    /**
+     * @brief Bind a draw's state on State (a context or a state cache) and draw it on Context
+     */
+    template<typename StateType>
+    void RecordDraw(StateType& State, IRHICommandContext& Context, const FDraw& Draw)
+    {
+        State.SetInputLayout(Handle(Draw.Shader));
+        State.SetShader(EShaderType::Vertex, Handle(4 + Draw.Shader));
+        State.SetShader(EShaderType::Pixel, Handle(8 + Draw.Shader));
+        State.SetPrimitiveTopology(EPrimitiveTopology::TriangleList);
+        State.SetShaderResource(EShaderType::Pixel, 0, Handle(16 + Draw.Texture));
+        State.SetVertexBuffer(0, Handle(32 + Draw.Mesh), 32, 0);
+        State.SetIndexBuffer(Handle(48 + Draw.Mesh), EIndexFormat::UInt16, 0);
+        Context.DrawIndexed(Draw.IndexCount, 0, 0);
+    }
+
+    void CheckChunks(uint32 ItemCount, uint32 MaxChunks, uint32 MinItemsPerChunk)
+    {
+        std::vector<FCommandChunk> Chunks;
+        KParallelCommandRecorder::BuildChunks(ItemCount, MaxChunks, MinItemsPerChunk, Chunks);
+        if (ItemCount == 0)
+        {
+            KE_CHECK(Chunks.empty());
+            return;
+        }
+
+        KE_REQUIRE(!Chunks.empty());
+        KE_CHECK(Chunks.size() <= (MaxChunks > 0 ? MaxChunks : 1));
+        KE_CHECK(Chunks.size() <= ItemCount);
+
+        // Contiguous and in order from 0, so every item is covered exactly once
+        uint32 Next = 0;
+        uint32 Smallest = Chunks[0].Count;
+        uint32 Largest = Chunks[0].Count;
+        for (const FCommandChunk& Chunk : Chunks)
+        {
+            KE_CHECK(Chunk.First == Next);
+            KE_CHECK(Chunk.Count > 0);
+            Next = Chunk.First + Chunk.Count;
+            Smallest = Chunk.Count < Smallest ? Chunk.Count : Smallest;
+            Largest = Chunk.Count > Largest ? Chunk.Count : Largest;
+        }
+        KE_CHECK(Next == ItemCount);
+        KE_CHECK(Largest - Smallest <= 1);
+
+        // Only a single chunk may be smaller than MinItemsPerChunk
+        if (Chunks.size() > 1)
+        {
+            KE_CHECK(Smallest >= MinItemsPerChunk);
+        }
+    }
+}
+
+KE_TEST(ChunksCoverEveryItemOnceAndAreBalanced)
+{
+    for (uint32 ItemCount : { 0u, 1u, 2u, 7u, 100u, 127u, 128u, 129u, 1000u, 4097u, 100000u })
+    {
+        for (uint32 MaxChunks : { 0u, 1u, 2u, 3u, 8u, 64u })
+        {
+            for (uint32 MinItemsPerChunk : { 0u, 1u, 16u, 128u, 1000u })
+            {
+                CheckChunks(ItemCount, MaxChunks, MinItemsPerChunk);
+            }
+        }
+    }
+}
+
+KE_TEST(ChunksRespectMinimumSizeAndFewItems)
+{
+    std::vector<FCommandChunk> Chunks;
+
+    // Fewer items than chunks: one chunk per MinItemsPerChunk items at most
+    KParallelCommandRecorder::BuildChunks(5, 8, 1, Chunks);
+    KE_REQUIRE(Chunks.size() == 5);
+    for (uint32 i = 0; i < 5; ++i)
+    {
+        KE_CHECK(Chunks[i].First == i && Chunks[i].Count == 1);
+    }
+
+    // Too few items for two chunks of the minimum size
+    KParallelCommandRecorder::BuildChunks(200, 8, 128, Chunks);
+    KE_REQUIRE(Chunks.size() == 1);
+    KE_CHECK(Chunks[0].First == 0 && Chunks[0].Count == 200);
+
+    // The minimum size limits the count below MaxChunks; the remainder goes to the first chunks
+    KParallelCommandRecorder::BuildChunks(1000, 16, 300, Chunks);
+    KE_REQUIRE(Chunks.size() == 3);
+    KE_CHECK(Chunks[0].First == 0 && Chunks[0].Count == 334);
+    KE_CHECK(Chunks[1].First == 334 && Chunks[1].Count == 333);
+    KE_CHECK(Chunks[2].First == 667 && Chunks[2].Count == 333);
+
+    // MaxChunks limits the count
+    KParallelCommandRecorder::BuildChunks(1000, 4, 1, Chunks);
+    KE_REQUIRE(Chunks.size() == 4);
+    KE_CHECK(Chunks[3].First == 750 && Chunks[3].Count == 250);
+}
+
+KE_TEST(ParallelRecordingReplaysLikeSerialRecording)
+{
+    const std::vector<FDraw> Draws = MakeDraws(5000);
+    const uint32 DrawCount = static_cast<uint32>(Draws.size());
+
+    KNullRHIDevice Device;
+    KNullCommandContext& Immediate = Device.GetNullContext();
+    Immediate.SetRecording(true);
+
+    KJobSystem JobSystem;
+    JobSystem.Initialize(3);
+    KParallelCommandRecorder Recorder;
+    KE_REQUIRE(Recorder.Initialize(&Device, &JobSystem, 6));
+    KE_CHECK(Recorder.GetMaxChunks() == 6);
+
+    // Without state caching, the replayed stream is exactly the serial one
+    for (const FDraw& Draw : Draws)
+    {
+        RecordDraw(Immediate, Immediate, Draw);
+    }
+    const std::vector<uint8> Serial = Immediate.GetRecordedStream();
+
+    const uint32 ListCount = Recorder.Record(DrawCount, [&](KRenderStateCache&, IRHICommandContext& Context,
+                                                            uint32 First, uint32 Count)
+    {
+        for (uint32 i = First; i < First + Count; ++i)
+        {
+            RecordDraw(Context, Context, Draws[i]);
+        }
+    }, 64);
+    KE_CHECK(ListCount == 6);
+    Immediate.Reset();
+    Recorder.Execute();
+    KE_CHECK(Immediate.GetRecordedStream() == Serial);
+    KE_CHECK(Immediate.GetDrawCallCount() == DrawCount);
+
+    // Through the chunks' state caches, it matches a serial recording that starts each chunk
+    // from default state
+    const uint32 CachedListCount = Recorder.Record(DrawCount, [&](KRenderStateCache& StateCache, IRHICommandContext& Context,
+                                                                  uint32 First, uint32 Count)
+    {
+        for (uint32 i = First; i < First + Count; ++i)
+        {
+            RecordDraw(StateCache, Context, Draws[i]);
+        }
+    }, 64);
+    KE_REQUIRE(CachedListCount == Recorder.GetChunks().size());
+
+    Immediate.Reset();
+    KRenderStateCache SerialCache(&Immediate);
+    for (const FCommandChunk& Chunk : Recorder.GetChunks())
+    {
+        SerialCache.Invalidate();
+        for (uint32 i = Chunk.First; i < Chunk.First + Chunk.Count; ++i)
+        {
+            RecordDraw(SerialCache, Immediate, Draws[i]);
+        }
+    }
+    const std::vector<uint8> SerialCached = Immediate.GetRecordedStream();
+    KE_CHECK(SerialCached.size() < Serial.size());
+    KE_CHECK(Recorder.GetStats().CallsSkipped > 0);
+
+    Immediate.Reset();
+    Recorder.Execute();
+    KE_CHECK(Immediate.GetRecordedStream() == SerialCached);
+    KE_CHECK(Immediate.GetDrawCallCount() == DrawCount);
+
+    // Lists are consumed by Execute: a second one replays nothing
+    Immediate.Reset();
+    Recorder.Execute();
+    KE_CHECK(Immediate.GetTotalCommandCount() == 0);
+
+    Recorder.Cleanup();
+    JobSystem.Shutdown();
+    KE_CHECK(Device.GetLiveResourceCount() == 0);
+}
@@ -0,0 +1,156 @@
+﻿#include "Test.h"
+#include "Graphics/ProceduralGeometry.h"
+#include "Graphics/MeshSimplifier.h"
+#include "Core/JobSystem.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    /**
+     * @brief Generate a shape and check counts, index range, unit normals and winding against the normals
+     * @return Number of problems found
+     */
+    uint32 CheckShape(const FProceduralMeshDesc& Desc, std::vector<FStandardVertex>& OutVertices)
+    {
+        uint32 VertexCount = 0;
+        uint32 IndexCount = 0;
+        std::vector<uint32> Indices;
+        if (!ProceduralGeometry::GetCounts(Desc, VertexCount, IndexCount) ||
+            !ProceduralGeometry::Generate(Desc, OutVertices, Indices) ||
+            OutVertices.size() != VertexCount || Indices.size() != IndexCount || IndexCount % 3 != 0)
+        {
+            return 1;
+        }
+
+        uint32 Problems = 0;
+        for (const FStandardVertex& Vertex : OutVertices)
+        {
+            const float* N = Vertex.Normal;
+            Problems += std::fabs(N[0] * N[0] + N[1] * N[1] + N[2] * N[2] - 1.0f) > 1e-3f ? 1 : 0;
+        }
+
+        // Every triangle is clockwise seen from the side its vertex normals face (Direct3D front faces)
+        for (uint32 i = 0; i < IndexCount; i += 3)
+        {
+            if (Indices[i] >= VertexCount || Indices[i + 1] >= VertexCount || Indices[i + 2] >= VertexCount)
+            {
+                return Problems + 1;
+            }
+            const float* A = OutVertices[Indices[i]].Position;
+            const float* B = OutVertices[Indices[i + 1]].Position;
+            const float* C = OutVertices[Indices[i + 2]].Position;
+            const float AB[3] = { B[0] - A[0], B[1] - A[1], B[2] - A[2] };
+            const float AC[3] = { C[0] - A[0], C[1] - A[1], C[2] - A[2] };
+            const float Face[3] = { AB[1] * AC[2] - AB[2] * AC[1], AB[2] * AC[0] - AB[0] * AC[2], AB[0] * AC[1] - AB[1] * AC[0] };
+            const float Area = std::sqrt(Face[0] * Face[0] + Face[1] * Face[1] + Face[2] * Face[2]);
+            Problems += Area < 1e-9f ? 1 : 0;
+
+            float Normal[3] = {};
+            for (uint32 Corner = 0; Corner < 3; ++Corner)
+            {
+                for (uint32 Axis = 0; Axis < 3; ++Axis)
+                {
+                    Normal[Axis] += OutVertices[Indices[i + Corner]].Normal[Axis];
+                }
+            }
+            Problems += Face[0] * Normal[0] + Face[1] * Normal[1] + Face[2] * Normal[2] >= 0.0f ? 0 : 1;
+        }
+        return Problems;
+    }
+}
+
+KE_TEST(ShapesHaveExactCountsAndConsistentWinding)
+{
+    std::vector<float> Heights(9 * 5);
+    for (size_t i = 0; i < Heights.size(); ++i)
+    {
+        Heights[i] = std::sin(static_cast<float>(i));
+    }
+
+    const FProceduralMeshDesc Descs[] = {
+        FProceduralMeshDesc::Sphere(24, 12, 2.0f),
+        FProceduralMeshDesc::Torus(24, 12),
+        FProceduralMeshDesc::Cylinder(24, 3),
+        FProceduralMeshDesc::Capsule(24, 6),
+        FProceduralMeshDesc::Plane(8, 4),
+        FProceduralMeshDesc::Heightfield(Heights.data(), 8, 4),
+    };
+    std::vector<FStandardVertex> Vertices;
+    for (const FProceduralMeshDesc& Desc : Descs)
+    {
+        KE_CHECK(CheckShape(Desc, Vertices) == 0);
+    }
+}
+
+KE_TEST(ShapesLieOnTheirSurfaces)
+{
+    std::vector<FStandardVertex> Vertices;
+    KE_REQUIRE(CheckShape(FProceduralMeshDesc::Sphere(32, 16, 2.0f), Vertices) == 0);
+    for (const FStandardVertex& Vertex : Vertices)
+    {
+        const float* P = Vertex.Position;
+        KE_REQUIRE(std::fabs(std::sqrt(P[0] * P[0] + P[1] * P[1] + P[2] * P[2]) - 2.0f) < 1e-4f);
+    }
+
+    KE_REQUIRE(CheckShape(FProceduralMeshDesc::Torus(32, 16, 1.0f, 0.25f), Vertices) == 0);
+    for (const FStandardVertex& Vertex : Vertices)
+    {
+        const float* P = Vertex.Position;
+        const float Ring = std::sqrt(P[0] * P[0] + P[2] * P[2]) - 1.0f;
+        KE_REQUIRE(std::fabs(std::sqrt(Ring * Ring + P[1] * P[1]) - 0.25f) < 1e-4f);
+    }
+
+    KE_REQUIRE(CheckShape(FProceduralMeshDesc::Plane(4, 2, 3.0f, 1.0f), Vertices) == 0);
+    KE_CHECK(Vertices.size() == 5 * 3);
+    for (const FStandardVertex& Vertex : Vertices)
+    {
+        KE_REQUIRE(Vertex.Position[1] == 0.0f && Vertex.Normal[1] == 1.0f);
+        KE_REQUIRE(std::fabs(Vertex.Position[0]) <= 1.5f && std::fabs(Vertex.Position[2]) <= 0.5f);
+    }
+}
+
+KE_TEST(ParallelGenerationMatchesSerial)
+{
+    KJobSystem JobSystem;
+    JobSystem.Initialize(3);
+    for (const FProceduralMeshDesc& Desc : { FProceduralMeshDesc::Plane(512, 384), FProceduralMeshDesc::Sphere(512, 256) })
+    {
+        std::vector<FStandardVertex> SerialVertices, ParallelVertices;
+        std::vector<uint32> SerialIndices, ParallelIndices;
+        KE_REQUIRE(ProceduralGeometry::Generate(Desc, SerialVertices, SerialIndices));
+        KE_REQUIRE(ProceduralGeometry::Generate(Desc, ParallelVertices, ParallelIndices, &JobSystem));
+        KE_CHECK(ParallelIndices == SerialIndices);
+        KE_REQUIRE(ParallelVertices.size() == SerialVertices.size());
+        KE_CHECK(std::memcmp(ParallelVertices.data(), SerialVertices.data(),
+                             SerialVertices.size() * sizeof(FStandardVertex)) == 0);
+    }
+    JobSystem.Shutdown();
+}
+
+KE_TEST(InvalidDescsAndCacheKeys)
+{
+    uint32 VertexCount, IndexCount;
+    KE_CHECK(!ProceduralGeometry::GetCounts(FProceduralMeshDesc::Sphere(2, 1), VertexCount, IndexCount));
+    KE_CHECK(!ProceduralGeometry::GetCounts(FProceduralMeshDesc::Plane(0, 4), VertexCount, IndexCount));
+    KE_CHECK(!ProceduralGeometry::GetCounts(FProceduralMeshDesc::Heightfield(nullptr, 4, 4), VertexCount, IndexCount));
+    KE_CHECK(!ProceduralGeometry::GetCounts(FProceduralMeshDesc::Plane(70000, 70000), VertexCount, IndexCount));
+
+    const FProceduralMeshDesc Sphere = FProceduralMeshDesc::Sphere(32, 16);
+    const uint64 Key = ProceduralGeometry::GetCacheKey(Sphere, EVertexLayout::Standard, nullptr);
+    KE_CHECK(Key == ProceduralGeometry::GetCacheKey(FProceduralMeshDesc::Sphere(32, 16), EVertexLayout::Standard, nullptr));
+    KE_CHECK(Key != ProceduralGeometry::GetCacheKey(FProceduralMeshDesc::Sphere(32, 16, 2.0f), EVertexLayout::Standard, nullptr));
+    KE_CHECK(Key != ProceduralGeometry::GetCacheKey(FProceduralMeshDesc::Sphere(32, 17), EVertexLayout::Standard, nullptr));
+    KE_CHECK(Key != ProceduralGeometry::GetCacheKey(Sphere, EVertexLayout::Compact, nullptr));
+    const FMeshLODSettings LODSettings;
+    KE_CHECK(Key != ProceduralGeometry::GetCacheKey(Sphere, EVertexLayout::Standard, &LODSettings));
+
+    // Height samples are part of the key
+    float Heights[4] = { 0, 1, 2, 3 };
+    const uint64 HeightKey = ProceduralGeometry::GetCacheKey(FProceduralMeshDesc::Heightfield(Heights, 1, 1),
+                                                             EVertexLayout::Standard, nullptr);
+    Heights[3] = 4;
+    KE_CHECK(HeightKey != ProceduralGeometry::GetCacheKey(FProceduralMeshDesc::Heightfield(Heights, 1, 1),
+                                                          EVertexLayout::Standard, nullptr));
+}
@@ -0,0 +1,162 @@
+﻿#include "Test.h"
+#include "Core/Profiler.h"
+#include "Core/JobSystem.h"
+
+#include <cstring>
+#include <string>
+#include <thread>
+
+namespace
+{
+    size_t CountEvents(const std::vector<FProfileEvent>& Events, const char* Name)
+    {
+        size_t Count = 0;
+        for (const FProfileEvent& Event : Events)
+        {
+            Count += std::strcmp(Event.Name, Name) == 0 ? 1 : 0;
+        }
+        return Count;
+    }
+}
+
+KE_TEST(DisabledProfilerRecordsNothing)
+{
+    KProfiler::SetEnabled(false);
+    KProfiler::Clear();
+    {
+        KE_PROFILE_SCOPE("Disabled");
+    }
+
+    std::vector<FProfileEvent> Events;
+    KProfiler::CollectEvents(Events);
+    KE_CHECK(Events.empty());
+}
+
+KE_TEST(NestedZonesRecordDepthAndContainment)
+{
+    KProfiler::SetEnabled(true);
+    KProfiler::Clear();
+    {
+        KE_PROFILE_SCOPE("Outer");
+        {
+            KE_PROFILE_SCOPE("Inner");
+        }
+    }
+    KProfiler::SetEnabled(false);
+
+    std::vector<FProfileEvent> Events;
+    KProfiler::CollectEvents(Events);
+    KE_REQUIRE(Events.size() == 2);
+
+    // Sorted by start time, outer zones first
+    KE_CHECK(std::strcmp(Events[0].Name, "Outer") == 0);
+    KE_CHECK(std::strcmp(Events[1].Name, "Inner") == 0);
+    KE_CHECK(Events[0].Depth == 0);
+    KE_CHECK(Events[1].Depth == 1);
+    KE_CHECK(Events[0].BeginTime <= Events[1].BeginTime);
+    KE_CHECK(Events[1].EndTime <= Events[0].EndTime);
+}
+
+KE_TEST(ZonesOfEveryThreadAreCollected)
+{
+    constexpr uint32 ThreadCount = 4;
+    constexpr uint32 ZonesPerThread = 100;
+
+    KProfiler::SetEnabled(true);
+    KProfiler::Clear();
+
+    std::vector<std::thread> Threads;
+    for (uint32 i = 0; i < ThreadCount; ++i)
+    {
+        Threads.emplace_back([]()
+        {
+            KProfiler::SetThreadName("Worker");
+            for (uint32 Zone = 0; Zone < ZonesPerThread; ++Zone)
+            {
+                KE_PROFILE_SCOPE("WorkerZone");
+            }
+        });
+    }
+    for (std::thread& Thread : Threads)
+    {
+        Thread.join();
+    }
+    KProfiler::SetEnabled(false);
+
+    std::vector<FProfileEvent> Events;
+    KProfiler::CollectEvents(Events);
+    KE_CHECK(CountEvents(Events, "WorkerZone") == ThreadCount * ZonesPerThread);
+
+    for (size_t i = 1; i < Events.size(); ++i)
+    {
+        KE_CHECK(Events[i - 1].BeginTime <= Events[i].BeginTime);
+    }
+}
+
+KE_TEST(ReinitializedWorkersReuseThreadBuffers)
+{
+    KProfiler::SetEnabled(true);
+    uint32 BufferCount = 0;
+    for (uint32 Cycle = 0; Cycle < 8; ++Cycle)
+    {
+        KJobSystem JobSystem;
+        JobSystem.Initialize(4);
+        JobSystem.ParallelFor(64, [](uint32, uint32)
+        {
+            KE_PROFILE_SCOPE("Job");
+        });
+        JobSystem.Shutdown();
+
+        // Joined workers hand their buffers back; the next cycle's workers take them over
+        if (Cycle == 0)
+        {
+            BufferCount = KProfiler::GetThreadBufferCount();
+        }
+    }
+    KProfiler::SetEnabled(false);
+
+    KE_CHECK(BufferCount > 0);
+    KE_CHECK(KProfiler::GetThreadBufferCount() == BufferCount);
+    KProfiler::Clear();
+}
+
+KE_TEST(FullRingKeepsNewestZones)
+{
+    KProfiler::SetEnabled(true);
+    KProfiler::Clear();
+    for (uint32 i = 0; i < KProfiler::EventsPerThread; ++i)
+    {
+        KE_PROFILE_SCOPE("Old");
+    }
+    for (uint32 i = 0; i < 10; ++i)
+    {
+        KE_PROFILE_SCOPE("New");
+    }
+    KProfiler::SetEnabled(false);
+
+    std::vector<FProfileEvent> Events;
+    KProfiler::CollectEvents(Events);
+    // A full ring also drops the oldest slot, which the owner may be writing next
+    KE_CHECK(Events.size() == KProfiler::EventsPerThread - 1);
+    KE_CHECK(CountEvents(Events, "New") == 10);
+    KE_CHECK(CountEvents(Events, "Old") == KProfiler::EventsPerThread - 11);
+}
+
+KE_TEST(ChromeTraceContainsCompleteEvents)
+{
+    KProfiler::SetEnabled(true);
+    KProfiler::Clear();
+    {
+        KE_PROFILE_SCOPE("Quoted \"Zone\"");
+    }
+    KProfiler::SetEnabled(false);
+
+    const std::string Trace = KProfiler::ExportChromeTrace();
+    KE_CHECK(Trace.find("\"traceEvents\":[") != std::string::npos);
+    KE_CHECK(Trace.find("\"name\":\"Quoted \\\"Zone\\\"\"") != std::string::npos);
+    KE_CHECK(Trace.find("\"ph\":\"X\"") != std::string::npos);
+    KE_CHECK(Trace.find("\"ph\":\"M\"") != std::string::npos);
+    KE_CHECK(Trace.size() >= 4 && Trace.compare(Trace.size() - 4, 4, "\n]}\n") == 0);
+
+    KProfiler::Clear();
+}
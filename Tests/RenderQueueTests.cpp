@@ -0,0 +1,112 @@
+﻿#include "Test.h"
+#include "Graphics/RenderQueue.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+KE_TEST(SortMatchesStableSort)
+{
+    std::mt19937_64 Random(7);
+    KRenderQueue Queue;
+    std::vector<FRenderQueueItem> Expected;
+    for (uint32 i = 0; i < 5000; ++i)
+    {
+        // Few distinct keys so stability matters
+        const uint64 Key = (Random() % 64) << 40 | (Random() % 4);
+        Queue.Push(Key, i);
+        Expected.push_back({ Key, i });
+    }
+
+    Queue.Sort();
+    std::stable_sort(Expected.begin(), Expected.end(),
+                     [](const FRenderQueueItem& A, const FRenderQueueItem& B) { return A.Key < B.Key; });
+
+    const std::vector<FRenderQueueItem>& Items = Queue.GetItems();
+    KE_REQUIRE(Items.size() == Expected.size());
+    for (size_t i = 0; i < Items.size(); ++i)
+    {
+        KE_CHECK(Items[i].Key == Expected[i].Key && Items[i].Index == Expected[i].Index);
+    }
+}
+
+KE_TEST(KeyFieldsRoundTrip)
+{
+    const uint32 MeshId = DrawKey::MakeMeshId(1234, 5);
+    for (ERenderPass Pass : { ERenderPass::Opaque, ERenderPass::Transparent, ERenderPass::Overlay })
+    {
+        const uint64 Key = DrawKey::Make(Pass, 17, 42, MeshId, 99999);
+        KE_CHECK(DrawKey::GetPass(Key) == Pass);
+        KE_CHECK(DrawKey::GetShader(Key) == 17);
+        KE_CHECK(DrawKey::GetTexture(Key) == 42);
+        KE_CHECK(DrawKey::GetMesh(Key) == MeshId);
+        KE_CHECK(DrawKey::GetDepth(Key) == 99999);
+    }
+}
+
+KE_TEST(OpaqueGroupsByStateThenFrontToBack)
+{
+    KRenderQueue Queue;
+    Queue.Push(DrawKey::Make(ERenderPass::Opaque, 2, 1, 1, DrawKey::QuantizeDepth(1.0f, 0.0f, 100.0f)), 0);
+    Queue.Push(DrawKey::Make(ERenderPass::Opaque, 1, 1, 1, DrawKey::QuantizeDepth(90.0f, 0.0f, 100.0f)), 1);
+    Queue.Push(DrawKey::Make(ERenderPass::Opaque, 1, 1, 1, DrawKey::QuantizeDepth(10.0f, 0.0f, 100.0f)), 2);
+    Queue.Sort();
+
+    const std::vector<FRenderQueueItem>& Items = Queue.GetItems();
+    KE_CHECK(Items[0].Index == 2);
+    KE_CHECK(Items[1].Index == 1);
+    KE_CHECK(Items[2].Index == 0);
+
+    // Same state, different depth: one batch
+    KE_CHECK(Queue.FindBatchEnd(0) == 2);
+    KE_CHECK(Queue.FindBatchEnd(2) == 3);
+}
+
+KE_TEST(TransparentSortsBackToFrontAcrossState)
+{
+    KRenderQueue Queue;
+    const float Depths[] = { 5.0f, 50.0f, 20.0f, 80.0f };
+    for (uint32 i = 0; i < 4; ++i)
+    {
+        // Alternating state must not break the depth order
+        Queue.Push(DrawKey::Make(ERenderPass::Transparent, 1 + i % 2, 1 + i % 2, 1,
+                                 DrawKey::QuantizeDepth(Depths[i], 0.0f, 100.0f, true)), i);
+    }
+    Queue.Push(DrawKey::Make(ERenderPass::Opaque, 3, 3, 3, 0), 4);
+    Queue.Push(DrawKey::Make(ERenderPass::Overlay, 1, 1, 1, 0), 5);
+    Queue.Sort();
+
+    const uint32 ExpectedOrder[] = { 4, 3, 1, 2, 0, 5 };
+    const std::vector<FRenderQueueItem>& Items = Queue.GetItems();
+    for (uint32 i = 0; i < 6; ++i)
+    {
+        KE_CHECK(Items[i].Index == ExpectedOrder[i]);
+    }
+
+    // Runs only join neighbours that share state
+    KE_CHECK(Queue.FindBatchEnd(1) == 3);
+    KE_CHECK(Queue.FindBatchEnd(3) == 5);
+}
+
+KE_TEST(QuantizeDepthClampsAndInverts)
+{
+    const uint32 MaxDepth = static_cast<uint32>(DrawKey::FieldMask(DrawKey::DepthBits));
+    KE_CHECK(DrawKey::QuantizeDepth(-5.0f, 0.0f, 100.0f) == 0);
+    KE_CHECK(DrawKey::QuantizeDepth(500.0f, 0.0f, 100.0f) == MaxDepth);
+    KE_CHECK(DrawKey::QuantizeDepth(0.0f, 0.0f, 100.0f, true) == MaxDepth);
+    KE_CHECK(DrawKey::QuantizeDepth(25.0f, 0.0f, 100.0f) < DrawKey::QuantizeDepth(75.0f, 0.0f, 100.0f));
+    KE_CHECK(DrawKey::QuantizeDepth(std::nanf(""), 0.0f, 100.0f) == 0);
+    KE_CHECK(DrawKey::QuantizeDepth(std::nanf(""), 0.0f, 100.0f, true) == MaxDepth);
+}
+
+KE_TEST(SortIdsAreDenseAndStable)
+{
+    KSortIdMap Ids;
+    int A = 0;
+    int B = 0;
+    KE_CHECK(Ids.GetId(nullptr) == 0);
+    const uint32 IdA = Ids.GetId(&A);
+    const uint32 IdB = Ids.GetId(&B);
+    KE_CHECK(IdA == 1 && IdB == 2);
+    KE_CHECK(Ids.GetId(&A) == IdA);
+}
@@ -0,0 +1,111 @@
+﻿#include "Test.h"
+#include "Graphics/RenderStateCache.h"
+#include "RHI/NullRHI.h"
+
+namespace
+{
+    const int Handles[8] = {};
+    const void* Handle(uint32 Index) { return &Handles[Index]; }
+}
+
+KE_TEST(RedundantBindingsAreSkipped)
+{
+    KNullCommandContext Context;
+    KRenderStateCache Cache(&Context);
+
+    for (uint32 Draw = 0; Draw < 3; ++Draw)
+    {
+        Cache.SetInputLayout(Handle(0));
+        Cache.SetShader(EShaderType::Vertex, Handle(1));
+        Cache.SetShader(EShaderType::Pixel, Handle(2));
+        Cache.SetPrimitiveTopology(EPrimitiveTopology::TriangleList);
+        Cache.SetVertexBuffer(0, Handle(3), 32, 0);
+        Cache.SetIndexBuffer(Handle(4), EIndexFormat::UInt16, 0);
+        Cache.SetConstantBuffer(EShaderType::Vertex, 0, Handle(5));
+        Cache.SetShaderResource(EShaderType::Pixel, 0, Handle(6));
+        Cache.SetSampler(EShaderType::Pixel, 0, Handle(7));
+        Cache.SetDepthStencilState(nullptr);
+        Cache.SetViewport({ 0.0f, 0.0f, 640.0f, 480.0f });
+    }
+
+    KE_CHECK(Context.GetTotalCommandCount() == 11);
+    KE_CHECK(Cache.GetStats().CallsIssued == 11);
+    KE_CHECK(Cache.GetStats().CallsSkipped == 22);
+}
+
+KE_TEST(ChangedArgumentsAreIssued)
+{
+    KNullCommandContext Context;
+    KRenderStateCache Cache(&Context);
+
+    Cache.SetVertexBuffer(0, Handle(0), 32, 0);
+    Cache.SetVertexBuffer(0, Handle(0), 32, 64);         // Offset
+    Cache.SetVertexBuffer(0, Handle(0), 16, 64);         // Stride
+    Cache.SetVertexBuffer(1, Handle(0), 16, 64);         // Slot
+    Cache.SetConstantBuffer(EShaderType::Vertex, 1, Handle(1), 0, 16);
+    Cache.SetConstantBuffer(EShaderType::Vertex, 1, Handle(1), 16, 16);  // Range
+    Cache.SetConstantBuffer(EShaderType::Pixel, 1, Handle(1), 16, 16);   // Stage
+    Cache.SetViewport({ 0.0f, 0.0f, 320.0f, 240.0f });
+    Cache.SetViewport({ 320.0f, 0.0f, 320.0f, 240.0f });
+
+    KE_CHECK(Context.GetCommandCount(ENullRHICommand::SetVertexBuffer) == 4);
+    KE_CHECK(Context.GetCommandCount(ENullRHICommand::SetConstantBuffer) == 3);
+    KE_CHECK(Context.GetCommandCount(ENullRHICommand::SetViewport) == 2);
+    KE_CHECK(Cache.GetStats().CallsSkipped == 0);
+}
+
+KE_TEST(InvalidateReissuesEverything)
+{
+    KNullCommandContext Context;
+    KRenderStateCache Cache(&Context);
+
+    Cache.SetShader(EShaderType::Vertex, Handle(0));
+    Cache.SetShaderResource(EShaderType::Pixel, 2, Handle(1));
+    Cache.Invalidate();
+    Cache.SetShader(EShaderType::Vertex, Handle(0));
+    Cache.SetShaderResource(EShaderType::Pixel, 2, Handle(1));
+
+    KE_CHECK(Context.GetCommandCount(ENullRHICommand::SetShader) == 2);
+    KE_CHECK(Context.GetCommandCount(ENullRHICommand::SetShaderResource) == 2);
+
+    // Changing the sink also starts from unknown state
+    KNullCommandContext OtherContext;
+    Cache.SetSink(&OtherContext);
+    Cache.SetShader(EShaderType::Vertex, Handle(0));
+    KE_CHECK(OtherContext.GetCommandCount(ENullRHICommand::SetShader) == 1);
+}
+
+KE_TEST(UntrackedSlotsAreAlwaysForwarded)
+{
+    KNullCommandContext Context;
+    KRenderStateCache Cache(&Context);
+
+    const uint32 Slot = KRenderStateCache::MaxShaderResourceSlots;
+    Cache.SetShaderResource(EShaderType::Pixel, Slot, Handle(0));
+    Cache.SetShaderResource(EShaderType::Pixel, Slot, Handle(0));
+    KE_CHECK(Context.GetCommandCount(ENullRHICommand::SetShaderResource) == 2);
+}
+
+KE_TEST(RecordedStreamReplaysTheSameCommands)
+{
+    KNullCommandContext Recorder;
+    Recorder.SetRecording(true);
+    KRenderStateCache Cache(&Recorder);
+
+    Cache.SetShader(EShaderType::Pixel, Handle(0));
+    Cache.SetShader(EShaderType::Pixel, Handle(0));
+    Cache.SetDepthStencilState(Handle(1), 3);
+    Cache.SetViewport({ 1.0f, 2.0f, 3.0f, 4.0f, 0.0f, 1.0f });
+    Recorder.SetPrimitiveTopology(EPrimitiveTopology::TriangleList);
+    Recorder.Draw(6, 0);
+
+    KNullCommandContext Player;
+    Player.SetRecording(true);
+    KE_REQUIRE(Player.Replay(Recorder.GetRecordedStream().data(), Recorder.GetRecordedStream().size()));
+    KE_CHECK(Player.GetRecordedStream() == Recorder.GetRecordedStream());
+    KE_CHECK(Player.GetTotalCommandCount() == 5);
+    KE_CHECK(Player.GetPrimitiveCount() == 2);
+
+    const std::string Dump = Player.DumpRecordedStream();
+    KE_CHECK(Dump.find("SetViewport 1, 2, 3, 4, 0, 1") != std::string::npos);
+}
@@ -0,0 +1,543 @@
+﻿#include "Test.h"
+#include "TestScene.h"
+#include "Graphics/SceneBVH.h"
+#include "Graphics/LooseOctree.h"
+#include "Graphics/SpatialHashGrid.h"
+#include "Core/JobSystem.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <random>
+
+namespace
+{
+    /**
+     * @brief Brute-force copy of the objects an index holds, by object id
+     */
+    struct FModel
+    {
+        struct FObject
+        {
+            float Min[3];
+            float Max[3];
+            uint32 UserData = 0;
+            bool bLive = false;
+        };
+
+        std::vector<FObject> Objects;
+        std::vector<uint32> LiveIds;
+        uint32 NextUserData = 0;
+
+        void SetBox(uint32 Id, const FBoundingBox& Box)
+        {
+            SpatialQuery::ToMinMax(Box, Objects[Id].Min, Objects[Id].Max);
+        }
+
+        template<typename PredicateType>
+        std::vector<uint32> Collect(PredicateType&& Predicate) const
+        {
+            std::vector<uint32> Result;
+            for (const FObject& Object : Objects)
+            {
+                if (Object.bLive && Predicate(Object))
+                {
+                    Result.push_back(Object.UserData);
+                }
+            }
+            std::sort(Result.begin(), Result.end());
+            return Result;
+        }
+    };
+
+    struct FWorkload
+    {
+        float WorldExtent = 500.0f;
+        float MinExtent = 0.1f;
+        float MaxExtent = 10.0f;
+        uint32 InitialCount = 2000;
+        uint32 RoundCount = 8;
+        uint32 ChangesPerRound = 300;   // Each of inserts, removes and moves
+        uint32 QueriesPerRound = 8;
+    };
+
+    void Insert(ISpatialIndex& Index, FModel& Model, const FBoundingBox& Box)
+    {
+        const uint32 UserData = Model.NextUserData++;
+        const uint32 Id = Index.Insert(Box, UserData);
+        if (Id >= Model.Objects.size())
+        {
+            Model.Objects.resize(Id + 1);
+        }
+        KE_CHECK(!Model.Objects[Id].bLive);
+        Model.Objects[Id].bLive = true;
+        Model.Objects[Id].UserData = UserData;
+        Model.SetBox(Id, Box);
+        Model.LiveIds.push_back(Id);
+    }
+
+    std::vector<uint32> Sorted(std::vector<uint32> Values)
+    {
+        std::sort(Values.begin(), Values.end());
+        return Values;
+    }
+
+    /**
+     * @brief Found (any order) holds each of Required and nothing outside Passing, once each
+     *
+     * For indexes that prune by the frustum's bounding box, which drops some boxes the plane
+     * test passes near the frustum's corners.
+     */
+    void CheckFrustumResult(std::vector<uint32> Found, const std::vector<uint32>& Passing,
+                            const std::vector<uint32>& Required)
+    {
+        std::sort(Found.begin(), Found.end());
+        KE_CHECK(std::adjacent_find(Found.begin(), Found.end()) == Found.end());
+        KE_CHECK(std::includes(Passing.begin(), Passing.end(), Found.begin(), Found.end()));
+        KE_CHECK(std::includes(Found.begin(), Found.end(), Required.begin(), Required.end()));
+    }
+
+    void CheckQueries(const ISpatialIndex& Index, const FModel& Model, std::mt19937& Random, const FWorkload& Workload,
+                      bool bPrunesFrustumBounds)
+    {
+        std::uniform_real_distribution<float> Position(-Workload.WorldExtent, Workload.WorldExtent);
+        std::uniform_real_distribution<float> Size(1.0f, Workload.WorldExtent * 0.25f);
+        std::vector<uint32> Found;
+
+        for (uint32 Query = 0; Query < Workload.QueriesPerRound; ++Query)
+        {
+            const FFrustum Frustum = TestScene::RandomFrustum(Random, Workload.WorldExtent, Workload.WorldExtent);
+            Found.clear();
+            KE_CHECK(Index.QueryFrustum(Frustum, Found) == Found.size());
+            const std::vector<uint32> Passing = Model.Collect([&](const FModel::FObject& Object)
+            {
+                uint32 PlaneMask = SpatialQuery::AllPlanes;
+                return SpatialQuery::TestFrustum(Frustum, Object.Min, Object.Max, PlaneMask);
+            });
+            if (bPrunesFrustumBounds)
+            {
+                float FrustumMin[3];
+                float FrustumMax[3];
+                KE_REQUIRE(SpatialQuery::ComputeFrustumBounds(Frustum, FrustumMin, FrustumMax));
+                const std::vector<uint32> Required = Model.Collect([&](const FModel::FObject& Object)
+                {
+                    uint32 PlaneMask = SpatialQuery::AllPlanes;
+                    return SpatialQuery::TestFrustum(Frustum, Object.Min, Object.Max, PlaneMask) &&
+                           SpatialQuery::Overlaps(Object.Min, Object.Max, FrustumMin, FrustumMax);
+                });
+                CheckFrustumResult(Found, Passing, Required);
+            }
+            else
+            {
+                KE_CHECK(Sorted(Found) == Passing);
+            }
+
+            const FBoundingBox Box = TestScene::RandomBox(Random, Workload.WorldExtent, 1.0f, Workload.WorldExtent * 0.25f);
+            float BoxMin[3];
+            float BoxMax[3];
+            SpatialQuery::ToMinMax(Box, BoxMin, BoxMax);
+            Found.clear();
+            KE_CHECK(Index.QueryBox(Box, Found) == Found.size());
+            KE_CHECK(Sorted(Found) == Model.Collect([&](const FModel::FObject& Object)
+            {
+                return SpatialQuery::Overlaps(Object.Min, Object.Max, BoxMin, BoxMax);
+            }));
+
+            FBoundingSphere Sphere;
+            Sphere.Center[0] = Position(Random);
+            Sphere.Center[1] = Position(Random);
+            Sphere.Center[2] = Position(Random);
+            Sphere.Radius = Size(Random);
+            Found.clear();
+            KE_CHECK(Index.QuerySphere(Sphere, Found) == Found.size());
+            KE_CHECK(Sorted(Found) == Model.Collect([&](const FModel::FObject& Object)
+            {
+                return SpatialQuery::OverlapsSphere(Sphere, Object.Min, Object.Max);
+            }));
+
+            // Ties may be reported in either order, so compare distances
+            const float Point[3] = { Position(Random), Position(Random), Position(Random) };
+            const uint32 Count = 1 + Query * 4;
+            const float MaxDistance = Query % 2 == 0 ? FLT_MAX : Size(Random);
+            std::vector<float> Expected;
+            for (const FModel::FObject& Object : Model.Objects)
+            {
+                const float DistanceSquared = SpatialQuery::DistanceSquared(Point, Object.Min, Object.Max);
+                if (Object.bLive && DistanceSquared <= MaxDistance * MaxDistance)
+                {
+                    Expected.push_back(DistanceSquared);
+                }
+            }
+            std::sort(Expected.begin(), Expected.end());
+            Expected.resize(std::min<size_t>(Expected.size(), Count));
+
+            std::vector<FSpatialNeighbor> Neighbors;
+            KE_CHECK(Index.QueryNearest(Point, Count, MaxDistance, Neighbors) == Neighbors.size());
+            KE_REQUIRE(Neighbors.size() == Expected.size());
+            for (size_t i = 0; i < Neighbors.size(); ++i)
+            {
+                KE_CHECK(Neighbors[i].DistanceSquared == Expected[i]);
+            }
+        }
+    }
+
+    /**
+     * @brief Random inserts, removes, jitters and teleports, checking every query kind against brute force after each Update
+     */
+    void CheckAgainstBruteForce(ISpatialIndex& Index, uint32 Seed, const FWorkload& Workload, KJobSystem* JobSystem,
+                                bool bPrunesFrustumBounds = false)
+    {
+        std::mt19937 Random(Seed);
+        FModel Model;
+        auto RandomBox = [&]()
+        {
+            return TestScene::RandomBox(Random, Workload.WorldExtent, Workload.MinExtent, Workload.MaxExtent);
+        };
+
+        for (uint32 i = 0; i < Workload.InitialCount; ++i)
+        {
+            Insert(Index, Model, RandomBox());
+        }
+        Index.Update(JobSystem);
+        KE_CHECK(Index.GetObjectCount() == Model.LiveIds.size());
+        CheckQueries(Index, Model, Random, Workload, bPrunesFrustumBounds);
+
+        std::uniform_real_distribution<float> Jitter(-2.0f, 2.0f);
+        for (uint32 Round = 0; Round < Workload.RoundCount; ++Round)
+        {
+            for (uint32 Change = 0; Change < Workload.ChangesPerRound && !Model.LiveIds.empty(); ++Change)
+            {
+                const size_t Slot = Random() % Model.LiveIds.size();
+                const uint32 Id = Model.LiveIds[Slot];
+                Model.LiveIds[Slot] = Model.LiveIds.back();
+                Model.LiveIds.pop_back();
+                Index.Remove(Id);
+                Model.Objects[Id].bLive = false;
+                KE_CHECK(!Index.IsValid(Id));
+            }
+
+            for (uint32 Change = 0; Change < Workload.ChangesPerRound; ++Change)
+            {
+                Insert(Index, Model, RandomBox());
+            }
+
+            // Most moves are small steps, some jump across the world
+            for (uint32 Change = 0; Change < Workload.ChangesPerRound; ++Change)
+            {
+                const uint32 Id = Model.LiveIds[Random() % Model.LiveIds.size()];
+                FBoundingBox Box = RandomBox();
+                if (Change % 4 != 0)
+                {
+                    const FModel::FObject& Object = Model.Objects[Id];
+                    for (uint32 Axis = 0; Axis < 3; ++Axis)
+                    {
+                        Box.Center[Axis] = 0.5f * (Object.Min[Axis] + Object.Max[Axis]) + Jitter(Random);
+                    }
+                }
+                Index.Move(Id, Box);
+                Model.SetBox(Id, Box);
+            }
+
+            Index.Update(JobSystem);
+            KE_CHECK(Index.GetObjectCount() == Model.LiveIds.size());
+            for (const uint32 Id : Model.LiveIds)
+            {
+                KE_CHECK(Index.IsValid(Id) && Index.GetUserData(Id) == Model.Objects[Id].UserData);
+            }
+            CheckQueries(Index, Model, Random, Workload, bPrunesFrustumBounds);
+        }
+
+        Index.Clear();
+        std::vector<uint32> Found;
+        KE_CHECK(Index.GetObjectCount() == 0);
+        KE_CHECK(Index.QueryFrustum(TestScene::RandomFrustum(Random, Workload.WorldExtent, 1000.0f), Found) == 0);
+    }
+
+    /**
+     * @brief Ray parameter where the ray enters the box (0 inside), FLT_MAX if it misses within MaxDistance
+     */
+    float IntersectRay(const FSceneRay& Ray, const float Min[3], const float Max[3])
+    {
+        float Enter = 0.0f;
+        float Exit = Ray.MaxDistance;
+        for (uint32 Axis = 0; Axis < 3; ++Axis)
+        {
+            if (Ray.Direction[Axis] == 0.0f)
+            {
+                if (Ray.Origin[Axis] < Min[Axis] || Ray.Origin[Axis] > Max[Axis])
+                {
+                    return FLT_MAX;
+                }
+                continue;
+            }
+            const float A = (Min[Axis] - Ray.Origin[Axis]) / Ray.Direction[Axis];
+            const float B = (Max[Axis] - Ray.Origin[Axis]) / Ray.Direction[Axis];
+            Enter = std::max(Enter, std::min(A, B));
+            Exit = std::min(Exit, std::max(A, B));
+        }
+        return Enter <= Exit ? Enter : FLT_MAX;
+    }
+}
+
+KE_TEST(SceneBVHMatchesBruteForce)
+{
+    KSceneBVH BVH;
+    CheckAgainstBruteForce(BVH, 23, FWorkload(), nullptr);
+    KE_CHECK(BVH.GetStats().ObjectCount == 0);
+}
+
+KE_TEST(SceneBVHMatchesBruteForceWithJobs)
+{
+    // Enough objects for the parallel binning of the top levels
+    FWorkload Workload;
+    Workload.InitialCount = 40000;
+    Workload.ChangesPerRound = 4000;
+    Workload.RoundCount = 4;
+
+    KJobSystem JobSystem;
+    JobSystem.Initialize(3);
+    KSceneBVH BVH;
+    CheckAgainstBruteForce(BVH, 24, Workload, &JobSystem);
+    JobSystem.Shutdown();
+}
+
+KE_TEST(SceneBVHMatchesBruteForceWithRefitsOnly)
+{
+    // Never rebuild: every change goes through the refit and pending-tree paths
+    FSceneBVHSettings Settings;
+    Settings.RebuildCostRatio = FLT_MAX;
+    Settings.RebuildPendingFraction = FLT_MAX;
+    Settings.PendingTailSize = 16;
+
+    KSceneBVH BVH;
+    BVH.SetSettings(Settings);
+    CheckAgainstBruteForce(BVH, 25, FWorkload(), nullptr);
+}
+
+KE_TEST(SceneBVHRebuildsWhenDegraded)
+{
+    std::mt19937 Random(7);
+    KSceneBVH BVH;
+    std::vector<uint32> Ids;
+    for (uint32 i = 0; i < 4096; ++i)
+    {
+        Ids.push_back(BVH.Insert(TestScene::RandomBox(Random, 100.0f, 0.1f, 1.0f), i));
+    }
+    BVH.Update();
+    const FSceneBVHStats Built = BVH.GetStats();
+    KE_CHECK(Built.ObjectCount == 4096 && Built.PendingCount == 0);
+    KE_CHECK(Built.LeafCount > 0 && Built.NodeCount == 2 * Built.LeafCount - 1);
+
+    // Scattering every object far apart makes the refitted tree much worse than a fresh build
+    for (const uint32 Id : Ids)
+    {
+        BVH.Move(Id, TestScene::RandomBox(Random, 10000.0f, 0.1f, 1.0f));
+    }
+    BVH.Update();
+    const FSceneBVHStats Rebuilt = BVH.GetStats();
+    KE_CHECK(Rebuilt.RebuildCount > Built.RebuildCount);
+    KE_CHECK(Rebuilt.Cost <= Rebuilt.BuildCost * BVH.GetSettings().RebuildCostRatio);
+}
+
+KE_TEST(SceneBVHRaycastMatchesBruteForce)
+{
+    std::mt19937 Random(31);
+    std::uniform_real_distribution<float> Unit(-1.0f, 1.0f);
+    KSceneBVH BVH;
+    FModel Model;
+    for (uint32 i = 0; i < 20000; ++i)
+    {
+        Insert(BVH, Model, TestScene::RandomBox(Random, 500.0f, 0.1f, 5.0f));
+    }
+    BVH.Update();
+
+    // Some rays along an axis, some limited, some starting inside a box
+    std::vector<FSceneRay> Rays(2000);
+    for (uint32 i = 0; i < Rays.size(); ++i)
+    {
+        FSceneRay& Ray = Rays[i];
+        for (uint32 Axis = 0; Axis < 3; ++Axis)
+        {
+            Ray.Origin[Axis] = 600.0f * Unit(Random);
+            Ray.Direction[Axis] = i % 8 == 0 && Axis != i % 3 ? 0.0f : Unit(Random);
+        }
+        Ray.MaxDistance = i % 3 == 0 ? 200.0f : FLT_MAX;
+        if (i % 16 == 1)
+        {
+            const FModel::FObject& Object = Model.Objects[Model.LiveIds[Random() % Model.LiveIds.size()]];
+            for (uint32 Axis = 0; Axis < 3; ++Axis)
+            {
+                Ray.Origin[Axis] = 0.5f * (Object.Min[Axis] + Object.Max[Axis]);
+            }
+        }
+    }
+
+    KJobSystem JobSystem;
+    JobSystem.Initialize(3);
+    std::vector<FSceneRayHit> Hits(Rays.size());
+    BVH.RaycastBatch(Rays.data(), static_cast<uint32>(Rays.size()), Hits.data(), &JobSystem);
+    JobSystem.Shutdown();
+
+    uint32 HitCount = 0;
+    for (uint32 i = 0; i < Rays.size(); ++i)
+    {
+        float Expected = FLT_MAX;
+        for (const FModel::FObject& Object : Model.Objects)
+        {
+            Expected = std::min(Expected, IntersectRay(Rays[i], Object.Min, Object.Max));
+        }
+
+        const FSceneRayHit Single = BVH.Raycast(Rays[i]);
+        KE_CHECK(Single.UserData == Hits[i].UserData && Single.Distance == Hits[i].Distance);
+        if (Expected == FLT_MAX)
+        {
+            KE_CHECK(Hits[i].UserData == FSceneRayHit::NoHit);
+            continue;
+        }
+
+        // Another object entered at the same distance may be reported, so check the hit box too
+        ++HitCount;
+        KE_REQUIRE(Hits[i].UserData < Model.Objects.size());
+        KE_CHECK_NEAR(Hits[i].Distance, Expected, 1.0e-3f * (1.0f + Expected));
+        const FModel::FObject& Object = Model.Objects[Hits[i].UserData];
+        KE_CHECK_NEAR(IntersectRay(Rays[i], Object.Min, Object.Max), Expected, 1.0e-3f * (1.0f + Expected));
+    }
+    KE_CHECK(HitCount > Rays.size() / 10 && HitCount < Rays.size());
+}
+
+KE_TEST(LooseOctreeMatchesBruteForce)
+{
+    FLooseOctreeSettings Settings;
+    Settings.HalfSize = 1024.0f;
+    Settings.MaxDepth = 8;
+    KLooseOctree Octree(Settings);
+    CheckAgainstBruteForce(Octree, 41, FWorkload(), nullptr);
+
+    // Nodes are released as their subtrees empty
+    KE_CHECK(Octree.GetNodeCount() <= 1);
+}
+
+KE_TEST(LooseOctreeMatchesBruteForceOutsideWorld)
+{
+    // Objects centered outside the world cube stay in the root
+    FLooseOctreeSettings Settings;
+    Settings.HalfSize = 200.0f;
+    Settings.MaxDepth = 6;
+    KLooseOctree Octree(Settings);
+    CheckAgainstBruteForce(Octree, 42, FWorkload(), nullptr);
+}
+
+KE_TEST(LooseOctreeMatchesBruteForceWithLargeObjects)
+{
+    FWorkload Workload;
+    Workload.MinExtent = 0.01f;
+    Workload.MaxExtent = 150.0f;
+
+    FLooseOctreeSettings Settings;
+    Settings.HalfSize = 512.0f;
+    Settings.MaxDepth = KLooseOctree::MaxDepthLimit;
+    KLooseOctree Octree(Settings);
+    CheckAgainstBruteForce(Octree, 43, Workload, nullptr);
+}
+
+KE_TEST(SpatialHashGridMatchesBruteForce)
+{
+    KSpatialHashGrid Grid;
+    CheckAgainstBruteForce(Grid, 51, FWorkload(), nullptr, true);
+    KE_CHECK(Grid.GetCellCount() == 0);
+}
+
+KE_TEST(SpatialHashGridMatchesBruteForceWithSmallCells)
+{
+    // Objects larger than the cells, and more cells than the queries cover
+    FSpatialHashGridSettings Settings;
+    Settings.CellSize = 4.0f;
+    KSpatialHashGrid Grid(Settings);
+    CheckAgainstBruteForce(Grid, 52, FWorkload(), nullptr, true);
+}
+
+KE_TEST(SpatialHashGridMatchesBruteForceWithLargeCells)
+{
+    // Few cells, so queries scan the occupied cells instead of looking them up
+    FWorkload Workload;
+    Workload.MaxExtent = 150.0f;
+
+    FSpatialHashGridSettings Settings;
+    Settings.CellSize = 400.0f;
+    KSpatialHashGrid Grid(Settings);
+    CheckAgainstBruteForce(Grid, 53, Workload, nullptr, true);
+}
+
+KE_TEST(SpatialIndexesAgreeOnMoves)
+{
+    // The same small-step moves every frame, as for a crowd; the BVH and the octree report exactly
+    // the boxes the plane test passes, the grid may drop those outside the frustum's bounding box
+    std::mt19937 Random(61);
+    KSceneBVH BVH;
+    KLooseOctree Octree;
+    KSpatialHashGrid Grid;
+    ISpatialIndex* Indexes[] = { &BVH, &Octree, &Grid };
+
+    std::vector<FBoundingBox> Boxes;
+    for (uint32 i = 0; i < 5000; ++i)
+    {
+        Boxes.push_back(TestScene::RandomBox(Random, 300.0f, 0.5f, 2.0f));
+        for (ISpatialIndex* Index : Indexes)
+        {
+            KE_CHECK(Index->Insert(Boxes.back(), i) == i);
+        }
+    }
+
+    std::uniform_real_distribution<float> Step(-1.0f, 1.0f);
+    for (uint32 Frame = 0; Frame < 16; ++Frame)
+    {
+        for (uint32 i = Frame % 2; i < Boxes.size(); i += 2)
+        {
+            for (uint32 Axis = 0; Axis < 3; ++Axis)
+            {
+                Boxes[i].Center[Axis] += Step(Random);
+            }
+            for (ISpatialIndex* Index : Indexes)
+            {
+                Index->Move(i, Boxes[i]);
+            }
+        }
+
+        const FFrustum Frustum = TestScene::RandomFrustum(Random, 300.0f, 300.0f);
+        float FrustumMin[3];
+        float FrustumMax[3];
+        KE_REQUIRE(SpatialQuery::ComputeFrustumBounds(Frustum, FrustumMin, FrustumMax));
+        std::vector<uint32> Passing;
+        std::vector<uint32> Required;
+        for (uint32 i = 0; i < Boxes.size(); ++i)
+        {
+            float Min[3];
+            float Max[3];
+            uint32 PlaneMask = SpatialQuery::AllPlanes;
+            SpatialQuery::ToMinMax(Boxes[i], Min, Max);
+            if (SpatialQuery::TestFrustum(Frustum, Min, Max, PlaneMask))
+            {
+                Passing.push_back(i);
+                if (SpatialQuery::Overlaps(Min, Max, FrustumMin, FrustumMax))
+                {
+                    Required.push_back(i);
+                }
+            }
+        }
+
+        for (ISpatialIndex* Index : Indexes)
+        {
+            Index->Update(nullptr);
+            std::vector<uint32> Found;
+            Index->QueryFrustum(Frustum, Found);
+            if (Index == &Grid)
+            {
+                CheckFrustumResult(Found, Passing, Required);
+            }
+            else
+            {
+                KE_CHECK(Sorted(Found) == Passing);
+            }
+        }
+    }
+}
@@ -0,0 +1,208 @@
+﻿#include "Test.h"
+#include "Graphics/TLSFAllocator.h"
+
+#include <algorithm>
+#include <map>
+#include <random>
+
+namespace
+{
+    /**
+     * @brief Reference model: live ranges by offset
+     */
+    struct FModel
+    {
+        uint32 Capacity = 0;
+        std::map<uint32, uint32> Ranges;
+
+        uint32 GetLargestGap() const
+        {
+            uint32 Largest = 0;
+            uint32 End = 0;
+            for (const auto& Range : Ranges)
+            {
+                Largest = std::max(Largest, Range.first - End);
+                End = Range.first + Range.second;
+            }
+            return std::max(Largest, Capacity - End);
+        }
+
+        bool Insert(uint32 Offset, uint32 Size)
+        {
+            if (Offset + Size > Capacity)
+            {
+                return false;
+            }
+            const auto Next = Ranges.lower_bound(Offset);
+            if (Next != Ranges.end() && Next->first < Offset + Size)
+            {
+                return false;
+            }
+            if (Next != Ranges.begin() && std::prev(Next)->first + std::prev(Next)->second > Offset)
+            {
+                return false;
+            }
+            Ranges.emplace(Offset, Size);
+            return true;
+        }
+    };
+}
+
+KE_TEST(AllocateWholeCapacityAndMergeOnFree)
+{
+    KTLSFAllocator Allocator(1000);
+    const uint32 All = Allocator.Allocate(1000);
+    KE_REQUIRE(All != KTLSFAllocator::InvalidHandle);
+    KE_CHECK(Allocator.GetOffset(All) == 0);
+    KE_CHECK(Allocator.Allocate(1) == KTLSFAllocator::InvalidHandle);
+    Allocator.Free(All);
+
+    uint32 Handles[10];
+    for (uint32 i = 0; i < 10; ++i)
+    {
+        Handles[i] = Allocator.Allocate(100);
+        KE_REQUIRE(Handles[i] != KTLSFAllocator::InvalidHandle);
+    }
+    KE_CHECK(Allocator.GetFreeSize() == 0);
+
+    // Free every other range, then the rest: neighbours merge back into one block
+    for (uint32 i = 0; i < 10; i += 2)
+    {
+        Allocator.Free(Handles[i]);
+    }
+    KE_CHECK(Allocator.GetFreeBlockCount() == 5);
+    KE_CHECK(Allocator.GetLargestFreeBlock() == 100);
+    KE_CHECK(Allocator.Allocate(101) == KTLSFAllocator::InvalidHandle);
+    for (uint32 i = 1; i < 10; i += 2)
+    {
+        Allocator.Free(Handles[i]);
+    }
+    KE_CHECK(Allocator.GetFreeBlockCount() == 1);
+    KE_CHECK(Allocator.GetLargestFreeBlock() == 1000);
+    KE_CHECK(Allocator.GetAllocationCount() == 0);
+    KE_CHECK(Allocator.GetFragmentation() == 0.0f);
+}
+
+KE_TEST(RandomAllocationsMatchModel)
+{
+    const uint32 Capacity = 1 << 20;
+    KTLSFAllocator Allocator(Capacity);
+    FModel Model;
+    Model.Capacity = Capacity;
+
+    std::mt19937 Random(14);
+    std::vector<uint32> Live;
+    uint64 UsedSize = 0;
+    for (int Step = 0; Step < 50000; ++Step)
+    {
+        if (Live.empty() || Random() % 100 < 55)
+        {
+            // Mostly small sizes with an occasional large one
+            const uint32 Size = Random() % 8 == 0 ? 1 + Random() % 65536 : 1 + Random() % 2048;
+            const bool bFits = Model.GetLargestGap() >= Size;
+            const uint32 Handle = Allocator.Allocate(Size);
+
+            // A good fit never fails while a large enough range is free
+            KE_REQUIRE((Handle != KTLSFAllocator::InvalidHandle) == bFits);
+            if (Handle != KTLSFAllocator::InvalidHandle)
+            {
+                KE_REQUIRE(Allocator.GetSize(Handle) == Size);
+                KE_REQUIRE(Model.Insert(Allocator.GetOffset(Handle), Size));
+                Live.push_back(Handle);
+                UsedSize += Size;
+            }
+        }
+        else
+        {
+            const size_t Index = Random() % Live.size();
+            const uint32 Handle = Live[Index];
+            Model.Ranges.erase(Allocator.GetOffset(Handle));
+            UsedSize -= Allocator.GetSize(Handle);
+            Allocator.Free(Handle);
+            Live[Index] = Live.back();
+            Live.pop_back();
+        }
+
+        KE_REQUIRE(Allocator.GetUsedSize() == UsedSize);
+        KE_REQUIRE(Allocator.GetAllocationCount() == Live.size());
+        if (Step % 1000 == 0)
+        {
+            KE_REQUIRE(Allocator.GetLargestFreeBlock() == Model.GetLargestGap());
+        }
+    }
+}
+
+KE_TEST(DefragmentCompactsInOrder)
+{
+    const uint32 Capacity = 4096;
+    KTLSFAllocator Allocator(Capacity);
+    std::vector<uint32> Memory(Capacity, 0);
+
+    // Fill ranges with their handle, then free a random half
+    std::mt19937 Random(5);
+    std::vector<uint32> Live;
+    for (;;)
+    {
+        const uint32 Handle = Allocator.Allocate(1 + Random() % 64);
+        if (Handle == KTLSFAllocator::InvalidHandle)
+        {
+            break;
+        }
+        std::fill_n(Memory.begin() + Allocator.GetOffset(Handle), Allocator.GetSize(Handle), Handle + 1);
+        Live.push_back(Handle);
+    }
+    std::shuffle(Live.begin(), Live.end(), Random);
+    for (size_t i = Live.size() / 2; i < Live.size(); ++i)
+    {
+        Allocator.Free(Live[i]);
+    }
+    Live.resize(Live.size() / 2);
+    KE_CHECK(Allocator.GetFragmentation() > 0.5f);
+
+    std::vector<uint32> OldOffsets(Live.size());
+    for (size_t i = 0; i < Live.size(); ++i)
+    {
+        OldOffsets[i] = Allocator.GetOffset(Live[i]);
+    }
+
+    std::vector<KTLSFAllocator::FRelocation> Relocations;
+    Allocator.Defragment(Relocations);
+
+    // Copying in reported order must be safe in place
+    uint32 PreviousOffset = 0;
+    for (const KTLSFAllocator::FRelocation& Relocation : Relocations)
+    {
+        KE_CHECK(Relocation.NewOffset < Relocation.OldOffset);
+        KE_CHECK(Relocation.OldOffset >= PreviousOffset);
+        PreviousOffset = Relocation.OldOffset;
+        std::copy_n(Memory.begin() + Relocation.OldOffset, Relocation.Size, Memory.begin() + Relocation.NewOffset);
+    }
+
+    KE_CHECK(Allocator.GetFreeBlockCount() == 1);
+    KE_CHECK(Allocator.GetFragmentation() == 0.0f);
+    KE_CHECK(Allocator.GetLargestFreeBlock() == Capacity - Allocator.GetUsedSize());
+
+    // Every range is packed, kept its relative order, and holds its own data
+    std::vector<uint32> ByOffset;
+    for (size_t i = 0; i < Live.size(); ++i)
+    {
+        const uint32 Handle = Live[i];
+        KE_CHECK(Allocator.GetOffset(Handle) <= OldOffsets[i]);
+        for (uint32 u = 0; u < Allocator.GetSize(Handle); ++u)
+        {
+            KE_REQUIRE(Memory[Allocator.GetOffset(Handle) + u] == Handle + 1);
+        }
+        ByOffset.push_back(Handle);
+    }
+    std::sort(ByOffset.begin(), ByOffset.end(), [&](uint32 A, uint32 B)
+    {
+        return Allocator.GetOffset(A) < Allocator.GetOffset(B);
+    });
+    uint32 End = 0;
+    for (const uint32 Handle : ByOffset)
+    {
+        KE_CHECK(Allocator.GetOffset(Handle) == End);
+        End += Allocator.GetSize(Handle);
+    }
+    KE_CHECK(End == Allocator.GetUsedSize());
+}
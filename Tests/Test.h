@@ -0,0 +1,72 @@
+﻿#pragma once
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+/**
+ * @brief Minimal unit test harness
+ *
+ * KE_TEST registers a test case; TestMain.cpp runs every case of the
+ * executable and returns non-zero if any check failed.
+ */
+namespace KTest
+{
+    using FTestFunction = void (*)();
+
+    struct FTestCase
+    {
+        const char* Name;
+        FTestFunction Function;
+    };
+
+    inline std::vector<FTestCase>& GetTestCases()
+    {
+        static std::vector<FTestCase> TestCases;
+        return TestCases;
+    }
+
+    inline int& GetFailureCount()
+    {
+        static int FailureCount = 0;
+        return FailureCount;
+    }
+
+    struct FRegistrar
+    {
+        FRegistrar(const char* Name, FTestFunction Function) { GetTestCases().push_back({ Name, Function }); }
+    };
+
+    inline void ReportFailure(const char* File, int Line, const char* Expression)
+    {
+        std::printf("  %s(%d): check failed: %s\n", File, Line, Expression);
+        ++GetFailureCount();
+    }
+}
+
+#define KE_TEST(Name)                                                    \
+    static void Name();                                                  \
+    static const KTest::FRegistrar Name##_Registrar(#Name, &Name);       \
+    static void Name()
+
+#define KE_CHECK(Expression)                                             \
+    do                                                                   \
+    {                                                                    \
+        if (!(Expression))                                               \
+        {                                                                \
+            KTest::ReportFailure(__FILE__, __LINE__, #Expression);       \
+        }                                                                \
+    } while (0)
+
+#define KE_CHECK_NEAR(A, B, Tolerance) KE_CHECK(std::fabs((A) - (B)) <= (Tolerance))
+
+// Stops the current test case when the check fails
+#define KE_REQUIRE(Expression)                                           \
+    do                                                                   \
+    {                                                                    \
+        if (!(Expression))                                               \
+        {                                                                \
+            KTest::ReportFailure(__FILE__, __LINE__, #Expression);       \
+            return;                                                      \
+        }                                                                \
+    } while (0)
@@ -0,0 +1,18 @@
+﻿#include "Test.h"
+
+int main()
+{
+    int FailedCases = 0;
+    for (const KTest::FTestCase& TestCase : KTest::GetTestCases())
+    {
+        const int FailuresBefore = KTest::GetFailureCount();
+        TestCase.Function();
+
+        const bool bPassed = KTest::GetFailureCount() == FailuresBefore;
+        std::printf("[%s] %s\n", bPassed ? "PASS" : "FAIL", TestCase.Name);
+        FailedCases += bPassed ? 0 : 1;
+    }
+
+    std::printf("%zu test cases, %d failed\n", KTest::GetTestCases().size(), FailedCases);
+    return FailedCases == 0 ? 0 : 1;
+}
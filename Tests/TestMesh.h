@@ -0,0 +1,70 @@
+﻿#pragma once
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "Graphics/VertexFormat.h"
+
+/**
+ * @brief Mesh file helpers shared by the tests and benchmarks
+ */
+namespace TestMesh
+{
+    /**
+     * @brief Wavefront OBJ text of a triangle list (one v/vt/vn per vertex)
+     *
+     * Texture V is flipped back, as MeshImporter flips it on import.
+     */
+    inline void AppendObj(const std::vector<FStandardVertex>& Vertices, const std::vector<uint32>& Indices,
+                          std::string& OutText)
+    {
+        char Line[160];
+        for (const FStandardVertex& Vertex : Vertices)
+        {
+            std::snprintf(Line, sizeof(Line), "v %.6f %.6f %.6f\nvt %.6f %.6f\nvn %.6f %.6f %.6f\n",
+                          Vertex.Position[0], Vertex.Position[1], Vertex.Position[2],
+                          Vertex.TexCoord[0], 1.0f - Vertex.TexCoord[1],
+                          Vertex.Normal[0], Vertex.Normal[1], Vertex.Normal[2]);
+            OutText += Line;
+        }
+        for (size_t i = 0; i + 2 < Indices.size(); i += 3)
+        {
+            const uint32 A = Indices[i] + 1;
+            const uint32 B = Indices[i + 1] + 1;
+            const uint32 C = Indices[i + 2] + 1;
+            std::snprintf(Line, sizeof(Line), "f %u/%u/%u %u/%u/%u %u/%u/%u\n", A, A, A, B, B, B, C, C, C);
+            OutText += Line;
+        }
+    }
+
+    inline bool WriteTextFile(const std::string& Path, const std::string& Text)
+    {
+        FILE* File = std::fopen(Path.c_str(), "wb");
+        if (!File)
+        {
+            return false;
+        }
+        const bool bWritten = std::fwrite(Text.data(), 1, Text.size(), File) == Text.size();
+        return std::fclose(File) == 0 && bWritten;
+    }
+
+    /**
+     * @brief Fresh directory under the system temp directory (removed by RemoveDirectory)
+     */
+    inline std::string MakeTempDirectory(const char* Name)
+    {
+        const std::filesystem::path Path = std::filesystem::temp_directory_path() / Name;
+        std::error_code Error;
+        std::filesystem::remove_all(Path, Error);
+        std::filesystem::create_directories(Path, Error);
+        return Path.string();
+    }
+
+    inline void RemoveDirectory(const std::string& Path)
+    {
+        std::error_code Error;
+        std::filesystem::remove_all(Path, Error);
+    }
+}
@@ -0,0 +1,229 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Graphics/Animation.h"
+#include "Graphics/OcclusionCuller.h"
+#include "Utils/Bounds.h"
+
+/**
+ * @brief Scene helpers shared by the tests and benchmarks
+ *
+ * Matrices follow Bounds.h: row-major, for row vectors, Direct3D clip space.
+ */
+namespace TestScene
+{
+    /**
+     * @brief Left-handed look-at view times perspective projection
+     */
+    inline void MakeViewProjection(const float Eye[3], const float At[3], float FovY, float Aspect,
+                                   float NearZ, float FarZ, float OutViewProjection[16])
+    {
+        auto Normalize = [](float V[3])
+        {
+            const float Length = std::sqrt(V[0] * V[0] + V[1] * V[1] + V[2] * V[2]);
+            V[0] /= Length;
+            V[1] /= Length;
+            V[2] /= Length;
+        };
+
+        float Z[3] = { At[0] - Eye[0], At[1] - Eye[1], At[2] - Eye[2] };
+        Normalize(Z);
+
+        // Looking straight up or down picks another up vector
+        const float Up[3] = { 0.0f, std::fabs(Z[1]) > 0.99f ? 0.0f : 1.0f, std::fabs(Z[1]) > 0.99f ? 1.0f : 0.0f };
+        float X[3] = { Up[1] * Z[2] - Up[2] * Z[1], Up[2] * Z[0] - Up[0] * Z[2], Up[0] * Z[1] - Up[1] * Z[0] };
+        Normalize(X);
+        const float Y[3] = { Z[1] * X[2] - Z[2] * X[1], Z[2] * X[0] - Z[0] * X[2], Z[0] * X[1] - Z[1] * X[0] };
+
+        const float View[16] = {
+            X[0], Y[0], Z[0], 0.0f,
+            X[1], Y[1], Z[1], 0.0f,
+            X[2], Y[2], Z[2], 0.0f,
+            -(X[0] * Eye[0] + X[1] * Eye[1] + X[2] * Eye[2]),
+            -(Y[0] * Eye[0] + Y[1] * Eye[1] + Y[2] * Eye[2]),
+            -(Z[0] * Eye[0] + Z[1] * Eye[1] + Z[2] * Eye[2]), 1.0f
+        };
+
+        const float Height = 1.0f / std::tan(FovY * 0.5f);
+        const float Q = FarZ / (FarZ - NearZ);
+        const float Projection[16] = {
+            Height / Aspect, 0.0f, 0.0f, 0.0f,
+            0.0f, Height, 0.0f, 0.0f,
+            0.0f, 0.0f, Q, 1.0f,
+            0.0f, 0.0f, -Q * NearZ, 0.0f
+        };
+
+        for (int Row = 0; Row < 4; ++Row)
+        {
+            for (int Column = 0; Column < 4; ++Column)
+            {
+                float Sum = 0.0f;
+                for (int k = 0; k < 4; ++k)
+                {
+                    Sum += View[Row * 4 + k] * Projection[k * 4 + Column];
+                }
+                OutViewProjection[Row * 4 + Column] = Sum;
+            }
+        }
+    }
+
+    /**
+     * @brief Frustum of a camera at Eye looking at At
+     */
+    inline FFrustum MakeFrustum(const float Eye[3], const float At[3], float FovY = 1.0f, float Aspect = 16.0f / 9.0f,
+                                float NearZ = 0.1f, float FarZ = 1000.0f)
+    {
+        float ViewProjection[16];
+        MakeViewProjection(Eye, At, FovY, Aspect, NearZ, FarZ, ViewProjection);
+
+        FFrustum Frustum;
+        Bounds::ExtractFrustumPlanes(ViewProjection, Frustum);
+        return Frustum;
+    }
+
+    /**
+     * @brief Random box inside [-WorldExtent, WorldExtent]^3
+     */
+    inline FBoundingBox RandomBox(std::mt19937& Random, float WorldExtent, float MinExtent, float MaxExtent)
+    {
+        std::uniform_real_distribution<float> Position(-WorldExtent, WorldExtent);
+        std::uniform_real_distribution<float> Size(MinExtent, MaxExtent);
+
+        FBoundingBox Box;
+        for (int Axis = 0; Axis < 3; ++Axis)
+        {
+            Box.Center[Axis] = Position(Random);
+            Box.Extents[Axis] = Size(Random);
+        }
+        return Box;
+    }
+
+    /**
+     * @brief Random frustum looking from inside the world box
+     */
+    inline FFrustum RandomFrustum(std::mt19937& Random, float WorldExtent, float FarZ)
+    {
+        std::uniform_real_distribution<float> Position(-WorldExtent, WorldExtent);
+        const float Eye[3] = { Position(Random), Position(Random), Position(Random) };
+        const float At[3] = { Position(Random), Position(Random), Position(Random) };
+        return MakeFrustum(Eye, At, 1.0f, 16.0f / 9.0f, 0.1f, FarZ);
+    }
+
+    /**
+     * @brief City of BlockCount x BlockCount blocks of 60 m with 20 m streets, 2 x 2 buildings of 15 - 85 m per block
+     *
+     * Blocks start at the origin and extend along +x and +z; street centers are at 70 + 80 k.
+     */
+    inline void MakeCity(std::mt19937& Random, uint32 BlockCount, std::vector<FBoundingBox>& OutBuildings)
+    {
+        constexpr float Pitch = 80.0f;
+        std::uniform_real_distribution<float> Height(15.0f, 85.0f);
+        for (uint32 BlockZ = 0; BlockZ < BlockCount; ++BlockZ)
+        {
+            for (uint32 BlockX = 0; BlockX < BlockCount; ++BlockX)
+            {
+                for (uint32 Building = 0; Building < 4; ++Building)
+                {
+                    const float HalfHeight = 0.5f * Height(Random);
+                    FBoundingBox Box;
+                    Box.Center[0] = BlockX * Pitch + (Building & 1) * 31.0f + 14.5f;
+                    Box.Center[1] = HalfHeight;
+                    Box.Center[2] = BlockZ * Pitch + (Building >> 1) * 31.0f + 14.5f;
+                    Box.Extents[0] = 14.5f;
+                    Box.Extents[1] = HalfHeight;
+                    Box.Extents[2] = 14.5f;
+                    OutBuildings.push_back(Box);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Unit cube [0, 1]^3, clockwise seen from outside (front faces, see FOccluderMesh::bTwoSided)
+     */
+    inline FOccluderMesh MakeUnitCube()
+    {
+        FOccluderMesh Cube;
+        for (uint32 Corner = 0; Corner < 8; ++Corner)
+        {
+            Cube.Positions.push_back((Corner & 1) ? 1.0f : 0.0f);
+            Cube.Positions.push_back((Corner & 2) ? 1.0f : 0.0f);
+            Cube.Positions.push_back((Corner & 4) ? 1.0f : 0.0f);
+        }
+        const uint32 Faces[6][4] = { { 0, 2, 3, 1 }, { 4, 5, 7, 6 }, { 0, 1, 5, 4 }, { 2, 6, 7, 3 }, { 0, 4, 6, 2 }, { 1, 3, 7, 5 } };
+        for (const auto& Face : Faces)
+        {
+            const uint32 Triangles[6] = { Face[0], Face[1], Face[2], Face[0], Face[2], Face[3] };
+            Cube.Indices.insert(Cube.Indices.end(), Triangles, Triangles + 6);
+        }
+        Cube.Bounds = Bounds::ComputeBox(Cube.Positions.data(), 8, 3 * sizeof(float));
+        return Cube;
+    }
+
+    /**
+     * @brief World matrix mapping the unit cube onto Box
+     */
+    inline void MakeBoxMatrix(const FBoundingBox& Box, float OutWorld[16])
+    {
+        std::fill(OutWorld, OutWorld + 16, 0.0f);
+        for (uint32 Axis = 0; Axis < 3; ++Axis)
+        {
+            OutWorld[Axis * 5] = 2.0f * Box.Extents[Axis];
+            OutWorld[12 + Axis] = Box.Center[Axis] - Box.Extents[Axis];
+        }
+        OutWorld[15] = 1.0f;
+    }
+
+    /**
+     * @brief Rotation of Angle radians about Axis (need not be normalized)
+     */
+    inline void MakeQuaternion(const float Axis[3], float Angle, float OutRotation[4])
+    {
+        const float Length = std::sqrt(Axis[0] * Axis[0] + Axis[1] * Axis[1] + Axis[2] * Axis[2]);
+        const float S = std::sin(Angle * 0.5f) / Length;
+        OutRotation[0] = Axis[0] * S;
+        OutRotation[1] = Axis[1] * S;
+        OutRotation[2] = Axis[2] * S;
+        OutRotation[3] = std::cos(Angle * 0.5f);
+    }
+
+    /**
+     * @brief Chain of joints with a branch every fourth joint
+     */
+    inline void MakeSkeleton(uint32 JointCount, std::mt19937& Random, KSkeleton& OutSkeleton)
+    {
+        std::uniform_real_distribution<float> Unit(-1.0f, 1.0f);
+        std::vector<FSkeletonJoint> Joints(JointCount);
+        for (uint32 Joint = 0; Joint < JointCount; ++Joint)
+        {
+            Joints[Joint].Name = "Joint" + std::to_string(Joint);
+            Joints[Joint].Parent = Joint == 0 ? -1 : static_cast<int32>(Joint % 4 == 0 ? Joint / 2 : Joint - 1);
+            const float Axis[3] = { Unit(Random), Unit(Random), Unit(Random) + 2.0f };
+            MakeQuaternion(Axis, Unit(Random), Joints[Joint].BindPose.Rotation);
+            Joints[Joint].BindPose.Translation[1] = 0.5f + 0.1f * Unit(Random);
+        }
+        OutSkeleton.Initialize(Joints.data(), JointCount, true);
+    }
+
+    /**
+     * @brief Smallest plane margin of a box (negative: outside that plane by the margin)
+     */
+    inline float GetFrustumMargin(const FFrustum& Frustum, const FBoundingBox& Box)
+    {
+        float Margin = 1.0e30f;
+        for (const FPlane& Plane : Frustum.Planes)
+        {
+            const float Radius = Box.Extents[0] * std::fabs(Plane.Normal[0]) +
+                                 Box.Extents[1] * std::fabs(Plane.Normal[1]) +
+                                 Box.Extents[2] * std::fabs(Plane.Normal[2]);
+            const float Distance = Plane.GetSignedDistance(Box.Center) + Radius;
+            Margin = Distance < Margin ? Distance : Margin;
+        }
+        return Margin;
+    }
+}
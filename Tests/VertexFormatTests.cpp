@@ -0,0 +1,246 @@
+﻿#include "Test.h"
+#include "Graphics/VertexFormat.h"
+
+#include <cmath>
+#include <limits>
+#include <random>
+
+namespace
+{
+    // Angle between a unit normal and its SNorm16 octahedral round trip
+    constexpr float MaxNormalAngle = 1.0e-4f;
+
+    float RoundTripAngle(const float Normal[3])
+    {
+        int16 Encoded[2];
+        float Decoded[3];
+        VertexFormat::EncodeOctahedralNormal(Normal, Encoded);
+        VertexFormat::DecodeOctahedralNormal(Encoded, Decoded);
+
+        const float Length = std::sqrt(Decoded[0] * Decoded[0] + Decoded[1] * Decoded[1] + Decoded[2] * Decoded[2]);
+        KE_CHECK_NEAR(Length, 1.0f, 1.0e-5f);
+
+        // atan2 of the cross and dot products stays accurate for tiny angles, unlike acos
+        const double Cross[3] =
+        {
+            double(Normal[1]) * Decoded[2] - double(Normal[2]) * Decoded[1],
+            double(Normal[2]) * Decoded[0] - double(Normal[0]) * Decoded[2],
+            double(Normal[0]) * Decoded[1] - double(Normal[1]) * Decoded[0]
+        };
+        const double Dot = double(Normal[0]) * Decoded[0] + double(Normal[1]) * Decoded[1] + double(Normal[2]) * Decoded[2];
+        return static_cast<float>(std::atan2(std::sqrt(Cross[0] * Cross[0] + Cross[1] * Cross[1] + Cross[2] * Cross[2]), Dot));
+    }
+}
+
+KE_TEST(OctahedralNormalRoundTripIsAccurate)
+{
+    // Poles, axes and the folded lower hemisphere's diagonals
+    const float Special[][3] =
+    {
+        { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f },
+        { 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f },
+        { 0.57735027f, 0.57735027f, -0.57735027f }, { -0.57735027f, 0.57735027f, -0.57735027f },
+        { 0.57735027f, -0.57735027f, -0.57735027f }, { -0.57735027f, -0.57735027f, -0.57735027f },
+        { 0.70710678f, 0.0f, -0.70710678f }, { 0.0f, -0.70710678f, -0.70710678f }
+    };
+    for (const float* Normal : Special)
+    {
+        KE_CHECK(RoundTripAngle(Normal) <= MaxNormalAngle);
+    }
+
+    int16 Encoded[2];
+    float Decoded[3];
+    const float SouthPole[3] = { 0.0f, 0.0f, -1.0f };
+    VertexFormat::EncodeOctahedralNormal(SouthPole, Encoded);
+    VertexFormat::DecodeOctahedralNormal(Encoded, Decoded);
+    KE_CHECK(Decoded[0] == 0.0f && Decoded[1] == 0.0f && Decoded[2] == -1.0f);
+
+    // Uniform over the sphere
+    std::mt19937 Random(11);
+    std::normal_distribution<float> Gaussian;
+    float MaxAngle = 0.0f;
+    for (int i = 0; i < 100000; ++i)
+    {
+        float Normal[3] = { Gaussian(Random), Gaussian(Random), Gaussian(Random) };
+        const float Length = std::sqrt(Normal[0] * Normal[0] + Normal[1] * Normal[1] + Normal[2] * Normal[2]);
+        if (Length < 1.0e-3f)
+        {
+            continue;
+        }
+        for (float& Component : Normal)
+        {
+            Component /= Length;
+        }
+        const float Angle = RoundTripAngle(Normal);
+        MaxAngle = Angle > MaxAngle ? Angle : MaxAngle;
+    }
+    KE_CHECK(MaxAngle <= MaxNormalAngle);
+}
+
+KE_TEST(HalfFloatConversionIsExact)
+{
+    KE_CHECK(VertexFormat::FloatToHalf(0.0f) == 0x0000);
+    KE_CHECK(VertexFormat::FloatToHalf(-0.0f) == 0x8000);
+    KE_CHECK(VertexFormat::FloatToHalf(1.0f) == 0x3C00);
+    KE_CHECK(VertexFormat::FloatToHalf(-2.0f) == 0xC000);
+    KE_CHECK(VertexFormat::FloatToHalf(0.5f) == 0x3800);
+    KE_CHECK(VertexFormat::FloatToHalf(65504.0f) == 0x7BFF);
+    KE_CHECK(VertexFormat::FloatToHalf(std::ldexp(1.0f, -14)) == 0x0400);
+
+    // Round to nearest, ties to even
+    KE_CHECK(VertexFormat::FloatToHalf(1.0f + std::ldexp(1.0f, -11)) == 0x3C00);
+    KE_CHECK(VertexFormat::FloatToHalf(1.0f + 3.0f * std::ldexp(1.0f, -11)) == 0x3C02);
+    KE_CHECK(VertexFormat::FloatToHalf(1.0f + std::ldexp(1.0f, -11) + std::ldexp(1.0f, -20)) == 0x3C01);
+    KE_CHECK(VertexFormat::FloatToHalf(2047.5f) == 0x6800);
+
+    // Denormals, including ties and underflow
+    KE_CHECK(VertexFormat::FloatToHalf(std::ldexp(1.0f, -24)) == 0x0001);
+    KE_CHECK(VertexFormat::FloatToHalf(std::ldexp(1.0f, -25)) == 0x0000);
+    KE_CHECK(VertexFormat::FloatToHalf(3.0f * std::ldexp(1.0f, -25)) == 0x0002);
+    KE_CHECK(VertexFormat::FloatToHalf(std::ldexp(1.0f, -14) - std::ldexp(1.0f, -24)) == 0x03FF);
+    KE_CHECK(VertexFormat::FloatToHalf(-std::ldexp(1.0f, -30)) == 0x8000);
+    KE_CHECK(VertexFormat::HalfToFloat(0x0001) == std::ldexp(1.0f, -24));
+    KE_CHECK(VertexFormat::HalfToFloat(0x03FF) == std::ldexp(1023.0f, -24));
+
+    // Overflow to infinity: 65520 is the tie between 65504 and 65536
+    KE_CHECK(VertexFormat::FloatToHalf(65519.0f) == 0x7BFF);
+    KE_CHECK(VertexFormat::FloatToHalf(65520.0f) == 0x7C00);
+    KE_CHECK(VertexFormat::FloatToHalf(-1.0e6f) == 0xFC00);
+    KE_CHECK(VertexFormat::FloatToHalf(std::numeric_limits<float>::infinity()) == 0x7C00);
+    KE_CHECK(std::isinf(VertexFormat::HalfToFloat(0x7C00)));
+
+    // NaN stays NaN
+    const uint16 HalfNaN = VertexFormat::FloatToHalf(std::numeric_limits<float>::quiet_NaN());
+    KE_CHECK((HalfNaN & 0x7C00) == 0x7C00 && (HalfNaN & 0x03FF) != 0);
+    KE_CHECK(std::isnan(VertexFormat::HalfToFloat(0x7C01)));
+    KE_CHECK(std::isnan(VertexFormat::HalfToFloat(0xFE00)));
+
+    // Every non-NaN half round-trips through float exactly
+    for (uint32 Half = 0; Half <= 0xFFFF; ++Half)
+    {
+        const float Value = VertexFormat::HalfToFloat(static_cast<uint16>(Half));
+        if (std::isnan(Value))
+        {
+            KE_CHECK((Half & 0x7C00) == 0x7C00 && (Half & 0x03FF) != 0);
+            continue;
+        }
+        KE_CHECK(VertexFormat::FloatToHalf(Value) == Half);
+    }
+
+    // Halfway between two adjacent finite halves (exact in float) rounds to the even one
+    for (uint32 Half = 0x0000; Half < 0x7BFF; ++Half)
+    {
+        const double Low = VertexFormat::HalfToFloat(static_cast<uint16>(Half));
+        const double High = VertexFormat::HalfToFloat(static_cast<uint16>(Half + 1));
+        const float Midpoint = static_cast<float>((Low + High) * 0.5);
+        KE_CHECK(VertexFormat::FloatToHalf(Midpoint) == ((Half & 1) ? Half + 1 : Half));
+    }
+}
+
+KE_TEST(QuantizedPositionsDecodeWithinOneStep)
+{
+    FBoundingBox Bounds;
+    Bounds.Center[0] = 12.5f;
+    Bounds.Center[1] = -3.0f;
+    Bounds.Center[2] = 1000.0f;
+    Bounds.Extents[0] = 40.0f;
+    Bounds.Extents[1] = 0.25f;
+    Bounds.Extents[2] = 7.0f;
+
+    float Matrix[16];
+    VertexFormat::GetPositionDecodeMatrix(Bounds, Matrix);
+
+    std::mt19937 Random(5);
+    std::uniform_real_distribution<float> Unit(-1.0f, 1.0f);
+    std::vector<FStandardVertex> Vertices(4096);
+    for (size_t i = 0; i < Vertices.size(); ++i)
+    {
+        for (int Axis = 0; Axis < 3; ++Axis)
+        {
+            // The first eight vertices are the corners of the bounds
+            const float Offset = i < 8 ? ((i >> Axis) & 1 ? 1.0f : -1.0f) : Unit(Random);
+            Vertices[i].Position[Axis] = Bounds.Center[Axis] + Offset * Bounds.Extents[Axis];
+        }
+    }
+
+    std::vector<uint8> Streams[VertexFormat::MaxStreams];
+    KE_REQUIRE(VertexFormat::Encode(Vertices.data(), static_cast<uint32>(Vertices.size()), EVertexLayout::Quantized,
+                                    Bounds, Streams));
+    KE_REQUIRE(Streams[0].size() == sizeof(FQuantizedVertex) * Vertices.size());
+    const FQuantizedVertex* Quantized = reinterpret_cast<const FQuantizedVertex*>(Streams[0].data());
+
+    for (size_t i = 0; i < Vertices.size(); ++i)
+    {
+        // Row vector times the decode matrix, as the vertex shader does with the SNorm input
+        float Input[4];
+        for (int Component = 0; Component < 4; ++Component)
+        {
+            Input[Component] = VertexFormat::DequantizeSNorm16(Quantized[i].Position[Component]);
+        }
+        KE_CHECK(Input[3] == 1.0f);
+
+        for (int Axis = 0; Axis < 3; ++Axis)
+        {
+            float Decoded = 0.0f;
+            for (int Row = 0; Row < 4; ++Row)
+            {
+                Decoded += Input[Row] * Matrix[Row * 4 + Axis];
+            }
+
+            const float Step = Bounds.Extents[Axis] / 32767.0f;
+            const float Slack = 1.0e-6f * std::fabs(Bounds.Center[Axis]) + 1.0e-6f;
+            KE_CHECK(std::fabs(Decoded - Vertices[i].Position[Axis]) <= Step + Slack);
+            KE_CHECK(std::fabs(Decoded - Bounds.Center[Axis]) <= Bounds.Extents[Axis] + Slack);
+        }
+    }
+    KE_CHECK(Matrix[15] == 1.0f && Matrix[3] == 0.0f && Matrix[7] == 0.0f && Matrix[11] == 0.0f);
+}
+
+KE_TEST(SkinWeightsSumTo255)
+{
+    const uint8 Joints[4] = { 3, 9, 27, 81 };
+    FSkinInfluences Influences;
+
+    auto CheckWeights = [&](const float Weights[4])
+    {
+        VertexFormat::EncodeSkinInfluences(Joints, Weights, Influences);
+        uint32 Total = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            KE_CHECK(Influences.JointIndices[i] == Joints[i]);
+            Total += Influences.JointWeights[i];
+        }
+        KE_CHECK(Total == 255);
+    };
+
+    // Thirds round down, and the lost unit goes to the largest weight
+    const float Thirds[4] = { 1.0f, 1.0f, 1.0f, 0.0f };
+    CheckWeights(Thirds);
+    KE_CHECK(Influences.JointWeights[0] == 85 && Influences.JointWeights[1] == 85 && Influences.JointWeights[2] == 85);
+    KE_CHECK(Influences.JointWeights[3] == 0);
+
+    // No weight at all: the first joint takes it
+    const float Zero[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    CheckWeights(Zero);
+    KE_CHECK(Influences.JointWeights[0] == 255);
+
+    // Negative weights are ignored, unnormalized ones are normalized
+    const float Mixed[4] = { -1.0f, 2.0f, 6.0f, 0.0f };
+    CheckWeights(Mixed);
+    KE_CHECK(Influences.JointWeights[0] == 0 && Influences.JointWeights[3] == 0);
+    KE_CHECK(Influences.JointWeights[1] == 64 && Influences.JointWeights[2] == 191);
+
+    std::mt19937 Random(3);
+    std::uniform_real_distribution<float> Unit(0.0f, 1.0f);
+    for (int i = 0; i < 100000; ++i)
+    {
+        float Weights[4];
+        for (float& Weight : Weights)
+        {
+            // Some influences unused, some tiny
+            const float Value = Unit(Random);
+            Weight = Value < 0.3f ? 0.0f : (Value < 0.4f ? Value * 1.0e-3f : Value);
+        }
+        CheckWeights(Weights);
+    }
+}
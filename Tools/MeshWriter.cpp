@@ -0,0 +1,130 @@
+﻿#include "../Engine/Graphics/MeshFile.h"
+#include "../Engine/Graphics/MeshImporter.h"
+#include "../Engine/Core/JobSystem.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+/**
+ * @brief Mesh writer tool
+ *
+ * Converts an OBJ or glTF file into a binary mesh file that KMesh::LoadFromFile
+ * maps and uploads without conversion. Import, optimization, LOD generation and
+ * vertex encoding run here, at build time.
+ *
+ * Usage: MeshWriter <input.obj|.gltf|.glb> <output.kmesh> [--layout <name>] [--lods <count>] [--no-optimize]
+ */
+
+namespace
+{
+    bool ParseLayout(const char* Name, EVertexLayout& OutLayout)
+    {
+        static const struct { const char* Name; EVertexLayout Layout; } Layouts[] = {
+            { "standard", EVertexLayout::Standard },
+            { "compact", EVertexLayout::Compact },
+            { "compact-split", EVertexLayout::CompactSplit },
+            { "quantized", EVertexLayout::Quantized },
+            { "quantized-split", EVertexLayout::QuantizedSplit },
+        };
+        for (const auto& Entry : Layouts)
+        {
+            if (std::strcmp(Name, Entry.Name) == 0)
+            {
+                OutLayout = Entry.Layout;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void PrintUsage()
+    {
+        std::fprintf(stderr,
+            "Usage: MeshWriter <input.obj|.gltf|.glb> <output.kmesh> [options]\n"
+            "  --layout <standard|compact|compact-split|quantized|quantized-split>  (default: standard)\n"
+            "  --lods <count>    LODs after LOD 0, each half the previous (default: 3, single-material meshes only)\n"
+            "  --no-optimize     Keep the authored index and vertex order\n");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    EVertexLayout Layout = EVertexLayout::Standard;
+    uint32 LODCount = 3;
+    bool bOptimize = true;
+    for (int i = 3; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--layout") == 0 && i + 1 < argc && ParseLayout(argv[i + 1], Layout))
+        {
+            ++i;
+        }
+        else if (std::strcmp(argv[i], "--lods") == 0 && i + 1 < argc)
+        {
+            LODCount = static_cast<uint32>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--no-optimize") == 0)
+        {
+            bOptimize = false;
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+
+    FMeshLODSettings LODSettings;
+    LODSettings.TriangleRatios.clear();
+    float Ratio = 1.0f;
+    for (uint32 i = 0; i < LODCount && i + 1 < FMeshLODSettings::MaxLODs; ++i)
+    {
+        Ratio *= 0.5f;
+        LODSettings.TriangleRatios.push_back(Ratio);
+    }
+
+    KJobSystem JobSystem;
+    JobSystem.Initialize();
+
+    FImportedMesh Mesh;
+    FMeshImportStats ImportStats;
+    if (!MeshImporter::Import(argv[1], Mesh, FMeshImportSettings(), &JobSystem, &ImportStats))
+    {
+        std::fprintf(stderr, "%s\n", ImportStats.Error.c_str());
+        return 1;
+    }
+    std::printf("%s: imported in %.1f ms (%.1f MB/s)\n", argv[1], ImportStats.Seconds * 1000.0,
+                ImportStats.BytesRead / 1.0e6 / (ImportStats.Seconds > 0.0 ? ImportStats.Seconds : 1.0));
+
+    FMeshBuildData Build;
+    const bool bBuilt = MeshFile::Build(Mesh.Vertices.data(), static_cast<uint32>(Mesh.Vertices.size()),
+                                        Mesh.Indices.data(), static_cast<uint32>(Mesh.Indices.size()),
+                                        Layout, bOptimize, Build,
+                                        Mesh.Submeshes.data(), static_cast<uint32>(Mesh.Submeshes.size()),
+                                        LODSettings.TriangleRatios.empty() ? nullptr : &LODSettings, &JobSystem);
+    JobSystem.Shutdown();
+    if (!bBuilt)
+    {
+        std::fprintf(stderr, "Failed to build mesh data for %s\n", argv[1]);
+        return 1;
+    }
+
+    if (!MeshFile::WriteFile(Build.Data, argv[2]))
+    {
+        std::fprintf(stderr, "Failed to write %s\n", argv[2]);
+        return 1;
+    }
+
+    std::printf("%s: %u vertices, %u triangles, %u submeshes, %u LODs, ACMR %.2f -> %.2f\n",
+                argv[2], Build.Data.VertexCount, Build.Data.LODs ? Build.Data.LODs[0].IndexCount / 3 : 0,
+                Build.Data.SubmeshCount, Build.Data.LODCount,
+                Build.OptimizeStats.Before.ACMR, Build.OptimizeStats.After.ACMR);
+    return 0;
+}